@@ -20,7 +20,7 @@
 typedef struct button *Button;
 
 Button createButton(char*, bool);
-void setButtonSelected(Button, bool);
+bool setButtonSelected(Button, bool);
 void freeButton(Button b);
 Button copyButton(Button b);
 void renderButton(Button, int* __restrict__ x, int* __restrict__ y, int, int);
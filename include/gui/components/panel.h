@@ -24,8 +24,8 @@
 typedef struct panel* Panel;
 
 Panel emptyPanel();
-void setPNButtonSelected(Panel, bool, int);
-void setPNText(Panel, int, char*);
+bool setPNButtonSelected(Panel, bool, int);
+bool setPNText(Panel, int, char*);
 void panelInsert(Panel, VisualElement);
 void renderPanel(Panel, int, int, int, int);
 Panel copyPanel(Panel);
@@ -12,6 +12,8 @@
  */
 #define _TEXT_H_
 
+#include <stdbool.h>
+
 /**
  * @brief The componennt representing basic text
  * 
@@ -21,7 +23,7 @@ typedef struct text* Text;
 Text createText(char*, int);
 Text createTextFromWide(wchar_t*, int);
 Text copyText(Text);
-void setText(Text, char*);
+bool setText(Text, char*);
 void printText(Text, int*, int*, int);
 void freeText(Text);
 
@@ -26,8 +26,8 @@ typedef enum contentType {
  */
 typedef struct visualElement *VisualElement;
 
-void setVEButtonSelected(VisualElement, bool);
-void setVEText(VisualElement, char*);
+bool setVEButtonSelected(VisualElement, bool);
+bool setVEText(VisualElement, char*);
 VisualElement createVEWideText(wchar_t*);
 VisualElement createVisualElement(ContentType, void*);
 VisualElement copyVisualElement(VisualElement);
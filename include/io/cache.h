@@ -11,6 +11,8 @@
  */
 #define _CACHE_H_
 
+#include <sys/mman.h>
+
 #include "../utils/utils.h"
 
 /**
@@ -32,20 +34,87 @@ typedef unsigned long long pos_t;
 #define POS_T_MAX ULONG_MAX
 
 /**
- * @brief The size of a #Line of #Cache
+ * @brief The default size of a #Line of #Cache (suits index files, read 16 bytes at a time)
  * 
  */
 #define CACHE_LINE_SIZE 1024
 
-Cache getCache(int);
+/**
+ * @brief The size of a #Line of #Cache suiting record and group files, read in long runs
+ * 
+ */
+#define CACHE_BIG_LINE_SIZE 65536
+
+/**
+ * @brief The default number of independently locked shards of a #Cache
+ * 
+ */
+#define CACHE_SHARD_NUM 64
+
+/**
+ * @brief   Serve the read-only files of a loaded catalog from memory mappings (see @ref mapCacheFile).
+ *          Comment out to bound the memory used by the catalog to the size of the #Cache
+ * 
+ */
+#define CACHE_MMAP
+
+/**
+ * @brief   Read the record files of a loaded catalog with O_DIRECT, bypassing the kernel page cache, so their data is
+ *          only held once, by the #Line of the #Cache (see @ref setCacheFileDirect). Takes the place of
+ *          @ref CACHE_MMAP for those files, and drops the published files from the page cache once written.
+ *          Uncomment to bound the memory used by the catalog, page cache included, to the size of the #Cache
+ * 
+ */
+//#define CACHE_DIRECT_IO
+
+/**
+ * @brief The alignment (in bytes) of the buffers, positions and sizes of the reads done with O_DIRECT
+ * 
+ */
+#define CACHE_DIRECT_ALIGNMENT 4096
+
+/**
+ * @brief The maximum number of #Line of each pool whose keys are kept by a snapshot of a #Cache (see @ref saveCacheSnapshot)
+ * 
+ */
+#define CACHE_SNAPSHOT_LINES 65536
+
+/**
+ * @brief The size of the tag identifying the contents of the files of a snapshot of a #Cache
+ * 
+ */
+#define CACHE_SNAPSHOT_TAG_SIZE 64
+
+/**
+ * @brief The eviction policies available to a #Cache
+ * 
+ */
+typedef enum cachePolicy {
+    CACHE_LRU,  ///< Evicts the least recently accessed line
+    CACHE_2Q    ///< 2Q: lines accessed once are kept apart from the hot lines, so long scans cannot evict the latter
+} CachePolicy;
+
+Cache getCache(int, int, CachePolicy);
+bool addCachePool(Cache, int, int);
+bool growCachePool(Cache, int, int);
+bool registerCacheFile(Cache, FILE*, int);
+
 int getLine(Cache, FILE*, pos_t, char[], int);
 int getStr(Cache, FILE*, pos_t, char[], int);
 int getInt(Cache, FILE*, pos_t);
 pos_t getPosT(Cache, FILE*, pos_t);
 void setStr(Cache, FILE*, pos_t, char[], int);
 
+void prefetchRange(Cache, FILE*, pos_t, pos_t);
+void cancelPrefetchFile(Cache, FILE*);
+
+bool mapCacheFile(Cache, FILE*, int);
+void unmapCacheFile(Cache, FILE*);
+bool setCacheFileDirect(Cache, FILE*);
+
 void flushCacheFile(Cache, FILE*);
 void flushCache(Cache);
+void startCacheFlusher(Cache, int);
 
 void refreshCacheFile(Cache, FILE*);
 void refreshCache(Cache);
@@ -53,6 +122,11 @@ void refreshCache(Cache);
 void clearCacheFile(Cache, FILE*);
 void clearCache(Cache);
 
+bool saveCacheSnapshot(Cache, char*, FILE*[], int, char*);
+bool loadCacheSnapshot(Cache, char*, FILE*[], int, char*);
+
+void getCacheStatistics(Cache, long*, long*);
+
 void freeCache(Cache);
 
 #endif
\ No newline at end of file
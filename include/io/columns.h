@@ -0,0 +1,34 @@
+/**
+ * @file columns.h
+ * 
+ * File containing declaration of functions used to store fixed-width columns of integers in a memory mapped file
+ */
+
+#ifndef _COLUMNS_H_
+
+/**
+ * @brief Include guard
+ */
+#define _COLUMNS_H_
+
+#include "../utils/utils.h"
+
+/**
+ * @brief The size of the header of a #ColumnFile (so that the columns start aligned to a cache line)
+ */
+#define COLUMN_FILE_HEADER_SIZE 64
+
+/**
+ * @brief   A file of columns of the same number of rows, each stored as a contiguous array of integers and served
+ *          straight from a memory mapping of the file
+ */
+typedef struct columnFile * ColumnFile;
+
+ColumnFile makeColumnFile(char*, int, int);
+ColumnFile openColumnFile(char*);
+int* getColumn(ColumnFile, int);
+int getColumnFileRows(ColumnFile);
+bool syncColumnFile(ColumnFile);
+void freeColumnFile(ColumnFile);
+
+#endif
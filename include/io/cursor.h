@@ -0,0 +1,38 @@
+/**
+ * @file cursor.h
+ *
+ * File containing declaration of functions used to scan a range of an #Indexer in batches, decoding only some
+ * members of its records
+ */
+
+#ifndef _CURSOR_H_
+
+/**
+ * @brief Include guard
+ */
+#define _CURSOR_H_
+
+#include "../utils/utils.h"
+#include "../types/format.h"
+#include "cache.h"
+#include "indexer.h"
+
+/**
+ * @brief The number of records decoded by each batch of a #Cursor
+ */
+#define CURSOR_BATCH_SIZE 256
+
+/**
+ * @brief   A cursor over the positions [from, to) of a sorted #Indexer, which decodes the members of a projection of the
+ *          records of a batch of positions at once, each member into its own array (struct of arrays)
+ */
+typedef struct cursor * Cursor;
+
+Cursor openCursor(Indexer, int, int, Format, int*, int);
+int nextCursorBatch(Cursor, Cache);
+int getCursorPosition(Cursor);
+pos_t* getCursorKeys(Cursor);
+void* getCursorColumn(Cursor, int);
+void closeCursor(Cursor);
+
+#endif
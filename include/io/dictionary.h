@@ -0,0 +1,33 @@
+/**
+ * @file dictionary.h
+ *
+ * File containing declaration of functions used to encode the few distinct values of a string field into small
+ * integer ids
+ */
+
+#ifndef _DICTIONARY_H_
+
+/**
+ * @brief Include guard
+ */
+#define _DICTIONARY_H_
+
+#include "../utils/utils.h"
+
+/**
+ * @brief   A dictionary of words, each identified by the order it was added in (0, 1, ...), so the ids of the words
+ *          added before are kept when new ones are added
+ */
+typedef struct dictionary * Dictionary;
+
+Dictionary makeDictionary();
+int addToDictionary(Dictionary, char*);
+int getDictionaryId(Dictionary, char*);
+char* getDictionaryWord(Dictionary, int);
+int getDictionarySize(Dictionary);
+
+bool saveDictionary(Dictionary, char*);
+Dictionary loadDictionary(char*);
+void freeDictionary(Dictionary);
+
+#endif
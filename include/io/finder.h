@@ -1,17 +1,18 @@
 /**
  * @file finder.h
  * 
- * File containing declaration of functions used to index a file
+ * File containing declaration of functions used to search the lines of a file for a substring
  */
 
 
-#ifndef _INDEXER_H_
+#ifndef _FINDER_H_
 
 /**
  * @brief Include guard
  */
-#define _INDEXER_H_
+#define _FINDER_H_
 
-void finder(char*, char*, char*);
+void indexFinderFile(char*);
+void finder(char*, char*, char*, int);
 
-#endif
\ No newline at end of file
+#endif
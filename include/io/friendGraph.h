@@ -0,0 +1,34 @@
+/**
+ * @file friendGraph.h
+ *
+ * File containing declaration of functions used to store the friendships of the users as a graph over dense indices,
+ * for fast friendship checks
+ */
+
+#ifndef _FRIENDGRAPH_H_
+
+/**
+ * @brief Include guard
+ */
+#define _FRIENDGRAPH_H_
+
+#include "../utils/utils.h"
+
+/**
+ * @brief   The friends of each user, as a compressed sparse row graph: each user is a node (its index in the sorted ids),
+ *          whose friends are a sorted run of nodes, summarized by a 64 bits signature that rejects most non friends
+ *          without reading the run
+ */
+typedef struct friendGraph * FriendGraph;
+
+FriendGraph makeFriendGraph(int*, int);
+void addFriends(FriendGraph, int, int*, int);
+int getFriendGraphNode(FriendGraph, int);
+int getFriendGraphSize(FriendGraph);
+bool areFriends(FriendGraph, int, int);
+
+bool saveFriendGraph(FriendGraph, char*);
+FriendGraph loadFriendGraph(char*);
+void freeFriendGraph(FriendGraph);
+
+#endif
@@ -0,0 +1,51 @@
+/**
+ * @file idSet.h
+ * 
+ * File containing declaration of functions used to check whether an id exists without accessing the disk
+ */
+
+#ifndef _ID_SET_H_
+
+/**
+ * @brief Include guard
+ */
+#define _ID_SET_H_
+
+#include "../utils/utils.h"
+
+/**
+ * @brief Ids up to this value are always stored in a bitmap (8MB)
+ */
+#define ID_SET_MIN_BITMAP_BITS 67108864
+
+/**
+ * @brief The maximum number of bits per id a bitmap may use before a Bloom filter is used instead
+ */
+#define ID_SET_MAX_BITS_PER_ID 64
+
+/**
+ * @brief The number of bits per id of a Bloom filter
+ */
+#define ID_SET_BLOOM_BITS_PER_ID 16
+
+/**
+ * @brief The number of hash functions of a Bloom filter
+ */
+#define ID_SET_BLOOM_HASHES 4
+
+/**
+ * @brief   A set of non-negative ids: an exact bitmap if the ids are dense enough, or a Bloom filter otherwise
+ *          (which may report ids not in the set as present, see @ref isIdSetExact)
+ */
+typedef struct idSet * IdSet;
+
+IdSet makeIdSet(int, int);
+void addToIdSet(IdSet, int);
+bool mayContainId(IdSet, int);
+bool isIdSetExact(IdSet);
+
+bool saveIdSet(IdSet, char*);
+IdSet loadIdSet(char*);
+void freeIdSet(IdSet);
+
+#endif
@@ -20,8 +20,21 @@
 #define IMBED_INT(i) ((pos_t)i)
 #define GET_IMBEDDED_INT(p) ((int)p)
 
+/**
+ * @brief The maximum number of files of an #Indexer read through the #Cache (see @ref getIndexerFiles)
+ */
+#define INDEXER_MAX_FILES 3
+
 typedef struct indexer * Indexer;
 
+/**
+ * @brief A function scanning the positions [from, to) of an #Indexer as a partition of @ref scanIndexerRange, given the
+ *        #Indexer, the range, the number of the partition and a state
+ */
+typedef void (*IndexerScan)(Indexer, int, int, int, void*);
+
+int directCmp(FILE*, pos_t, FILE*, pos_t, Cache);
+
 Indexer makeIndexer(char*, FILE*, FILE*, int (*cmpKeys)(FILE*, pos_t, FILE*, pos_t, Cache));
 Indexer parseIndexer(char*, FILE*, FILE*, int (*cmpKeys)(FILE*, pos_t, FILE*, pos_t, Cache));
 Indexer parseGroupedIndexer(char*, char*, FILE*, FILE*, int (*cmpKeys)(FILE*, pos_t, FILE*, pos_t, Cache));
@@ -33,6 +46,9 @@ int getElemNumber(Indexer);
 void insertIntoIndex(Indexer, pos_t, pos_t);
 void sortIndexer(Indexer, Cache);
 void groupIndexer(Indexer, char*, bool, Cache);
+void sortAndGroupIndexer(Indexer, char*, bool, Cache);
+void mergeIndexer(Indexer, Indexer, Cache);
+void mergeGroupedIndexer(Indexer, Indexer, char*, bool, Cache);
 
 int retrieveKey(Indexer, pos_t, Cache);
 int retrieveKeyLowerBound(Indexer, pos_t, Cache);
@@ -40,6 +56,9 @@ int retrieveKeyLowerBound(Indexer, pos_t, Cache);
 pos_t retrieveEmbeddedKey(Indexer, int, Cache);
 pos_t retrieveEmbeddedValue(Indexer, int, Cache);
 void retrieveValueAsLazy(Indexer, int, Cache, Lazy);
+int retrieveLines(Indexer, int, int, pos_t*, pos_t*, Cache);
+FILE* getValuesFile(Indexer);
+int getIndexerFiles(Indexer, FILE*[]);
 
 pos_t getEmbeddedValue(Indexer, pos_t, Cache);
 bool findEmbeddedValue(Indexer, pos_t, Cache, pos_t*);
@@ -48,9 +67,14 @@ bool findValueAsLazy(Indexer, pos_t, Cache, Lazy);
 #define getGroup(i, p, c) getEmbeddedValue(i, p, c)
 #define retrieveGroup(i, o, c) retrieveEmbeddedValue(i, o, c)
 int getGroupSize(Indexer, pos_t, Cache);
-pos_t getGroupElem(Indexer, pos_t, int, Cache);
-void getGroupElemAsLazy(Indexer, pos_t, int, Cache, Lazy);
+pos_t* getGroupElems(Indexer, pos_t, int*, Cache);
+void getGroupElemAsLazy(Indexer, pos_t, Lazy);
+
+int getScanPartitions(int);
+void scanIndexerRange(Indexer, int, int, int, IndexerScan, void*);
 
+void registerIndexer(Indexer, Cache);
+void mapIndexer(Indexer, Cache);
 void freeIndexer(Indexer, Cache);
 
 /**
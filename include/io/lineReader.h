@@ -0,0 +1,31 @@
+/**
+ * @file lineReader.h
+ * 
+ * File containing declaration of functions used to read the lines of a text file in large blocks
+ */
+
+#ifndef _LINE_READER_H_
+
+/**
+ * @brief Include guard
+ */
+#define _LINE_READER_H_
+
+#include "../utils/utils.h"
+
+/**
+ * @brief The size of the blocks read from the file at once (4MB)
+ */
+#define LINE_READER_BLOCK_SIZE 4194304
+
+/**
+ * @brief Reads the lines of a range of a text file, handing out views of its blocks without copying them
+ */
+typedef struct lineReader * LineReader;
+
+LineReader openLineReader(char*, long, long);
+int readLine(LineReader, char**);
+long getLineReaderPos(LineReader);
+void closeLineReader(LineReader);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file manifest.h
+ *
+ * File containing declaration of functions used to describe a catalog with a manifest and to publish its
+ * generations atomically
+ */
+
+#ifndef _MANIFEST_H_
+
+/**
+ * @brief Include guard
+ */
+#define _MANIFEST_H_
+
+#include "../utils/utils.h"
+
+/**
+ * @brief The version of the format of the catalog. Catalogs written with another version are rebuilt
+ */
+#define MANIFEST_VERSION 11
+
+/**
+ * @brief The name of the manifest file in the directory of a catalog
+ */
+#define MANIFEST_NAME "manifest"
+
+/**
+ * @brief The name of the link (in the root directory) to the directory of the catalog being served
+ */
+#define MANIFEST_CURRENT "catalog"
+
+/**
+ * @brief The size of the blocks the files are read in to calculate their checksums
+ */
+#define MANIFEST_BLOCK_SIZE 65536
+
+/**
+ * @brief   The description of a catalog: the format version, the source files it was built from (by their size and
+ *          modification time), the size and checksum of each of its files and its record counts
+ */
+typedef struct manifest * Manifest;
+
+Manifest makeManifest();
+void addManifestSource(Manifest, char*);
+bool addManifestFile(Manifest, char*, char*);
+void setManifestRecords(Manifest, char*, long long);
+long long getManifestRecords(Manifest, char*);
+
+bool saveManifest(Manifest, char*);
+Manifest loadManifest(char*);
+bool checkManifest(Manifest, char*, bool);
+void freeManifest(Manifest);
+
+char* getCurrentDir(char*);
+char* makeStagingDir(char*);
+bool copyStagingDir(char*, char*);
+bool publishStagingDir(char*, char*);
+void removeStagingDir(char*);
+
+#endif
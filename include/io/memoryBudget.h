@@ -0,0 +1,53 @@
+/**
+ * @file memoryBudget.h
+ * 
+ * File containing declaration of functions used to share a global memory budget between the #Cache and the
+ * buffers of the program
+ */
+
+#ifndef _MEMORY_BUDGET_H_
+
+/**
+ * @brief Include guard
+ */
+#define _MEMORY_BUDGET_H_
+
+#include <stddef.h>
+
+/**
+ * @brief The percentage of the available memory (the least of the cgroup limit and the available physical memory)
+ *        used as the budget when none is set
+ */
+#define MEMORY_BUDGET_SYSTEM_SHARE 50
+
+/**
+ * @brief The budget used when none is set and the available memory cannot be found (1GB)
+ */
+#define MEMORY_BUDGET_FALLBACK 1073741824ULL
+
+/**
+ * @brief The percentage of the budget given to the #Cache while a catalog is built (the rest goes to the sort buffers)
+ */
+#define MEMORY_BUILD_CACHE_SHARE 25
+
+/**
+ * @brief The percentage of the budget given to the #Cache while queries are answered (the rest goes to their buffers)
+ */
+#define MEMORY_QUERY_CACHE_SHARE 60
+
+/**
+ * @brief The phases of the program, which split the budget differently
+ */
+typedef enum memoryPhase {
+    MEMORY_BUILD,   ///< A catalog is being built (or appended to)
+    MEMORY_QUERY    ///< Queries are being answered
+} MemoryPhase;
+
+void setMemoryBudget(size_t);
+size_t getMemoryBudget();
+size_t getCacheBudget(MemoryPhase, size_t);
+
+size_t acquireMemory(size_t, size_t);
+void releaseMemory(size_t);
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * @file messages.h
+ *
+ * File containing declaration of functions used to store strings read rarely (the messages of the commits) apart
+ * from their records, in compressed blocks
+ */
+
+#ifndef _MESSAGES_H_
+
+/**
+ * @brief Include guard
+ */
+#define _MESSAGES_H_
+
+#include <stdio.h>
+
+#include "../utils/utils.h"
+
+/**
+ * @brief The least number of characters of the messages of a block before it is written (64KB)
+ */
+#define MESSAGE_BLOCK_SIZE 65536
+
+/**
+ * @brief The maximum number of messages of a block
+ */
+#define MESSAGE_BLOCK_MESSAGES 4096
+
+/**
+ * @brief The number of decompressed blocks kept by a #MessageFile
+ */
+#define MESSAGE_CACHED_BLOCKS 8
+
+/**
+ * @brief   Writes messages, numbered in the order they are added, to a file of compressed blocks. The blocks of many
+ *          writers may be concatenated, numbering the messages of each after the ones before
+ */
+typedef struct messageWriter * MessageWriter;
+
+/**
+ * @brief   A file of compressed blocks of messages (see #MessageWriter), whose messages are read by their number.
+ *          The most recently read blocks are kept decompressed
+ */
+typedef struct messageFile * MessageFile;
+
+MessageWriter makeMessageWriter(FILE*);
+void addMessage(MessageWriter, char*);
+bool closeMessageWriter(MessageWriter);
+
+MessageFile openMessageFile(char*);
+int getMessageFileSize(MessageFile);
+char* getMessage(MessageFile, int);
+void freeMessageFile(MessageFile);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file placement.h
+ *
+ * File containing declaration of functions used to place the memory of the #Cache and the worker threads on the
+ * hardware: huge pages for the slabs of lines and, on machines with many NUMA nodes, the slabs interleaved across the
+ * nodes and each worker kept on the processors of one of them
+ */
+
+#ifndef _PLACEMENT_H_
+
+/**
+ * @brief Include guard
+ */
+#define _PLACEMENT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief The size of a huge page (2MB), which the size and the alignment of every slab are a multiple of
+ */
+#define SLAB_HUGE_PAGE_SIZE 2097152
+
+/**
+ * @brief Asks for the slabs to be backed by transparent huge pages, so a 1M line #Cache takes a few hundred TLB entries
+ *        instead of a quarter of a million. Comment out to keep the pages of 4KB
+ */
+#define SLAB_HUGE_PAGES
+
+/**
+ * @brief Maps the slabs from the explicit huge pages reserved by the system (vm.nr_hugepages), falling back to
+ *        transparent ones once there are none left. Uncomment where huge pages are reserved for the program
+ */
+//#define SLAB_EXPLICIT_HUGE_PAGES
+
+/**
+ * @brief Interleaves the pages of the slabs across the NUMA nodes, as any thread reads the lines of any shard. Comment
+ *        out to leave them on the node of the thread first touching them
+ */
+#define SLAB_INTERLEAVE_NODES
+
+/**
+ * @brief Keeps each worker thread of a #TaskPool on the processors of one NUMA node, the workers dealt to the nodes in
+ *        turn. Comment out to let the scheduler move them anywhere
+ */
+#define PLACEMENT_PIN_WORKERS
+
+/**
+ * @brief The maximum number of NUMA nodes known about
+ */
+#define PLACEMENT_MAX_NODES 64
+
+int getNumaNodes();
+
+void* allocateSlab(size_t);
+void freeSlab(void*, size_t);
+
+bool placeWorker(int);
+
+#endif
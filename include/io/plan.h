@@ -0,0 +1,67 @@
+/**
+ * @file plan.h
+ *
+ * File containing declaration of functions used to solve queries as plans of operators (a scan of a range of rows of
+ * some columns, filters and an aggregate) run in batches of rows, several plans sharing a single scan
+ */
+
+#ifndef _PLAN_H_
+
+/**
+ * @brief Include guard
+ */
+#define _PLAN_H_
+
+#include "indexer.h"
+#include "../utils/cancel.h"
+#include "../utils/counter.h"
+
+/**
+ * @brief The number of rows each operator of a #Plan processes at once
+ */
+#define PLAN_BATCH_SIZE 1024
+
+/**
+ * @brief The maximum number of filters of a #Plan
+ */
+#define PLAN_MAX_FILTERS 4
+
+/**
+ * @brief The maximum number of key columns a #Plan groups by
+ */
+#define PLAN_MAX_KEYS 2
+
+/**
+ * @brief The comparisons of a filter of a #Plan, between the value of a column and a constant
+ */
+typedef enum planOp {
+    PLAN_EQ,        ///< Keeps the rows whose value is the constant
+    PLAN_NE,        ///< Keeps the rows whose value is not the constant
+    PLAN_GE,        ///< Keeps the rows whose value is greater than or equal to the constant
+    PLAN_LT,        ///< Keeps the rows whose value is less than the constant
+    PLAN_HAS_FLAGS  ///< Keeps the rows whose value has every bit of the constant set
+} PlanOp;
+
+/**
+ * @brief The aggregates of a #Plan, computed per key
+ */
+typedef enum planAggregate {
+    PLAN_COUNT,     ///< The number of rows of the key
+    PLAN_MAX        ///< The maximum value of a column in the rows of the key
+} PlanAggregate;
+
+/**
+ * @brief   A plan of a query over some columns of the same rows: a scan of a range of the rows, the filters its rows
+ *          go through and the aggregate of those kept, grouped by some key columns into a #Counter
+ */
+typedef struct plan * Plan;
+
+Plan makePlan(int, int);
+void addPlanFilter(Plan, int*, PlanOp, int);
+void setPlanGroupBy(Plan, int**, int, PlanAggregate, int*);
+
+void runPlans(Plan*, int, Indexer, CancelToken);
+Counter takePlanResult(Plan);
+void freePlan(Plan);
+
+#endif
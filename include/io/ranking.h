@@ -0,0 +1,35 @@
+/**
+ * @file ranking.h
+ * 
+ * File containing declaration of functions used to store rankings (lists of keys sorted by decreasing value) in a file
+ * and to read their first rows
+ */
+
+#ifndef _RANKING_H_
+
+/**
+ * @brief Include guard
+ */
+#define _RANKING_H_
+
+#include "../utils/counter.h"
+#include "../utils/utils.h"
+
+/**
+ * @brief   A file of rankings: groups identified by a key, each holding its rows (#COUNTERENTRY) in the order they
+ *          are ranked. It is either written, group after group, or read, a group at a time
+ */
+typedef struct ranking * Ranking;
+
+Ranking makeRanking(char*, int);
+bool addRankingGroup(Ranking, int, COUNTERENTRY*, int);
+bool closeRanking(Ranking);
+
+Ranking openRanking(char*);
+int getRankingGroups(Ranking);
+int getRankingGroupKey(Ranking, int);
+int findRankingGroup(Ranking, int);
+COUNTERENTRY* readRankingGroup(Ranking, int, int, int*);
+void freeRanking(Ranking);
+
+#endif
@@ -0,0 +1,46 @@
+/**
+ * @file resultCache.h
+ *
+ * File containing declaration of functions used to keep the results of queries, in memory and on disk, to answer
+ * them again without solving them
+ */
+
+#ifndef _RESULT_CACHE_H_
+
+/**
+ * @brief Include guard
+ */
+#define _RESULT_CACHE_H_
+
+#include <stddef.h>
+
+#include "../utils/utils.h"
+
+/**
+ * @brief The memory kept by the most recently used results of a #ResultCache (16MB)
+ */
+#define RESULT_CACHE_MEMORY 16777216
+
+/**
+ * @brief The space the results of a #ResultCache may take on disk (256MB)
+ */
+#define RESULT_CACHE_DISK_SIZE 268435456ULL
+
+/**
+ * @brief The prefix of the names of the files of a #ResultCache. They are hidden, so they are never copied to the
+ *        next generation of a catalog (see @ref copyStagingDir) and die with the generation they were solved on
+ */
+#define RESULT_CACHE_PREFIX ".result."
+
+/**
+ * @brief   The results of queries, by the normalized text of the query: the most recently used are kept in memory
+ *          (in LRU order), and all of them in files of the directory of the catalog they were solved on, up to a size
+ */
+typedef struct resultCache * ResultCache;
+
+ResultCache makeResultCache(char*, size_t, size_t);
+char* getResult(ResultCache, char*, size_t*);
+void putResult(ResultCache, char*, char*, size_t);
+void freeResultCache(ResultCache);
+
+#endif
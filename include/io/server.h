@@ -0,0 +1,71 @@
+/**
+ * @file server.h
+ *
+ * File containing declaration of functions used to answer queries from a resident #Catalog over a Unix socket
+ */
+
+#ifndef _SERVER_H_
+
+/**
+ * @brief Include guard
+ */
+#define _SERVER_H_
+
+#include "../utils/utils.h"
+#include "../types/catalog.h"
+#include "shards.h"
+
+/**
+ * @brief The number of connections waiting to be accepted by the server
+ */
+#define SERVER_BACKLOG 64
+
+/**
+ * @brief The maximum number of connections a client opens to answer a file of queries
+ */
+#define CLIENT_MAX_CONNECTIONS 16
+
+/**
+ * @brief The host of a TCP address ("*:port") listening on every interface. The requests are not authenticated, so any
+ *        peer reaching the port may run queries and stop the server: only use it on a trusted network (an empty host
+ *        listens on the loopback interface alone)
+ */
+#define SERVER_ANY_HOST "*"
+
+/**
+ * @brief The request which stops the server
+ */
+#define SERVER_STOP_REQUEST "STOP"
+
+/**
+ * @brief The request answered with the metrics of the server (see @ref dumpMetrics)
+ */
+#define SERVER_METRICS_REQUEST "METRICS"
+
+/**
+ * @brief The prefix of the requests answered with the partial aggregate of a query on a shard (see @ref executePartialQuery)
+ */
+#define SERVER_PARTIAL_REQUEST "PARTIAL "
+
+/**
+ * @brief The prefix of the requests answered with the logins of the users of the ids following it, one per line
+ */
+#define SERVER_LOGINS_REQUEST "LOGINS "
+
+/**
+ * @brief The size of the largest response received from a server (see @ref receiveResponse), in bytes. The size of a
+ *        response is sent by the other end, so a larger one is taken as a failed connection
+ */
+#define SERVER_MAX_RESPONSE_SIZE (1L << 30)
+
+bool runServer(Catalog, char*);
+bool runCoordinator(char**, int, char*);
+bool runClient(char*, char*, char*);
+bool stopServer(char*);
+bool getServerMetrics(char*, FILE*);
+
+int connectToServer(char*);
+bool sendAll(int, const char*, size_t);
+bool receiveResponse(FILE*, char**, size_t*);
+
+#endif
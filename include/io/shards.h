@@ -0,0 +1,40 @@
+/**
+ * @file shards.h
+ *
+ * File containing declaration of functions used to split a dataset into shards, each built into its own #Catalog
+ * (possibly on another machine), and to answer the queries from the servers of the shards
+ */
+
+#ifndef _SHARDS_H_
+
+/**
+ * @brief Include guard
+ */
+#define _SHARDS_H_
+
+#include <stdio.h>
+
+#include "../types/queries.h"
+
+/**
+ * @brief The maximum number of shards a dataset is split into
+ */
+#define MAX_SHARDS 256
+
+/**
+ * @brief The size of the buffer of each file written when splitting a dataset (1MB)
+ */
+#define SHARD_BUFFER_SIZE 1048576
+
+/**
+ * @brief   The connections of a coordinator to the servers of the shards, one per shard
+ */
+typedef struct shardLinks * ShardLinks;
+
+bool partitionInputs(char*, char*, char*, int, char*);
+
+ShardLinks connectToShards(char**, int);
+bool answerScatteredQuery(ShardLinks, Query, char*, FILE*);
+void closeShardLinks(ShardLinks);
+
+#endif
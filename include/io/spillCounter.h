@@ -0,0 +1,55 @@
+/**
+ * @file spillCounter.h
+ *
+ * File containing declaration of functions used to aggregate values by integer keys within the memory budget, spilling
+ * the keys to temporary files once they take more memory than was granted
+ */
+
+#ifndef _SPILL_COUNTER_H_
+
+/**
+ * @brief Include guard
+ */
+#define _SPILL_COUNTER_H_
+
+#include <stdbool.h>
+
+#include "../utils/counter.h"
+
+/**
+ * @brief The number of bits of the hash of a key giving its partition once a #SpillCounter spills
+ */
+#define SPILL_PARTITION_BITS 6
+
+/**
+ * @brief The number of partitions the keys of a #SpillCounter are split into once it spills
+ */
+#define SPILL_PARTITIONS (1 << SPILL_PARTITION_BITS)
+
+/**
+ * @brief The percentage of the memory budget each #SpillCounter asks for (see @ref acquireMemory)
+ */
+#define SPILL_MEMORY_SHARE 10
+
+/**
+ * @brief The least memory a #SpillCounter works with, even if the budget is used up (1MB)
+ */
+#define SPILL_MIN_MEMORY 1048576
+
+/**
+ * @brief   A #Counter bounded by the memory budget: once it holds more keys than fit in the memory granted, its entries
+ *          are written to the temporary file of their partition (by the hash of the key) and it starts over empty. The
+ *          partitions are aggregated one at a time once every value is added, so only one of them is ever in memory
+ */
+typedef struct spillCounter * SpillCounter;
+
+SpillCounter makeSpillCounter(bool);
+void addToSpillCounter(SpillCounter, int, int);
+void mergeIntoSpillCounter(SpillCounter, Counter);
+
+int getSpillPartitions(SpillCounter);
+COUNTERENTRY* readSpillPartition(SpillCounter, int, int*);
+COUNTERENTRY* getSpillCounterTop(SpillCounter, int, int*);
+void freeSpillCounter(SpillCounter);
+
+#endif
@@ -44,9 +44,36 @@
 */
 typedef void (*routine)(void**);
 
+/**
+ * @brief The struct representing a graph of tasks (each one a SEQ), run as soon as the tasks they depend on are done
+ */
+typedef struct taskGraph * TaskGraph;
+
+/**
+ * @brief The maximum number of threads of a #TaskPool
+ */
+#define TASK_POOL_MAX_THREADS 64
+
+/**
+ * @brief The struct representing a persistent pool of worker threads, running batches of tasks with work stealing
+ */
+typedef struct taskPool * TaskPool;
+
 
 void* sequence(void*);
 
+TaskGraph makeTaskGraph();
+int addGraphTask(TaskGraph, void*, int, ...);
+void runTaskGraph(TaskGraph, int);
+void freeTaskGraph(TaskGraph);
+
+TaskPool makeTaskPool(int);
+int getTaskPoolThreads(TaskPool);
+void runPoolTasks(TaskPool, void* taskList[], int, void*, void (*solver)(int, void*, void*));
+void freeTaskPool(TaskPool);
+
+void setTaskThreads(int);
+int getSpareThreads();
 void executeTasks(void* taskList[], int tasks, void* catalog, void (*solver)(int, void*, void*), int threads) ;
 
 #endif
\ No newline at end of file
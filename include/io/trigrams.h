@@ -0,0 +1,40 @@
+/**
+ * @file trigrams.h
+ *
+ * File containing declaration of functions used to index the trigrams of the lines of a text file, so the lines
+ * holding a substring are found without reading the whole file
+ */
+
+#ifndef _TRIGRAMS_H_
+
+/**
+ * @brief Include guard
+ */
+#define _TRIGRAMS_H_
+
+#include <stdio.h>
+
+#include "../utils/utils.h"
+
+/**
+ * @brief The number of buckets the trigrams are hashed to
+ */
+#define TRIGRAM_BUCKETS 65536
+
+/**
+ * @brief The number of bytes of the text file indexed by each segment of a #TrigramIndex (16MB)
+ */
+#define TRIGRAM_SEGMENT_SIZE 16777216
+
+/**
+ * @brief   An inverted index of the case folded trigrams of the lines of a text file: for each range of the file (a
+ *          segment), the bucket of each trigram lists the lines holding it, as compressed posting lists
+ */
+typedef struct trigramIndex * TrigramIndex;
+
+bool buildTrigramIndex(char*, char*);
+TrigramIndex openTrigramIndex(char*, char*);
+bool searchTrigramIndex(TrigramIndex, char*, int, FILE*);
+void closeTrigramIndex(TrigramIndex);
+
+#endif
@@ -16,6 +16,12 @@
 #include "types/repo.h"
 #include "types/user.h"
 #include "types/lazy.h"
+#include "io/plan.h"
+#include "io/ranking.h"
+#include "io/resultCache.h"
+#include "io/spillCounter.h"
+#include "utils/cancel.h"
+#include "utils/counter.h"
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -24,8 +30,23 @@
  * 
  */
 typedef struct catalog *Catalog;
+
+/**
+ * @brief The phases of the build of a #Catalog, timed by @ref getBuildPhaseTime
+ */
+typedef enum buildPhase {
+    BUILD_PARSE,            ///< Parsing the users (sorting usersById) and the repos
+    BUILD_FILTER,           ///< Filtering the commits (and reading the ids of the repos)
+    BUILD_SORT,             ///< Sorting the indexes
+    BUILD_GROUP,            ///< Sorting and grouping (or merging) the grouped indexes
+    BUILD_FRIENDS,          ///< Indexing the friendships of the users
+    BUILD_STATIC_QUERIES,   ///< Solving the static queries and writing the rankings, columns and rollups
+    BUILD_PUBLISH,          ///< Writing the manifest and publishing the generation
+    BUILD_PHASE_NUM         ///< The number of phases
+} BuildPhase;
 Catalog newCatalog(char*, char*, char*, bool);
 Catalog loadCatalog();
+Catalog appendCatalog(char*, char*, char*, bool);
 
 int getUserCountC(Catalog);
 int getBotCountC(Catalog);
@@ -33,6 +54,7 @@ int getorganizationCountC(Catalog);
 int getUsersCount(Catalog);
 void getUserById(Catalog,int,Lazy);
 void printUserLoginById(Catalog, int, Lazy, FILE*);
+char* getUserLogins(Catalog, int*, int, int*);
 
 int getCommitsCount(Catalog);
 
@@ -43,14 +65,26 @@ double getValueFromQ2(Catalog);
 int getValueFromQ3(Catalog);
 double getValueFromQ4(Catalog);
 void queryOne(Catalog,FILE*);
-void querySeven(Catalog, Date, FILE*);
+void querySeven(Catalog, Date, FILE*, CancelToken);
+void partialSeven(Catalog, Date, FILE*, CancelToken);
 
 void freeCatalog(Catalog);
-GHashTable* getHashTableOfUserWithCommitsAfter(Catalog,Date,Date,int*);
-GHashTable* getHashTableOfCommitsPerLanguage(Catalog,char*,int*);
-GHashTable* getHashTableOfNumbersOfAperencesOfALanguageAfter(Catalog,Date);
-GHashTable* getHashTableOfCommitCountInReposOfFriends(Catalog);
-GHashTable* getHashTableOfLengthOfCommitsInArepoByRepoPositionInList(Catalog,int,int*);
+double getBuildPhaseTime(BuildPhase);
+void resetBuildPhaseTimes();
+void getCatalogCacheStatistics(Catalog, long*, long*);
+SpillCounter getCounterOfUserWithCommitsAfter(Catalog,Date,Date,CancelToken);
+Counter getCounterOfCommitsPerLanguage(Catalog,char*,int*,CancelToken);
+Counter getCounterOfCommitsPerLanguageAfter(Catalog,Date,CancelToken);
+Plan planCommitsPerLanguage(Catalog,char*);
+Plan planCommitsPerLanguageAfter(Catalog,Date);
+void runCatalogPlans(Catalog,Plan*,int,CancelToken);
+char* getCatalogLanguage(Catalog,int);
+char* getCatalogCommitMessage(Catalog,pos_t);
+Ranking openFriendsCommitsRanking(Catalog);
+Ranking openMessageLengthRanking(Catalog);
+Ranking openLanguageRanking(Catalog);
+int findLanguageRankingGroup(Catalog, Ranking, char*);
+ResultCache getCatalogResults(Catalog);
 
 Format getStaticQueriesFormat();
 
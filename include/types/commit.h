@@ -40,8 +40,7 @@ typedef enum ccommit{
 	CCCOMMITTER_ID=3,		///< The id of the committer
 	CCCOMMITTER_FRIEND=4,   ///< The committer's friends
     CCCOMMIT_AT=5,			///< The #Date of the #Commit
-	CCMESSAGE_LEN=6,		///< The length of the message
-	CCMESSAGE=7				///< The message
+	CCMESSAGE_LEN=6			///< The length of the message (the message is stored apart, see #MessageFile)
 }CCOMMIT;
 
 
@@ -52,9 +52,9 @@ bool isDateValid(Date );
 int dateCompare(Date ,Date );
 int getDateSizeof();
 Date  copyDate(Date );
-bool readDate(char*, int, Date *, bool);
+bool readDate(char*, int, Date *, bool, Arena);
 bool checkDate(char*, int);
-Date unsafeDateFromString(char*);
+Date unsafeDateFromString(char*, Arena);
 
 
 void printDate(Date , FILE *);
@@ -74,7 +74,7 @@ void setDateDay(Date ,int );
 
 
 int getCompactedDate(Date);
-Date getUncompactedDate(int);
+Date getUncompactedDate(int, Arena);
 
 /**
  * @brief The function which frees a #Date
@@ -66,11 +66,17 @@ void addToPair(PAIR*,int,int,void*);
 bool isAllocd(FormatType);
 int stringSize(FormatType);
 int elemStringSize(FormatType);
-void readBinaryMember(FormatType, char*, int, void*);
+int typeSize(FormatType);
+void readBinaryMember(FormatType, char*, int, void*, Arena);
 void writeBinaryMember(FormatType, void*, char*, int);
 
 Format makeFormat(void*, void**, FormatType*, int, int, PAIR*, int, char);
 Format copyFormat(Format);
+bool setFormatOffsetHeader(Format);
+bool hasOffsetHeader(Format);
+int getOffsetHeaderSize(Format);
+bool isFixedMember(Format, int);
+int getMemberOffset(Format, int, int*);
 bool isBinary(Format);
 int getFormatSize(Format);
 int getFormatMembers(Format);
@@ -82,8 +88,8 @@ void* getMember(Format, void*, int);
 void freeMember(Format, void*, int);
 
 bool checkFormat(Format, char*);
-bool readFormat(Format, char*, void*);
-void unsafeReadFormat(Format, char*, void*);
+bool readFormat(Format, char*, void*, Arena);
+void unsafeReadFormat(Format, char*, void*, Arena);
 void printFormat(Format, void*, FILE*);
 void freeFormat(Format, void*);
 
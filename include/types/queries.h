@@ -23,12 +23,16 @@ typedef struct query *Query;
 Query createEmptyQuery();
 Query createQueryId(int);
 
-void executeQuery( FILE* ,Query,Catalog);
+void executeQuery( FILE* ,Query,Catalog,CancelToken);
+bool executePartialQuery(FILE*, Query, Catalog, CancelToken);
+void shareQueryScans(Query*, int, Catalog);
+char* getQueryKey(Query);
 
 void parseQuery(char*, Query);
 
 Format getQueryFormat(int);
 int getQueryId(Query );
+int getQueryLimit(Query);
 void freeQuery(Query);
 
 
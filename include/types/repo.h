@@ -33,23 +33,24 @@ typedef enum crepo{
     CRID=0,                     ///< The id
     CROWNER_ID=1,               ///< The id of the owner
 	CRACTUALLY_UPDATED_AT=2,    ///< The #Date of the last #Commit
-	CRLANGUAGE_LEN=3,           ///< The length of the language name
-    CRLANGUAGE=4,               ///< The language
-	CRDESCRIPTION_LEN=5,        ///< The length of the description
-    CRDESCRIPTION=6,            ///< The description
-    CRHAS_WIKI=7,               ///< Whether or not it has a wiki
-	CRDEFAULT_BRANCH_LEN=8,     ///< The length of the name of the default branch
-    CRDEFAULT_BRANCH=9,         ///< The default branch
-    CRCREATED_AT=10,            ///< The #Date of creation
-    CRUPDATED_AT=11,            ///< The #Date of the last update
-    CRFORKS_COUNT=12,           ///< The number of forks
-    CROPEN_ISSUES=13,           ///< The number of open issues
-    CRSTARGAZERS_COUNT=14,      ///< The number of stargazers
-    CRSIZE=15,                  ///< The size
-	CRFULL_NAME_LEN=16,         ///< The length of the name
-    CRFULL_NAME=17,             ///< The name
-    CRLICENSE_LEN=18,           ///< The length of the name of the license
-	CRLICENSE=19                ///< The license
+	CRLANGUAGE_ID=3,            ///< The id of the language (see @ref getRepoLanguageId)
+	CRLANGUAGE_LEN=4,           ///< The length of the language name
+    CRLANGUAGE=5,               ///< The language
+	CRDESCRIPTION_LEN=6,        ///< The length of the description
+    CRDESCRIPTION=7,            ///< The description
+    CRHAS_WIKI=8,               ///< Whether or not it has a wiki
+	CRDEFAULT_BRANCH_LEN=9,     ///< The length of the name of the default branch
+    CRDEFAULT_BRANCH=10,        ///< The default branch
+    CRCREATED_AT=11,            ///< The #Date of creation
+    CRUPDATED_AT=12,            ///< The #Date of the last update
+    CRFORKS_COUNT=13,           ///< The number of forks
+    CROPEN_ISSUES=14,           ///< The number of open issues
+    CRSTARGAZERS_COUNT=15,      ///< The number of stargazers
+    CRSIZE=16,                  ///< The size
+	CRFULL_NAME_LEN=17,         ///< The length of the name
+    CRFULL_NAME=18,             ///< The name
+    CRLICENSE_LEN=19,           ///< The length of the name of the license
+	CRLICENSE=20                ///< The license
 }CREPO;
 
 Repo  initRepo();
@@ -100,10 +101,12 @@ Format getCompressedRepoFormat();
 
 void setRepoCreationFromComp(Repo,int);
 void setRepoUpdatedFromComp(Repo,int);
-void setRepoLastCommitDateFromComp(Repo,int);
+void setRepoLastCommitDateFromComp(Repo,int,Arena);
 int getRepoNameLength(Repo);
 int getRepoDescriptionLength(Repo);
 int getRepoLanguageLength(Repo);
+int getRepoLanguageId(Repo);
+void setRepoLanguageId(Repo,int);
 int getRepoDefaultBranchLength(Repo);
 Date getRepoLastCommitDate(Repo);
 void setRepoLastCommitDate(Repo,Date);
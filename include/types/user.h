@@ -73,7 +73,7 @@ void  setUserPublicRepos(User,int );
 void freeUserContent(User);
 void freeUser(User);
 void freeUserList(void*[]);
-void calculateFriends(User);
+void calculateFriends(User, Arena);
 bool areUsersFriends(User,int);
 Format getUserFormat();
 Format getCompressedUserFormat();
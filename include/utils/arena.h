@@ -0,0 +1,33 @@
+/**
+ * @file arena.h
+ * 
+ * File containing declaration of functions used to allocate short-lived memory in bulk
+ */
+
+#ifndef _ARENA_H_
+
+/**
+ * @brief Include guard
+ */
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/**
+ * @brief The default size of the blocks of an #Arena (64KB)
+ */
+#define ARENA_BLOCK_SIZE 65536
+
+/**
+ * @brief   A bump allocator: memory is handed out from large blocks and is only given back all at once,
+ *          by @ref resetArena. Functions taking an #Arena fall back to malloc when given NULL
+ */
+typedef struct arena * Arena;
+
+Arena makeArena(size_t);
+void* arenaAlloc(Arena, size_t);
+void arenaFree(Arena, void*);
+void resetArena(Arena);
+void freeArena(Arena);
+
+#endif
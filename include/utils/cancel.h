@@ -0,0 +1,34 @@
+/**
+ * @file cancel.h
+ * 
+ * File containing declaration of functions used to stop long-running work cooperatively
+ */
+
+#ifndef _CANCEL_H_
+
+/**
+ * @brief Include guard
+ */
+#define _CANCEL_H_
+
+#include <stdbool.h>
+
+/**
+ * @brief The number of records scanned between two checks of a #CancelToken
+ */
+#define CANCEL_CHECK_INTERVAL 16384
+
+/**
+ * @brief   A flag shared by some work and whoever may want to stop it: the work checks it once in a while and returns
+ *          early once it is set. Reference counted, so each side releases it when done with it. Functions taking a
+ *          #CancelToken accept NULL for work that is never cancelled
+ */
+typedef struct cancelToken * CancelToken;
+
+CancelToken makeCancelToken();
+CancelToken retainCancelToken(CancelToken);
+void cancelWork(CancelToken);
+bool isCancelled(CancelToken);
+void releaseCancelToken(CancelToken);
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ * @file counter.h
+ *
+ * File containing declaration of functions used to count (or keep the maximum of) values by integer keys and to select
+ * the keys with the largest values
+ */
+
+#ifndef _COUNTER_H_
+
+/**
+ * @brief Include guard
+ */
+#define _COUNTER_H_
+
+#include <stdbool.h>
+
+/**
+ * @brief The initial number of slots of a #Counter (a power of 2)
+ */
+#define COUNTER_MIN_SLOTS 64
+
+/**
+ * @brief A key of a #Counter and its value
+ */
+typedef struct counterEntry {
+    int key;    ///< The key
+    int value;  ///< The value stored in the key
+} COUNTERENTRY;
+
+/**
+ * @brief   A map from integer keys to integer values, stored in an array of entries (in the order they were added)
+ *          indexed by an open-addressing table of slots
+ */
+typedef struct counter * Counter;
+
+Counter makeCounter(int);
+bool increaseCounter(Counter, int, int);
+bool storeCounterIfGreater(Counter, int, int);
+int getCounterValue(Counter, int);
+int getCounterSize(Counter);
+COUNTERENTRY* getCounterEntries(Counter, int*);
+void mergeCounter(Counter, Counter);
+COUNTERENTRY* getCounterTop(Counter, int, int*);
+void clearCounter(Counter);
+void freeCounter(Counter);
+
+#endif
@@ -0,0 +1,150 @@
+/**
+ * @file metrics.h
+ *
+ * File containing declaration of functions used to count the work done by the hot paths (per thread, aggregated on
+ * demand) and to profile the queries
+ */
+
+#ifndef _METRICS_H_
+
+/**
+ * @brief Include guard
+ */
+#define _METRICS_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+/**
+ * @brief Comment out to stop counting the work of the hot paths (every metric is then 0)
+ */
+#define HOT_PATH_METRICS
+
+/**
+ * @brief The number of buckets of a histogram: bucket b counts the values from 2^(b-1) to 2^b - 1 (0 in bucket 0)
+ */
+#define METRIC_BUCKETS 48
+
+/**
+ * @brief The counters of the hot paths
+ */
+typedef enum metric {
+    METRIC_CACHE_HITS,      ///< The lines found in the #Cache
+    METRIC_CACHE_MISSES,    ///< The lines not found in the #Cache
+    METRIC_CACHE_EVICTIONS, ///< The lines evicted from the #Cache
+    METRIC_READS,           ///< The reads of files by the #Cache
+    METRIC_READ_BYTES,      ///< The bytes read by the #Cache
+    METRIC_READ_NS,         ///< The time taken by the reads (in nanoseconds)
+    METRIC_WRITES,          ///< The writes of files by the #Cache
+    METRIC_WRITE_BYTES,     ///< The bytes written by the #Cache
+    METRIC_WRITE_NS,        ///< The time taken by the writes (in nanoseconds)
+    METRIC_LOCK_WAITS,      ///< The locks of the #Cache which were held by another thread
+    METRIC_LOCK_WAIT_NS,    ///< The time waited for those locks (in nanoseconds)
+    METRIC_INDEX_READS,     ///< The keys read from the index files of the #Indexer
+    METRIC_KEY_LOOKUPS,     ///< The keys searched in an #Indexer
+    METRIC_KEY_PROBES,      ///< The keys read by those searches
+    METRIC_LAZY_DECODES,    ///< The members of a #Lazy decoded
+    METRIC_ROWS_SCANNED,    ///< The rows scanned by the queries
+    METRIC_ROWS_SPILLED,    ///< The entries written to temporary files by the aggregates of the queries (see @ref SpillCounter)
+    METRIC_QUERIES,         ///< The queries executed
+    METRIC_QUERY_NS,        ///< The time taken by the queries (in nanoseconds)
+    METRIC_NUM              ///< The number of counters
+} Metric;
+
+/**
+ * @brief The histograms of the hot paths
+ */
+typedef enum histogram {
+    HISTOGRAM_READ_NS,      ///< The latency of the reads (in nanoseconds)
+    HISTOGRAM_WRITE_NS,     ///< The latency of the writes (in nanoseconds)
+    HISTOGRAM_LOCK_WAIT_NS, ///< The time waited for a lock held by another thread (in nanoseconds)
+    HISTOGRAM_KEY_PROBES,   ///< The keys read by a search of an #Indexer
+    HISTOGRAM_QUERY_NS,     ///< The latency of the queries (in nanoseconds)
+    HISTOGRAM_QUERY_ROWS,   ///< The rows scanned by a query
+    HISTOGRAM_NUM           ///< The number of histograms
+} Histogram;
+
+/**
+ * @brief The counters and histograms of a thread (or of all of them, once aggregated)
+ */
+typedef struct metrics {
+    long counters[METRIC_NUM];                          ///< The counters
+    long histograms[HISTOGRAM_NUM][METRIC_BUCKETS];     ///< The histograms
+} METRICS;
+
+/**
+ * @brief   The work done by a query in the thread executing it, telling it apart between I/O, locks and CPU
+ */
+typedef struct queryProfile {
+    int id;         ///< The id of the query
+    long ns;        ///< The time taken (in nanoseconds)
+    long read_ns;   ///< The time taken by the reads of the #Cache (in nanoseconds)
+    long lock_ns;   ///< The time waited for the locks of the #Cache (in nanoseconds)
+    long rows;      ///< The rows scanned
+    long misses;    ///< The misses of the #Cache
+} QUERYPROFILE;
+
+/**
+ * @brief The metrics of the calling thread (NULL until it first counts something)
+ */
+extern __thread METRICS* threadMetrics;
+
+METRICS* registerMetricsThread();
+
+#ifdef HOT_PATH_METRICS
+/**
+ * @brief   Adds a value to a counter of the calling thread. Only the thread writes its counters, so no atomic
+ *          read-modify-write is needed (the stores are atomic for the threads aggregating them)
+ */
+#define ADD_METRIC(metric, value) do { METRICS* _m = threadMetrics != NULL ? threadMetrics : registerMetricsThread(); \
+            __atomic_store_n(&_m->counters[metric], _m->counters[metric] + (value), __ATOMIC_RELAXED); } while (0)
+
+/**
+ * @brief Counts a value in a histogram of the calling thread
+ */
+#define ADD_HISTOGRAM(histogram, value) do { METRICS* _m = threadMetrics != NULL ? threadMetrics : registerMetricsThread(); \
+            long* _b = &_m->histograms[histogram][METRIC_BUCKET(value)]; \
+            __atomic_store_n(_b, *_b + 1, __ATOMIC_RELAXED); } while (0)
+
+/**
+ * @brief Gets the time of a monotonic clock, to time the hot paths (in nanoseconds, from an arbitrary point)
+ */
+#define METRICS_TIME() ({ struct timespec _t; clock_gettime(CLOCK_MONOTONIC, &_t); _t.tv_sec * 1000000000L + _t.tv_nsec; })
+#else
+/**
+ * @brief Adds a value to a counter of the calling thread (disabled)
+ */
+#define ADD_METRIC(metric, value) ((void)(value))
+
+/**
+ * @brief Counts a value in a histogram of the calling thread (disabled)
+ */
+#define ADD_HISTOGRAM(histogram, value) ((void)(value))
+
+/**
+ * @brief Gets the time of a monotonic clock, to time the hot paths (disabled)
+ */
+#define METRICS_TIME() 0L
+#endif
+
+/**
+ * @brief Gets the bucket of a histogram a value is counted in
+ */
+#define METRIC_BUCKET(value) ({ long _v = (value); int _b = _v <= 0 ? 0 : 64 - __builtin_clzl((unsigned long)_v); \
+            _b < METRIC_BUCKETS ? _b : METRIC_BUCKETS - 1; })
+
+long getThreadMetric(Metric);
+void getMetrics(METRICS*);
+long getHistogramPercentile(METRICS*, Histogram, double);
+const char* getMetricName(Metric);
+const char* getHistogramName(Histogram);
+
+void beginQueryProfile(QUERYPROFILE*, int);
+void endQueryProfile(QUERYPROFILE*);
+bool getLastQueryProfile(QUERYPROFILE*);
+
+void dumpMetrics(FILE*);
+bool saveMetrics(char*);
+
+#endif
@@ -24,16 +24,25 @@ int queryThree(Catalog);
 
 double queryFour(Catalog);
 
-void queryFive(Catalog,int,Date,Date,FILE*);
+void queryFive(Catalog,int,Date,Date,FILE*,CancelToken);
 
-void querySix(Catalog,int,char*,FILE*);
+void querySix(Catalog,int,char*,FILE*,CancelToken);
 
 //querySeven is decalred in catalog.h
 
-void queryEight(Catalog,int,Date,FILE*);
+void queryEight(Catalog,int,Date,FILE*,CancelToken);
 
 void queryNine(Catalog,int,FILE*);
 
-void queryTen(Catalog,int,FILE*);
+void queryTen(Catalog,int,FILE*,CancelToken);
+
+void printTopUsers(Catalog,Counter,int,FILE*);
+void printTopLanguages(Catalog,Counter,int,FILE*);
+
+void partialFive(Catalog,Date,Date,FILE*,CancelToken);
+void partialSix(Catalog,char*,FILE*,CancelToken);
+//partialSeven is decalred in catalog.h
+void partialEight(Catalog,Date,FILE*,CancelToken);
+void partialNine(Catalog,FILE*);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,36 @@
+/**
+ * @file sink.h
+ *
+ * File containing declaration of functions used to write the rows of the results of queries to a stream, in large
+ * buffered writes instead of a formatted stdio call per field
+ */
+
+#ifndef _SINK_H_
+
+/**
+ * @brief Include guard
+ */
+#define _SINK_H_
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * @brief The size of the buffer of a #ResultSink (64KB)
+ */
+#define SINK_BUFFER_SIZE 65536
+
+/**
+ * @brief   A writer of the results of a query to a stream (a file, the memory stream of the GUI or of the #ResultCache,
+ *          or the connection of a server): the fields are appended to a buffer, written to the stream whenever it
+ *          fills up and once the #ResultSink is closed
+ */
+typedef struct resultSink * ResultSink;
+
+ResultSink openSink(FILE*);
+void sinkInt(ResultSink, int);
+void sinkString(ResultSink, const char*);
+void sinkChar(ResultSink, char);
+bool closeSink(ResultSink);
+
+#endif
@@ -18,6 +18,8 @@
 #include <errno.h>
 #include <stdbool.h>
 
+#include "arena.h"
+
 //#define DEBUG
 
 #ifdef DEBUG
@@ -97,8 +99,8 @@ bool safeStringToInt(char*, int, int*);
 bool checkType(char*, int, Type*);
 bool checkBool(char*, int, bool*);
 bool checkIdList(char*, int, int*);
-bool readIdList(char*, int, int**, int*);
-int* unsafeReadIdList(char*, int, int*);
+bool readIdList(char*, int, int**, int*, Arena);
+int* unsafeReadIdList(char*, int, int*, Arena);
 
 int* copyIdList(int*, int);
 bool containedInSortedArray(int*, int, int);
@@ -111,15 +113,16 @@ void freeGArray(gpointer);
 void removeDuplicates(GArray*);
 
 char* getQueryFileName();
+void indexFileLines(char*);
 char** getFileContent(char*, int, int, int*);
 int getFileLine(FILE*, char**, int*);
 
 void writeIntToBinaryString(char*,int);
 void IntListToBinaryString(char **,int,int*);
 int readIntFromBinaryString(char *);
-int* BinaryStringTointList(char *,int );
+int* BinaryStringTointList(char *,int, Arena);
 bool binSearchInList(int,int*,int);
-void increaseNumberInHashTableIfFound(GHashTable*,gpointer,int*);
-void storeNumberInHashTableIfGreater(GHashTable*,gpointer,int);
+
+double getWallClock();
 
 #endif
\ No newline at end of file
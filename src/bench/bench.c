@@ -0,0 +1,321 @@
+/**
+ * @file bench.c
+ *
+ * File implementing the benchmark suite of the project
+ *
+ * Each data set (a directory of "tests/performance" holding users.csv, commits.csv, repos.csv and queries.txt) is built
+ * into a #Catalog, whose queries are then run a number of times. The wall clock latencies are reported by query id,
+ * apart for the first run of each query (solved) and for the following ones (answered from the #ResultCache), along
+ * with the time of each phase of the build, the throughput, the peak memory used, the bytes read and the hit ratio of
+ * the #Cache
+ */
+
+#include <dirent.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "types/catalog.h"
+#include "types/queries.h"
+#include "utils/utils.h"
+
+/**
+ * @brief Relative path of the base directory containing the data sets
+ */
+#define BENCH_DIR "tests/performance"
+
+/**
+ * @brief The number of times the queries of a data set are run (by default)
+ */
+#define BENCH_REPEAT 5
+
+/**
+ * @brief The largest query id whose latencies are reported
+ */
+#define BENCH_MAX_QUERY_ID 16
+
+/**
+ * @brief Max length of a query string
+ */
+#define MAX_QUERY_SIZE 128
+
+/**
+ * @brief The names of the #BuildPhase, as reported
+ */
+static char* phaseNames[BUILD_PHASE_NUM] = {
+    "parse", "filter", "sort", "group", "friends", "static_queries", "publish"
+};
+
+/**
+ * @brief The latencies of the runs of the queries with the same id
+ */
+typedef struct latencies {
+    GArray* solved;     ///< The latencies of the first runs (in seconds)
+    GArray* cached;     ///< The latencies of the following runs (in seconds)
+} LATENCIES;
+
+/**
+ * @brief       Compares two doubles, for g_array_sort
+ *
+ * @param a     The first double
+ * @param b     The second double
+ *
+ * @return      Negative, zero or positive as a is smaller than, equal to or larger than b
+ */
+static int compareDoubles(gconstpointer a, gconstpointer b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief           Gets a percentile of sorted values (nearest rank)
+ *
+ * @param values    The values, sorted
+ * @param p         The percentile (from 0 to 100)
+ *
+ * @return          The percentile (0 if there are no values)
+ */
+static double getPercentile(GArray* values, double p) {
+    if (values->len == 0)
+        return 0;
+
+    int rank = (int)(p / 100 * values->len + 0.999999);
+    return g_array_index(values, double, MIN(MAX(rank, 1), (int)values->len) - 1);
+}
+
+/**
+ * @brief       Reads a counter of the I/O of the process, from /proc/self/io
+ *
+ * @param name  The name of the counter (ex: "rchar")
+ *
+ * @return      The counter (-1 if it is not available)
+ */
+static long long getIoCounter(char* name) {
+    FILE* f = fopen("/proc/self/io", "r");
+    if (f == NULL)
+        return -1;
+
+    char key[64];
+    long long value, ans = -1;
+    while (ans == -1 && fscanf(f, "%63[^:]: %lld\n", key, &value) == 2)
+        if (strcmp(key, name) == 0)
+            ans = value;
+
+    fclose(f);
+    return ans;
+}
+
+/**
+ * @brief           Writes the percentiles of some latencies, as a JSON object
+ *
+ * @param stream    The stream to write to
+ * @param values    The latencies (sorted)
+ */
+static void printLatencies(FILE* stream, GArray* values) {
+    fprintf(stream, "{\"count\": %u, \"p50\": %.6f, \"p95\": %.6f, \"p99\": %.6f}", values->len,
+            getPercentile(values, 50), getPercentile(values, 95), getPercentile(values, 99));
+}
+
+/**
+ * @brief           Builds a data set into a #Catalog, runs its queries and reports the results
+ *
+ * @param path      The path to the directory of the data set
+ * @param repeat    The number of times the queries are run
+ * @param json      The stream to write the results to, as an element of a JSON array (NULL if none)
+ * @param first     Whether no element was written to the JSON array yet (updated)
+ */
+static void runBenchmark(char* path, int repeat, FILE* json, bool* first) {
+    char users[512], commits[512], repos[512], queries[512];
+    sprintf(users, "%s/users.csv", path);
+    sprintf(commits, "%s/commits.csv", path);
+    sprintf(repos, "%s/repos.csv", path);
+    sprintf(queries, "%s/queries.txt", path);
+
+    struct stat st;
+    if (stat(users, &st) != 0 || stat(commits, &st) != 0 || stat(repos, &st) != 0 || stat(queries, &st) != 0) {
+        printf("Input files for data set \"%s\" not found\n\n", path);
+        return;
+    }
+
+    printf("Data set \"%s\"\n", path);
+    long long read_before = getIoCounter("rchar"), storage_before = getIoCounter("read_bytes");
+
+    resetBuildPhaseTimes();
+    double start = getWallClock();
+    Catalog catalog = newCatalog(users, commits, repos, true);
+    double build = getWallClock() - start;
+
+    printf("Build: %.3f s\n", build);
+    for (int p = 0; p < BUILD_PHASE_NUM; p++)
+        printf("  %-16s %.3f s\n", phaseNames[p], getBuildPhaseTime(p));
+
+    freeCatalog(catalog);
+    start = getWallClock();
+    catalog = loadCatalog();
+    double load = getWallClock() - start;
+    printf("Load: %.3f s\n", load);
+
+    if (catalog == NULL) {
+        printf("The published catalog does not match its manifest\n\n");
+        return;
+    }
+
+    GArray* mix = g_array_new(FALSE, FALSE, sizeof(char*));
+    char buffer[MAX_QUERY_SIZE];
+    FILE* file = OPEN_FILE(queries, "r");
+    while (fgets(buffer, MAX_QUERY_SIZE, file))
+        if (strcmp(buffer, "\n") != 0) {
+            char* line = strdup(buffer);
+            g_array_append_val(mix, line);
+        }
+    fclose(file);
+
+    LATENCIES latencies[BENCH_MAX_QUERY_ID + 1];
+    for (int id = 0; id <= BENCH_MAX_QUERY_ID; id++) {
+        latencies[id].solved = g_array_new(FALSE, FALSE, sizeof(double));
+        latencies[id].cached = g_array_new(FALSE, FALSE, sizeof(double));
+    }
+
+    //The outputs are discarded, but still written, as the queries of the program do
+    FILE* output = OPEN_FILE("/dev/null", "w");
+    int run = 0;
+    double total = 0;
+
+    for (int r = 0; r < repeat; r++)
+        for (guint i = 0; i < mix->len; i++) {
+            strcpy(buffer, g_array_index(mix, char*, i));
+            trimNewLine(buffer, strlen(buffer));
+            Query q = createEmptyQuery();
+            parseQuery(buffer, q);
+            int id = getQueryId(q);
+
+            if (id >= 0 && id <= BENCH_MAX_QUERY_ID) {
+                start = getWallClock();
+                executeQuery(output, q, catalog, NULL);
+                fflush(output);
+                double latency = getWallClock() - start;
+
+                g_array_append_val(r == 0 ? latencies[id].solved : latencies[id].cached, latency);
+                total += latency;
+                run++;
+            }
+            freeQuery(q);
+        }
+    fclose(output);
+
+    long hits, misses;
+    getCatalogCacheStatistics(catalog, &hits, &misses);
+    freeCatalog(catalog);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    long long read = getIoCounter("rchar") - read_before, storage = getIoCounter("read_bytes") - storage_before;
+    double throughput = total > 0 ? run / total : 0, hit_ratio = hits + misses > 0 ? (double)hits / (hits + misses) : 0;
+
+    printf("Queries: %d runs (%u queries, %d times), %.1f queries/s\n", run, mix->len, repeat, throughput);
+    printf("%-4s %10s %10s %10s %10s %10s %10s\n", "id", "solve p50", "p95", "p99", "cached p50", "p95", "p99");
+    for (int id = 0; id <= BENCH_MAX_QUERY_ID; id++) {
+        g_array_sort(latencies[id].solved, compareDoubles);
+        g_array_sort(latencies[id].cached, compareDoubles);
+        if (latencies[id].solved->len + latencies[id].cached->len > 0)
+            printf("%-4d %10.6f %10.6f %10.6f %10.6f %10.6f %10.6f\n", id,
+                   getPercentile(latencies[id].solved, 50), getPercentile(latencies[id].solved, 95),
+                   getPercentile(latencies[id].solved, 99), getPercentile(latencies[id].cached, 50),
+                   getPercentile(latencies[id].cached, 95), getPercentile(latencies[id].cached, 99));
+    }
+    printf("Peak RSS: %ld KB\n", usage.ru_maxrss);
+    printf("Bytes read: %lld (%lld from storage)\n", read, storage);
+    printf("Cache: %ld hits, %ld misses (hit ratio %.3f)\n\n", hits, misses, hit_ratio);
+
+    if (json != NULL) {
+        fprintf(json, "%s{\"dataset\": \"%s\", \"build\": {\"total\": %.6f", *first ? "" : ", ", path, build);
+        *first = false;
+        for (int p = 0; p < BUILD_PHASE_NUM; p++)
+            fprintf(json, ", \"%s\": %.6f", phaseNames[p], getBuildPhaseTime(p));
+        fprintf(json, "}, \"load\": %.6f, \"queries\": %u, \"repeat\": %d, \"runs\": %d, \"throughput\": %.3f,",
+                load, mix->len, repeat, run, throughput);
+        fprintf(json, " \"latency\": {");
+
+        bool first_id = true;
+        for (int id = 0; id <= BENCH_MAX_QUERY_ID; id++)
+            if (latencies[id].solved->len + latencies[id].cached->len > 0) {
+                fprintf(json, "%s\"%d\": {\"solved\": ", first_id ? "" : ", ", id);
+                printLatencies(json, latencies[id].solved);
+                fprintf(json, ", \"cached\": ");
+                printLatencies(json, latencies[id].cached);
+                fprintf(json, "}");
+                first_id = false;
+            }
+
+        fprintf(json, "}, \"peak_rss_kb\": %ld, \"bytes_read\": %lld, \"storage_bytes_read\": %lld,", usage.ru_maxrss,
+                read, storage);
+        fprintf(json, " \"cache\": {\"hits\": %ld, \"misses\": %ld, \"hit_ratio\": %.6f}}", hits, misses, hit_ratio);
+    }
+
+    for (int id = 0; id <= BENCH_MAX_QUERY_ID; id++) {
+        g_array_free(latencies[id].solved, TRUE);
+        g_array_free(latencies[id].cached, TRUE);
+    }
+    for (guint i = 0; i < mix->len; i++)
+        free(g_array_index(mix, char*, i));
+    g_array_free(mix, TRUE);
+}
+
+/**
+ * @brief Benchmark suite's main entry point
+ *
+ * @param argc  The number of arguments
+ * @param argv  The arguments of the benchmark suite: the data sets (directories of "tests/performance"), all of them if
+ *              none is given. The option "--repeat" followed by a number sets the number of times the queries are run,
+ *              and the option "--json" followed by a path writes the results there, as a JSON array
+ *
+ * @return 0
+ */
+int main(int argc, char* argv[]) {
+    int repeat = BENCH_REPEAT, n = 0;
+    char* json_path = NULL;
+    char* sets[argc];
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            json_path = argv[++i];
+        else
+            sets[n++] = argv[i];
+    }
+
+    repeat = MAX(repeat, 1);
+    FILE* json = json_path == NULL ? NULL : OPEN_FILE(json_path, "w");
+    bool first = true;
+    if (json != NULL)
+        fprintf(json, "[");
+
+    char path[512];
+    if (n == 0) {
+        DIR* d = opendir(BENCH_DIR);
+        struct dirent* dir;
+
+        while (d != NULL && (dir = readdir(d)) != NULL)
+            if (dir->d_type == DT_DIR && strcmp(dir->d_name, ".") && strcmp(dir->d_name, "..")) {
+                snprintf(path, sizeof(path), BENCH_DIR "/%s", dir->d_name);
+                runBenchmark(path, repeat, json, &first);
+            }
+
+        if (d != NULL)
+            closedir(d);
+    }
+    for (int i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), BENCH_DIR "/%s", sets[i]);
+        runBenchmark(path, repeat, json, &first);
+    }
+
+    if (json != NULL) {
+        fprintf(json, "]\n");
+        fclose(json);
+    }
+    return 0;
+}
@@ -0,0 +1,640 @@
+/**
+ * @file generator.c
+ *
+ * File implementing the generator of the synthetic data sets of the project
+ *
+ * A data set (users.csv, commits.csv, repos.csv and queries.txt, as read by the program and by the benchmark suite) of
+ * about a target size is written from a seed, always the same for the same seed and size. The ids are dense, the
+ * followers, the commits per repo and the stars follow power laws, the languages are skewed and a few rows of each file
+ * are invalid, so the performance tiers (from 200MB to 100GB) are reproduced without being stored in the repository.
+ *
+ * Every user and repo is derived from the seed and its index alone, so the files are written as streams, in constant
+ * memory, whatever their size
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "utils/utils.h"
+
+/**
+ * @brief Relative path of the base directory the data sets are written to (by default)
+ */
+#define GENERATOR_DIR "tests/performance"
+
+/**
+ * @brief The seed of the data sets (by default)
+ */
+#define GENERATOR_SEED 2022
+
+/**
+ * @brief The id of the first user and of the first repo (the following ones are dense)
+ */
+#define GENERATOR_ID_BASE 1000
+
+/**
+ * @brief The share (per mille) of the target size taken by users.csv
+ */
+#define USERS_SHARE 240
+
+/**
+ * @brief The share (per mille) of the target size taken by repos.csv (commits.csv takes the rest)
+ */
+#define REPOS_SHARE 270
+
+/**
+ * @brief The number of rows sampled to estimate the average size of a row of users.csv and of repos.csv
+ */
+#define SAMPLE_ROWS 4096
+
+/**
+ * @brief The largest number of ids in a list of followers (or of followed users)
+ */
+#define MAX_LIST_SIZE 2048
+
+/**
+ * @brief The share (per mille) of the rows of each file which are invalid
+ */
+#define INVALID_ROWS 5
+
+/**
+ * @brief The share (per mille) of the pairs of neighbour users, by index, which follow each other (friends)
+ */
+#define FRIENDS_SHARE 300
+
+/**
+ * @brief The number of queries written to queries.txt
+ */
+#define QUERY_MIX_SIZE 100
+
+/**
+ * @brief The first and the last instant (seconds since the epoch) of the dates written: 2008-01-01 to 2021-12-31
+ */
+#define FIRST_DATE 1199145600LL
+#define LAST_DATE 1640995199LL
+
+/**
+ * @brief The size of the buffer a row is formatted into
+ */
+#define ROW_SIZE (2 * MAX_LIST_SIZE * 12 + 1024)
+
+/**
+ * @brief The streams of random numbers, mixed with the seed, so each kind of value is drawn independently
+ */
+enum stream { STREAM_USER = 1, STREAM_LOGIN, STREAM_REPO, STREAM_OWNER, STREAM_CREATED, STREAM_FRIENDS, STREAM_COMMIT,
+              STREAM_QUERY };
+
+/**
+ * @brief The parameters of a data set being generated
+ */
+typedef struct dataset {
+    uint64_t seed;      ///< The seed of the data set
+    int users;          ///< The number of users
+    int repos;          ///< The number of repos
+} DATASET;
+
+static char* syllables[] = { "ka", "ri", "mo", "lu", "te", "san", "vo", "pe", "dri", "ne", "go", "ta", "zu", "li", "ar",
+                             "mi", "do", "bel", "ko", "ra" };
+
+static char* words[] = { "fast", "simple", "library", "for", "the", "web", "parser", "tool", "a", "of", "data", "api",
+                         "client", "server", "fix", "update", "add", "remove", "tests", "docs", "bug", "support",
+                         "config", "build", "initial", "commit", "refactor", "engine", "plugin", "and" };
+
+/**
+ * @brief The languages, from the most to the least used
+ */
+static char* languages[] = { "JavaScript", "Python", "Java", "C++", "PHP", "C", "Ruby", "Go", "C#", "TypeScript",
+                             "Shell", "HTML", "CSS", "Swift", "Objective-C", "Kotlin", "Rust", "Scala", "R", "Perl",
+                             "Lua", "Haskell", "Dart", "Elixir", "Clojure", "Julia", "Erlang", "OCaml", "Fortran",
+                             "Jupyter Notebook" };
+
+static char* licenses[] = { "MIT License", "Apache License 2.0", "GNU General Public License v3.0",
+                            "BSD 3-Clause \"New\" or \"Revised\" License", "GNU General Public License v2.0",
+                            "Other", "The Unlicense", "Mozilla Public License 2.0" };
+
+#define COUNT(array) ((int)(sizeof(array) / sizeof(array[0])))
+
+/**
+ * @brief       Draws the next random number of a stream (splitmix64)
+ *
+ * @param state The state of the stream (updated)
+ *
+ * @return      The random number
+ */
+static uint64_t nextRandom(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief           Gets the state of the stream of random numbers of an item of a data set
+ *
+ * @param d         The data set
+ * @param stream    The stream
+ * @param index     The index of the item (user, repo, ...)
+ *
+ * @return          The state of the stream
+ */
+static uint64_t getStream(DATASET* d, int stream, long long index) {
+    uint64_t state = d->seed ^ ((uint64_t)stream << 56) ^ (uint64_t)index;
+    nextRandom(&state);
+    return state;
+}
+
+/**
+ * @brief       Draws a uniform number in [0, 1)
+ *
+ * @param state The state of the stream (updated)
+ *
+ * @return      The random number
+ */
+static double nextUniform(uint64_t* state) {
+    return (nextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief       Draws a uniform integer in [0, n)
+ *
+ * @param state The state of the stream (updated)
+ * @param n     The number of values (larger than 0)
+ *
+ * @return      The random integer
+ */
+static long long nextInt(uint64_t* state, long long n) {
+    return (long long)(nextRandom(state) % (uint64_t)n);
+}
+
+/**
+ * @brief       Draws a count from a power law (a Pareto distribution shifted to start at 0)
+ *
+ * @param state The state of the stream (updated)
+ * @param alpha The exponent of the power law (larger than 1, larger is less skewed)
+ * @param max   The largest count
+ *
+ * @return      The count, from 0 to max
+ */
+static int nextPowerLaw(uint64_t* state, double alpha, int max) {
+    double x = pow(1 - nextUniform(state), -1 / (alpha - 1)) - 1;
+    return x >= max ? max : (int)x;
+}
+
+/**
+ * @brief       Draws a rank from [0, n), the rank r being drawn with a probability about proportional to 1 / (r + 1)
+ *
+ * @param state The state of the stream (updated)
+ * @param n     The number of ranks (larger than 0)
+ *
+ * @return      The rank
+ */
+static long long nextZipf(uint64_t* state, long long n) {
+    long long rank = (long long)exp(nextUniform(state) * log((double)n + 1)) - 1;
+    return rank < 0 ? 0 : rank >= n ? n - 1 : rank;
+}
+
+/**
+ * @brief       Maps a rank of popularity to an index, so the popular users (or repos) are spread over the ids
+ *
+ * @param rank  The rank
+ * @param n     The number of indexes
+ *
+ * @return      The index
+ */
+static int spreadRank(long long rank, int n) {
+    return (int)((rank * 2654435761LL) % n);
+}
+
+/**
+ * @brief           Writes a date (in the format of the data sets)
+ *
+ * @param buffer    The buffer to write to
+ * @param seconds   The date, as seconds since the epoch
+ *
+ * @return          The number of characters written
+ */
+static int formatDate(char* buffer, long long seconds) {
+    time_t t = (time_t)seconds;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    return (int)strftime(buffer, 32, "%Y-%m-%d %H:%M:%S", &tm);
+}
+
+/**
+ * @brief           Writes the login of a user
+ *
+ * @param d         The data set
+ * @param user      The index of the user
+ * @param buffer    The buffer to write to
+ *
+ * @return          The number of characters written
+ */
+static int formatLogin(DATASET* d, int user, char* buffer) {
+    uint64_t state = getStream(d, STREAM_LOGIN, user);
+    int len = 0, n = 2 + nextInt(&state, 2);
+    for (int i = 0; i < n; i++)
+        len += sprintf(buffer + len, "%s", syllables[nextInt(&state, COUNT(syllables))]);
+    return len + sprintf(buffer + len, "%d", user % 1000);
+}
+
+/**
+ * @brief       Gets the owner of a repo (the popular users own the most repos)
+ *
+ * @param d     The data set
+ * @param repo  The index of the repo
+ *
+ * @return      The index of the owner
+ */
+static int getRepoOwner(DATASET* d, int repo) {
+    uint64_t state = getStream(d, STREAM_OWNER, repo);
+    return spreadRank(nextZipf(&state, d->users), d->users);
+}
+
+/**
+ * @brief       Gets the creation date of a repo
+ *
+ * @param d     The data set
+ * @param repo  The index of the repo
+ *
+ * @return      The creation date, as seconds since the epoch
+ */
+static long long getRepoCreation(DATASET* d, int repo) {
+    uint64_t state = getStream(d, STREAM_CREATED, repo);
+    return FIRST_DATE + nextInt(&state, LAST_DATE - FIRST_DATE);
+}
+
+/**
+ * @brief       Gets the friend of a user: the neighbour user by index, if both follow each other
+ *
+ * @param d     The data set
+ * @param user  The index of the user
+ *
+ * @return      The index of the friend (-1 if the user has none)
+ */
+static int getFriend(DATASET* d, int user) {
+    int other = user ^ 1;
+    if (other >= d->users)
+        return -1;
+
+    uint64_t state = getStream(d, STREAM_FRIENDS, MIN(user, other));
+    return nextInt(&state, 1000) < FRIENDS_SHARE ? other : -1;
+}
+
+/**
+ * @brief       Checks whether a row is invalid, and which way
+ *
+ * @param state The state of the stream of the row (updated)
+ * @param kinds The number of ways a row may be invalid
+ *
+ * @return      The way the row is invalid (-1 if it is valid)
+ */
+static int nextInvalid(uint64_t* state, int kinds) {
+    return nextInt(state, 1000) < INVALID_ROWS ? (int)nextInt(state, kinds) : -1;
+}
+
+/**
+ * @brief           Writes a list of user ids, drawn by popularity, along with its size
+ *
+ * @param d         The data set
+ * @param state     The state of the stream (updated)
+ * @param buffer    The buffer to write to
+ * @param user      The index of the user, never in the list
+ * @param friend    The index of the friend of the user, always in the list (-1 if none)
+ * @param mismatch  Whether the size written does not match the list (an invalid row)
+ *
+ * @return          The number of characters written
+ */
+static int formatIdList(DATASET* d, uint64_t* state, char* buffer, int user, int friend, bool mismatch) {
+    int n = nextPowerLaw(state, 2.0, MIN(MAX_LIST_SIZE, d->users) - 1);
+    char list[MAX_LIST_SIZE * 12 + 8];
+    int len = sprintf(list, "[");
+
+    if (friend >= 0)
+        len += sprintf(list + len, "%d", GENERATOR_ID_BASE + friend);
+    for (int i = 0; i < n; i++) {
+        int other = spreadRank(nextZipf(state, d->users), d->users);
+        other = other == user ? (other + 1) % d->users : other;
+        len += sprintf(list + len, "%s%d", i > 0 || friend >= 0 ? ", " : "", GENERATOR_ID_BASE + other);
+    }
+    sprintf(list + len, "]");
+
+    return sprintf(buffer, "%d;%s", n + (friend >= 0) + mismatch, list);
+}
+
+/**
+ * @brief           Writes a row of users.csv
+ *
+ * @param d         The data set
+ * @param user      The index of the user
+ * @param buffer    The buffer to write to (of ::ROW_SIZE characters)
+ *
+ * @return          The number of characters written
+ */
+static int formatUser(DATASET* d, int user, char* buffer) {
+    uint64_t state = getStream(d, STREAM_USER, user);
+    int invalid = nextInvalid(&state, 4), friend = getFriend(d, user);
+
+    int len = sprintf(buffer, "%d;", GENERATOR_ID_BASE + user);
+    if (invalid != 0)
+        len += formatLogin(d, user, buffer + len);
+
+    double type = nextUniform(&state);
+    len += sprintf(buffer + len, ";%s;", invalid == 1 ? "Alien" : type < 0.9 ? "User" : type < 0.98 ? "Organization" : "Bot");
+    len += invalid == 2 ? sprintf(buffer + len, "2004-02-30 10:00:00")
+                        : formatDate(buffer + len, FIRST_DATE + nextInt(&state, LAST_DATE - FIRST_DATE));
+
+    buffer[len++] = ';';
+    len += formatIdList(d, &state, buffer + len, user, friend, invalid == 3);
+    buffer[len++] = ';';
+    len += formatIdList(d, &state, buffer + len, user, friend, false);
+
+    return len + sprintf(buffer + len, ";%d;%d\n", nextPowerLaw(&state, 2.2, 10000), nextPowerLaw(&state, 1.8, 10000));
+}
+
+/**
+ * @brief           Writes a row of repos.csv
+ *
+ * @param d         The data set
+ * @param repo      The index of the repo
+ * @param buffer    The buffer to write to (of ::ROW_SIZE characters)
+ *
+ * @return          The number of characters written
+ */
+static int formatRepo(DATASET* d, int repo, char* buffer) {
+    uint64_t state = getStream(d, STREAM_REPO, repo);
+    int invalid = nextInvalid(&state, 4), owner = getRepoOwner(d, repo);
+    long long created = getRepoCreation(d, repo);
+
+    int len = sprintf(buffer, "%d;%d;", GENERATOR_ID_BASE + repo, GENERATOR_ID_BASE + owner);
+    len += formatLogin(d, owner, buffer + len);
+    len += sprintf(buffer + len, "/%s-%d;%s;%s;", words[nextInt(&state, COUNT(words))], repo,
+                   nextInt(&state, 10) < 4 ? "None" : licenses[nextZipf(&state, COUNT(licenses))],
+                   invalid == 0 ? "Maybe" : nextInt(&state, 10) < 7 ? "True" : "False");
+
+    int n = 1 + nextInt(&state, 12);
+    for (int i = 0; i < n; i++)
+        len += sprintf(buffer + len, "%s%s", i > 0 ? " " : "", words[nextInt(&state, COUNT(words))]);
+
+    char* branches[] = { "master", "master", "master", "main", "main", "develop", "gh-pages" };
+    len += sprintf(buffer + len, ";%s;%s;", nextInt(&state, 100) < 15 ? "None" : languages[nextZipf(&state, COUNT(languages))],
+                   branches[nextInt(&state, COUNT(branches))]);
+
+    len += invalid == 1 ? sprintf(buffer + len, "2004-12-01 00:00:00") : formatDate(buffer + len, created);
+    buffer[len++] = ';';
+    len += formatDate(buffer + len, created + nextInt(&state, LAST_DATE - created + 1));
+
+    int stars = nextPowerLaw(&state, 1.6, 500000);
+    len += sprintf(buffer + len, ";%d;%d;%d;", nextPowerLaw(&state, 1.8, 100000), nextPowerLaw(&state, 2.0, 10000), stars);
+    return len + (invalid == 2 ? sprintf(buffer + len, "big\n") : invalid == 3 ? sprintf(buffer + len, "-\n")
+                                                                               : sprintf(buffer + len, "%d\n", (int)nextInt(&state, 1000000)));
+}
+
+/**
+ * @brief           Writes a row of commits.csv, the repo being drawn by popularity
+ *
+ * @param d         The data set
+ * @param state     The state of the stream of the commits (updated)
+ * @param buffer    The buffer to write to (of ::ROW_SIZE characters)
+ *
+ * @return          The number of characters written
+ */
+static int formatCommit(DATASET* d, uint64_t* state, char* buffer) {
+    int invalid = nextInvalid(state, 4);
+    int repo = spreadRank(nextZipf(state, d->repos), d->repos), owner = getRepoOwner(d, repo);
+    int friend = getFriend(d, owner), author;
+
+    int who = (int)nextInt(state, 100);
+    if (who < 60)
+        author = owner;
+    else if (who < 70 && friend >= 0)
+        author = friend;
+    else
+        author = spreadRank(nextZipf(state, d->users), d->users);
+    int committer = nextInt(state, 100) < 85 ? author : spreadRank(nextZipf(state, d->users), d->users);
+
+    int len = sprintf(buffer, "%d;", GENERATOR_ID_BASE + (invalid == 0 ? d->repos + repo : repo));
+    len += invalid == 1 ? sprintf(buffer + len, "abc;") : sprintf(buffer + len, "%d;", GENERATOR_ID_BASE + author);
+    if (invalid != 2)
+        len += sprintf(buffer + len, "%d", GENERATOR_ID_BASE + committer);
+    buffer[len++] = ';';
+
+    long long created = getRepoCreation(d, repo);
+    len += invalid == 3 ? sprintf(buffer + len, "2005-04-06 12:00:00")
+                        : formatDate(buffer + len, created + nextInt(state, LAST_DATE - created + 1));
+    buffer[len++] = ';';
+
+    int n = 1 + nextInt(state, 8);
+    for (int i = 0; i < n; i++)
+        len += sprintf(buffer + len, "%s%s", i > 0 ? " " : "", words[nextInt(state, COUNT(words))]);
+    return len + sprintf(buffer + len, "\n");
+}
+
+/**
+ * @brief       Estimates the number of rows of a file which take a given size
+ *
+ * @param d     The data set (with the number of users and of repos guessed)
+ * @param row   The function writing a row
+ * @param n     The number of rows of the file guessed
+ * @param size  The size of the file
+ *
+ * @return      The number of rows (at least 2)
+ */
+static int estimateRows(DATASET* d, int (*row)(DATASET*, int, char*), int n, long long size) {
+    char* buffer = malloc(ROW_SIZE);
+    long long total = 0;
+    int samples = MIN(SAMPLE_ROWS, n);
+
+    for (int i = 0; i < samples; i++)
+        total += row(d, (int)(((long long)i * n) / samples), buffer);
+
+    free(buffer);
+    long long rows = size * samples / MAX(total, 1);
+    return (int)(rows < 2 ? 2 : rows > 2000000000 ? 2000000000 : rows);
+}
+
+/**
+ * @brief           Writes a file of the data set
+ *
+ * @param d         The data set
+ * @param path      The path to the file
+ * @param header    The first line of the file
+ * @param row       The function writing a row
+ * @param n         The number of rows
+ *
+ * @return          The size of the file
+ */
+static long long writeRows(DATASET* d, char* path, char* header, int (*row)(DATASET*, int, char*), int n) {
+    FILE* f = OPEN_FILE(path, "w");
+    char* buffer = malloc(ROW_SIZE);
+    long long size = fprintf(f, "%s\n", header);
+
+    for (int i = 0; i < n; i++) {
+        int len = row(d, i, buffer);
+        fwrite(buffer, 1, len, f);
+        size += len;
+    }
+
+    free(buffer);
+    fclose(f);
+    return size;
+}
+
+/**
+ * @brief           Writes the commits of the data set, until they take a given size
+ *
+ * @param d         The data set
+ * @param path      The path to the file
+ * @param size      The size of the file
+ * @param count     The number of commits written (set)
+ *
+ * @return          The size of the file
+ */
+static long long writeCommits(DATASET* d, char* path, long long size, long long* count) {
+    FILE* f = OPEN_FILE(path, "w");
+    char* buffer = malloc(ROW_SIZE);
+    uint64_t state = getStream(d, STREAM_COMMIT, 0);
+    long long written = fprintf(f, "repo_id;author_id;committer_id;commit_at;message\n");
+
+    for (*count = 0; written < size; (*count)++) {
+        int len = formatCommit(d, &state, buffer);
+        fwrite(buffer, 1, len, f);
+        written += len;
+    }
+
+    free(buffer);
+    fclose(f);
+    return written;
+}
+
+/**
+ * @brief       Writes a mix of queries, of every id, with parameters fitting the data set
+ *
+ * @param d     The data set
+ * @param path  The path to the file
+ */
+static void writeQueries(DATASET* d, char* path) {
+    FILE* f = OPEN_FILE(path, "w");
+    uint64_t state = getStream(d, STREAM_QUERY, 0);
+    int tops[] = { 1, 3, 5, 10, 50, 100 };
+    char from[32], to[32];
+
+    for (int i = 0; i < QUERY_MIX_SIZE; i++) {
+        int id = 1 + i % 10, top = tops[nextInt(&state, COUNT(tops))];
+        long long a = FIRST_DATE + nextInt(&state, LAST_DATE - FIRST_DATE), b = FIRST_DATE + nextInt(&state, LAST_DATE - FIRST_DATE);
+        formatDate(from, MIN(a, b));
+        formatDate(to, MAX(a, b));
+        from[10] = to[10] = '\0';
+
+        switch (id) {
+            case 5:
+                fprintf(f, "5 %d %s %s\n", top, from, to);
+                break;
+            case 6:
+                fprintf(f, "6 %d %s\n", top, languages[nextZipf(&state, COUNT(languages))]);
+                break;
+            case 7:
+                fprintf(f, "7 %s\n", from);
+                break;
+            case 8:
+                fprintf(f, "8 %d %s\n", top, from);
+                break;
+            case 9:
+            case 10:
+                fprintf(f, "%d %d\n", id, top);
+                break;
+            default:
+                fprintf(f, "%d\n", id);
+        }
+    }
+
+    fclose(f);
+}
+
+/**
+ * @brief       Parses a size (ex: "200MB", "10GB")
+ *
+ * @param text  The size, in bytes if it has no unit (KB, MB, GB)
+ *
+ * @return      The size in bytes (0 if it is not valid)
+ */
+static long long parseSize(char* text) {
+    char* end;
+    double size = strtod(text, &end);
+    if (end == text || size <= 0)
+        return 0;
+
+    char* units[] = { "", "KB", "MB", "GB" };
+    for (int i = 0; i < COUNT(units); i++, size *= 1024)
+        if (strcasecmp(end, units[i]) == 0)
+            return (long long)size;
+    return 0;
+}
+
+/**
+ * @brief Generator's main entry point
+ *
+ * @param argc  The number of arguments
+ * @param argv  The arguments of the generator: the target size of the data set (ex: "200MB"). The option "--seed"
+ *              followed by a number sets the seed, and the option "--output" followed by a path sets the directory the
+ *              files are written to (by default, the directory of "tests/performance" named after the target size)
+ *
+ * @return 0 if the data set was written
+ */
+int main(int argc, char* argv[]) {
+    uint64_t seed = GENERATOR_SEED;
+    char* size_arg = NULL;
+    char* output = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+            output = argv[++i];
+        else
+            size_arg = argv[i];
+    }
+
+    long long size = size_arg == NULL ? 0 : parseSize(size_arg);
+    if (size == 0) {
+        fprintf(stderr, "Usage: %s <size (ex: 200MB)> [--seed <seed>] [--output <directory>]\n", argv[0]);
+        return 1;
+    }
+
+    char dir[512], path[1024];
+    snprintf(dir, sizeof(dir), "%s", output != NULL ? output : GENERATOR_DIR);
+    if (output == NULL)
+        snprintf(dir + strlen(dir), sizeof(dir) - strlen(dir), "/%s", size_arg);
+    mkdir(dir, 0755);
+
+    //The number of rows is estimated from a sample, the size of a row depending on the number of users and repos
+    DATASET d = { .seed = seed, .users = 1000000, .repos = 1000000 };
+    long long users_size = size * USERS_SHARE / 1000, repos_size = size * REPOS_SHARE / 1000;
+    d.users = estimateRows(&d, formatUser, d.users, users_size);
+    d.repos = estimateRows(&d, formatRepo, d.repos, repos_size);
+
+    snprintf(path, sizeof(path), "%s/users.csv", dir);
+    long long written = writeRows(&d, path, "id;login;type;created_at;followers;follower_list;following;following_list;"
+                                           "public_gists;public_repos", formatUser, d.users);
+    printf("%s: %d users, %lld bytes\n", path, d.users, written);
+
+    snprintf(path, sizeof(path), "%s/repos.csv", dir);
+    written = writeRows(&d, path, "id;owner_id;full_name;license;has_wiki;description;language;default_branch;"
+                                  "created_at;updated_at;forks_count;open_issues;stargazers_count;size", formatRepo, d.repos);
+    printf("%s: %d repos, %lld bytes\n", path, d.repos, written);
+
+    long long commits;
+    snprintf(path, sizeof(path), "%s/commits.csv", dir);
+    written = writeCommits(&d, path, size - users_size - repos_size, &commits);
+    printf("%s: %lld commits, %lld bytes\n", path, commits, written);
+
+    snprintf(path, sizeof(path), "%s/queries.txt", dir);
+    writeQueries(&d, path);
+    printf("%s: %d queries\n", path, QUERY_MIX_SIZE);
+    return 0;
+}
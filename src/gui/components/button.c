@@ -48,9 +48,13 @@ Button createButton(char* text, bool selected) {
  * 
  * @param button    The given #Button
  * @param selected  Whether the #Button is selected or not
+ * 
+ * @return          Whether or not the selected state changed
  */
-void setButtonSelected(Button button, bool selected) {
+bool setButtonSelected(Button button, bool selected) {
+    bool changed = button->selected != selected;
     button->selected = selected;
+    return changed;
 }
 
 /**
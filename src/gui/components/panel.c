@@ -91,12 +91,11 @@ void freePanel(Panel p) {
  * @param panel     The given #Panel
  * @param selected  Whether or not the #Button is selected 
  * @param index     The index of the #Button in the stack
+ * 
+ * @return          Whether or not the #Panel changed
  */
-void setPNButtonSelected(Panel panel, bool selected, int index) {
-    if(index >= 0 && index < panel->numberElements) {
-        setVEButtonSelected(panel->stack[index], selected);
-    }   
-   
+bool setPNButtonSelected(Panel panel, bool selected, int index) {
+    return index >= 0 && index < panel->numberElements && setVEButtonSelected(panel->stack[index], selected);
 }
 
 /**
@@ -105,12 +104,11 @@ void setPNButtonSelected(Panel panel, bool selected, int index) {
  * @param panel     The given #Panel
  * @param index     The index of the #Button in the stack
  * @param text      The given string (new content of the #Text)
+ * 
+ * @return          Whether or not the #Panel changed
  */
-void setPNText(Panel panel, int index, char* text) {
-    if(index >= 0 && index < panel->numberElements) {
-        setVEText(panel->stack[index], text);
-    }   
-   
+bool setPNText(Panel panel, int index, char* text) {
+    return index >= 0 && index < panel->numberElements && setVEText(panel->stack[index], text);
 }
 
 /**
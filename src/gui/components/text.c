@@ -36,6 +36,7 @@
  */
 struct text {
     wchar_t* string;    ///< The wide string containing the content of the text
+    char* source;       ///< The string it was converted from (NULL if it was created from a wide string)
     int colour;         ///< The foreground / background code of the colours the text should be printed in
 };
 
@@ -54,6 +55,7 @@ Text createText(char* str, int colour) {
     Text result = malloc(sizeof(struct text));
 
     result->string = stringToWide(str);
+    result->source = strdup(str);
     result->colour = colour;
 
     return result;
@@ -72,6 +74,7 @@ Text createTextFromWide(wchar_t* str, int colour) {
     Text result = malloc(sizeof(struct text));
 
     result->string = wcsdup(str);
+    result->source = NULL;
     result->colour = colour;
 
     return result;
@@ -88,21 +91,30 @@ Text copyText(Text text) {
     Text copy = malloc(sizeof(struct text));
     copy->colour = text->colour;
     copy->string = wcsdup(text->string);
+    copy->source = text->source == NULL ? NULL : strdup(text->source);
     return copy;
 }
 
 /**
  * @brief           Sets the content of a #Text
  * 
- * @remark          This function receives a "narrow" string which will be converted to a wide string
+ * @remark          This function receives a "narrow" string which will be converted to a wide string (unless it is
+ *                  the one the #Text already holds, so setting the same content every frame costs no conversion)
  * 
  * @param text      The given #Text
  * @param str       The given string
  * 
+ * @return          Whether or not the content changed
  */
-void setText(Text text, char* str) {
+bool setText(Text text, char* str) {
+    if (text->source != NULL && strcmp(text->source, str) == 0)
+        return false;
+
     free(text->string);
+    free(text->source);
     text->string = stringToWide(str);
+    text->source = strdup(str);
+    return true;
 }
 
 /**
@@ -132,5 +144,6 @@ void printText(Text text, int* x, int* y, int width) {
  */
 void freeText(Text text) {
     free(text->string);
+    free(text->source);
     free(text);
 } 
\ No newline at end of file
@@ -40,11 +40,10 @@ struct visualElement {
  * @param elem      The given #VisualElement
  * @param selected  Whether or not the #Button is selected
  *
+ * @return          Whether or not the #VisualElement changed
  */
-void setVEButtonSelected(VisualElement elem, bool selected) {
-    if(elem->contentType == BUTTON) {
-        setButtonSelected(elem->content.button, selected);
-    }
+bool setVEButtonSelected(VisualElement elem, bool selected) {
+    return elem->contentType == BUTTON && setButtonSelected(elem->content.button, selected);
 }
 
 /**
@@ -53,12 +52,10 @@ void setVEButtonSelected(VisualElement elem, bool selected) {
  * @param elem      The given #VisualElement
  * @param text      The given text
  *
+ * @return          Whether or not the #VisualElement changed
  */
-void setVEText(VisualElement elem, char* text) {
-    if(elem->contentType == TEXT) {
-        freeText(elem->content.text);
-        elem->content.text = createText(text, 2);
-    }
+bool setVEText(VisualElement elem, char* text) {
+    return elem->contentType == TEXT && setText(elem->content.text, text);
 }
 
 /**
@@ -171,7 +168,7 @@ void renderVisualElement(VisualElement elem, int* x, int* y, int width, int heig
 void freeVisualElement(VisualElement v) {
     switch(v->contentType) {
         case TEXT:
-            free(v->content.text);
+            freeText(v->content.text);
             break;
         case BUTTON:
             freeButton(v->content.button);
@@ -19,13 +19,21 @@
 #include "gui/pages/catalogPage.h"
 #include "gui/pages/catalogMenu.h"
 #include "gui/pages/mainMenu.h"
+#include "io/finder.h"
 #include "io/taskManager.h"
 #include "types/queries.h"
 #include "types/catalog.h"
+#include "utils/cancel.h"
 #include "utils/utils.h"
 
 
 
+/**
+ * @brief The time waited for a key before the #Page is rendered again, so the pages showing the results of a query
+ *        running or the live metrics keep updating (in milliseconds)
+ */
+#define INPUT_TIMEOUT 100
+
 /**
  * @brief The object used to describe the state of the GUI
  */
@@ -33,8 +41,14 @@ struct gui {
     Page page;          ///< The page the application is displaying
     void* state;        ///< The state of the page
     Catalog catalog;    ///< The catalog
+    CancelToken query;  ///< The #CancelToken of the last query started (NULL if none was)
 };
 
+/**
+ * @brief The mutex held by the query running (the queries write the same file, so they run one at a time)
+ */
+static pthread_mutex_t queryMutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 /**
  * @brief       Changes the current #Page being displayed in the #GUI
@@ -67,7 +81,7 @@ void executeStatistics(Catalog catalog) {
         Query query = createQueryId(i);
         FILE* file = OPEN_FILE(filename, "w+");
 
-        executeQuery(file, query, catalog);
+        executeQuery(file, query, catalog, NULL);
 
         fclose(file);
         freeQuery(query);
@@ -87,6 +101,11 @@ void loadCatalogsWrapper(void* args[]) {
     if (*(Catalog*)args[0] == NULL)
         *(Catalog*)args[0] = newCatalog(USERS_IN,COMMITS_IN,REPOS_IN, true);
 
+    //The searches of the catalog pages go through the trigram indexes of the input files
+    indexFinderFile(USERS_IN);
+    indexFinderFile(REPOS_IN);
+    indexFinderFile(COMMITS_IN);
+
     executeStatistics(*(Catalog*)args[0]);  //TODO: is this needed? catalog has the answers. ask vasques
     *(bool*)args[1] = true;
 }
@@ -117,6 +136,7 @@ GUI loadGUI() {
 
     gui->state = NULL;
     gui->page = NULL;
+    gui->query = NULL;
     changePage(gui, splashScreen(), NULL);
     
     while(!finished) {
@@ -139,7 +159,13 @@ GUI loadGUI() {
  */
 void freeGUI(GUI gui) {
     endwin();	
+
+    //Waits for the query running to stop before freeing the catalog
+    cancelWork(gui->query);
+    releaseCancelToken(gui->query);
+    pthread_mutex_lock(&queryMutex);
     freeCatalog(gui->catalog);
+    pthread_mutex_unlock(&queryMutex);
     void (*freeState)(void*) = getFreeStateFunction(gui->page);
     freeState(gui->state);
     freePage(gui->page);
@@ -147,21 +173,28 @@ void freeGUI(GUI gui) {
 }
 
 /**
- * @brief Executes a #Query
+ * @brief Executes a #Query, after the one running stops (skipping it if it was superseded in the meantime)
  * 
- * @param args [0] -> catalog [1] -> query to execute
+ * @param args [0] -> catalog [1] -> query to execute [2] -> #CancelToken of the query (released when done)
  */
 void executeQueryGUI(void* args[]) {
-    char* filename = getQueryFileName();
-
     Catalog catalog = (Catalog)args[0];
     Query query = (Query)args[1];
+    CancelToken cancel = (CancelToken)args[2];
+
+    pthread_mutex_lock(&queryMutex);
+    if (!isCancelled(cancel)) {
+        char* filename = getQueryFileName();
+        FILE* file = OPEN_FILE(filename, "w+");      
+        executeQuery(file, query, catalog, cancel);
+        fclose(file);
+        indexFileLines(filename);
+        free(filename);
+    }
+    pthread_mutex_unlock(&queryMutex);
 
-    FILE* file = OPEN_FILE(filename, "w+");      
-    executeQuery(file, query, catalog);
-    fclose(file);
-    free(filename);
     freeQuery(query);
+    releaseCancelToken(cancel);
 }
 
 /**
@@ -215,9 +248,14 @@ bool processKeyInput(GUI gui, int ch) {
             }
             freeQuery(q);
         } else  {
-            //Execute query
+            //Execute query, superseding the one running
+            cancelWork(gui->query);
+            releaseCancelToken(gui->query);
+            gui->query = makeCancelToken();
+
             pthread_t queryThread;
-            pthread_create(&queryThread, NULL, sequence, SEQ(FUNC(executeQueryGUI, gui->catalog, q)));
+            pthread_create(&queryThread, NULL, sequence,
+                           SEQ(FUNC(executeQueryGUI, gui->catalog, q, retainCancelToken(gui->query))));
             pthread_detach(queryThread);
             //Give thread enough time to copy data
             nanosleep((const struct timespec[]){{0, 1000000L}}, NULL);
@@ -235,12 +273,12 @@ bool processKeyInput(GUI gui, int ch) {
 void runGUI(GUI gui) {
     bool running = true;
 
+    //Block on the next key instead of polling (the pages are only drawn again when they change, see renderPage)
+    timeout(INPUT_TIMEOUT);
     while(running) {
         renderPage(gui->page, gui->state);
         int ch = getch();
         running = processKeyInput(gui, ch);
-        //Lock to 60fps
-        nanosleep((const struct timespec[]){{0, 16666666L}}, NULL);
     }
     char* filename = getQueryFileName();
     remove(filename);
@@ -39,6 +39,9 @@ struct page {
     void (*freeState)(void*);           ///< The function used to free the state type
     Query (*processInput)(void*, int);  ///< The function used to process the input
     void (*applyState)(Page, void*);    ///< The function used to apply the state
+    bool damaged;                       ///< Whether or not a #Panel changed since the #Page was last rendered
+    int screenRows;                     ///< The number of rows of the terminal when the #Page was last rendered (0 if never)
+    int screenCols;                     ///< The number of columns of the terminal when the #Page was last rendered
 };
 
 /**
@@ -51,8 +54,9 @@ struct page {
  * @param selected      Whether or not the #Button is selected
  */
 void setPageButtonSelected(Page page, int row, int column, int stackIndex, bool selected) {
-    if(row * page->columns + column >= 0 && row * page->columns + column < page->rows * page->columns)
-        setPNButtonSelected(page->grid[row * page->columns + column], selected, stackIndex);
+    if(row * page->columns + column >= 0 && row * page->columns + column < page->rows * page->columns
+       && setPNButtonSelected(page->grid[row * page->columns + column], selected, stackIndex))
+        page->damaged = true;
 }
 
 /**
@@ -65,8 +69,9 @@ void setPageButtonSelected(Page page, int row, int column, int stackIndex, bool
  * @param text          Whether or not the #Text is selected
  */
 void setPageText(Page page, int row, int column, int stackIndex, char* text) {
-    if(row * page->columns + column >= 0 && row * page->columns + column < page->rows * page->columns)
-        setPNText(page->grid[row * page->columns + column], stackIndex, text);
+    if(row * page->columns + column >= 0 && row * page->columns + column < page->rows * page->columns
+       && setPNText(page->grid[row * page->columns + column], stackIndex, text))
+        page->damaged = true;
 }
 
 /**
@@ -110,6 +115,9 @@ Page newPage(int rows, int cols, float* rowHeight, float* colWidth, void* (*stat
     page->freeState = freeState;
     page->processInput = processInput;
     page->applyState = applyState;
+    page->damaged = true;
+    page->screenRows = 0;
+    page->screenCols = 0;
     return page;
 }
 
@@ -124,6 +132,7 @@ Page newPage(int rows, int cols, float* rowHeight, float* colWidth, void* (*stat
 void setPagePanel(Page page, Panel panel, int row, int column) {
     freePanel(page->grid[row * page->columns + column]);
     page->grid[row * page->columns + column] = copyPanel(panel);
+    page->damaged = true;
 }
 
 /**
@@ -186,6 +195,10 @@ void getScreenDimensions(int* rows, int* cols) {
 /**
  * @brief       Displays the given #Page on the terminal window
  * 
+ *              The state is applied first, and the #Page is only drawn again if that changed one of its #Panel (or
+ *              the terminal was resized). The screen is then updated with wnoutrefresh and doupdate, which only send
+ *              the characters that differ from the ones on the terminal
+ * 
  * @param page  The #Page to display
  * @param state The state of the #Page
  */
@@ -194,8 +207,11 @@ void renderPage(Page page, void* state) {
     getScreenDimensions(&rows, &cols);
     int x = 1, y = 1;
     float width = 0.0f, height = 0.0f;
-    erase();
     page->applyState(page, state);
+    if(!page->damaged && rows == page->screenRows && cols == page->screenCols)
+        return;
+
+    erase();
     for(int i = 0; i < page->rows; i++) {
         x = 1;
         width = 0.0f;
@@ -208,7 +224,11 @@ void renderPage(Page page, void* state) {
         height = page->rowHeight[i];
     }
 
-    refresh();
+    page->damaged = false;
+    page->screenRows = rows;
+    page->screenCols = cols;
+    wnoutrefresh(stdscr);
+    doupdate();
 }
 
 /**
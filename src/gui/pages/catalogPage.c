@@ -102,7 +102,6 @@ void applyCatalogPageString(CtState state) {
     state->lazyPage = true;
 
     free(pstr);
-    clear();
 }
 
 
@@ -221,7 +220,7 @@ void applyCtState(Page page, void* st) {
 
         if(state->status == 3) {
             char* search = getStringContent(state->searchString);
-            finder(files[state->catalogId], filename, search);
+            finder(files[state->catalogId], filename, search, (state->page + 1) * resultsPerPage + 1);
             free(search);
         }
 
@@ -4,6 +4,7 @@
  * File containing implementations of the functions used to interface with the query page for the GUI
  */
 
+#include <glib.h>
 #include <ncurses.h>
 #include <pthread.h>
 #include <stdio.h>
@@ -48,6 +49,8 @@ typedef struct qpstate {
     String searchString;                    ///< The string used to search
     String pageString;                      ///< The string used to store the page the user requested
     bool invalidQueryVisible;               ///< Whether or not the text displaying "The input is invalid!" is on or not
+    GHashTable* tables;                     ///< The #Panel of the pages of results already formatted, by page + 1
+    int tableRows;                          ///< The number of results per page the tables were formatted for
 } *QpState;
 
 
@@ -153,6 +156,8 @@ QpState defaultQpState(int query) {
     state->invalidQueryVisible = false;
     state->searchString = newString("");
     state->pageString = newString("");
+    state->tables = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)freePanel);
+    state->tableRows = 0;
     for(int i = 0; i < state->parameterCount; i++) {
         state->parameters[i] = newString("");
         state->parametersValid[i] = false;
@@ -190,9 +195,19 @@ void freeQpState(void* st) {
         freeString(state->parameters[i]);
     }
 
+    g_hash_table_destroy(state->tables);
     free(state);
 }
 
+/**
+ * @brief       Forgets the pages of results formatted (when the results or the way they are split into pages change)
+ *
+ * @param state The state of the #Page
+ */
+void clearResultTables(QpState state) {
+    g_hash_table_remove_all(state->tables);
+}
+
 /**
  * @brief       Applies the value of the pageString property
  *
@@ -215,7 +230,6 @@ void applyPageString(QpState state) {
     state->lazyPage = true;
 
     free(pstr);
-    clear();
 }
 
 
@@ -253,11 +267,13 @@ Query processQpInput(void* state, int key) {
                 q = getRequestedQuery(st);
                 st->queryRun = !st->invalidQueryVisible;
                 st->lazyPage = true;
+                clearResultTables(st);
             } else if(st->mousePosition == - 1) { //User has finished typing the search
                 st->mousePosition = -2;
                 st->page = 0;
                 st->lazyPage = true;
                 st->queryRun = true;
+                clearResultTables(st);
             }
             break;
         case 27: //Esc
@@ -266,6 +282,7 @@ Query processQpInput(void* state, int key) {
             } else {
                 st->mousePosition++;
                 st->lazyPage = true;
+                clearResultTables(st);
             }
             break;
         case KEY_BACKSPACE:
@@ -373,6 +390,17 @@ void applyQpState(Page page, void* st) {
         free(content);
     }
 
+    if(state->queryRun && state->lazyPage && state->tableRows != resultsPerPage) {
+        clearResultTables(state);
+        state->tableRows = resultsPerPage;
+    }
+
+    Panel cached = state->queryRun && state->lazyPage ? g_hash_table_lookup(state->tables, GINT_TO_POINTER(state->page + 1)) : NULL;
+    if(cached != NULL) {
+        setPagePanel(page, cached, 1, 1);
+        state->lazyPage = false;
+    }
+
     if(state->queryRun && state->lazyPage) {
 
         char* filename = getQueryFileName();
@@ -382,7 +410,7 @@ void applyQpState(Page page, void* st) {
             char* queryFileName = strdup(filename);
            	filename[6] = 'q';
             char* search = getStringContent(state->searchString);
-            finder(queryFileName, filename, search);
+            finder(queryFileName, filename, search, (state->page + 1) * resultsPerPage);
             free(search);
             free(queryFileName);
         }
@@ -417,7 +445,7 @@ void applyQpState(Page page, void* st) {
         state->lazyPage = false;
 
         setPagePanel(page, textPanel, 1, 1);
-        freePanel(textPanel);
+        g_hash_table_insert(state->tables, GINT_TO_POINTER(state->page + 1), textPanel);
 
         for(int i = 0; i < size; i++)
             free(content[i]);
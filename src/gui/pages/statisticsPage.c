@@ -2,6 +2,9 @@
  * @file statisticsPage.c
  * 
  * File containing the implementation of the statistics page
+ *
+ * Along with the statistic queries, the page shows the metrics of the hot paths (see @ref getMetrics), refreshed while
+ * it is displayed, and the profile of the last query executed
  */
 
 #include <stdio.h>
@@ -14,7 +17,9 @@
 #include "gui/components/panel.h"
 #include "gui/components/title.h"
 #include "types/queries.h"
+#include "utils/metrics.h"
 #include "utils/querySolver.h"
+#include "utils/utils.h"
 
 
 /**
@@ -22,6 +27,22 @@
  */
 #define MAX_OUTPUT_LENGTH 2
 
+/**
+ * @brief The time between two refreshes of the metrics (in seconds)
+ */
+#define METRICS_REFRESH_INTERVAL 0.5
+
+/**
+ * @brief The number of lines of the metrics of the hot paths and of the metrics of the queries
+ */
+#define METRICS_LINES 6
+#define QUERY_METRICS_LINES 5
+
+/**
+ * @brief The size of a line of the metrics
+ */
+#define METRICS_LINE_SIZE 64
+
 /**
  * @brief The state for the statistics page
  * 
@@ -29,6 +50,7 @@
 typedef struct stState {
     char** output[STATISTICS_COUNT];    ///< The content of the statistic queries
     int lines[STATISTICS_COUNT];        ///< The number of lines of each statistic query
+    double refreshed;                   ///< The time the metrics were last refreshed (see @ref getWallClock)
 } * StState;
 
 
@@ -65,13 +87,71 @@ void freeStState(void* st) {
 }
 
 /**
- * @brief Empty function as the state is applied once at the beggining of the page
+ * @brief           Converts nanoseconds to milliseconds
+ */
+#define MS(ns) ((ns) / 1e6)
+
+/**
+ * @brief           Writes the metrics of the hot paths and of the queries to the texts of their panels
+ * 
+ * @param page      The given #Page
+ */
+static void setMetricsTexts(Page page) {
+    METRICS m;
+    getMetrics(&m);
+    long* c = m.counters;
+    char lines[METRICS_LINES + QUERY_METRICS_LINES][METRICS_LINE_SIZE];
+
+    long accesses = c[METRIC_CACHE_HITS] + c[METRIC_CACHE_MISSES];
+    snprintf(lines[0], METRICS_LINE_SIZE, "Cache: %ld hits, %ld misses (%.1f%%)", c[METRIC_CACHE_HITS],
+             c[METRIC_CACHE_MISSES], accesses > 0 ? 100.0 * c[METRIC_CACHE_HITS] / accesses : 0);
+    snprintf(lines[1], METRICS_LINE_SIZE, "Evictions: %ld", c[METRIC_CACHE_EVICTIONS]);
+    snprintf(lines[2], METRICS_LINE_SIZE, "Reads: %ld, %.1f MB (p99 %.2f ms)", c[METRIC_READS],
+             c[METRIC_READ_BYTES] / 1048576.0, MS(getHistogramPercentile(&m, HISTOGRAM_READ_NS, 99)));
+    snprintf(lines[3], METRICS_LINE_SIZE, "Writes: %ld, %.1f MB (p99 %.2f ms)", c[METRIC_WRITES],
+             c[METRIC_WRITE_BYTES] / 1048576.0, MS(getHistogramPercentile(&m, HISTOGRAM_WRITE_NS, 99)));
+    snprintf(lines[4], METRICS_LINE_SIZE, "Lock waits: %ld, %.2f ms", c[METRIC_LOCK_WAITS], MS(c[METRIC_LOCK_WAIT_NS]));
+    snprintf(lines[5], METRICS_LINE_SIZE, "Key probes: %.1f avg (p99 %ld), decodes: %ld",
+             c[METRIC_KEY_LOOKUPS] > 0 ? (double)c[METRIC_KEY_PROBES] / c[METRIC_KEY_LOOKUPS] : 0,
+             getHistogramPercentile(&m, HISTOGRAM_KEY_PROBES, 99), c[METRIC_LAZY_DECODES]);
+
+    snprintf(lines[6], METRICS_LINE_SIZE, "Queries: %ld (p50 %.2f ms, p99 %.2f ms)", c[METRIC_QUERIES],
+             MS(getHistogramPercentile(&m, HISTOGRAM_QUERY_NS, 50)), MS(getHistogramPercentile(&m, HISTOGRAM_QUERY_NS, 99)));
+    snprintf(lines[7], METRICS_LINE_SIZE, "Rows scanned: %ld", c[METRIC_ROWS_SCANNED]);
+
+    QUERYPROFILE p;
+    if (getLastQueryProfile(&p)) {
+        snprintf(lines[8], METRICS_LINE_SIZE, "Last query: %d, %.2f ms, %ld rows", p.id, MS(p.ns), p.rows);
+        snprintf(lines[9], METRICS_LINE_SIZE, "I/O %.2f ms, locks %.2f ms, CPU %.2f ms", MS(p.read_ns), MS(p.lock_ns),
+                 MS(MAX(0, p.ns - p.read_ns - p.lock_ns)));
+        snprintf(lines[10], METRICS_LINE_SIZE, "Cache misses: %ld", p.misses);
+    }
+    else
+        for (int i = 8; i < METRICS_LINES + QUERY_METRICS_LINES; i++)
+            lines[i][0] = '\0';
+
+    //The first two texts of each panel are its description and a blank line
+    for (int i = 0; i < METRICS_LINES; i++)
+        setPageText(page, 1, 1, 2 + i, lines[i]);
+    for (int i = 0; i < QUERY_METRICS_LINES; i++)
+        setPageText(page, 2, 1, 2 + i, lines[METRICS_LINES + i]);
+}
+
+/**
+ * @brief Refreshes the metrics shown, every @ref METRICS_REFRESH_INTERVAL seconds (the statistics are applied once, at
+ *        the beggining of the page)
  * 
  * @param page  The given #Page
  * @param st    The state of the #Page
  */
 void applyStState(Page page, void* st) {
+    StState state = (StState)st;
+    double now = getWallClock();
 
+    if (now - state->refreshed >= METRICS_REFRESH_INTERVAL) {
+        setMetricsTexts(page);
+        state->refreshed = now;
+    }
 }
 
 
@@ -80,6 +160,7 @@ void applyStState(Page page, void* st) {
  */
 StState defaultStState() {
     StState state = malloc(sizeof(struct stState));
+    state->refreshed = 0;
 
     for(int i = 0; i < STATISTICS_COUNT; i++) {
         char* filename = getStatisticFileName(i + 1);
@@ -167,6 +248,20 @@ Page statisticsPage() {
         freePanel(panel);
     }
 
+    //The metrics, filled by applyStState
+    char* metricsDescription[2] = { "Live Metrics:", "Query Metrics:" };
+    int metricsLines[2] = { METRICS_LINES, QUERY_METRICS_LINES };
+    for (int i = 0; i < 2; i++) {
+        panel = emptyPanel();
+        for (int j = 0; j < 2 + metricsLines[i]; j++) {
+            VisualElement ve = createVisualElement(TEXT, j == 0 ? metricsDescription[i] : "");
+            panelInsert(panel, ve);
+            freeVisualElement(ve);
+        }
+        setPagePanel(page, panel, 1 + i, 1);
+        freePanel(panel);
+    }
+
     panel = emptyPanel();
     VisualElement ve = createVisualElement(TEXT, "<Press ESC to exit>");
     panelInsert(panel, ve);
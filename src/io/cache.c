@@ -6,12 +6,22 @@
  * The #Cache is used to minimize the number of file accesses needed when executing a query
  * 
  */
-
+#define _GNU_SOURCE
+#include <fcntl.h>
 #include <glib.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "io/cache.h"
+#include "io/placement.h"
+#include "utils/metrics.h"
 
 
 /**
@@ -20,215 +30,1535 @@
  */
 #define HASH_KEY 4294967029
 
+/**
+ * @brief The maximum number of pending @ref prefetchRange requests. Further requests are dropped
+ * 
+ */
+#define PREFETCH_QUEUE_SIZE 64
+
+/**
+ * @brief The maximum number of different line sizes (pools) of a #Cache
+ * 
+ */
+#define CACHE_MAX_POOLS 4
+
+/**
+ * @brief The number of file descriptors whose #CACHE_FILE are allocated together
+ */
+#define CACHE_FILE_CHUNK 64
+
+/**
+ * @brief The largest file descriptor (plus one) a #Cache may know about
+ */
+#define CACHE_MAX_FILES 65536
+
+/**
+ * @brief Iterates over all the #Shard of all the #Pool of a #Cache
+ * 
+ */
+#define FOR_EACH_SHARD(c, shard) \
+    for (int _pool = 0; _pool < (c)->pool_num; _pool++) \
+        for (Shard shard = (c)->pools[_pool].shards; shard < (c)->pools[_pool].shards + (c)->pools[_pool].shard_num; shard++)
+
+/**
+ * @brief The number of bytes of data of the #Line of a #Pool allocated together, when first needed: a slab of one huge
+ *        page (see @ref allocateSlab)
+ */
+#define CACHE_CHUNK_SIZE SLAB_HUGE_PAGE_SIZE
+
+/**
+ * @brief The number of mutexes of a #Shard its #Line are loaded under (each #Line uses the one its address falls on)
+ */
+#define CACHE_LINE_LOCKS 8
+
+/**
+ * @brief The maximum number of #Line loaded by a single vectored read
+ * 
+ */
+#define MAX_RANGE_LINES 64
+
 /**
  * @brief   The basic data unit of the #Cache
  * 
- *          Contains information about the position in a file of the data block read
+ *          Contains information about the position in a file of the data block read
+ */
+typedef struct key {
+    int file_desc;  ///< The file descriptor the of the data
+    pos_t pos;      ///< The position (in bytes) in the file of the data
+} KEY, * Key;
+
+/**
+ * @brief   A line of the #Cache
+ * 
+ *          A line is a doubly linked list of #Key and the data as a binary string 
+ */
+typedef struct line {
+    struct line * prev;     ///< The previous element in the list (NULL if first element)
+    struct line * next;     ///< The next element in the list (NULL if last element)
+
+    KEY key;                ///< The #Key of the element
+    int read_desc;          ///< The file descriptor the data is read from (that of the key, unless the file is read with O_DIRECT)
+
+    bool loaded;            ///< Whether or not the data has been loaded from file (read without locks, see @ref isLoaded)
+    bool altered;           ///< Whether or not the data has been written to and not yet flushed
+    int queue;              ///< The queue of the #Shard the line is in (see @ref QUEUE_MAIN and @ref QUEUE_IN)
+    struct shard* shard;    ///< The #Shard the line belongs to
+    int dirty_index;        ///< The position of the line in the list of altered lines of its #Shard (-1 if not altered)
+    int pins;               ///< The number of threads using the line (never evicted while used, see @ref releaseLine)
+
+    int size;               ///< The size of the data of the line (the line size of its #Pool)
+    int length;             ///< The number of bytes of data that exist in the file (written back on flush)
+    char* data;             ///< The data of the line
+} * Line;
+
+/**
+ * @brief       Checks if two #Key are equal
+ * 
+ *              Two #Key are said to be equal if they have the same position and file descriptor
+ * 
+ * @param k1    The first #Key
+ * @param k2    The second #Key
+ * 
+ * @return      Whether or not they are the same      
+ */
+gboolean key_equal(gconstpointer k1, gconstpointer k2) {
+    Key _k1 = (Key)k1, _k2 = (Key)k2;
+    return _k1->pos == _k2->pos && _k1->file_desc == _k2->file_desc;
+}
+
+/**
+ * @brief   Hashes a #Key
+ *
+ * 
+ * @param k The given #Key
+ * 
+ * @return  The hash of the #Key (an integer)
+ */
+guint key_hash(gconstpointer k) {
+    Key _k = (Key)k;
+    return _k->file_desc ^ (_k->pos % (guint)HASH_KEY);
+}
+
+/**
+ * @brief The queue holding the frequently accessed #Line (the only queue used by @ref CACHE_LRU)
+ * 
+ */
+#define QUEUE_MAIN 0
+
+/**
+ * @brief The FIFO queue holding the #Line accessed only once recently (used by @ref CACHE_2Q)
+ * 
+ */
+#define QUEUE_IN 1
+
+/**
+ * @brief   A shard of the #Cache
+ * 
+ *          Each shard owns a slice of the #Line of the #Cache and is locked independently of the others,
+ *          so lookups refering to different shards never contend for the same mutex.
+ * 
+ *          With @ref CACHE_2Q, a #Line read for the first time enters the FIFO queue @ref QUEUE_IN. When
+ *          it is evicted from there, its #Key is remembered in a ring of ghost keys, and only a miss on a
+ *          ghost key promotes the #Line to @ref QUEUE_MAIN. A long scan therefore only cycles through
+ *          @ref QUEUE_IN, leaving the hot lines of @ref QUEUE_MAIN in place.
+ */
+typedef struct shard {
+    Line first[2];              ///< The most recently inserted #Line of each queue
+    Line last[2];               ///< The least recently inserted #Line of each queue (the eviction candidate)
+    int count[2];               ///< The number of #Line in each queue
+    int in_max;                 ///< The target size of @ref QUEUE_IN (@ref CACHE_2Q only)
+
+    KEY* ghosts;                ///< Ring of the #Key recently evicted from @ref QUEUE_IN (@ref CACHE_2Q only)
+    int ghost_num;              ///< The size of the ring of ghost keys
+    int ghost_next;             ///< The next position of the ring to overwrite
+    GHashTable* ghostKeys;      ///< Hashtable of the ghost keys present in the ring
+
+    pthread_mutex_t mutex;      ///< The mutex of the shard
+    pthread_cond_t unpinned;    ///< Signaled when a #Line of the shard stops being used
+    pthread_mutex_t line_locks[CACHE_LINE_LOCKS];   ///< The mutexes the #Line of the shard are loaded under (see @ref getLineMutex)
+    GHashTable* posLinePairs;   ///< Hashtable of the shard's #Line indexed by #Key
+
+    int line_num;               ///< The number of lines of the shard
+    int allocated;              ///< The number of lines of the shard allocated so far (the others are taken before evicting)
+    long hits;                  ///< The number of hits in the shard (for statistical purposes only)
+    long misses;                ///< The number of misses in the shard (for statistical purposes only)
+    long ghost_hits;            ///< The number of misses that hit a ghost key (for statistical purposes only)
+
+    GArray* dirty;              ///< The altered #Line of the shard, written back by @ref flushCache
+    long writes;                ///< The number of writes to files (for statistical purposes only)
+    long written_lines;         ///< The number of #Line written back (for statistical purposes only)
+} * Shard;
+
+/**
+ * @brief   A pool of #Line of the same size
+ * 
+ *          Each file is served by the pool whose line size suits the way it is read (see @ref registerCacheFile)
+ */
+typedef struct pool {
+    int line_size;              ///< The size (in bytes) of the #Line of the pool. Not to confuse with file lines, that end in '\n'
+    GArray* blocks;             ///< The first #Line of each block of lines allocated together (see @ref takeSpareLine)
+    Line block;                 ///< The block lines are being taken from (NULL if none)
+    int block_used;             ///< The number of lines of block taken
+    int block_len;              ///< The number of lines of block
+    pthread_mutex_t block_mutex;    ///< The mutex of block
+    pthread_mutex_t flush_mutex;    ///< Serializes the write-backs of the pool (see @ref writeDirty)
+    struct shard* shards;       ///< The shards of the pool
+    int shard_num;              ///< The number of shards of the pool
+    int line_num;               ///< The number of lines of the pool (allocated or not)
+} * Pool;
+
+/**
+ * @brief   What the #Cache knows about a file, indexed by its file descriptor
+ * 
+ */
+typedef struct cacheFile {
+    int pool;                   ///< The index of the #Pool serving the file
+    char* map;                  ///< The memory mapping of the file (NULL if not mapped)
+    pos_t map_size;             ///< The size of the mapped file
+    int direct;                 ///< The file descriptor the file is read from with O_DIRECT (-1 if none, see @ref setCacheFileDirect)
+} CACHE_FILE;
+
+/**
+ * @brief   A pending @ref prefetchRange request
+ * 
+ */
+typedef struct prefetch {
+    int file_desc;  ///< The file descriptor of the file to prefetch
+    pos_t from;     ///< The first position to prefetch
+    pos_t to;       ///< The position after the last position to prefetch
+    bool hot;       ///< Whether the lines were hot when a snapshot was taken (placed in @ref QUEUE_MAIN, see @ref loadCacheSnapshot)
+} PREFETCH;
+
+/**
+ * @brief   A range of a file kept by a snapshot of the #Cache (see @ref saveCacheSnapshot)
+ */
+typedef struct snapshotRange {
+    int file;       ///< The index of the file in the files given to the snapshot
+    int hot;        ///< Whether the lines of the range were in @ref QUEUE_MAIN
+    pos_t from;     ///< The first position of the range
+    pos_t to;       ///< The position after the last position of the range
+} SNAPSHOTRANGE;
+
+/**
+ * @brief   An altered #Line taken to be written back by @ref writeDirty
+ */
+typedef struct dirtyLine {
+    Line line;      ///< The #Line, pinned until it is written
+    int length;     ///< The length of the data of the #Line when it was taken
+} DIRTYLINE;
+
+/**
+ * @brief   The header of a snapshot of the #Cache
+ */
+typedef struct snapshotHeader {
+    char tag[CACHE_SNAPSHOT_TAG_SIZE];  ///< The tag of what the files held when the snapshot was taken
+    int range_num;                      ///< The number of #SNAPSHOTRANGE following the header
+} SNAPSHOTHEADER;
+
+/**
+ * @brief The type used to represent the program's cache
+ * 
+ * The cache aims to reduce the number of file accesses needed throughout the execution of the program
+ * 
+ */
+struct cache {
+    struct pool pools[CACHE_MAX_POOLS]; ///< The pools of the cache. The first one, of @ref CACHE_LINE_SIZE, is the default
+    int pool_num;               ///< The number of pools of the cache
+    CachePolicy policy;         ///< The eviction policy of the cache
+
+    pthread_t prefetcher;                       ///< The thread loading the lines requested by @ref prefetchRange
+    pthread_mutex_t prefetch_mutex;             ///< The mutex of the prefetch queue
+    pthread_cond_t prefetch_cond;               ///< Signaled when a request is queued or the prefetcher must stop
+    pthread_cond_t prefetch_done;               ///< Signaled when the prefetcher finishes a request
+    PREFETCH prefetch_queue[PREFETCH_QUEUE_SIZE];   ///< The circular queue of pending requests
+    int prefetch_start;                         ///< The position of the oldest pending request in the queue
+    int prefetch_len;                           ///< The number of pending requests
+    int prefetch_busy;                          ///< The file descriptor being prefetched (-1 if none)
+    bool prefetch_stop;                         ///< Whether or not the prefetcher must stop
+    GArray* warm;                               /**< The ranges of a snapshot left to load, in reverse order, loaded when
+                                                     no request is pending (see @ref loadCacheSnapshot) */
+
+    pthread_t flusher;                          ///< The thread periodically writing back the altered lines (see @ref startCacheFlusher)
+    bool flusher_running;                       ///< Whether or not the flusher was started
+    bool flusher_stop;                          ///< Whether or not the flusher must stop
+    int flush_interval;                         ///< The time between two write-backs of the flusher (in milliseconds)
+    pthread_mutex_t flusher_mutex;              ///< The mutex of the flusher
+    pthread_cond_t flusher_cond;                ///< Signaled when the flusher must stop
+
+    CACHE_FILE* files[CACHE_MAX_FILES / CACHE_FILE_CHUNK];   /**< The registered and mapped files, indexed by file descriptor, in chunks
+                                                                 allocated when first needed. Chunks never move, so files may be
+                                                                 looked up while others are registered */
+    pthread_mutex_t files_mutex;                            ///< The mutex protecting the allocation of the chunks of files
+};
+
+/**
+ * @brief           Gets the #Shard of a #Pool responsible for the given #Key
+ * 
+ *                  Consecutive lines of the same file are spread across different shards
+ * 
+ * @param p         The given #Pool
+ * @param key       The given #Key (its position must be aligned to the line size of the #Pool)
+ * 
+ * @return          The requested #Shard
+ */
+static inline Shard getShard(Pool p, Key key) {
+    pos_t h = (key->pos / (pos_t)p->line_size) * (pos_t)2654435761u + (pos_t)key->file_desc;
+    return p->shards + (h % (pos_t)p->shard_num);
+}
+
+/**
+ * @brief       Gets the mutex a #Line is loaded under, shared with other #Line of its #Shard
+ * 
+ * @param l     The #Line
+ * 
+ * @return      The mutex
+ */
+static inline pthread_mutex_t* getLineMutex(Line l) {
+    return l->shard->line_locks + ((uintptr_t)l / sizeof(struct line)) % CACHE_LINE_LOCKS;
+}
+
+/**
+ * @brief           Locks a mutex of the #Cache, timing the wait when it is held by another thread
+ * 
+ * @param mutex     The mutex
+ */
+static inline void lockCacheMutex(pthread_mutex_t* mutex) {
+#ifdef HOT_PATH_METRICS
+    if (pthread_mutex_trylock(mutex) == 0)
+        return;
+
+    long start = METRICS_TIME();
+    pthread_mutex_lock(mutex);
+    long wait = METRICS_TIME() - start;
+
+    ADD_METRIC(METRIC_LOCK_WAITS, 1);
+    ADD_METRIC(METRIC_LOCK_WAIT_NS, wait);
+    ADD_HISTOGRAM(HISTOGRAM_LOCK_WAIT_NS, wait);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+/**
+ * @brief           Counts a read (or a write) of the #Cache
+ * 
+ * @param write     Whether it is a write
+ * @param bytes     The number of bytes read or written (-1 on error)
+ * @param start     The time it started (see @ref METRICS_TIME)
+ */
+static inline void countCacheIo(bool write, ssize_t bytes, long start) {
+    long ns = METRICS_TIME() - start;
+
+    ADD_METRIC(write ? METRIC_WRITES : METRIC_READS, 1);
+    ADD_METRIC(write ? METRIC_WRITE_BYTES : METRIC_READ_BYTES, MAX(0, bytes));
+    ADD_METRIC(write ? METRIC_WRITE_NS : METRIC_READ_NS, ns);
+    ADD_HISTOGRAM(write ? HISTOGRAM_WRITE_NS : HISTOGRAM_READ_NS, ns);
+}
+
+/**
+ * @brief       Checks whether or not the data of a #Line was loaded. Pairs with the store made once it is, so the data
+ *              read after a positive check is complete
+ * 
+ * @param l     The #Line
+ * 
+ * @return      Whether or not the data was loaded
+ */
+static inline bool isLoaded(Line l) {
+    return __atomic_load_n(&l->loaded, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief       Updates a #Cache line: flushes it if altered and loads if if not loaded
+ * 
+ * @warning     Does not set the previous/next members
+ * 
+ * @param line      The #Line to update
+ * @param old_key   The old key to flush
+ */
+void updateCacheLine(Line line, Key old_key) {
+    if (!isLoaded(line) || line->altered) {
+        lockCacheMutex(getLineMutex(line));
+
+        if (line->altered) {
+            long start = METRICS_TIME();
+            ssize_t write = pwrite(line->key.file_desc, line->data, line->length, line->key.pos);
+            countCacheIo(true, write, start);
+        
+            if (write == -1)
+                fprintf(stderr, "updateCacheLine: error writing to file (file descriptor: %d)\n", line->key.file_desc);
+        
+            line->altered = false;
+        }
+
+        if (!line->loaded) {
+            long start = METRICS_TIME();
+            ssize_t read = pread(line->read_desc, line->data, line->size, line->key.pos);
+            countCacheIo(false, read, start);
+
+            if (read == -1)
+                fprintf(stderr, "updateCacheLine: error reading file (file descriptor: %d)\n", line->key.file_desc);
+            else if (read < line->size)         //End of file
+                line->data[read] = '\0';
+
+            line->length = MAX(0, read);
+
+            __atomic_store_n(&line->loaded, true, __ATOMIC_RELEASE);
+        }
+
+        pthread_mutex_unlock(getLineMutex(line));
+    }
+}
+
+/**
+ * @brief           Removes a #Line from its queue
+ * 
+ * @param shard     The #Shard of the #Line
+ * @param l         The #Line
+ */
+static inline void unlinkLine(Shard shard, Line l) {
+    if (l->prev == NULL)
+        shard->first[l->queue] = l->next;
+    else
+        l->prev->next = l->next;
+
+    if (l->next == NULL)
+        shard->last[l->queue] = l->prev;
+    else
+        l->next->prev = l->prev;
+
+    shard->count[l->queue]--;
+}
+
+/**
+ * @brief           Places a #Line at the beginning of the given queue
+ * 
+ * @param shard     The #Shard of the #Line
+ * @param l         The #Line
+ * @param queue     The queue (@ref QUEUE_MAIN or @ref QUEUE_IN)
+ */
+static inline void pushLine(Shard shard, Line l, int queue) {
+    l->queue = queue;
+    l->prev = NULL;
+    l->next = shard->first[queue];
+
+    if (shard->first[queue] == NULL)
+        shard->last[queue] = l;
+    else
+        shard->first[queue]->prev = l;
+
+    shard->first[queue] = l;
+    shard->count[queue]++;
+}
+
+/**
+ * @brief           Remembers the #Key of a #Line evicted from @ref QUEUE_IN
+ * 
+ * @param shard     The #Shard
+ * @param key       The evicted #Key
+ */
+static void pushGhost(Shard shard, Key key) {
+    Key slot = shard->ghosts + shard->ghost_next;
+
+    if (g_hash_table_lookup(shard->ghostKeys, (gpointer)slot) == slot)
+        g_hash_table_remove(shard->ghostKeys, (gpointer)slot);
+
+    *slot = *key;
+    g_hash_table_insert(shard->ghostKeys, (gpointer)slot, (gpointer)slot);
+    shard->ghost_next = (shard->ghost_next + 1) % shard->ghost_num;
+}
+
+/**
+ * @brief           Checks if the given #Key is a ghost key, forgetting it if so
+ * 
+ * @param shard     The #Shard
+ * @param key       The #Key
+ * 
+ * @return          Whether or not the #Key was a ghost key
+ */
+static bool popGhost(Shard shard, Key key) {
+    Key slot = g_hash_table_lookup(shard->ghostKeys, (gpointer)key);
+
+    if (slot == NULL)
+        return false;
+
+    g_hash_table_remove(shard->ghostKeys, (gpointer)slot);
+    slot->file_desc = -1;
+    return true;
+}
+
+/**
+ * @brief           Adds an altered #Line to the list of altered lines of its #Shard
+ * 
+ * @warning         The mutex of the #Shard must be locked
+ * 
+ * @param l         The #Line
+ */
+static inline void listDirty(Line l) {
+    if (l->dirty_index == -1) {
+        l->dirty_index = l->shard->dirty->len;
+        g_array_append_val(l->shard->dirty, l);
+    }
+}
+
+/**
+ * @brief           Removes a #Line from the list of altered lines of its #Shard
+ * 
+ * @warning         The mutex of the #Shard must be locked
+ * 
+ * @param l         The #Line
+ */
+static inline void unlistDirty(Line l) {
+    if (l->dirty_index != -1) {
+        GArray* dirty = l->shard->dirty;
+        Line last = g_array_index(dirty, Line, dirty->len - 1);
+
+        g_array_index(dirty, Line, l->dirty_index) = last;
+        last->dirty_index = l->dirty_index;
+        g_array_set_size(dirty, dirty->len - 1);
+        l->dirty_index = -1;
+    }
+}
+
+/**
+ * @brief           Chooses the #Line of the #Shard to evict and removes it from its queue. Lines in use are skipped
+ * 
+ * @param c         The #Cache
+ * @param shard     The #Shard
+ * 
+ * @return          The evicted #Line (NULL if every #Line of the #Shard is in use)
+ */
+static Line evictLine(Cache c, Shard shard) {
+    int queue = QUEUE_MAIN;
+
+    if (c->policy == CACHE_2Q && (shard->count[QUEUE_IN] > shard->in_max || shard->count[QUEUE_MAIN] == 0))
+        queue = QUEUE_IN;
+
+    Line l = shard->last[queue];
+    while (l != NULL && l->pins > 0)
+        l = l->prev;
+
+    if (l == NULL && c->policy == CACHE_2Q) {
+        l = shard->last[!queue];
+        while (l != NULL && l->pins > 0)
+            l = l->prev;
+    }
+
+    if (l == NULL)
+        return NULL;
+    unlinkLine(shard, l);
+    ADD_METRIC(METRIC_CACHE_EVICTIONS, 1);
+
+    if (g_hash_table_lookup(shard->posLinePairs, (gpointer)&l->key) == l) {
+        g_hash_table_remove(shard->posLinePairs, (gpointer)&l->key);
+
+        if (queue == QUEUE_IN)
+            pushGhost(shard, &l->key);
+
+        //Pending writes must reach the file before the line is reused
+        if (l->altered) {
+            unlistDirty(l);
+            updateCacheLine(l, &l->key);
+            shard->writes++;
+            shard->written_lines++;
+        }
+    }
+
+    return l;
+}
+
+static void* prefetchRoutine(void*);
+
+/**
+ * @brief           Takes an empty #Line for a #Shard that has not allocated all of its lines yet, allocating a block of
+ *                  @ref CACHE_CHUNK_SIZE bytes of lines for its #Pool when the previous one is used up
+ * 
+ * @warning         The mutex of the #Shard must be locked
+ * 
+ * @param p         The #Pool
+ * @param shard     The #Shard
+ * 
+ * @return          The #Line (not in any queue), or NULL if a new block could not be allocated
+ */
+static Line takeSpareLine(Pool p, Shard shard) {
+    pthread_mutex_lock(&p->block_mutex);
+
+    if (p->block == NULL || p->block_used == p->block_len) {
+        int block_len = MAX(1, CACHE_CHUNK_SIZE / p->line_size);
+        Line block = malloc(block_len * sizeof(struct line));
+        //Aligned to a huge page, so also fit to be read with O_DIRECT (see setCacheFileDirect)
+        char* data = block == NULL ? NULL : allocateSlab((size_t)block_len * p->line_size * sizeof(char));
+
+        if (data == NULL) {
+            fprintf(stderr, "takeSpareLine: error allocating lines\n");
+            free(block);
+            pthread_mutex_unlock(&p->block_mutex);
+            return NULL;
+        }
+
+        p->block = block;
+        p->block->data = data;
+        p->block_len = block_len;
+        p->block_used = 0;
+        g_array_append_val(p->blocks, p->block);
+    }
+
+    Line l = p->block + p->block_used;
+    l->data = p->block->data + (size_t)p->block_used * p->line_size * sizeof(char);
+    p->block_used++;
+    pthread_mutex_unlock(&p->block_mutex);
+
+    l->size = p->line_size;
+    l->key.file_desc = -1;
+    l->loaded = false;
+    l->altered = false;
+    l->dirty_index = -1;
+    l->pins = 0;
+    l->length = 0;
+    l->shard = shard;
+    shard->allocated++;
+    return l;
+}
+
+/**
+ * @brief           Initializes a #Pool with the given number of #Line, split into the given number of shards. The lines
+ *                  are only allocated once needed (see @ref takeSpareLine)
+ * 
+ * @param p         The #Pool to initialize
+ * @param line_size The size of each #Line
+ * @param line_num  The number of #Line
+ * @param shard_num The number of shards (at least 1 and at most line_num)
+ * @param policy    The eviction policy
+ */
+static void initPool(Pool p, int line_size, int line_num, int shard_num, CachePolicy policy) {
+    if (shard_num < 1)
+        shard_num = 1;
+    if (shard_num > line_num)
+        shard_num = line_num;
+
+    p->blocks = g_array_new(FALSE, FALSE, sizeof(Line));
+    p->block = NULL;
+    p->block_used = p->block_len = 0;
+    pthread_mutex_init(&p->block_mutex, NULL);
+    pthread_mutex_init(&p->flush_mutex, NULL);
+
+    p->shards = malloc(shard_num * sizeof(struct shard));
+
+    for (int s = 0; s < shard_num; s++) {
+        Shard shard = p->shards + s;
+        shard->line_num = line_num / shard_num + (s < line_num % shard_num);
+        shard->allocated = 0;
+        shard->posLinePairs = g_hash_table_new(key_hash, key_equal);
+        pthread_mutex_init(&shard->mutex, NULL);
+        pthread_cond_init(&shard->unpinned, NULL);
+        for (int i = 0; i < CACHE_LINE_LOCKS; i++)
+            pthread_mutex_init(shard->line_locks + i, NULL);
+
+        for (int q = 0; q < 2; q++) {
+            shard->first[q] = shard->last[q] = NULL;
+            shard->count[q] = 0;
+        }
+
+        shard->in_max = MAX(1, shard->line_num / 4);
+        shard->ghost_num = MAX(1, shard->line_num / 2);
+        shard->ghost_next = 0;
+        shard->ghosts = NULL;
+        shard->ghostKeys = NULL;
+
+        if (policy == CACHE_2Q) {
+            shard->ghosts = malloc(shard->ghost_num * sizeof(KEY));
+            shard->ghostKeys = g_hash_table_new(key_hash, key_equal);
+
+            for (int i = 0; i < shard->ghost_num; i++)
+                shard->ghosts[i].file_desc = -1;
+        }
+
+        shard->hits = 0;
+        shard->misses = 0;
+        shard->ghost_hits = 0;
+
+        shard->dirty = g_array_new(FALSE, FALSE, sizeof(Line));
+        shard->writes = 0;
+        shard->written_lines = 0;
+    }
+
+    p->line_size = line_size;
+    p->shard_num = shard_num;
+    p->line_num = line_num;
+}
+
+/**
+ * @brief           Creates a #Cache with the given number of #Line of @ref CACHE_LINE_SIZE, split into the
+ *                  given number of shards. Files are served by these lines, unless registered to another
+ *                  pool (see @ref addCachePool and @ref registerCacheFile)
+ * 
+ * @param line_num  The number of #Line
+ * @param shard_num The number of shards (at least 1 and at most line_num)
+ * @param policy    The eviction policy
+ * @return          The requested #Cache
+ */
+Cache getCache(int line_num, int shard_num, CachePolicy policy) {
+    Cache c = malloc(sizeof(struct cache));
+
+    initPool(c->pools, CACHE_LINE_SIZE, line_num, shard_num, policy);
+    c->pool_num = 1;
+    c->policy = policy;
+
+    for (int i = 0; i < CACHE_MAX_FILES / CACHE_FILE_CHUNK; i++)
+        c->files[i] = NULL;
+    pthread_mutex_init(&c->files_mutex, NULL);
+
+    pthread_mutex_init(&c->prefetch_mutex, NULL);
+    pthread_cond_init(&c->prefetch_cond, NULL);
+    pthread_cond_init(&c->prefetch_done, NULL);
+    c->prefetch_start = 0;
+    c->prefetch_len = 0;
+    c->prefetch_busy = -1;
+    c->prefetch_stop = false;
+    c->warm = g_array_new(FALSE, FALSE, sizeof(PREFETCH));
+    pthread_create(&c->prefetcher, NULL, prefetchRoutine, c);
+
+    c->flusher_running = false;
+    c->flusher_stop = false;
+    c->flush_interval = 0;
+    pthread_mutex_init(&c->flusher_mutex, NULL);
+    pthread_cond_init(&c->flusher_cond, NULL);
+
+    return c;
+}
+
+/**
+ * @brief           Adds to the #Cache a pool of #Line of the given size, which registered files may use
+ * 
+ * @warning         Must not be called while other threads use the #Cache
+ * 
+ * @param c         The given #Cache
+ * @param line_size The size of each #Line of the pool
+ * @param line_num  The number of #Line of the pool
+ * 
+ * @return          Whether or not the pool was added
+ */
+bool addCachePool(Cache c, int line_size, int line_num) {
+    if (c->pool_num == CACHE_MAX_POOLS || line_size <= 0 || line_num <= 0) {
+        fprintf(stderr, "addCachePool: cannot add a pool of %d lines of %d bytes\n", line_num, line_size);
+        return false;
+    }
+
+    initPool(c->pools + c->pool_num, line_size, line_num, c->pools[0].shard_num, c->policy);
+    c->pool_num++;
+    return true;
+}
+
+/**
+ * @brief           Adds #Line to the pool of the #Cache with the given line size (ex: when more memory becomes available),
+ *                  spread evenly across its shards. The new lines are allocated once needed, before any is evicted
+ * 
+ * @param c         The given #Cache
+ * @param line_size The size of the #Line of the pool
+ * @param line_num  The number of #Line to add
+ * 
+ * @return          Whether or not the pool was grown
+ */
+bool growCachePool(Cache c, int line_size, int line_num) {
+    Pool p = NULL;
+    for (int i = 0; i < c->pool_num && p == NULL; i++)
+        if (c->pools[i].line_size == line_size)
+            p = c->pools + i;
+
+    if (p == NULL || line_num <= 0) {
+        fprintf(stderr, "growCachePool: cannot add %d lines of %d bytes\n", line_num, line_size);
+        return false;
+    }
+
+    for (int s = 0; s < p->shard_num; s++) {
+        Shard shard = p->shards + s;
+        int n = line_num / p->shard_num + (s < line_num % p->shard_num);
+
+        pthread_mutex_lock(&shard->mutex);
+        shard->line_num += n;
+        shard->in_max = MAX(1, shard->line_num / 4);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+
+    p->line_num += line_num;
+    return true;
+}
+
+/**
+ * @brief           Gets what the #Cache knows about the given file descriptor
+ * 
+ * @param c         The given #Cache
+ * @param file_desc The given file descriptor
+ * @param create    Whether or not to make room for the file descriptor if it is unknown
+ * 
+ * @return NULL     If the file descriptor is unknown and create is false
+ * @return          The requested #CACHE_FILE
+ */
+static inline CACHE_FILE* getCacheFile(Cache c, int file_desc, bool create) {
+    if (file_desc < 0 || file_desc >= CACHE_MAX_FILES)
+        return NULL;
+
+    CACHE_FILE** slot = c->files + file_desc / CACHE_FILE_CHUNK;
+    CACHE_FILE* chunk = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+    if (chunk == NULL) {
+        if (!create)
+            return NULL;
+
+        pthread_mutex_lock(&c->files_mutex);
+        chunk = *slot;
+        if (chunk == NULL) {
+            chunk = malloc(CACHE_FILE_CHUNK * sizeof(CACHE_FILE));
+            for (int i = 0; i < CACHE_FILE_CHUNK; i++)
+                chunk[i] = (CACHE_FILE){ .pool = 0, .map = NULL, .map_size = 0, .direct = -1 };
+            __atomic_store_n(slot, chunk, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&c->files_mutex);
+    }
+
+    return chunk + file_desc % CACHE_FILE_CHUNK;
+}
+
+/**
+ * @brief           Gets the #Pool serving the given file descriptor
+ * 
+ * @param c         The given #Cache
+ * @param file_desc The given file descriptor
+ * 
+ * @return          The requested #Pool
+ */
+static inline Pool getPool(Cache c, int file_desc) {
+    CACHE_FILE* f = getCacheFile(c, file_desc, false);
+    return c->pools + (f == NULL ? 0 : f->pool);
+}
+
+/**
+ * @brief           Makes the given file be served by the pool of #Line of the given size. Files not
+ *                  registered use @ref CACHE_LINE_SIZE
+ * 
+ * @warning         Must not be called while other threads use the file
+ * 
+ * @param c         The given #Cache
+ * @param file      The given file
+ * @param line_size The line size (see @ref addCachePool)
+ * 
+ * @return          Whether or not there is such a pool
+ */
+bool registerCacheFile(Cache c, FILE* file, int line_size) {
+    int pool;
+    for (pool = 0; pool < c->pool_num && c->pools[pool].line_size != line_size; pool++);
+
+    if (pool == c->pool_num)
+        return false;
+
+    CACHE_FILE* f = getCacheFile(c, fileno(file), true);
+
+    if (f->pool != pool) {
+        //The lines of the old pool must not outlive the registration
+        clearCacheFile(c, file);
+        f->pool = pool;
+    }
+
+    return true;
+}
+
+/**
+ * @brief           Gets the memory mapping of the given file descriptor, if any
+ * 
+ * @param c         The given #Cache
+ * @param file_desc The given file descriptor
+ * @param size      Where to store the size of the mapped file
+ * 
+ * @return NULL     If the file is not mapped
+ * @return char*    The start of the mapping
+ */
+static inline char* getMapping(Cache c, int file_desc, pos_t* size) {
+    CACHE_FILE* f = getCacheFile(c, file_desc, false);
+
+    if (f == NULL || f->map == NULL)
+        return NULL;
+
+    *size = f->map_size;
+    return f->map;
+}
+
+/**
+ * @brief           Serves all future reads of the given file directly from a read-only memory mapping,
+ *                  bypassing the #Line of the #Cache. The kernel page cache then holds the data only once
+ * 
+ * @warning         The file must not be written to while mapped, and this function must not be called
+ *                  while other threads use the #Cache
+ * 
+ * @param c         The given #Cache
+ * @param file      The file to map
+ * @param advice    The madvise hint describing how the file will be accessed (e.g. MADV_RANDOM)
+ * 
+ * @return          Whether or not the file was mapped. If not, reads keep going through the #Line of the #Cache
+ */
+bool mapCacheFile(Cache c, FILE* file, int advice) {
+    int file_desc = fileno(file);
+    struct stat st;
+
+    if (getMapping(c, file_desc, &(pos_t){0}) != NULL)
+        return true;
+
+    if (fstat(file_desc, &st) == -1 || st.st_size == 0)
+        return false;
+
+    fflush(file);
+    clearCacheFile(c, file);
+
+    char* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, file_desc, 0);
+
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "mapCacheFile: error mapping file (file descriptor: %d)\n", file_desc);
+        return false;
+    }
+
+    if (madvise(map, st.st_size, advice) == -1)
+        fprintf(stderr, "mapCacheFile: ignored madvise hint (file descriptor: %d)\n", file_desc);
+
+    CACHE_FILE* f = getCacheFile(c, file_desc, true);
+    f->map = map;
+    f->map_size = st.st_size;
+    return true;
+}
+
+/**
+ * @brief           Stops serving reads of the given file from its memory mapping, or with O_DIRECT
+ * 
+ * @warning         Must be called before closing a mapped file, as its file descriptor may be reused
+ * 
+ * @param c         The given #Cache
+ * @param file      The mapped file
+ */
+void unmapCacheFile(Cache c, FILE* file) {
+    int file_desc = fileno(file);
+    pos_t size;
+    char* map = getMapping(c, file_desc, &size);
+
+    if (map != NULL) {
+        munmap(map, size);
+        getCacheFile(c, file_desc, false)->map = NULL;
+    }
+
+    CACHE_FILE* f = getCacheFile(c, file_desc, false);
+    if (f != NULL && f->direct != -1) {
+        clearCacheFile(c, file);
+        close(f->direct);
+        f->direct = -1;
+    }
+}
+
+/**
+ * @brief           Reads all future #Line of the given file with O_DIRECT, from a second file descriptor, so the data
+ *                  is not held by the kernel page cache as well as by the #Cache. Writes keep going through the file
+ * 
+ * @warning         Must not be called while other threads use the #Cache. The line size of the #Pool serving the file
+ *                  must be a multiple of @ref CACHE_DIRECT_ALIGNMENT (see @ref registerCacheFile)
+ * 
+ * @param c         The given #Cache
+ * @param file      The file to read with O_DIRECT
+ * 
+ * @return          Whether or not the file is read with O_DIRECT. If not, reads keep going through the page cache
+ */
+bool setCacheFileDirect(Cache c, FILE* file) {
+    int file_desc = fileno(file);
+    CACHE_FILE* f = getCacheFile(c, file_desc, true);
+
+    if (f == NULL || c->pools[f->pool].line_size % CACHE_DIRECT_ALIGNMENT != 0)
+        return false;
+    if (f->direct != -1)
+        return true;
+
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/self/fd/%d", file_desc);
+    int direct = open(path, O_RDONLY | O_DIRECT | O_CLOEXEC);
+
+    if (direct == -1) {
+        fprintf(stderr, "setCacheFileDirect: file can not be read with O_DIRECT (file descriptor: %d)\n", file_desc);
+        return false;
+    }
+
+    //The lines already loaded were read through the page cache
+    fflush(file);
+    clearCacheFile(c, file);
+    f->direct = direct;
+    return true;
+}
+
+/**
+ * @brief           Gets the file descriptor the #Line of the given file descriptor are read from
+ * 
+ * @param c         The given #Cache
+ * @param file_desc The given file descriptor
+ * 
+ * @return          The file descriptor opened with O_DIRECT (see @ref setCacheFileDirect), or the given one
+ */
+static inline int getReadDesc(Cache c, int file_desc) {
+    CACHE_FILE* f = getCacheFile(c, file_desc, false);
+    return f == NULL || f->direct == -1 ? file_desc : f->direct;
+}
+
+/**
+ * @brief           Searches the #Pool for the #Line holding the given position of a file, assigning it a
+ *                  #Line if there is none. The data of the #Line may not be loaded yet
+ * 
+ *                  The #Line is pinned: it is not evicted (nor reused for another position) until it is released with
+ *                  @ref releaseLine, so the data stays valid while it is read, however small the #Cache
+ * 
+ * @param c         The given #Cache
+ * @param p         The #Pool serving the file
+ * @param file_desc The given file descriptor
+ * @param pos       The given position in the file
+ * @param hot       Whether a #Line assigned to the position starts among the hot lines (@ref CACHE_2Q only)
+ * @param wait      Whether to wait for a #Line to be released when every #Line of the #Shard is pinned
+ * 
+ * @return          The requested #Line (NULL if every #Line is pinned and it was not to wait)
+ */
+static Line acquireLine(Cache c, Pool p, int file_desc, pos_t pos, bool hot, bool wait) {
+    Line l;
+    KEY key = (KEY){ .file_desc = file_desc, .pos = pos - pos % (pos_t)p->line_size };
+    Shard shard = getShard(p, &key);
+
+    lockCacheMutex(&shard->mutex);
+
+    while (true) {
+        gpointer search = g_hash_table_lookup(shard->posLinePairs, (gpointer)&key);
+
+        if (search != NULL) { //Hit 
+            shard->hits++;
+            ADD_METRIC(METRIC_CACHE_HITS, 1);
+            l = (Line)search;
+
+            //Lines in the FIFO queue keep their place: repeated accesses while scanning do not make them hot
+            if (l->queue == QUEUE_MAIN && l != shard->first[QUEUE_MAIN]) {
+                unlinkLine(shard, l);
+                pushLine(shard, l, QUEUE_MAIN);
+            }
+            break;
+        }
+
+        //Lines that cannot be allocated are made up for by evicting those already allocated
+        l = shard->allocated < shard->line_num ? takeSpareLine(p, shard) : NULL;
+        if (l == NULL)
+            l = evictLine(c, shard);
+        if (l != NULL) { //Miss
+            shard->misses++;
+            ADD_METRIC(METRIC_CACHE_MISSES, 1);
+
+            l->key = key;
+            l->read_desc = getReadDesc(c, file_desc);
+            l->loaded = false;
+            l->altered = false;
+            g_hash_table_insert(shard->posLinePairs, (gpointer)&l->key, (gpointer)l);
+
+            if (c->policy == CACHE_2Q && !hot && !popGhost(shard, &key))
+                pushLine(shard, l, QUEUE_IN);
+            else {
+                shard->ghost_hits += (c->policy == CACHE_2Q && !hot);
+                pushLine(shard, l, QUEUE_MAIN);
+            }
+            break;
+        }
+
+        if (!wait) {
+            pthread_mutex_unlock(&shard->mutex);
+            return NULL;
+        }
+
+        //Every line of the shard is in use: wait for one to be released (the key may be loaded meanwhile)
+        pthread_cond_wait(&shard->unpinned, &shard->mutex);
+    }
+
+    l->pins++;
+    pthread_mutex_unlock(&shard->mutex);
+    return l;
+}
+
+/**
+ * @brief       Releases a #Line acquired by @ref acquireLine, allowing it to be evicted once no thread uses it
+ * 
+ * @param l     The #Line
+ */
+static inline void releaseLine(Line l) {
+    Shard shard = l->shard;
+
+    lockCacheMutex(&shard->mutex);
+    if (--l->pins == 0)
+        pthread_cond_broadcast(&shard->unpinned);
+    pthread_mutex_unlock(&shard->mutex);
+}
+
+/**
+ * @brief           Searches the #Cache for a #Key matching the given file descriptor and position.
+ *                  The given position may be bigger than the file's size
+ * 
+ * @param c         The given #Cache
+ * @param file_desc The given file descriptor
+ * @param pos       The given position in the file
+ * 
+ * @warning         The #Line must be released with @ref releaseLine once used
+ * 
+ * @return NULL     If there is no such #Line
+ * @return Line     The requested #Line
  */
-typedef struct key {
-    int file_desc;  ///< The file descriptor the of the data
-    pos_t pos;      ///< The position (in bytes) in the file of the data
-} KEY, * Key;
+Line getCacheLine(Cache c, int file_desc, pos_t pos) {
+    Line l = acquireLine(c, getPool(c, file_desc), file_desc, pos, false, true);
+
+    if (!isLoaded(l))
+        updateCacheLine(l, &l->key);
+
+    return l;
+}
 
 /**
- * @brief   A line of the #Cache
+ * @brief           Reads the data of consecutive #Line of the same file with a single vectored read
  * 
- *          A line is a doubly linked list of #Key and the data as a binary string 
+ * @warning         The mutexes of the #Line must be locked. They are unlocked by this function
+ * 
+ * @param run       The #Line, sorted by position
+ * @param iov       The buffers of the #Line
+ * @param len       The number of #Line
  */
-typedef struct line {
-    struct line * prev;     ///< The previous element in the list (NULL if first element)
-    struct line * next;     ///< The next element in the list (NULL if last element)
+static void readRun(Line run[], struct iovec iov[], int len) {
+    long start = METRICS_TIME();
+    ssize_t read = preadv(run[0]->read_desc, iov, len, run[0]->key.pos);
+    countCacheIo(false, read, start);
 
-    KEY key;                ///< The #Key of the element
+    if (read == -1)
+        fprintf(stderr, "readRun: error reading file (file descriptor: %d)\n", run[0]->key.file_desc);
 
-    bool loaded;            ///< Whether or not the data has been loaded from file
-    bool altered;
+    for (int i = 0; i < len; i++) {
+        ssize_t line_read = read == -1 ? -1 : MAX(0, MIN(read - (ssize_t)i * run[i]->size, run[i]->size));
 
-    pthread_mutex_t mutex;  ///< The mutex of the line
-    char* data;             ///< The data of the line (size LINE_SIZE)
-} * Line;
+        if (line_read >= 0 && line_read < run[i]->size)    //End of file
+            run[i]->data[line_read] = '\0';
+
+        run[i]->length = MAX(0, line_read);
+
+        __atomic_store_n(&run[i]->loaded, true, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(getLineMutex(run[i]));
+    }
+}
 
 /**
- * @brief       Checks if two #Key are equal
- * 
- *              Two #Key are said to be equal if they have the same position and file descriptor
+ * @brief           Loads the #Line of the #Cache covering the given range of a file, so that reading the
+ *                  range issues a vectored read per run of consecutive unloaded #Line instead of a read per #Line
  * 
- * @param k1    The first #Key
- * @param k2    The second #Key
+ *                  The #Line are pinned in batches, and a batch is cut short when its #Shard has no #Line left to pin
+ *                  rather than waiting while holding the #Line already pinned
  * 
- * @return      Whether or not they are the same      
+ * @param c         The given #Cache
+ * @param p         The #Pool serving the file
+ * @param file_desc The file descriptor of the file
+ * @param from      The first position of the range
+ * @param to        The position after the last position of the range
+ * @param hot       Whether the #Line assigned to the range start among the hot lines (see @ref acquireLine)
  */
-gboolean key_equal(gconstpointer k1, gconstpointer k2) {
-    Key _k1 = (Key)k1, _k2 = (Key)k2;
-    return _k1->pos == _k2->pos && _k1->file_desc == _k2->file_desc;
+static void loadRange(Cache c, Pool p, int file_desc, pos_t from, pos_t to, bool hot) {
+    Line lines[MAX_RANGE_LINES], run[MAX_RANGE_LINES];
+    struct iovec iov[MAX_RANGE_LINES];
+    pos_t pos = from - from % (pos_t)p->line_size;
+
+    while (pos < to) {
+        int n = 0, len = 0;
+
+        for (; pos < to && n < MAX_RANGE_LINES; pos += p->line_size) {
+            //Waiting for a #Line while holding others could leave every thread waiting for the lines the others hold
+            Line l = acquireLine(c, p, file_desc, pos, hot, n == 0);
+            if (l == NULL)
+                break;
+            lines[n++] = l;
+        }
+
+        for (int i = 0; i <= n; i++) {
+            //Lines locked by other threads are being loaded by them
+            bool take = i < n && !isLoaded(lines[i]) && pthread_mutex_trylock(getLineMutex(lines[i])) == 0;
+
+            if (take && lines[i]->loaded) {
+                pthread_mutex_unlock(getLineMutex(lines[i]));
+                take = false;
+            }
+
+            bool consecutive = take && len > 0 && run[len-1]->key.file_desc == lines[i]->key.file_desc
+                                    && run[len-1]->key.pos + run[len-1]->size == lines[i]->key.pos;
+
+            if (len > 0 && !consecutive) {
+                readRun(run, iov, len);
+                len = 0;
+            }
+
+            if (take) {
+                run[len] = lines[i];
+                iov[len] = (struct iovec){ .iov_base = lines[i]->data, .iov_len = lines[i]->size };
+                len++;
+            }
+        }
+
+        for (int i = 0; i < n; i++)
+            releaseLine(lines[i]);
+    }
 }
 
 /**
- * @brief   Hashes a #Key
- *
+ * @brief           The routine of the prefetcher thread of a #Cache.
+ *                  Loads the lines of the queued requests, and then those of the snapshot loaded, until the #Cache is freed
  * 
- * @param k The given #Key
+ * @param cache     The #Cache
  * 
- * @return  The hash of the #Key (an integer)
+ * @return          Always NULL
  */
-guint key_hash(gconstpointer k) {
-    Key _k = (Key)k;
-    return _k->file_desc ^ (_k->pos % (guint)HASH_KEY);
+static void* prefetchRoutine(void* cache) {
+    Cache c = (Cache)cache;
+    pthread_mutex_lock(&c->prefetch_mutex);
+
+    while (true) {
+        while (c->prefetch_len == 0 && c->warm->len == 0 && !c->prefetch_stop)
+            pthread_cond_wait(&c->prefetch_cond, &c->prefetch_mutex);
+
+        if (c->prefetch_stop)
+            break;
+
+        PREFETCH p;
+        if (c->prefetch_len > 0) {
+            p = c->prefetch_queue[c->prefetch_start];
+            c->prefetch_start = (c->prefetch_start + 1) % PREFETCH_QUEUE_SIZE;
+            c->prefetch_len--;
+        } else {
+            p = g_array_index(c->warm, PREFETCH, c->warm->len - 1);
+            g_array_set_size(c->warm, c->warm->len - 1);
+        }
+        c->prefetch_busy = p.file_desc;
+        pthread_mutex_unlock(&c->prefetch_mutex);
+
+        loadRange(c, getPool(c, p.file_desc), p.file_desc, p.from, p.to, p.hot);
+
+        pthread_mutex_lock(&c->prefetch_mutex);
+        c->prefetch_busy = -1;
+        pthread_cond_broadcast(&c->prefetch_done);
+    }
+
+    pthread_mutex_unlock(&c->prefetch_mutex);
+    return NULL;
 }
 
 /**
- * @brief The type used to represent the program's cache
+ * @brief           Asks the #Cache to load the given range of a file in the background, so that a future
+ *                  read of it does not wait for the disk
  * 
- * The cache aims to reduce the number of file accesses needed throughout the execution of the program
+ * @note            This is only a hint: if too many requests are pending, the request is dropped
  * 
+ * @param c         The given #Cache
+ * @param file      The given file
+ * @param from      The first position to prefetch
+ * @param to        The position after the last position to prefetch
  */
-struct cache {
-    Line* lines;                ///< The lines of the cache, each LINE_SIZE bytes long. Not to confuse with file lines, that end in '\n'
-    Line first;                 ///< The most recently accessed #Line
-    Line last;                  ///< The least recently accessed #Line
+void prefetchRange(Cache c, FILE* file, pos_t from, pos_t to) {
+    int file_desc = fileno(file);
+    pos_t size;
+    char* map = getMapping(c, file_desc, &size);
 
-    pthread_mutex_t mutex;      ///< The mutex of the cache
-    GHashTable* posLinePairs;   ///< Hashtable of cache #Line indexed by #Key
+    if (map != NULL) {
+        //The kernel reads the pages asynchronously
+        long page_size = sysconf(_SC_PAGESIZE);
+        from -= from % page_size;
+        to = MIN(to, size);
 
-    int line_num;               ///< The number of lines of the cache
-    long hits;                  ///< The number of hits in the cache (for statistical purposes only)
-    long misses;                ///< The number of misses in the cache (for statistical purposes only)
-};
+        if (from < to)
+            madvise(map + from, to - from, MADV_WILLNEED);
+
+        return;
+    }
+
+    //Never prefetch more than a fraction of the cache, or the prefetched lines would evict each other
+    Pool p = getPool(c, file_desc);
+    to = MIN(to, from + (pos_t)(p->line_num / 8) * p->line_size);
+
+    if (from >= to)
+        return;
+
+    pthread_mutex_lock(&c->prefetch_mutex);
+
+    if (c->prefetch_len < PREFETCH_QUEUE_SIZE) {
+        c->prefetch_queue[(c->prefetch_start + c->prefetch_len) % PREFETCH_QUEUE_SIZE] =
+            (PREFETCH){ .file_desc = file_desc, .from = from, .to = to, .hot = false };
+        c->prefetch_len++;
+        pthread_cond_signal(&c->prefetch_cond);
+    }
+
+    pthread_mutex_unlock(&c->prefetch_mutex);
+}
 
 /**
- * @brief           Creates a #Cache with the given number of #Line
+ * @brief           Drops the pending @ref prefetchRange requests (and snapshot ranges) of the given file and waits
+ *                  for the one being processed, if any
  * 
- * @param line_num  The number of #Line
- * @return          The requested #Cache
+ * @warning         Must be called before closing a file that may have been prefetched, as its file
+ *                  descriptor may be reused
+ * 
+ * @param c         The given #Cache
+ * @param file      The given file
  */
-Cache getCache(int line_num) {
-    Cache c = malloc(sizeof(struct cache));
-    c->posLinePairs = g_hash_table_new(key_hash, key_equal);
-    pthread_mutex_init(&c->mutex, NULL);
-
-    c->lines = malloc(line_num * sizeof(Line));
-    c->lines[0] = malloc(line_num * sizeof(struct line));
-    c->lines[0]->data = malloc(line_num * CACHE_LINE_SIZE * sizeof(char));
-    c->lines[0]->prev = NULL;
-    c->lines[0]->key.file_desc = -1;
-    c->lines[0]->loaded = false;
-    pthread_mutex_init(&c->lines[0]->mutex, NULL);
+void cancelPrefetchFile(Cache c, FILE* file) {
+    int file_desc = fileno(file), len = 0;
+    pthread_mutex_lock(&c->prefetch_mutex);
 
-    for (int i = 1; i < line_num; i++) {
-        c->lines[i] = c->lines[0] + i;
-        c->lines[i]->data = c->lines[0]->data + i * CACHE_LINE_SIZE * sizeof(char);
+    for (int i = 0; i < c->prefetch_len; i++) {
+        PREFETCH p = c->prefetch_queue[(c->prefetch_start + i) % PREFETCH_QUEUE_SIZE];
 
-        c->lines[i-1]->next = c->lines[i];
-        c->lines[i]->prev = c->lines[i-1];
-
-        c->lines[i]->key.file_desc = -1;
-        c->lines[i]->loaded = false;
-        c->lines[i]->altered = false;
-        pthread_mutex_init(&c->lines[i]->mutex, NULL);
+        if (p.file_desc != file_desc)
+            c->prefetch_queue[(c->prefetch_start + len++) % PREFETCH_QUEUE_SIZE] = p;
     }
 
-    c->lines[line_num-1]->next = NULL;
+    c->prefetch_len = len;
 
-    c->first = c->lines[0];
-    c->last = c->lines[line_num - 1];
+    len = 0;
+    for (int i = 0; i < (int)c->warm->len; i++)
+        if (g_array_index(c->warm, PREFETCH, i).file_desc != file_desc)
+            g_array_index(c->warm, PREFETCH, len++) = g_array_index(c->warm, PREFETCH, i);
+    g_array_set_size(c->warm, len);
 
-    c->line_num = line_num;
-    c->hits = 0;
-    c->misses = 0;
+    while (c->prefetch_busy == file_desc)
+        pthread_cond_wait(&c->prefetch_done, &c->prefetch_mutex);
 
-    return c;
+    pthread_mutex_unlock(&c->prefetch_mutex);
 }
 
 /**
- * @brief       Updates a #Cache line: flushes it if altered and loads if if not loaded
+ * @brief           Gets the index of the file with the given file descriptor among the files of a snapshot
  * 
- * @warning     Does not set the previous/next members
+ * @param files     The files of the snapshot
+ * @param file_num  The number of files
+ * @param file_desc The file descriptor
  * 
- * @param line      The #Line to update
- * @param old_key   The old key to flush
+ * @return          The index of the file (-1 if it is not among them)
  */
-void updateCacheLine(Line line, Key old_key) {
-    if (!line->loaded || line->altered) {
-        pthread_mutex_lock(&line->mutex);
+static int getSnapshotFile(FILE* files[], int file_num, int file_desc) {
+    for (int i = 0; i < file_num; i++)
+        if (files[i] != NULL && fileno(files[i]) == file_desc)
+            return i;
+    return -1;
+}
 
-        if (line->altered) {
-            ssize_t write = pwrite(line->key.file_desc, line->data, CACHE_LINE_SIZE, line->key.pos);
-        
-            if (write == -1)
-                fprintf(stderr, "updateCacheLine: error writing to file (file descriptor: %d)\n", line->key.file_desc);
-        
-            line->altered = false;
-        }
+/**
+ * @brief       Compares two #PREFETCH by file descriptor and position. Used to merge the ranges of a snapshot
+ * 
+ * @param a     The first #PREFETCH
+ * @param b     The second #PREFETCH
+ * 
+ * @return      The result of the comparison
+ */
+static int comparePrefetchPos(gconstpointer a, gconstpointer b) {
+    const PREFETCH *p1 = a, *p2 = b;
 
-        if (!line->loaded) {
-            ssize_t read = pread(line->key.file_desc, line->data, CACHE_LINE_SIZE, line->key.pos);
+    if (p1->file_desc != p2->file_desc)
+        return p1->file_desc < p2->file_desc ? -1 : 1;
 
-            if (read == -1)
-                fprintf(stderr, "updateCacheLine: error reading file (file descriptor: %d)\n", line->key.file_desc);
-            else if (read < CACHE_LINE_SIZE)    //End of file
-                line->data[read] = '\0';
+    return p1->from < p2->from ? -1 : (p1->from > p2->from);
+}
 
-            line->loaded = true;
+/**
+ * @brief           Writes to a file where the hottest data of the given files is: the keys of up to
+ *                  @ref CACHE_SNAPSHOT_LINES #Line of each #Pool, the most recently used of each #Shard first, and the
+ *                  pages in memory of the mapped files (see @ref mapCacheFile). @ref loadCacheSnapshot loads them back
+ * 
+ *                  Files are told apart by their index in the given files, so the snapshot is loaded with the same files
+ * 
+ * @param c         The given #Cache
+ * @param path      The path to the snapshot file
+ * @param files     The files whose data is kept (a NULL file is skipped)
+ * @param file_num  The number of files
+ * @param tag       What identifies the contents of the files (at most @ref CACHE_SNAPSHOT_TAG_SIZE - 1 characters kept)
+ * 
+ * @return          Whether or not the snapshot was written
+ */
+bool saveCacheSnapshot(Cache c, char* path, FILE* files[], int file_num, char* tag) {
+    GArray* ranges = g_array_new(FALSE, FALSE, sizeof(SNAPSHOTRANGE));
+
+    for (int p = 0; p < c->pool_num; p++) {
+        Pool pool = c->pools + p;
+        GArray* shards[pool->shard_num];
+        int longest = 0;
+
+        for (int s = 0; s < pool->shard_num; s++) {
+            Shard shard = pool->shards + s;
+            shards[s] = g_array_new(FALSE, FALSE, sizeof(SNAPSHOTRANGE));
+
+            pthread_mutex_lock(&shard->mutex);
+            for (int q = QUEUE_MAIN; q <= QUEUE_IN; q++)
+                for (Line l = shard->first[q]; l != NULL; l = l->next) {
+                    int file = getSnapshotFile(files, file_num, l->key.file_desc);
+
+                    if (file != -1 && isLoaded(l) && l->length > 0) {
+                        SNAPSHOTRANGE r = { .file = file, .hot = q == QUEUE_MAIN, .from = l->key.pos,
+                                            .to = l->key.pos + (pos_t)pool->line_size };
+                        g_array_append_val(shards[s], r);
+                    }
+                }
+            pthread_mutex_unlock(&shard->mutex);
+
+            longest = MAX(longest, (int)shards[s]->len);
         }
 
-        pthread_mutex_unlock(&line->mutex);
+        //The shards are not ordered among themselves, so the hottest lines are taken from each in turn
+        int taken = 0;
+        for (int i = 0; i < longest && taken < CACHE_SNAPSHOT_LINES; i++)
+            for (int s = 0; s < pool->shard_num && taken < CACHE_SNAPSHOT_LINES; s++)
+                if (i < (int)shards[s]->len) {
+                    g_array_append_val(ranges, g_array_index(shards[s], SNAPSHOTRANGE, i));
+                    taken++;
+                }
+
+        for (int s = 0; s < pool->shard_num; s++)
+            g_array_free(shards[s], TRUE);
+    }
+
+    //The pages of the mapped files are kept as runs, since the kernel may drop them by the next run
+    long page_size = sysconf(_SC_PAGESIZE);
+    for (int f = 0, taken = 0; f < file_num && taken < CACHE_SNAPSHOT_LINES; f++) {
+        pos_t size;
+        char* map = files[f] == NULL ? NULL : getMapping(c, fileno(files[f]), &size);
+        if (map == NULL)
+            continue;
+
+        size_t pages = (size + page_size - 1) / page_size;
+        unsigned char* resident = malloc(pages);
+
+        if (mincore(map, size, resident) == 0)
+            for (size_t i = 0, j; i < pages && taken < CACHE_SNAPSHOT_LINES; i = j) {
+                for (j = i; j < pages && (resident[j] & 1); j++);
+
+                if (j > i) {
+                    SNAPSHOTRANGE r = { .file = f, .hot = false, .from = (pos_t)i * page_size,
+                                        .to = MIN(size, (pos_t)j * page_size) };
+                    g_array_append_val(ranges, r);
+                    taken++;
+                } else
+                    j++;
+            }
+
+        free(resident);
     }
+
+    SNAPSHOTHEADER header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.tag, tag, CACHE_SNAPSHOT_TAG_SIZE - 1);
+    header.range_num = ranges->len;
+
+    //Written aside and renamed, so a snapshot is never read half written
+    char* tmp = malloc(strlen(path) + 5);
+    if (tmp == NULL) {
+        fprintf(stderr, "saveCacheSnapshot: error allocating the path of file '%s'\n", path);
+        g_array_free(ranges, TRUE);
+        return false;
+    }
+    sprintf(tmp, "%s.tmp", path);
+    FILE* out = fopen(tmp, "wb");
+    bool ok = out != NULL;
+
+    if (!ok)
+        fprintf(stderr, "saveCacheSnapshot: could not open file '%s'\n", tmp);
+    else {
+        ok = fwrite(&header, sizeof(header), 1, out) == 1
+          && fwrite(ranges->data, sizeof(SNAPSHOTRANGE), ranges->len, out) == ranges->len;
+        ok = fclose(out) == 0 && ok && rename(tmp, path) == 0;
+
+        if (!ok)
+            unlink(tmp);
+    }
+
+    free(tmp);
+    g_array_free(ranges, TRUE);
+    return ok;
 }
 
 /**
- * @brief           Searches the #Cache for a #Key matching the given file descriptor and position.
- *                  The given position may be bigger than the file's size
+ * @brief           Loads back the data kept by @ref saveCacheSnapshot in the background: the prefetcher reads the
+ *                  #Line when no @ref prefetchRange request is pending, merging neighbouring lines into vectored reads,
+ *                  and the kernel is asked to read the pages of mapped files ahead. At most half of each #Pool is
+ *                  loaded, so the lines loaded never evict each other
  * 
  * @param c         The given #Cache
- * @param file_desc The given file descriptor
- * @param pos       The given position in the file
+ * @param path      The path to the snapshot file
+ * @param files     The files given to @ref saveCacheSnapshot, in the same order (opened again)
+ * @param file_num  The number of files
+ * @param tag       What identifies the contents of the files. A snapshot with another tag is stale, and ignored
  * 
- * @return NULL     If there is no such #Line
- * @return Line     The requested #Line
+ * @return          Whether or not the snapshot was loaded (false if it does not exist or is stale)
  */
-Line getCacheLine(Cache c, int file_desc, pos_t pos) {
-    //TODO: make small caches not fail miserably with multi-threading
+bool loadCacheSnapshot(Cache c, char* path, FILE* files[], int file_num, char* tag) {
+    FILE* in = fopen(path, "rb");
+    if (in == NULL)
+        return false;
+
+    SNAPSHOTHEADER header;
+    bool ok = fread(&header, sizeof(header), 1, in) == 1 && header.range_num >= 0
+           && strncmp(header.tag, tag, CACHE_SNAPSHOT_TAG_SIZE - 1) == 0;
+    SNAPSHOTRANGE* ranges = ok ? malloc(header.range_num * sizeof(SNAPSHOTRANGE) + 1) : NULL;
+    ok = ok && fread(ranges, sizeof(SNAPSHOTRANGE), header.range_num, in) == (size_t)header.range_num;
+    fclose(in);
+
+    if (!ok) {
+        free(ranges);
+        return false;
+    }
 
-    Line l;
-    KEY key = (KEY){ .file_desc = file_desc, .pos = pos - pos % (pos_t)CACHE_LINE_SIZE };
-    KEY old_key;
-
-    pthread_mutex_lock(&c->mutex);
-
-    gpointer search = g_hash_table_lookup(c->posLinePairs, (gpointer)&key);
-
-    if (search != NULL) { //Hit 
-        c->hits++;
-        l = (Line)search;
-    } else { //Miss
-        c->misses++;
-        l = c->last;
-        if (l->loaded)
-            g_hash_table_remove(c->posLinePairs, (gpointer)&l->key);
-        old_key = l->key;
-        l->key = key;
-        l->loaded = false;
-        l->altered = false;
-        g_hash_table_insert(c->posLinePairs, (gpointer)&l->key, (gpointer)l);
-    }
-
-    if (l != c->first) {
-        //Place l at the beginning of the queue (most recently accessed)
-        if (l == c->last)
-            c->last = l->prev;     
-        else
-            l->next->prev = l->prev;
+    GArray* warm = g_array_new(FALSE, FALSE, sizeof(PREFETCH));
+    long page_size = sysconf(_SC_PAGESIZE);
+    int left[CACHE_MAX_POOLS];
+    for (int p = 0; p < c->pool_num; p++)
+        left[p] = c->pools[p].line_num / 2;
+
+    for (int i = 0; i < header.range_num; i++) {
+        SNAPSHOTRANGE r = ranges[i];
+        if (r.file < 0 || r.file >= file_num || files[r.file] == NULL || r.from >= r.to)
+            continue;
+
+        int file_desc = fileno(files[r.file]);
+        pos_t size;
+        char* map = getMapping(c, file_desc, &size);
+
+        if (map != NULL) {
+            pos_t from = r.from - r.from % page_size, to = MIN(r.to, size);
+            if (from < to)
+                madvise(map + from, to - from, MADV_WILLNEED);
+            continue;
+        }
 
-        l->prev->next = l->next;
-        l->next = c->first;
-        c->first->prev = l;
-        c->first = l;
-        l->prev = NULL;
+        //The ranges come the hottest first, so the coldest are the ones left out
+        Pool p = getPool(c, file_desc);
+        pos_t from = r.from - r.from % (pos_t)p->line_size;
+        int lines = (r.to - from + p->line_size - 1) / p->line_size;
+        if (left[p - c->pools] < lines)
+            continue;
+        left[p - c->pools] -= lines;
+
+        PREFETCH w = { .file_desc = file_desc, .from = from, .to = r.to, .hot = r.hot };
+        g_array_append_val(warm, w);
     }
+    free(ranges);
 
-    pthread_mutex_unlock(&c->mutex);
-    updateCacheLine(l, &old_key);
-    return l;
+    g_array_sort(warm, comparePrefetchPos);
+    int n = 0;
+    for (int i = 0; i < (int)warm->len; i++) {
+        PREFETCH w = g_array_index(warm, PREFETCH, i);
+        PREFETCH* last = n > 0 ? &g_array_index(warm, PREFETCH, n - 1) : NULL;
+
+        if (last != NULL && last->file_desc == w.file_desc && last->hot == w.hot && last->to >= w.from)
+            last->to = MAX(last->to, w.to);
+        else
+            g_array_index(warm, PREFETCH, n++) = w;
+    }
+
+    //The ranges are taken from the end, so they are queued in reverse order
+    pthread_mutex_lock(&c->prefetch_mutex);
+    for (int i = n - 1; i >= 0; i--)
+        g_array_append_val(c->warm, g_array_index(warm, PREFETCH, i));
+    pthread_cond_signal(&c->prefetch_cond);
+    pthread_mutex_unlock(&c->prefetch_mutex);
+
+    g_array_free(warm, TRUE);
+    return true;
 }
 
 /**
@@ -247,20 +1577,44 @@ Line getCacheLine(Cache c, int file_desc, pos_t pos) {
  * @return          The number of written characters
  */
 int getLine(Cache c, FILE* file, pos_t pos, char buffer[], int max_write) {
+    pos_t size;
+    char* map = getMapping(c, fileno(file), &size);
+
+    if (map != NULL) {
+        int i;
+        char* str = map + pos;
+
+        for (i = 0; i < max_write && pos + i < size && str[i] != '\n' && str[i] != '\0'; i++)
+            buffer[i] = str[i];
+
+        if (i < max_write) {
+            if (i > 0 && buffer[i-1] == '\r' && pos + i < size && str[i] == '\n')
+                buffer[i-1] = '\0';
+            else
+                buffer[i++] = '\0';
+        }
+
+        return i;
+    }
+
     Line l = getCacheLine(c, fileno(file), pos);
 
     if (l == NULL)
         return 0;
     
-    int line_pos = pos % (pos_t)CACHE_LINE_SIZE, str_len = CACHE_LINE_SIZE - line_pos, i;
+    int line_pos = pos % (pos_t)l->size, str_len = l->size - line_pos, i;
     char* str = l->data + line_pos;
 
     for (i = 0; *str != '\n' && *str != '\0' && i < str_len && i < max_write; i++)
         buffer[i] = *(str++);
 
-    if (i < str_len && *str == '\n' && buffer[i-1] == '\r')
+    bool end = i < str_len && (*str == '\n' || *str == '\0');
+    bool newline = i < str_len && *str == '\n';
+    releaseLine(l);
+
+    if (newline && buffer[i-1] == '\r')
             buffer[i-1] = '\0';
-    else if (i < max_write && i < str_len && (*str == '\n' || *str == '\0'))
+    else if (i < max_write && end)
             buffer[i++] = '\0';
     else if (i < max_write && i == str_len && buffer[i-1] != '\n' && buffer[i-1] != '\0')
         return i + getLine(c, file, pos + (pos_t)str_len, buffer + str_len, max_write - str_len);
@@ -285,20 +1639,37 @@ int getLine(Cache c, FILE* file, pos_t pos, char buffer[], int max_write) {
  * @return              The number of written bytes 
  */
 int getStr(Cache c, FILE* file, pos_t pos, char buffer[], int max_write) {
-    Line l = getCacheLine(c, fileno(file), pos);
+    pos_t size;
+    char* map = getMapping(c, fileno(file), &size);
 
-    if (l == NULL)
-        return 0;
+    if (map != NULL) {
+        int write = pos >= size ? 0 : (int)MIN((pos_t)max_write, size - pos);
+        memcpy(buffer, map + pos, write);
 
-    int line_pos = pos % (pos_t)CACHE_LINE_SIZE, str_len = CACHE_LINE_SIZE - line_pos, write = MIN(str_len, max_write);
-    char* str = l->data + line_pos;
+        if (write < max_write)
+            buffer[write] = '\0';
+
+        return max_write;
+    }
+
+    int file_desc = fileno(file), written = 0;
+    Pool p = getPool(c, file_desc);
+
+    if (pos % (pos_t)p->line_size + (pos_t)max_write > (pos_t)p->line_size)
+        loadRange(c, p, file_desc, pos, pos + (pos_t)max_write, false);
+
+    while (written < max_write) {
+        Line l = getCacheLine(c, file_desc, pos);
 
-    memcpy(buffer, str, write);
+        int line_pos = pos % (pos_t)l->size, write = MIN(l->size - line_pos, max_write - written);
+        memcpy(buffer + written, l->data + line_pos, write);
+        releaseLine(l);
 
-    if (write < max_write)
-        return write + getStr(c, file, pos + (pos_t)str_len, buffer + str_len, max_write - str_len);
+        written += write;
+        pos += (pos_t)write;
+    }
 
-    return write;
+    return written;
 }
 
 /**
@@ -343,6 +1714,11 @@ pos_t getPosT(Cache c, FILE* file, pos_t pos) {
  */
 void setStr(Cache c, FILE* file, pos_t pos, char buffer[], int write)
 {
+    if (getMapping(c, fileno(file), &(pos_t){0}) != NULL) {
+        fprintf(stderr, "setStr: cannot write to a mapped file (file descriptor: %d)\n", fileno(file));
+        return;
+    }
+
     Line l = getCacheLine(c, fileno(file), pos);
 
     if (l == NULL) {
@@ -350,29 +1726,122 @@ void setStr(Cache c, FILE* file, pos_t pos, char buffer[], int write)
         return;
     }
 
-    l->altered = true;
-    int line_pos = pos % (pos_t)CACHE_LINE_SIZE, str_len = CACHE_LINE_SIZE - line_pos, write_cur = MIN(str_len, write);
+    int line_pos = pos % (pos_t)l->size, str_len = l->size - line_pos, write_cur = MIN(str_len, write);
     char* str = l->data + line_pos;
 
     memcpy(str, buffer, write_cur);
 
+    //Marked after the copy: a flush running meanwhile either writes the new data or leaves the line listed
+    pthread_mutex_lock(&l->shard->mutex);
+    l->length = MAX(l->length, line_pos + write_cur);
+    l->altered = true;
+    listDirty(l);
+    pthread_mutex_unlock(&l->shard->mutex);
+    releaseLine(l);
+
     if (write_cur < write)
         setStr(c, file, pos + (pos_t)str_len, buffer + str_len, write - str_len);
 }
 
 /**
- * @brief       Auxiliary function to @ref flushCacheFile
+ * @brief       Compares two #DIRTYLINE by file descriptor and position. Used to sort the altered lines
  * 
- *              Checks if a #Line has the altered flag
+ * @param a     The first #DIRTYLINE
+ * @param b     The second #DIRTYLINE
  * 
- * @param key   The #Key
- * @param line  The #Line
- * @param file  The file descriptor
- * @return      Whether or not the #Line referes the given file
+ * @return      The result of the comparison
  */
-void flushFileAux(gpointer key, gpointer line, gpointer file) {
-    if (((Key)key)->file_desc == GPOINTER_TO_INT(file))
-        updateCacheLine((Line)line, (Key)key);
+static int compareLinePos(gconstpointer a, gconstpointer b) {
+    Line l1 = ((DIRTYLINE*)a)->line, l2 = ((DIRTYLINE*)b)->line;
+
+    if (l1->key.file_desc != l2->key.file_desc)
+        return l1->key.file_desc < l2->key.file_desc ? -1 : 1;
+
+    return l1->key.pos < l2->key.pos ? -1 : (l1->key.pos > l2->key.pos);
+}
+
+/**
+ * @brief           Writes back the altered #Line of a #Pool. The lines are sorted by position, and each
+ *                  run of consecutive lines is written with a single vectored write
+ * 
+ *                  The lines are taken one #Shard at a time and pinned, so they are not evicted while written. The
+ *                  writes hold no mutex of a #Shard: a line altered meanwhile is listed again, and written by the next
+ *                  write-back. Lines not fully written are listed again as well
+ * 
+ * @param p         The #Pool
+ * @param file_desc The file descriptor of the file to flush (-1 to flush all files)
+ */
+static void writeDirty(Pool p, int file_desc) {
+    GArray* lines = g_array_new(FALSE, FALSE, sizeof(DIRTYLINE));
+    struct iovec iov[MAX_RANGE_LINES];
+
+    //A write-back running meanwhile could write a line altered since this one took it, and be overwritten by this one
+    pthread_mutex_lock(&p->flush_mutex);
+
+    for (int s = 0; s < p->shard_num; s++) {
+        Shard shard = p->shards + s;
+        lockCacheMutex(&shard->mutex);
+
+        for (int i = (int)shard->dirty->len - 1; i >= 0; i--) {
+            Line l = g_array_index(shard->dirty, Line, i);
+
+            if (file_desc == -1 || l->key.file_desc == file_desc) {
+                unlistDirty(l);
+                l->pins++;
+                l->altered = false;
+                g_array_append_val(lines, ((DIRTYLINE){ .line = l, .length = l->length }));
+            }
+        }
+
+        pthread_mutex_unlock(&shard->mutex);
+    }
+
+    g_array_sort(lines, compareLinePos);
+
+    for (int i = 0, len; i < (int)lines->len; i += len) {
+        DIRTYLINE* run = &g_array_index(lines, DIRTYLINE, i);
+        Line first = run[0].line;
+        size_t total = 0;
+        len = 0;
+
+        do {
+            iov[len] = (struct iovec){ .iov_base = run[len].line->data, .iov_len = run[len].length };
+            total += run[len].length;
+            len++;
+        } while (i + len < (int)lines->len && len < MAX_RANGE_LINES && run[len-1].length == run[len-1].line->size
+                 && run[len].line->key.file_desc == run[len-1].line->key.file_desc
+                 && run[len].line->key.pos == run[len-1].line->key.pos + run[len-1].line->size);
+
+        long start = METRICS_TIME();
+        ssize_t write = pwritev(first->key.file_desc, iov, len, first->key.pos);
+        countCacheIo(true, write, start);
+
+        if (write < (ssize_t)total)
+            fprintf(stderr, "writeDirty: error writing to file (file descriptor: %d, %zd of %zu bytes written)\n",
+                    first->key.file_desc, write, total);
+
+        for (int k = 0, end = 0; k < len; k++) {
+            Line l = run[k].line;
+            end += run[k].length;
+            bool written = write >= (ssize_t)end;
+
+            lockCacheMutex(&l->shard->mutex);
+            l->shard->writes += k == 0;
+            l->shard->written_lines += written;
+
+            if (!written) {
+                l->altered = true;
+                listDirty(l);
+            }
+
+            if (--l->pins == 0)
+                pthread_cond_broadcast(&l->shard->unpinned);
+            pthread_mutex_unlock(&l->shard->mutex);
+        }
+    }
+
+    pthread_mutex_unlock(&p->flush_mutex);
+    g_array_free(lines, TRUE);
 }
 
 /**
@@ -382,32 +1851,71 @@ void flushFileAux(gpointer key, gpointer line, gpointer file) {
  * @param file  The specified file
  */
 void flushCacheFile(Cache c, FILE* file) {
-    pthread_mutex_lock(&c->mutex);
-    g_hash_table_foreach(c->posLinePairs, flushFileAux, file);
-    pthread_mutex_unlock(&c->mutex);
+    for (int p = 0; p < c->pool_num; p++)
+        writeDirty(c->pools + p, fileno(file));
 }
 
 /**
- * @brief       Auxiliary function to @ref flushCache
- *              Flushes the given #Cache line
+ * @brief   Writes all altered #Line to their files
  * 
- * @param key   The #Key
- * @param line  The #Line
- * @param null  Is always NULL. Required by g_hash_table_foreach
+ * @param c The #Cache
  */
-void flushAux(gpointer key, gpointer line, gpointer null) {
-    updateCacheLine((Line)line, (Key)key);
+void flushCache(Cache c) {
+    for (int p = 0; p < c->pool_num; p++)
+        writeDirty(c->pools + p, -1);
 }
 
 /**
- * @brief   Writes all altered #Line to their files
+ * @brief           The routine of the flusher thread of a #Cache.
+ *                  Writes back the altered lines periodically until the #Cache is freed
  * 
- * @param c The #Cache
+ * @param cache     The #Cache
+ * 
+ * @return          Always NULL
  */
-void flushCache(Cache c) {
-    pthread_mutex_lock(&c->mutex);
-    g_hash_table_foreach(c->posLinePairs, flushAux, NULL);
-    pthread_mutex_unlock(&c->mutex);
+static void* flusherRoutine(void* cache) {
+    Cache c = (Cache)cache;
+    pthread_mutex_lock(&c->flusher_mutex);
+
+    while (!c->flusher_stop) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_sec += c->flush_interval / 1000;
+        until.tv_nsec += (c->flush_interval % 1000) * 1000000L;
+
+        if (until.tv_nsec >= 1000000000L) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+
+        pthread_cond_timedwait(&c->flusher_cond, &c->flusher_mutex, &until);
+
+        if (!c->flusher_stop) {
+            pthread_mutex_unlock(&c->flusher_mutex);
+            flushCache(c);
+            pthread_mutex_lock(&c->flusher_mutex);
+        }
+    }
+
+    pthread_mutex_unlock(&c->flusher_mutex);
+    return NULL;
+}
+
+/**
+ * @brief           Starts a thread writing back the altered #Line of the #Cache every given number of
+ *                  milliseconds, so that writes overlap with the work of the program instead of piling up
+ *                  until the lines are evicted or flushed. Has no effect if the thread is already running
+ * 
+ * @param c         The given #Cache
+ * @param interval  The time between two write-backs (in milliseconds)
+ */
+void startCacheFlusher(Cache c, int interval) {
+    if (c->flusher_running || interval <= 0)
+        return;
+
+    c->flush_interval = interval;
+    c->flusher_running = true;
+    pthread_create(&c->flusher, NULL, flusherRoutine, c);
 }
 
 /**
@@ -421,7 +1929,14 @@ void flushCache(Cache c) {
  * @return      Whether or not the #Line referes the given file
  */
 gboolean refreshFileAux(gpointer key, gpointer line, gpointer file) {
-    return ((Key)key)->file_desc == GPOINTER_TO_INT(file);
+    if (((Key)key)->file_desc == GPOINTER_TO_INT(file)) {
+        unlistDirty((Line)line);
+        ((Line)line)->loaded = false;
+        ((Line)line)->altered = false;
+        return true;
+    }
+
+    return false;
 }
 
 /**
@@ -432,9 +1947,28 @@ gboolean refreshFileAux(gpointer key, gpointer line, gpointer file) {
  * @param file  The given file
  */
 void refreshCacheFile(Cache c, FILE* file) {
-    pthread_mutex_lock(&c->mutex);
-    g_hash_table_foreach_remove(c->posLinePairs, refreshFileAux, GINT_TO_POINTER(fileno(file)));
-    pthread_mutex_unlock(&c->mutex);
+    FOR_EACH_SHARD(c, shard) {
+        pthread_mutex_lock(&shard->mutex);
+        g_hash_table_foreach_remove(shard->posLinePairs, refreshFileAux, GINT_TO_POINTER(fileno(file)));
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+/**
+ * @brief       Auxiliary function to @ref refreshCache
+ * 
+ *              Marks the #Line as empty, discarding any pending writes
+ * 
+ * @param key   The #Key
+ * @param line  The #Line
+ * @param null  Is always NULL. Required by g_hash_table_foreach_remove
+ * @return      Always true
+ */
+gboolean refreshAux(gpointer key, gpointer line, gpointer null) {
+    unlistDirty((Line)line);
+    ((Line)line)->loaded = false;
+    ((Line)line)->altered = false;
+    return true;
 }
 
 /**
@@ -443,9 +1977,11 @@ void refreshCacheFile(Cache c, FILE* file) {
  * @param c The #Cache
  */
 void refreshCache(Cache c) {
-    pthread_mutex_lock(&c->mutex);
-    g_hash_table_remove_all(c->posLinePairs);
-    pthread_mutex_unlock(&c->mutex);
+    FOR_EACH_SHARD(c, shard) {
+        pthread_mutex_lock(&shard->mutex);
+        g_hash_table_foreach_remove(shard->posLinePairs, refreshAux, NULL);
+        pthread_mutex_unlock(&shard->mutex);
+    }
 }
 
 /**
@@ -460,7 +1996,9 @@ void refreshCache(Cache c) {
  */
 gboolean clearFileAux(gpointer key, gpointer line, gpointer file) {
     if (((Key)key)->file_desc == GPOINTER_TO_INT(file)) {
+        unlistDirty((Line)line);
         updateCacheLine((Line)line, (Key)key);
+        ((Line)line)->loaded = false;
         return true;
     }
 
@@ -473,9 +2011,30 @@ gboolean clearFileAux(gpointer key, gpointer line, gpointer file) {
  * @param c The given #Cache
  */
 void clearCacheFile(Cache c, FILE* file) {
-    pthread_mutex_lock(&c->mutex);
-    g_hash_table_foreach_remove(c->posLinePairs, clearFileAux, GINT_TO_POINTER(fileno(file)));
-    pthread_mutex_unlock(&c->mutex);
+    flushCacheFile(c, file);
+
+    FOR_EACH_SHARD(c, shard) {
+        pthread_mutex_lock(&shard->mutex);
+        g_hash_table_foreach_remove(shard->posLinePairs, clearFileAux, GINT_TO_POINTER(fileno(file)));
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+/**
+ * @brief       Auxiliary function to @ref clearCache
+ * 
+ *              Flushes the #Line and marks it as empty
+ * 
+ * @param key   The #Key
+ * @param line  The #Line
+ * @param null  Is always NULL. Required by g_hash_table_foreach_remove
+ * @return      Always true
+ */
+gboolean clearAux(gpointer key, gpointer line, gpointer null) {
+    unlistDirty((Line)line);
+    updateCacheLine((Line)line, (Key)key);
+    ((Line)line)->loaded = false;
+    return true;
 }
 
 /**
@@ -484,10 +2043,30 @@ void clearCacheFile(Cache c, FILE* file) {
  * @param c The given #Cache
  */
 void clearCache(Cache c) {
-    pthread_mutex_lock(&c->mutex);
-    g_hash_table_foreach(c->posLinePairs, flushAux, NULL);
-    g_hash_table_remove_all(c->posLinePairs);
-    pthread_mutex_unlock(&c->mutex);
+    flushCache(c);
+
+    FOR_EACH_SHARD(c, shard) {
+        pthread_mutex_lock(&shard->mutex);
+        g_hash_table_foreach_remove(shard->posLinePairs, clearAux, NULL);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+}
+
+/**
+ * @brief           Gets the number of hits and misses of the lines of a #Cache so far (reads of mapped files are
+ *                  neither). The counts are read without locking the shards, so they are approximate while it is used
+ * 
+ * @param c         The given #Cache
+ * @param hits      Where to store the number of hits
+ * @param misses    Where to store the number of misses
+ */
+void getCacheStatistics(Cache c, long* hits, long* misses) {
+    *hits = *misses = 0;
+
+    FOR_EACH_SHARD(c, shard) {
+        *hits += shard->hits;
+        *misses += shard->misses;
+    }
 }
 
 /**
@@ -496,22 +2075,97 @@ void clearCache(Cache c) {
  * @param c The given #Cache
  */
 void freeCache(Cache c) {
+    pthread_mutex_lock(&c->prefetch_mutex);
+    c->prefetch_stop = true;
+    pthread_cond_signal(&c->prefetch_cond);
+    pthread_mutex_unlock(&c->prefetch_mutex);
+    pthread_join(c->prefetcher, NULL);
+
+    pthread_mutex_destroy(&c->prefetch_mutex);
+    pthread_cond_destroy(&c->prefetch_cond);
+    pthread_cond_destroy(&c->prefetch_done);
+    g_array_free(c->warm, TRUE);
+
+    if (c->flusher_running) {
+        pthread_mutex_lock(&c->flusher_mutex);
+        c->flusher_stop = true;
+        pthread_cond_signal(&c->flusher_cond);
+        pthread_mutex_unlock(&c->flusher_mutex);
+        pthread_join(c->flusher, NULL);
+    }
 
-    DEBUG_PRINT("Cache line size: %d bytes\n", CACHE_LINE_SIZE);
-    DEBUG_PRINT("Cache usage: %d/%d cache lines\n", g_hash_table_size(c->posLinePairs), c->line_num);
-    DEBUG_PRINT("Cache hits: %ld\n", c->hits);
-    DEBUG_PRINT("Cache misses: %ld\n", c->misses);
+    pthread_mutex_destroy(&c->flusher_mutex);
+    pthread_cond_destroy(&c->flusher_cond);
 
     flushCache(c);
 
-    for (int i = 0; i < c->line_num; i++)
-        pthread_mutex_destroy(&c->lines[i]->mutex);
+    for (int p = 0; p < c->pool_num; p++) {
+        Pool pool = c->pools + p;
+        long hits = 0, misses = 0, ghost_hits = 0, writes = 0, written_lines = 0;
+        int used = 0;
+
+        for (int s = 0; s < pool->shard_num; s++) {
+            hits += pool->shards[s].hits;
+            misses += pool->shards[s].misses;
+            ghost_hits += pool->shards[s].ghost_hits;
+            writes += pool->shards[s].writes;
+            written_lines += pool->shards[s].written_lines;
+            used += g_hash_table_size(pool->shards[s].posLinePairs);
+        }
+
+        DEBUG_PRINT("Cache line size: %d bytes\n", pool->line_size);
+        DEBUG_PRINT("Cache shards: %d\n", pool->shard_num);
+        DEBUG_PRINT("Cache usage: %d/%d cache lines\n", used, pool->line_num);
+        DEBUG_PRINT("Cache policy: %s\n", c->policy == CACHE_2Q ? "2Q" : "LRU");
+        DEBUG_PRINT("Cache hits: %ld\n", hits);
+        DEBUG_PRINT("Cache misses: %ld\n", misses);
+
+        if (c->policy == CACHE_2Q)
+            DEBUG_PRINT("Cache ghost hits: %ld\n", ghost_hits);
+
+        DEBUG_PRINT("Cache write-backs: %ld lines in %ld writes\n", written_lines, writes);
+    }
+
+    for (int p = 0; p < c->pool_num; p++) {
+        Pool pool = c->pools + p;
 
-    free(c->lines[0]->data);    //all lines are malloc'd together, so one free frees them all
-    free(c->lines[0]);          //same here
-    free(c->lines);
+        //The lines of each block are allocated together, so one free frees them all
+        for (int b = 0; b < pool->blocks->len; b++) {
+            Line block = g_array_index(pool->blocks, Line, b);
+            freeSlab(block->data, (size_t)pool->block_len * pool->line_size * sizeof(char));
+            free(block);
+        }
+        g_array_free(pool->blocks, TRUE);
+        pthread_mutex_destroy(&pool->block_mutex);
+        pthread_mutex_destroy(&pool->flush_mutex);
+
+        for (int s = 0; s < pool->shard_num; s++) {
+            pthread_mutex_destroy(&pool->shards[s].mutex);
+            pthread_cond_destroy(&pool->shards[s].unpinned);
+            for (int i = 0; i < CACHE_LINE_LOCKS; i++)
+                pthread_mutex_destroy(pool->shards[s].line_locks + i);
+            g_hash_table_destroy(pool->shards[s].posLinePairs);
+            g_array_free(pool->shards[s].dirty, TRUE);
+
+            if (pool->shards[s].ghostKeys != NULL) {
+                g_hash_table_destroy(pool->shards[s].ghostKeys);
+                free(pool->shards[s].ghosts);
+            }
+        }
+
+        free(pool->shards);
+    }
 
-    pthread_mutex_destroy(&c->mutex);
-    g_hash_table_destroy(c->posLinePairs);
+    for (int i = 0; i < CACHE_MAX_FILES / CACHE_FILE_CHUNK; i++) {
+        for (int j = 0; c->files[i] != NULL && j < CACHE_FILE_CHUNK; j++) {
+            if (c->files[i][j].map != NULL)
+                munmap(c->files[i][j].map, c->files[i][j].map_size);
+            if (c->files[i][j].direct != -1)
+                close(c->files[i][j].direct);
+        }
+        free(c->files[i]);
+    }
+
+    pthread_mutex_destroy(&c->files_mutex);
     free(c);
-}
\ No newline at end of file
+}
@@ -0,0 +1,187 @@
+/**
+ * @file columns.c
+ * 
+ * File containing the implementation of the #ColumnFile type
+ * 
+ * The file holds the number of columns and of rows (padded to @ref COLUMN_FILE_HEADER_SIZE bytes), followed by each
+ * column in turn. The whole file is mapped, so a column is handed out as a pointer into the mapping and scanning it
+ * is a loop over contiguous memory, with no copies nor decoding
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io/columns.h"
+
+/**
+ * @brief The header of a #ColumnFile
+ */
+typedef struct columnHeader {
+    int columns;    ///< The number of columns
+    int rows;       ///< The number of rows of each column
+} COLUMNHEADER;
+
+/**
+ * @brief Structure representing a #ColumnFile
+ */
+struct columnFile {
+    int file_desc;  ///< The file descriptor of the file
+    char* map;      ///< The memory mapping of the file
+    size_t size;    ///< The size of the file
+    int columns;    ///< The number of columns
+    int rows;       ///< The number of rows of each column
+};
+
+/**
+ * @brief           Gets the size of a #ColumnFile
+ * 
+ * @param columns   The number of columns
+ * @param rows      The number of rows of each column
+ * 
+ * @return          The size of the file
+ */
+static size_t getColumnFileSize(int columns, int rows) {
+    return COLUMN_FILE_HEADER_SIZE + (size_t)columns * (size_t)rows * sizeof(int);
+}
+
+/**
+ * @brief           Maps a #ColumnFile
+ * 
+ * @param file_desc The file descriptor of the file
+ * @param size      The size of the file
+ * @param prot      The protection of the mapping (PROT_READ, optionally with PROT_WRITE)
+ * 
+ * @return NULL     If the file could not be mapped (the file descriptor is closed)
+ * @return          The #ColumnFile (with the number of columns and of rows still to be set)
+ */
+static ColumnFile mapColumnFile(int file_desc, size_t size, int prot) {
+    char* map = mmap(NULL, size, prot, MAP_SHARED, file_desc, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "mapColumnFile: error mapping file (file descriptor: %d)\n", file_desc);
+        close(file_desc);
+        return NULL;
+    }
+
+    if (madvise(map, size, MADV_SEQUENTIAL) == -1)
+        fprintf(stderr, "mapColumnFile: ignored madvise hint (file descriptor: %d)\n", file_desc);
+
+    ColumnFile f = malloc(sizeof(struct columnFile));
+    f->file_desc = file_desc;
+    f->map = map;
+    f->size = size;
+    return f;
+}
+
+/**
+ * @brief           Creates a #ColumnFile (replacing the file if it exists), whose columns are then filled through
+ *                  @ref getColumn
+ * 
+ * @param path      The path to the file
+ * @param columns   The number of columns
+ * @param rows      The number of rows of each column
+ * 
+ * @return NULL     If the file could not be created
+ * @return          The #ColumnFile
+ */
+ColumnFile makeColumnFile(char* path, int columns, int rows) {
+    int file_desc = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    size_t size = getColumnFileSize(columns, rows);
+
+    if (file_desc == -1 || ftruncate(file_desc, size) == -1) {
+        fprintf(stderr, "makeColumnFile: could not create file '%s'\n", path);
+        if (file_desc != -1)
+            close(file_desc);
+        return NULL;
+    }
+
+    ColumnFile f = mapColumnFile(file_desc, size, PROT_READ | PROT_WRITE);
+    if (f != NULL) {
+        f->columns = columns;
+        f->rows = rows;
+        *(COLUMNHEADER*)f->map = (COLUMNHEADER){ .columns = columns, .rows = rows };
+    }
+    return f;
+}
+
+/**
+ * @brief           Opens a #ColumnFile written by @ref makeColumnFile, for reading
+ * 
+ * @param path      The path to the file
+ * 
+ * @return NULL     If the file does not exist or is not valid
+ * @return          The #ColumnFile
+ */
+ColumnFile openColumnFile(char* path) {
+    int file_desc = open(path, O_RDONLY);
+    if (file_desc == -1)
+        return NULL;
+
+    struct stat st;
+    COLUMNHEADER header;
+    if (fstat(file_desc, &st) == -1 || pread(file_desc, &header, sizeof(COLUMNHEADER), 0) != sizeof(COLUMNHEADER)
+        || header.columns < 0 || header.rows < 0 || (size_t)st.st_size != getColumnFileSize(header.columns, header.rows)) {
+        fprintf(stderr, "openColumnFile: invalid file '%s'\n", path);
+        close(file_desc);
+        return NULL;
+    }
+
+    ColumnFile f = mapColumnFile(file_desc, st.st_size, PROT_READ);
+    if (f != NULL) {
+        f->columns = header.columns;
+        f->rows = header.rows;
+    }
+    return f;
+}
+
+/**
+ * @brief           Gets a column of a #ColumnFile
+ * 
+ * @param f         The given #ColumnFile
+ * @param column    The position of the column
+ * 
+ * @return          The rows of the column (which may only be written to if the file was created by
+ *                  @ref makeColumnFile), valid until the #ColumnFile is freed
+ */
+int* getColumn(ColumnFile f, int column) {
+    return (int*)(f->map + COLUMN_FILE_HEADER_SIZE) + (size_t)column * f->rows;
+}
+
+/**
+ * @brief   Gets the number of rows of the columns of a #ColumnFile
+ * 
+ * @param f The given #ColumnFile
+ * 
+ * @return  The number of rows
+ */
+int getColumnFileRows(ColumnFile f) {
+    return f->rows;
+}
+
+/**
+ * @brief   Writes the columns of a #ColumnFile to disk
+ * 
+ * @param f The given #ColumnFile
+ * 
+ * @return  Whether or not the columns were written
+ */
+bool syncColumnFile(ColumnFile f) {
+    return msync(f->map, f->size, MS_SYNC) == 0;
+}
+
+/**
+ * @brief   Frees a #ColumnFile, unmapping and closing its file
+ * 
+ * @param f The given #ColumnFile
+ */
+void freeColumnFile(ColumnFile f) {
+    if (f == NULL)
+        return;
+
+    munmap(f->map, f->size);
+    close(f->file_desc);
+    free(f);
+}
@@ -0,0 +1,294 @@
+/**
+ * @file cursor.c
+ *
+ * File containing the implementation of the #Cursor type
+ *
+ * Each batch reads the lines of the index it covers at once (see @ref retrieveLines), then decodes the projected
+ * members of each record with at most two reads from the #Cache: one for the members of fixed width at fixed offsets
+ * (and the offset header, if the #Format has one), one for the others. The members are decoded into one array per
+ * member, the allocated ones (strings, lists and dates) from an #Arena reset by every batch
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io/cursor.h"
+#include "types/lazy.h"
+#include "utils/arena.h"
+#include "utils/metrics.h"
+
+/**
+ * @brief Structure representing a #Cursor
+ */
+struct cursor {
+    Indexer indexer;                    ///< The #Indexer scanned
+    FILE* values;                       ///< The file holding the records
+    Format format;                      ///< The #Format of the records
+    int next;                           ///< The position read by the next batch
+    int to;                             ///< The position after the last position of the range
+    int position;                       ///< The position of the first record of the current batch
+    int rows;                           ///< The number of records of the current batch
+
+    pos_t keys[CURSOR_BATCH_SIZE];      ///< The embedded keys of the records of the current batch
+    pos_t records[CURSOR_BATCH_SIZE];   ///< The position of each record of the current batch in the values file
+
+    int members;                        ///< The number of members projected
+    int* projection;                    ///< The members projected
+    char** columns;                     ///< The array of each member projected, holding it for every record of the batch
+    int* column_of;                     ///< The index of the array of each member of the #Format (-1 if not projected)
+
+    int fixed_from;                     ///< The offset of the first byte read for the members at fixed offsets
+    int fixed_to;                       ///< The offset after the last byte read for the members at fixed offsets
+    bool variable;                      ///< Whether some member projected is not of fixed width at a fixed offset
+    int* list_ends;                     ///< The offset header of the record being decoded
+    Lazy lazy;                          ///< Finds the members of the records that have no offset header (NULL if not needed)
+    void* obj;                          ///< The object wrapped by lazy
+    char* buffer;                       ///< The buffer the members not at fixed offsets are read to
+    int buffer_size;                    ///< The size of buffer
+
+    Arena arena;                        ///< The #Arena the allocated members of the current batch are allocated from
+};
+
+/**
+ * @brief           Checks whether a member of a #Format always has the same width and is at the same offset
+ *
+ * @param f         The given #Format
+ * @param member    The index of the member
+ *
+ * @return          Whether the member is read along with the others of fixed width
+ */
+static bool isFixedWidthMember(Format f, int member) {
+    return isFixedMember(f, member) && stringSize(getMemberType(f, member)) != 0;
+}
+
+/**
+ * @brief               Opens a #Cursor over a range of a sorted #Indexer whose values are positions of records
+ *
+ * @param i             The given #Indexer
+ * @param from          The first position of the range
+ * @param to            The position after the last position of the range
+ * @param format        The binary #Format of the records
+ * @param projection    The members decoded (copied)
+ * @param members       The number of members decoded
+ *
+ * @return NULL         If the values of the #Indexer are embedded or the #Format is not binary
+ * @return              The #Cursor, before its first batch
+ */
+Cursor openCursor(Indexer i, int from, int to, Format format, int* projection, int members) {
+    if (getValuesFile(i) == NULL || !isBinary(format)) {
+        fprintf(stderr, "openCursor: the values must be records of a binary format\n");
+        return NULL;
+    }
+
+    Cursor cur = malloc(sizeof(struct cursor));
+    cur->indexer = i;
+    cur->values = getValuesFile(i);
+    cur->format = copyFormat(format);
+    cur->next = MAX(from, 0);
+    cur->to = MIN(to, getElemNumber(i));
+    cur->position = cur->next;
+    cur->rows = 0;
+
+    cur->members = members;
+    cur->projection = malloc(members * sizeof(int));
+    cur->columns = malloc(members * sizeof(char*));
+    cur->column_of = malloc(getFormatMembers(format) * sizeof(int));
+    for (int m = 0; m < getFormatMembers(format); m++)
+        cur->column_of[m] = -1;
+
+    cur->fixed_from = INT_MAX;
+    cur->fixed_to = 0;
+    cur->variable = false;
+    for (int k = 0; k < members; k++) {
+        int m = projection[k];
+        cur->projection[k] = m;
+        cur->columns[k] = malloc(CURSOR_BATCH_SIZE * typeSize(getMemberType(format, m)));
+        cur->column_of[m] = k;
+
+        if (isFixedWidthMember(format, m)) {
+            cur->fixed_from = MIN(cur->fixed_from, getMemberOffset(format, m, NULL));
+            cur->fixed_to = MAX(cur->fixed_to, getMemberOffset(format, m, NULL) + stringSize(getMemberType(format, m)));
+        } else
+            cur->variable = true;
+    }
+    if (cur->fixed_to == 0)
+        cur->fixed_from = 0;
+
+    //The offset header is read along with the members at fixed offsets (it is before them)
+    if (cur->variable && hasOffsetHeader(format)) {
+        cur->fixed_from = 0;
+        cur->fixed_to = MAX(cur->fixed_to, getOffsetHeaderSize(format));
+    }
+
+    cur->list_ends = malloc(getOffsetHeaderSize(format) + sizeof(int));
+    cur->obj = NULL;
+    cur->lazy = NULL;
+    if (cur->variable && !hasOffsetHeader(format)) {
+        cur->obj = calloc(1, getFormatSize(format));
+        cur->lazy = makeLazy(cur->values, 0, format, cur->obj);
+    }
+    cur->buffer_size = 0;
+    cur->buffer = NULL;
+
+    cur->arena = makeArena(0);
+    return cur;
+}
+
+/**
+ * @brief       Decodes the members projected of a record of the current batch of a #Cursor
+ *
+ * @param cur   The given #Cursor
+ * @param row   The index of the record in the batch
+ * @param c     The #Cache
+ */
+static void decodeRecord(Cursor cur, int row, Cache c) {
+    Format f = cur->format;
+    pos_t pos = cur->records[row];
+    int fixed_size = cur->fixed_to - cur->fixed_from;
+    char fixed[fixed_size + 1];
+
+    if (fixed_size > 0)
+        getStr(c, cur->values, pos + cur->fixed_from, fixed, fixed_size);
+
+    for (int k = 0; k < cur->members; k++) {
+        int m = cur->projection[k];
+        FormatType type = getMemberType(f, m);
+        if (isFixedWidthMember(f, m))
+            readBinaryMember(type, fixed + getMemberOffset(f, m, NULL) - cur->fixed_from, stringSize(type),
+                             cur->columns[k] + row * typeSize(type), cur->arena);
+    }
+
+    if (!cur->variable)
+        return;
+
+    if (cur->lazy == NULL)
+        for (int j = 0; j * (int)sizeof(int) < getOffsetHeaderSize(f); j++)
+            cur->list_ends[j] = readIntFromBinaryString(fixed + j * sizeof(int));
+    else
+        setLazyAddress(cur->lazy, cur->values, pos);
+
+    int starts[cur->members], ends[cur->members], lo = -1, hi = 0;
+    for (int k = 0; k < cur->members; k++) {
+        int m = cur->projection[k];
+        if (isFixedWidthMember(f, m))
+            continue;
+
+        if (cur->lazy == NULL) {
+            starts[k] = getMemberOffset(f, m, cur->list_ends);
+            ends[k] = getMemberOffset(f, m + 1, cur->list_ends);
+        } else {
+            starts[k] = getPosOfLazyMember(cur->lazy, m, c) - pos;
+            ends[k] = getPosOfLazyMember(cur->lazy, m + 1, c) - pos;
+        }
+        lo = lo == -1 ? starts[k] : MIN(lo, starts[k]);
+        hi = MAX(hi, ends[k]);
+    }
+
+    if (hi - lo > cur->buffer_size) {
+        cur->buffer_size = MAX(hi - lo, cur->buffer_size * 2);
+        cur->buffer = realloc(cur->buffer, cur->buffer_size + 1);
+    }
+    if (hi > lo)
+        getStr(c, cur->values, pos + lo, cur->buffer, hi - lo);
+
+    for (int k = 0; k < cur->members; k++) {
+        int m = cur->projection[k];
+        FormatType type = getMemberType(f, m);
+        if (!isFixedWidthMember(f, m))
+            readBinaryMember(type, cur->buffer + starts[k] - lo, ends[k] - starts[k],
+                             cur->columns[k] + row * typeSize(type), cur->arena);
+    }
+}
+
+/**
+ * @brief       Moves a #Cursor to its next batch, decoding it (the members of the previous batch are discarded)
+ *
+ * @param cur   The given #Cursor
+ * @param c     The #Cache
+ *
+ * @return      The number of records of the batch (0 after the end of the range)
+ */
+int nextCursorBatch(Cursor cur, Cache c) {
+    resetArena(cur->arena);
+    cur->position = cur->next;
+    cur->rows = MIN(cur->to - cur->next, CURSOR_BATCH_SIZE);
+    if (cur->rows <= 0) {
+        cur->rows = 0;
+        return 0;
+    }
+
+    cur->rows = retrieveLines(cur->indexer, cur->next, cur->rows, cur->keys, cur->records, c);
+    for (int row = 0; row < cur->rows; row++)
+        decodeRecord(cur, row, c);
+
+    cur->next += cur->rows;
+    ADD_METRIC(METRIC_ROWS_SCANNED, cur->rows);
+    return cur->rows;
+}
+
+/**
+ * @brief       Gets the position in the #Indexer of the first record of the current batch of a #Cursor
+ *
+ * @param cur   The given #Cursor
+ *
+ * @return      The position
+ */
+int getCursorPosition(Cursor cur) {
+    return cur->position;
+}
+
+/**
+ * @brief       Gets the embedded keys of the records of the current batch of a #Cursor
+ *
+ * @param cur   The given #Cursor
+ *
+ * @return      The keys (owned by the #Cursor, valid until the next batch)
+ */
+pos_t* getCursorKeys(Cursor cur) {
+    return cur->keys;
+}
+
+/**
+ * @brief           Gets the values of a member projected for the records of the current batch of a #Cursor
+ *
+ * @param cur       The given #Cursor
+ * @param member    The index of the member in the #Format
+ *
+ * @return NULL     If the member is not projected
+ * @return          The array of the values of the member (as many as the records of the batch, of the type of the member,
+ *                  owned by the #Cursor and valid until the next batch)
+ */
+void* getCursorColumn(Cursor cur, int member) {
+    if (member < 0 || member >= getFormatMembers(cur->format) || cur->column_of[member] == -1) {
+        fprintf(stderr, "getCursorColumn: member %d is not projected\n", member);
+        return NULL;
+    }
+    return cur->columns[cur->column_of[member]];
+}
+
+/**
+ * @brief       Frees the memory allocated to a #Cursor
+ *
+ * @param cur   The given #Cursor
+ */
+void closeCursor(Cursor cur) {
+    if (cur == NULL)
+        return;
+
+    for (int k = 0; k < cur->members; k++)
+        free(cur->columns[k]);
+    free(cur->columns);
+    free(cur->projection);
+    free(cur->column_of);
+    free(cur->list_ends);
+    if (cur->lazy != NULL) {
+        freeLazy(cur->lazy);
+        free(cur->obj);
+    }
+    free(cur->buffer);
+    freeArena(cur->arena);
+    disposeFormat(cur->format);
+    free(cur);
+}
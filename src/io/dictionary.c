@@ -0,0 +1,170 @@
+/**
+ * @file dictionary.c
+ *
+ * File containing the implementation of the #Dictionary type
+ *
+ * The words are kept in an array, indexed by their id, and in a hash table from each word to its id plus one (so that
+ * a missing word, looked up as NULL, is told apart from the id 0). The file holds the number of words followed by each
+ * of them (its length and its characters), in the order of their ids
+ */
+
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io/dictionary.h"
+
+/**
+ * @brief Structure representing a #Dictionary
+ */
+struct dictionary {
+    GArray* words;      ///< The words, indexed by their id
+    GHashTable* ids;    ///< The id plus one of each word
+};
+
+/**
+ * @brief   Creates an empty #Dictionary
+ *
+ * @return  The #Dictionary
+ */
+Dictionary makeDictionary() {
+    Dictionary d = malloc(sizeof(struct dictionary));
+    d->words = g_array_new(FALSE, FALSE, sizeof(char*));
+    d->ids = g_hash_table_new(g_str_hash, g_str_equal);
+    return d;
+}
+
+/**
+ * @brief       Gets the id of a word of a #Dictionary, adding it (with the next id) if it is not there
+ *
+ * @param d     The given #Dictionary
+ * @param word  The word (copied if it is added)
+ *
+ * @return      The id of the word
+ */
+int addToDictionary(Dictionary d, char* word) {
+    int id = getDictionaryId(d, word);
+    if (id != -1)
+        return id;
+
+    char* copy = strdup(word);
+    id = d->words->len;
+    g_array_append_val(d->words, copy);
+    g_hash_table_insert(d->ids, copy, GINT_TO_POINTER(id + 1));
+    return id;
+}
+
+/**
+ * @brief       Gets the id of a word of a #Dictionary
+ *
+ * @param d     The given #Dictionary
+ * @param word  The word
+ *
+ * @return      The id of the word (-1 if it is not in the #Dictionary)
+ */
+int getDictionaryId(Dictionary d, char* word) {
+    return GPOINTER_TO_INT(g_hash_table_lookup(d->ids, word)) - 1;
+}
+
+/**
+ * @brief       Gets the word of an id of a #Dictionary
+ *
+ * @param d     The given #Dictionary
+ * @param id    The id
+ *
+ * @return      The word (owned by the #Dictionary), NULL if the id is not in use
+ */
+char* getDictionaryWord(Dictionary d, int id) {
+    return id < 0 || id >= (int)d->words->len ? NULL : g_array_index(d->words, char*, id);
+}
+
+/**
+ * @brief       Gets the number of words of a #Dictionary (so its ids are 0 up to that number, exclusive)
+ *
+ * @param d     The given #Dictionary
+ *
+ * @return      The number of words
+ */
+int getDictionarySize(Dictionary d) {
+    return d->words->len;
+}
+
+/**
+ * @brief       Writes a #Dictionary to a file
+ *
+ * @param d     The given #Dictionary
+ * @param path  The path to the file
+ *
+ * @return      Whether or not the #Dictionary was written
+ */
+bool saveDictionary(Dictionary d, char* path) {
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "saveDictionary: could not open file '%s'\n", path);
+        return false;
+    }
+
+    int size = getDictionarySize(d);
+    bool ok = fwrite(&size, sizeof(int), 1, f) == 1;
+    for (int i = 0; ok && i < size; i++) {
+        char* word = getDictionaryWord(d, i);
+        int len = strlen(word);
+        ok = fwrite(&len, sizeof(int), 1, f) == 1 && fwrite(word, sizeof(char), len, f) == (size_t)len;
+    }
+
+    fclose(f);
+    return ok;
+}
+
+/**
+ * @brief       Reads a #Dictionary written by @ref saveDictionary
+ *
+ * @param path  The path to the file
+ *
+ * @return NULL If the file does not exist or is not valid
+ * @return      The #Dictionary
+ */
+Dictionary loadDictionary(char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    Dictionary d = makeDictionary();
+    int size;
+    bool ok = fread(&size, sizeof(int), 1, f) == 1 && size >= 0;
+    for (int i = 0; ok && i < size; i++) {
+        int len;
+        ok = fread(&len, sizeof(int), 1, f) == 1 && len >= 0;
+        if (ok) {
+            char word[len + 1];
+            ok = fread(word, sizeof(char), len, f) == (size_t)len;
+            word[len] = '\0';
+            ok = ok && addToDictionary(d, word) == i;
+        }
+    }
+    fclose(f);
+
+    if (!ok) {
+        fprintf(stderr, "loadDictionary: invalid file '%s'\n", path);
+        freeDictionary(d);
+        return NULL;
+    }
+    return d;
+}
+
+/**
+ * @brief   Frees the memory allocated to a #Dictionary
+ *
+ * @param d The given #Dictionary
+ */
+void freeDictionary(Dictionary d) {
+    if (d == NULL)
+        return;
+
+    for (int i = 0; i < getDictionarySize(d); i++)
+        free(getDictionaryWord(d, i));
+    g_array_free(d->words, TRUE);
+    g_hash_table_destroy(d->ids);
+    free(d);
+}
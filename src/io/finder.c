@@ -3,36 +3,328 @@
  *
  * File implementing the function which searches a file for a substring
  *
+ * Without an index, the file is mapped and split into chunks scanned in parallel, in rounds of one chunk per thread.
+ * Each chunk is searched as a whole (not line by line) for the substring, comparing the first and last characters of
+ * the substring to 16 positions at once, and the lines holding a match are kept in memory until the chunks before are
+ * written, so the lines are written in the order of the file. The scan stops once enough lines were written
  */
 #define _GNU_SOURCE
+#include <ctype.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "io/finder.h"
+#include "io/lineReader.h"
+#include "io/taskManager.h"
+#include "io/trigrams.h"
 #include "utils/utils.h"
 
 /**
- * @brief           This function will find all lines where a substring occurs and copy only those to a new file
+ * @brief Search the files indexed by @ref indexFinderFile through their #TrigramIndex. Comment out to always scan them
+ */
+#define USE_TRIGRAM_INDEX
+
+/**
+ * @brief The number of bytes of the file scanned by each thread at once (8MB)
+ */
+#define FINDER_CHUNK_SIZE 8388608
+
+/**
+ * @brief The maximum number of threads scanning a file at once
+ */
+#define FINDER_MAX_THREADS 8
+
+/**
+ * @brief A chunk of a mapped file scanned by a thread, and the lines of it holding the substring
+ */
+typedef struct finderChunk {
+    const char* map;        ///< The mapped file
+    long size;              ///< The size of the file
+    long from;              ///< The position of the chunk (the lines starting from it on are scanned)
+    long to;                ///< The position after the chunk (the lines starting from it on are left to the next one)
+    const char* substring;  ///< The substring searched
+    int max_lines;          ///< The maximum number of lines kept (-1 for every line)
+
+    char* lines;            ///< The lines holding the substring, each followed by '\n'
+    int lines_size;         ///< The number of characters of lines
+    int lines_capacity;     ///< The number of characters allocated to lines
+    int found;              ///< The number of lines kept
+} FINDERCHUNK;
+
+/**
+ * @brief           Gets the path to the #TrigramIndex of a file (in the output directory, named after the file)
+ *
+ * @param infile    The path to the file
+ *
+ * @return NULL     If the path could not be allocated
+ * @return          The path (must be freed)
+ */
+static char* getTrigramIndexName(char* infile) {
+    char* base = strrchr(infile, '/');
+    base = base == NULL ? infile : base + 1;
+
+    char* name = malloc(strlen(base) + 11);
+    if (name == NULL) {
+        fprintf(stderr, "getTrigramIndexName: error allocating the path of the index of '%s'\n", infile);
+        return NULL;
+    }
+    sprintf(name, "saida/%s.tri", base);
+    return name;
+}
+
+/**
+ * @brief           Builds the #TrigramIndex of a file searched by @ref finder, unless it is up to date
+ *
+ * @param infile    The path to the file
+ */
+void indexFinderFile(char* infile) {
+#ifdef USE_TRIGRAM_INDEX
+    char* index_name = getTrigramIndexName(infile);
+    if (index_name == NULL)
+        return;
+
+    TrigramIndex t = openTrigramIndex(infile, index_name);
+    if (t == NULL)
+        buildTrigramIndex(infile, index_name);
+
+    closeTrigramIndex(t);
+    free(index_name);
+#endif
+}
+
+/**
+ * @brief           Finds the first occurrence of a substring in a range of characters, ignoring case (as strcasestr)
+ *
+ * @param s         The characters
+ * @param from      The position the search starts at
+ * @param to        The position after the range
+ * @param substring The substring
+ * @param len       The length of the substring
+ *
+ * @return -1       If the substring does not occur
+ * @return          The position of the occurrence
+ */
+static long findCaseless(const char* s, long from, long to, const char* substring, int len) {
+    if (len == 0)
+        return from;
+
+    long i = from;
+#ifdef __SSE2__
+    __m128i first_lower = _mm_set1_epi8((char)tolower((unsigned char)substring[0]));
+    __m128i first_upper = _mm_set1_epi8((char)toupper((unsigned char)substring[0]));
+    __m128i last_lower = _mm_set1_epi8((char)tolower((unsigned char)substring[len - 1]));
+    __m128i last_upper = _mm_set1_epi8((char)toupper((unsigned char)substring[len - 1]));
+
+    for (; i + len - 1 + 16 <= to; i += 16) {
+        __m128i first = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i last = _mm_loadu_si128((const __m128i*)(s + i + len - 1));
+        __m128i eq = _mm_and_si128(_mm_or_si128(_mm_cmpeq_epi8(first, first_lower), _mm_cmpeq_epi8(first, first_upper)),
+                                   _mm_or_si128(_mm_cmpeq_epi8(last, last_lower), _mm_cmpeq_epi8(last, last_upper)));
+        for (unsigned mask = _mm_movemask_epi8(eq); mask != 0; mask &= mask - 1) {
+            long pos = i + __builtin_ctz(mask);
+            if (strncasecmp(s + pos, substring, len) == 0)
+                return pos;
+        }
+    }
+#endif
+
+    int first = tolower((unsigned char)substring[0]);
+    for (; i + len <= to; i++)
+        if (tolower((unsigned char)s[i]) == first && strncasecmp(s + i, substring, len) == 0)
+            return i;
+    return -1;
+}
+
+/**
+ * @brief       Adds a line to the lines of a #FINDERCHUNK, followed by '\n'
+ *
+ * @param chunk The given #FINDERCHUNK
+ * @param line  The line
+ * @param len   The length of the line (without '\r' and '\n')
+ */
+static void keepLine(FINDERCHUNK* chunk, const char* line, long len) {
+    if (chunk->lines_size + len + 1 > chunk->lines_capacity) {
+        chunk->lines_capacity = MAX(chunk->lines_capacity * 2, chunk->lines_size + (int)len + 1);
+        chunk->lines = realloc(chunk->lines, chunk->lines_capacity);
+    }
+    memcpy(chunk->lines + chunk->lines_size, line, len);
+    chunk->lines_size += len;
+    chunk->lines[chunk->lines_size++] = '\n';
+    chunk->found++;
+}
+
+/**
+ * @brief   Used with pthread_create to scan a #FINDERCHUNK
+ *
+ * @param p The #FINDERCHUNK
+ *
+ * @return  Always returns NULL (required by pthread_create thread_start prototype)
+ */
+static void* scanChunk(void* p) {
+    FINDERCHUNK* chunk = (FINDERCHUNK*)p;
+    const char* s = chunk->map;
+    int len = strlen(chunk->substring);
+
+    //The first line of the chunk starts after the first line break before it
+    long pos = chunk->from;
+    if (pos > 0) {
+        const char* newline = memchr(s + pos - 1, '\n', chunk->size - pos + 1);
+        pos = newline == NULL ? chunk->size : newline - s + 1;
+    }
+
+    while (pos < chunk->to && chunk->found != chunk->max_lines) {
+        long match = findCaseless(s, pos, chunk->size, chunk->substring, len);
+        if (match == -1)
+            break;
+
+        const char* start = memrchr(s + pos, '\n', match - pos);
+        long line = start == NULL ? pos : start - s + 1;
+        if (line >= chunk->to)
+            break;
+
+        const char* end = memchr(s + match, '\n', chunk->size - match);
+        long line_end = end == NULL ? chunk->size : end - s;
+        long line_len = line_end - line;
+        if (line_len > 0 && s[line_end - 1] == '\r')
+            line_len--;
+
+        //In the line (not past its end, nor in its '\r')
+        if (match + len <= line + line_len)
+            keepLine(chunk, s + line, line_len);
+        pos = line_end + 1;
+    }
+    return NULL;
+}
+
+/**
+ * @brief           Writes the lines of a mapped file where a substring occurs (ignoring case), scanning its chunks in
+ *                  parallel
+ *
+ * @param map       The mapped file
+ * @param size      The size of the file
+ * @param substring The substring to search for (without line breaks)
+ * @param max_lines The maximum number of lines written (-1 for every line)
+ * @param output    The file to write the lines to
+ */
+static void scanMappedFile(const char* map, long size, char* substring, int max_lines, FILE* output) {
+    int parts = MIN(getSpareThreads(), FINDER_MAX_THREADS);
+    pthread_t tids[FINDER_MAX_THREADS];
+    FINDERCHUNK chunks[FINDER_MAX_THREADS];
+    for (int p = 0; p < parts; p++)
+        chunks[p] = (FINDERCHUNK){ .map = map, .size = size, .substring = substring,
+                                   .lines = NULL, .lines_size = 0, .lines_capacity = 0 };
+
+    for (long from = 0; from < size && max_lines != 0; from += (long)parts * FINDER_CHUNK_SIZE) {
+        int n = 0;
+        for (; n < parts && from + (long)n * FINDER_CHUNK_SIZE < size; n++) {
+            chunks[n].from = from + (long)n * FINDER_CHUNK_SIZE;
+            chunks[n].to = MIN(size, chunks[n].from + FINDER_CHUNK_SIZE);
+            chunks[n].max_lines = max_lines;
+            chunks[n].lines_size = 0;
+            chunks[n].found = 0;
+        }
+
+        for (int p = 1; p < n; p++)
+            pthread_create(&tids[p], NULL, scanChunk, &chunks[p]);
+        scanChunk(&chunks[0]);
+        for (int p = 1; p < n; p++)
+            pthread_join(tids[p], NULL);
+
+        for (int p = 0; p < n && max_lines != 0; p++) {
+            int written = chunks[p].lines_size;
+            if (max_lines >= 0 && chunks[p].found > max_lines) {
+                //Only the first max_lines lines of the chunk
+                written = 0;
+                for (int l = 0; l < max_lines; l++)
+                    written = (char*)memchr(chunks[p].lines + written, '\n', chunks[p].lines_size - written) - chunks[p].lines + 1;
+                chunks[p].found = max_lines;
+            }
+            fwrite(chunks[p].lines, 1, written, output);
+            if (max_lines > 0)
+                max_lines -= chunks[p].found;
+        }
+    }
+
+    for (int p = 0; p < parts; p++)
+        free(chunks[p].lines);
+}
+
+/**
+ * @brief           Writes the lines of a file where a substring occurs
+ *
+ *                  The lines are found through the #TrigramIndex of the file, if it has an up to date one and the
+ *                  substring is long enough; otherwise the file is scanned (see @ref scanMappedFile)
  *
  * @param infile    The path to the input file
- * @param outfile   The path to the output file
+ * @param output    The file to write the lines to
  * @param substring The substring to search for
+ * @param max_lines The maximum number of lines written, the first ones (-1 for every line)
  */
-void finder(char* infile, char* outfile, char* substring) {
-    FILE* input = OPEN_FILE(infile,"r");
-    FILE* output = OPEN_FILE(outfile,"w");
-    char *buf = NULL;
-    int buf_size = 0;
+static void findLines(char* infile, FILE* output, char* substring, int max_lines) {
+#ifdef USE_TRIGRAM_INDEX
+    char* index_name = getTrigramIndexName(infile);
+    TrigramIndex t = index_name != NULL ? openTrigramIndex(infile, index_name) : NULL;
+    bool searched = t != NULL && searchTrigramIndex(t, substring, max_lines, output);
+    closeTrigramIndex(t);
+    free(index_name);
+
+    if (searched)
+        return;
+#endif
+
+    struct stat st;
+    int fd = strpbrk(substring, "\r\n") == NULL ? open(infile, O_RDONLY) : -1;
+    if (fd != -1 && fstat(fd, &st) == 0) {
+        char* map = st.st_size == 0 ? NULL : mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            if (map != NULL) {
+                madvise(map, st.st_size, MADV_SEQUENTIAL);
+                scanMappedFile(map, st.st_size, substring, max_lines, output);
+                munmap(map, st.st_size);
+            }
+            close(fd);
+            return;
+        }
+    }
+    if (fd != -1)
+        close(fd);
 
-    while (getFileLine(input, &buf, &buf_size)) {
-        if (strcasestr(buf,substring))
+    LineReader input = openLineReader(infile, 0, -1);
+    char *buf;
+
+    while (max_lines != 0 && readLine(input, &buf) >= 0) {
+        if (strcasestr(buf,substring)) {
             fprintf(output,"%s\n",buf);
+            if (max_lines > 0)
+                max_lines--;
+        }
     }
 
-    if (buf)
-        free(buf);
+    closeLineReader(input);
+}
 
-    fclose(input);
+/**
+ * @brief           This function will find all lines where a substring occurs and copy only those to a new file
+ *                  (along with its line index, for paging through it)
+ *
+ * @param infile    The path to the input file
+ * @param outfile   The path to the output file
+ * @param substring The substring to search for
+ * @param max_lines The maximum number of lines copied, the first ones (-1 for every line)
+ */
+void finder(char* infile, char* outfile, char* substring, int max_lines) {
+    FILE* output = OPEN_FILE(outfile,"w");
+    findLines(infile, output, substring, max_lines);
     fclose(output);
+    indexFileLines(outfile);
 }
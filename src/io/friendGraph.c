@@ -0,0 +1,277 @@
+/**
+ * @file friendGraph.c
+ *
+ * File containing the implementation of the #FriendGraph type
+ *
+ * The nodes are the ids of the users, sorted, and the friends of each node are kept as one run of the adjacency array
+ * (from its offset to the offset of the next node). The file holds the number of nodes and of edges, followed by the
+ * ids, the offsets (one more than the nodes), the signatures and the adjacency array
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io/friendGraph.h"
+
+/**
+ * @brief Structure representing a #FriendGraph
+ */
+struct friendGraph {
+    int nodes;              ///< The number of nodes
+    int* ids;               ///< The id of each node, sorted
+    int* offsets;           ///< The offset of the friends of each node in adjacency (and the number of edges, after the last)
+    uint64_t* signatures;   ///< The bits of @ref getFriendBit of the friends of each node
+    int* adjacency;         ///< The friends of every node, sorted in runs
+    int edges;              ///< The number of edges
+    int capacity;           ///< The number of edges allocated
+    int filled;             ///< The number of nodes whose friends were added (the following ones have none yet)
+};
+
+/**
+ * @brief       Gets the bit of the signatures that stands for a node
+ *
+ * @param node  The node
+ *
+ * @return      The signature with only that bit set
+ */
+static inline uint64_t getFriendBit(int node) {
+    return 1ULL << (((uint64_t)node * 0x9E3779B97F4A7C15ULL) >> 58);
+}
+
+/**
+ * @brief       Compares two ints, for qsort and bsearch
+ *
+ * @param a     The first int
+ * @param b     The second int
+ *
+ * @return      Negative, zero or positive as a is smaller than, equal to or larger than b
+ */
+static int compareNodes(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return x < y ? -1 : x > y;
+}
+
+/**
+ * @brief       Creates a #FriendGraph without friendships
+ *
+ * @param ids   The ids of the users, sorted (copied)
+ * @param nodes The number of users
+ *
+ * @return      The #FriendGraph
+ */
+FriendGraph makeFriendGraph(int* ids, int nodes) {
+    FriendGraph g = malloc(sizeof(struct friendGraph));
+    g->nodes = nodes;
+    g->ids = malloc(nodes * sizeof(int) + 1);
+    memcpy(g->ids, ids, nodes * sizeof(int));
+    g->offsets = calloc(nodes + 1, sizeof(int));
+    g->signatures = calloc(nodes + 1, sizeof(uint64_t));
+    g->capacity = 1024;
+    g->adjacency = malloc(g->capacity * sizeof(int));
+    g->edges = 0;
+    g->filled = 0;
+    return g;
+}
+
+/**
+ * @brief       Marks the nodes before the given one, whose friends were not added, as having none
+ *
+ * @param g     The given #FriendGraph
+ * @param node  The node
+ */
+static void fillFriendRows(FriendGraph g, int node) {
+    for (; g->filled < node; g->filled++)
+        g->offsets[g->filled + 1] = g->edges;
+}
+
+/**
+ * @brief           Adds the friends of a node of a #FriendGraph. The nodes are added in order, each at most once
+ *
+ * @param g         The given #FriendGraph
+ * @param node      The node (the index of the user in the ids)
+ * @param friends   The ids of the friends (the ones not in the #FriendGraph are left out)
+ * @param n         The number of friends
+ */
+void addFriends(FriendGraph g, int node, int* friends, int n) {
+    if (node < g->filled || node >= g->nodes) {
+        fprintf(stderr, "addFriends: node %d is out of order\n", node);
+        return;
+    }
+
+    fillFriendRows(g, node);
+    if (g->edges + n > g->capacity) {
+        g->capacity = MAX(g->capacity * 2, g->edges + n);
+        g->adjacency = realloc(g->adjacency, g->capacity * sizeof(int));
+    }
+
+    int* row = g->adjacency + g->edges;
+    int size = 0;
+    bool sorted = true;
+    for (int j = 0; j < n; j++) {
+        int friend = getFriendGraphNode(g, friends[j]);
+        if (friend == -1)
+            continue;
+        sorted = sorted && (size == 0 || row[size - 1] < friend);
+        row[size++] = friend;
+    }
+    if (!sorted)
+        qsort(row, size, sizeof(int), compareNodes);
+
+    g->signatures[node] = 0;
+    for (int j = 0; j < size; j++)
+        g->signatures[node] |= getFriendBit(row[j]);
+
+    g->edges += size;
+    g->offsets[node + 1] = g->edges;
+    g->filled = node + 1;
+}
+
+/**
+ * @brief       Gets the node of a user of a #FriendGraph
+ *
+ * @param g     The given #FriendGraph
+ * @param id    The id of the user
+ *
+ * @return      The node (-1 if the user is not in the #FriendGraph)
+ */
+int getFriendGraphNode(FriendGraph g, int id) {
+    int* found = bsearch(&id, g->ids, g->nodes, sizeof(int), compareNodes);
+    return found == NULL ? -1 : found - g->ids;
+}
+
+/**
+ * @brief       Gets the number of nodes of a #FriendGraph
+ *
+ * @param g     The given #FriendGraph
+ *
+ * @return      The number of nodes
+ */
+int getFriendGraphSize(FriendGraph g) {
+    return g->nodes;
+}
+
+/**
+ * @brief       Checks whether a node is among the friends of another
+ *
+ * @param g     The given #FriendGraph
+ * @param node  The node whose friends are searched
+ * @param other The node searched
+ *
+ * @return      Whether other is a friend of node
+ */
+static bool hasFriend(FriendGraph g, int node, int other) {
+    if (node >= g->filled || !(g->signatures[node] & getFriendBit(other)))
+        return false;
+
+    int lo = g->offsets[node], hi = g->offsets[node + 1];
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (g->adjacency[mid] < other)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo < g->offsets[node + 1] && g->adjacency[lo] == other;
+}
+
+/**
+ * @brief       Checks whether two users of a #FriendGraph are friends (each is among the friends of the other)
+ *
+ * @param g     The given #FriendGraph
+ * @param a     The id of the first user
+ * @param b     The id of the second user
+ *
+ * @return      Whether the users are friends (false if one of them is not in the #FriendGraph)
+ */
+bool areFriends(FriendGraph g, int a, int b) {
+    int x = getFriendGraphNode(g, a), y = getFriendGraphNode(g, b);
+    return x != -1 && y != -1 && hasFriend(g, y, x) && hasFriend(g, x, y);
+}
+
+/**
+ * @brief       Writes a #FriendGraph to a file
+ *
+ * @param g     The given #FriendGraph
+ * @param path  The path to the file
+ *
+ * @return      Whether or not the #FriendGraph was written
+ */
+bool saveFriendGraph(FriendGraph g, char* path) {
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "saveFriendGraph: could not open file '%s'\n", path);
+        return false;
+    }
+
+    fillFriendRows(g, g->nodes);
+    int header[2] = { g->nodes, g->edges };
+    bool ok = fwrite(header, sizeof(int), 2, f) == 2
+           && fwrite(g->ids, sizeof(int), g->nodes, f) == (size_t)g->nodes
+           && fwrite(g->offsets, sizeof(int), g->nodes + 1, f) == (size_t)g->nodes + 1
+           && fwrite(g->signatures, sizeof(uint64_t), g->nodes, f) == (size_t)g->nodes
+           && fwrite(g->adjacency, sizeof(int), g->edges, f) == (size_t)g->edges;
+
+    return fclose(f) == 0 && ok;
+}
+
+/**
+ * @brief       Reads a #FriendGraph written by @ref saveFriendGraph
+ *
+ * @param path  The path to the file
+ *
+ * @return NULL If the file does not exist or is not valid
+ * @return      The #FriendGraph
+ */
+FriendGraph loadFriendGraph(char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    int header[2];
+    if (fread(header, sizeof(int), 2, f) != 2 || header[0] < 0 || header[1] < 0) {
+        fprintf(stderr, "loadFriendGraph: invalid file '%s'\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    FriendGraph g = malloc(sizeof(struct friendGraph));
+    g->nodes = header[0];
+    g->edges = g->capacity = header[1];
+    g->filled = g->nodes;
+    g->ids = malloc(g->nodes * sizeof(int) + 1);
+    g->offsets = malloc((g->nodes + 1) * sizeof(int));
+    g->signatures = malloc((g->nodes + 1) * sizeof(uint64_t));
+    g->adjacency = malloc(g->edges * sizeof(int) + 1);
+
+    bool ok = fread(g->ids, sizeof(int), g->nodes, f) == (size_t)g->nodes
+           && fread(g->offsets, sizeof(int), g->nodes + 1, f) == (size_t)g->nodes + 1
+           && fread(g->signatures, sizeof(uint64_t), g->nodes, f) == (size_t)g->nodes
+           && fread(g->adjacency, sizeof(int), g->edges, f) == (size_t)g->edges
+           && g->offsets[g->nodes] == g->edges;
+    fclose(f);
+
+    if (!ok) {
+        fprintf(stderr, "loadFriendGraph: invalid file '%s'\n", path);
+        freeFriendGraph(g);
+        return NULL;
+    }
+    return g;
+}
+
+/**
+ * @brief   Frees the memory allocated to a #FriendGraph
+ *
+ * @param g The given #FriendGraph
+ */
+void freeFriendGraph(FriendGraph g) {
+    if (g == NULL)
+        return;
+
+    free(g->ids);
+    free(g->offsets);
+    free(g->signatures);
+    free(g->adjacency);
+    free(g);
+}
@@ -0,0 +1,187 @@
+/**
+ * @file idSet.c
+ * 
+ * File containing the implementation of the #IdSet type
+ * 
+ * The #IdSet answers whether an id exists in O(1), without accessing the #Cache. Sets of dense ids are stored
+ * in a bitmap with one bit per possible id; sparse sets fall back to a Bloom filter of @ref ID_SET_BLOOM_BITS_PER_ID
+ * bits per id
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "io/idSet.h"
+
+/**
+ * @brief Structure representing an #IdSet
+ */
+struct idSet {
+    bool bloom;                 ///< Whether the set is a Bloom filter (or an exact bitmap)
+    unsigned long long bits;    ///< The number of bits of the set (a power of two for Bloom filters)
+    unsigned long long* words;  ///< The bits of the set
+};
+
+/**
+ * @brief       Creates an empty #IdSet, suiting the given ids
+ * 
+ * @param max   The largest id the set will contain
+ * @param count The number of ids the set will contain
+ * 
+ * @return      The #IdSet
+ */
+IdSet makeIdSet(int max, int count) {
+    IdSet s = malloc(sizeof(struct idSet));
+    unsigned long long bitmap_bits = (unsigned long long)(max < 0 ? 0 : max) + 1;
+
+    s->bloom = bitmap_bits > ID_SET_MIN_BITMAP_BITS && bitmap_bits / ID_SET_MAX_BITS_PER_ID > (unsigned long long)count;
+    if (s->bloom)
+        for (s->bits = 64; s->bits < (unsigned long long)count * ID_SET_BLOOM_BITS_PER_ID; s->bits *= 2);
+    else
+        s->bits = bitmap_bits;
+
+    s->words = calloc((s->bits + 63) / 64, sizeof(unsigned long long));
+    return s;
+}
+
+/**
+ * @brief       Calculates the i-th bit of a Bloom filter corresponding to an id (double hashing of a 64-bit mix)
+ * 
+ * @param s     The given #IdSet
+ * @param id    The given id
+ * @param i     The index of the hash function
+ * 
+ * @return      The position of the bit
+ */
+static unsigned long long getBloomBit(IdSet s, int id, int i) {
+    unsigned long long h = (unsigned long long)id + 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+
+    return ((h & 0xFFFFFFFF) + i * ((h >> 32) | 1)) & (s->bits - 1);
+}
+
+/**
+ * @brief       Adds an id to an #IdSet
+ * 
+ * @warning     Ids larger than the maximum the set was created with are ignored by bitmaps
+ * 
+ * @param s     The given #IdSet
+ * @param id    The id to add
+ */
+void addToIdSet(IdSet s, int id) {
+    if (id < 0)
+        return;
+
+    if (s->bloom)
+        for (int i = 0; i < ID_SET_BLOOM_HASHES; i++) {
+            unsigned long long bit = getBloomBit(s, id, i);
+            s->words[bit / 64] |= 1ULL << (bit % 64);
+        }
+    else if ((unsigned long long)id < s->bits)
+        s->words[id / 64] |= 1ULL << (id % 64);
+}
+
+/**
+ * @brief       Checks whether an id may be in an #IdSet
+ * 
+ * @param s     The given #IdSet
+ * @param id    The given id
+ * 
+ * @return      false if the id is not in the set, true if it is (or may be, if the set is not exact)
+ */
+bool mayContainId(IdSet s, int id) {
+    if (id < 0)
+        return false;
+
+    if (!s->bloom)
+        return (unsigned long long)id < s->bits && (s->words[id / 64] >> (id % 64)) & 1;
+
+    for (int i = 0; i < ID_SET_BLOOM_HASHES; i++) {
+        unsigned long long bit = getBloomBit(s, id, i);
+        if (!((s->words[bit / 64] >> (bit % 64)) & 1))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief   Checks whether the answers of @ref mayContainId are exact (the set is a bitmap)
+ * 
+ * @param s The given #IdSet
+ * 
+ * @return  Whether or not the #IdSet is exact
+ */
+bool isIdSetExact(IdSet s) {
+    return !s->bloom;
+}
+
+/**
+ * @brief       Writes an #IdSet to a file
+ * 
+ * @param s     The given #IdSet
+ * @param path  The path to the file
+ * 
+ * @return      Whether or not the #IdSet was written
+ */
+bool saveIdSet(IdSet s, char* path) {
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "saveIdSet: could not open file '%s'\n", path);
+        return false;
+    }
+
+    unsigned long long words = (s->bits + 63) / 64;
+    bool ok = fwrite(&s->bloom, sizeof(bool), 1, f) == 1
+           && fwrite(&s->bits, sizeof(unsigned long long), 1, f) == 1
+           && fwrite(s->words, sizeof(unsigned long long), words, f) == words;
+
+    fclose(f);
+    return ok;
+}
+
+/**
+ * @brief       Reads an #IdSet written by @ref saveIdSet
+ * 
+ * @param path  The path to the file
+ * 
+ * @return NULL If the file does not exist or is not valid
+ * @return      The #IdSet
+ */
+IdSet loadIdSet(char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    IdSet s = malloc(sizeof(struct idSet));
+    s->words = NULL;
+
+    bool ok = fread(&s->bloom, sizeof(bool), 1, f) == 1 && fread(&s->bits, sizeof(unsigned long long), 1, f) == 1;
+    if (ok) {
+        unsigned long long words = (s->bits + 63) / 64;
+        s->words = malloc(words * sizeof(unsigned long long));
+        ok = fread(s->words, sizeof(unsigned long long), words, f) == words;
+    }
+    fclose(f);
+
+    if (!ok) {
+        fprintf(stderr, "loadIdSet: invalid file '%s'\n", path);
+        freeIdSet(s);
+        return NULL;
+    }
+    return s;
+}
+
+/**
+ * @brief   Frees the memory allocated to an #IdSet
+ * 
+ * @param s The given #IdSet
+ */
+void freeIdSet(IdSet s) {
+    if (s == NULL)
+        return;
+
+    free(s->words);
+    free(s);
+}
@@ -11,11 +11,18 @@
  */
 #define _GNU_SOURCE
 
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <unistd.h>
 
 #include "io/cache.h"
 #include "io/indexer.h"
+#include "io/memoryBudget.h"
+#include "io/taskManager.h"
+#include "utils/metrics.h"
 
 
 /**
@@ -23,134 +30,1151 @@
  */
 #define MAX_FILE_LINES 8388608 //128MB (size of each file is 8388608 * size of each line (sizeof(LINE)))
 
+/**
+ * @brief The number of consecutive positions that must be retrieved in the same direction for the
+ *        #Indexer to consider it a scan and start prefetching
+ */
+#define SCAN_THRESHOLD 8
+
+/**
+ * @brief The number of lines of the index file prefetched ahead of a scan at once
+ */
+#define PREFETCH_WINDOW 4096
+
+/**
+ * @brief The maximum number of threads sorting the runs of @ref sortIndexer at once
+ */
+#define SORT_MAX_THREADS 8
+
+/**
+ * @brief The maximum number of threads scanning the partitions of @ref scanIndexerRange at once
+ */
+#define SCAN_MAX_THREADS 8
+
+/**
+ * @brief The least number of positions of each partition of @ref scanIndexerRange (smaller ranges use fewer threads)
+ */
+#define SCAN_PARTITION_MIN_ELEMS 16384
+
+/**
+ * @brief The number of lines read from (or written to) a file at once while merging the sorted runs
+ */
+#define MERGE_BLOCK_LINES 4096
+
+/**
+ * @brief The largest number of bytes a value of a group is encoded to (a varint of 7 bits per byte of a 64 bits value)
+ */
+#define GROUP_VALUE_MAX_BYTES 10
+
+/**
+ * @brief   Store the lines of the indexes with embedded keys packed (see @ref PACKED_LINE_SIZE). Comment out to store
+ *          every line as two ::pos_t
+ */
+#define PACK_EMBEDDED_KEYS
+
+/**
+ * @brief   The size of a packed line in the index file: a 32 bits key (embedded keys are ids, or compacted dates,
+ *          stored as ints) and a 48 bits value (a position in the values file up to 256TB)
+ */
+#define PACKED_LINE_SIZE 10
+
+/**
+ * @brief The number of bytes of the value of a packed line
+ */
+#define PACKED_VALUE_SIZE 6
+
+/**
+ * @brief The number of lines of the index file of an #Indexer in each block summarized by the search tree (one #Cache line)
+ */
+#define TREE_BLOCK_LINES(i) (CACHE_LINE_SIZE / (i)->line_size)
+
+/**
+ * @brief The number of keys in each node of the search tree (one #Cache line)
+ */
+#define TREE_NODE_KEYS (CACHE_LINE_SIZE / sizeof(pos_t))
+
+/**
+ * @brief The maximum height of the search tree
+ */
+#define TREE_MAX_HEIGHT 8
+
+/**
+ * @brief   Find the dense keys compared directly through a table addressed by the key (see @ref buildDirectTable).
+ *          Comment out to always search them
+ */
+#define USE_DIRECT_TABLES
+
+/**
+ * @brief The maximum number of slots of the direct address table per key stored (sparser keys are searched)
+ */
+#define DIRECT_TABLE_MAX_SLOTS_PER_KEY 4
+
+/**
+ * @brief The flag of an entry of a direct address table set if its key is stored
+ */
+#define DIRECT_TABLE_FOUND 0x80000000u
+
+/**
+ * @brief   Find the keys compared directly that are too sparse for a direct address table through a piecewise linear
+ *          model of their positions (see @ref buildLearnedIndex). Comment out to search them through the tree
+ */
+#define USE_LEARNED_INDEX
+
+/**
+ * @brief The maximum distance (in lines) between the position of a key stored and the one its segment predicts
+ */
+#define LEARNED_INDEX_ERROR 32
+
+/**
+ * @brief The minimum number of lines of an index modelled by a learned index (smaller ones are searched)
+ */
+#define LEARNED_INDEX_MIN_LINES 4096
+
+/**
+ * @brief The maximum size of the top levels of the search tree kept in memory by each #Indexer (4MB)
+ */
+#define TREE_RESIDENT_SIZE 4194304
+
 /**
  * @brief Defines a line of the indexer file: the key and the position that key maps to
  */
-typedef struct line {
-    pos_t key;     ///< The key: position in the key file (if it is NULL, it is embedded)
-    pos_t value;   ///< The value: position in the value file (if it is NULL, it is embedded)
-} LINE;
+typedef struct line {
+    pos_t key;     ///< The key: position in the key file (if it is NULL, it is embedded)
+    pos_t value;   ///< The value: position in the value file (if it is NULL, it is embedded)
+} LINE;
+
+/**
+ * @brief A segment of a learned index: predicts the position of the keys from its key to the key of the next one
+ */
+typedef struct learnedSegment {
+    pos_t key;      ///< The first key of the segment
+    double slope;   ///< The number of positions per unit of key
+    int pos;        ///< The first position of the key
+} LEARNEDSEGMENT;
+
+/**
+ * @brief The header of the file of a learned index
+ */
+typedef struct learnedHeader {
+    int elem_no;    ///< The number of lines of the index modelled
+    int segment_no; ///< The number of segments
+    pos_t last_key; ///< The largest key of the index modelled
+} LEARNEDHEADER;
+
+/**
+ * @brief Structure representing an index of the application
+ */
+struct indexer {
+    FILE* index;                                        ///< The index file
+    int elem_no;                                        ///< The number of lines stored in the index file
+    int line_size;                                      ///< The size of each line in the index file (sizeof(LINE), or @ref PACKED_LINE_SIZE)
+    char* index_name;                                   ///< The name of the index file (if NULL it is a temporary file deleted on program exit)
+    bool changed_since_cache_refresh;                   ///< Whether or not the index has changed since the #Cache has refreshed
+    pthread_mutex_t flush_mutex;                        ///< The mutex serializing concurrent flushes (see @ref flushIndex)
+
+    FILE* keys;                                         ///< The file containing the keys
+    int (*cmpKeys)(FILE*, pos_t, FILE*, pos_t, Cache);  ///< The function used to compare keys
+
+    FILE* values;                                       ///< The file containing the values
+    FILE* grouped_values;                               ///< The file containing the values grouped by key
+
+    int last_retrieved;                                 ///< The last position retrieved (used to detect scans)
+    int scan_step;                                      ///< The direction of the current scan (1 or -1)
+    int scan_length;                                    ///< The number of consecutive positions retrieved by the current scan
+    int prefetched;                                     ///< The farthest position prefetched by the current scan
+
+    bool direct_keys;                                   ///< Whether the keys are compared directly (see @ref directCmp), allowing a radix sort
+
+    FILE* tree;                                         ///< The static search tree over the index file (NULL if the index is not searched through one)
+    int tree_height;                                    ///< The number of levels of the search tree
+    int tree_count[TREE_MAX_HEIGHT];                    ///< The number of keys in each level of the search tree (level 0 has one per block)
+    pos_t tree_level[TREE_MAX_HEIGHT];                  ///< The position of each level in the search tree file
+    pos_t* resident;                                    ///< The top levels of the search tree, kept in memory (a prefix of the file)
+    pos_t resident_size;                                ///< The size of the levels in memory
+
+    uint32_t* direct;                                   ///< The position of the lower bound of each key from direct_min on, flagged with @ref DIRECT_TABLE_FOUND if it is stored (NULL if there is no table)
+    pos_t direct_min;                                   ///< The smallest key stored
+    pos_t direct_slots;                                 ///< The number of entries of direct (up to the largest key stored)
+
+    LEARNEDSEGMENT* segments;                           ///< The segments of the learned index, sorted by key (NULL if there is none)
+    int segment_no;                                     ///< The number of segments
+};
+
+/**
+ * @brief 		Directly compares two positions in the same file
+ *
+ * @remark      Since this function is passed as an argument it must have the same type as every comparison of keys so some arguments are unused
+ *
+ * @param f 	The file correspondent to the postion a
+ * @param a 	The position to compare in the file f
+ * @param g 	The file correspondent to the postion b
+ * @param b 	The position to compare in the file g
+ * @param c 	The dinamic #Cache
+ *
+ * @return -1   If a < b
+ * @return 0    If a == b
+ * @return 1    If a > b
+ */
+int directCmp(FILE* f, pos_t a, FILE* g, pos_t b, Cache c) {
+    return a < b ? -1 : a > b;
+}
+
+/**
+ * @brief An #Indexer and a #Cache
+ */
+typedef struct indexerCachePair
+{
+    Indexer indexer;    ///< The #Indexer
+    Cache cache;        ///< The #Cache
+    bool by_value;      ///< Whether lines with the same key are ordered by their values (see @ref sortAndGroupIndexer)
+} INDEXERCACHEPAIR, * IndexerCachePair;
+
+/**
+ * @brief       Compares two #Line based on their keys (and on their values, if the pair orders by them)
+ * 
+ * @param a     The first #Line
+ * @param b     The second #Line
+ * @param p     A pair of #Indexer and #Cache
+ * 
+ * @return < 0  If a < b
+ * @return 0    If a == b
+ * @return > 0  If a > b
+ */
+int compareLines(const void* a, const void* b, void* p) {
+    IndexerCachePair pair = (IndexerCachePair)p;
+    int cmp = pair->indexer->cmpKeys(pair->indexer->keys, ((LINE*)a)->key,
+              pair->indexer->keys, ((LINE*)b)->key, pair->cache);
+    if (cmp == 0 && pair->by_value)
+        cmp = directCmp(NULL, ((LINE*)a)->value, NULL, ((LINE*)b)->value, NULL);
+    return cmp;
+}
+
+/**
+ * @brief           Gets the size of the lines of the index file of an #Indexer: packed if its keys are embedded
+ *
+ * @param keys      The file containing the keys (NULL if they are embedded)
+ *
+ * @return          The size of each line
+ */
+static int getLineSize(FILE* keys) {
+#ifdef PACK_EMBEDDED_KEYS
+    if (keys == NULL)
+        return PACKED_LINE_SIZE;
+#endif
+    return sizeof(LINE);
+}
+
+/**
+ * @brief       Turns a key into the one stored by an #Indexer (packed keys keep their lowest 32 bits, which keeps
+ *              the order of ints, dates and every other key up to 32 bits)
+ *
+ * @param i     The given #Indexer
+ * @param key   The key
+ *
+ * @return      The key as stored
+ */
+static inline pos_t getIndexedKey(Indexer i, pos_t key) {
+    return i->line_size == PACKED_LINE_SIZE ? (pos_t)(uint32_t)key : key;
+}
+
+/**
+ * @brief       Sign extends the value of a packed line (so embedded negative ints are kept)
+ *
+ * @param value The value, in its lowest @ref PACKED_VALUE_SIZE bytes
+ *
+ * @return      The value
+ */
+static inline pos_t unpackValue(uint64_t value) {
+    return (pos_t)((int64_t)(value << (64 - 8 * PACKED_VALUE_SIZE)) >> (64 - 8 * PACKED_VALUE_SIZE));
+}
+
+/**
+ * @brief       Unpacks packed lines stored at the start of an array of lines, in place, from the last to the first (a
+ *              line never overwrites the packed lines not yet unpacked, as they are smaller)
+ *
+ * @param lines The array, holding the packed lines
+ * @param n     The number of lines
+ */
+static void unpackLines(LINE* lines, pos_t n) {
+    char* packed = (char*)lines;
+    for (pos_t j = n; j-- > 0; ) {
+        uint32_t key;
+        uint64_t value = 0;
+        memcpy(&key, packed + j * PACKED_LINE_SIZE, sizeof(uint32_t));
+        memcpy(&value, packed + j * PACKED_LINE_SIZE + sizeof(uint32_t), PACKED_VALUE_SIZE);
+        lines[j] = (LINE){ .key = key, .value = unpackValue(value) };
+    }
+}
+
+/**
+ * @brief       Reads lines from a file of lines of an #Indexer, in the layout of its index file
+ *
+ * @param i     The given #Indexer
+ * @param f     The file, read from its current position
+ * @param lines The array to read the lines to
+ * @param n     The maximum number of lines to read
+ *
+ * @return      The number of lines read
+ */
+static pos_t readLines(Indexer i, FILE* f, LINE* lines, pos_t n) {
+    pos_t read = fread(lines, i->line_size, n, f);
+    if (i->line_size != sizeof(LINE))
+        unpackLines(lines, read);
+    return read;
+}
+
+/**
+ * @brief       Writes lines to a file of lines of an #Indexer, in the layout of its index file
+ *
+ * @param i     The given #Indexer
+ * @param f     The file, written at its current position
+ * @param lines The lines (left unchanged)
+ * @param n     The number of lines
+ */
+static void writeLines(Indexer i, FILE* f, LINE* lines, pos_t n) {
+    if (i->line_size == sizeof(LINE)) {
+        fwrite(lines, sizeof(LINE), n, f);
+        return;
+    }
+
+    char packed[MERGE_BLOCK_LINES * PACKED_LINE_SIZE];
+    for (pos_t first = 0; first < n; first += MERGE_BLOCK_LINES) {
+        pos_t count = MIN(n - first, MERGE_BLOCK_LINES);
+        for (pos_t j = 0; j < count; j++) {
+            uint32_t key = (uint32_t)lines[first + j].key;
+            memcpy(packed + j * PACKED_LINE_SIZE, &key, sizeof(uint32_t));
+            memcpy(packed + j * PACKED_LINE_SIZE + sizeof(uint32_t), &lines[first + j].value, PACKED_VALUE_SIZE);
+        }
+        fwrite(packed, PACKED_LINE_SIZE, count, f);
+    }
+}
+
+/**
+ * @brief       Gets the key stored in a position of the index file of an #Indexer
+ *
+ * @param i     The given #Indexer
+ * @param pos   The position
+ * @param c     The #Cache
+ *
+ * @return      The key
+ */
+static pos_t getStoredKey(Indexer i, int pos, Cache c) {
+    ADD_METRIC(METRIC_INDEX_READS, 1);
+    if (i->line_size == sizeof(LINE))
+        return getPosT(c, i->index, pos * sizeof(LINE));
+
+    uint32_t key;
+    getStr(c, i->index, (pos_t)pos * PACKED_LINE_SIZE, (char*)&key, sizeof(uint32_t));
+    return key;
+}
+
+/**
+ * @brief       Gets the value stored in a position of the index file of an #Indexer
+ *
+ * @param i     The given #Indexer
+ * @param pos   The position
+ * @param c     The #Cache
+ *
+ * @return      The value
+ */
+static pos_t getStoredValue(Indexer i, int pos, Cache c) {
+    if (i->line_size == sizeof(LINE))
+        return getPosT(c, i->index, pos * sizeof(LINE) + sizeof(pos_t));
+
+    uint64_t value = 0;
+    getStr(c, i->index, (pos_t)pos * PACKED_LINE_SIZE + sizeof(uint32_t), (char*)&value, PACKED_VALUE_SIZE);
+    return unpackValue(value);
+}
+
+/**
+ * @brief A sorted run of lines of an #Indexer, merged by @ref sortIndexer
+ */
+typedef struct run {
+    LINE* lines;            ///< The lines of the run currently in memory
+    pos_t size;             ///< The number of lines in memory
+    pos_t pos;              ///< The position of the next line to merge
+    FILE* file;             ///< The file holding the rest of the run (NULL if the run is fully in memory)
+    IndexerCachePair pair;  ///< The #Indexer and #Cache used to sort the run
+} RUN, * Run;
+
+/**
+ * @brief A loser (tournament) tree over the sorted runs being merged
+ */
+typedef struct loserTree {
+    int* tree;              ///< tree[0] is the run holding the smallest line, tree[1..k-1] the loser of each match
+    int k;                  ///< The number of runs
+    Run runs;               ///< The runs
+    IndexerCachePair pair;  ///< The #Indexer and #Cache used to compare lines
+} LOSERTREE, * LoserTree;
+
+/**
+ * @brief The state of a grouping of the lines of an #Indexer, fed in order (see @ref addGroupLine)
+ */
+typedef struct groupBuilder GROUPBUILDER, * GroupBuilder;
+
+static void addGroupLine(GroupBuilder, LINE);
+
+/**
+ * @brief           Gets the byte of a line sorted by a pass of @ref radixSortLines
+ *
+ * @param l         The line
+ * @param pass      The pass
+ * @param by_value  Whether the lines are sorted by their values as well (the passes of the value come first)
+ *
+ * @return          The byte
+ */
+static inline int getRadixDigit(LINE* l, int pass, bool by_value) {
+    if (by_value)
+        return pass < 8 ? (l->value >> (8 * pass)) & 0xFF : (l->key >> (8 * (pass - 8))) & 0xFF;
+    return (l->key >> (8 * pass)) & 0xFF;
+}
+
+/**
+ * @brief           Sorts lines by their key with a (stable) LSD radix sort, one byte of the key per pass (after a pass
+ *                  per byte of the value, if sorting by it as well)
+ * 
+ *                  Passes in which every line has the same byte are skipped
+ * 
+ * @param lines     The lines to sort
+ * @param size      The number of lines
+ * @param by_value  Whether lines with the same key are sorted by their values
+ */
+static void radixSortLines(LINE* lines, pos_t size, bool by_value) {
+    int passes = by_value ? 16 : 8;
+    pos_t (*counts)[256] = calloc(sizeof(pos_t), passes * 256);
+    LINE* aux = malloc(size * sizeof(LINE));
+    LINE *from = lines, *to = aux;
+
+    for (pos_t j = 0; j < size; j++)
+        for (int b = 0; b < passes; b++)
+            counts[b][getRadixDigit(&lines[j], b, by_value)]++;
+
+    for (int b = 0; b < passes; b++) {
+        if (counts[b][getRadixDigit(&lines[0], b, by_value)] == size)
+            continue;
+
+        pos_t offset = 0;
+        for (int d = 0; d < 256; d++) {
+            pos_t count = counts[b][d];
+            counts[b][d] = offset;
+            offset += count;
+        }
+
+        for (pos_t j = 0; j < size; j++)
+            to[counts[b][getRadixDigit(&from[j], b, by_value)]++] = from[j];
+
+        LINE* swap = from;
+        from = to;
+        to = swap;
+    }
+
+    if (from != lines)
+        memcpy(lines, from, size * sizeof(LINE));
+
+    free(aux);
+    free(counts);
+}
+
+/**
+ * @brief   Used with pthread_create to sort a #Run in memory
+ * 
+ * @param p The #Run to sort
+ * 
+ * @return  Always returns NULL (required by pthread_create thread_start prototype)
+ */
+static void* sortRun(void* p) {
+    Run r = (Run)p;
+    if (r->pair->indexer->direct_keys)
+        radixSortLines(r->lines, r->size, r->pair->by_value);
+    else
+        qsort_r(r->lines, r->size, sizeof(LINE), compareLines, r->pair);
+    return NULL;
+}
+
+/**
+ * @brief   Reads the next block of a #Run from its file, once every line in memory was merged
+ * 
+ * @param r The given #Run
+ */
+static void refillRun(Run r) {
+    if (r->pos < r->size || !r->file)
+        return;
+
+    r->size = readLines(r->pair->indexer, r->file, r->lines, MERGE_BLOCK_LINES);
+    r->pos = 0;
+}
+
+/**
+ * @brief   Checks whether the current line of a run wins its match against the current line of another
+ *          (exhausted runs lose every match, ties go to the first run)
+ * 
+ * @param t The given #LoserTree
+ * @param a The first run
+ * @param b The second run
+ * 
+ * @return  Whether or not run a wins the match
+ */
+static bool winsMatch(LoserTree t, int a, int b) {
+    Run ra = &t->runs[a], rb = &t->runs[b];
+    if (ra->pos >= ra->size)
+        return false;
+    if (rb->pos >= rb->size)
+        return true;
+
+    LINE *la = &ra->lines[ra->pos], *lb = &rb->lines[rb->pos];
+    int cmp = t->pair->indexer->direct_keys ? directCmp(NULL, la->key, NULL, lb->key, NULL) : compareLines(la, lb, t->pair);
+    if (cmp == 0 && t->pair->by_value && t->pair->indexer->direct_keys)
+        cmp = directCmp(NULL, la->value, NULL, lb->value, NULL);
+    return cmp < 0 || (cmp == 0 && a < b);
+}
+
+/**
+ * @brief   Replays the matches from the leaf of a run up to the root of the #LoserTree
+ * 
+ *          While the tree is being built (empty nodes are -1) the run stops at the first empty node
+ * 
+ * @param t The given #LoserTree
+ * @param s The run whose current line changed
+ */
+static void replayMatches(LoserTree t, int s) {
+    for (int n = (s + t->k) / 2; n > 0; n /= 2) {
+        if (t->tree[n] == -1) {
+            t->tree[n] = s;
+            return;
+        }
+
+        if (winsMatch(t, t->tree[n], s)) {
+            int aux = t->tree[n];
+            t->tree[n] = s;
+            s = aux;
+        }
+    }
+    t->tree[0] = s;
+}
+
+/**
+ * @brief       Merges sorted runs, writing the result in blocks to the given file (or grouping it on the fly)
+ * 
+ * @param runs  The sorted runs
+ * @param k     The number of runs
+ * @param pair  The #Indexer and #Cache used to compare lines
+ * @param out   The file to write the merged lines to (unused if they are grouped)
+ * @param g     The #GroupBuilder the merged lines are added to, in order (NULL to write them to the file)
+ */
+static void mergeRuns(Run runs, int k, IndexerCachePair pair, FILE* out, GroupBuilder g) {
+    LOSERTREE t = { .tree = malloc(k * sizeof(int)), .k = k, .runs = runs, .pair = pair };
+    LINE* buffer = malloc(MERGE_BLOCK_LINES * sizeof(LINE));
+    int n = 0;
+
+    for (int j = 0; j < k; j++)
+        t.tree[j] = -1;
+    for (int j = 0; j < k; j++)
+        replayMatches(&t, j);
+
+    for (int w = t.tree[0]; runs[w].pos < runs[w].size; w = t.tree[0]) {
+        if (g != NULL)
+            addGroupLine(g, runs[w].lines[runs[w].pos++]);
+        else
+            buffer[n++] = runs[w].lines[runs[w].pos++];
+        if (n == MERGE_BLOCK_LINES) {
+            writeLines(pair->indexer, out, buffer, n);
+            n = 0;
+        }
+
+        refillRun(&runs[w]);
+        replayMatches(&t, w);
+    }
+    if (g == NULL)
+        writeLines(pair->indexer, out, buffer, n);
+
+    free(buffer);
+    free(t.tree);
+}
+
+/**
+ * @brief   Calculates the number of threads used to sort the runs of @ref sortIndexer
+ * 
+ * @return  The number of online processors, capped at @ref SORT_MAX_THREADS
+ */
+static int getSortThreads() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : n > SORT_MAX_THREADS ? SORT_MAX_THREADS : n;
+}
+
+/**
+ * @brief   Forgets the scan the #Indexer was performing, if any
+ * 
+ * @param i The given #Indexer
+ */
+static void resetScan(Indexer i) {
+    i->last_retrieved = -2;
+    i->scan_step = 0;
+    i->scan_length = 0;
+    i->prefetched = 0;
+}
+
+/**
+ * @brief               Records that a position of the index was retrieved. If the last positions were
+ *                      retrieved in order, prefetches the lines of the index the scan will read next
+ * 
+ * @note                Only a hint: concurrent scans of the same #Indexer just prefetch less accurately
+ * 
+ * @param i             The given #Indexer
+ * @param key_order     The retrieved position
+ * @param c             The #Cache to prefetch to
+ */
+static void noteRetrieval(Indexer i, int key_order, Cache c) {
+    //The fields are read and written whole (relaxed atomics), so concurrent scans only mix their hints
+    int last = __atomic_load_n(&i->last_retrieved, __ATOMIC_RELAXED);
+    int scan_step = __atomic_load_n(&i->scan_step, __ATOMIC_RELAXED);
+    int scan_length = __atomic_load_n(&i->scan_length, __ATOMIC_RELAXED);
+    int prefetched = __atomic_load_n(&i->prefetched, __ATOMIC_RELAXED);
+    int step = key_order - last;
+
+    if (step == 0)
+        return;
+
+    if ((step == 1 || step == -1) && step == scan_step)
+        scan_length++;
+    else {
+        scan_step = (step == 1 || step == -1) ? step : 0;
+        scan_length = 1;
+        prefetched = key_order;
+    }
+
+    __atomic_store_n(&i->last_retrieved, key_order, __ATOMIC_RELAXED);
+    __atomic_store_n(&i->scan_step, scan_step, __ATOMIC_RELAXED);
+    __atomic_store_n(&i->scan_length, scan_length, __ATOMIC_RELAXED);
+    __atomic_store_n(&i->prefetched, prefetched, __ATOMIC_RELAXED);
+
+    if (scan_step == 0 || scan_length < SCAN_THRESHOLD || abs(prefetched - key_order) >= PREFETCH_WINDOW / 2)
+        return;
+
+    int from = prefetched, to = prefetched + scan_step * PREFETCH_WINDOW;
+    to = MAX(-1, MIN(to, i->elem_no));
+    __atomic_store_n(&i->prefetched, to, __ATOMIC_RELAXED);
+
+    if (from > to) {
+        int aux = from;
+        from = to + 1;
+        to = aux + 1;
+    }
+
+    prefetchRange(c, i->index, (pos_t)from * i->line_size, (pos_t)to * i->line_size);
+}
+
+/**
+ * @brief   Computes the layout of the search tree of the #Indexer from its number of elements
+ * 
+ *          Level 0 holds the last key of each block of @ref TREE_BLOCK_LINES lines, each level above it the
+ *          last key of each node of @ref TREE_NODE_KEYS keys of the level below. The levels are stored from
+ *          the top down, each starting on a node boundary, so the levels kept in memory (as many as fit
+ *          @ref TREE_RESIDENT_SIZE) are a prefix of the file
+ * 
+ * @param i The given #Indexer
+ * 
+ * @return  The size of the search tree file (0 if the index fits a single block and needs no tree)
+ */
+static pos_t layoutSearchTree(Indexer i) {
+    int count = (i->elem_no + TREE_BLOCK_LINES(i) - 1) / TREE_BLOCK_LINES(i);
+    i->tree_height = 0;
+    if (count <= 1)
+        return 0;
+
+    for (; i->tree_height == 0 || count > 1; count = (count + TREE_NODE_KEYS - 1) / TREE_NODE_KEYS)
+        i->tree_count[i->tree_height++] = count;
+
+    pos_t pos = 0;
+    i->resident_size = 0;
+    for (int l = i->tree_height - 1; l >= 0; l--) {
+        i->tree_level[l] = pos;
+        pos += (i->tree_count[l] + TREE_NODE_KEYS - 1) / TREE_NODE_KEYS * CACHE_LINE_SIZE;
+        if (pos <= TREE_RESIDENT_SIZE)
+            i->resident_size = pos;
+    }
+    return pos;
+}
+
+/**
+ * @brief   Closes the search tree of the #Indexer, if any
+ * 
+ * @param i The given #Indexer
+ * @param c The #Cache
+ */
+static void closeSearchTree(Indexer i, Cache c) {
+    free(i->direct);
+    free(i->segments);
+    i->direct = NULL;
+    i->segments = NULL;
+    if (i->tree == NULL)
+        return;
+
+    if (c != NULL) {
+        cancelPrefetchFile(c, i->tree);
+        unmapCacheFile(c, i->tree);
+        clearCacheFile(c, i->tree);
+    }
+    fclose(i->tree);
+    free(i->resident);
+    i->tree = NULL;
+    i->resident = NULL;
+    i->tree_height = 0;
+}
+
+/**
+ * @brief   Opens a file persisted next to the index file of the #Indexer (a temporary file if the index has no name)
+ * 
+ * @param i         The given #Indexer
+ * @param extension The extension of the file (appended to the name of the index file)
+ * @param mode      The mode to open the file with (as in fopen)
+ * 
+ * @return          The file (NULL if it could not be opened)
+ */
+static FILE* openIndexCompanion(Indexer i, char* extension, char* mode) {
+    if (i->index_name == NULL)
+        return tmpfile();
+
+    char name[strlen(i->index_name) + strlen(extension) + 1];
+    sprintf(name, "%s%s", i->index_name, extension);
+    return fopen(name, mode);
+}
 
 /**
- * @brief Structure representing an index of the application
+ * @brief   Opens the search tree file of the #Indexer (a temporary file if the index has no name)
+ * 
+ * @param i     The given #Indexer
+ * @param mode  The mode to open the file with (as in fopen)
+ * 
+ * @return      The search tree file (NULL if it could not be opened)
  */
-struct indexer {
-    FILE* index;                                        ///< The index file
-    int elem_no;                                        ///< The number of lines stored in the index file
-    char* index_name;                                   ///< The name of the index file (if NULL it is a temporary file deleted on program exit)
-    bool changed_since_cache_refresh;                   ///< Whether or not the index has changed since the #Cache has refreshed
+static FILE* openSearchTree(Indexer i, char* mode) {
+    return openIndexCompanion(i, ".tree", mode);
+}
 
-    FILE* keys;                                         ///< The file containing the keys
-    int (*cmpKeys)(FILE*, pos_t, FILE*, pos_t, Cache);  ///< The function used to compare keys
+/**
+ * @brief   Builds the direct address table of a sorted #Indexer, if its keys are compared directly and dense enough
+ *          (at most @ref DIRECT_TABLE_MAX_SLOTS_PER_KEY slots per key): an entry for each key from the smallest to the
+ *          largest stored, holding their lower bound, so they are found without reading the index
+ * 
+ * @param i The given #Indexer
+ */
+static void buildDirectTable(Indexer i) {
+    free(i->direct);
+    i->direct = NULL;
+#ifdef USE_DIRECT_TABLES
+    if (!i->direct_keys || i->keys != NULL || i->elem_no == 0)
+        return;
 
-    FILE* values;                                       ///< The file containing the values
-    FILE* grouped_values;                               ///< The file containing the values grouped by key
-};
+    LINE first, last;
+    fflush(i->index);
+    fseek(i->index, 0, SEEK_SET);
+    bool read = readLines(i, i->index, &first, 1) == 1;
+    fseek(i->index, (pos_t)(i->elem_no - 1) * i->line_size, SEEK_SET);
+    read = read && readLines(i, i->index, &last, 1) == 1;
+    if (!read || last.key < first.key || last.key - first.key >= (pos_t)i->elem_no * DIRECT_TABLE_MAX_SLOTS_PER_KEY)
+        return;
+
+    i->direct_min = first.key;
+    i->direct_slots = last.key - first.key + 1;
+    i->direct = malloc(i->direct_slots * sizeof(uint32_t));
+
+    LINE* buffer = malloc(MERGE_BLOCK_LINES * sizeof(LINE));
+    pos_t next = 0;
+    int n;
+    fseek(i->index, 0, SEEK_SET);
+    for (int l = 0; l < i->elem_no; l += n) {
+        n = readLines(i, i->index, buffer, MERGE_BLOCK_LINES);
+        if (n <= 0)
+            break;
+        for (int j = 0; j < n; j++)
+            for (pos_t slot = buffer[j].key - i->direct_min; next <= slot; next++)
+                i->direct[next] = (uint32_t)(l + j) | (next == slot ? DIRECT_TABLE_FOUND : 0);
+    }
+    free(buffer);
+
+    if (next != i->direct_slots) {
+        fprintf(stderr, "buildDirectTable: the index is not sorted\n");
+        free(i->direct);
+        i->direct = NULL;
+    }
+#endif
+}
 
 /**
- * @brief Represents a min heap of the lines in the file. The lines are indexed by their key
+ * @brief           Finds a key in the direct address table of an #Indexer (see @ref buildDirectTable)
+ * 
+ * @param i         The given #Indexer (with a direct address table)
+ * @param key       The given key (as stored, see @ref getIndexedKey)
+ * @param found     Where to write whether the key is stored
  * 
+ * @return          The first position of the index whose key is not smaller than the given key
  */
-typedef struct heap {
-    LINE* values;           ///< The array of values of the heap
-    int* heap;              ///< The indices of the values stored
-    int size;               ///< The number of elements in the heap
-} HEAP, * Heap;
+static inline int lookupDirectTable(Indexer i, pos_t key, bool* found) {
+    *found = false;
+    if (key < i->direct_min)
+        return 0;
+    if (key - i->direct_min >= i->direct_slots)
+        return i->elem_no;
+
+    uint32_t entry = i->direct[key - i->direct_min];
+    *found = entry & DIRECT_TABLE_FOUND;
+    return entry & ~DIRECT_TABLE_FOUND;
+}
 
 /**
- * @brief       Heapifies the #Heap (sorts the #Heap)
+ * @brief   Builds the learned index of a sorted #Indexer, if its keys are compared directly and it has no direct address
+ *          table: the positions of the first line of each key are split into segments, each a line predicting them
+ *          within @ref LEARNED_INDEX_ERROR lines (each segment grows while some slope keeps every key of it in range).
+ *          It is dropped if it has more segments than the search tree has blocks, since the tree is then as cheap
  * 
- * @param h     The given #Heap
- * @param i     The given #Indexer (used to compare keys)
- * @param c     The #Cache to use when comparing keys
- * @param elem  The current position in the heap (initially zero)
+ * @param i The given #Indexer
  */
-void heapify(Heap h, Indexer i, Cache c, int elem) {
-    int l = 2 * elem + 1;
-    int r = 2 * elem + 2;
-    int smallest = elem;
-    if (l < h->size && i->cmpKeys(i->keys, h->values[h->heap[l]].key, i->keys, h->values[h->heap[smallest]].key, c) < 0)
-        smallest = l;
-    if (r < h->size && i->cmpKeys(i->keys, h->values[h->heap[r]].key, i->keys, h->values[h->heap[smallest]].key, c) < 0)
-        smallest = r;
-    if (smallest != elem)
-    {
-        int aux = h->heap[elem];
-        h->heap[elem] = h->heap[smallest];
-        h->heap[smallest] = aux;
-        heapify(h, i, c, smallest);
+static void buildLearnedIndex(Indexer i) {
+    free(i->segments);
+    i->segments = NULL;
+    i->segment_no = 0;
+#ifdef USE_LEARNED_INDEX
+    if (!i->direct_keys || i->keys != NULL || i->direct != NULL || i->elem_no < LEARNED_INDEX_MIN_LINES)
+        return;
+
+    int capacity = 64, max_segments = i->elem_no / TREE_BLOCK_LINES(i);
+    LEARNEDSEGMENT* segments = malloc(capacity * sizeof(LEARNEDSEGMENT));
+    LINE* buffer = malloc(MERGE_BLOCK_LINES * sizeof(LINE));
+    double lo = 0, hi = INFINITY;
+    pos_t previous = 0;
+    int n, segment_no = 0;
+
+    fflush(i->index);
+    fseek(i->index, 0, SEEK_SET);
+    for (int l = 0; l < i->elem_no && segment_no <= max_segments; l += n) {
+        n = readLines(i, i->index, buffer, MERGE_BLOCK_LINES);
+        if (n <= 0)
+            break;
+
+        for (int j = 0; j < n; j++) {
+            pos_t key = buffer[j].key;
+            int pos = l + j;
+            if (segment_no > 0 && key == previous)
+                continue;   //Only the first line of each key is modelled
+            previous = key;
+
+            if (segment_no > 0) {
+                LEARNEDSEGMENT* s = &segments[segment_no - 1];
+                double dx = (double)(key - s->key);
+                double key_lo = (pos - LEARNED_INDEX_ERROR - s->pos) / dx, key_hi = (pos + LEARNED_INDEX_ERROR - s->pos) / dx;
+                if (MAX(lo, key_lo) <= MIN(hi, key_hi)) {
+                    lo = MAX(lo, key_lo);
+                    hi = MIN(hi, key_hi);
+                    continue;
+                }
+                s->slope = isinf(hi) ? lo : (lo + hi) / 2;
+            }
+
+            if (segment_no == capacity) {
+                capacity *= 2;
+                segments = realloc(segments, capacity * sizeof(LEARNEDSEGMENT));
+            }
+            segments[segment_no++] = (LEARNEDSEGMENT){ .key = key, .slope = 0, .pos = pos };
+            lo = 0;
+            hi = INFINITY;
+        }
+    }
+    free(buffer);
+
+    if (segment_no == 0 || segment_no > max_segments) {
+        free(segments);
+        return;
     }
+    segments[segment_no - 1].slope = isinf(hi) ? lo : (lo + hi) / 2;
+    i->segments = segments;
+    i->segment_no = segment_no;
+#endif
 }
 
 /**
- * @brief       Returns the element with the smallest key stored in the #Heap
+ * @brief       Reads the key of a line of the index file of an #Indexer, without a #Cache
  * 
- * @param h     The given #Heap
  * @param i     The given #Indexer
- * @param c     The #Cache to use when comparing keys
+ * @param pos   The position of the line
  * 
- * @return      The element with the smallest key stored in the #Heap
+ * @return      The key (0 if it could not be read)
  */
-int popHeap(Heap h, Indexer i, Cache c) {
-    int ans = h->heap[0];
-    if (--h->size > 0)
-    {
-        h->heap[0] = h->heap[h->size];
-        heapify(h, i, c, 0);
+static pos_t readStoredKey(Indexer i, int pos) {
+    LINE line = { 0 };
+    fflush(i->index);
+    fseek(i->index, (pos_t)pos * i->line_size, SEEK_SET);
+    readLines(i, i->index, &line, 1);
+    return line.key;
+}
+
+/**
+ * @brief   Writes the learned index of an #Indexer next to its index file, if it has one
+ * 
+ * @param i The given #Indexer
+ */
+static void saveLearnedIndex(Indexer i) {
+    if (i->segments == NULL || i->index_name == NULL)
+        return;
+
+    FILE* f = openIndexCompanion(i, ".pla", "wb");
+    if (f == NULL) {
+        fprintf(stderr, "saveLearnedIndex: could not open the learned index file\n");
+        return;
     }
 
-    return ans;
+    LEARNEDHEADER header = { .elem_no = i->elem_no, .segment_no = i->segment_no, .last_key = readStoredKey(i, i->elem_no - 1) };
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(i->segments, sizeof(LEARNEDSEGMENT), i->segment_no, f);
+    fclose(f);
 }
 
 /**
- * @brief       Inserts the given value into the #Heap
+ * @brief   Reads the learned index persisted next to the index file of the #Indexer, building it (and persisting it) if
+ *          it is missing or does not match the index
  * 
- * @param h     The given #Heap
- * @param i     The given #Indexer
- * @param c     The #Cache to use when comparing keys
- * @param val   The given value
+ * @param i The given #Indexer
+ */
+static void loadLearnedIndex(Indexer i) {
+    i->segments = NULL;
+    i->segment_no = 0;
+#ifdef USE_LEARNED_INDEX
+    if (!i->direct_keys || i->keys != NULL || i->direct != NULL || i->elem_no < LEARNED_INDEX_MIN_LINES)
+        return;
+
+    FILE* f = openIndexCompanion(i, ".pla", "rb");
+    LEARNEDHEADER header;
+    if (f != NULL && fread(&header, sizeof(header), 1, f) == 1 && header.elem_no == i->elem_no && header.segment_no > 0
+        && header.segment_no <= i->elem_no / TREE_BLOCK_LINES(i) && header.last_key == readStoredKey(i, i->elem_no - 1)) {
+        LEARNEDSEGMENT* segments = malloc(header.segment_no * sizeof(LEARNEDSEGMENT));
+        if (fread(segments, sizeof(LEARNEDSEGMENT), header.segment_no, f) == (size_t)header.segment_no
+            && segments[0].key == readStoredKey(i, 0) && segments[0].pos == 0) {
+            i->segments = segments;
+            i->segment_no = header.segment_no;
+            fclose(f);
+            return;
+        }
+        free(segments);
+    }
+    if (f != NULL)
+        fclose(f);
+
+    buildLearnedIndex(i);
+    saveLearnedIndex(i);
+#endif
+}
+
+/**
+ * @brief       Finds the first position of the index whose key is not smaller than the given key through the learned
+ *              index: the segment of the key predicts it, and the window of @ref LEARNED_INDEX_ERROR lines around the
+ *              prediction is widened (doubling) until it holds the position, then binary searched
+ * 
+ * @param i     The given #Indexer (with a learned index)
+ * @param key   The given key (as stored, see @ref getIndexedKey)
+ * @param c     The #Cache
+ * 
+ * @return      The requested position (the number of elements if every key is smaller)
  */
-void pushHeap(Heap h, Indexer i, Cache c, int val) {
-    int pos = h->size++;
-    h->heap[pos] = val;
+static int searchLearnedIndex(Indexer i, pos_t key, Cache c) {
+    if (key <= i->segments[0].key)
+        return 0;
+
+    int lo = 0, hi = i->segment_no - 1;
+    while (lo < hi) {
+        int m = (lo + hi + 1) / 2;
+        if (i->segments[m].key <= key)
+            lo = m;
+        else
+            hi = m - 1;
+    }
 
-    // Fix the min heap property if it is violated
-    int parent = (pos - 1) / 2;
-    while (pos != 0 && i->cmpKeys(i->keys, h->values[h->heap[parent]].key, i->keys, h->values[h->heap[pos]].key, c) > 0)
-    {
-        int aux = h->heap[pos];
-        h->heap[pos] = h->heap[parent];
-        h->heap[parent] = aux;
+    LEARNEDSEGMENT* s = &i->segments[lo];
+    double predicted = s->pos + s->slope * (double)(key - s->key);
+    int p = predicted >= i->elem_no ? i->elem_no : (int)predicted;
+    int a = MAX(s->pos, p - LEARNED_INDEX_ERROR), b = MIN(i->elem_no, p + LEARNED_INDEX_ERROR + 1);
 
-        pos = parent;
-        parent = (pos - 1) / 2;
+    for (int step = LEARNED_INDEX_ERROR; a > 0 && getStoredKey(i, a - 1, c) >= key; step *= 2) {
+        b = a - 1;
+        a = MAX(0, a - step);
+    }
+    for (int step = LEARNED_INDEX_ERROR; b < i->elem_no && getStoredKey(i, b, c) < key; step *= 2) {
+        a = b + 1;
+        b = MIN(i->elem_no, b + step);
+    }
+
+    while (a < b) {
+        int m = (a + b) / 2;
+        if (getStoredKey(i, m, c) < key)
+            a = m + 1;
+        else
+            b = m;
     }
+    return a;
 }
 
 /**
- * @brief An #Indexer and a #Cache
+ * @brief   Builds the search tree of a sorted #Indexer, reading its index file once
+ * 
+ * @param i The given #Indexer
+ * @param c The #Cache holding stale lines of a previous tree (may be NULL)
  */
-typedef struct indexerCachePair
-{
-    Indexer indexer;    ///< The #Indexer
-    Cache cache;        ///< The #Cache
-} INDEXERCACHEPAIR, * IndexerCachePair;
+static void buildSearchTree(Indexer i, Cache c) {
+    closeSearchTree(i, c);
+    buildDirectTable(i);
+    buildLearnedIndex(i);
+    saveLearnedIndex(i);
+    pos_t size = layoutSearchTree(i);
+    if (size == 0)
+        return;
+
+    i->tree = openSearchTree(i, "wb+");
+    if (i->tree == NULL) {
+        fprintf(stderr, "buildSearchTree: could not open the search tree file\n");
+        i->tree_height = 0;
+        return;
+    }
+
+    pos_t* keys = calloc(size / sizeof(pos_t), sizeof(pos_t));
+    LINE* buffer = malloc(MERGE_BLOCK_LINES * sizeof(LINE));
+    int read, block = 0, batch = MERGE_BLOCK_LINES / TREE_BLOCK_LINES(i) * TREE_BLOCK_LINES(i); //Whole blocks only
+
+    fflush(i->index);
+    fseek(i->index, 0, SEEK_SET);
+    pos_t* level = keys + i->tree_level[0] / sizeof(pos_t);
+    for (int l = 0; l < i->elem_no; l += read) {
+        read = readLines(i, i->index, buffer, batch);
+        if (read <= 0) {
+            fprintf(stderr, "buildSearchTree: unexpected end of the index file\n");
+            break;
+        }
+        for (int j = TREE_BLOCK_LINES(i) - 1; j < read; j += TREE_BLOCK_LINES(i))
+            level[block++] = buffer[j].key;
+        if (read % TREE_BLOCK_LINES(i))
+            level[block++] = buffer[read - 1].key;
+    }
+
+    for (int l = 1; l < i->tree_height; l++) {
+        pos_t *below = keys + i->tree_level[l - 1] / sizeof(pos_t), *above = keys + i->tree_level[l] / sizeof(pos_t);
+        for (int j = 0; j < i->tree_count[l]; j++) {
+            int last = (j + 1) * TREE_NODE_KEYS - 1;
+            above[j] = below[last < i->tree_count[l - 1] ? last : i->tree_count[l - 1] - 1];
+        }
+    }
+
+    fwrite(keys, 1, size, i->tree);
+    fflush(i->tree);
+    if (c != NULL)
+        refreshCacheFile(c, i->tree);
+
+    i->resident = realloc(keys, i->resident_size == 0 ? sizeof(pos_t) : i->resident_size);
+    free(buffer);
+}
 
 /**
- * @brief       Compares two #Line based on their keys
+ * @brief   Loads the search tree persisted next to the index file, building it if it is missing or outdated
  * 
- * @param a     The first #Line
- * @param b     The second #Line
- * @param p     A pair of #Indexer and #Cache
+ * @param i The given #Indexer
+ */
+static void loadSearchTree(Indexer i) {
+    i->tree = NULL;
+    i->resident = NULL;
+    i->direct = NULL;
+    i->segments = NULL;
+    pos_t size = layoutSearchTree(i);
+    if (size == 0 || i->index_name == NULL) {
+        buildSearchTree(i, NULL);
+        return;
+    }
+
+    i->tree = openSearchTree(i, "rb");
+    if (i->tree != NULL) {
+        fseek(i->tree, 0, SEEK_END);
+        if (ftell(i->tree) == size) {
+            i->resident = malloc(i->resident_size == 0 ? sizeof(pos_t) : i->resident_size);
+            fseek(i->tree, 0, SEEK_SET);
+            if (fread(i->resident, 1, i->resident_size, i->tree) == i->resident_size) {
+                buildDirectTable(i);
+                loadLearnedIndex(i);
+                return;
+            }
+            free(i->resident);
+            i->resident = NULL;
+        }
+        fclose(i->tree);
+        i->tree = NULL;
+    }
+    buildSearchTree(i, NULL);
+}
+
+/**
+ * @brief       Compares a key to a key stored in the #Indexer
  * 
- * @return < 0  If a < b
- * @return 0    If a == b
- * @return > 0  If a > b
+ * @param i     The given #Indexer
+ * @param key   The given key
+ * @param other The key stored in the #Indexer
+ * @param c     The #Cache
+ * 
+ * @return      The result of the comparison (as in @ref directCmp)
  */
-int compareLines(const void* a, const void* b, void* p) {
-    IndexerCachePair pair = (IndexerCachePair)p;
-    return pair->indexer->cmpKeys(pair->indexer->keys, ((LINE*)a)->key,
-           pair->indexer->keys, ((LINE*)b)->key, pair->cache);
+static int cmpStoredKey(Indexer i, pos_t key, pos_t other, Cache c) {
+    return i->direct_keys ? directCmp(NULL, key, NULL, other, NULL) : i->cmpKeys(NULL, key, i->keys, other, c);
+}
+
+/**
+ * @brief       Finds the first position of the index whose key is not smaller than the given key
+ * 
+ *              Descends the search tree (in memory for the resident levels, one #Cache line per level otherwise)
+ *              to the block holding the position, then binary searches that block only
+ * 
+ * @param i     The given #Indexer (with a search tree)
+ * @param key   The given key
+ * @param c     The #Cache
+ * 
+ * @return      The requested position (the number of elements if every key is smaller)
+ */
+static int searchTree(Indexer i, pos_t key, Cache c) {
+    pos_t buffer[TREE_NODE_KEYS], *keys;
+    int node = 0;
+
+    for (int l = i->tree_height - 1; l >= 0; l--) {
+        int count = i->tree_count[l] - node * TREE_NODE_KEYS;
+        if (count > TREE_NODE_KEYS)
+            count = TREE_NODE_KEYS;
+
+        pos_t pos = i->tree_level[l] + (pos_t)node * CACHE_LINE_SIZE;
+        if (pos < i->resident_size)
+            keys = i->resident + pos / sizeof(pos_t);
+        else {
+            getStr(c, i->tree, pos, (char*)buffer, count * sizeof(pos_t));
+            ADD_METRIC(METRIC_INDEX_READS, 1);
+            keys = buffer;
+        }
+
+        int lo = 0, hi = count;
+        while (lo < hi) {
+            int m = (lo + hi) / 2;
+            if (cmpStoredKey(i, key, keys[m], c) > 0)
+                lo = m + 1;
+            else
+                hi = m;
+        }
+
+        if (lo == count)
+            return i->elem_no;
+        node = node * TREE_NODE_KEYS + lo;
+    }
+
+    int lo = node * TREE_BLOCK_LINES(i), hi = lo + TREE_BLOCK_LINES(i) - 1;
+    if (hi >= i->elem_no)
+        hi = i->elem_no - 1;
+
+    while (lo < hi) {
+        int m = (lo + hi) / 2;
+        if (cmpStoredKey(i, key, getStoredKey(i, m, c), c) > 0)
+            lo = m + 1;
+        else
+            hi = m;
+    }
+    return lo;
 }
 
 /**
@@ -167,12 +1191,21 @@ Indexer makeIndexer(char* index_file, FILE* keys, FILE* values, int (*cmpKeys)(F
     Indexer i = malloc(sizeof(struct indexer));
     i->index = index_file == NULL ? tmpfile() : OPEN_FILE(index_file, "wb+");
     i->elem_no = 0;
+    i->line_size = getLineSize(keys);
     i->index_name = index_file == NULL ? NULL : strdup(index_file);
     i->changed_since_cache_refresh = false;
+    pthread_mutex_init(&i->flush_mutex, NULL);
     i->keys = keys;
     i->cmpKeys = cmpKeys;
+    i->direct_keys = cmpKeys == directCmp;
     i->values = values;
     i->grouped_values = NULL;
+    i->tree = NULL;
+    i->resident = NULL;
+    i->direct = NULL;
+    i->segments = NULL;
+    i->tree_height = 0;
+    resetScan(i);
     return i;
 }
 
@@ -192,10 +1225,12 @@ Indexer parseIndexer(char* index_file, FILE* keys, FILE* values, int (*cmpKeys)(
     Indexer i = malloc(sizeof(struct indexer));
     i->keys = keys;
     i->cmpKeys = cmpKeys;
+    i->direct_keys = cmpKeys == directCmp;
     i->values = values;
     i->grouped_values = NULL;
     i->index_name = index_file == NULL ? NULL : strdup(index_file);
     i->changed_since_cache_refresh = false;
+    pthread_mutex_init(&i->flush_mutex, NULL);
 
     if (index_file == NULL)
         i->index = tmpfile();
@@ -203,7 +1238,10 @@ Indexer parseIndexer(char* index_file, FILE* keys, FILE* values, int (*cmpKeys)(
         i->index = OPEN_MAYBE_FILE(index_file, "b");
 
     fseek(i->index, 0, SEEK_END);
-    i->elem_no = ftell(i->index) / sizeof(LINE);
+    i->line_size = getLineSize(keys);
+    i->elem_no = ftell(i->index) / i->line_size;
+    resetScan(i);
+    loadSearchTree(i);
 
     return i;
 }
@@ -225,14 +1263,19 @@ Indexer parseGroupedIndexer(char* index_file, char* values, FILE* keys, FILE* gr
     Indexer i = malloc(sizeof(struct indexer));
     i->keys = keys;
     i->cmpKeys = cmpKeys;
+    i->direct_keys = cmpKeys == directCmp;
     i->values = OPEN_FILE(values, "rb");
     i->grouped_values = grouped_values;
     i->index = OPEN_FILE(index_file, "rb+");
     i->index_name = index_file == NULL ? NULL : strdup(index_file);
     i->changed_since_cache_refresh = false;
+    pthread_mutex_init(&i->flush_mutex, NULL);
 
     fseek(i->index, 0, SEEK_END);
-    i->elem_no = ftell(i->index) / sizeof(LINE);
+    i->line_size = getLineSize(keys);
+    i->elem_no = ftell(i->index) / i->line_size;
+    resetScan(i);
+    loadSearchTree(i);
 
     return i;
 }
@@ -240,15 +1283,22 @@ Indexer parseGroupedIndexer(char* index_file, char* values, FILE* keys, FILE* gr
 /**
  * @brief   Flushes the #Indexer, i.e., if you have changed the index file, the #Cache is refreshed
  * 
+ *          Safe to call from concurrent lookups: only the first one flushes, the others wait for it
+ * 
  * @param i The given #Indexer
  * @param c The #Cache to refresh
  */
 void flushIndex(Indexer i, Cache c) {
+    if (!__atomic_load_n(&i->changed_since_cache_refresh, __ATOMIC_ACQUIRE))
+        return;
+
+    pthread_mutex_lock(&i->flush_mutex);
     if (i->changed_since_cache_refresh) {
         fflush(i->index);
         refreshCacheFile(c, i->index);
-        i->changed_since_cache_refresh = false;
+        __atomic_store_n(&i->changed_since_cache_refresh, false, __ATOMIC_RELEASE);
     }
+    pthread_mutex_unlock(&i->flush_mutex);
 }
 
 /**
@@ -258,129 +1308,407 @@ void flushIndex(Indexer i, Cache c) {
  * @param key   The given key
  * @param value The given value
  */
-void insertIntoIndex(Indexer i, pos_t key, pos_t value) {
-    fseek(i->index, i->elem_no * sizeof(LINE), SEEK_SET);
-    LINE l = { .key = key, .value = value };
-    fwrite(&l, sizeof(LINE), 1, i->index);
-    i->changed_since_cache_refresh = true;
-    i->elem_no++;
+void insertIntoIndex(Indexer i, pos_t key, pos_t value) {
+    fseek(i->index, (pos_t)i->elem_no * i->line_size, SEEK_SET);
+    LINE l = { .key = key, .value = value };
+    writeLines(i, i->index, &l, 1);
+    i->changed_since_cache_refresh = true;
+    i->elem_no++;
+    i->tree_height = 0;
+    if (i->direct != NULL || i->segments != NULL) {
+        free(i->direct);
+        free(i->segments);
+        i->direct = NULL;
+        i->segments = NULL;
+    }
+}
+
+/**
+ * @brief           Sorts the lines of an #Indexer
+ * 
+ *                  The index is split into runs of at most @ref MAX_FILE_LINES lines in total per batch (fewer if the
+ *                  memory budget is short, see @ref acquireMemory), sorted in parallel, then merged with a #LoserTree.
+ *                  Runs not fitting in memory at once are spilled to temporary files and read back in blocks of
+ *                  @ref MERGE_BLOCK_LINES lines
+ * 
+ * @param i         The given #Indexer (with more than one line)
+ * @param c         The #Cache to use when comparing keys
+ * @param g         The #GroupBuilder the sorted lines are added to (NULL to write them back to the index file)
+ * @param by_value  Whether lines with the same key are sorted by their values
+ */
+static void sortLines(Indexer i, Cache c, GroupBuilder g, bool by_value) {
+    fflush(i->index);
+    fseek(i->index, 0, SEEK_SET);
+
+    INDEXERCACHEPAIR p = { .indexer = i, .cache = c, .by_value = by_value };
+    int threads = getSortThreads();
+    pos_t wanted = MIN((pos_t)i->elem_no + threads, MAX_FILE_LINES);
+    size_t memory = acquireMemory(wanted * sizeof(LINE), threads * MERGE_BLOCK_LINES * sizeof(LINE));
+    pos_t run_lines = memory / sizeof(LINE) / threads;
+    int k = (i->elem_no + run_lines - 1) / run_lines;
+    int batch = k < threads ? k : threads;
+    bool spill = k > batch;
+
+    LINE* buffer = malloc((i->elem_no / k + 1) * batch * sizeof(LINE));
+    RUN* runs = malloc(k * sizeof(RUN));
+    pthread_t tids[SORT_MAX_THREADS];
+
+    for (int first = 0; first < k; first += batch) {
+        int n = k - first < batch ? k - first : batch;
+        LINE* lines = buffer;
+
+        for (int j = first; j < first + n; j++) {
+            runs[j] = (RUN){ .lines = lines, .size = i->elem_no / k + (i->elem_no % k > j ? 1 : 0),
+                             .pos = 0, .file = NULL, .pair = &p };
+            lines += runs[j].size;
+
+            pos_t read = readLines(i, i->index, runs[j].lines, runs[j].size);
+            if (read != runs[j].size)
+                fprintf(stderr, "sortLines: unexpected number of characters read (read: %lld; expected: %lld)\n", read, runs[j].size);
+        }
+
+        for (int j = 1; j < n; j++)
+            pthread_create(&tids[j], NULL, sortRun, &runs[first + j]);
+        sortRun(&runs[first]);
+        for (int j = 1; j < n; j++)
+            pthread_join(tids[j], NULL);
+
+        for (int j = first; spill && j < first + n; j++) {
+            runs[j].file = tmpfile();
+            writeLines(i, runs[j].file, runs[j].lines, runs[j].size);
+            fseek(runs[j].file, 0, SEEK_SET);
+            runs[j].size = 0;
+        }
+    }
+
+    if (spill) {
+        free(buffer);
+        buffer = NULL;
+        for (int j = 0; j < k; j++) {
+            runs[j].lines = malloc(MERGE_BLOCK_LINES * sizeof(LINE));
+            refillRun(&runs[j]);
+        }
+    }
+
+    fseek(i->index, 0, SEEK_SET);
+    mergeRuns(runs, k, &p, i->index, g);
+
+    for (int j = 0; spill && j < k; j++) {
+        fclose(runs[j].file);
+        free(runs[j].lines);
+    }
+    free(runs);
+    free(buffer);
+    releaseMemory(memory);
+}
+
+/**
+ * @brief   Sorts the #Indexer (see @ref sortLines)
+ * 
+ * @param i The given #Indexer
+ * @param c The #Cache to use when comparing keys
+ */
+void sortIndexer(Indexer i, Cache c) {
+    i->changed_since_cache_refresh = true;
+    if (i->elem_no > 1)
+        sortLines(i, c, NULL, false);
+    buildSearchTree(i, c);
+}
+
+/**
+ * @brief       Auxiliary function to @ref removeDuplicatesAux
+ * 
+ *              Compares two ::pos_t
+ * 
+ * @param a     The first position
+ * @param b     The second position
+ * 
+ * @return -1   If a < b
+ * @return 0    If a == b
+ * @return > 0  If a > b
+ */
+int compareAux(const void* a, const void* b) {
+    return *(pos_t*)b > *(pos_t*)a ? -1 : *(pos_t*)b < *(pos_t*)a;
+}
+
+/**
+ * @brief Auxiliary function to @ref groupIndexer. Sorts the given array of positions and removes its duplicates
+ *
+ * @param values    The array of positions
+ * @param n         The number of elements in the array
+ *
+ * @return          The new size of the array
+ */
+static int removeDuplicatePositions(pos_t* values, int n) {
+    qsort(values, n, sizeof(pos_t), compareAux);
+
+    int last = 0;
+    for (int i = 1; i < n; i++)
+        if (values[i] != values[last])
+            values[++last] = values[i];
+
+    return last + 1;
+}
+
+/**
+ * @brief           Encodes the values of a group: the difference of each value to the previous one (the first to 0),
+ *                  zigzag mapped (so small negative differences stay small), as a varint of 7 bits per byte, the
+ *                  highest bit set on every byte but the last
+ *
+ * @param values    The values
+ * @param n         The number of values
+ * @param dest      The buffer to write to (at least GROUP_VALUE_MAX_BYTES per value)
+ *
+ * @return          The number of bytes written
+ */
+static int encodeGroupValues(pos_t* values, int n, unsigned char* dest) {
+    unsigned char* p = dest;
+    pos_t last = 0;
+
+    for (int j = 0; j < n; j++) {
+        int64_t delta = (int64_t)(values[j] - last);
+        uint64_t zigzag = ((uint64_t)delta << 1) ^ (uint64_t)(delta >> 63);
+        last = values[j];
+
+        while (zigzag >= 0x80) {
+            *p++ = (unsigned char)(zigzag | 0x80);
+            zigzag >>= 7;
+        }
+        *p++ = (unsigned char)zigzag;
+    }
+
+    return p - dest;
+}
+
+/**
+ * @brief           Decodes the values of a group written by @ref encodeGroupValues
+ *
+ * @param src       The encoded values
+ * @param n         The number of values
+ * @param dest      The array to write the values to
+ */
+static void decodeGroupValues(unsigned char* src, int n, pos_t* dest) {
+    pos_t last = 0;
+
+    for (int j = 0; j < n; j++) {
+        uint64_t zigzag = 0;
+        int shift = 0;
+        while (*src & 0x80) {
+            zigzag |= (uint64_t)(*src++ & 0x7F) << shift;
+            shift += 7;
+        }
+        zigzag |= (uint64_t)*src++ << shift;
+
+        last += (pos_t)((zigzag >> 1) ^ -(zigzag & 1));
+        dest[j] = last;
+    }
+}
+
+/**
+ * @brief                       Auxiliary function to @ref groupIndexer. Writes a group to the values file: its number of
+ *                              values, the number of bytes they were encoded to and the encoded values
+ *                              (see @ref encodeGroupValues)
+ *
+ * @param out                   The values file (written at its current position)
+ * @param values                The values of the group
+ * @param n                     The number of values
+ * @param removeDuplicateVals   Whether or not to remove duplicated values
+ * @param buffer                The auxiliary buffer to encode into (grown if needed)
+ * @param buffer_size           The size of the buffer
+ *
+ * @return                      The number of bytes written
+ */
+static pos_t writeGroup(FILE* out, pos_t* values, int n, bool removeDuplicateVals, unsigned char** buffer, int* buffer_size) {
+    if (removeDuplicateVals)
+        n = removeDuplicatePositions(values, n);
+
+    if (*buffer_size < n * GROUP_VALUE_MAX_BYTES) {
+        *buffer_size = MAX(n * GROUP_VALUE_MAX_BYTES, *buffer_size * 1.5);
+        *buffer = realloc(*buffer, *buffer_size);
+    }
+
+    int header[2] = { n, encodeGroupValues(values, n, *buffer) };
+    fwrite(header, sizeof(int), 2, out);
+    fwrite(*buffer, 1, header[1], out);
+    return sizeof(header) + (pos_t)header[1];
+}
+
+/**
+ * @brief Structure representing a #GroupBuilder
+ */
+struct groupBuilder {
+    Indexer indexer;            ///< The #Indexer grouped
+    Cache cache;                ///< The #Cache used when comparing keys
+    FILE* index;                ///< The file the line of each group (its key and the position of its values) is written to
+    FILE* values;               ///< The file the values of each group are written to (see @ref writeGroup)
+    bool remove_duplicates;     ///< Whether duplicated values are removed from each group
+    bool by_value;              ///< Whether the values of each key are fed in order (so duplicates are next to each other)
+    pos_t* group;               ///< The values of the current group
+    int group_size;             ///< The number of values of the current group
+    int group_capacity;         ///< The number of values allocated
+    pos_t key;                  ///< The key of the current group
+    pos_t out_pos;              ///< The position in the values file of the current group
+    int groups;                 ///< The number of groups
+    LINE* lines;                ///< The lines of the groups not yet written to the index file
+    int line_no;                ///< The number of those lines
+    unsigned char* buffer;      ///< The buffer the values of a group are encoded into
+    int buffer_size;            ///< The size of the buffer
+};
+
+/**
+ * @brief                       Starts grouping the lines of an #Indexer
+ *
+ * @param g                     The #GroupBuilder
+ * @param i                     The given #Indexer
+ * @param index                 The file the line of each group is written to
+ * @param values                The file the values of each group are written to
+ * @param removeDuplicateVals   Whether or not to remove duplicated values
+ * @param by_value              Whether the lines with the same key are fed ordered by their values
+ * @param c                     The #Cache used when comparing keys
+ */
+static void initGroupBuilder(GroupBuilder g, Indexer i, FILE* index, FILE* values, bool removeDuplicateVals, bool by_value,
+                             Cache c) {
+    *g = (GROUPBUILDER){ .indexer = i, .cache = c, .index = index, .values = values, .remove_duplicates = removeDuplicateVals,
+                         .by_value = by_value, .group_capacity = MERGE_BLOCK_LINES };
+    g->group = malloc(g->group_capacity * sizeof(pos_t));
+    g->lines = malloc(MERGE_BLOCK_LINES * sizeof(LINE));
+    fseek(index, 0, SEEK_SET);
+    fseek(values, 0, SEEK_SET);
 }
 
 /**
- * @brief   Sorts the #Indexer
- * 
- * @param i The given #Indexer
- * @param c The #Cache to use when comparing keys
+ * @brief       Writes the values of the current group of a #GroupBuilder (duplicates were already skipped if the values
+ *              came in order)
+ *
+ * @param g     The given #GroupBuilder
  */
-void sortIndexer(Indexer i, Cache c) {
-    fseek(i->index, 0, SEEK_SET);
-    fflush(i->index);
-    pos_t size, k = (i->elem_no + MAX_FILE_LINES - 1) / MAX_FILE_LINES;
-    LINE* buffer = malloc(i->elem_no / k * sizeof(LINE));
-    FILE** tmp_files = malloc(k * sizeof(FILE*));
-    int j = 0;
+static void endGroup(GroupBuilder g) {
+    if (g->group_size == 0)
+        return;
 
-    for (pos_t l = 0; l < i->elem_no; l += size) {
-        tmp_files[j] = tmpfile();
-        size = i->elem_no / k + (i->elem_no % k > j ? 1 : 0);
+    g->out_pos += writeGroup(g->values, g->group, g->group_size, g->remove_duplicates && !g->by_value, &g->buffer,
+                             &g->buffer_size);
+    g->group_size = 0;
+}
 
-        int read = fread(buffer, sizeof(LINE), size, i->index);
-        if (read != size)
-            fprintf(stderr, "sortIndexer: unexpected number of characters read (read: %d; expected: %lld)\n", read, size);
-        
-        INDEXERCACHEPAIR p = { .indexer = i, .cache = c };
-        qsort_r(buffer, size, sizeof(LINE), compareLines, &p);
+/**
+ * @brief       Adds the next line of an #Indexer (in the order of its keys) to the groups of a #GroupBuilder
+ *
+ * @param g     The given #GroupBuilder
+ * @param l     The line
+ */
+static void addGroupLine(GroupBuilder g, LINE l) {
+    if (g->group_size > 0) {
+        Indexer i = g->indexer;
+        int cmp = i->cmpKeys(i->keys, l.key, i->keys, g->key, g->cache);
+        if (cmp < 0)
+            fprintf(stderr, "addGroupLine: indexer must be sorted\n");
 
-        fwrite(buffer, sizeof(LINE), size, tmp_files[j++]);
+        if (cmp != 0)
+            endGroup(g);
+        else if (g->by_value && g->remove_duplicates && l.value == g->group[g->group_size - 1])
+            return;
     }
-    
-    HEAP h;
-    h.heap = malloc(k * sizeof(int));
-    h.values = malloc(k * sizeof(LINE));
-    h.size = 0;
 
-    for (int j = 0; j < k; j++) {
-        fseek(tmp_files[j], 0, SEEK_SET);
-        if (fread(&h.values[j], sizeof(LINE), 1, tmp_files[j]))
-            pushHeap(&h, i, c, j);
+    if (g->group_size == 0) {
+        g->lines[g->line_no++] = (LINE){ .key = l.key, .value = g->out_pos };
+        if (g->line_no == MERGE_BLOCK_LINES) {
+            writeLines(g->indexer, g->index, g->lines, g->line_no);
+            g->line_no = 0;
+        }
+        g->key = l.key;
+        g->groups++;
     }
 
-    fseek(i->index, 0, SEEK_SET);
-
-    while (h.size) {
-        //TODO: function replaceHeap to speed up pop + push
-        int branch = popHeap(&h, i, c);
-        fwrite(&h.values[branch], sizeof(LINE), 1, i->index);
-        
-        if (fread(&h.values[branch], sizeof(LINE), 1, tmp_files[branch]))
-            pushHeap(&h, i, c, branch);
+    if (g->group_size == g->group_capacity) {
+        g->group_capacity *= 2;
+        g->group = realloc(g->group, g->group_capacity * sizeof(pos_t));
     }
-
-    for (int j = 0; j < k; j++)
-        fclose(tmp_files[j]);
-
-    i->changed_since_cache_refresh = true;
-    free(tmp_files);
-    free(h.values);
-    free(h.heap);
-    free(buffer);
+    g->group[g->group_size++] = l.value;
 }
 
 /**
- * @brief       Auxiliary function to @ref removeDuplicatesAux
- * 
- *              Compares two ::pos_t
- * 
- * @param a     The first position
- * @param b     The second position
- * 
- * @return -1   If a < b
- * @return 0    If a == b
- * @return > 0  If a > b
+ * @brief       Writes what is left of the groups of a #GroupBuilder and frees its buffers
+ *
+ * @param g     The given #GroupBuilder
+ *
+ * @return      The number of groups
  */
-int compareAux(const void* a, const void* b) {
-    return *(pos_t*)b > *(pos_t*)a ? -1 : *(pos_t*)b < *(pos_t*)a;
+static int finishGroupBuilder(GroupBuilder g) {
+    endGroup(g);
+    writeLines(g->indexer, g->index, g->lines, g->line_no);
+    free(g->lines);
+    free(g->group);
+    free(g->buffer);
+    return g->groups;
 }
 
 /**
- * @brief Auxiliary function to @ref groupIndexer. Removes the duplicates from the given array of positions
- * 
- * @param f         The given file
- * @param pos       The starting position in the file
- * @param elems     The number of elements in a block
- * @param aux       The auxiliary array
- * @param aux_size  The number of elements in the array
- * 
- * @return          The new size of the array
+ * @brief               Opens the files a grouped #Indexer is written to: the values file and the file taking the place
+ *                      of its index once the groups are written (see @ref replaceGroupedIndex)
+ *
+ * @param i             The given #Indexer
+ * @param value_file    The path to the file that is to contain the values (NULL for a temporary file)
+ * @param dest          Set to the file of the new index
+ * @param dest_name     Set to the path of the file of the new index (NULL if it is a temporary file)
+ * @param c             The #Cache the values file is registered in
+ *
+ * @return              The values file
  */
-int removeDuplicatesAux(FILE* f, pos_t pos, int elems, pos_t** aux, int *aux_size) {
-    if (*aux == NULL) {
-        *aux = malloc(sizeof(pos_t) * elems);
-        *aux_size = elems;
-    } else if (*aux_size < elems) {
-        *aux_size = MAX(elems, *aux_size * 1.5);
-        *aux = realloc(*aux, sizeof(pos_t) * *aux_size);
+static FILE* openGroupFiles(Indexer i, char* value_file, FILE** dest, char** dest_name, Cache c) {
+    FILE* out = value_file == NULL ? tmpfile() : OPEN_FILE(value_file, "wb+");
+    registerCacheFile(c, out, CACHE_BIG_LINE_SIZE);
+
+    *dest_name = NULL;
+    if (i->index_name == NULL)
+        *dest = tmpfile();
+    else {
+        *dest_name = malloc(strlen(i->index_name) + 5);
+        sprintf(*dest_name, "%s.tmp", i->index_name);
+        *dest = OPEN_FILE(*dest_name, "wb+");
     }
+    return out;
+}
 
-    fseek(f, pos, SEEK_SET);
-    int read = fread(*aux, sizeof(pos_t), elems, f);
-    if (read != elems)
-        fprintf(stderr, "removeDuplicatesAux: unexpected number of objects read (read: %d; expected: %d)\n", read, elems);
-    qsort(*aux, elems, sizeof(pos_t), compareAux);
+/**
+ * @brief               Replaces the index of an #Indexer by the lines of its groups, once they are written
+ *
+ * @param i             The given #Indexer
+ * @param dest          The file of the new index (see @ref openGroupFiles)
+ * @param dest_name     The path to the file of the new index (NULL if it is a temporary file)
+ * @param out           The values file
+ * @param groups        The number of groups
+ * @param c             The #Cache
+ */
+static void replaceGroupedIndex(Indexer i, FILE* dest, char* dest_name, FILE* out, int groups, Cache c) {
+    cancelPrefetchFile(c, i->index);
+    fclose(i->index);
+    resetScan(i);
 
-    int last = 0;
+    if (i->index_name == NULL)
+        i->index = dest;
+    else {
+        fclose(dest);
+        remove(i->index_name);
+        rename(dest_name, i->index_name);
+        i->index = OPEN_FILE(i->index_name, "rb+");
+    }
 
-    for (int i = 1; i < elems; i++)
-        if ((*aux)[i] != (*aux)[last])
-            (*aux)[++last] = (*aux)[i];
+    i->elem_no = groups;
+    i->changed_since_cache_refresh = true;
+    i->grouped_values = i->values;
+    i->values = out;
+    fflush(out);
+    free(dest_name);
 
-    fseek(f, pos, SEEK_SET);
-    fwrite(*aux, sizeof(pos_t), last + 1, f);
-    return last + 1;
+    buildSearchTree(i, c);
 }
 
 /**
  * @brief                       Groups an #Indexer, i.e., joins all elements with the same key in the same group
+ *
+ *                              The values of each group are delta and varint encoded (see @ref writeGroup), and are read
+ *                              back with @ref getGroupElems
  * 
  * @warning                     #Indexer must be sorted
  * 
@@ -392,99 +1720,177 @@ int removeDuplicatesAux(FILE* f, pos_t pos, int elems, pos_t** aux, int *aux_siz
  * @param c                     The #Cache used when comparing keys
  */
 void groupIndexer(Indexer i, char* value_file, bool removeDuplicateVals, Cache c) {
-    FILE *dest, *out = value_file == NULL ? tmpfile() : OPEN_FILE(value_file, "wb+");
-    char* dest_name = NULL;
+    FILE* dest;
+    char* dest_name;
+    FILE* out = openGroupFiles(i, value_file, &dest, &dest_name, c);
 
-    if (i->index_name == NULL)
-        dest = tmpfile();
+    GROUPBUILDER g;
+    initGroupBuilder(&g, i, dest, out, removeDuplicateVals, false, c);
+
+    LINE* lines = malloc(MERGE_BLOCK_LINES * sizeof(LINE));
+    pos_t read, total = 0;
+    fflush(i->index);
+    fseek(i->index, 0, SEEK_SET);
+    while (total < (pos_t)i->elem_no && (read = readLines(i, i->index, lines, MIN(MERGE_BLOCK_LINES, i->elem_no - total))) > 0) {
+        for (pos_t j = 0; j < read; j++)
+            addGroupLine(&g, lines[j]);
+        total += read;
+    }
+    free(lines);
+
+    if (total != (pos_t)i->elem_no)
+        fprintf(stderr, "groupIndexer: unexpected number of objects read (read: %lld; expected: %d)\n", total, i->elem_no);
+    replaceGroupedIndex(i, dest, dest_name, out, finishGroupBuilder(&g), c);
+}
+
+/**
+ * @brief                       Sorts and groups an #Indexer in a single pass (see @ref sortIndexer and
+ *                              @ref groupIndexer): the lines merged from the sorted runs are grouped as they come out,
+ *                              so the sorted index is never written and read back. When duplicated values are removed,
+ *                              the lines with the same key are sorted by their values, so duplicates are skipped as they
+ *                              are merged instead of sorting each group again
+ *
+ * @note                        Decreases the size of #Indexer
+ *
+ * @param i                     The given #Indexer
+ * @param value_file            The path to the file that is to contain the values
+ * @param removeDuplicateVals   Whether or not to remove duplicated values
+ * @param c                     The #Cache used when comparing keys
+ */
+void sortAndGroupIndexer(Indexer i, char* value_file, bool removeDuplicateVals, Cache c) {
+    if (i->elem_no <= 1) {
+        groupIndexer(i, value_file, removeDuplicateVals, c);
+        return;
+    }
+
+    FILE* dest;
+    char* dest_name;
+    FILE* out = openGroupFiles(i, value_file, &dest, &dest_name, c);
+
+    GROUPBUILDER g;
+    initGroupBuilder(&g, i, dest, out, removeDuplicateVals, removeDuplicateVals, c);
+    sortLines(i, c, &g, removeDuplicateVals);
+    replaceGroupedIndex(i, dest, dest_name, out, finishGroupBuilder(&g), c);
+}
+
+/**
+ * @brief       Merges two sorted files of lines of an #Indexer into the given file (ties keep the lines of the first file first)
+ *
+ * @param a     The first file, read from its start
+ * @param b     The second file, read from its start
+ * @param pair  The #Indexer and #Cache used to compare lines
+ * @param out   The file to write the merged lines to, from its start (unused if they are grouped)
+ * @param g     The #GroupBuilder the merged lines are added to (NULL to write them to the file)
+ */
+static void mergeLineFiles(FILE* a, FILE* b, IndexerCachePair pair, FILE* out, GroupBuilder g) {
+    RUN runs[2];
+    FILE* files[2] = { a, b };
+
+    for (int j = 0; j < 2; j++) {
+        fflush(files[j]);
+        fseek(files[j], 0, SEEK_SET);
+        runs[j] = (RUN){ .lines = malloc(MERGE_BLOCK_LINES * sizeof(LINE)), .size = 0, .pos = 0, .file = files[j], .pair = pair };
+        refillRun(&runs[j]);
+    }
+
+    if (g != NULL)
+        mergeRuns(runs, 2, pair, NULL, g);
     else {
-        int filename_size = strlen(i->index_name);
-        dest_name = malloc(filename_size + 5);
-        sprintf(dest_name, "%s.tmp", i->index_name);
-        dest = OPEN_FILE(dest_name, "wb+");
+        fseek(out, 0, SEEK_SET);
+        mergeRuns(runs, 2, pair, out, NULL);
+        fflush(out);
     }
 
-    if (i->elem_no != 0) {
-        LINE l;
-        int block_no = 1, block_length = 1;
+    free(runs[0].lines);
+    free(runs[1].lines);
+}
 
-        pos_t out_block = 0;
-        pos_t out_pos = sizeof(int);
+/**
+ * @brief       Merges a sorted #Indexer into another sorted #Indexer over the same keys and values files
+ *
+ *              Ties keep the lines of the given #Indexer first so, as long as delta indexes the records appended
+ *              after the ones the given #Indexer indexes, the result is the index the records would have had if the
+ *              #Indexer had been built with all of them at once
+ *
+ * @param i     The given #Indexer (sorted, not grouped)
+ * @param delta The sorted #Indexer to merge (left untouched)
+ * @param c     The #Cache
+ */
+void mergeIndexer(Indexer i, Indexer delta, Cache c) {
+    if (delta->elem_no == 0)
+        return;
 
-        pos_t* aux = NULL;
-        int aux_size;
+    INDEXERCACHEPAIR p = { .indexer = i, .cache = c };
+    FILE* merged = tmpfile();
+    mergeLineFiles(i->index, delta->index, &p, merged, NULL);
 
-        fflush(i->index);
-        fseek(i->index, 0, SEEK_SET);
-        fseek(out, sizeof(int), SEEK_SET);
-
-        int read = fread(&l, sizeof(LINE), 1, i->index);
-        if (read != 1)
-            fprintf(stderr, "groupIndexer: unexpected number of objects read (read: %d; expected: 1)\n", read);
-        LINE l_out = { .key = l.key, .value = out_block };
-        fwrite(&l_out, sizeof(LINE), 1, dest);
-        pos_t last_key = l.key;
-        fwrite(&l.value, sizeof(pos_t), 1, out);
-        out_pos += sizeof(pos_t);
-
-        while (fread(&l, sizeof(LINE), 1, i->index)) {
-            int cmp = i->cmpKeys(i->keys, l.key, i->keys, last_key, c);
-            if (cmp < 0)
-                fprintf(stderr, "groupIndexer: indexer must be sorted\n");
-
-            if (cmp == 0)
-                block_length++;
-            else {
-                if (removeDuplicateVals) {
-                    block_length = removeDuplicatesAux(out, out_block + sizeof(int), block_length, &aux, &aux_size);
-                    out_pos = out_block + sizeof(int) + sizeof(pos_t) * (pos_t)block_length;
-                }
+    char buffer[MERGE_BLOCK_LINES * sizeof(LINE)];
+    size_t read;
 
-                fseek(out, out_block, SEEK_SET);
-                fwrite(&block_length, sizeof(int), 1, out);
-                out_block = out_pos;
-                out_pos += sizeof(int);
-                fseek(out, out_pos, SEEK_SET);
-
-                l_out = (LINE){ .key = l.key, .value = out_block };
-                fwrite(&l_out, sizeof(LINE), 1, dest);
-                last_key = l.key;
-                block_length = 1;
-                block_no++;
-            }
+    cancelPrefetchFile(c, i->index);
+    fseek(merged, 0, SEEK_SET);
+    fseek(i->index, 0, SEEK_SET);
+    while ((read = fread(buffer, 1, sizeof(buffer), merged)) > 0)
+        fwrite(buffer, 1, read, i->index);
+    fclose(merged);
 
-            fwrite(&l.value, sizeof(pos_t), 1, out);
-            out_pos += sizeof(pos_t);
-        }
+    i->elem_no += delta->elem_no;
+    i->changed_since_cache_refresh = true;
+    resetScan(i);
+    buildSearchTree(i, c);
+}
 
-        if (removeDuplicateVals) {
-            block_length = removeDuplicatesAux(out, out_block + sizeof(int), block_length, &aux, &aux_size);
-            out_pos = out_block + sizeof(int) + sizeof(pos_t) * (pos_t)block_length;
-        }
+/**
+ * @brief                       Merges a sorted #Indexer into a grouped #Indexer over the same keys and grouped values files,
+ *                              grouping the result again as it is merged
+ *
+ *                              The values of each group are kept before the ones merged into it (see @ref mergeIndexer)
+ *
+ * @param i                     The given #Indexer (grouped)
+ * @param delta                 The sorted #Indexer to merge (left untouched)
+ * @param value_file            The path to the file that is to contain the values (the one i was grouped to)
+ * @param removeDuplicateVals   Whether or not to remove duplicated values
+ * @param c                     The #Cache
+ */
+void mergeGroupedIndexer(Indexer i, Indexer delta, char* value_file, bool removeDuplicateVals, Cache c) {
+    if (delta->elem_no == 0)
+        return;
+
+    FILE* lines = tmpfile();
+    LINE l;
 
-        fseek(out, out_block, SEEK_SET);
-        fwrite(&block_length, sizeof(int), 1, out);
+    fflush(i->index);
+    fflush(i->values);
+    fseek(i->index, 0, SEEK_SET);
+    for (int g = 0; g < i->elem_no && readLines(i, i->index, &l, 1) == 1; g++) {
+        int size;
+        pos_t* group = getGroupElems(i, l.value, &size, c);
 
-        i->elem_no = block_no;
-        free(aux);
+        for (int j = 0; j < size; j++) {
+            LINE line = { .key = l.key, .value = group[j] };
+            writeLines(i, lines, &line, 1);
+        }
+        free(group);
     }
 
-    fclose(i->index);
+    cancelPrefetchFile(c, i->values);
+    unmapCacheFile(c, i->values);
+    clearCacheFile(c, i->values);
+    fclose(i->values);
+    i->values = i->grouped_values;
+    i->grouped_values = NULL;
 
-    if (i->index_name == NULL)
-        i->index = dest;
-    else {
-        fclose(dest);
-        remove(i->index_name);
-        rename(dest_name, i->index_name);
-        i->index = OPEN_FILE(i->index_name, "rb+");
-    }
+    FILE* dest;
+    char* dest_name;
+    FILE* out = openGroupFiles(i, value_file, &dest, &dest_name, c);
 
-    i->changed_since_cache_refresh = true;
-    i->grouped_values = i->values;
-    i->values = out;
-    fflush(out);
-    free(dest_name);
+    GROUPBUILDER g;
+    INDEXERCACHEPAIR p = { .indexer = i, .cache = c };
+    initGroupBuilder(&g, i, dest, out, removeDuplicateVals, false, c);
+    mergeLineFiles(lines, delta->index, &p, NULL, &g);
+    fclose(lines);
+
+    replaceGroupedIndex(i, dest, dest_name, out, finishGroupBuilder(&g), c);
 }
 
 /**
@@ -501,7 +1907,19 @@ int getElemNumber(Indexer i) {
 }
 
 /**
- * @brief       Returns the position of the key in the list of keys
+ * @brief       Counts a search of an #Indexer, by the keys it read (at least 1, the direct tables included)
+ * 
+ * @param reads The number of keys read from the index files of the calling thread before the search
+ */
+static inline void countKeyLookup(long reads) {
+    long probes = MAX(1, getThreadMetric(METRIC_INDEX_READS) - reads);
+    ADD_METRIC(METRIC_KEY_LOOKUPS, 1);
+    ADD_METRIC(METRIC_KEY_PROBES, probes);
+    ADD_HISTOGRAM(HISTOGRAM_KEY_PROBES, probes);
+}
+
+/**
+ * @brief       Finds the position of the key in the list of keys (see @ref retrieveKey)
  * 
  * @param i     The given #Indexer
  * @param key   The given key
@@ -510,17 +1928,36 @@ int getElemNumber(Indexer i) {
  * @return -1   If the key was not found
  * @return      The position of the key (0-indexed)
  */
-int retrieveKey(Indexer i, pos_t key, Cache c) {
+static int findKey(Indexer i, pos_t key, Cache c) {
     flushIndex(i, c);
+    key = getIndexedKey(i, key);
 
     if (i->elem_no == 0)
         return -1;  //NOT FOUND
 
+    if (i->direct != NULL) {
+        bool found;
+        int pos = lookupDirectTable(i, key, &found);
+        return found ? pos : -1;
+    }
+
+    if (i->segments != NULL) {
+        int pos = searchLearnedIndex(i, key, c);
+        return pos < i->elem_no && getStoredKey(i, pos, c) == key ? pos : -1;
+    }
+
+    if (i->tree_height > 0) {
+        int pos = searchTree(i, key, c);
+        if (pos < i->elem_no && cmpStoredKey(i, key, getStoredKey(i, pos, c), c) == 0)
+            return pos;
+        return -1;  //NOT FOUND
+    }
+
     int l = 0, r = i->elem_no - 1, m;
     pos_t aux;
 
     while (m = (l + r) / 2, l < r) {
-        aux = getPosT(c, i->index, m * sizeof(LINE));
+        aux = getStoredKey(i, m, c);
         int cmp = i->cmpKeys(NULL, key, i->keys, aux, c);
 
         if (cmp < 0)
@@ -531,7 +1968,7 @@ int retrieveKey(Indexer i, pos_t key, Cache c) {
             r = m;
     }
 
-    aux = getPosT(c, i->index, l * sizeof(LINE));
+    aux = getStoredKey(i, l, c);
     if (i->cmpKeys(NULL, key, i->keys, aux, c) == 0)
         return l;
     else
@@ -539,10 +1976,24 @@ int retrieveKey(Indexer i, pos_t key, Cache c) {
 }
 
 /**
- * @brief       Retrieves a lower bound of the position of the given key
+ * @brief       Returns the position of the key in the list of keys
  * 
- *              This means if the key exists, returns the key itself and if it doesn't returns the
- *              position of the key immediately after
+ * @param i     The given #Indexer
+ * @param key   The given key
+ * @param c     The #Cache
+ * 
+ * @return -1   If the key was not found
+ * @return      The position of the key (0-indexed)
+ */
+int retrieveKey(Indexer i, pos_t key, Cache c) {
+    long reads = getThreadMetric(METRIC_INDEX_READS);
+    int pos = findKey(i, key, c);
+    countKeyLookup(reads);
+    return pos;
+}
+
+/**
+ * @brief       Finds a lower bound of the position of the given key (see @ref retrieveKeyLowerBound)
  * 
  * @param i     The given #Indexer
  * @param key   The given key
@@ -550,19 +2001,31 @@ int retrieveKey(Indexer i, pos_t key, Cache c) {
  * 
  * @return      The smallest position lower-bounded by the given key
  */
-int retrieveKeyLowerBound(Indexer i, pos_t key, Cache c) {
+static int findKeyLowerBound(Indexer i, pos_t key, Cache c) {
 
     flushIndex(i, c);
+    key = getIndexedKey(i, key);
 
     if (i->elem_no == 0)
         return 0;
 
+    if (i->direct != NULL) {
+        bool found;
+        return lookupDirectTable(i, key, &found);
+    }
+
+    if (i->segments != NULL)
+        return searchLearnedIndex(i, key, c);
+
+    if (i->tree_height > 0)
+        return searchTree(i, key, c);
+
     int l = 0, r = i->elem_no - 1, m;
     pos_t aux;
 
     while (m = (l + r) / 2, l < r) {
 
-        aux = getPosT(c, i->index, m * sizeof(LINE));
+        aux = getStoredKey(i, m, c);
         int cmp = i->cmpKeys(NULL, key, i->keys, aux, c);
 
         if (cmp < 0)
@@ -573,13 +2036,32 @@ int retrieveKeyLowerBound(Indexer i, pos_t key, Cache c) {
             r = m;
     }
 
-    aux = getPosT(c, i->index, l * sizeof(LINE));
+    aux = getStoredKey(i, l, c);
     if (i->cmpKeys(NULL, key, i->keys, aux, c) <= 0)
         return l;
     else
         return l + 1;
 }
 
+/**
+ * @brief       Retrieves a lower bound of the position of the given key
+ * 
+ *              This means if the key exists, returns the key itself and if it doesn't returns the
+ *              position of the key immediately after
+ * 
+ * @param i     The given #Indexer
+ * @param key   The given key
+ * @param c     The #Cache
+ * 
+ * @return      The smallest position lower-bounded by the given key
+ */
+int retrieveKeyLowerBound(Indexer i, pos_t key, Cache c) {
+    long reads = getThreadMetric(METRIC_INDEX_READS);
+    int pos = findKeyLowerBound(i, key, c);
+    countKeyLookup(reads);
+    return pos;
+}
+
 /**
  * @brief               Returns the key in the given position 
  * 
@@ -597,7 +2079,8 @@ pos_t retrieveEmbeddedKey(Indexer i, int key_order, Cache c)
     }
 
     flushIndex(i, c);
-    return getPosT(c, i->index, key_order * sizeof(LINE));
+    noteRetrieval(i, key_order, c);
+    return getStoredKey(i, key_order, c);
 }
 
 /**
@@ -617,7 +2100,77 @@ pos_t retrieveEmbeddedValue(Indexer i, int key_order, Cache c)
     }
 
     flushIndex(i, c);
-    return getPosT(c, i->index, key_order * sizeof(LINE) + sizeof(pos_t));
+    noteRetrieval(i, key_order, c);
+    return getStoredValue(i, key_order, c);
+}
+
+/**
+ * @brief               Returns the keys and values of consecutive positions of a sorted #Indexer, reading the lines of
+ *                      the index they are in at once
+ * 
+ * @param i             The given #Indexer
+ * @param from          The first position
+ * @param n             The number of positions
+ * @param keys          The array to write the embedded keys to (NULL if they are not needed)
+ * @param values        The array to write the embedded values to (NULL if they are not needed)
+ * @param c             The #Cache
+ * 
+ * @return              The number of positions read (0 if the range is out of bounds)
+ */
+int retrieveLines(Indexer i, int from, int n, pos_t* keys, pos_t* values, Cache c)
+{
+    if (from < 0 || n < 0 || from + n > i->elem_no) {
+        fprintf(stderr, "retrieveLines: range [%d, %d) is out of bounds\n", from, from + n);
+        return 0;
+    }
+
+    flushIndex(i, c);
+    LINE* lines = malloc(n * sizeof(LINE));
+    getStr(c, i->index, (pos_t)from * i->line_size, (char*)lines, n * i->line_size);
+    if (i->line_size != sizeof(LINE))
+        unpackLines(lines, n);
+
+    for (int j = 0; j < n; j++) {
+        if (keys != NULL)
+            keys[j] = lines[j].key;
+        if (values != NULL)
+            values[j] = lines[j].value;
+    }
+    free(lines);
+    return n;
+}
+
+/**
+ * @brief               Gets the file the values of an #Indexer point into
+ * 
+ * @param i             The given #Indexer
+ * 
+ * @return              The values file (NULL if the values are embedded)
+ */
+FILE* getValuesFile(Indexer i) {
+    return i->values;
+}
+
+/**
+ * @brief               Gets the files of an #Indexer read through the #Cache: the index file, and the grouped values and
+ *                      search tree files, if any
+ * 
+ * @param i             The given #Indexer
+ * @param files         Where to write the files (room for @ref INDEXER_MAX_FILES)
+ * 
+ * @return              The number of files written
+ */
+int getIndexerFiles(Indexer i, FILE* files[]) {
+    int n = 0;
+    files[n++] = i->index;
+
+    if (i->grouped_values != NULL)
+        files[n++] = i->values;
+
+    if (i->tree != NULL)
+        files[n++] = i->tree;
+
+    return n;
 }
 
 /**
@@ -719,45 +2272,160 @@ int getGroupSize(Indexer i, pos_t group, Cache c)
 }
 
 /**
- * @brief           Gets the element in the given position of the given group
- * 
+ * @brief           Gets the elements of the given group, in the order they were grouped in
+ *
  * @param i         The given #Indexer
  * @param group     The given group
- * @param elem      The index of the element
+ * @param size      Set to the size of the group
  * @param c         The #Cache
- * 
- * @return          The requested element
+ *
+ * @return          The elements (to be freed by the caller), NULL if the group is empty
  */
-pos_t getGroupElem(Indexer i, pos_t group, int elem, Cache c)
+pos_t* getGroupElems(Indexer i, pos_t group, int* size, Cache c)
 {
+    *size = 0;
     if (i->values == NULL) {
-        fprintf(stderr, "getGroupElem: the value mustn't be embedded\n");
-        return 0;
+        fprintf(stderr, "getGroupElems: the value mustn't be embedded\n");
+        return NULL;
     }
 
-    return getPosT(c, i->values, group + sizeof(int) + sizeof(pos_t) * (pos_t)elem);
+    int header[2];
+    getStr(c, i->values, group, (char*)header, sizeof(header));
+    if (header[0] <= 0)
+        return NULL;
+
+    //The group is read at once, so load big ones in a single request
+    pos_t start = group + sizeof(header);
+    if (header[1] > CACHE_LINE_SIZE)
+        prefetchRange(c, i->values, start, start + (pos_t)header[1]);
+
+    unsigned char* encoded = malloc(header[1]);
+    pos_t* elems = malloc(header[0] * sizeof(pos_t));
+    getStr(c, i->values, start, (char*)encoded, header[1]);
+    decodeGroupValues(encoded, header[0], elems);
+    free(encoded);
+
+    *size = header[0];
+    return elems;
 }
 
 /**
- * @brief           Gets the element in the given position of the given group as a #Lazy
+ * @brief           Loads an element of a group (see @ref getGroupElems) as a #Lazy
  * 
  * @param i         The given #Indexer
- * @param group     The given group
- * @param elem      The index of the element
- * @param c         The #Cache
+ * @param elem      The element
  * @param dest      The destination #Lazy
- * 
- * @return          The requested element
  */
-void getGroupElemAsLazy(Indexer i, pos_t group, int elem, Cache c, Lazy dest)
+void getGroupElemAsLazy(Indexer i, pos_t elem, Lazy dest)
 {
     if (i->grouped_values == NULL) {
         fprintf(stderr, "getGroupElemAsLazy: the grouped value mustn't be embedded\n");
         return;
     }
 
-    pos_t pos = getGroupElem(i, group, elem, c);
-    setLazyAddress(dest, i->grouped_values, pos);
+    setLazyAddress(dest, i->grouped_values, elem);
+}
+
+/**
+ * @brief The arguments of a partition of @ref scanIndexerRange
+ */
+typedef struct scanPartition {
+    Indexer indexer;    ///< The #Indexer scanned
+    int from;           ///< The first position of the partition
+    int to;             ///< The position after the last position of the partition
+    int part;           ///< The number of the partition
+    IndexerScan scan;   ///< The function scanning the partition
+    void* state;        ///< The state passed to the function
+} SCANPARTITION;
+
+/**
+ * @brief   Used with pthread_create to scan a partition of @ref scanIndexerRange
+ * 
+ * @param p The #SCANPARTITION
+ * 
+ * @return  Always returns NULL (required by pthread_create thread_start prototype)
+ */
+static void* scanPartition(void* p) {
+    SCANPARTITION* s = (SCANPARTITION*)p;
+    s->scan(s->indexer, s->from, s->to, s->part, s->state);
+    return NULL;
+}
+
+/**
+ * @brief       Gets the number of partitions @ref scanIndexerRange splits a range into: one per spare thread
+ *              (see @ref getSpareThreads), as long as each has at least @ref SCAN_PARTITION_MIN_ELEMS positions
+ * 
+ * @param elems The number of positions of the range
+ * 
+ * @return      The number of partitions (at least 1)
+ */
+int getScanPartitions(int elems) {
+    int parts = MIN(getSpareThreads(), SCAN_MAX_THREADS);
+    return MAX(1, MIN(parts, elems / SCAN_PARTITION_MIN_ELEMS));
+}
+
+/**
+ * @brief           Scans the positions [from, to) of the #Indexer in parallel, split into the given number of contiguous
+ *                  partitions (see @ref getScanPartitions), each scanned by its own thread (the first one by the caller)
+ * 
+ *                  Each partition usually fills its own partial aggregate (in the state, indexed by the partition),
+ *                  merged by the caller once this function returns, so the threads never share a #Lazy or a table
+ * 
+ * @param i         The given #Indexer
+ * @param from      The first position of the range
+ * @param to        The position after the last position of the range
+ * @param parts     The number of partitions (at most @ref SCAN_MAX_THREADS)
+ * @param scan      The function scanning a partition, given the #Indexer, its range, its number and the state
+ * @param state     The state passed to the function
+ */
+void scanIndexerRange(Indexer i, int from, int to, int parts, IndexerScan scan, void* state) {
+    parts = MAX(1, MIN(parts, SCAN_MAX_THREADS));
+    if (to < from)
+        to = from;
+
+    SCANPARTITION partitions[SCAN_MAX_THREADS];
+    pthread_t tids[SCAN_MAX_THREADS];
+    long long elems = to - from;
+
+    for (int p = 0; p < parts; p++)
+        partitions[p] = (SCANPARTITION){ .indexer = i, .from = from + (int)(elems * p / parts),
+                                         .to = from + (int)(elems * (p + 1) / parts), .part = p, .scan = scan, .state = state };
+
+    for (int p = 1; p < parts; p++)
+        pthread_create(&tids[p], NULL, scanPartition, &partitions[p]);
+    scanPartition(&partitions[0]);
+    for (int p = 1; p < parts; p++)
+        pthread_join(tids[p], NULL);
+}
+
+/**
+ * @brief   Registers the files of the #Indexer to the pools of the #Cache suiting the way they are read:
+ *          the grouped values file, if any, is read in long runs
+ * 
+ * @param i The given #Indexer
+ * @param c The #Cache
+ */
+void registerIndexer(Indexer i, Cache c) {
+    if (i->grouped_values != NULL)
+        registerCacheFile(c, i->values, CACHE_BIG_LINE_SIZE);
+}
+
+/**
+ * @brief   Serves the index file (and the grouped values and search tree files, if any) of a read-only #Indexer from
+ *          memory mappings of the given #Cache
+ * 
+ * @param i The given #Indexer
+ * @param c The #Cache
+ */
+void mapIndexer(Indexer i, Cache c) {
+    flushIndex(i, c);
+    mapCacheFile(c, i->index, MADV_WILLNEED);
+
+    if (i->grouped_values != NULL)
+        mapCacheFile(c, i->values, MADV_WILLNEED);
+
+    if (i->tree != NULL)
+        mapCacheFile(c, i->tree, MADV_WILLNEED);
 }
 
 /**
@@ -769,11 +2437,18 @@ void getGroupElemAsLazy(Indexer i, pos_t group, int elem, Cache c, Lazy dest)
  * @param c The #Cache to flush to
  */
 void freeIndexer(Indexer i, Cache c) {
-    if (i->grouped_values != NULL)
+    if (i->grouped_values != NULL) {
+        cancelPrefetchFile(c, i->values);
+        unmapCacheFile(c, i->values);
         fclose(i->values);
+    }
 
     flushIndex(i, c);
+    closeSearchTree(i, c);
+    cancelPrefetchFile(c, i->index);
+    unmapCacheFile(c, i->index);
     fclose(i->index);
+    pthread_mutex_destroy(&i->flush_mutex);
     free(i->index_name);
     free(i);
 }
\ No newline at end of file
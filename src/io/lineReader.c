@@ -0,0 +1,152 @@
+/**
+ * @file lineReader.c
+ * 
+ * File containing the implementation of the #LineReader type
+ * 
+ * The #LineReader reads a file in blocks of @ref LINE_READER_BLOCK_SIZE bytes and finds the line breaks with memchr,
+ * so each byte of the input is scanned only once
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "io/lineReader.h"
+
+/**
+ * @brief Structure representing a #LineReader
+ */
+struct lineReader {
+    int fd;             ///< The file descriptor of the file
+    long pos;           ///< The position in the file of the first byte of the block
+    long end;           ///< The position in the file where the range read ends (lines starting at or after it are not read)
+    bool eof;           ///< Whether or not the end of the file was read into the block
+
+    char* block;        ///< The block of the file in memory
+    int size;           ///< The size of the buffer of the block
+    int length;         ///< The number of bytes of the file in the block
+    int next;           ///< The position in the block of the next line
+};
+
+/**
+ * @brief       Opens a #LineReader over a range of the given file
+ * 
+ * @param path  The path to the file
+ * @param start The position of the first line to read (must be the start of a line)
+ * @param end   The position where the range ends (-1 for the end of the file)
+ * 
+ * @return      The #LineReader (exits the program if the file could not be opened, as @ref OPEN_FILE)
+ */
+LineReader openLineReader(char* path, long start, long end) {
+    errno = EFAULT;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error opening file '%s'. Error code: %d\n", path, errno);
+        exit(EXIT_FAILURE);
+    }
+
+    posix_fadvise(fd, start, end < 0 ? 0 : end - start, POSIX_FADV_SEQUENTIAL);
+
+    LineReader r = malloc(sizeof(struct lineReader));
+    *r = (struct lineReader){ .fd = fd, .pos = start, .end = end, .eof = false,
+                              .block = malloc(LINE_READER_BLOCK_SIZE + 1), .size = LINE_READER_BLOCK_SIZE,
+                              .length = 0, .next = 0 };
+    return r;
+}
+
+/**
+ * @brief   Reads the next block of the file, keeping the part of the current line already read
+ * 
+ *          The buffer of the block grows if the line does not fit it
+ * 
+ * @param r The given #LineReader
+ */
+static void readBlock(LineReader r) {
+    int kept = r->length - r->next;
+    memmove(r->block, r->block + r->next, kept);
+    r->pos += r->next;
+    r->length = kept;
+    r->next = 0;
+
+    if (r->length == r->size) {
+        r->size *= 2;
+        r->block = realloc(r->block, r->size + 1);
+    }
+
+    ssize_t read = pread(r->fd, r->block + r->length, r->size - r->length, r->pos + r->length);
+    if (read <= 0)
+        r->eof = true;
+    else
+        r->length += read;
+}
+
+/**
+ * @brief       Reads the next line of the range. Removes the '\r' and '\n' at the end of the line
+ * 
+ * @warning     The line is only valid until the next call to @ref readLine or @ref closeLineReader.
+ *              It may be changed in place (for example, by the parsing functions of a #Format)
+ * 
+ * @param r     The given #LineReader
+ * @param line  Where to store the (null-terminated) line
+ * 
+ * @return -1   If there are no more lines in the range
+ * @return      The number of characters in the line read (excluding '\r', '\n' and '\0')
+ */
+int readLine(LineReader r, char** line) {
+    if (r->end >= 0 && r->pos + r->next >= r->end)
+        return -1;
+
+    char* newline;
+    int searched = r->next;
+    while (!(newline = memchr(r->block + searched, '\n', r->length - searched))) {
+        if (r->eof)
+            break;
+        searched = r->length - r->next;
+        readBlock(r);
+    }
+
+    char* start = r->block + r->next;
+    int len;
+    if (newline != NULL) {
+        len = newline - start;
+        r->next += len + 1;
+    } else {
+        //last line of the file, without a line break
+        len = r->length - r->next;
+        if (len == 0)
+            return -1;
+        r->next = r->length;
+    }
+
+    if (len > 0 && start[len - 1] == '\r')
+        len--;
+    start[len] = '\0';
+
+    *line = start;
+    return len;
+}
+
+/**
+ * @brief   Gets the position in the file of the next line the #LineReader reads
+ * 
+ * @param r The given #LineReader
+ * 
+ * @return  The position of the next line
+ */
+long getLineReaderPos(LineReader r) {
+    return r->pos + r->next;
+}
+
+/**
+ * @brief   Closes the file of the #LineReader and frees the memory allocated to it
+ * 
+ * @param r The given #LineReader
+ */
+void closeLineReader(LineReader r) {
+    close(r->fd);
+    free(r->block);
+    free(r);
+}
@@ -0,0 +1,624 @@
+/**
+ * @file manifest.c
+ *
+ * File containing the implementation of the #Manifest type and of the generations of a catalog
+ *
+ * Each catalog is built (or appended to) in its own staging directory, named after the process building it. Once all
+ * of its files are written, the #Manifest is saved next to them and the link @ref MANIFEST_CURRENT is swapped to the
+ * new directory with a rename, so a killed build never leaves a half-written catalog behind, and the processes serving
+ * the previous generation keep their (already open) files until they are done
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glib.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io/cache.h"
+#include "io/manifest.h"
+
+/**
+ * @brief An entry of a #Manifest: a source file, a file of the catalog or a record count
+ */
+typedef struct manifestEntry {
+    char* name;                 ///< The path of the source, the name of the file or the name of the records
+    long long size;             ///< The size of the file (or the number of records)
+    unsigned long long stamp;   ///< The modification time of the source (in ns) or the checksum of the file
+} MANIFESTENTRY;
+
+/**
+ * @brief Structure representing a #Manifest
+ */
+struct manifest {
+    GArray* sources;    ///< The source files (#MANIFESTENTRY)
+    GArray* files;      ///< The files of the catalog (#MANIFESTENTRY)
+    GArray* records;    ///< The record counts (#MANIFESTENTRY)
+};
+
+/**
+ * @brief       Joins a directory (ending in '/') and a file name
+ *
+ * @param dir   The directory
+ * @param name  The name of the file
+ *
+ * @return      The path (to be freed, NULL if it could not be allocated)
+ */
+static char* joinPath(char* dir, char* name) {
+    char* ans = malloc(strlen(dir) + strlen(name) + 1);
+    if (ans == NULL) {
+        fprintf(stderr, "joinPath: error allocating the path of '%s'\n", name);
+        return NULL;
+    }
+    sprintf(ans, "%s%s", dir, name);
+    return ans;
+}
+
+/**
+ * @brief       Gets the modification time of a file in ns
+ *
+ * @param st    The status of the file
+ *
+ * @return      The modification time
+ */
+static unsigned long long getModificationTime(struct stat* st) {
+    return (unsigned long long)st->st_mtim.tv_sec * 1000000000ULL + (unsigned long long)st->st_mtim.tv_nsec;
+}
+
+/**
+ * @brief       Calculates the checksum (64 bit FNV-1a, a word at a time) of a file, flushing it to the disk
+ *
+ * @param path  The path to the file
+ * @param size  Where to store the size of the file
+ * @param sum   Where to store the checksum
+ *
+ * @return      Whether or not the file could be read
+ */
+static bool checksumFile(char* path, long long* size, unsigned long long* sum) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    unsigned long long h = 14695981039346656037ULL, word;
+    unsigned char* buffer = malloc(MANIFEST_BLOCK_SIZE);
+    if (buffer == NULL) {
+        fprintf(stderr, "checksumFile: error allocating the buffer\n");
+        close(fd);
+        return false;
+    }
+    ssize_t n;
+    *size = 0;
+
+    while ((n = read(fd, buffer, MANIFEST_BLOCK_SIZE)) > 0) {
+        ssize_t i = 0;
+        for (; i + (ssize_t)sizeof(word) <= n; i += sizeof(word)) {
+            memcpy(&word, buffer + i, sizeof(word));
+            h = (h ^ word) * 1099511628211ULL;
+        }
+        for (; i < n; i++)
+            h = (h ^ buffer[i]) * 1099511628211ULL;
+        *size += n;
+    }
+
+    if (n == 0 && fsync(fd) == -1 && errno != EINVAL)
+        n = -1;
+#ifdef CACHE_DIRECT_IO
+    //Once on the disk, the file is read with O_DIRECT: its pages would only hold a second copy of the data
+    if (n == 0)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    free(buffer);
+    close(fd);
+    *sum = h;
+    return n == 0;
+}
+
+/**
+ * @brief       Finds the entry with the given name
+ *
+ * @param a     The GArray of #MANIFESTENTRY
+ * @param name  The name
+ *
+ * @return      The entry (NULL if there is none)
+ */
+static MANIFESTENTRY* findEntry(GArray* a, char* name) {
+    for (int i = 0; i < a->len; i++)
+        if (strcmp(g_array_index(a, MANIFESTENTRY, i).name, name) == 0)
+            return &g_array_index(a, MANIFESTENTRY, i);
+    return NULL;
+}
+
+/**
+ * @brief       Sets the entry with the given name, adding it if there is none
+ *
+ * @param a     The GArray of #MANIFESTENTRY
+ * @param name  The name
+ * @param size  The size of the entry
+ * @param stamp The stamp of the entry
+ */
+static void setEntry(GArray* a, char* name, long long size, unsigned long long stamp) {
+    MANIFESTENTRY* e = findEntry(a, name);
+    if (e == NULL) {
+        MANIFESTENTRY n = { .name = strdup(name) };
+        g_array_append_val(a, n);
+        e = &g_array_index(a, MANIFESTENTRY, a->len - 1);
+    }
+    e->size = size;
+    e->stamp = stamp;
+}
+
+/**
+ * @brief   Creates an empty #Manifest
+ *
+ * @return  The #Manifest
+ */
+Manifest makeManifest() {
+    Manifest m = malloc(sizeof(struct manifest));
+    m->sources = g_array_new(FALSE, FALSE, sizeof(MANIFESTENTRY));
+    m->files = g_array_new(FALSE, FALSE, sizeof(MANIFESTENTRY));
+    m->records = g_array_new(FALSE, FALSE, sizeof(MANIFESTENTRY));
+    return m;
+}
+
+/**
+ * @brief       Adds a source file to the #Manifest, as it is now. Should be called before the file is read
+ *
+ * @param m     The #Manifest
+ * @param path  The path to the source file (ignored if it does not exist)
+ */
+void addManifestSource(Manifest m, char* path) {
+    struct stat st;
+    if (stat(path, &st) == 0)
+        setEntry(m->sources, path, (long long)st.st_size, getModificationTime(&st));
+}
+
+/**
+ * @brief       Adds a file of the catalog to the #Manifest (or updates it), flushing it to the disk
+ *
+ * @param m     The #Manifest
+ * @param dir   The directory of the catalog
+ * @param name  The name of the file
+ *
+ * @return      Whether or not the file could be read
+ */
+bool addManifestFile(Manifest m, char* dir, char* name) {
+    char* path = joinPath(dir, name);
+    if (path == NULL)
+        return false;
+
+    long long size;
+    unsigned long long sum;
+    bool ok = checksumFile(path, &size, &sum);
+
+    if (ok)
+        setEntry(m->files, name, size, sum);
+    else
+        fprintf(stderr, "addManifestFile: could not read file '%s'\n", path);
+    free(path);
+    return ok;
+}
+
+/**
+ * @brief       Sets the number of records of the given kind of the catalog
+ *
+ * @param m     The #Manifest
+ * @param name  The kind of the records (ex: "users")
+ * @param count The number of records
+ */
+void setManifestRecords(Manifest m, char* name, long long count) {
+    setEntry(m->records, name, count, 0);
+}
+
+/**
+ * @brief       Gets the number of records of the given kind of the catalog
+ *
+ * @param m     The #Manifest
+ * @param name  The kind of the records (ex: "users")
+ *
+ * @return      The number of records (-1 if unknown)
+ */
+long long getManifestRecords(Manifest m, char* name) {
+    MANIFESTENTRY* e = findEntry(m->records, name);
+    return e == NULL ? -1 : e->size;
+}
+
+/**
+ * @brief       Writes the entries of a GArray of #MANIFESTENTRY to a file, one per line
+ *
+ * @param a     The GArray
+ * @param kind  The kind of the entries
+ * @param f     The file
+ */
+static void writeEntries(GArray* a, char* kind, FILE* f) {
+    for (int i = 0; i < a->len; i++) {
+        MANIFESTENTRY* e = &g_array_index(a, MANIFESTENTRY, i);
+        fprintf(f, "%s %lld %llx %s\n", kind, e->size, e->stamp, e->name);
+    }
+}
+
+/**
+ * @brief       Saves the #Manifest to the directory of its catalog, replacing the existing one with a rename
+ *
+ * @param m     The #Manifest
+ * @param dir   The directory of the catalog
+ *
+ * @return      Whether or not the #Manifest was saved
+ */
+bool saveManifest(Manifest m, char* dir) {
+    char* path = joinPath(dir, MANIFEST_NAME);
+    char* tmp = path == NULL ? NULL : joinPath(path, ".tmp");
+    if (tmp == NULL) {
+        free(path);
+        return false;
+    }
+
+    FILE* f = fopen(tmp, "w");
+    bool ok = f != NULL;
+
+    if (ok) {
+        fprintf(f, "version %d\n", MANIFEST_VERSION);
+        writeEntries(m->sources, "source", f);
+        writeEntries(m->files, "file", f);
+        writeEntries(m->records, "records", f);
+        ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+        ok = fclose(f) == 0 && ok;
+        ok = ok && rename(tmp, path) == 0;
+    }
+
+    if (!ok)
+        fprintf(stderr, "saveManifest: could not write file '%s'\n", path);
+    free(tmp);
+    free(path);
+    return ok;
+}
+
+/**
+ * @brief       Loads the #Manifest of a catalog
+ *
+ * @param dir   The directory of the catalog
+ *
+ * @return      The #Manifest (NULL if there is none, or if it is of another version)
+ */
+Manifest loadManifest(char* dir) {
+    char* path = joinPath(dir, MANIFEST_NAME);
+    FILE* f = path == NULL ? NULL : fopen(path, "r");
+    free(path);
+    if (f == NULL)
+        return NULL;
+
+    int version = -1;
+    if (fscanf(f, "version %d\n", &version) != 1 || version != MANIFEST_VERSION) {
+        fclose(f);
+        return NULL;
+    }
+
+    Manifest m = makeManifest();
+    char line[4096 + 64], kind[16];
+    long long size;
+    unsigned long long stamp;
+    int name;
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        trimNewLine(line, strlen(line));
+        if (sscanf(line, "%15s %lld %llx %n", kind, &size, &stamp, &name) != 3)
+            continue;
+
+        GArray* a = strcmp(kind, "source") == 0 ? m->sources : strcmp(kind, "file") == 0 ? m->files
+                  : strcmp(kind, "records") == 0 ? m->records : NULL;
+        if (a != NULL)
+            setEntry(a, line + name, size, stamp);
+    }
+
+    fclose(f);
+    return m;
+}
+
+/**
+ * @brief           Checks that a catalog still matches its #Manifest: none of its sources changed since it was built
+ *                  and all of its files have the recorded sizes (and checksums)
+ *
+ * @param m         The #Manifest
+ * @param dir       The directory of the catalog
+ * @param checksums Whether or not to check the checksums of the files (which reads them whole)
+ *
+ * @return          Whether or not the catalog matches the #Manifest
+ */
+bool checkManifest(Manifest m, char* dir, bool checksums) {
+    struct stat st;
+
+    for (int i = 0; i < m->sources->len; i++) {
+        MANIFESTENTRY* e = &g_array_index(m->sources, MANIFESTENTRY, i);
+        if (stat(e->name, &st) == 0 && ((long long)st.st_size != e->size || getModificationTime(&st) != e->stamp)) {
+            fprintf(stderr, "checkManifest: the file '%s' changed since the catalog was built\n", e->name);
+            return false;
+        }
+    }
+
+    for (int i = 0; i < m->files->len; i++) {
+        MANIFESTENTRY* e = &g_array_index(m->files, MANIFESTENTRY, i);
+        char* path = joinPath(dir, e->name);
+        if (path == NULL)
+            return false;
+
+        long long size = -1;
+        unsigned long long sum = e->stamp;
+
+        if (stat(path, &st) == 0)
+            size = (long long)st.st_size;
+        if (size == e->size && checksums && !checksumFile(path, &size, &sum))
+            size = -1;
+
+        if (size != e->size || sum != e->stamp) {
+            fprintf(stderr, "checkManifest: the file '%s' does not match the manifest\n", path);
+            free(path);
+            return false;
+        }
+        free(path);
+    }
+    return true;
+}
+
+/**
+ * @brief       Frees the entries of a GArray of #MANIFESTENTRY, and the GArray
+ *
+ * @param a     The GArray
+ */
+static void freeEntries(GArray* a) {
+    for (int i = 0; i < a->len; i++)
+        free(g_array_index(a, MANIFESTENTRY, i).name);
+    g_array_free(a, TRUE);
+}
+
+/**
+ * @brief   Frees the #Manifest
+ *
+ * @param m The #Manifest
+ */
+void freeManifest(Manifest m) {
+    if (m == NULL)
+        return;
+    freeEntries(m->sources);
+    freeEntries(m->files);
+    freeEntries(m->records);
+    free(m);
+}
+
+/**
+ * @brief       Reads the name of the directory the link @ref MANIFEST_CURRENT points to
+ *
+ * @param root  The root directory (ending in '/')
+ *
+ * @return      The name of the directory (to be freed, NULL if there is no link)
+ */
+static char* readCurrentLink(char* root) {
+    char* link = joinPath(root, MANIFEST_CURRENT);
+    if (link == NULL)
+        return NULL;
+
+    char target[4096];
+    ssize_t n = readlink(link, target, sizeof(target) - 1);
+    free(link);
+
+    if (n <= 0)
+        return NULL;
+    target[n] = '\0';
+    return strdup(target);
+}
+
+/**
+ * @brief       Gets the directory of the catalog currently served
+ *
+ * @param root  The root directory (ending in '/')
+ *
+ * @return      The directory (ending in '/', to be freed; NULL if there is no catalog)
+ */
+char* getCurrentDir(char* root) {
+    char* target = readCurrentLink(root);
+    if (target == NULL)
+        return NULL;
+
+    char* ans = malloc(strlen(root) + strlen(target) + 2);
+    if (ans == NULL) {
+        fprintf(stderr, "getCurrentDir: error allocating the path of the directory\n");
+        free(target);
+        return NULL;
+    }
+    sprintf(ans, "%s%s/", root, target);
+    free(target);
+    return ans;
+}
+
+/**
+ * @brief       Removes the staging directories left behind by the builds of processes no longer running, except the
+ *              one currently served
+ *
+ * @param root  The root directory (ending in '/')
+ */
+static void removeStaleDirs(char* root) {
+    DIR* d = opendir(root);
+    if (d == NULL)
+        return;
+
+    char* current = readCurrentLink(root);
+    struct dirent* e;
+    int pid;
+
+    while ((e = readdir(d)) != NULL) {
+        if (sscanf(e->d_name, MANIFEST_CURRENT ".%d.", &pid) != 1 || pid == getpid()
+            || (current != NULL && strcmp(current, e->d_name) == 0) || kill(pid, 0) == 0 || errno != ESRCH)
+            continue;
+
+        char* dir = malloc(strlen(root) + strlen(e->d_name) + 2);
+        if (dir == NULL)
+            continue;
+        sprintf(dir, "%s%s/", root, e->d_name);
+        removeStagingDir(dir);
+        free(dir);
+    }
+
+    free(current);
+    closedir(d);
+}
+
+/**
+ * @brief       Creates a new staging directory to build a catalog in, removing the stale ones
+ *
+ * @param root  The root directory (ending in '/')
+ *
+ * @return      The directory (ending in '/', to be freed; NULL if it could not be created)
+ */
+char* makeStagingDir(char* root) {
+    removeStaleDirs(root);
+
+    char* dir = malloc(strlen(root) + strlen(MANIFEST_CURRENT) + 32);
+    if (dir == NULL) {
+        fprintf(stderr, "makeStagingDir: error allocating the path of the directory\n");
+        return NULL;
+    }
+    sprintf(dir, "%s" MANIFEST_CURRENT ".%d.XXXXXX", root, getpid());
+
+    if (mkdtemp(dir) == NULL) {
+        fprintf(stderr, "makeStagingDir: could not create directory '%s'. Error code: %d\n", dir, errno);
+        free(dir);
+        return NULL;
+    }
+    chmod(dir, 0755);
+    strcat(dir, "/");
+    return dir;
+}
+
+/**
+ * @brief       Copies a file
+ *
+ * @param from  The path to the file
+ * @param to    The path to the copy
+ *
+ * @return      Whether or not the file was copied
+ */
+static bool copyFile(char* from, char* to) {
+    int in = open(from, O_RDONLY), out = open(to, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    char* buffer = malloc(MANIFEST_BLOCK_SIZE);
+    bool ok = in != -1 && out != -1 && buffer != NULL;
+    ssize_t n = 0;
+
+    while (ok && (n = read(in, buffer, MANIFEST_BLOCK_SIZE)) > 0)
+        ok = write(out, buffer, n) == n;
+    ok = ok && n == 0;
+
+    free(buffer);
+    if (in != -1)   close(in);
+    if (out != -1)  close(out);
+    return ok;
+}
+
+/**
+ * @brief       Copies the files of a catalog to a staging directory (to be appended to)
+ *
+ * @param from  The directory of the catalog
+ * @param to    The staging directory
+ *
+ * @return      Whether or not all of the files were copied
+ */
+bool copyStagingDir(char* from, char* to) {
+    DIR* d = opendir(from);
+    if (d == NULL)
+        return false;
+
+    struct dirent* e;
+    bool ok = true;
+    while (ok && (e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.' || strcmp(e->d_name, MANIFEST_NAME) == 0)
+            continue;
+
+        char* src = joinPath(from, e->d_name);
+        char* dest = joinPath(to, e->d_name);
+        ok = src != NULL && dest != NULL && copyFile(src, dest);
+        if (!ok)
+            fprintf(stderr, "copyStagingDir: could not copy file '%s'\n", e->d_name);
+        free(src);
+        free(dest);
+    }
+
+    closedir(d);
+    return ok;
+}
+
+/**
+ * @brief           Publishes a staging directory (with its #Manifest saved): swaps the link @ref MANIFEST_CURRENT to it
+ *                  and removes the directory previously served
+ *
+ * @param root      The root directory (ending in '/')
+ * @param staging   The staging directory
+ *
+ * @return          Whether or not the directory was published
+ */
+bool publishStagingDir(char* root, char* staging) {
+    char* name = strdup(staging + strlen(root));
+    if (name == NULL) {
+        fprintf(stderr, "publishStagingDir: error allocating the name of the directory\n");
+        return false;
+    }
+    name[strlen(name) - 1] = '\0';
+
+    char* link = joinPath(root, MANIFEST_CURRENT);
+    char* tmp = link == NULL ? NULL : malloc(strlen(link) + 32);
+    if (tmp == NULL) {
+        fprintf(stderr, "publishStagingDir: error allocating the path of the link\n");
+        free(link);
+        free(name);
+        return false;
+    }
+    sprintf(tmp, "%s.link.%d", link, getpid());
+
+    char* previous = getCurrentDir(root);
+    unlink(tmp);
+    bool ok = symlink(name, tmp) == 0 && rename(tmp, link) == 0;
+
+    if (ok) {
+        int fd = open(root, O_RDONLY);
+        if (fd != -1) {
+            fsync(fd);
+            close(fd);
+        }
+        if (previous != NULL && strcmp(previous, staging) != 0)
+            removeStagingDir(previous);
+    } else {
+        fprintf(stderr, "publishStagingDir: could not link '%s' to '%s'. Error code: %d\n", link, name, errno);
+        unlink(tmp);
+    }
+
+    free(previous);
+    free(tmp);
+    free(link);
+    free(name);
+    return ok;
+}
+
+/**
+ * @brief       Removes a staging directory and its files. The processes which have them open keep reading them
+ *
+ * @param dir   The directory (ending in '/')
+ */
+void removeStagingDir(char* dir) {
+    DIR* d = opendir(dir);
+    if (d == NULL)
+        return;
+
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0)
+            continue;
+        char* path = joinPath(dir, e->d_name);
+        if (path != NULL)
+            unlink(path);
+        free(path);
+    }
+
+    closedir(d);
+    rmdir(dir);
+}
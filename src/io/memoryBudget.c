@@ -0,0 +1,162 @@
+/**
+ * @file memoryBudget.c
+ * 
+ * File containing the implementation of the global memory budget
+ * 
+ * The budget is set from the command line or, failing that, taken as @ref MEMORY_BUDGET_SYSTEM_SHARE percent of the
+ * memory available to the process. Every large allocation (the lines of the #Cache, the runs of the sorts) is acquired
+ * from it and released once freed, so concurrent users shrink their buffers instead of exceeding it
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "io/memoryBudget.h"
+
+/**
+ * @brief The budget (0 while unknown)
+ */
+static size_t budget = 0;
+
+/**
+ * @brief The memory of the budget currently acquired
+ */
+static size_t acquired = 0;
+
+/**
+ * @brief The mutex protecting the budget
+ */
+static pthread_mutex_t budget_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief       Reads a number of bytes from the first line of the given file
+ * 
+ * @param path  The path to the file
+ * 
+ * @return 0    If the file could not be read or holds no number (ex: "max")
+ * @return      The number otherwise
+ */
+static size_t readLimitFile(char* path) {
+    FILE* f = fopen(path, "r");
+    unsigned long long n = 0;
+
+    if (f == NULL)
+        return 0;
+    if (fscanf(f, "%llu", &n) != 1)
+        n = 0;
+    fclose(f);
+    return (size_t)n;
+}
+
+/**
+ * @brief   Reads the available physical memory from /proc/meminfo
+ * 
+ * @return  The available memory, in bytes (0 if unknown)
+ */
+static size_t readAvailableMemory() {
+    FILE* f = fopen("/proc/meminfo", "r");
+    char line[256];
+    unsigned long long kb = 0;
+
+    if (f == NULL)
+        return 0;
+    while (fgets(line, sizeof(line), f) != NULL)
+        if (sscanf(line, "MemAvailable: %llu kB", &kb) == 1)
+            break;
+    fclose(f);
+    return (size_t)kb * 1024;
+}
+
+/**
+ * @brief   Finds the memory available to the process: the least of the limit of its cgroup (v2 or v1) and of the
+ *          available physical memory
+ * 
+ * @return  The available memory, in bytes (0 if unknown)
+ */
+static size_t detectAvailableMemory() {
+    size_t ans = readAvailableMemory();
+    size_t limits[2] = { readLimitFile("/sys/fs/cgroup/memory.max"),
+                         readLimitFile("/sys/fs/cgroup/memory/memory.limit_in_bytes") };
+
+    for (int i = 0; i < 2; i++)
+        if (limits[i] != 0 && (ans == 0 || limits[i] < ans))
+            ans = limits[i];
+    return ans;
+}
+
+/**
+ * @brief       Sets the memory budget of the program (ex: from the command line)
+ * 
+ * @warning     Must be called before any memory is acquired
+ * 
+ * @param bytes The budget, in bytes (0 to detect it)
+ */
+void setMemoryBudget(size_t bytes) {
+    pthread_mutex_lock(&budget_mutex);
+    budget = bytes;
+    pthread_mutex_unlock(&budget_mutex);
+}
+
+/**
+ * @brief   Gets the memory budget of the program, detecting it on the first call if it wasn't set
+ * 
+ * @return  The budget, in bytes
+ */
+size_t getMemoryBudget() {
+    pthread_mutex_lock(&budget_mutex);
+    if (budget == 0) {
+        size_t available = detectAvailableMemory();
+        budget = available == 0 ? MEMORY_BUDGET_FALLBACK : available / 100 * MEMORY_BUDGET_SYSTEM_SHARE;
+    }
+    size_t ans = budget;
+    pthread_mutex_unlock(&budget_mutex);
+    return ans;
+}
+
+/**
+ * @brief           Calculates the memory the #Cache should get in the given phase
+ * 
+ * @param phase     The phase of the program
+ * @param data_size The size of the data the #Cache serves (there's no use in the #Cache being larger)
+ * 
+ * @return          The memory of the #Cache, in bytes
+ */
+size_t getCacheBudget(MemoryPhase phase, size_t data_size) {
+    size_t ans = getMemoryBudget() / 100 * (phase == MEMORY_BUILD ? MEMORY_BUILD_CACHE_SHARE : MEMORY_QUERY_CACHE_SHARE);
+    return data_size < ans ? data_size : ans;
+}
+
+/**
+ * @brief           Acquires memory from the budget. If less than wanted is left, what is left is granted,
+ *                  but never less than the minimum (which may exceed the budget, so the caller can always progress)
+ * 
+ * @param wanted    The memory wanted, in bytes
+ * @param minimum   The least memory the caller can work with, in bytes
+ * 
+ * @return          The memory granted, in bytes. Must be given back with @ref releaseMemory
+ */
+size_t acquireMemory(size_t wanted, size_t minimum) {
+    size_t total = getMemoryBudget();
+
+    pthread_mutex_lock(&budget_mutex);
+    size_t left = acquired < total ? total - acquired : 0;
+    size_t ans = wanted < left ? wanted : left;
+    if (ans < minimum)
+        ans = minimum;
+    acquired += ans;
+    pthread_mutex_unlock(&budget_mutex);
+
+    return ans;
+}
+
+/**
+ * @brief       Gives memory acquired with @ref acquireMemory back to the budget
+ * 
+ * @param bytes The memory, in bytes
+ */
+void releaseMemory(size_t bytes) {
+    pthread_mutex_lock(&budget_mutex);
+    acquired = bytes < acquired ? acquired - bytes : 0;
+    pthread_mutex_unlock(&budget_mutex);
+}
@@ -0,0 +1,335 @@
+/**
+ * @file messages.c
+ *
+ * File containing the implementation of the #MessageWriter and #MessageFile types
+ *
+ * The file is a sequence of blocks, each made of its header (see #MESSAGEBLOCKHEADER) and its contents, compressed
+ * with zlib (or as they are, if that does not make them smaller). The contents of a block are the offset of each of
+ * its messages and of their end, followed by the characters of the messages. The blocks do not hold the number of
+ * their first message, so the blocks of many writers are concatenated as they are
+ */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "io/messages.h"
+
+/**
+ * @brief Compress the blocks of messages. Comment out to store them as they are (they are read either way)
+ */
+#define COMPRESS_MESSAGES
+
+/**
+ * @brief The header of a block of messages
+ */
+typedef struct messageBlockHeader {
+    int messages;       ///< The number of messages of the block
+    int raw_size;       ///< The size of the contents of the block
+    int stored_size;    ///< The size of the contents in the file (the contents are compressed if it is smaller than raw_size)
+} MESSAGEBLOCKHEADER;
+
+/**
+ * @brief Structure representing a #MessageWriter
+ */
+struct messageWriter {
+    FILE* file;         ///< The file the blocks are written to
+    int* offsets;       ///< The offset of each message of the block being filled (and of their end)
+    int messages;       ///< The number of messages of the block being filled
+    char* chars;        ///< The characters of the messages of the block being filled
+    int chars_size;     ///< The number of characters
+    int chars_capacity; ///< The number of characters allocated
+    bool ok;            ///< Whether every block was written
+};
+
+/**
+ * @brief A block of a #MessageFile, decompressed
+ */
+typedef struct cachedBlock {
+    int block;          ///< The index of the block (-1 if none was loaded)
+    char* contents;     ///< The contents of the block
+} CACHEDBLOCK;
+
+/**
+ * @brief Structure representing a #MessageFile
+ */
+struct messageFile {
+    int file_desc;          ///< The file descriptor of the file
+    int blocks;             ///< The number of blocks
+    int* firsts;            ///< The number of the first message of each block (and the number of messages, after the last)
+    off_t* positions;       ///< The position of the header of each block
+
+    CACHEDBLOCK cached[MESSAGE_CACHED_BLOCKS];  ///< The blocks kept decompressed
+    int next_evicted;                           ///< The entry of cached replaced next (in round robin)
+    pthread_mutex_t mutex;                      ///< The mutex guarding the blocks kept decompressed
+};
+
+/**
+ * @brief       Creates a #MessageWriter
+ *
+ * @param file  The file to write the blocks to (from its current position)
+ *
+ * @return      The #MessageWriter
+ */
+MessageWriter makeMessageWriter(FILE* file) {
+    MessageWriter w = malloc(sizeof(struct messageWriter));
+    w->file = file;
+    w->offsets = malloc((MESSAGE_BLOCK_MESSAGES + 1) * sizeof(int));
+    w->messages = 0;
+    w->chars_capacity = MESSAGE_BLOCK_SIZE * 2;
+    w->chars = malloc(w->chars_capacity);
+    w->chars_size = 0;
+    w->ok = true;
+    return w;
+}
+
+/**
+ * @brief       Writes the block being filled by a #MessageWriter, compressed, and starts the next
+ *
+ * @param w     The given #MessageWriter
+ */
+static void writeMessageBlock(MessageWriter w) {
+    if (w->messages == 0)
+        return;
+
+    w->offsets[w->messages] = w->chars_size;
+    int offsets_size = (w->messages + 1) * sizeof(int);
+    MESSAGEBLOCKHEADER header = { .messages = w->messages, .raw_size = offsets_size + w->chars_size };
+
+    char* raw = malloc(header.raw_size);
+    memcpy(raw, w->offsets, offsets_size);
+    memcpy(raw + offsets_size, w->chars, w->chars_size);
+
+    uLongf stored_size = compressBound(header.raw_size);
+    char* stored = malloc(stored_size);
+#ifdef COMPRESS_MESSAGES
+    bool compressed = compress2((Bytef*)stored, &stored_size, (Bytef*)raw, header.raw_size, Z_BEST_SPEED) == Z_OK
+                   && stored_size < (uLongf)header.raw_size;
+#else
+    bool compressed = false;
+#endif
+    if (!compressed) {
+        free(stored);
+        stored = raw;
+        stored_size = header.raw_size;
+        raw = NULL;
+    }
+    header.stored_size = (int)stored_size;
+
+    w->ok = fwrite(&header, sizeof(header), 1, w->file) == 1
+         && fwrite(stored, 1, stored_size, w->file) == stored_size && w->ok;
+
+    free(stored);
+    free(raw);
+    w->messages = 0;
+    w->chars_size = 0;
+}
+
+/**
+ * @brief           Adds a message to a #MessageWriter, numbered after the ones added before
+ *
+ * @param w         The given #MessageWriter
+ * @param message   The message (NULL is stored as an empty message)
+ */
+void addMessage(MessageWriter w, char* message) {
+    int len = message == NULL ? 0 : strlen(message);
+
+    if (w->chars_size + len > w->chars_capacity) {
+        w->chars_capacity = MAX(w->chars_capacity * 2, w->chars_size + len);
+        w->chars = realloc(w->chars, w->chars_capacity);
+    }
+
+    w->offsets[w->messages++] = w->chars_size;
+    if (len > 0)
+        memcpy(w->chars + w->chars_size, message, len);
+    w->chars_size += len;
+
+    if (w->chars_size >= MESSAGE_BLOCK_SIZE || w->messages == MESSAGE_BLOCK_MESSAGES)
+        writeMessageBlock(w);
+}
+
+/**
+ * @brief       Writes the last block of a #MessageWriter and frees it (the file is left open)
+ *
+ * @param w     The given #MessageWriter
+ *
+ * @return      Whether every block was written
+ */
+bool closeMessageWriter(MessageWriter w) {
+    writeMessageBlock(w);
+    fflush(w->file);
+
+    bool ok = w->ok;
+    free(w->offsets);
+    free(w->chars);
+    free(w);
+    return ok;
+}
+
+/**
+ * @brief       Opens a #MessageFile, reading the headers of its blocks
+ *
+ * @param path  The path to the file
+ *
+ * @return NULL If the file does not exist or is not valid
+ * @return      The #MessageFile
+ */
+MessageFile openMessageFile(char* path) {
+    int file_desc = open(path, O_RDONLY);
+    if (file_desc == -1)
+        return NULL;
+
+    MessageFile f = malloc(sizeof(struct messageFile));
+    int capacity = 64;
+    f->file_desc = file_desc;
+    f->blocks = 0;
+    f->firsts = malloc((capacity + 1) * sizeof(int));
+    f->positions = malloc(capacity * sizeof(off_t));
+    f->firsts[0] = 0;
+    for (int i = 0; i < MESSAGE_CACHED_BLOCKS; i++)
+        f->cached[i] = (CACHEDBLOCK){ .block = -1, .contents = NULL };
+    f->next_evicted = 0;
+    pthread_mutex_init(&f->mutex, NULL);
+
+    MESSAGEBLOCKHEADER header;
+    off_t pos = 0;
+    ssize_t read;
+    while ((read = pread(file_desc, &header, sizeof(header), pos)) == sizeof(header)) {
+        if (header.messages <= 0 || header.stored_size < 0 || header.stored_size > header.raw_size)
+            break;
+
+        if (f->blocks == capacity) {
+            capacity *= 2;
+            f->firsts = realloc(f->firsts, (capacity + 1) * sizeof(int));
+            f->positions = realloc(f->positions, capacity * sizeof(off_t));
+        }
+
+        f->positions[f->blocks] = pos;
+        f->firsts[f->blocks + 1] = f->firsts[f->blocks] + header.messages;
+        f->blocks++;
+        pos += sizeof(header) + header.stored_size;
+    }
+
+    if (read != 0) {
+        fprintf(stderr, "openMessageFile: invalid file '%s'\n", path);
+        freeMessageFile(f);
+        return NULL;
+    }
+
+    return f;
+}
+
+/**
+ * @brief       Gets the number of messages of a #MessageFile
+ *
+ * @param f     The given #MessageFile
+ *
+ * @return      The number of messages
+ */
+int getMessageFileSize(MessageFile f) {
+    return f->firsts[f->blocks];
+}
+
+/**
+ * @brief       Gets the decompressed contents of a block of a #MessageFile, reading it if it is not kept
+ *
+ * @warning     Must be called with the mutex of the #MessageFile locked
+ *
+ * @param f     The given #MessageFile
+ * @param block The index of the block
+ *
+ * @return      The contents (owned by the #MessageFile), NULL if the block could not be read
+ */
+static char* getMessageBlock(MessageFile f, int block) {
+    for (int i = 0; i < MESSAGE_CACHED_BLOCKS; i++)
+        if (f->cached[i].block == block)
+            return f->cached[i].contents;
+
+    MESSAGEBLOCKHEADER header;
+    if (pread(f->file_desc, &header, sizeof(header), f->positions[block]) != sizeof(header))
+        return NULL;
+
+    char* stored = malloc(header.stored_size);
+    char* contents = header.stored_size == header.raw_size ? stored : malloc(header.raw_size);
+    uLongf raw_size = header.raw_size;
+    bool ok = pread(f->file_desc, stored, header.stored_size, f->positions[block] + sizeof(header)) == header.stored_size
+           && (contents == stored || (uncompress((Bytef*)contents, &raw_size, (Bytef*)stored, header.stored_size) == Z_OK
+                                      && raw_size == (uLongf)header.raw_size));
+    if (contents != stored)
+        free(stored);
+    if (!ok) {
+        fprintf(stderr, "getMessageBlock: could not read block %d\n", block);
+        free(contents);
+        return NULL;
+    }
+
+    CACHEDBLOCK* evicted = &f->cached[f->next_evicted];
+    f->next_evicted = (f->next_evicted + 1) % MESSAGE_CACHED_BLOCKS;
+    free(evicted->contents);
+    *evicted = (CACHEDBLOCK){ .block = block, .contents = contents };
+    return contents;
+}
+
+/**
+ * @brief           Gets a message of a #MessageFile
+ *
+ * @param f         The given #MessageFile
+ * @param message   The number of the message
+ *
+ * @return          A copy of the message, NULL if it is empty or does not exist
+ */
+char* getMessage(MessageFile f, int message) {
+    if (message < 0 || message >= getMessageFileSize(f))
+        return NULL;
+
+    //The last block whose first message is not after the one wanted
+    int lo = 0, hi = f->blocks - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (f->firsts[mid] <= message)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    char* ans = NULL;
+    pthread_mutex_lock(&f->mutex);
+    char* contents = getMessageBlock(f, lo);
+    if (contents != NULL) {
+        int index = message - f->firsts[lo], offsets[2];
+        memcpy(offsets, contents + index * sizeof(int), sizeof(offsets));
+
+        int offsets_size = (f->firsts[lo + 1] - f->firsts[lo] + 1) * sizeof(int);
+        if (offsets[1] > offsets[0]) {
+            ans = malloc(offsets[1] - offsets[0] + 1);
+            memcpy(ans, contents + offsets_size + offsets[0], offsets[1] - offsets[0]);
+            ans[offsets[1] - offsets[0]] = '\0';
+        }
+    }
+    pthread_mutex_unlock(&f->mutex);
+
+    return ans;
+}
+
+/**
+ * @brief       Closes a #MessageFile and frees the memory allocated to it
+ *
+ * @param f     The given #MessageFile
+ */
+void freeMessageFile(MessageFile f) {
+    if (f == NULL)
+        return;
+
+    for (int i = 0; i < MESSAGE_CACHED_BLOCKS; i++)
+        free(f->cached[i].contents);
+    pthread_mutex_destroy(&f->mutex);
+
+    close(f->file_desc);
+    free(f->firsts);
+    free(f->positions);
+    free(f);
+}
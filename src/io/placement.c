@@ -0,0 +1,203 @@
+/**
+ * @file placement.c
+ *
+ * File containing the implementation of the placement of the slabs of the #Cache and of the worker threads
+ *
+ * The NUMA nodes and their processors are read once from sysfs. Slabs are mapped anonymously, a multiple of a huge
+ * page long and aligned to one, so transparent huge pages can back them whole, and bound to interleave across the
+ * nodes (with the raw system call, not to depend on libnuma). On a machine with a single node (or without sysfs)
+ * nothing but the huge pages is asked for
+ */
+#define _GNU_SOURCE
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "io/placement.h"
+
+/**
+ * @brief The number of NUMA nodes (the largest online node plus one, 1 if unknown)
+ */
+static int nodeNum = 1;
+
+/**
+ * @brief The online NUMA nodes, as the mask passed to mbind
+ */
+static unsigned long nodeMask[(PLACEMENT_MAX_NODES + 63) / 64];
+
+/**
+ * @brief The processors of each NUMA node the process may run on
+ */
+static cpu_set_t nodeCpus[PLACEMENT_MAX_NODES];
+
+/**
+ * @brief The NUMA nodes with processors the process may run on (those the workers are dealt to)
+ */
+static int cpuNodes[PLACEMENT_MAX_NODES];
+
+/**
+ * @brief The number of @ref cpuNodes
+ */
+static int cpuNodeNum = 0;
+
+/**
+ * @brief Makes sure the nodes are only read once
+ */
+static pthread_once_t nodesOnce = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief       Reads a list of ids from sysfs (ex: "0-3,8-11")
+ *
+ * @param path  The path to the file
+ * @param set   Set to the ids read (cleared first)
+ *
+ * @return      Whether or not the file could be read
+ */
+static bool readIdList(char* path, cpu_set_t* set) {
+    CPU_ZERO(set);
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+        return false;
+
+    int first, last;
+    char sep;
+    for (bool more = fscanf(file, "%d", &first) == 1; more; ) {
+        last = first;
+        more = fscanf(file, "%c", &sep) == 1;
+        if (more && sep == '-' && fscanf(file, "%d", &last) == 1)
+            more = fscanf(file, "%c", &sep) == 1;
+
+        for (int id = first; id <= last && id < CPU_SETSIZE; id++)
+            CPU_SET(id, set);
+        more = more && sep == ',' && fscanf(file, "%d", &first) == 1;
+    }
+
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief Reads the online NUMA nodes and their processors (the ones the process may run on)
+ */
+static void readNodes() {
+    cpu_set_t nodes, allowed;
+    if (!readIdList("/sys/devices/system/node/online", &nodes) || sched_getaffinity(0, sizeof(cpu_set_t), &allowed) != 0)
+        return;
+
+    for (int n = 0; n < PLACEMENT_MAX_NODES; n++) {
+        if (!CPU_ISSET(n, &nodes))
+            continue;
+
+        nodeNum = n + 1;
+        nodeMask[n / 64] |= 1UL << (n % 64);
+
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", n);
+        if (readIdList(path, &nodeCpus[n])) {
+            CPU_AND(&nodeCpus[n], &nodeCpus[n], &allowed);
+            if (CPU_COUNT(&nodeCpus[n]) > 0)
+                cpuNodes[cpuNodeNum++] = n;
+        }
+    }
+}
+
+/**
+ * @brief   Gets the number of NUMA nodes of the machine
+ *
+ * @return  The largest online node plus one (1 if they cannot be found)
+ */
+int getNumaNodes() {
+    pthread_once(&nodesOnce, readNodes);
+    return nodeNum;
+}
+
+/**
+ * @brief       Gets the length of the mapping of a slab: its size rounded up to a huge page
+ *
+ * @param size  The size of the slab
+ *
+ * @return      The length
+ */
+static inline size_t getSlabLength(size_t size) {
+    return (size + SLAB_HUGE_PAGE_SIZE - 1) / SLAB_HUGE_PAGE_SIZE * SLAB_HUGE_PAGE_SIZE;
+}
+
+/**
+ * @brief       Allocates a slab of memory (ex: the lines of a #Cache), aligned to a huge page. Backed by huge pages and
+ *              interleaved across the NUMA nodes, unless turned off (see @ref SLAB_HUGE_PAGES and
+ *              @ref SLAB_INTERLEAVE_NODES). The pages are zeroed and only take memory once touched
+ *
+ * @param size  The size of the slab (in bytes)
+ *
+ * @return NULL If the memory could not be mapped
+ * @return      The slab (to be freed with @ref freeSlab, given the same size)
+ */
+void* allocateSlab(size_t size) {
+    size_t len = getSlabLength(size);
+    char* slab = MAP_FAILED;
+
+#ifdef SLAB_EXPLICIT_HUGE_PAGES
+    slab = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+
+    if (slab == MAP_FAILED) {
+        //Mapped a huge page longer, then trimmed so it starts on one
+        char* map = mmap(NULL, len + SLAB_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "allocateSlab: could not map %zu bytes\n", len);
+            return NULL;
+        }
+
+        slab = (char*)(((uintptr_t)map + SLAB_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(SLAB_HUGE_PAGE_SIZE - 1));
+        if (slab > map)
+            munmap(map, slab - map);
+        munmap(slab + len, map + SLAB_HUGE_PAGE_SIZE - slab);
+
+#ifdef SLAB_HUGE_PAGES
+        madvise(slab, len, MADV_HUGEPAGE);
+#endif
+    }
+
+#ifdef SLAB_INTERLEAVE_NODES
+    if (getNumaNodes() > 1
+        && syscall(SYS_mbind, slab, len, MPOL_INTERLEAVE, nodeMask, (unsigned long)PLACEMENT_MAX_NODES + 1, 0) != 0)
+        fprintf(stderr, "allocateSlab: could not interleave the slab across the nodes\n");
+#endif
+
+    return slab;
+}
+
+/**
+ * @brief       Frees a slab allocated by @ref allocateSlab
+ *
+ * @param slab  The slab (NULL is ignored)
+ * @param size  The size it was allocated with
+ */
+void freeSlab(void* slab, size_t size) {
+    if (slab != NULL)
+        munmap(slab, getSlabLength(size));
+}
+
+/**
+ * @brief           Keeps the calling thread on the processors of a NUMA node, the workers dealt to the nodes in turn
+ *                  (see @ref PLACEMENT_PIN_WORKERS). Nothing is done on machines with a single node
+ *
+ * @param worker    The number of the worker
+ *
+ * @return          Whether or not the thread was placed
+ */
+bool placeWorker(int worker) {
+#ifdef PLACEMENT_PIN_WORKERS
+    getNumaNodes();
+    if (cpuNodeNum > 1) {
+        int node = cpuNodes[worker % cpuNodeNum];
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &nodeCpus[node]) == 0;
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,283 @@
+/**
+ * @file plan.c
+ *
+ * File containing the implementation of the #Plan type
+ *
+ * A #Plan is run a batch of @ref PLAN_BATCH_SIZE rows at a time: its filters narrow a selection of the rows of the batch
+ * (each filter a tight loop over one column) and the rows selected are aggregated into a #Counter. The range is split
+ * into partitions scanned in parallel (see @ref scanIndexerRange), each aggregating into its own counters, merged once
+ * the scan ends. The plans run together share the scan: each batch is read once and handed to every plan whose range
+ * it overlaps, so the queries of a batch pay for a single pass over the columns
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "io/plan.h"
+#include "utils/metrics.h"
+#include "utils/utils.h"
+
+/**
+ * @brief A filter of a #Plan
+ */
+typedef struct planFilter {
+    int* column;    ///< The column compared
+    PlanOp op;      ///< The comparison
+    int value;      ///< The constant compared to
+} PLANFILTER;
+
+/**
+ * @brief Structure representing a #Plan
+ */
+struct plan {
+    int from;                           ///< The first row of the range scanned
+    int to;                             ///< The row after the last row of the range scanned
+    PLANFILTER filters[PLAN_MAX_FILTERS]; ///< The filters, applied in the order they were added
+    int filter_num;                     ///< The number of filters
+    int* keys[PLAN_MAX_KEYS];           ///< The key columns grouped by
+    int key_num;                        ///< The number of key columns (0 until the aggregate is set)
+    PlanAggregate aggregate;            ///< The aggregate
+    int* values;                        ///< The column aggregated by @ref PLAN_MAX
+    Counter result;                     ///< The aggregate of each key (NULL until the #Plan is run)
+};
+
+/**
+ * @brief The state of a run of some plans (see @ref runPlans)
+ */
+typedef struct planRun {
+    Plan* plans;            ///< The plans
+    int n;                  ///< The number of plans
+    Counter* counters;      ///< The partial aggregates of each plan in each partition (n per partition)
+    CancelToken cancel;     ///< The #CancelToken of the run (the partitions stop once it is cancelled)
+} PLANRUN;
+
+/**
+ * @brief       Makes a #Plan scanning a range of rows, with no filters
+ *
+ * @param from  The first row of the range
+ * @param to    The row after the last row of the range
+ *
+ * @return      The #Plan (to be given its aggregate with @ref setPlanGroupBy)
+ */
+Plan makePlan(int from, int to) {
+    Plan ans = calloc(1, sizeof(struct plan));
+    ans->from = from;
+    ans->to = MAX(from, to);
+    return ans;
+}
+
+/**
+ * @brief           Adds a filter to a #Plan, keeping only the rows whose value of a column passes a comparison
+ *
+ * @param p         The given #Plan
+ * @param column    The column
+ * @param op        The comparison
+ * @param value     The constant compared to
+ */
+void addPlanFilter(Plan p, int* column, PlanOp op, int value) {
+    if (p->filter_num == PLAN_MAX_FILTERS) {
+        fprintf(stderr, "addPlanFilter: too many filters\n");
+        return;
+    }
+
+    p->filters[p->filter_num++] = (PLANFILTER){ .column = column, .op = op, .value = value };
+}
+
+/**
+ * @brief           Sets the aggregate of a #Plan, grouped by some key columns. A row counts once in each of the distinct
+ *                  keys it holds (so a row whose key columns hold the same key counts once in it)
+ *
+ * @param p         The given #Plan
+ * @param keys      The key columns
+ * @param key_num   The number of key columns (at most @ref PLAN_MAX_KEYS)
+ * @param aggregate The aggregate
+ * @param values    The column aggregated (ignored by @ref PLAN_COUNT)
+ */
+void setPlanGroupBy(Plan p, int** keys, int key_num, PlanAggregate aggregate, int* values) {
+    if (key_num < 1 || key_num > PLAN_MAX_KEYS) {
+        fprintf(stderr, "setPlanGroupBy: invalid number of keys\n");
+        return;
+    }
+
+    for (int k = 0; k < key_num; k++)
+        p->keys[k] = keys[k];
+    p->key_num = key_num;
+    p->aggregate = aggregate;
+    p->values = values;
+}
+
+/**
+ * @brief       Keeps the rows of a selection passing a condition, in order
+ */
+#define FILTER_SELECTION(condition) do { for (int j = 0; j < n; j++) { int _r = selection[j]; \
+            if (condition) selection[kept++] = _r; } } while (0)
+
+/**
+ * @brief           Filters a selection of rows
+ *
+ * @param f         The filter
+ * @param selection The rows selected (narrowed in place)
+ * @param n         The number of rows selected
+ *
+ * @return          The number of rows kept
+ */
+static int filterSelection(PLANFILTER* f, int* selection, int n) {
+    int *column = f->column, value = f->value, kept = 0;
+    switch (f->op) {
+        case PLAN_EQ: FILTER_SELECTION(column[_r] == value); break;
+        case PLAN_NE: FILTER_SELECTION(column[_r] != value); break;
+        case PLAN_GE: FILTER_SELECTION(column[_r] >= value); break;
+        case PLAN_LT: FILTER_SELECTION(column[_r] < value); break;
+        case PLAN_HAS_FLAGS: FILTER_SELECTION((column[_r] & value) == value); break;
+    }
+    return kept;
+}
+
+/**
+ * @brief           Aggregates the rows selected by a #Plan
+ *
+ * @param p         The given #Plan
+ * @param counter   The #Counter to aggregate into
+ * @param selection The rows selected
+ * @param n         The number of rows selected
+ */
+static void aggregateSelection(Plan p, Counter counter, int* selection, int n) {
+    for (int j = 0; j < n; j++) {
+        int r = selection[j];
+        for (int k = 0; k < p->key_num; k++) {
+            int key = p->keys[k][r], seen = 0;
+            while (seen < k && p->keys[seen][r] != key)
+                seen++;
+            if (seen < k)
+                continue;
+
+            if (p->aggregate == PLAN_COUNT)
+                increaseCounter(counter, key, 1);
+            else
+                storeCounterIfGreater(counter, key, p->values[r]);
+        }
+    }
+}
+
+/**
+ * @brief       Runs the plans on a partition of the union of their ranges, a batch of rows at a time
+ *
+ * @param i     The #Indexer whose range is scanned (unused)
+ * @param from  The first row of the partition
+ * @param to    The row after the last row of the partition
+ * @param part  The number of the partition
+ * @param state The #PLANRUN
+ */
+static void runPlanPartition(Indexer i, int from, int to, int part, void* state) {
+    PLANRUN* run = state;
+    int selection[PLAN_BATCH_SIZE];
+    for (int base = from; base < to; base += PLAN_BATCH_SIZE) {
+        if ((base - from) % CANCEL_CHECK_INTERVAL == 0 && isCancelled(run->cancel))
+            return;
+
+        int end = MIN(base + PLAN_BATCH_SIZE, to);
+        for (int k = 0; k < run->n; k++) {
+            Plan p = run->plans[k];
+            int lo = MAX(base, p->from), hi = MIN(end, p->to), n = 0;
+            if (lo >= hi || p->key_num == 0)
+                continue;
+
+            for (int r = lo; r < hi; r++)
+                selection[n++] = r;
+            for (int f = 0; f < p->filter_num && n > 0; f++)
+                n = filterSelection(&p->filters[f], selection, n);
+            aggregateSelection(p, run->counters[part * run->n + k], selection, n);
+        }
+    }
+}
+
+/**
+ * @brief           Merges the partial aggregate of a #Plan in a partition into that of another partition: the counts
+ *                  are added, the maxima are kept if greater
+ *
+ * @param p         The #Plan
+ * @param dest      The #Counter to merge into
+ * @param src       The #Counter merged (left unchanged)
+ */
+static void mergePartialAggregate(Plan p, Counter dest, Counter src) {
+    if (p->aggregate == PLAN_COUNT) {
+        mergeCounter(dest, src);
+        return;
+    }
+
+    int len;
+    COUNTERENTRY* entries = getCounterEntries(src, &len);
+    for (int e = 0; e < len; e++)
+        storeCounterIfGreater(dest, entries[e].key, entries[e].value);
+}
+
+/**
+ * @brief           Runs some plans over the same rows in a single scan of the union of their ranges, in parallel (see
+ *                  @ref scanIndexerRange), storing the result of each (see @ref takePlanResult)
+ *
+ * @param plans     The plans (their columns must have the rows of the positions of the #Indexer)
+ * @param n         The number of plans
+ * @param i         The #Indexer whose positions the rows are
+ * @param cancel    The #CancelToken of the run (the results are partial once it is cancelled)
+ */
+void runPlans(Plan* plans, int n, Indexer i, CancelToken cancel) {
+    int from = INT_MAX, to = 0;
+    for (int k = 0; k < n; k++) {
+        if (plans[k]->from < plans[k]->to) {
+            from = MIN(from, plans[k]->from);
+            to = MAX(to, plans[k]->to);
+        }
+        if (plans[k]->result != NULL)
+            freeCounter(plans[k]->result);
+        plans[k]->result = makeCounter(0);
+    }
+    if (from >= to)
+        return;
+
+    int parts = getScanPartitions(to - from);
+    Counter* counters = malloc(parts * n * sizeof(Counter));
+    for (int k = 0; k < n; k++) {
+        counters[k] = plans[k]->result;
+        for (int p = 1; p < parts; p++)
+            counters[p * n + k] = makeCounter(0);
+    }
+
+    PLANRUN run = { .plans = plans, .n = n, .counters = counters, .cancel = cancel };
+    scanIndexerRange(i, from, to, parts, runPlanPartition, &run);
+    ADD_METRIC(METRIC_ROWS_SCANNED, to - from);
+
+    for (int p = 1; p < parts; p++)
+        for (int k = 0; k < n; k++) {
+            mergePartialAggregate(plans[k], counters[k], counters[p * n + k]);
+            freeCounter(counters[p * n + k]);
+        }
+    free(counters);
+}
+
+/**
+ * @brief       Takes the result of a #Plan which was run (see @ref runPlans)
+ *
+ * @param p     The given #Plan
+ *
+ * @return      The #Counter holding the aggregate of each key (owned by the caller, empty if the #Plan was not run)
+ */
+Counter takePlanResult(Plan p) {
+    Counter ans = p->result != NULL ? p->result : makeCounter(0);
+    p->result = NULL;
+    return ans;
+}
+
+/**
+ * @brief       Frees a #Plan (and its result, unless it was taken)
+ *
+ * @param p     The given #Plan
+ */
+void freePlan(Plan p) {
+    if (p == NULL)
+        return;
+
+    if (p->result != NULL)
+        freeCounter(p->result);
+    free(p);
+}
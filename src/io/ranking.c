@@ -0,0 +1,257 @@
+/**
+ * @file ranking.c
+ *
+ * File containing the implementation of the #Ranking type
+ *
+ * The file starts with the number of groups and the index of the groups (the key of each group and the position of its
+ * first row, followed by the number of rows of the file), written once every group was added. The rows of the groups
+ * follow, one after the other, so reading the first rows of a group is a single seek and read
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "io/ranking.h"
+#include "utils/metrics.h"
+
+/**
+ * @brief An entry of the index of a #Ranking
+ */
+typedef struct rankingGroup {
+    int key;    ///< The key of the group
+    int first;  ///< The position of the first row of the group
+} RANKINGGROUP;
+
+/**
+ * @brief Structure representing a #Ranking
+ */
+struct ranking {
+    FILE* file;             ///< The file of the #Ranking
+    char* path;             ///< The path to the file (for error messages)
+    bool writing;           ///< Whether the #Ranking is being written (or read)
+    int groups;             ///< The number of groups
+    int added;              ///< The number of groups added (when writing)
+    int rows;               ///< The number of rows added (when writing)
+    RANKINGGROUP* index;    ///< The index of the groups (with an extra entry holding the number of rows)
+    COUNTERENTRY* buffer;   ///< The rows read last (when reading)
+    int buffer_size;        ///< The number of rows the buffer holds
+};
+
+/**
+ * @brief       Gets the position in the file of a row of a #Ranking
+ *
+ * @param r     The given #Ranking
+ * @param row   The position of the row
+ *
+ * @return      The position in the file
+ */
+static long getRankingRowOffset(Ranking r, int row) {
+    return (long)sizeof(int) + (long)(r->groups + 1) * sizeof(RANKINGGROUP) + (long)row * sizeof(COUNTERENTRY);
+}
+
+/**
+ * @brief           Allocates a #Ranking
+ *
+ * @param f         The file of the #Ranking
+ * @param path      The path to the file
+ * @param writing   Whether the #Ranking is being written
+ * @param groups    The number of groups
+ *
+ * @return          The #Ranking
+ */
+static Ranking allocRanking(FILE* f, char* path, bool writing, int groups) {
+    Ranking r = malloc(sizeof(struct ranking));
+    r->file = f;
+    r->path = strdup(path);
+    r->writing = writing;
+    r->groups = groups;
+    r->added = r->rows = 0;
+    r->index = calloc((size_t)groups + 1, sizeof(RANKINGGROUP));
+    r->buffer = NULL;
+    r->buffer_size = 0;
+    return r;
+}
+
+/**
+ * @brief           Creates the file of a #Ranking, to which the groups are then added (see @ref addRankingGroup)
+ *
+ * @param path      The path to the file
+ * @param groups    The number of groups of the #Ranking
+ *
+ * @return NULL     If the file could not be created
+ * @return          The #Ranking
+ */
+Ranking makeRanking(char* path, int groups) {
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "makeRanking: could not open file '%s'\n", path);
+        return NULL;
+    }
+
+    Ranking r = allocRanking(f, path, true, groups);
+    //The index is only written once every group was added
+    fseek(f, getRankingRowOffset(r, 0), SEEK_SET);
+    return r;
+}
+
+/**
+ * @brief       Adds the next group to a #Ranking being written
+ *
+ * @param r     The given #Ranking
+ * @param key   The key of the group
+ * @param rows  The rows of the group, in the order they are ranked
+ * @param n     The number of rows
+ *
+ * @return      Whether or not the group was written
+ */
+bool addRankingGroup(Ranking r, int key, COUNTERENTRY* rows, int n) {
+    if (!r->writing || r->added == r->groups) {
+        fprintf(stderr, "addRankingGroup: more groups than expected in '%s'\n", r->path);
+        return false;
+    }
+
+    r->index[r->added++] = (RANKINGGROUP){ .key = key, .first = r->rows };
+    r->rows += n;
+    return n == 0 || fwrite(rows, sizeof(COUNTERENTRY), n, r->file) == (size_t)n;
+}
+
+/**
+ * @brief       Writes the index of a #Ranking being written and frees it
+ *
+ * @param r     The given #Ranking
+ *
+ * @return      Whether or not the file was written (with every group)
+ */
+bool closeRanking(Ranking r) {
+    bool ok = r->added == r->groups;
+    if (!ok)
+        fprintf(stderr, "closeRanking: %d of %d groups added to '%s'\n", r->added, r->groups, r->path);
+
+    r->index[r->groups] = (RANKINGGROUP){ .key = 0, .first = r->rows };
+    fseek(r->file, 0, SEEK_SET);
+    ok = ok && fwrite(&r->groups, sizeof(int), 1, r->file) == 1
+            && fwrite(r->index, sizeof(RANKINGGROUP), r->groups + 1, r->file) == (size_t)r->groups + 1;
+
+    freeRanking(r);
+    return ok;
+}
+
+/**
+ * @brief       Opens a #Ranking written by @ref makeRanking, reading its index
+ *
+ * @param path  The path to the file
+ *
+ * @return NULL If the file does not exist or is not valid
+ * @return      The #Ranking
+ */
+Ranking openRanking(char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    int groups;
+    if (fread(&groups, sizeof(int), 1, f) != 1 || groups < 0) {
+        fprintf(stderr, "openRanking: invalid file '%s'\n", path);
+        fclose(f);
+        return NULL;
+    }
+
+    Ranking r = allocRanking(f, path, false, groups);
+    if (fread(r->index, sizeof(RANKINGGROUP), groups + 1, f) != (size_t)groups + 1) {
+        fprintf(stderr, "openRanking: invalid file '%s'\n", path);
+        freeRanking(r);
+        return NULL;
+    }
+    return r;
+}
+
+/**
+ * @brief       Gets the number of groups of a #Ranking
+ *
+ * @param r     The given #Ranking
+ *
+ * @return      The number of groups
+ */
+int getRankingGroups(Ranking r) {
+    return r->groups;
+}
+
+/**
+ * @brief       Gets the key of a group of a #Ranking
+ *
+ * @param r     The given #Ranking
+ * @param group The position of the group
+ *
+ * @return      The key of the group
+ */
+int getRankingGroupKey(Ranking r, int group) {
+    return r->index[group].key;
+}
+
+/**
+ * @brief       Finds the first group of a #Ranking whose key is not smaller than a given key, searching the index (the
+ *              groups must have been added in increasing order of key)
+ *
+ * @param r     The given #Ranking
+ * @param key   The key
+ *
+ * @return      The position of the group (the number of groups if every key is smaller)
+ */
+int findRankingGroup(Ranking r, int key) {
+    int l = 0, h = r->groups;
+    while (l < h) {
+        int m = l + (h - l) / 2;
+        if (r->index[m].key < key)
+            l = m + 1;
+        else
+            h = m;
+    }
+    return l;
+}
+
+/**
+ * @brief       Reads the first rows of a group of a #Ranking being read
+ *
+ * @param r     The given #Ranking
+ * @param group The position of the group
+ * @param n     The number of rows wanted
+ * @param len   Set to the number of rows read (the least of n and the number of rows of the group)
+ *
+ * @return      The rows, valid until the next call (or until the #Ranking is freed)
+ */
+COUNTERENTRY* readRankingGroup(Ranking r, int group, int n, int* len) {
+    int first = r->index[group].first;
+    int size = MIN(MAX(n, 0), r->index[group + 1].first - first);
+
+    if (size > r->buffer_size) {
+        r->buffer = realloc(r->buffer, (size_t)size * sizeof(COUNTERENTRY));
+        r->buffer_size = size;
+    }
+
+    *len = 0;
+    if (size > 0 && fseek(r->file, getRankingRowOffset(r, first), SEEK_SET) == 0)
+        *len = (int)fread(r->buffer, sizeof(COUNTERENTRY), size, r->file);
+    if (*len != size)
+        fprintf(stderr, "readRankingGroup: unexpected number of rows read from '%s' (read: %d; expected: %d)\n",
+                r->path, *len, size);
+
+    ADD_METRIC(METRIC_ROWS_SCANNED, *len);
+    return r->buffer;
+}
+
+/**
+ * @brief   Frees a #Ranking, closing its file (without writing the index: see @ref closeRanking)
+ *
+ * @param r The given #Ranking
+ */
+void freeRanking(Ranking r) {
+    if (r == NULL)
+        return;
+
+    fclose(r->file);
+    free(r->path);
+    free(r->index);
+    free(r->buffer);
+    free(r);
+}
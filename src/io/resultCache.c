@@ -0,0 +1,421 @@
+/**
+ * @file resultCache.c
+ *
+ * File containing the implementation of the #ResultCache type
+ *
+ * Each result is stored in the file @ref RESULT_CACHE_PREFIX followed by the hash of its key, holding the key (to tell
+ * apart keys with the same hash) and the result. Files are written to a temporary file and renamed, so a result is
+ * either fully there or missing. Once the files take more than the given size, the least recently written are removed
+ */
+
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io/memoryBudget.h"
+#include "io/resultCache.h"
+
+/**
+ * @brief A result kept in memory by a #ResultCache
+ */
+typedef struct resultEntry {
+    char* key;                  ///< The key of the result
+    char* data;                 ///< The result
+    size_t size;                ///< The size of the result
+    struct resultEntry* prev;   ///< The result used before (NULL if it is the most recently used)
+    struct resultEntry* next;   ///< The result used after (NULL if it is the least recently used)
+} RESULTENTRY, * ResultEntry;
+
+/**
+ * @brief Structure representing a #ResultCache
+ */
+struct resultCache {
+    char* dir;                  ///< The directory of the files of the results (ending in '/')
+    pthread_mutex_t mutex;      ///< Mutex guarding the fields below
+    GHashTable* entries;        ///< The results kept in memory, by their key
+    ResultEntry first;          ///< The most recently used result kept in memory
+    ResultEntry last;           ///< The least recently used result kept in memory
+    size_t memory;              ///< The memory the results kept in memory may use
+    size_t used;                ///< The memory used by the results kept in memory
+    size_t disk;                ///< The space the files of the results may take
+    size_t disk_used;           ///< The space taken by the files of the results
+    long hits;                  ///< The number of results found in memory (for statistical purposes only)
+    long disk_hits;             ///< The number of results read from their files (for statistical purposes only)
+    long misses;                ///< The number of results not found (for statistical purposes only)
+};
+
+/**
+ * @brief       Gets the path to the file of a result (FNV-1a hash of its key)
+ *
+ * @param r     The given #ResultCache
+ * @param key   The key of the result
+ *
+ * @return NULL If the path could not be allocated
+ * @return      The path (to be freed)
+ */
+static char* getResultPath(ResultCache r, char* key) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (char* c = key; *c; c++)
+        hash = (hash ^ (unsigned char)*c) * 1099511628211ULL;
+
+    char* path = malloc(strlen(r->dir) + strlen(RESULT_CACHE_PREFIX) + 17);
+    if (path == NULL) {
+        fprintf(stderr, "getResultPath: error allocating the path of a result\n");
+        return NULL;
+    }
+    sprintf(path, "%s" RESULT_CACHE_PREFIX "%016llx", r->dir, hash);
+    return path;
+}
+
+/**
+ * @brief   Removes a result from the LRU list of a #ResultCache
+ *
+ * @param r The given #ResultCache
+ * @param e The result
+ */
+static void unlinkResult(ResultCache r, ResultEntry e) {
+    if (e->prev) e->prev->next = e->next; else r->first = e->next;
+    if (e->next) e->next->prev = e->prev; else r->last = e->prev;
+    e->prev = e->next = NULL;
+}
+
+/**
+ * @brief   Adds a result to the front of the LRU list of a #ResultCache
+ *
+ * @param r The given #ResultCache
+ * @param e The result
+ */
+static void pushResult(ResultCache r, ResultEntry e) {
+    e->prev = NULL;
+    e->next = r->first;
+    if (r->first) r->first->prev = e; else r->last = e;
+    r->first = e;
+}
+
+/**
+ * @brief   Forgets the least recently used result kept in memory by a #ResultCache
+ *
+ * @param r The given #ResultCache
+ */
+static void evictResult(ResultCache r) {
+    ResultEntry e = r->last;
+    unlinkResult(r, e);
+    g_hash_table_remove(r->entries, e->key);
+    r->used -= e->size;
+    free(e->key);
+    free(e->data);
+    free(e);
+}
+
+/**
+ * @brief       Keeps a copy of a result in the memory of a #ResultCache (if it fits), as the most recently used one
+ *
+ * @warning     Must be called with the mutex of the #ResultCache locked
+ *
+ * @param r     The given #ResultCache
+ * @param key   The key of the result
+ * @param data  The result
+ * @param size  The size of the result
+ */
+static void keepResult(ResultCache r, char* key, char* data, size_t size) {
+    if (size > r->memory || g_hash_table_contains(r->entries, key))
+        return;
+
+    while (r->used + size > r->memory)
+        evictResult(r);
+
+    ResultEntry e = malloc(sizeof(RESULTENTRY));
+    e->key = strdup(key);
+    e->data = malloc(size > 0 ? size : 1);
+    memcpy(e->data, data, size);
+    e->size = size;
+    pushResult(r, e);
+    g_hash_table_insert(r->entries, e->key, e);
+    r->used += size;
+}
+
+/**
+ * @brief       Whether the name of a file in the directory of a #ResultCache is the one of a result
+ *
+ * @param name  The name of the file
+ *
+ * @return      Whether the file holds a result (and not the temporary file of one being written)
+ */
+static bool isResultFile(char* name) {
+    return strncmp(name, RESULT_CACHE_PREFIX, strlen(RESULT_CACHE_PREFIX)) == 0 && strstr(name, ".tmp") == NULL;
+}
+
+/**
+ * @brief A file of a result, found by @ref listResultFiles
+ */
+typedef struct resultFile {
+    char* path;     ///< The path to the file
+    time_t mtime;   ///< When the file was written
+    size_t size;    ///< The size of the file
+} RESULTFILE;
+
+/**
+ * @brief           Lists the files of the results of a #ResultCache
+ *
+ * @param r         The given #ResultCache
+ *
+ * @return          The GArray of #RESULTFILE (to be freed, with their paths)
+ */
+static GArray* listResultFiles(ResultCache r) {
+    GArray* files = g_array_new(FALSE, FALSE, sizeof(RESULTFILE));
+    DIR* d = opendir(r->dir);
+    if (d == NULL)
+        return files;
+
+    struct dirent* e;
+    while ((e = readdir(d)) != NULL) {
+        if (!isResultFile(e->d_name))
+            continue;
+
+        RESULTFILE f = { .path = malloc(strlen(r->dir) + strlen(e->d_name) + 1) };
+        if (f.path == NULL)
+            continue;
+        sprintf(f.path, "%s%s", r->dir, e->d_name);
+        struct stat st;
+        if (stat(f.path, &st) == -1) {
+            free(f.path);
+            continue;
+        }
+        f.mtime = st.st_mtime;
+        f.size = st.st_size;
+        g_array_append_val(files, f);
+    }
+
+    closedir(d);
+    return files;
+}
+
+/**
+ * @brief       Compares two files of results by when they were written
+ *
+ * @param a     The first #RESULTFILE
+ * @param b     The second #RESULTFILE
+ *
+ * @return      Negative if the first was written before, positive if after, 0 otherwise
+ */
+static gint compareResultFiles(gconstpointer a, gconstpointer b) {
+    time_t x = ((RESULTFILE*)a)->mtime, y = ((RESULTFILE*)b)->mtime;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief   Removes the least recently written files of the results of a #ResultCache, until they take at most three
+ *          quarters of the space they may take
+ *
+ * @warning Must be called with the mutex of the #ResultCache locked
+ *
+ * @param r The given #ResultCache
+ */
+static void trimResultFiles(ResultCache r) {
+    GArray* files = listResultFiles(r);
+    g_array_sort(files, compareResultFiles);
+
+    r->disk_used = 0;
+    for (int i = 0; i < files->len; i++)
+        r->disk_used += g_array_index(files, RESULTFILE, i).size;
+
+    for (int i = 0; i < files->len && r->disk_used > r->disk / 4 * 3; i++) {
+        RESULTFILE* f = &g_array_index(files, RESULTFILE, i);
+        if (unlink(f->path) == 0)
+            r->disk_used -= f->size;
+    }
+
+    for (int i = 0; i < files->len; i++)
+        free(g_array_index(files, RESULTFILE, i).path);
+    g_array_free(files, TRUE);
+}
+
+/**
+ * @brief       Creates a #ResultCache
+ *
+ * @param dir   The directory to keep the files of the results in (ending in '/'), i.e. the one of the catalog they
+ *              are solved on
+ * @param memory The memory the most recently used results may use (taken from the memory budget)
+ * @param disk  The space the files of the results may take
+ *
+ * @return      The #ResultCache
+ */
+ResultCache makeResultCache(char* dir, size_t memory, size_t disk) {
+    ResultCache r = malloc(sizeof(struct resultCache));
+    r->dir = strdup(dir);
+    pthread_mutex_init(&r->mutex, NULL);
+    r->entries = g_hash_table_new(g_str_hash, g_str_equal);
+    r->first = r->last = NULL;
+    r->memory = acquireMemory(memory, 0);
+    r->used = 0;
+    r->disk = disk;
+    r->hits = r->disk_hits = r->misses = 0;
+
+    GArray* files = listResultFiles(r);
+    r->disk_used = 0;
+    for (int i = 0; i < files->len; i++) {
+        r->disk_used += g_array_index(files, RESULTFILE, i).size;
+        free(g_array_index(files, RESULTFILE, i).path);
+    }
+    g_array_free(files, TRUE);
+
+    return r;
+}
+
+/**
+ * @brief       Reads the file of a result
+ *
+ * @param path  The path to the file
+ * @param key   The key of the result
+ * @param size  Set to the size of the result
+ *
+ * @return NULL If there is no file or it holds the result of another key
+ * @return      The result (to be freed)
+ */
+static char* readResultFile(char* path, char* key, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return NULL;
+
+    struct stat st;
+    size_t key_len = strlen(key);
+    char* data = NULL;
+
+    if (fstat(fileno(f), &st) == 0 && (size_t)st.st_size > key_len) {
+        char stored[key_len + 1];
+        if (fread(stored, 1, key_len + 1, f) == key_len + 1 && memcmp(stored, key, key_len) == 0
+            && stored[key_len] == '\n') {
+            *size = st.st_size - key_len - 1;
+            data = malloc(*size > 0 ? *size : 1);
+            if (fread(data, 1, *size, f) != *size) {
+                free(data);
+                data = NULL;
+            }
+        }
+    }
+
+    fclose(f);
+    return data;
+}
+
+/**
+ * @brief       Gets the result of a key from a #ResultCache: from memory or, if it is not there, from its file
+ *
+ * @param r     The given #ResultCache
+ * @param key   The key of the result (the normalized text of the query)
+ * @param size  Set to the size of the result
+ *
+ * @return NULL If the result is not in the #ResultCache
+ * @return      A copy of the result (to be freed)
+ */
+char* getResult(ResultCache r, char* key, size_t* size) {
+    pthread_mutex_lock(&r->mutex);
+    ResultEntry e = g_hash_table_lookup(r->entries, key);
+    if (e != NULL) {
+        unlinkResult(r, e);
+        pushResult(r, e);
+        r->hits++;
+        char* data = malloc(e->size > 0 ? e->size : 1);
+        memcpy(data, e->data, e->size);
+        *size = e->size;
+        pthread_mutex_unlock(&r->mutex);
+        return data;
+    }
+    pthread_mutex_unlock(&r->mutex);
+
+    char* path = getResultPath(r, key);
+    char* data = path != NULL ? readResultFile(path, key, size) : NULL;
+    free(path);
+
+    pthread_mutex_lock(&r->mutex);
+    if (data != NULL) {
+        r->disk_hits++;
+        keepResult(r, key, data, *size);
+    } else
+        r->misses++;
+    pthread_mutex_unlock(&r->mutex);
+
+    return data;
+}
+
+/**
+ * @brief       Stores the result of a key in a #ResultCache: in memory and in its file. Results taking more than a
+ *              quarter of the space the files may take are not stored on disk
+ *
+ * @param r     The given #ResultCache
+ * @param key   The key of the result (the normalized text of the query, without line breaks)
+ * @param data  The result
+ * @param size  The size of the result
+ */
+void putResult(ResultCache r, char* key, char* data, size_t size) {
+    pthread_mutex_lock(&r->mutex);
+    keepResult(r, key, data, size);
+    pthread_mutex_unlock(&r->mutex);
+
+    if (size > r->disk / 4)
+        return;
+
+    char* path = getResultPath(r, key);
+    if (path == NULL)
+        return;
+
+    char* tmp = malloc(strlen(path) + 16);
+    if (tmp == NULL) {
+        fprintf(stderr, "putResult: error allocating the path of file '%s'\n", path);
+        free(path);
+        return;
+    }
+    sprintf(tmp, "%s.tmpXXXXXX", path);
+
+    int file_desc = mkstemp(tmp);
+    FILE* f = file_desc == -1 || fchmod(file_desc, 0644) == -1 ? NULL : fdopen(file_desc, "wb");
+    bool ok = f != NULL && fwrite(key, 1, strlen(key), f) == strlen(key) && fputc('\n', f) != EOF
+           && fwrite(data, 1, size, f) == size;
+    if (f != NULL)
+        ok = fclose(f) == 0 && ok;
+    else if (file_desc != -1)
+        close(file_desc);
+
+    if (ok && rename(tmp, path) == 0) {
+        pthread_mutex_lock(&r->mutex);
+        r->disk_used += strlen(key) + 1 + size;
+        if (r->disk_used > r->disk)
+            trimResultFiles(r);
+        pthread_mutex_unlock(&r->mutex);
+    } else {
+        fprintf(stderr, "putResult: could not write file '%s'\n", path);
+        unlink(tmp);
+    }
+
+    free(tmp);
+    free(path);
+}
+
+/**
+ * @brief   Frees a #ResultCache (its files are kept)
+ *
+ * @param r The given #ResultCache
+ */
+void freeResultCache(ResultCache r) {
+    if (r == NULL)
+        return;
+
+    DEBUG_PRINT("Result cache usage: %zu/%zu bytes in memory, %zu/%zu bytes on disk\n", r->used, r->memory,
+                r->disk_used, r->disk);
+    DEBUG_PRINT("Result cache hits: %ld (%ld from disk)\n", r->hits + r->disk_hits, r->disk_hits);
+    DEBUG_PRINT("Result cache misses: %ld\n", r->misses);
+    DEBUG_PRINT("Result cache hit rate: %.2f%%\n",
+                100.0 * (r->hits + r->disk_hits) / MAX(1, r->hits + r->disk_hits + r->misses));
+
+    while (r->last != NULL)
+        evictResult(r);
+    g_hash_table_destroy(r->entries);
+    releaseMemory(r->memory);
+    pthread_mutex_destroy(&r->mutex);
+    free(r->dir);
+    free(r);
+}
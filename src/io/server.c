@@ -0,0 +1,656 @@
+/**
+ * @file server.c
+ *
+ * File containing the implementation of the server answering queries from a resident #Catalog, and of its client
+ *
+ * The protocol is line based: each request is a query in the syntax of the query files, ended by '\n', and each
+ * response is the size of the output of the query, in decimal, ended by '\n' (-1 for an invalid query, which has no
+ * output), followed by the output. The request @ref SERVER_METRICS_REQUEST is answered the same way, with the metrics of
+ * the server. Each connection is answered by its own thread, one query after the other, so the
+ * queries of different connections are answered concurrently
+ *
+ * The server of a shard of a dataset also answers the partial queries (@ref SERVER_PARTIAL_REQUEST) and the logins of
+ * users (@ref SERVER_LOGINS_REQUEST) its coordinator sends (see @ref runCoordinator). A server listens on a Unix socket,
+ * or on a TCP port when its address is "host:port", so the shards may be on other machines. The protocol has no
+ * authentication: whoever reaches the port may run queries and stop the server, so an empty host only listens on the
+ * loopback interface, and every interface is only listened on when asked for (@ref SERVER_ANY_HOST)
+ */
+
+#define _GNU_SOURCE
+#include <glib.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "io/server.h"
+#include "types/queries.h"
+#include "utils/metrics.h"
+
+/**
+ * @brief The state of a running server
+ */
+typedef struct server {
+    Catalog catalog;        ///< The #Catalog the queries are answered from (NULL if coordinating shards)
+    char** shards;          ///< The addresses of the servers of the shards the queries are scattered to (see @ref runCoordinator)
+    int shard_num;          ///< The number of shards (0 unless coordinating)
+    int listener;           ///< The socket accepting the connections
+    bool stopping;          ///< Whether a stop was requested
+    int connections;        ///< The number of connections being answered
+    pthread_mutex_t mutex;  ///< The mutex guarding stopping and connections
+    pthread_cond_t idle;    ///< Signaled when a connection is closed
+} SERVER;
+
+/**
+ * @brief A connection accepted by a server
+ */
+typedef struct connection {
+    SERVER* server;         ///< The server
+    int fd;                 ///< The socket of the connection
+    ShardLinks links;       ///< The connections to the shards the queries are scattered through (NULL if none)
+} CONNECTION;
+
+/**
+ * @brief A connection of a client and the queries it sends (see @ref runClient)
+ */
+typedef struct clientConnection {
+    int fd;                 ///< The socket of the connection
+    char** queries;         ///< The queries of the file
+    int first;              ///< The first query sent through the connection
+    int step;               ///< The number of queries between two sent through the connection
+    int n;                  ///< The number of queries of the file
+    char* output_format;    ///< The format of the paths of the output files (with the number of the query, from 1)
+    bool ok;                ///< Whether every query sent was answered and its output written
+} CLIENTCONNECTION;
+
+/**
+ * @brief       Writes the whole of a buffer to a socket
+ *
+ * @param fd    The socket
+ * @param data  The buffer
+ * @param size  The size of the buffer
+ *
+ * @return      Whether it was written (false if the other end closed the connection)
+ */
+bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0)
+            return false;
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+/**
+ * @brief       Receives a response of a server: its size, then its output
+ *
+ * @param in    The stream reading the connection
+ * @param data  Set to the output, ended by '\0' (NULL if there is none, to be freed by the caller)
+ * @param size  Set to the size of the output
+ *
+ * @return      Whether the output was received (false for an invalid query, if the connection was closed, or if the
+ *              output is larger than @ref SERVER_MAX_RESPONSE_SIZE or could not be allocated, in which case it is left
+ *              unread and the connection should not be used again)
+ */
+bool receiveResponse(FILE* in, char** data, size_t* size) {
+    char header[32];
+    long len;
+    *data = NULL;
+    *size = 0;
+    if (fgets(header, sizeof(header), in) == NULL || sscanf(header, "%ld", &len) != 1 || len < 0)
+        return false;
+
+    if (len > SERVER_MAX_RESPONSE_SIZE) {
+        fprintf(stderr, "receiveResponse: response of %ld bytes is too large\n", len);
+        return false;
+    }
+
+    *data = malloc(len + 1);
+    if (*data == NULL) {
+        fprintf(stderr, "receiveResponse: error allocating a response of %ld bytes\n", len);
+        return false;
+    }
+    *size = fread(*data, 1, len, in);
+    (*data)[*size] = '\0';
+    return *size == (size_t)len;
+}
+
+/**
+ * @brief           Fills the address of a socket: of a TCP port if the address is "host:port", of a Unix socket
+ *                  otherwise. An empty host is the loopback interface, and @ref SERVER_ANY_HOST every interface when
+ *                  listening (the loopback one when connecting)
+ *
+ * @param path      The address (the path to a Unix socket, or "host:port")
+ * @param listening Whether the address is listened on (or connected to)
+ * @param which     The position of the address among those the host resolves to (ex: its IPv6 and IPv4 addresses)
+ * @param addr      Where to write the address
+ * @param len       Where to write the length of the address
+ *
+ * @return          Whether the address was resolved (false if the host resolves to fewer addresses)
+ */
+static bool getSocketAddress(char* path, bool listening, int which, struct sockaddr_storage* addr, socklen_t* len) {
+    memset(addr, 0, sizeof(*addr));
+    char* colon = strrchr(path, ':');
+
+    if (colon != NULL && strchr(path, '/') == NULL) {
+        char host[256];
+        snprintf(host, sizeof(host), "%.*s", (int)(colon - path), path);
+        bool any = strcmp(host, SERVER_ANY_HOST) == 0;
+        //Without AI_PASSIVE, a NULL host resolves to the loopback interface
+        struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM,
+                                  .ai_flags = any && listening ? AI_PASSIVE : 0 };
+        struct addrinfo* info;
+        if (getaddrinfo(host[0] != '\0' && !any ? host : NULL, colon + 1, &hints, &info) != 0) {
+            fprintf(stderr, "getSocketAddress: could not resolve '%s'\n", path);
+            return false;
+        }
+        struct addrinfo* chosen = info;
+        for (int k = 0; k < which && chosen != NULL; k++)
+            chosen = chosen->ai_next;
+        if (chosen != NULL) {
+            memcpy(addr, chosen->ai_addr, chosen->ai_addrlen);
+            *len = chosen->ai_addrlen;
+        }
+        freeaddrinfo(info);
+        return chosen != NULL;
+    }
+
+    if (which > 0)
+        return false;
+
+    struct sockaddr_un* un = (struct sockaddr_un*)addr;
+    un->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(un->sun_path)) {
+        fprintf(stderr, "getSocketAddress: the path '%s' is too long\n", path);
+        return false;
+    }
+    strcpy(un->sun_path, path);
+    *len = sizeof(*un);
+    return true;
+}
+
+/**
+ * @brief       Disables the coalescing of small writes of a TCP socket: the size and the output of a response are sent
+ *              apart, so the output would wait for the size to be acknowledged
+ *
+ * @param fd    The socket (nothing is done to a Unix socket)
+ */
+static void setNoDelay(int fd) {
+    int one = 1;
+    struct sockaddr_storage addr;
+    socklen_t len = sizeof(addr);
+    if (getsockname(fd, (struct sockaddr*)&addr, &len) == 0 && addr.ss_family != AF_UNIX)
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+/**
+ * @brief       Connects to a server, trying each of the addresses its host resolves to
+ *
+ * @param path  The address of the server (the path to its Unix socket, or "host:port")
+ *
+ * @return      The socket of the connection (-1 if no server answers there)
+ */
+int connectToServer(char* path) {
+    struct sockaddr_storage addr;
+    socklen_t len = 0;
+    int fd = -1;
+
+    for (int which = 0; fd == -1 && getSocketAddress(path, false, which, &addr, &len); which++) {
+        fd = socket(addr.ss_family, SOCK_STREAM, 0);
+        if (fd != -1 && connect(fd, (struct sockaddr*)&addr, len) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd != -1)
+        setNoDelay(fd);
+    return fd;
+}
+
+/**
+ * @brief           Writes the logins of users, one per line (an empty line for an id with no #User)
+ *
+ * @param catalog   The #Catalog
+ * @param ids       The ids of the users, separated by spaces
+ * @param stream    The stream to write to
+ */
+static void writeLogins(Catalog catalog, char* ids, FILE* stream) {
+    GArray* list = g_array_new(FALSE, FALSE, sizeof(int));
+    for (char* end; ; ids = end) {
+        int id = (int)strtol(ids, &end, 10);
+        if (end == ids)
+            break;
+        g_array_append_val(list, id);
+    }
+
+    int* offsets = malloc(MAX(list->len, 1) * sizeof(int));
+    char* logins = getUserLogins(catalog, (int*)list->data, list->len, offsets);
+    for (guint i = 0; i < list->len; i++)
+        fprintf(stream, "%s\n", logins + offsets[i]);
+
+    free(logins);
+    free(offsets);
+    g_array_free(list, TRUE);
+}
+
+/**
+ * @brief           Answers a request of a connection: a query, from the #Catalog of the server or from its shards, or
+ *                  one of the requests the protocol defines
+ *
+ * @param s         The server
+ * @param c         The connection
+ * @param request   The request, as in a query file (changed in place)
+ *
+ * @return          Whether the response was sent
+ */
+static bool answerQuery(SERVER* s, CONNECTION* c, char* request) {
+    trimNewLine(request, strlen(request));
+    char* output;
+    size_t size;
+    FILE* stream = open_memstream(&output, &size);
+    bool answered = true;
+
+    if (strcmp(request, SERVER_METRICS_REQUEST) == 0)
+        dumpMetrics(stream);
+    else if (s->catalog != NULL && strncmp(request, SERVER_LOGINS_REQUEST, strlen(SERVER_LOGINS_REQUEST)) == 0)
+        writeLogins(s->catalog, request + strlen(SERVER_LOGINS_REQUEST), stream);
+    else {
+        bool partial = strncmp(request, SERVER_PARTIAL_REQUEST, strlen(SERVER_PARTIAL_REQUEST)) == 0;
+        char* text = partial ? request + strlen(SERVER_PARTIAL_REQUEST) : request;
+        char* scattered = s->catalog == NULL ? strdup(text) : NULL;     //parseQuery splits the text
+        Query q = createEmptyQuery();
+        if (*text != '\0')
+            parseQuery(text, q);
+
+        if (getQueryId(q) == -1)
+            answered = false;
+        else if (s->catalog == NULL)
+            answered = !partial && answerScatteredQuery(c->links, q, scattered, stream);
+        else if (partial)
+            answered = executePartialQuery(stream, q, s->catalog, NULL);
+        else
+            executeQuery(stream, q, s->catalog, NULL);
+
+        free(scattered);
+        freeQuery(q);
+    }
+    fclose(stream);
+
+    bool ok;
+    if (!answered)
+        ok = sendAll(c->fd, "-1\n", 3);
+    else {
+        char header[32];
+        int len = sprintf(header, "%zu\n", size);
+        ok = sendAll(c->fd, header, len) && sendAll(c->fd, output, size);
+    }
+
+    free(output);
+    return ok;
+}
+
+/**
+ * @brief   Used with pthread_create to answer the queries of a connection, until it is closed
+ *
+ * @param p The #CONNECTION (freed, along with its socket)
+ *
+ * @return  Always returns NULL (required by pthread_create thread_start prototype)
+ */
+static void* serveConnection(void* p) {
+    CONNECTION* c = (CONNECTION*)p;
+    SERVER* s = c->server;
+    FILE* in = fdopen(dup(c->fd), "r");
+    char* line = NULL;
+    size_t capacity = 0;
+    c->links = s->shard_num > 0 ? connectToShards(s->shards, s->shard_num) : NULL;
+
+    while (in != NULL && getline(&line, &capacity, in) >= 0) {
+        if (strncmp(line, SERVER_STOP_REQUEST, strlen(SERVER_STOP_REQUEST)) == 0
+            && trimNewLine(line, strlen(line)) == (int)strlen(SERVER_STOP_REQUEST)) {
+            pthread_mutex_lock(&s->mutex);
+            s->stopping = true;
+            shutdown(s->listener, SHUT_RDWR);   //Wakes the accept of runServer
+            pthread_mutex_unlock(&s->mutex);
+            sendAll(c->fd, "0\n", 2);
+            break;
+        }
+        if (!answerQuery(s, c, line))
+            break;
+    }
+
+    closeShardLinks(c->links);
+    free(line);
+    if (in != NULL)
+        fclose(in);
+    close(c->fd);
+    free(c);
+
+    pthread_mutex_lock(&s->mutex);
+    s->connections--;
+    pthread_cond_signal(&s->idle);
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+/**
+ * @brief           Answers the connections to a socket until a client requests the server to stop (see @ref stopServer)
+ *
+ * @param s         The server (its #Catalog or shards set)
+ * @param path      The address of the socket (a Unix socket is created, replacing a stale one, and removed when the
+ *                  server stops)
+ * @param caller    The name of the function reporting the errors
+ *
+ * @return          Whether the server could listen on the socket (false if another server does, or if the path is a
+ *                  file other than a socket)
+ */
+static bool serve(SERVER* s, char* path, char* caller) {
+    int running = connectToServer(path);
+    if (running != -1) {
+        fprintf(stderr, "%s: a server is already listening on '%s'\n", caller, path);
+        close(running);
+        return false;
+    }
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    if (!getSocketAddress(path, true, 0, &addr, &addr_len))
+        return false;
+
+    //Only a stale socket (no server answered on it) is replaced, never another kind of file
+    bool unix_socket = addr.ss_family == AF_UNIX;
+    struct stat st;
+    if (unix_socket && lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "%s: '%s' exists and is not a socket\n", caller, path);
+            return false;
+        }
+        unlink(path);
+    }
+
+    int one = 1;
+    s->listener = socket(addr.ss_family, SOCK_STREAM, 0);
+    s->stopping = false;
+    s->connections = 0;
+    if (s->listener != -1 && !unix_socket)
+        setsockopt(s->listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (s->listener == -1 || bind(s->listener, (struct sockaddr*)&addr, addr_len) != 0 || listen(s->listener, SERVER_BACKLOG) != 0) {
+        fprintf(stderr, "%s: could not listen on '%s'\n", caller, path);
+        if (s->listener != -1)
+            close(s->listener);
+        return false;
+    }
+
+    //The identity of the socket created, so it is only removed if still there when the server stops
+    dev_t dev = 0;
+    ino_t ino = 0;
+    if (unix_socket && lstat(path, &st) == 0) {
+        dev = st.st_dev;
+        ino = st.st_ino;
+    }
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->idle, NULL);
+
+    while (true) {
+        int fd = accept(s->listener, NULL, NULL);
+
+        pthread_mutex_lock(&s->mutex);
+        bool stopping = s->stopping;
+        if (fd != -1 && !stopping)
+            s->connections++;
+        pthread_mutex_unlock(&s->mutex);
+
+        if (fd == -1 || stopping) {
+            if (fd != -1)
+                close(fd);
+            if (stopping)
+                break;
+            continue;
+        }
+
+        setNoDelay(fd);
+        CONNECTION* c = malloc(sizeof(CONNECTION));
+        *c = (CONNECTION){ .server = s, .fd = fd, .links = NULL };
+        pthread_t thread;
+        pthread_create(&thread, NULL, serveConnection, c);
+        pthread_detach(thread);
+    }
+
+    close(s->listener);
+    if (unix_socket && lstat(path, &st) == 0 && S_ISSOCK(st.st_mode) && st.st_dev == dev && st.st_ino == ino)
+        unlink(path);
+
+    //The connections still open are answered before the catalog is freed
+    pthread_mutex_lock(&s->mutex);
+    while (s->connections > 0)
+        pthread_cond_wait(&s->idle, &s->mutex);
+    pthread_mutex_unlock(&s->mutex);
+
+    pthread_mutex_destroy(&s->mutex);
+    pthread_cond_destroy(&s->idle);
+    return true;
+}
+
+/**
+ * @brief           Answers the queries sent to a socket from a #Catalog, until a client requests it to stop (see
+ *                  @ref stopServer), keeping the #Catalog and its #Cache warm between them
+ *
+ * @param catalog   The given #Catalog
+ * @param path      The address of the socket (a Unix socket is created, and removed when the server stops)
+ *
+ * @return          Whether the server could listen on the socket (false if another server does)
+ */
+bool runServer(Catalog catalog, char* path) {
+    SERVER s = { .catalog = catalog, .shards = NULL, .shard_num = 0 };
+    return serve(&s, path, "runServer");
+}
+
+/**
+ * @brief           Answers the queries sent to a socket from the servers of the shards of a dataset (see
+ *                  @ref partitionInputs), until a client requests it to stop. Only the queries 5 to 10 are answered (see
+ *                  @ref answerScatteredQuery), each connection scattering them through its own connections to the shards
+ *
+ * @param shards    The addresses of the servers of the shards, in the order of the shards
+ * @param n         The number of shards
+ * @param path      The address of the socket (a Unix socket is created, and removed when the server stops)
+ *
+ * @return          Whether the server could listen on the socket (false if another server does)
+ */
+bool runCoordinator(char** shards, int n, char* path) {
+    SERVER s = { .catalog = NULL, .shards = shards, .shard_num = n };
+    return serve(&s, path, "runCoordinator");
+}
+
+/**
+ * @brief   Used with pthread_create to send the queries of a #CLIENTCONNECTION, writing the output of each to its file
+ *
+ * @param p The #CLIENTCONNECTION
+ *
+ * @return  Always returns NULL (required by pthread_create thread_start prototype)
+ */
+static void* sendQueries(void* p) {
+    CLIENTCONNECTION* c = (CLIENTCONNECTION*)p;
+    FILE* in = fdopen(dup(c->fd), "r");
+    char header[32], path[256], buffer[65536];
+    bool written = true;
+    c->ok = in != NULL;
+
+    for (int q = c->first; q < c->n && c->ok; q += c->step) {
+        long size;
+        c->ok = sendAll(c->fd, c->queries[q], strlen(c->queries[q])) && fgets(header, sizeof(header), in) != NULL
+             && sscanf(header, "%ld", &size) == 1;
+        if (!c->ok || size < 0)
+            continue;
+
+        //An output that cannot be written is still read, so the following responses stay in step
+        snprintf(path, sizeof(path), c->output_format, q + 1);
+        FILE* output = fopen(path, "w");
+        if (output == NULL) {
+            fprintf(stderr, "sendQueries: could not open file '%s'\n", path);
+            written = false;
+        }
+
+        while (size > 0 && c->ok) {
+            size_t read = fread(buffer, 1, MIN((long)sizeof(buffer), size), in);
+            c->ok = read > 0;
+            if (output != NULL && c->ok && fwrite(buffer, 1, read, output) != read) {
+                fprintf(stderr, "sendQueries: could not write to file '%s'\n", path);
+                fclose(output);
+                output = NULL;
+                written = false;
+            }
+            size -= read;
+        }
+        if (output != NULL)
+            fclose(output);
+    }
+
+    c->ok = c->ok && written;
+    if (in != NULL)
+        fclose(in);
+    return NULL;
+}
+
+/**
+ * @brief               Answers a file of queries through a server, writing the output of each query to its own file
+ *                      (as the batch mode does), over up to @ref CLIENT_MAX_CONNECTIONS connections at once
+ *
+ * @param path          The path to the socket of the server
+ * @param queryFile     The path to the file of queries
+ * @param output_format The format of the paths of the output files (with the number of the query, from 1)
+ *
+ * @return              Whether every query was answered (false if no server answers on the socket)
+ */
+bool runClient(char* path, char* queryFile, char* output_format) {
+    int first = connectToServer(path);
+    if (first == -1)
+        return false;
+
+    FILE* file = fopen(queryFile, "r");
+    if (file == NULL) {
+        fprintf(stderr, "runClient: could not open file '%s'\n", queryFile);
+        close(first);
+        return false;
+    }
+
+    //Each query is sent as it is in the file, ended by a line break
+    int n = 0, capacity = 64;
+    char** queries = malloc(capacity * sizeof(char*));
+    char* line = NULL;
+    size_t line_capacity = 0;
+    bool read = queries != NULL;
+    for (ssize_t len; read && (len = getline(&line, &line_capacity, file)) >= 0; n++) {
+        if (n == capacity) {
+            char** grown = realloc(queries, capacity * 2 * sizeof(char*));
+            read = grown != NULL;
+            if (read) {
+                capacity *= 2;
+                queries = grown;
+            }
+        }
+        if (read)
+            read = (queries[n] = malloc(len + 2)) != NULL;
+        if (!read)
+            break;
+        strcpy(queries[n], line);
+        if (len == 0 || line[len - 1] != '\n')
+            strcat(queries[n], "\n");
+    }
+    free(line);
+    fclose(file);
+
+    if (!read) {
+        fprintf(stderr, "runClient: error allocating the queries of file '%s'\n", queryFile);
+        for (int q = 0; q < n; q++)
+            free(queries[q]);
+        free(queries);
+        close(first);
+        return false;
+    }
+
+    int k = MAX(1, MIN(MIN(CLIENT_MAX_CONNECTIONS, (int)sysconf(_SC_NPROCESSORS_ONLN)), n));
+    CLIENTCONNECTION connections[k];
+    pthread_t threads[k];
+    connections[0].fd = first;
+    for (int j = 1; j < k; j++)
+        if ((connections[j].fd = connectToServer(path)) == -1)
+            k = j;
+
+    for (int j = 0; j < k; j++) {
+        connections[j] = (CLIENTCONNECTION){ .fd = connections[j].fd, .queries = queries, .first = j, .step = k, .n = n,
+                                             .output_format = output_format, .ok = true };
+        if (j > 0)
+            pthread_create(&threads[j], NULL, sendQueries, &connections[j]);
+    }
+    sendQueries(&connections[0]);
+
+    bool ok = true;
+    for (int j = 0; j < k; j++) {
+        if (j > 0)
+            pthread_join(threads[j], NULL);
+        ok = ok && connections[j].ok;
+        close(connections[j].fd);
+    }
+
+    for (int q = 0; q < n; q++)
+        free(queries[q]);
+    free(queries);
+    return ok;
+}
+
+/**
+ * @brief       Requests a server to stop, once the connections it has open are closed
+ *
+ * @param path  The path to the socket of the server
+ *
+ * @return      Whether the server acknowledged the request
+ */
+bool stopServer(char* path) {
+    int fd = connectToServer(path);
+    if (fd == -1)
+        return false;
+
+    char reply[8];
+    bool ok = sendAll(fd, SERVER_STOP_REQUEST "\n", strlen(SERVER_STOP_REQUEST) + 1) && recv(fd, reply, sizeof(reply), 0) > 0;
+    close(fd);
+    return ok;
+}
+
+/**
+ * @brief           Gets the metrics of a server (see @ref dumpMetrics)
+ *
+ * @param path      The path to the socket of the server
+ * @param stream    The stream to write the metrics to
+ *
+ * @return          Whether the server sent its metrics
+ */
+bool getServerMetrics(char* path, FILE* stream) {
+    int fd = connectToServer(path);
+    if (fd == -1)
+        return false;
+
+    FILE* in = fdopen(dup(fd), "r");
+    char header[32], buffer[4096];
+    long size = -1;
+    bool ok = in != NULL && sendAll(fd, SERVER_METRICS_REQUEST "\n", strlen(SERVER_METRICS_REQUEST) + 1)
+              && fgets(header, sizeof(header), in) != NULL && sscanf(header, "%ld", &size) == 1 && size >= 0;
+
+    while (ok && size > 0) {
+        size_t read = fread(buffer, 1, MIN((long)sizeof(buffer), size), in);
+        ok = read > 0 && fwrite(buffer, 1, read, stream) == read;
+        size -= read;
+    }
+
+    if (in != NULL)
+        fclose(in);
+    close(fd);
+    return ok;
+}
@@ -0,0 +1,466 @@
+/**
+ * @file shards.c
+ *
+ * File containing the implementation of the shards of a dataset and of the coordinator answering queries from them
+ *
+ * The commits and the repos are split by a hash of the id of the repo, so each repo is in a single shard along with its
+ * commits, while the users are in every shard (the commits and the friendships are validated against them, and any
+ * shard can resolve a login). Each shard is built into its own #Catalog and answered by its own server (see
+ * @ref runServer), so no machine holds more than its shard.
+ *
+ * The coordinator sends the queries 5 to 10 to every shard at once, as partial queries (see @ref executePartialQuery),
+ * and merges the partial aggregates: the values of the users (or languages) are added up before taking the top N, whose
+ * logins are then resolved by the first shard, and the rows of the queries 7 and 10 are merged in the order of their
+ * keys. The values are only ranked once added up, so the top N is the one of the whole dataset
+ */
+
+#include <errno.h>
+#include <glib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io/server.h"
+#include "io/shards.h"
+#include "utils/counter.h"
+#include "utils/metrics.h"
+
+/**
+ * @brief Structure representing the #ShardLinks
+ */
+struct shardLinks {
+    int n;          ///< The number of shards
+    int* fds;       ///< The socket of the connection to each shard
+    FILE** ins;     ///< The stream reading the responses of each shard
+    bool broken;    ///< Whether a connection failed (the responses of the shards may then be out of step)
+};
+
+/**
+ * @brief       Gets the shard of a row of the commits or repos files, by a hash of the id of its repo (its first field)
+ *
+ * @param line  The row
+ * @param n     The number of shards
+ *
+ * @return      The shard
+ */
+static int getRowShard(char* line, int n) {
+    unsigned int x = (unsigned int)atoi(line);
+    x = (x ^ (x >> 16)) * 0x45d9f3bu;
+    x = (x ^ (x >> 16)) * 0x45d9f3bu;
+    return (int)((x ^ (x >> 16)) % (unsigned int)n);
+}
+
+/**
+ * @brief           Splits a file of the dataset into the directories of the shards, keeping its header in each
+ *
+ * @param path      The path to the file
+ * @param dir       The directory of the shards
+ * @param name      The name of the file in the directory of each shard
+ * @param n         The number of shards
+ * @param replicate Whether every row goes to every shard (otherwise, to the shard of its repo, see @ref getRowShard)
+ *
+ * @return          Whether the file was split
+ */
+static bool splitFile(char* path, char* dir, char* name, int n, bool replicate) {
+    FILE* input = fopen(path, "r");
+    if (input == NULL) {
+        fprintf(stderr, "splitFile: could not open file '%s'\n", path);
+        return false;
+    }
+
+    FILE* outputs[n];
+    char out[512];
+    bool ok = true;
+    for (int i = 0; i < n; i++) {
+        snprintf(out, sizeof(out), "%s/shard%d/%s", dir, i, name);
+        outputs[i] = fopen(out, "w");
+        if (outputs[i] == NULL) {
+            fprintf(stderr, "splitFile: could not open file '%s'\n", out);
+            ok = false;
+        } else
+            setvbuf(outputs[i], NULL, _IOFBF, SHARD_BUFFER_SIZE);
+    }
+
+    char* line = NULL;
+    size_t capacity = 0;
+    for (bool header = true; ok && getline(&line, &capacity, input) >= 0; header = false) {
+        if (header || replicate)
+            for (int i = 0; i < n; i++)
+                fputs(line, outputs[i]);
+        else
+            fputs(line, outputs[getRowShard(line, n)]);
+    }
+    free(line);
+
+    for (int i = 0; i < n; i++)
+        if (outputs[i] != NULL && fclose(outputs[i]) != 0)
+            ok = false;
+    fclose(input);
+    return ok;
+}
+
+/**
+ * @brief           Splits a dataset into shards, each in its own directory ("shard" followed by its number, from 0) of
+ *                  the given directory, holding its users.csv, commits.csv and repos.csv, to be built into a #Catalog
+ *                  where it is served (ex: with "--append" and the paths to the files)
+ *
+ * @param users     The path to the users file
+ * @param commits   The path to the commits file
+ * @param repos     The path to the repos file
+ * @param n         The number of shards (up to @ref MAX_SHARDS)
+ * @param dir       The directory of the shards (created if missing)
+ *
+ * @return          Whether every file was split
+ */
+bool partitionInputs(char* users, char* commits, char* repos, int n, char* dir) {
+    if (n < 1 || n > MAX_SHARDS) {
+        fprintf(stderr, "partitionInputs: the number of shards must be between 1 and %d\n", MAX_SHARDS);
+        return false;
+    }
+
+    char path[512];
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "partitionInputs: could not create directory '%s'\n", dir);
+        return false;
+    }
+    for (int i = 0; i < n; i++) {
+        snprintf(path, sizeof(path), "%s/shard%d", dir, i);
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "partitionInputs: could not create directory '%s'\n", path);
+            return false;
+        }
+    }
+
+    return splitFile(users, dir, "users.csv", n, true) && splitFile(commits, dir, "commits.csv", n, false)
+        && splitFile(repos, dir, "repos.csv", n, false);
+}
+
+/**
+ * @brief           Connects to the servers of the shards
+ *
+ * @param paths     The addresses of the servers of the shards (see @ref connectToServer), in the order of the shards
+ * @param n         The number of shards
+ *
+ * @return NULL     If a server does not answer
+ * @return          The #ShardLinks
+ */
+ShardLinks connectToShards(char** paths, int n) {
+    ShardLinks l = malloc(sizeof(struct shardLinks));
+    *l = (struct shardLinks){ .n = 0, .fds = malloc(n * sizeof(int)), .ins = malloc(n * sizeof(FILE*)), .broken = false };
+
+    for (; l->n < n; l->n++) {
+        int fd = connectToServer(paths[l->n]);
+        FILE* in = fd == -1 ? NULL : fdopen(dup(fd), "r");
+        if (in == NULL) {
+            fprintf(stderr, "connectToShards: no server is listening on '%s'\n", paths[l->n]);
+            if (fd != -1)
+                close(fd);
+            closeShardLinks(l);
+            return NULL;
+        }
+        l->fds[l->n] = fd;
+        l->ins[l->n] = in;
+    }
+    return l;
+}
+
+/**
+ * @brief           Sends a request to every shard and receives their responses. Every request is sent before any
+ *                  response is read, so the shards answer it at once
+ *
+ * @param l         The #ShardLinks
+ * @param request   The request, ended by '\n'
+ * @param outputs   Set to the output of each shard (to be freed by the caller, see @ref receiveResponse)
+ *
+ * @return          Whether every shard answered the request
+ */
+static bool scatterRequest(ShardLinks l, char* request, char** outputs) {
+    for (int i = 0; i < l->n; i++)
+        outputs[i] = NULL;
+    if (l->broken)
+        return false;
+
+    int sent = 0;
+    while (sent < l->n && sendAll(l->fds[sent], request, strlen(request)))
+        sent++;
+
+    bool ok = sent == l->n;
+    for (int i = 0; i < sent; i++) {
+        size_t size;
+        ok = receiveResponse(l->ins[i], &outputs[i], &size) && ok;
+    }
+
+    //A shard which did not answer leaves its connection out of step with the requests
+    l->broken = !ok;
+    return ok;
+}
+
+/**
+ * @brief           Adds up the partial aggregates of the shards which are lines "key;value"
+ *
+ * @param outputs   The partial aggregate of each shard
+ * @param n         The number of shards
+ *
+ * @return          The #Counter of the sum of the values of each key
+ */
+static Counter sumPartialCounters(char** outputs, int n) {
+    Counter c = makeCounter(0);
+    for (int i = 0; i < n; i++)
+        for (char* p = outputs[i]; *p != '\0'; ) {
+            char* end;
+            int key = (int)strtol(p, &end, 10);
+            if (*end != ';')
+                break;
+            int value = (int)strtol(end + 1, &end, 10);
+            if (*end != '\n')
+                break;
+            increaseCounter(c, key, value);
+            p = end + 1;
+        }
+    return c;
+}
+
+/**
+ * @brief           Writes the top users of queries 5, 6 and 9, resolving their logins with the first shard (every shard
+ *                  has every user)
+ *
+ * @param l         The #ShardLinks
+ * @param outputs   The partial aggregate of each shard
+ * @param N         The number of users to write
+ * @param value     Whether the value of each user is written (queries 5 and 6)
+ * @param stream    The stream to write to
+ *
+ * @return          Whether the logins were resolved
+ */
+static bool writeTopUsers(ShardLinks l, char** outputs, int N, bool value, FILE* stream) {
+    Counter users = sumPartialCounters(outputs, l->n);
+    int c;
+    COUNTERENTRY* top = getCounterTop(users, N, &c);
+
+    char* request;
+    size_t size;
+    FILE* r = open_memstream(&request, &size);
+    fputs(SERVER_LOGINS_REQUEST, r);
+    for (int i = 0; i < c; i++)
+        fprintf(r, " %d", top[i].key);
+    fputc('\n', r);
+    fclose(r);
+
+    char* logins = NULL;
+    bool ok = !l->broken && sendAll(l->fds[0], request, size) && receiveResponse(l->ins[0], &logins, &size);
+    l->broken = !ok;
+
+    char* login = logins;
+    for (int i = 0; ok && i < c; i++) {
+        char* end = strchr(login, '\n');
+        if (end != NULL)
+            *end = '\0';
+        if (value)
+            fprintf(stream, "%d;%s;%d\n", top[i].key, login, top[i].value);
+        else
+            fprintf(stream, "%d;%s\n", top[i].key, login);
+        login = end != NULL ? end + 1 : login + strlen(login);
+    }
+
+    free(logins);
+    free(request);
+    free(top);
+    freeCounter(users);
+    return ok;
+}
+
+/**
+ * @brief           Writes the top languages of query 8 from the partial aggregates of the shards (lines "value;language").
+ *                  The languages are numbered in the order they are first found, as the ids of the shards differ
+ *
+ * @param outputs   The partial aggregate of each shard (changed in place)
+ * @param n         The number of shards
+ * @param N         The number of languages to write
+ * @param stream    The stream to write to
+ */
+static void writeTopLanguages(char** outputs, int n, int N, FILE* stream) {
+    GHashTable* ids = g_hash_table_new(g_str_hash, g_str_equal);
+    GArray* names = g_array_new(FALSE, FALSE, sizeof(char*));
+    Counter languages = makeCounter(0);
+
+    for (int i = 0; i < n; i++)
+        for (char* p = outputs[i]; *p != '\0'; ) {
+            char* name;
+            int value = (int)strtol(p, &name, 10);
+            char* end = strchr(name, '\n');
+            if (*name != ';' || end == NULL)
+                break;
+            *end = '\0';
+            name++;
+
+            //The ids are stored plus one, as NULL stands for a missing key
+            int id = GPOINTER_TO_INT(g_hash_table_lookup(ids, name)) - 1;
+            if (id == -1) {
+                id = names->len;
+                g_hash_table_insert(ids, name, GINT_TO_POINTER(id + 1));
+                g_array_append_val(names, name);
+            }
+            increaseCounter(languages, id, value);
+            p = end + 1;
+        }
+
+    int c;
+    //One more than wanted, as "none" is not a language
+    COUNTERENTRY* top = getCounterTop(languages, N + 1, &c);
+    for (int i = 0, printed = 0; i < c && printed < N; i++) {
+        char* name = g_array_index(names, char*, top[i].key);
+        if (strcmp(name, "none") != 0) {
+            fprintf(stream, "%s\n", name);
+            printed++;
+        }
+    }
+
+    free(top);
+    freeCounter(languages);
+    g_array_free(names, TRUE);
+    g_hash_table_destroy(ids);
+}
+
+/**
+ * @brief           Gets the key a row of a shard is merged by: its first field (query 7, which is then left out of the
+ *                  output) or its last one (query 10, the id of its repo)
+ *
+ * @param line      The row
+ * @param len       The length of the row (without the '\n')
+ * @param first     Whether the key is the first field
+ *
+ * @return          The key
+ */
+static unsigned long long getRowKey(char* line, size_t len, bool first) {
+    if (first)
+        return strtoull(line, NULL, 10);
+
+    char* field = line + len;
+    while (field > line && field[-1] != ';')
+        field--;
+    return strtoull(field, NULL, 10);
+}
+
+/**
+ * @brief           Merges the rows of the shards in the order of their keys (see @ref getRowKey), each shard writing its
+ *                  rows in that order. The rows of the same key are written shard by shard
+ *
+ * @param outputs   The rows of each shard
+ * @param n         The number of shards
+ * @param first     Whether the key is the first field of the rows (left out of the output)
+ * @param stream    The stream to write to
+ */
+static void mergeShardRows(char** outputs, int n, bool first, FILE* stream) {
+    char* next[n];
+    for (int i = 0; i < n; i++)
+        next[i] = outputs[i];
+
+    while (true) {
+        int best = -1;
+        unsigned long long best_key = 0;
+        for (int i = 0; i < n; i++)
+            if (*next[i] != '\0') {
+                char* end = strchr(next[i], '\n');
+                unsigned long long key = getRowKey(next[i], end != NULL ? (size_t)(end - next[i]) : strlen(next[i]), first);
+                if (best == -1 || key < best_key) {
+                    best = i;
+                    best_key = key;
+                }
+            }
+
+        if (best == -1)
+            break;
+
+        char* line = next[best];
+        char* end = strchr(line, '\n');
+        next[best] = end != NULL ? end + 1 : line + strlen(line);
+
+        char* row = line;
+        if (first) {
+            char* separator = strchr(line, ';');
+            row = separator != NULL && separator < next[best] ? separator + 1 : next[best];
+        }
+        fwrite(row, 1, next[best] - row, stream);
+    }
+}
+
+/**
+ * @brief           Answers a #Query from the servers of the shards, merging their partial aggregates (only the queries 5
+ *                  to 10 are answered, which are all the shards are asked), and profiles it
+ *
+ *                  The ties between languages of query 8 are broken in the order the languages are first found in the
+ *                  shards, and the repos of query 7 with the same last commit date are written shard by shard, so their
+ *                  order may differ from the one of a single #Catalog
+ *
+ * @param l         The #ShardLinks (NULL if they could not be connected)
+ * @param q         The #Query
+ * @param text      The text of the #Query, as in a query file (without the '\n')
+ * @param stream    The stream to write the output to
+ *
+ * @return          Whether the #Query was answered
+ */
+bool answerScatteredQuery(ShardLinks l, Query q, char* text, FILE* stream) {
+    int id = getQueryId(q);
+    if (id == 0)
+        return true;
+    if (l == NULL || id < 5 || id > 10)
+        return false;
+
+    char* request = malloc(strlen(SERVER_PARTIAL_REQUEST) + strlen(text) + 2);
+    if (request == NULL) {
+        fprintf(stderr, "answerScatteredQuery: error allocating the request\n");
+        return false;
+    }
+    sprintf(request, "%s%s\n", SERVER_PARTIAL_REQUEST, text);
+
+    QUERYPROFILE profile;
+    beginQueryProfile(&profile, id);
+    char* outputs[l->n];
+    bool ok = scatterRequest(l, request, outputs);
+
+    if (ok)
+        switch (id) {
+            case 5:
+            case 6:
+                ok = writeTopUsers(l, outputs, getQueryLimit(q), true, stream);
+                break;
+            case 9:
+                ok = writeTopUsers(l, outputs, getQueryLimit(q), false, stream);
+                break;
+            case 7:
+                mergeShardRows(outputs, l->n, true, stream);
+                break;
+            case 8:
+                writeTopLanguages(outputs, l->n, getQueryLimit(q), stream);
+                break;
+            default:
+                mergeShardRows(outputs, l->n, false, stream);
+                break;
+        }
+
+    for (int i = 0; i < l->n; i++)
+        free(outputs[i]);
+    free(request);
+    endQueryProfile(&profile);
+    return ok;
+}
+
+/**
+ * @brief       Closes the connections to the servers of the shards
+ *
+ * @param l     The #ShardLinks (NULL for none)
+ */
+void closeShardLinks(ShardLinks l) {
+    if (l == NULL)
+        return;
+
+    for (int i = 0; i < l->n; i++) {
+        fclose(l->ins[i]);
+        close(l->fds[i]);
+    }
+    free(l->fds);
+    free(l->ins);
+    free(l);
+}
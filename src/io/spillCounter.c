@@ -0,0 +1,230 @@
+/**
+ * @file spillCounter.c
+ *
+ * File containing the implementation of the #SpillCounter type
+ *
+ * The keys are aggregated in a #Counter until it holds as many as the memory granted fits (about @ref SPILL_KEY_SIZE
+ * bytes each). It is then spilled: each entry is appended to the temporary file of its partition, given by the top
+ * bits of the hash of its key (the #Counter places keys by the bottom ones, so the keys of a partition still spread over
+ * its slots), and the #Counter is cleared. A key may be spilled many times, so each partition is aggregated again when
+ * read, and the top entries of the partitions (whose keys are disjoint) are merged into the top of the whole
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "io/memoryBudget.h"
+#include "io/spillCounter.h"
+#include "utils/metrics.h"
+#include "utils/utils.h"
+
+/**
+ * @brief The memory a key of a #Counter may take: its entry and the slots, both grown by doubling (in bytes)
+ */
+#define SPILL_KEY_SIZE 32
+
+/**
+ * @brief The number of entries read from the file of a partition at once
+ */
+#define SPILL_BLOCK_ENTRIES 4096
+
+/**
+ * @brief Structure representing a #SpillCounter
+ */
+struct spillCounter {
+    Counter counter;                    ///< The keys aggregated since the last spill (or the partition read last)
+    bool max;                           ///< Whether the greatest value of each key is kept, instead of their sum
+    size_t memory;                      ///< The memory granted by the budget (see @ref acquireMemory)
+    int limit;                          ///< The number of keys the #Counter holds before being spilled
+    FILE* files[SPILL_PARTITIONS];      ///< The temporary file of each partition (NULL until the first spill)
+    bool spilled;                       ///< Whether the #Counter was ever spilled
+    bool sealed;                        ///< Whether the partitions are being read (so no more values may be added)
+};
+
+/**
+ * @brief       Creates an empty #SpillCounter, acquiring its memory from the budget
+ *
+ * @param max   Whether the greatest value added to each key is kept (see @ref storeCounterIfGreater), instead of the
+ *              sum of the values
+ *
+ * @return      The #SpillCounter
+ */
+SpillCounter makeSpillCounter(bool max) {
+    SpillCounter s = calloc(1, sizeof(struct spillCounter));
+    s->counter = makeCounter(0);
+    s->max = max;
+    s->memory = acquireMemory(getMemoryBudget() / 100 * SPILL_MEMORY_SHARE, SPILL_MIN_MEMORY);
+    s->limit = (int)MIN(s->memory / SPILL_KEY_SIZE, (size_t)INT_MAX);
+    return s;
+}
+
+/**
+ * @brief       Aggregates a value into the entry of a key of a #Counter
+ *
+ * @param s     The #SpillCounter whose aggregate is used
+ * @param c     The #Counter
+ * @param key   The key
+ * @param value The value
+ *
+ * @return      Whether the key was added to the #Counter
+ */
+static inline bool aggregateEntry(SpillCounter s, Counter c, int key, int value) {
+    return s->max ? storeCounterIfGreater(c, key, value) : increaseCounter(c, key, value);
+}
+
+/**
+ * @brief       Appends the entries of the #Counter of a #SpillCounter to the files of their partitions (created on the
+ *              first spill) and clears it
+ *
+ * @param s     The given #SpillCounter
+ */
+static void spillEntries(SpillCounter s) {
+    for (int p = 0; !s->spilled && p < SPILL_PARTITIONS; p++)
+        if ((s->files[p] = tmpfile()) == NULL) {
+            fprintf(stderr, "spillEntries: could not create the files of the partitions, keeping the keys in memory\n");
+            for (int q = 0; q < p; q++) {
+                fclose(s->files[q]);
+                s->files[q] = NULL;
+            }
+            s->limit = INT_MAX;
+            return;
+        }
+
+    int n;
+    COUNTERENTRY* entries = getCounterEntries(s->counter, &n);
+    for (int i = 0; i < n; i++) {
+        unsigned int p = ((unsigned int)entries[i].key * 2654435769u) >> (32 - SPILL_PARTITION_BITS);
+        fwrite(&entries[i], sizeof(COUNTERENTRY), 1, s->files[p]);
+    }
+
+    ADD_METRIC(METRIC_ROWS_SPILLED, n);
+    clearCounter(s->counter);
+    s->spilled = true;
+}
+
+/**
+ * @brief       Adds a value to a key of a #SpillCounter, spilling its keys if they no longer fit in its memory
+ *
+ * @param s     The given #SpillCounter
+ * @param key   The key
+ * @param value The value
+ */
+void addToSpillCounter(SpillCounter s, int key, int value) {
+    if (s->sealed) {
+        fprintf(stderr, "addToSpillCounter: the partitions are already being read\n");
+        return;
+    }
+
+    if (aggregateEntry(s, s->counter, key, value) && getCounterSize(s->counter) >= s->limit)
+        spillEntries(s);
+}
+
+/**
+ * @brief       Adds the values of every key of a #Counter to a #SpillCounter (see @ref addToSpillCounter)
+ *
+ * @param s     The given #SpillCounter
+ * @param c     The #Counter (left unchanged)
+ */
+void mergeIntoSpillCounter(SpillCounter s, Counter c) {
+    int n;
+    COUNTERENTRY* entries = getCounterEntries(c, &n);
+    for (int i = 0; i < n; i++)
+        addToSpillCounter(s, entries[i].key, entries[i].value);
+}
+
+/**
+ * @brief       Gets the number of partitions of the keys of a #SpillCounter (see @ref readSpillPartition)
+ *
+ * @param s     The given #SpillCounter
+ *
+ * @return      The number of partitions (1 if it never spilled)
+ */
+int getSpillPartitions(SpillCounter s) {
+    return s->spilled ? SPILL_PARTITIONS : 1;
+}
+
+/**
+ * @brief       Reads the aggregate of every key of a partition of a #SpillCounter. Once a partition is read, no more
+ *              values may be added
+ *
+ * @param s     The given #SpillCounter
+ * @param part  The partition (less than @ref getSpillPartitions)
+ * @param len   Set to the number of entries
+ *
+ * @return      The entries, valid until the next partition is read (or the #SpillCounter is freed)
+ */
+COUNTERENTRY* readSpillPartition(SpillCounter s, int part, int* len) {
+    if (!s->spilled)
+        return getCounterEntries(s->counter, len);
+
+    if (!s->sealed) {
+        spillEntries(s);
+        s->sealed = true;
+    }
+
+    clearCounter(s->counter);
+    FILE* file = s->files[part];
+    if (fseek(file, 0, SEEK_SET) == 0) {
+        COUNTERENTRY block[SPILL_BLOCK_ENTRIES];
+        for (size_t read; (read = fread(block, sizeof(COUNTERENTRY), SPILL_BLOCK_ENTRIES, file)) > 0; )
+            for (size_t i = 0; i < read; i++)
+                aggregateEntry(s, s->counter, block[i].key, block[i].value);
+    }
+
+    return getCounterEntries(s->counter, len);
+}
+
+/**
+ * @brief       Gets the entries of a #SpillCounter with the largest values, in the order of @ref getCounterTop. Once
+ *              it is called, no more values may be added
+ *
+ *              The top entries of each partition are gathered, keeping only the best n once there are twice as many
+ *
+ * @param s     The given #SpillCounter
+ * @param n     The number of entries wanted
+ * @param len   Set to the number of entries returned
+ *
+ * @return      The entries (to be freed by the caller)
+ */
+COUNTERENTRY* getSpillCounterTop(SpillCounter s, int n, int* len) {
+    if (!s->spilled)
+        return getCounterTop(s->counter, n, len);
+
+    Counter best = makeCounter(0);
+    for (int p = 0; p < SPILL_PARTITIONS; p++) {
+        int k;
+        readSpillPartition(s, p, &k);
+        COUNTERENTRY* top = getCounterTop(s->counter, n, &k);
+        for (int i = 0; i < k; i++)
+            increaseCounter(best, top[i].key, top[i].value);
+        free(top);
+
+        if (getCounterSize(best) >= 2LL * n) {
+            top = getCounterTop(best, n, &k);
+            clearCounter(best);
+            for (int i = 0; i < k; i++)
+                increaseCounter(best, top[i].key, top[i].value);
+            free(top);
+        }
+    }
+
+    COUNTERENTRY* ans = getCounterTop(best, n, len);
+    freeCounter(best);
+    return ans;
+}
+
+/**
+ * @brief       Frees a #SpillCounter, deleting the files of its partitions and giving its memory back to the budget
+ *
+ * @param s     The given #SpillCounter
+ */
+void freeSpillCounter(SpillCounter s) {
+    for (int p = 0; p < SPILL_PARTITIONS; p++)
+        if (s->files[p] != NULL)
+            fclose(s->files[p]);
+
+    releaseMemory(s->memory);
+    freeCounter(s->counter);
+    free(s);
+}
@@ -5,9 +5,11 @@
  */
 
 #include <pthread.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <unistd.h>
 
+#include "io/placement.h"
 #include "io/taskManager.h"
 #include "utils/utils.h"
 
@@ -36,66 +38,468 @@ void* sequence(void* arg_list) {
 }
 
 /**
- * @brief fetches the next task to executed
+ * @brief A task of a #TaskGraph
+ */
+typedef struct taskNode {
+    void* task;             ///< The functions to call, packaged by SEQ
+    int pending;            ///< The number of tasks it depends on which are not done
+    GArray* dependents;     ///< The tasks (ints) depending on it
+} TASKNODE;
+
+/**
+ * @brief Structure representing a graph of tasks
+ */
+struct taskGraph {
+    GArray* tasks;          ///< The #TASKNODE of the graph, in the order they were added
+    int* ready;             ///< The queue of the tasks ready to run (each task enters it once)
+    int first;              ///< The position of the next task to run in the queue
+    int last;               ///< The position after the last task in the queue
+    int done;               ///< The number of tasks done
+    pthread_mutex_t mutex;  ///< The mutex protecting the graph while it runs
+    pthread_cond_t changed; ///< Signaled whenever a task is done
+};
+
+/**
+ * @brief   Creates an empty #TaskGraph
  * 
- * @param p List of the list of tasks their current state,what task is being executed,the state and the routine solver (void* taskList[], int *tasks,  int *currentTask, void* state, routine solver)
+ * @return  The #TaskGraph
+ */
+TaskGraph makeTaskGraph() {
+    TaskGraph g = malloc(sizeof(struct taskGraph));
+    g->tasks = g_array_new(FALSE, FALSE, sizeof(TASKNODE));
+    g->ready = NULL;
+    g->first = g->last = g->done = 0;
+    pthread_mutex_init(&g->mutex, NULL);
+    pthread_cond_init(&g->changed, NULL);
+    return g;
+}
+
+/**
+ * @brief           Adds a task to a #TaskGraph
  * 
- * @return NULL
+ * @warning         The task must stay valid until the graph is run (SEQ packages the functions in the scope it is called)
+ * 
+ * @param g         The given #TaskGraph
+ * @param task      The functions to call, packaged by SEQ
+ * @param dep_no    The number of tasks it depends on, followed by the tasks themselves (as returned by this function)
+ * 
+ * @return          The task (its position in the graph)
  */
-void* fetchTasks(void* p) {
-    void** params = (void**)p;
+int addGraphTask(TaskGraph g, void* task, int dep_no, ...) {
+    int id = g->tasks->len;
+    TASKNODE node = { .task = task, .pending = 0, .dependents = g_array_new(FALSE, FALSE, sizeof(int)) };
 
-    void** taskList = (void**)params[0];
-    int tasks = *(int*)params[1];
-    int *task = (int*)params[2];
-    void*catalog = params[3];
-    void (*solver)(int, void*, void*) = params[4];
-    pthread_mutex_t* mutex = (pthread_mutex_t*)params[5];
-    bool running = true;
+    va_list deps;
+    va_start(deps, dep_no);
+    for (int i = 0; i < dep_no; i++) {
+        int dep = va_arg(deps, int);
+        if (dep < 0 || dep >= id) {
+            fprintf(stderr, "addGraphTask: task %d cannot depend on task %d\n", id, dep);
+            continue;
+        }
 
-    while (running) {
-        pthread_mutex_lock(mutex);
-        int current_task = (*task)++;
-        pthread_mutex_unlock(mutex);
+        g_array_append_val(g_array_index(g->tasks, TASKNODE, dep).dependents, id);
+        node.pending++;
+    }
+    va_end(deps);
+
+    g_array_append_val(g->tasks, node);
+    return id;
+}
 
-        if (current_task >= tasks)
-            running = false;
-        else
-            solver(current_task, taskList[current_task],catalog);
+/**
+ * @brief   Used with pthread_create to run the tasks of a #TaskGraph as they become ready, until all are done
+ * 
+ * @param p The #TaskGraph
+ * 
+ * @return  Always returns NULL (required by pthread_create thread_start prototype)
+ */
+static void* runGraphTasks(void* p) {
+    TaskGraph g = (TaskGraph)p;
+    int n = g->tasks->len;
+
+    pthread_mutex_lock(&g->mutex);
+    while (g->done < n) {
+        if (g->first == g->last) {
+            pthread_cond_wait(&g->changed, &g->mutex);
+            continue;
+        }
+
+        TASKNODE* node = &g_array_index(g->tasks, TASKNODE, g->ready[g->first++]);
+        pthread_mutex_unlock(&g->mutex);
+
+        sequence(node->task);
+
+        pthread_mutex_lock(&g->mutex);
+        g->done++;
+        for (int i = 0; i < node->dependents->len; i++) {
+            TASKNODE* dependent = &g_array_index(g->tasks, TASKNODE, g_array_index(node->dependents, int, i));
+            if (--dependent->pending == 0)
+                g->ready[g->last++] = g_array_index(node->dependents, int, i);
+        }
+        pthread_cond_broadcast(&g->changed);
     }
+    pthread_mutex_unlock(&g->mutex);
 
     return NULL;
 }
 
 /**
- * @brief           Executes a task
+ * @brief           Runs every task of a #TaskGraph, each as soon as the tasks it depends on are done
  * 
- * @param taskList  List of all tasks to be executed
- * @param tasks     Number of the task to execute
- * @param state     Current state of the task
- * @param solver    Solver to the query
- * @param threads   Number of threads avaiable
+ * @param g         The given #TaskGraph
+ * @param threads   The maximum number of tasks run at once
  */
-void executeTasks(void* taskList[], int tasks, void* catalog, void (*solver)(int, void*, void*), int threads) {
+void runTaskGraph(TaskGraph g, int threads) {
+    int n = g->tasks->len;
+    if (threads > n)
+        threads = n;
+    if (threads < 1)
+        return;
 
-    if (tasks < threads)
-        threads = tasks;
+    g->ready = malloc(n * sizeof(int));
+    g->first = g->last = g->done = 0;
+    for (int i = 0; i < n; i++)
+        if (g_array_index(g->tasks, TASKNODE, i).pending == 0)
+            g->ready[g->last++] = i;
 
     pthread_t threadArr[threads];
-    pthread_mutex_t mutex;
-    pthread_mutex_init(&mutex, NULL);
+    for (int i = 1; i < threads; i++)
+        pthread_create(&threadArr[i], NULL, runGraphTasks, g);
+    runGraphTasks(g);
+    for (int i = 1; i < threads; i++)
+        pthread_join(threadArr[i], NULL);
+
+    free(g->ready);
+    g->ready = NULL;
+}
+
+/**
+ * @brief   Frees a #TaskGraph
+ * 
+ * @param g The #TaskGraph to be freed
+ */
+void freeTaskGraph(TaskGraph g) {
+    for (int i = 0; i < g->tasks->len; i++)
+        g_array_free(g_array_index(g->tasks, TASKNODE, i).dependents, TRUE);
+    g_array_free(g->tasks, TRUE);
+    pthread_mutex_destroy(&g->mutex);
+    pthread_cond_destroy(&g->changed);
+    free(g);
+}
+
+/**
+ * @brief The deque of the tasks of a batch left to a worker of a #TaskPool: a range of positions of the batch
+ */
+typedef struct taskDeque {
+    pthread_mutex_t mutex;  ///< The mutex of the deque
+    int first;              ///< The next task the worker runs (it takes tasks from the front)
+    int last;               ///< The position after the last task (thieves take tasks from the back)
+} TASKDEQUE;
 
-    int task = 0;
-    void* params[6] = { taskList, &tasks, &task, catalog, solver, &mutex };
+/**
+ * @brief Structure representing a pool of worker threads
+ */
+struct taskPool {
+    int threads;                        ///< The number of threads running the tasks (the workers and the caller)
+    pthread_t* workers;                 ///< The worker threads (threads - 1, the caller being the first worker)
+    TASKDEQUE* deques;                  ///< The deque of each worker
+
+    void** taskList;                    ///< The tasks of the current batch
+    void* state;                        ///< The state passed to the solver
+    void (*solver)(int, void*, void*);  ///< The function solving a task of the batch
+
+    int batch;                          ///< The number of batches started (the workers wait for the next one)
+    int running;                        ///< The number of workers still running the current batch
+    bool stop;                          ///< Whether or not the workers must stop
+    pthread_mutex_t mutex;              ///< The mutex protecting the batches
+    pthread_cond_t started;             ///< Signaled when a batch is started (or the workers must stop)
+    pthread_cond_t finished;            ///< Signaled when a worker runs out of tasks of the batch
+};
+
+/**
+ * @brief The #TaskPool used by @ref executeTasks (NULL until first needed)
+ */
+static TaskPool defaultPool = NULL;
+
+/**
+ * @brief The number of threads of the #TaskPool used by @ref executeTasks (0 for the number of processors)
+ */
+static int defaultThreads = 0;
+
+/**
+ * @brief The number of threads running batches of a #TaskPool (see @ref getSpareThreads)
+ */
+static int busyThreads = 0;
+
+/**
+ * @brief Whether or not the thread is running a batch of a #TaskPool
+ */
+static __thread bool inPool = false;
+
+/**
+ * @brief               Takes the next task of a worker of a #TaskPool: from the front of its deque or, if it is empty,
+ *                      half of the tasks left at the back of the deque of another worker
+ * 
+ * @param p             The #TaskPool
+ * @param worker        The worker
+ * 
+ * @return              The position of the task in the batch (-1 if there are no tasks left)
+ */
+static int takeTask(TaskPool p, int worker) {
+    TASKDEQUE* own = &p->deques[worker];
+    int task = -1;
+
+    pthread_mutex_lock(&own->mutex);
+    if (own->first < own->last)
+        task = own->first++;
+    pthread_mutex_unlock(&own->mutex);
+
+    for (int k = 1; task == -1 && k < p->threads; k++) {
+        TASKDEQUE* victim = &p->deques[(worker + k) % p->threads];
+
+        pthread_mutex_lock(&victim->mutex);
+        int left = victim->last - victim->first, from = victim->last - (left + 1) / 2, to = victim->last;
+        if (left > 0)
+            victim->last = from;
+        pthread_mutex_unlock(&victim->mutex);
+
+        if (left > 0) {
+            pthread_mutex_lock(&own->mutex);
+            own->first = from + 1;
+            own->last = to;
+            pthread_mutex_unlock(&own->mutex);
+            task = from;
+        }
+    }
+
+    return task;
+}
+
+/**
+ * @brief           Runs the tasks of the current batch of a #TaskPool as a worker, until none is left
+ * 
+ * @param p         The #TaskPool
+ * @param worker    The worker
+ */
+static void runWorker(TaskPool p, int worker) {
+    __atomic_add_fetch(&busyThreads, 1, __ATOMIC_RELAXED);
+    inPool = true;
+
+    for (int task = takeTask(p, worker); task != -1; task = takeTask(p, worker))
+        p->solver(task, p->taskList[task], p->state);
+
+    inPool = false;
+    __atomic_sub_fetch(&busyThreads, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_lock(&p->mutex);
+    if (--p->running == 0)
+        pthread_cond_signal(&p->finished);
+    pthread_mutex_unlock(&p->mutex);
+}
+
+/**
+ * @brief   The routine of a worker thread of a #TaskPool. Runs each batch until the pool is freed
+ * 
+ * @param p The #TaskPool and the number of the worker
+ * 
+ * @return  Always returns NULL (required by pthread_create thread_start prototype)
+ */
+static void* workerRoutine(void* p) {
+    TaskPool pool = (TaskPool)((void**)p)[0];
+    int worker = (int)(long)((void**)p)[1], batch = 0;
+    free(p);
+    placeWorker(worker);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (true) {
+        while (pool->batch == batch && !pool->stop)
+            pthread_cond_wait(&pool->started, &pool->mutex);
+        if (pool->stop)
+            break;
+
+        batch = pool->batch;
+        pthread_mutex_unlock(&pool->mutex);
+        runWorker(pool, worker);
+        pthread_mutex_lock(&pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+/**
+ * @brief           Creates a #TaskPool, starting its worker threads (which wait for batches of tasks), each kept on the
+ *                  processors of a NUMA node (see @ref placeWorker)
+ * 
+ * @param threads   The number of threads running the tasks, the caller of @ref runPoolTasks included
+ *                  (0 for the number of processors)
+ * 
+ * @return          The #TaskPool
+ */
+TaskPool makeTaskPool(int threads) {
+    if (threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    threads = MAX(1, MIN(threads, TASK_POOL_MAX_THREADS));
+
+    TaskPool p = malloc(sizeof(struct taskPool));
+    p->threads = threads;
+    p->workers = malloc(threads * sizeof(pthread_t));
+    p->deques = malloc(threads * sizeof(TASKDEQUE));
+    p->batch = p->running = 0;
+    p->stop = false;
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->started, NULL);
+    pthread_cond_init(&p->finished, NULL);
 
     for (int i = 0; i < threads; i++) {
-        pthread_create(&threadArr[i], NULL, fetchTasks, params);
-        sleep(1);
+        pthread_mutex_init(&p->deques[i].mutex, NULL);
+        p->deques[i].first = p->deques[i].last = 0;
     }
-        
 
-    for (int i = 0; i < threads; i++)
-        pthread_join(threadArr[i], NULL);
+    for (int i = 1; i < threads; i++) {
+        void** args = malloc(2 * sizeof(void*));
+        args[0] = p;
+        args[1] = (void*)(long)i;
+        pthread_create(&p->workers[i], NULL, workerRoutine, args);
+    }
+
+    return p;
+}
+
+/**
+ * @brief   Gets the number of threads running the tasks of a #TaskPool
+ * 
+ * @param p The #TaskPool
+ * 
+ * @return  The number of threads
+ */
+int getTaskPoolThreads(TaskPool p) {
+    return p->threads;
+}
+
+/**
+ * @brief           Runs a batch of tasks on a #TaskPool, returning once all are done. The caller runs tasks as well
+ * 
+ *                  Each worker starts with an even share of the batch, and steals half of the tasks left by another
+ *                  worker once it runs out of its own, so tasks of very different costs keep all of the threads busy
+ * 
+ * @param p         The #TaskPool
+ * @param taskList  List of all tasks to be executed
+ * @param tasks     Number of tasks
+ * @param state     The state passed to the solver (ex: the #Catalog)
+ * @param solver    The function solving a task, given its position, the task and the state
+ */
+void runPoolTasks(TaskPool p, void* taskList[], int tasks, void* state, void (*solver)(int, void*, void*)) {
+    if (tasks <= 0)
+        return;
+
+    p->taskList = taskList;
+    p->state = state;
+    p->solver = solver;
+
+    for (int i = 0; i < p->threads; i++) {
+        pthread_mutex_lock(&p->deques[i].mutex);
+        p->deques[i].first = (int)((long long)tasks * i / p->threads);
+        p->deques[i].last = (int)((long long)tasks * (i + 1) / p->threads);
+        pthread_mutex_unlock(&p->deques[i].mutex);
+    }
 
-    pthread_mutex_destroy(&mutex);
-}
\ No newline at end of file
+    pthread_mutex_lock(&p->mutex);
+    p->running = p->threads;
+    p->batch++;
+    pthread_cond_broadcast(&p->started);
+    pthread_mutex_unlock(&p->mutex);
+
+    runWorker(p, 0);
+
+    pthread_mutex_lock(&p->mutex);
+    while (p->running > 0)
+        pthread_cond_wait(&p->finished, &p->mutex);
+    pthread_mutex_unlock(&p->mutex);
+}
+
+/**
+ * @brief   Frees a #TaskPool, stopping its worker threads
+ * 
+ * @param p The #TaskPool
+ */
+void freeTaskPool(TaskPool p) {
+    if (p == NULL)
+        return;
+
+    pthread_mutex_lock(&p->mutex);
+    p->stop = true;
+    pthread_cond_broadcast(&p->started);
+    pthread_mutex_unlock(&p->mutex);
+
+    for (int i = 1; i < p->threads; i++)
+        pthread_join(p->workers[i], NULL);
+    for (int i = 0; i < p->threads; i++)
+        pthread_mutex_destroy(&p->deques[i].mutex);
+
+    pthread_mutex_destroy(&p->mutex);
+    pthread_cond_destroy(&p->started);
+    pthread_cond_destroy(&p->finished);
+    free(p->deques);
+    free(p->workers);
+    free(p);
+}
+
+/**
+ * @brief   Stops the #TaskPool used by @ref executeTasks. Registered with atexit
+ */
+static void freeDefaultPool() {
+    freeTaskPool(defaultPool);
+    defaultPool = NULL;
+}
+
+/**
+ * @brief           Sets the number of threads @ref executeTasks runs the tasks with by default
+ * 
+ * @param threads   The number of threads (0 for the number of processors)
+ */
+void setTaskThreads(int threads) {
+    defaultThreads = MAX(0, threads);
+}
+
+/**
+ * @brief           Executes the given tasks on the persistent #TaskPool of the program (created on the first call,
+ *                  and again whenever another number of threads is asked for)
+ * 
+ * @param taskList  List of all tasks to be executed
+ * @param tasks     Number of tasks
+ * @param catalog   The state passed to the solver (ex: the #Catalog)
+ * @param solver    Solver to the query
+ * @param threads   Number of threads avaiable (0 for the default, see @ref setTaskThreads)
+ */
+void executeTasks(void* taskList[], int tasks, void* catalog, void (*solver)(int, void*, void*), int threads) {
+    if (threads <= 0)
+        threads = defaultThreads;
+    if (threads <= 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    threads = MAX(1, MIN(threads, TASK_POOL_MAX_THREADS));
+
+    if (defaultPool != NULL && getTaskPoolThreads(defaultPool) != threads)
+        freeDefaultPool();
+    if (defaultPool == NULL) {
+        static bool registered = false;
+        if (!registered)
+            atexit(freeDefaultPool);
+        registered = true;
+        defaultPool = makeTaskPool(threads);
+    }
+
+    runPoolTasks(defaultPool, taskList, tasks, catalog, solver);
+}
+
+/**
+ * @brief   Gets the number of threads a task may use at once without oversubscribing the processors: those not running
+ *          the batches of a #TaskPool, plus the calling thread
+ * 
+ * @return  The number of threads (at least 1)
+ */
+int getSpareThreads() {
+    int ans = (int)sysconf(_SC_NPROCESSORS_ONLN) - __atomic_load_n(&busyThreads, __ATOMIC_RELAXED) + (inPool ? 1 : 0);
+    return MAX(1, ans);
+}
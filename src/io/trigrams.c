@@ -0,0 +1,429 @@
+/**
+ * @file trigrams.c
+ *
+ * File containing the implementation of the #TrigramIndex type
+ *
+ * The file holds its header (see #TRIGRAMHEADER), the segments and the table of the segments, after them. Each segment
+ * is the offset of the posting list of each bucket (and of their end), followed by the posting lists: the position of
+ * each line of the segment holding a trigram of the bucket (relative to the start of the segment, plus one), in
+ * increasing order, each as the difference to the one before it, in a variable number of bytes (7 bits per byte)
+ *
+ * The trigrams are folded to lower case, and the ones with bytes out of ASCII are left out (their case folding depends
+ * on the locale), so the lines found are a superset of the ones holding the substring, checked before being written
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "io/lineReader.h"
+#include "io/trigrams.h"
+
+/**
+ * @brief The version of the layout of the file of a #TrigramIndex (files of other versions are rebuilt)
+ */
+#define TRIGRAM_INDEX_VERSION 1
+
+/**
+ * @brief The header of the file of a #TrigramIndex
+ */
+typedef struct trigramHeader {
+    int version;        ///< @ref TRIGRAM_INDEX_VERSION (0 while the file is being built)
+    int segments;       ///< The number of segments
+    long source_size;   ///< The size of the text file indexed
+    long source_mtime;  ///< The time of the last modification of the text file indexed
+    long table;         ///< The position of the table of the segments
+} TRIGRAMHEADER;
+
+/**
+ * @brief An entry of the table of the segments of a #TrigramIndex
+ */
+typedef struct trigramSegment {
+    long start;         ///< The position in the text file of the first line of the segment
+    long position;      ///< The position of the segment in the file of the #TrigramIndex
+} TRIGRAMSEGMENT;
+
+/**
+ * @brief The posting list of a bucket of the segment being built
+ */
+typedef struct postingList {
+    unsigned char* data;    ///< The encoded positions
+    int size;               ///< The number of bytes of data used
+    int capacity;           ///< The number of bytes of data allocated
+    uint32_t last;          ///< The last position added (0 if none)
+} POSTINGLIST;
+
+/**
+ * @brief Structure representing a #TrigramIndex
+ */
+struct trigramIndex {
+    char* map;                  ///< The file of the index, mapped
+    long size;                  ///< The size of the file of the index
+    TRIGRAMHEADER* header;      ///< The header of the file
+    TRIGRAMSEGMENT* segments;   ///< The table of the segments
+    int source;                 ///< The file descriptor of the text file indexed
+};
+
+/**
+ * @brief       Gets the bucket of the trigram starting at a string
+ *
+ * @param s     The string (at least three characters long)
+ *
+ * @return -1   If the trigram has bytes out of ASCII
+ * @return      The bucket of the trigram, folded to lower case
+ */
+static inline int getTrigramBucket(const char* s) {
+    uint32_t trigram = 0;
+    for (int j = 0; j < 3; j++) {
+        unsigned char c = s[j];
+        if (c >= 128)
+            return -1;
+        trigram = trigram << 8 | (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    }
+    return (trigram * 2654435761u) >> 16;
+}
+
+/**
+ * @brief       Adds a position to a posting list, unless it is the last one added
+ *
+ * @param list  The given posting list
+ * @param pos   The position (larger than or equal to the ones added before, and larger than 0)
+ */
+static void addPosting(POSTINGLIST* list, uint32_t pos) {
+    if (list->last == pos)
+        return;
+
+    if (list->size + 5 > list->capacity) {
+        list->capacity = MAX(list->capacity * 2, 16);
+        list->data = realloc(list->data, list->capacity);
+    }
+
+    uint32_t delta = pos - list->last;
+    while (delta >= 128) {
+        list->data[list->size++] = (delta & 127) | 128;
+        delta >>= 7;
+    }
+    list->data[list->size++] = delta;
+    list->last = pos;
+}
+
+/**
+ * @brief           Writes the posting lists of a segment, emptying them
+ *
+ * @param out       The file of the index, written at its current position
+ * @param lists     The posting lists of the buckets
+ *
+ * @return          Whether the segment was written
+ */
+static bool writeSegment(FILE* out, POSTINGLIST* lists) {
+    uint32_t* offsets = malloc((TRIGRAM_BUCKETS + 1) * sizeof(uint32_t));
+    offsets[0] = 0;
+    for (int b = 0; b < TRIGRAM_BUCKETS; b++)
+        offsets[b + 1] = offsets[b] + lists[b].size;
+
+    bool ok = fwrite(offsets, sizeof(uint32_t), TRIGRAM_BUCKETS + 1, out) == TRIGRAM_BUCKETS + 1;
+    for (int b = 0; b < TRIGRAM_BUCKETS; b++) {
+        ok = ok && fwrite(lists[b].data, 1, lists[b].size, out) == (size_t)lists[b].size;
+        lists[b].size = 0;
+        lists[b].last = 0;
+    }
+
+    free(offsets);
+    return ok;
+}
+
+/**
+ * @brief               Builds the #TrigramIndex of a text file, reading it once
+ *
+ * @param infile        The path to the text file
+ * @param index_file    The path to the file of the index
+ *
+ * @return              Whether the index was written
+ */
+bool buildTrigramIndex(char* infile, char* index_file) {
+    struct stat st;
+    if (stat(infile, &st) != 0) {
+        fprintf(stderr, "buildTrigramIndex: could not open file '%s'\n", infile);
+        return false;
+    }
+
+    FILE* out = fopen(index_file, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "buildTrigramIndex: could not open file '%s'\n", index_file);
+        return false;
+    }
+
+    TRIGRAMHEADER header = { .version = 0, .segments = 0, .source_size = st.st_size, .source_mtime = st.st_mtime };
+    bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+
+    POSTINGLIST* lists = calloc(TRIGRAM_BUCKETS, sizeof(POSTINGLIST));
+    int capacity = 64;
+    TRIGRAMSEGMENT* segments = malloc(capacity * sizeof(TRIGRAMSEGMENT));
+    long start = 0, pos;
+    bool empty = true;
+    char* line;
+    int len;
+
+    LineReader r = openLineReader(infile, 0, -1);
+    while (pos = getLineReaderPos(r), (len = readLine(r, &line)) >= 0) {
+        if (!empty && pos - start >= TRIGRAM_SEGMENT_SIZE) {
+            if (header.segments == capacity) {
+                capacity *= 2;
+                segments = realloc(segments, capacity * sizeof(TRIGRAMSEGMENT));
+            }
+            segments[header.segments++] = (TRIGRAMSEGMENT){ .start = start, .position = ftell(out) };
+            ok = writeSegment(out, lists) && ok;
+            start = pos;
+            empty = true;
+        }
+
+        for (int j = 0; j + 3 <= len; j++) {
+            int b = getTrigramBucket(line + j);
+            if (b != -1)
+                addPosting(&lists[b], (uint32_t)(pos - start) + 1);
+        }
+        empty = false;
+    }
+    closeLineReader(r);
+
+    if (!empty) {
+        if (header.segments == capacity)
+            segments = realloc(segments, (capacity + 1) * sizeof(TRIGRAMSEGMENT));
+        segments[header.segments++] = (TRIGRAMSEGMENT){ .start = start, .position = ftell(out) };
+        ok = writeSegment(out, lists) && ok;
+    }
+
+    header.table = ftell(out);
+    ok = fwrite(segments, sizeof(TRIGRAMSEGMENT), header.segments, out) == (size_t)header.segments && ok;
+    header.version = TRIGRAM_INDEX_VERSION;
+    fseek(out, 0, SEEK_SET);
+    ok = ok && fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = fclose(out) == 0 && ok;
+
+    for (int b = 0; b < TRIGRAM_BUCKETS; b++)
+        free(lists[b].data);
+    free(lists);
+    free(segments);
+
+    if (!ok) {
+        fprintf(stderr, "buildTrigramIndex: could not write file '%s'\n", index_file);
+        remove(index_file);
+    }
+    return ok;
+}
+
+/**
+ * @brief               Opens the #TrigramIndex of a text file
+ *
+ * @param infile        The path to the text file
+ * @param index_file    The path to the file of the index
+ *
+ * @return NULL         If the index does not exist, is not valid or was built before the text file last changed
+ * @return              The #TrigramIndex
+ */
+TrigramIndex openTrigramIndex(char* infile, char* index_file) {
+    struct stat source_st, st;
+    int source = open(infile, O_RDONLY);
+    if (source == -1)
+        return NULL;
+    int fd = open(index_file, O_RDONLY);
+    if (fd == -1 || fstat(source, &source_st) != 0 || fstat(fd, &st) != 0 || st.st_size < (long)sizeof(TRIGRAMHEADER)) {
+        if (fd != -1)
+            close(fd);
+        close(source);
+        return NULL;
+    }
+
+    char* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        close(source);
+        return NULL;
+    }
+
+    TRIGRAMHEADER* header = (TRIGRAMHEADER*)map;
+    bool valid = header->version == TRIGRAM_INDEX_VERSION && header->source_size == source_st.st_size
+              && header->source_mtime == source_st.st_mtime && header->segments >= 0 && header->table >= 0
+              && header->table + (long)(header->segments * sizeof(TRIGRAMSEGMENT)) == st.st_size;
+    for (int s = 0; valid && s < header->segments; s++) {
+        TRIGRAMSEGMENT* segment = (TRIGRAMSEGMENT*)(map + header->table) + s;
+        long postings = segment->position + (long)((TRIGRAM_BUCKETS + 1) * sizeof(uint32_t));
+        valid = segment->position >= 0 && postings <= header->table
+             && postings + ((uint32_t*)(map + segment->position))[TRIGRAM_BUCKETS] <= header->table;
+    }
+    if (!valid) {
+        munmap(map, st.st_size);
+        close(source);
+        return NULL;
+    }
+
+    TrigramIndex t = malloc(sizeof(struct trigramIndex));
+    t->map = map;
+    t->size = st.st_size;
+    t->header = header;
+    t->segments = (TRIGRAMSEGMENT*)(map + header->table);
+    t->source = source;
+    return t;
+}
+
+/**
+ * @brief           Decodes a posting list
+ *
+ * @param p         The encoded posting list
+ * @param end       The end of the encoded posting list
+ * @param dest      Where to write the positions (at least as many as the bytes of the list)
+ *
+ * @return          The number of positions
+ */
+static int decodePostings(unsigned char* p, unsigned char* end, uint32_t* dest) {
+    int n = 0;
+    uint32_t pos = 0;
+    while (p < end) {
+        uint32_t delta = 0;
+        for (int shift = 0; p < end; shift += 7) {
+            unsigned char byte = *p++;
+            delta |= (uint32_t)(byte & 127) << shift;
+            if (!(byte & 128))
+                break;
+        }
+        pos += delta;
+        dest[n++] = pos;
+    }
+    return n;
+}
+
+/**
+ * @brief           Reads the line of a text file starting at a position. Removes the '\r' and '\n' at its end
+ *
+ * @param fd        The file descriptor of the text file
+ * @param pos       The position of the line
+ * @param buffer    The buffer the line is read to (may be reallocated)
+ * @param size      The size of the buffer
+ *
+ * @return          The line (in the buffer)
+ */
+static char* readLineAt(int fd, long pos, char** buffer, int* size) {
+    int len = 0;
+    char* newline = NULL;
+    while (newline == NULL) {
+        if (len + 4096 > *size) {
+            *size = MAX(*size * 2, len + 4096);
+            *buffer = realloc(*buffer, *size + 1);
+        }
+        ssize_t read = pread(fd, *buffer + len, *size - len, pos + len);
+        if (read <= 0)
+            break;
+        newline = memchr(*buffer + len, '\n', read);
+        len += read;
+    }
+
+    if (newline != NULL)
+        len = newline - *buffer;
+    if (len > 0 && (*buffer)[len - 1] == '\r')
+        len--;
+    (*buffer)[len] = '\0';
+    return *buffer;
+}
+
+/**
+ * @brief           Writes the lines of the text file of a #TrigramIndex where a substring occurs (ignoring case), in
+ *                  the order of the file: the posting lists of the buckets of the trigrams of the substring are
+ *                  intersected in each segment, and only the lines left are read and checked
+ *
+ * @param t         The given #TrigramIndex
+ * @param substring The substring to search for
+ * @param max_lines The maximum number of lines written (-1 for every line)
+ * @param output    The file to write the lines to
+ *
+ * @return          Whether the search was done (false, without writing, if the substring has no trigram indexed)
+ */
+bool searchTrigramIndex(TrigramIndex t, char* substring, int max_lines, FILE* output) {
+    int len = strlen(substring), buckets[len + 1], n = 0;
+    for (int j = 0; j + 3 <= len; j++) {
+        int b = getTrigramBucket(substring + j), k = 0;
+        while (k < n && buckets[k] != b)
+            k++;
+        if (b != -1 && k == n)
+            buckets[n++] = b;
+    }
+    if (n == 0)
+        return false;
+
+    uint32_t *candidates = NULL, *other = NULL;
+    int capacity = 0, size = 0;
+    char* line = NULL;
+
+    for (int s = 0; s < t->header->segments && max_lines != 0; s++) {
+        uint32_t* offsets = (uint32_t*)(t->map + t->segments[s].position);
+        unsigned char* postings = (unsigned char*)(offsets + TRIGRAM_BUCKETS + 1);
+
+        //The shortest list is decoded first, the others intersected with it
+        int shortest = 0;
+        for (int k = 1; k < n; k++)
+            if (offsets[buckets[k] + 1] - offsets[buckets[k]] < offsets[buckets[shortest] + 1] - offsets[buckets[shortest]])
+                shortest = k;
+
+        int longest = 0;
+        for (int k = 0; k < n; k++)
+            longest = MAX(longest, (int)(offsets[buckets[k] + 1] - offsets[buckets[k]]));
+        if (longest > capacity) {
+            capacity = longest;
+            candidates = realloc(candidates, capacity * sizeof(uint32_t));
+            other = realloc(other, capacity * sizeof(uint32_t));
+        }
+
+        int b = buckets[shortest];
+        int count = decodePostings(postings + offsets[b], postings + offsets[b + 1], candidates);
+        for (int k = 0; k < n && count > 0; k++) {
+            if (k == shortest)
+                continue;
+            b = buckets[k];
+            int m = decodePostings(postings + offsets[b], postings + offsets[b + 1], other), kept = 0;
+            for (int x = 0, y = 0; x < count && y < m;) {
+                if (candidates[x] < other[y])
+                    x++;
+                else if (candidates[x] > other[y])
+                    y++;
+                else {
+                    candidates[kept++] = candidates[x++];
+                    y++;
+                }
+            }
+            count = kept;
+        }
+
+        for (int x = 0; x < count && max_lines != 0; x++) {
+            readLineAt(t->source, t->segments[s].start + candidates[x] - 1, &line, &size);
+            if (strcasestr(line, substring)) {
+                fprintf(output, "%s\n", line);
+                if (max_lines > 0)
+                    max_lines--;
+            }
+        }
+    }
+
+    free(candidates);
+    free(other);
+    free(line);
+    return true;
+}
+
+/**
+ * @brief   Closes a #TrigramIndex and frees the memory allocated to it
+ *
+ * @param t The given #TrigramIndex
+ */
+void closeTrigramIndex(TrigramIndex t) {
+    if (t == NULL)
+        return;
+
+    munmap(t->map, t->size);
+    close(t->source);
+    free(t);
+}
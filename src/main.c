@@ -8,15 +8,18 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <math.h>
+#include <string.h>
 
 #include "gui/gui.h"
 #include "gui/page.h"
-#include "io/taskManager.h"
+#include "io/memoryBudget.h"
+#include "io/server.h"
 #include "io/taskManager.h"
 #include "types/catalog.h"
 #include "types/commit.h"
 #include "types/format.h"
 #include "types/queries.h"
+#include "utils/metrics.h"
 #include "utils/querySolver.h"
 #include "utils/utils.h"
 
@@ -55,7 +58,7 @@ void solveTask(int taskIndex, void* task, void* state) {
 
         DEBUG_PRINT("Query %d begin\n", taskIndex + 1);
 
-        executeQuery(output, (Query)task,catalog);
+        executeQuery(output, (Query)task,catalog, NULL);
 
         DEBUG_PRINT("Query %d executed\n", taskIndex + 1);
 
@@ -89,7 +92,8 @@ void readAndExecuteQueries(const char* queryFile, Catalog catalog) {
         g_array_append_val(queries, q);
     }
 
-    executeTasks((void**)queries->data, queries->len,catalog, solveTask, 1);
+    shareQueryScans((Query*)queries->data, queries->len, catalog);
+    executeTasks((void**)queries->data, queries->len,catalog, solveTask, 0);
 
     DEBUG_PRINT("Finished all queries\n");
 
@@ -100,8 +104,23 @@ void readAndExecuteQueries(const char* queryFile, Catalog catalog) {
 /**
  * @brief       Application's main entry point
  * 
- *              If no arguments (apart from the name of the program) are passed, then the #GUI is run. Otherwise it grabs
- *              The queries input file and executes them
+ *              If no arguments (apart from the name of the program) are passed, then the #GUI is run. If "--append" and
+ *              the paths to new users, commits and repos files are passed, the records are appended to the existing #Catalog.
+ *              Otherwise it grabs The queries input file and executes them.
+ * 
+ *              The option "--memory" followed by a number of megabytes, which may be passed anywhere, sets the memory budget
+ *              of the program (by default, a share of the memory available, see @ref getMemoryBudget). The option "--threads"
+ *              followed by a number sets the number of queries run at once in batch mode (by default, one per processor).
+ *              The option "--server" followed by the path to a socket makes the batch mode send the queries to the server
+ *              listening there (run with "--serve" and the path, and stopped with "--stop" and the path), which answers
+ *              them from its warm #Catalog. If no server answers, the queries are run locally. A server address may also
+ *              be "host:port", to listen on (or connect to) a TCP port: ":port" is the loopback interface, and "*:port"
+ *              listens on every interface (see @ref SERVER_ANY_HOST)
+ * 
+ *              "--partition" followed by a number of shards and a directory splits the dataset (or the users, commits and
+ *              repos files following them) into shards there (see @ref partitionInputs), each built into its own #Catalog and served where it is kept. "--coordinate"
+ *              followed by the address of a socket and the addresses of the servers of the shards answers the queries sent
+ *              to the socket from the shards (see @ref runCoordinator)
  * 
  * @param argc  The number of arguments
  * @param argv  The arguments
@@ -111,6 +130,24 @@ void readAndExecuteQueries(const char* queryFile, Catalog catalog) {
  *
  */
 int main(int argc, char* argv[]) {
+    //Options are taken out of the arguments
+    int n = 1, ans = 0;
+    char* server = NULL;
+    char* metrics = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--memory") == 0 && i + 1 < argc)
+            setMemoryBudget((size_t)atoll(argv[++i]) * 1048576);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            setTaskThreads(atoi(argv[++i]));
+        else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc)
+            server = argv[++i];
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+            metrics = argv[++i];     //The metrics of the run are written there once it ends
+        else
+            argv[n++] = argv[i];
+    }
+    argc = n;
+
     if(argc == 1) {
 
         GUI gui = loadGUI();
@@ -124,14 +161,53 @@ int main(int argc, char* argv[]) {
     }
     else if(argc == 2) {
         char *QUERIES_IN = argv[1];
+        if (server != NULL && runClient(server, QUERIES_IN, QUERIES_OUT))
+            return 0;
 		Catalog catalog = loadCatalog();
     	if (catalog == NULL)
         	catalog = newCatalog(USERS_IN, COMMITS_IN, REPOS_IN, true);
         readAndExecuteQueries(QUERIES_IN,catalog);
         freeCatalog(catalog);
     }
+    else if(argc == 5 && strcmp(argv[1], "--append") == 0) {
+        Catalog catalog = appendCatalog(argv[2], argv[3], argv[4], true);
+        if (catalog == NULL)
+            catalog = newCatalog(argv[2], argv[3], argv[4], true);
+        freeCatalog(catalog);
+    }
+    else if(argc == 3 && strcmp(argv[1], "--serve") == 0) {
+        Catalog catalog = loadCatalog();
+        if (catalog == NULL)
+            catalog = newCatalog(USERS_IN, COMMITS_IN, REPOS_IN, true);
+        ans = runServer(catalog, argv[2]) ? 0 : 1;
+        freeCatalog(catalog);
+    }
+    else if((argc == 4 || argc == 7) && strcmp(argv[1], "--partition") == 0) {
+        bool given = argc == 7;
+        if (!partitionInputs(given ? argv[4] : USERS_IN, given ? argv[5] : COMMITS_IN, given ? argv[6] : REPOS_IN,
+                             atoi(argv[2]), argv[3]))
+            ans = 1;
+    }
+    else if(argc >= 4 && strcmp(argv[1], "--coordinate") == 0) {
+        ans = runCoordinator(argv + 3, argc - 3, argv[2]) ? 0 : 1;
+    }
+    else if(argc == 3 && strcmp(argv[1], "--stop") == 0) {
+        if (!stopServer(argv[2])) {
+            fprintf(stderr, "main: no server is listening on '%s'\n", argv[2]);
+            return 1;
+        }
+    }
+    else if(argc == 3 && strcmp(argv[1], "--server-metrics") == 0) {
+        if (!getServerMetrics(argv[2], stdout)) {
+            fprintf(stderr, "main: no server is listening on '%s'\n", argv[2]);
+            return 1;
+        }
+    }
     else{
         printf("Wrong Number of arguments");
     }
-    return 0;
+
+    if (metrics != NULL && !saveMetrics(metrics))
+        ans = 1;
+    return ans;
 }
@@ -3,18 +3,29 @@
  * 
  * File implementing the testing suite of the project
  */
+#define _GNU_SOURCE
 
 #include <dirent.h>
+#include <limits.h>
 #include <malloc.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
+#include "io/cache.h"
+#include "io/indexer.h"
+#include "io/memoryBudget.h"
+#include "io/plan.h"
+#include "io/spillCounter.h"
 #include "io/taskManager.h"
+#include "io/trigrams.h"
 #include "types/catalog.h"
 #include "types/commit.h"
 #include "types/format.h"
 #include "types/queries.h"
+#include "utils/counter.h"
+#include "utils/metrics.h"
 #include "utils/querySolver.h"
 
 /**
@@ -73,6 +84,156 @@
  */
 #define MAX_QUERY_SIZE 128
 
+/**
+ * @brief The argument selecting the unit tests of the data structures (see @ref runUnitTests)
+ * 
+ */
+#define UNIT_TESTS "units"
+
+/**
+ * @brief Checks a condition of a unit test, reporting it if it does not hold
+ * 
+ */
+#define CHECK(condition) checkCondition(condition, #condition, __LINE__)
+
+/**
+ * @brief The number of lines of the tiny #Cache of the unit tests, so a few hundred reads evict every line many times
+ * 
+ */
+#define UNIT_CACHE_LINES 8
+
+/**
+ * @brief The number of lines of @ref CACHE_LINE_SIZE of the file read through the #Cache by the unit tests
+ * 
+ */
+#define UNIT_FILE_LINES 64
+
+/**
+ * @brief The number of threads reading the sharded #Cache at once in the unit tests
+ * 
+ */
+#define UNIT_THREADS 4
+
+/**
+ * @brief The number of ints of the ranges read through the #Cache by many threads at once in the unit tests (all but
+ *        two lines of its tiny #Cache, so two threads cannot pin every line they read at once)
+ * 
+ */
+#define UNIT_RANGE_INTS ((UNIT_CACHE_LINES - 2) * CACHE_LINE_SIZE / (int)sizeof(int))
+
+/**
+ * @brief The number of keys of the #Indexer searched through its tree in the unit tests (several blocks of lines, fewer
+ *        than a learned index is built for)
+ * 
+ */
+#define UNIT_TREE_KEYS 1000
+
+/**
+ * @brief The number of keys of the #Indexer searched through its direct address table in the unit tests
+ * 
+ */
+#define UNIT_DIRECT_KEYS 5000
+
+/**
+ * @brief The number of keys of the #Indexer searched through its learned index in the unit tests
+ * 
+ */
+#define UNIT_LEARNED_KEYS 20000
+
+/**
+ * @brief The file the learned index of the unit tests is persisted next to (with the extensions of its companions)
+ * 
+ */
+#define UNIT_LEARNED_FILE "saida/unitLearned.idx"
+
+/**
+ * @brief The number of keys of the #Counter of the unit tests (many times @ref COUNTER_MIN_SLOTS, so its slots grow)
+ * 
+ */
+#define UNIT_COUNTER_KEYS 1000
+
+/**
+ * @brief The number of groups of the grouped #Indexer of the unit tests
+ * 
+ */
+#define UNIT_GROUPS 300
+
+/**
+ * @brief The number of values of the largest group of the grouped #Indexer of the unit tests
+ * 
+ */
+#define UNIT_GROUP_MAX_SIZE 5000
+
+/**
+ * @brief The number of lines of the #Indexer sorted by the unit tests (many times the runs sorted on a tiny budget)
+ * 
+ */
+#define UNIT_SORT_LINES 60000
+
+/**
+ * @brief The number of distinct keys of the #Indexer sorted by the unit tests (so most keys are repeated)
+ * 
+ */
+#define UNIT_SORT_KEYS 20011
+
+/**
+ * @brief The number of keys of the #SpillCounter of the unit tests forced to spill (a few times those fitting in
+ *        @ref SPILL_MIN_MEMORY)
+ * 
+ */
+#define UNIT_SPILL_KEYS 100000
+
+/**
+ * @brief The number of top entries of the #SpillCounter checked by the unit tests
+ * 
+ */
+#define UNIT_SPILL_TOP 50
+
+/**
+ * @brief The number of rows scanned by the plans of the unit tests (enough to be split into partitions)
+ * 
+ */
+#define UNIT_PLAN_ROWS 100000
+
+/**
+ * @brief The number of lines of the text file searched through its trigrams by the unit tests
+ * 
+ */
+#define UNIT_TEXT_LINES 3000
+
+/**
+ * @brief The text file searched through its trigrams by the unit tests
+ * 
+ */
+#define UNIT_TEXT_FILE "saida/unitTrigrams.txt"
+
+/**
+ * @brief The file of the trigram index of the text file of the unit tests
+ * 
+ */
+#define UNIT_TRIGRAM_FILE "saida/unitTrigrams.tri"
+
+/**
+ * @brief A unit test: a group of checks of a data structure
+ * 
+ */
+typedef struct unitTest {
+    char* name;     ///< The name of the data structure tested
+    void (*run)();  ///< The function running the checks
+} UNITTEST;
+
+/**
+ * @brief The number of checks of the unit test being run
+ * 
+ */
+static int unitChecks = 0;
+
+/**
+ * @brief The number of checks which failed in the unit test being run
+ * 
+ */
+static int unitFailures = 0;
+
 /**
  * @brief               Runs the given #Query
  * 
@@ -100,7 +261,7 @@ bool runQuery(Catalog c, Query q, int queryNumber, char* path) {
     clock_t start, end;
     start = clock();
 
-    executeQuery(output, q, c);
+    executeQuery(output, q, c, NULL);
 
     end = clock();
     double cpu_time_used = ((double) (end - start)) / CLOCKS_PER_SEC;
@@ -277,8 +438,9 @@ int getMemUse() {
  * @param commits   The commits.csv file
  * @param repos     The repos.csv file
  * @param queries   The queries.txt file
+ * @param delta     The users.csv, commits.csv and repos.csv files appended to the catalog before the queries are run (NULL if none)
  */
-void runTest(char* path, char* users, char* commits, char* repos, char* queries) {
+void runTest(char* path, char* users, char* commits, char* repos, char* queries, char* delta[3]) {
     PRINT("Starting test \"%s\"\n", path);
     PRINT("Loading catalogs...\n");
     clock_t start_cpu, end_cpu;
@@ -288,6 +450,10 @@ void runTest(char* path, char* users, char* commits, char* repos, char* queries)
     clock_gettime(CLOCK_REALTIME, &start);
 
     Catalog catalog = newCatalog(users, commits, repos, true);
+    if (delta != NULL) {
+        freeCatalog(catalog);
+        catalog = appendCatalog(delta[0], delta[1], delta[2], true);
+    }
 
     end_cpu = clock();
     clock_gettime(CLOCK_REALTIME, &end);
@@ -298,6 +464,13 @@ void runTest(char* path, char* users, char* commits, char* repos, char* queries)
     PRINT("Catalogs loaded, %f seconds elapsed\n", elapsed);
     PRINT("CPU time: %f seconds\n", cpu_time_used);
 
+    //The published catalog must load back, matching its manifest
+    Catalog published = loadCatalog();
+    PRINT(published == NULL ? RED "The published catalog does not match its manifest\n" RESET
+                            : "The published catalog matches its manifest\n");
+    if (published != NULL)
+        freeCatalog(published);
+
     int ram = getMemUse(); //in MB
     if (ram == -1)
         PRINT("The program was unable to determine memory allocation\n");
@@ -336,6 +509,954 @@ void runTest(char* path, char* users, char* commits, char* repos, char* queries)
     PRINT("End of test\n\n");
 }
 
+/**
+ * @brief           Counts a check of a unit test, reporting it if it failed
+ * 
+ * @param passed    Whether the check passed
+ * @param condition The condition checked
+ * @param line      The line of the check
+ * 
+ * @return          Whether the check passed
+ */
+static bool checkCondition(bool passed, char* condition, int line) {
+    unitChecks++;
+    if (!passed) {
+        unitFailures++;
+        PRINT(RED "Check failed:" RESET " %s (line %d)\n", condition, line);
+    }
+    return passed;
+}
+
+/**
+ * @brief   Creates a temporary file of @ref UNIT_FILE_LINES lines of @ref CACHE_LINE_SIZE, holding the ints from 0 on
+ * 
+ * @return  The file
+ */
+static FILE* makeIntFile() {
+    FILE* file = tmpfile();
+    for (int i = 0; i < UNIT_FILE_LINES * CACHE_LINE_SIZE / (int)sizeof(int); i++)
+        fwrite(&i, sizeof(int), 1, file);
+    fflush(file);
+    return file;
+}
+
+/**
+ * @brief       Reads the ints of a file made by @ref makeIntFile through a #Cache, in a scattered order
+ * 
+ * @param c     The #Cache
+ * @param file  The file
+ * @param seed  The seed of the order
+ * @param reads The number of ints read
+ * 
+ * @return      The number of ints read wrong
+ */
+static int readIntFile(Cache c, FILE* file, unsigned seed, int reads) {
+    int wrong = 0, ints = UNIT_FILE_LINES * CACHE_LINE_SIZE / sizeof(int);
+    for (int r = 0; r < reads; r++) {
+        int j = rand_r(&seed) % ints;
+        wrong += getInt(c, file, (pos_t)j * sizeof(int)) != j;
+    }
+    return wrong;
+}
+
+/**
+ * @brief       Reads ranges of many lines of a file made by @ref makeIntFile through a #Cache, at scattered positions
+ * 
+ * @param c     The #Cache
+ * @param file  The file
+ * @param seed  The seed of the positions
+ * @param reads The number of ranges read
+ * 
+ * @return      The number of ints read wrong
+ */
+static int readIntRanges(Cache c, FILE* file, unsigned seed, int reads) {
+    int wrong = 0, ints = UNIT_FILE_LINES * CACHE_LINE_SIZE / sizeof(int), range[UNIT_RANGE_INTS];
+    for (int r = 0; r < reads; r++) {
+        int j = rand_r(&seed) % (ints - UNIT_RANGE_INTS);
+        getStr(c, file, (pos_t)j * sizeof(int), (char*)range, sizeof(range));
+        for (int k = 0; k < UNIT_RANGE_INTS; k++)
+            wrong += range[k] != j + k;
+    }
+    return wrong;
+}
+
+/**
+ * @brief       Auxiliary function to @ref testCache, reading the file of the #Cache from a thread
+ * 
+ * @param args  The #Cache, the file and the seed
+ * 
+ * @return      The number of ints read wrong
+ */
+static void* readIntFileAux(void* args) {
+    void** pair = args;
+    return (void*)(long)readIntFile(pair[0], pair[1], (unsigned)(long)pair[2], 4096);
+}
+
+/**
+ * @brief       Auxiliary function to @ref testCache, reading ranges of the file of the #Cache from a thread
+ * 
+ * @param args  The #Cache, the file and the seed
+ * 
+ * @return      The number of ints read wrong
+ */
+static void* readIntRangesAux(void* args) {
+    void** pair = args;
+    return (void*)(long)readIntRanges(pair[0], pair[1], (unsigned)(long)pair[2], 1024);
+}
+
+/**
+ * @brief       Auxiliary function to @ref testCache, writing the complement of every @ref UNIT_THREADS -th int of the
+ *              file of the #Cache from a thread, and flushing the #Cache every few writes
+ * 
+ * @param args  The #Cache, the file and the seed (the first int written is the seed-th one)
+ * 
+ * @return      Always NULL
+ */
+static void* writeIntFileAux(void* args) {
+    void** pair = args;
+    int ints = UNIT_FILE_LINES * CACHE_LINE_SIZE / sizeof(int);
+    for (int j = (int)(long)pair[2] - 1, w = 1; j < ints; j += UNIT_THREADS, w++) {
+        int value = ~j;
+        setStr(pair[0], pair[1], (pos_t)j * sizeof(int), (char*)&value, sizeof(int));
+        if (w % 64 == 0)
+            flushCache(pair[0]);
+    }
+    return NULL;
+}
+
+/**
+ * @brief           Reads (or writes) the file of a #Cache from @ref UNIT_THREADS threads at once
+ * 
+ * @param c         The #Cache
+ * @param file      The file
+ * @param routine   The routine of the threads (@ref readIntFileAux, @ref readIntRangesAux or @ref writeIntFileAux)
+ * 
+ * @return          The number of ints read wrong
+ */
+static long readFromThreads(Cache c, FILE* file, void* (*routine)(void*)) {
+    pthread_t tids[UNIT_THREADS];
+    void* args[UNIT_THREADS][3];
+    for (int t = 0; t < UNIT_THREADS; t++) {
+        args[t][0] = c;
+        args[t][1] = file;
+        args[t][2] = (void*)(long)(t + 1);
+        pthread_create(&tids[t], NULL, routine, args[t]);
+    }
+    long wrong = 0;
+    for (int t = 0; t < UNIT_THREADS; t++) {
+        void* ans;
+        pthread_join(tids[t], &ans);
+        wrong += (long)ans;
+    }
+    return wrong;
+}
+
+/**
+ * @brief           Reads a hot line, has it become a ghost, reads it again (promoting it under @ref CACHE_2Q) and
+ *                  scans every other line of the file through a tiny #Cache
+ * 
+ * @param policy    The eviction policy of the #Cache
+ * 
+ * @return          Whether the hot line was still held after the scan
+ */
+static bool hotLineSurvivesScan(CachePolicy policy) {
+    FILE* file = makeIntFile();
+    Cache c = getCache(UNIT_CACHE_LINES, 1, policy);
+
+    getInt(c, file, 0);
+    for (int l = 1; l <= UNIT_CACHE_LINES; l++)
+        getInt(c, file, (pos_t)l * CACHE_LINE_SIZE);
+    getInt(c, file, 0);
+    for (int l = UNIT_CACHE_LINES + 1; l < UNIT_FILE_LINES; l++)
+        getInt(c, file, (pos_t)l * CACHE_LINE_SIZE);
+
+    //A line still held is read from the cache, not from the file changed behind it
+    int changed = -1;
+    fseek(file, 0, SEEK_SET);
+    fwrite(&changed, sizeof(int), 1, file);
+    fflush(file);
+    bool held = getInt(c, file, 0) == 0;
+
+    freeCache(c);
+    fclose(file);
+    return held;
+}
+
+/**
+ * @brief Tests the sharded #Cache: contents and written lines kept under eviction, reads and writes from many threads at
+ *        once and the scan resistance of 2Q
+ */
+static void testCache() {
+    FILE* file = makeIntFile();
+
+    //Every read of a tiny cache evicts a line
+    Cache c = getCache(UNIT_CACHE_LINES, 1, CACHE_2Q);
+    CHECK(readIntFile(c, file, 1, 2048) == 0);
+
+    //A written line is written back when evicted, and read back from the file
+    int marker = -1;
+    setStr(c, file, 3 * CACHE_LINE_SIZE, (char*)&marker, sizeof(int));
+    for (int l = 4; l < UNIT_FILE_LINES; l++)
+        getInt(c, file, (pos_t)l * CACHE_LINE_SIZE);
+    CHECK(getInt(c, file, 3 * CACHE_LINE_SIZE) == -1);
+    flushCache(c);
+    int stored = 0;
+    fseek(file, 3 * CACHE_LINE_SIZE, SEEK_SET);
+    CHECK(fread(&stored, sizeof(int), 1, file) == 1 && stored == -1);
+    marker = 3 * CACHE_LINE_SIZE / sizeof(int); //Restored for the reads below, written back when the cache is freed
+    setStr(c, file, 3 * CACHE_LINE_SIZE, (char*)&marker, sizeof(int));
+    freeCache(c);
+
+    //The shards of a tiny cache read by many threads at once
+    c = getCache(2 * UNIT_CACHE_LINES, UNIT_CACHE_LINES / 2, CACHE_2Q);
+    CHECK(readFromThreads(c, file, readIntFileAux) == 0);
+    freeCache(c);
+
+    //Ranges of many lines read by many threads at once through a single tiny shard
+    c = getCache(UNIT_CACHE_LINES, 1, CACHE_2Q);
+    CHECK(readFromThreads(c, file, readIntRangesAux) == 0);
+    freeCache(c);
+
+    //Ints written by many threads at once, flushing while the others write, all reach the file
+    c = getCache(2 * UNIT_CACHE_LINES, UNIT_CACHE_LINES / 2, CACHE_2Q);
+    readFromThreads(c, file, writeIntFileAux);
+    freeCache(c);
+    int wrong = 0;
+    rewind(file);
+    for (int j = 0, value; j < UNIT_FILE_LINES * CACHE_LINE_SIZE / (int)sizeof(int); j++)
+        wrong += fread(&value, sizeof(int), 1, file) != 1 || value != ~j;
+    CHECK(wrong == 0);
+    fclose(file);
+
+    //A hot line outlives a scan of the file under 2Q, not under LRU
+    CHECK(hotLineSurvivesScan(CACHE_2Q));
+    CHECK(!hotLineSurvivesScan(CACHE_LRU));
+}
+
+/**
+ * @brief       Creates an #Indexer of embedded ints, the keys first, first + step, ... inserted shuffled, each with its
+ *              order as the value, and sorts it
+ * 
+ * @param n     The number of keys
+ * @param first The smallest key
+ * @param step  The difference between consecutive keys
+ * @param c     The #Cache
+ * 
+ * @return      The sorted #Indexer
+ */
+static Indexer makeIntIndexer(int n, int first, int step, Cache c) {
+    Indexer i = makeIndexer(NULL, NULL, NULL, directCmp);
+    for (int j = 0, k = 0; j < n; j++, k = (k + 7919) % n) //7919 is a prime not dividing n, so every k is inserted once
+        insertIntoIndex(i, IMBED_INT(first + k * step), IMBED_INT(k));
+    sortIndexer(i, c);
+    return i;
+}
+
+/**
+ * @brief       Checks the lookups of an #Indexer made by @ref makeIntIndexer, at and around the ends of its range
+ * 
+ * @param i     The #Indexer
+ * @param n     The number of keys
+ * @param first The smallest key
+ * @param step  The difference between consecutive keys (more than 1, so there are keys missing between them)
+ * @param c     The #Cache
+ */
+static void checkIntLookups(Indexer i, int n, int first, int step, Cache c) {
+    int last = first + (n - 1) * step, wrong = 0;
+
+    CHECK(getElemNumber(i) == n);
+    CHECK(retrieveKey(i, IMBED_INT(first), c) == 0);
+    CHECK(retrieveKey(i, IMBED_INT(last), c) == n - 1);
+    CHECK(retrieveKey(i, IMBED_INT(first - 1), c) == -1);
+    CHECK(retrieveKey(i, IMBED_INT(last + 1), c) == -1);
+    CHECK(retrieveKey(i, IMBED_INT(first + 1), c) == -1);
+    CHECK(retrieveKeyLowerBound(i, IMBED_INT(first - 1), c) == 0);
+    CHECK(retrieveKeyLowerBound(i, IMBED_INT(first), c) == 0);
+    CHECK(retrieveKeyLowerBound(i, IMBED_INT(last), c) == n - 1);
+    CHECK(retrieveKeyLowerBound(i, IMBED_INT(last + 1), c) == n);
+    CHECK(retrieveEmbeddedKey(i, 0, c) == IMBED_INT(first));
+    CHECK(retrieveEmbeddedKey(i, n - 1, c) == IMBED_INT(last));
+    CHECK(retrieveEmbeddedValue(i, n - 1, c) == IMBED_INT(n - 1));
+
+    for (int j = 0; j < n; j++) {
+        int key = first + j * step;
+        wrong += retrieveKey(i, IMBED_INT(key), c) != j;
+        wrong += retrieveKey(i, IMBED_INT(key + 1), c) != -1;
+        wrong += retrieveKeyLowerBound(i, IMBED_INT(key + 1), c) != j + 1;
+        wrong += retrieveEmbeddedKey(i, j, c) != IMBED_INT(key);
+    }
+    CHECK(wrong == 0);
+}
+
+/**
+ * @brief Tests the search tree of an #Indexer: lookups of the keys ending its blocks of lines and of the ends of its range
+ */
+static void testSearchTree() {
+    //Too sparse for a direct table and too few for a learned index
+    Cache c = getCache(UNIT_CACHE_LINES, 1, CACHE_2Q);
+    Indexer i = makeIntIndexer(UNIT_TREE_KEYS, 5, 10, c);
+    checkIntLookups(i, UNIT_TREE_KEYS, 5, 10, c);
+    freeIndexer(i, c);
+
+    //A single line, and a single block
+    i = makeIntIndexer(1, 5, 10, c);
+    checkIntLookups(i, 1, 5, 10, c);
+    freeIndexer(i, c);
+    i = makeIntIndexer(64, 5, 10, c);
+    checkIntLookups(i, 64, 5, 10, c);
+    freeIndexer(i, c);
+
+    //An empty index has no keys
+    i = makeIndexer(NULL, NULL, NULL, directCmp);
+    sortIndexer(i, c);
+    CHECK(retrieveKey(i, IMBED_INT(5), c) == -1);
+    CHECK(retrieveKeyLowerBound(i, IMBED_INT(5), c) == 0);
+    freeIndexer(i, c);
+    freeCache(c);
+}
+
+/**
+ * @brief Tests the direct address table of an #Indexer: lookups of dense keys, up to the sparsest a table is built for
+ */
+static void testDirectTable() {
+    Cache c = getCache(UNIT_CACHE_LINES, 1, CACHE_2Q);
+
+    //Every other key up to 4 slots per key (the sparsest a table is built for), then too sparse for a table
+    for (int step = 2; step <= 5; step++) {
+        Indexer i = makeIntIndexer(UNIT_DIRECT_KEYS, 1, step, c);
+        checkIntLookups(i, UNIT_DIRECT_KEYS, 1, step, c);
+        freeIndexer(i, c);
+    }
+
+    //A single key, a table of a single slot
+    Indexer i = makeIntIndexer(1, 1, 2, c);
+    checkIntLookups(i, 1, 1, 2, c);
+    freeIndexer(i, c);
+
+    //Repeated keys share their slot, found at the first of them
+    i = makeIndexer(NULL, NULL, NULL, directCmp);
+    for (int j = 0; j < 3 * UNIT_DIRECT_KEYS; j++)
+        insertIntoIndex(i, IMBED_INT(1 + j % UNIT_DIRECT_KEYS), IMBED_INT(j));
+    sortIndexer(i, c);
+    int wrong = 0;
+    for (int key = 1; key <= UNIT_DIRECT_KEYS; key++)
+        wrong += retrieveKey(i, IMBED_INT(key), c) != 3 * (key - 1);
+    CHECK(wrong == 0);
+    CHECK(retrieveKeyLowerBound(i, IMBED_INT(UNIT_DIRECT_KEYS + 1), c) == 3 * UNIT_DIRECT_KEYS);
+    freeIndexer(i, c);
+    freeCache(c);
+}
+
+/**
+ * @brief       Gets a key of the #Indexer of the unit tests searched through its learned index: far apart (at least 7),
+ *              along a curve and with a jump in the middle, so the keys are split into many segments
+ * 
+ * @param j     The order of the key
+ * 
+ * @return      The key
+ */
+static inline int getLearnedKey(int j) {
+    return 1 + 7 * j + j / 8 * j / 8 + (j >= UNIT_LEARNED_KEYS / 2 ? 100000000 : 0);
+}
+
+/**
+ * @brief       Checks the lookups of the #Indexer of the unit tests searched through its learned index
+ * 
+ * @param i     The #Indexer
+ * @param c     The #Cache
+ */
+static void checkLearnedLookups(Indexer i, Cache c) {
+    int n = UNIT_LEARNED_KEYS, wrong = 0;
+    CHECK(getElemNumber(i) == n);
+    CHECK(retrieveKey(i, IMBED_INT(0), c) == -1);
+    CHECK(retrieveKeyLowerBound(i, IMBED_INT(0), c) == 0);
+    CHECK(retrieveKey(i, IMBED_INT(INT_MAX), c) == -1);
+    CHECK(retrieveKeyLowerBound(i, IMBED_INT(getLearnedKey(n - 1) + 1), c) == n);
+    CHECK(retrieveKeyLowerBound(i, IMBED_INT(INT_MAX), c) == n);
+
+    for (int j = 0; j < n; j++) {
+        int key = getLearnedKey(j);
+        wrong += retrieveKey(i, IMBED_INT(key), c) != j;
+        wrong += retrieveKey(i, IMBED_INT(key + 1), c) != -1;
+        wrong += retrieveKeyLowerBound(i, IMBED_INT(key - 1), c) != j;
+        wrong += retrieveKeyLowerBound(i, IMBED_INT(key + 1), c) != j + 1;
+        wrong += GET_IMBEDDED_INT(retrieveEmbeddedValue(i, j, c)) != j;
+    }
+    CHECK(wrong == 0);
+}
+
+/**
+ * @brief Tests the learned index of an #Indexer: lookups of sparse keys around the ends of their segments and of their
+ *        range, once built, once loaded from its file and once rebuilt over a stale file
+ */
+static void testLearnedIndex() {
+    Cache c = getCache(UNIT_CACHE_LINES, 1, CACHE_2Q);
+    Indexer i = makeIndexer(UNIT_LEARNED_FILE, NULL, NULL, directCmp);
+    for (int j = 0, k = 0; j < UNIT_LEARNED_KEYS; j++, k = (k + 7919) % UNIT_LEARNED_KEYS)
+        insertIntoIndex(i, IMBED_INT(getLearnedKey(k)), IMBED_INT(k));
+    sortIndexer(i, c);
+    checkLearnedLookups(i, c);
+    freeIndexer(i, c);
+
+    i = parseIndexer(UNIT_LEARNED_FILE, NULL, NULL, directCmp);
+    checkLearnedLookups(i, c);
+    freeIndexer(i, c);
+
+    FILE* stale = fopen(UNIT_LEARNED_FILE ".pla", "wb");
+    CHECK(stale != NULL);
+    if (stale != NULL) {
+        fwrite(&(int){ 1 }, sizeof(int), 1, stale);
+        fclose(stale);
+    }
+    i = parseIndexer(UNIT_LEARNED_FILE, NULL, NULL, directCmp);
+    checkLearnedLookups(i, c);
+    freeIndexer(i, c);
+
+    remove(UNIT_LEARNED_FILE);
+    remove(UNIT_LEARNED_FILE ".pla");
+    remove(UNIT_LEARNED_FILE ".tree");
+    freeCache(c);
+}
+
+/**
+ * @brief           Checks the top entries of a #Counter
+ * 
+ * @param c         The #Counter
+ * @param n         The number of entries wanted
+ * @param keys      The keys expected, in order
+ * @param values    The values expected, in order
+ * @param len       The number of entries expected
+ * 
+ * @return          Whether the top entries are the ones expected
+ */
+static bool isCounterTop(Counter c, int n, int keys[], int values[], int len) {
+    int top_len;
+    COUNTERENTRY* top = getCounterTop(c, n, &top_len);
+    bool ans = top_len == len;
+    for (int j = 0; ans && j < len; j++)
+        ans = top[j].key == keys[j] && top[j].value == values[j];
+    free(top);
+    return ans;
+}
+
+/**
+ * @brief Tests the #Counter: its values, and its top entries on no keys, fewer keys than wanted and ties
+ */
+static void testCounter() {
+    Counter c = makeCounter(0);
+    CHECK(isCounterTop(c, 5, NULL, NULL, 0));
+    CHECK(getCounterSize(c) == 0 && getCounterValue(c, 7) == 0);
+
+    //Fewer keys than wanted, ties ranked by increasing key (negative ones included)
+    CHECK(increaseCounter(c, 7, 2));
+    CHECK(!increaseCounter(c, 7, 1));
+    CHECK(increaseCounter(c, -1, 3));
+    CHECK(increaseCounter(c, 4, 1));
+    CHECK(isCounterTop(c, 10, (int[]){ -1, 7, 4 }, (int[]){ 3, 3, 1 }, 3));
+    CHECK(isCounterTop(c, 1, (int[]){ -1 }, (int[]){ 3 }, 1));
+    CHECK(isCounterTop(c, 0, NULL, NULL, 0));
+    CHECK(isCounterTop(c, -1, NULL, NULL, 0));
+
+    //The greatest value of each key
+    CHECK(!storeCounterIfGreater(c, 7, 1));
+    CHECK(!storeCounterIfGreater(c, 4, 5));
+    CHECK(storeCounterIfGreater(c, 9, -2));
+    CHECK(getCounterValue(c, 7) == 3 && getCounterValue(c, 4) == 5 && getCounterValue(c, 9) == -2);
+
+    //Cleared, the counter takes new keys
+    clearCounter(c);
+    CHECK(getCounterSize(c) == 0 && getCounterValue(c, 7) == 0);
+    CHECK(isCounterTop(c, 5, NULL, NULL, 0));
+
+    //Many keys, tied in groups (the top cut inside one), added in a scattered order
+    for (int j = 0, k = 0; j < UNIT_COUNTER_KEYS; j++, k = (k + 7919) % UNIT_COUNTER_KEYS)
+        increaseCounter(c, k, k % 10);
+    CHECK(getCounterSize(c) == UNIT_COUNTER_KEYS);
+    int keys[UNIT_COUNTER_KEYS / 10], values[UNIT_COUNTER_KEYS / 10];
+    for (int j = 0; j < UNIT_COUNTER_KEYS / 10; j++) {
+        keys[j] = 10 * j + 9;
+        values[j] = 9;
+    }
+    CHECK(isCounterTop(c, 25, keys, values, 25));
+    CHECK(isCounterTop(c, UNIT_COUNTER_KEYS / 10, keys, values, UNIT_COUNTER_KEYS / 10));
+    COUNTERENTRY* top;
+    int len;
+    top = getCounterTop(c, UNIT_COUNTER_KEYS + 1, &len);
+    bool sorted = len == UNIT_COUNTER_KEYS;
+    for (int j = 1; sorted && j < len; j++)
+        sorted = top[j - 1].value > top[j].value || (top[j - 1].value == top[j].value && top[j - 1].key < top[j].key);
+    CHECK(sorted);
+    free(top);
+
+    //Merged, the values of the same keys are added
+    Counter other = makeCounter(0);
+    increaseCounter(other, 3, 100);
+    increaseCounter(other, UNIT_COUNTER_KEYS, 1);
+    mergeCounter(c, other);
+    CHECK(getCounterSize(c) == UNIT_COUNTER_KEYS + 1);
+    CHECK(getCounterValue(c, 3) == 103 && getCounterValue(c, UNIT_COUNTER_KEYS) == 1);
+    CHECK(isCounterTop(c, 2, (int[]){ 3, 9 }, (int[]){ 103, 9 }, 2));
+    CHECK(getCounterSize(other) == 2);
+
+    freeCounter(other);
+    freeCounter(c);
+}
+
+/**
+ * @brief       Gets the number of values of a group of the grouped #Indexer of the unit tests (not counting the duplicate
+ *              of its first value)
+ * 
+ * @param group The group
+ * 
+ * @return      The number of values
+ */
+static inline int getUnitGroupSize(int group) {
+    return group == 0 ? UNIT_GROUP_MAX_SIZE : group % 7 + 1;
+}
+
+/**
+ * @brief       Gets a value of a group of the grouped #Indexer of the unit tests. The values of a group are distinct
+ *              (4294967311 is odd), far apart and in no order, so their deltas are large and negative
+ * 
+ * @param group The group
+ * @param j     The order of the value
+ * 
+ * @return      The value (below 2^47, as embedded values are kept in 6 bytes)
+ */
+static inline pos_t getUnitGroupValue(int group, int j) {
+    return ((pos_t)group * 1000003 + (pos_t)j * 4294967311ULL) % (1ULL << 47);
+}
+
+/**
+ * @brief       Compares two ::pos_t (for qsort)
+ * 
+ * @param a     The first position
+ * @param b     The second position
+ * 
+ * @return      Less than, equal to or greater than 0 if a is less than, equal to or greater than b
+ */
+static int comparePositions(const void* a, const void* b) {
+    pos_t x = *(pos_t*)a, y = *(pos_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief                       Checks the groups of the grouped #Indexer of the unit tests
+ * 
+ * @param i                     The #Indexer
+ * @param removeDuplicateVals   Whether duplicated values were removed
+ * @param c                     The #Cache
+ * 
+ * @return                      The number of groups read wrong
+ */
+static int checkUnitGroups(Indexer i, bool removeDuplicateVals, Cache c) {
+    int wrong = 0;
+    pos_t* expected = malloc((UNIT_GROUP_MAX_SIZE + 1) * sizeof(pos_t));
+
+    for (int g = 0; g < UNIT_GROUPS; g++) {
+        int n = getUnitGroupSize(g), size;
+        for (int j = 0; j < n; j++)
+            expected[j] = getUnitGroupValue(g, j);
+        if (!removeDuplicateVals)
+            expected[n++] = getUnitGroupValue(g, 0);
+        qsort(expected, n, sizeof(pos_t), comparePositions);
+
+        pos_t group;
+        if (!findEmbeddedValue(i, IMBED_INT(g), c, &group) || getGroupSize(i, group, c) != n) {
+            wrong++;
+            continue;
+        }
+        pos_t* elems = getGroupElems(i, group, &size, c);
+        qsort(elems, size, sizeof(pos_t), comparePositions);
+        wrong += size != n || memcmp(elems, expected, n * sizeof(pos_t)) != 0;
+        free(elems);
+    }
+
+    free(expected);
+    return wrong;
+}
+
+/**
+ * @brief Tests the groups of an #Indexer (delta and varint encoded): their values read back, with and without their
+ *        duplicates, grouped after sorting and while sorting
+ */
+static void testGroups() {
+    Cache c = getCache(UNIT_CACHE_LINES, 1, CACHE_2Q);
+    Indexer indexers[3];
+    for (int k = 0; k < 3; k++) {
+        indexers[k] = makeIndexer(NULL, NULL, NULL, directCmp);
+        for (int j = 0; j < UNIT_GROUP_MAX_SIZE; j++)
+            for (int g = 0; g < UNIT_GROUPS; g++)
+                if (j < getUnitGroupSize(g))
+                    insertIntoIndex(indexers[k], IMBED_INT(g), getUnitGroupValue(g, j));
+        for (int g = 0; g < UNIT_GROUPS; g++)
+            insertIntoIndex(indexers[k], IMBED_INT(g), getUnitGroupValue(g, 0));
+    }
+
+    sortIndexer(indexers[0], c);
+    groupIndexer(indexers[0], NULL, false, c);
+    sortIndexer(indexers[1], c);
+    groupIndexer(indexers[1], NULL, true, c);
+    sortAndGroupIndexer(indexers[2], NULL, true, c);
+
+    for (int k = 0; k < 3; k++) {
+        CHECK(getElemNumber(indexers[k]) == UNIT_GROUPS);
+        CHECK(checkUnitGroups(indexers[k], k > 0, c) == 0);
+        pos_t group;
+        CHECK(!findEmbeddedValue(indexers[k], IMBED_INT(UNIT_GROUPS), c, &group));
+        freeIndexer(indexers[k], c);
+    }
+    freeCache(c);
+}
+
+/**
+ * @brief           Sorts an #Indexer of repeated embedded ints, the largest int included, with negative values, and
+ *                  checks its lines are in order and are the ones inserted
+ * 
+ * @param budget    The memory budget sorting it (see @ref setMemoryBudget)
+ * @param c         The #Cache
+ * 
+ * @return          Whether the #Indexer was sorted
+ */
+static bool sortsIntIndexer(size_t budget, Cache c) {
+    size_t previous = getMemoryBudget();
+    setMemoryBudget(budget);
+
+    Indexer i = makeIndexer(NULL, NULL, NULL, directCmp);
+    for (int j = 0, k = 0; j < UNIT_SORT_LINES; j++, k = (k + 7919) % UNIT_SORT_LINES)
+        insertIntoIndex(i, IMBED_INT(k == 0 ? INT_MAX : k % UNIT_SORT_KEYS), IMBED_INT(k - UNIT_SORT_LINES / 2));
+    sortIndexer(i, c);
+    setMemoryBudget(previous);
+
+    bool* seen = calloc(UNIT_SORT_LINES, sizeof(bool));
+    bool sorted = getElemNumber(i) == UNIT_SORT_LINES;
+    for (int j = 0; sorted && j < UNIT_SORT_LINES; j++) {
+        int key = GET_IMBEDDED_INT(retrieveEmbeddedKey(i, j, c));
+        int k = GET_IMBEDDED_INT(retrieveEmbeddedValue(i, j, c)) + UNIT_SORT_LINES / 2;
+        sorted = k >= 0 && k < UNIT_SORT_LINES && !seen[k] && key == (k == 0 ? INT_MAX : k % UNIT_SORT_KEYS)
+              && (j == 0 || GET_IMBEDDED_INT(retrieveEmbeddedKey(i, j - 1, c)) <= key);
+        if (sorted)
+            seen[k] = true;
+    }
+    sorted = sorted && retrieveKey(i, IMBED_INT(INT_MAX), c) == UNIT_SORT_LINES - 1
+                    && retrieveKeyLowerBound(i, IMBED_INT(1), c) == UNIT_SORT_LINES / UNIT_SORT_KEYS;
+
+    free(seen);
+    freeIndexer(i, c);
+    return sorted;
+}
+
+/**
+ * @brief Tests the sorting of the packed lines of an #Indexer: radix sorted runs, in memory and spilled to files on a
+ *        tiny memory budget, merged through the loser tree
+ */
+static void testSort() {
+    Cache c = getCache(UNIT_CACHE_LINES, 1, CACHE_2Q);
+    CHECK(sortsIntIndexer(getMemoryBudget(), c));
+    CHECK(sortsIntIndexer(1, c));
+
+    //Sorting a single line, or none, leaves them be
+    Indexer i = makeIndexer(NULL, NULL, NULL, directCmp);
+    sortIndexer(i, c);
+    CHECK(getElemNumber(i) == 0);
+    insertIntoIndex(i, IMBED_INT(3), IMBED_INT(-3));
+    sortIndexer(i, c);
+    CHECK(retrieveKey(i, IMBED_INT(3), c) == 0 && GET_IMBEDDED_INT(retrieveEmbeddedValue(i, 0, c)) == -3);
+    freeIndexer(i, c);
+    freeCache(c);
+}
+
+/**
+ * @brief       Checks the top entries and the partitions of a #SpillCounter hold what a #Counter aggregating the same
+ *              values holds
+ * 
+ * @param s     The #SpillCounter
+ * @param c     The #Counter
+ * 
+ * @return      Whether they hold the same
+ */
+static bool isSpillCounterLike(SpillCounter s, Counter c) {
+    int len, expected_len;
+    COUNTERENTRY* top = getSpillCounterTop(s, UNIT_SPILL_TOP, &len);
+    COUNTERENTRY* expected = getCounterTop(c, UNIT_SPILL_TOP, &expected_len);
+    bool ans = len == expected_len && memcmp(top, expected, len * sizeof(COUNTERENTRY)) == 0;
+    free(top);
+    free(expected);
+
+    //The partitions hold disjoint keys
+    Counter seen = makeCounter(0);
+    for (int p = 0; ans && p < getSpillPartitions(s); p++) {
+        COUNTERENTRY* entries = readSpillPartition(s, p, &len);
+        for (int j = 0; ans && j < len; j++)
+            ans = increaseCounter(seen, entries[j].key, 1) && getCounterValue(c, entries[j].key) == entries[j].value;
+    }
+    ans = ans && getCounterSize(seen) == getCounterSize(c);
+    freeCounter(seen);
+    return ans;
+}
+
+/**
+ * @brief           Adds repeated keys with tied and negative values to a #SpillCounter and to a #Counter, and checks
+ *                  the #SpillCounter aggregates them the same
+ * 
+ * @param max       Whether the greatest value of each key is kept, instead of their sum
+ * @param keys      The number of keys
+ * @param budget    The memory budget the #SpillCounter is made on (see @ref setMemoryBudget)
+ * @param spills    Whether the #SpillCounter is expected to spill
+ * 
+ * @return          Whether the #SpillCounter aggregated the keys as the #Counter
+ */
+static bool spillCounterAggregates(bool max, int keys, size_t budget, bool spills) {
+    size_t previous = getMemoryBudget();
+    setMemoryBudget(budget);
+    SpillCounter s = makeSpillCounter(max);
+    setMemoryBudget(previous);
+
+    long spilled = getThreadMetric(METRIC_ROWS_SPILLED);
+    Counter c = makeCounter(0);
+    for (int r = 0; r < 3; r++)
+        for (int j = 0, k = 0; j < keys; j++, k = (k + 7919) % keys) {
+            int key = 7 * k - keys, value = (31 * k + 17 * r) % 1000 - 100;
+            addToSpillCounter(s, key, value);
+            if (max)
+                storeCounterIfGreater(c, key, value);
+            else
+                increaseCounter(c, key, value);
+        }
+
+    bool ans = (getSpillPartitions(s) > 1) == spills;
+#ifdef HOT_PATH_METRICS
+    ans = ans && (getThreadMetric(METRIC_ROWS_SPILLED) > spilled) == spills;
+#else
+    (void)spilled;
+#endif
+    ans = ans && isSpillCounterLike(s, c);
+    freeSpillCounter(s);
+
+    //The same keys, merged from the counter
+    setMemoryBudget(budget);
+    s = makeSpillCounter(max);
+    setMemoryBudget(previous);
+    mergeIntoSpillCounter(s, c);
+    ans = ans && (getSpillPartitions(s) > 1) == spills && isSpillCounterLike(s, c);
+    freeSpillCounter(s);
+
+    freeCounter(c);
+    return ans;
+}
+
+/**
+ * @brief Tests the #SpillCounter: sums and greatest values, with and without spilling on a tiny memory budget, and its
+ *        top entries on ties and on no keys
+ */
+static void testSpillCounter() {
+    CHECK(spillCounterAggregates(false, UNIT_SPILL_KEYS, 1, true));
+    CHECK(spillCounterAggregates(true, UNIT_SPILL_KEYS, 1, true));
+    CHECK(spillCounterAggregates(false, UNIT_SPILL_KEYS / 100, getMemoryBudget(), false));
+    CHECK(spillCounterAggregates(true, UNIT_SPILL_KEYS / 100, getMemoryBudget(), false));
+
+    SpillCounter s = makeSpillCounter(false);
+    int len;
+    COUNTERENTRY* top = getSpillCounterTop(s, UNIT_SPILL_TOP, &len);
+    CHECK(len == 0 && getSpillPartitions(s) == 1);
+    free(top);
+    freeSpillCounter(s);
+}
+
+/**
+ * @brief       Checks two #Counter hold the same keys and values
+ * 
+ * @param a     The first #Counter
+ * @param b     The second #Counter
+ * 
+ * @return      Whether they hold the same
+ */
+static bool isSameCounter(Counter a, Counter b) {
+    int len;
+    COUNTERENTRY* entries = getCounterEntries(a, &len);
+    bool ans = len == getCounterSize(b);
+    for (int j = 0; ans && j < len; j++)
+        ans = getCounterValue(b, entries[j].key) == entries[j].value;
+    return ans;
+}
+
+/**
+ * @brief Tests the plans of the queries: counts and maxima (negative ones included) grouped by one and two key columns,
+ *        over ranges split into partitions, filtered and empty, run in a single scan
+ */
+static void testPlans() {
+    int* columns = malloc(4 * UNIT_PLAN_ROWS * sizeof(int));
+    int *first = columns, *second = columns + UNIT_PLAN_ROWS, *flags = columns + 2 * UNIT_PLAN_ROWS,
+        *values = columns + 3 * UNIT_PLAN_ROWS;
+    Counter expected[3] = { makeCounter(0), makeCounter(0), makeCounter(0) };
+
+    for (int r = 0; r < UNIT_PLAN_ROWS; r++) {
+        first[r] = r % 97;
+        second[r] = r % 89;
+        flags[r] = r % 8;
+        values[r] = (int)((long)r * 7919 % 2001) - 1500;
+
+        if ((flags[r] & 5) == 5 && values[r] >= -1000)
+            increaseCounter(expected[0], first[r], 1);
+        if (r >= 1000 && r < UNIT_PLAN_ROWS - 1000) {
+            storeCounterIfGreater(expected[1], first[r], values[r]);
+            if (second[r] != first[r])
+                storeCounterIfGreater(expected[1], second[r], values[r]);
+        }
+    }
+
+    Plan plans[3] = { makePlan(0, UNIT_PLAN_ROWS), makePlan(1000, UNIT_PLAN_ROWS - 1000), makePlan(50, 50) };
+    addPlanFilter(plans[0], flags, PLAN_HAS_FLAGS, 5);
+    addPlanFilter(plans[0], values, PLAN_GE, -1000);
+    setPlanGroupBy(plans[0], (int*[]){ first }, 1, PLAN_COUNT, NULL);
+    setPlanGroupBy(plans[1], (int*[]){ first, second }, 2, PLAN_MAX, values);
+    setPlanGroupBy(plans[2], (int*[]){ first }, 1, PLAN_COUNT, NULL);
+
+    Cache c = getCache(UNIT_CACHE_LINES, 1, CACHE_2Q);
+    Indexer i = makeIntIndexer(UNIT_PLAN_ROWS, 1, 2, c);
+    runPlans(plans, 3, i, NULL);
+    for (int k = 0; k < 3; k++) {
+        Counter result = takePlanResult(plans[k]);
+        CHECK(isSameCounter(result, expected[k]));
+        freeCounter(result);
+        freeCounter(expected[k]);
+        freePlan(plans[k]);
+    }
+
+    freeIndexer(i, c);
+    freeCache(c);
+    free(columns);
+}
+
+/**
+ * @brief       Writes a line of the text file of the unit tests: words of mixed case and the number of the line
+ * 
+ * @param file  The text file
+ * @param j     The number of the line
+ */
+static void writeUnitText(FILE* file, int j) {
+    static char* words[] = { "Repo", "commit", "USER", "alpha", "Beta", "gAmMa", "delta" };
+    fprintf(file, "%s-%d %s_%s", words[j % 7], j, words[j * 3 % 7], words[j / 7 % 7]);
+}
+
+/**
+ * @brief           Checks a search of the trigram index of the text file of the unit tests against a scan of the file
+ * 
+ * @param t         The #TrigramIndex
+ * @param substring The substring to search for
+ * @param max_lines The maximum number of lines found (-1 for every line)
+ * 
+ * @return          Whether the lines found are the ones holding the substring, in order
+ */
+static bool searchesLikeScan(TrigramIndex t, char* substring, int max_lines) {
+    FILE* output = tmpfile();
+    FILE* expected = tmpfile();
+    for (int j = 0, left = max_lines; j < UNIT_TEXT_LINES && left != 0; j++) {
+        char line[128];
+        FILE* text = fmemopen(line, sizeof(line), "w");
+        writeUnitText(text, j);
+        fclose(text);
+        if (strcasestr(line, substring) != NULL) {
+            fprintf(expected, "%s\n", line);
+            left -= left > 0;
+        }
+    }
+
+    bool ans = searchTrigramIndex(t, substring, max_lines, output);
+    ans = ans && ftell(output) == ftell(expected);
+    for (long j = 0, n = ftell(output); ans && j < n; j++) {
+        fseek(output, j, SEEK_SET);
+        fseek(expected, j, SEEK_SET);
+        ans = fgetc(output) == fgetc(expected);
+    }
+    fclose(output);
+    fclose(expected);
+    return ans;
+}
+
+/**
+ * @brief Tests the trigram index of a text file: searches matching a scan of the file, ignoring case, on the first and
+ *        the last line and limited to a number of lines, and the index of a changed file being stale
+ */
+static void testTrigrams() {
+    FILE* text = fopen(UNIT_TEXT_FILE, "w");
+    if (!CHECK(text != NULL))
+        return;
+    for (int j = 0; j < UNIT_TEXT_LINES; j++) {
+        writeUnitText(text, j);
+        if (j < UNIT_TEXT_LINES - 1) //The last line is not ended
+            fputc('\n', text);
+    }
+    fclose(text);
+
+    CHECK(buildTrigramIndex(UNIT_TEXT_FILE, UNIT_TRIGRAM_FILE));
+    TrigramIndex t = openTrigramIndex(UNIT_TEXT_FILE, UNIT_TRIGRAM_FILE);
+    if (CHECK(t != NULL)) {
+        CHECK(searchesLikeScan(t, "repo-1", -1));
+        CHECK(searchesLikeScan(t, "BETA_", -1));
+        CHECK(searchesLikeScan(t, "mma-29", -1));
+        CHECK(searchesLikeScan(t, "Repo-0 ", -1));
+        CHECK(searchesLikeScan(t, "-2999 ", -1));
+        CHECK(searchesLikeScan(t, "user_delta", 5));
+        CHECK(searchesLikeScan(t, "delta_zeta", -1));
+
+        FILE* output = tmpfile();
+        CHECK(!searchTrigramIndex(t, "ab", -1, output));
+        CHECK(searchTrigramIndex(t, "commit", 0, output) && ftell(output) == 0);
+        fclose(output);
+        closeTrigramIndex(t);
+    }
+
+    //Appended to, the file outdates its index
+    text = fopen(UNIT_TEXT_FILE, "a");
+    fputs("\nRepo-3000", text);
+    fclose(text);
+    t = openTrigramIndex(UNIT_TEXT_FILE, UNIT_TRIGRAM_FILE);
+    CHECK(t == NULL);
+    closeTrigramIndex(t);
+
+    remove(UNIT_TEXT_FILE);
+    remove(UNIT_TRIGRAM_FILE);
+}
+
+/**
+ * @brief The unit tests of the data structures
+ * 
+ */
+static UNITTEST unitTests[] = {
+    { "cache", testCache },
+    { "search tree", testSearchTree },
+    { "direct table", testDirectTable },
+    { "learned index", testLearnedIndex },
+    { "counter", testCounter },
+    { "groups", testGroups },
+    { "sort", testSort },
+    { "spill counter", testSpillCounter },
+    { "plans", testPlans },
+    { "trigrams", testTrigrams }
+};
+
+/**
+ * @brief Runs the unit tests of the data structures, reporting the checks failed
+ */
+void runUnitTests() {
+    PRINT("Starting unit tests\n");
+    int successes = 0, n = sizeof(unitTests) / sizeof(UNITTEST);
+
+    for (int i = 0; i < n; i++) {
+        unitChecks = unitFailures = 0;
+        unitTests[i].run();
+        PRINT("Unit \"%s\": %s%d/%d" RESET " checks passed\n", unitTests[i].name, unitFailures == 0 ? GREEN : RED,
+              unitChecks - unitFailures, unitChecks);
+        successes += unitFailures == 0;
+    }
+
+    PRINT("---------------------------------------------------------------------\n");
+    PRINT("Total: %s%d/%d\n", successes == n ? GREEN : RED, successes, n);
+    PRINT("%s" RESET "\n", successes == n ? "APPROVED" : "FAILED");
+    PRINT("End of unit tests\n\n");
+}
+
 /**
  * @brief           Prints the full path of a file to a string
  *
@@ -369,9 +1490,40 @@ bool printFilePath(struct dirent *dir, char* path, char* filename, char* dest, i
     return false;
 }
 
+/**
+ * @brief Fetches the users.csv, commits.csv and repos.csv files appended to the catalog of a test case, if any
+ * 
+ * @param path      The relative path to the directory of the test case
+ * @param delta     The buffers to store the paths to the files in (255 bytes each)
+ * @return true     If the test case has the three files, in its "delta" directory
+ * @return false    Otherwise
+ */
+bool fetchDelta(char* path, char delta[3][255]) {
+    char delta_path[255];
+    sprintf(delta_path, "%s/delta", path);
+
+    DIR * d = opendir(delta_path);
+    if (d == NULL)
+        return false;
+
+    delta[0][0] = delta[1][0] = delta[2][0] = '\0';
+
+    struct dirent *dir;
+    while ((dir = readdir(d)) != NULL) {
+        printFilePath(dir, delta_path, "users.csv", delta[0], 255);
+        printFilePath(dir, delta_path, "commits.csv", delta[1], 255);
+        printFilePath(dir, delta_path, "repos.csv", delta[2], 255);
+    }
+
+    closedir(d);
+    return delta[0][0] != '\0' && delta[1][0] != '\0' && delta[2][0] != '\0';
+}
+
 /**
  * @brief Fetches and executes the given test case
  * 
+ *        If the test case has a "delta" directory, its files are appended to the catalog before the queries are run
+ * 
  * @param path      The relative path to the directory of the test case
  * @return true     If test case was run successfully (does not mean accepted)
  * @return false    If there was an error with the test case (files missing)
@@ -404,7 +1556,9 @@ bool fetchTest(char* path) {
         return false;
     }
 
-    runTest(path, users_in, commits_in, repos_in, queries_in);
+    char delta[3][255];
+    char* delta_in[3] = { delta[0], delta[1], delta[2] };
+    runTest(path, users_in, commits_in, repos_in, queries_in, fetchDelta(path, delta) ? delta_in : NULL);
     return true;
 }
 
@@ -412,7 +1566,8 @@ bool fetchTest(char* path) {
  * @brief Testing suite's main entry point
  * 
  * @param argc  The number of arguments (at least 2)
- * @param argv  The arguments of the testing suite: relative paths to the folders containing the test cases (or "all" to run all tests)
+ * @param argv  The arguments of the testing suite: relative paths to the folders containing the test cases, "units" to
+ *              run the unit tests of the data structures (or "all" to run all tests)
  *
  * @return 0
  */
@@ -421,6 +1576,7 @@ int main(int argc, char* argv[]) {
     if (argc == 1) {
         PRINT("No test selected. You can check the available tests inside the folder \"tests\"\n");
         PRINT("To run all available tests, call \"./test all\"\n");
+        PRINT("To run the unit tests of the data structures, call \"./test " UNIT_TESTS "\"\n");
         return 0;
     }
 
@@ -439,9 +1595,14 @@ int main(int argc, char* argv[]) {
         }
 
         closedir(d);
+        runUnitTests();
     }
     else {
         for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], UNIT_TESTS) == 0) {
+                runUnitTests();
+                continue;
+            }
             strcpy(temp + strlen(TEST_DIR) + 1, argv[i]);
             fetchTest(temp);
         }
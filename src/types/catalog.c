@@ -7,142 +7,194 @@
  */
 
 #include <glib.h>
+#include <limits.h>
 #include <pthread.h>
+#include <sys/stat.h>
 #include <types/lazy.h>
 #include <unistd.h>
 
+#include "io/columns.h"
+#include "io/cursor.h"
+#include "io/dictionary.h"
+#include "io/friendGraph.h"
+#include "io/idSet.h"
 #include "io/indexer.h"
+#include "io/lineReader.h"
+#include "io/manifest.h"
+#include "io/memoryBudget.h"
+#include "io/messages.h"
+#include "io/ranking.h"
+#include "io/resultCache.h"
 #include "io/taskManager.h"
 #include "types/catalog.h"
 #include "types/commit.h"
 #include "types/format.h"
 #include "types/repo.h"
 #include "types/user.h"
+#include "utils/counter.h"
+#include "utils/metrics.h"
+#include "utils/sink.h"
 #include "utils/utils.h"
 
 #define CAT_DIR "saida/"
 
-#define COMPRESSED_USERS            CAT_DIR "users.dat"
-#define COMPRESSED_COMMITS          CAT_DIR "commits.dat"
-#define COMPRESSED_REPOS            CAT_DIR "repos.dat"
-#define USERSBYID_IND               CAT_DIR "usersById.indx"
-#define REPOSBYID_IND               CAT_DIR "reposById.indx"
-#define COMMITSBYREPO_IND           CAT_DIR "commitsByRepo.indx"
-#define COMMITSBYREPO_IND_VALS      CAT_DIR "commitsByRepo.dat"
-#define REPOSBYLASTCOMMITDATE_IND   CAT_DIR "reposByLastCommitDate.indx"
-#define REPOSBYLANGUAGE_IND         CAT_DIR "reposByLanguage.indx"
-#define REPOSBYLANGUAGE_IND_VALS    CAT_DIR "reposByLanguage.dat"
-#define COMMITSBYDATE_IND           CAT_DIR "commitsByDate.indx"
-#define COLLABORATORS_IND           CAT_DIR "collaborators.indx"
-#define COLLABORATORS_IND_VALS      CAT_DIR "collaborators.dat"
-#define STATIC_QUERIES              CAT_DIR "staticQueries.dat"
+/**
+ * @brief   Check the checksums of the files of a #Catalog against its #Manifest when it is loaded.
+ *          Comment out to only check their sizes (faster restarts of large catalogs)
+ */
+#define CATALOG_VERIFY_CHECKSUMS
 
 /**
- * @brief 		Directly compares two positions in the same file
- *
- * @remark      Since this function is passed as an argument it must have the same type as stringCmp so some arguments are unused
- *
- * @param f 	The file correspondent to the postion a
- * @param a 	The position to compare in the file f
- * @param g 	The file correspondent to the postion b
- * @param b 	The position to compare in the file g
- * @param c 	The dinamic #Cache
- *
- * @return -1   If a < b
- * @return 0    If a == b
- * @return 1    If a > b
+ * @brief   Keep a snapshot of the hottest data of the #Cache of a #Catalog when it is freed, and load it back in the
+ *          background when the #Catalog is loaded (see @ref saveCacheSnapshot). Comment out to start every run cold
  */
-int directCmp(FILE* f, pos_t a, FILE* g, pos_t b, Cache c) {
-    return a < b ? -1 : a > b;
-}
+#define CATALOG_CACHE_SNAPSHOT
 
 /**
- * @brief Alias for @ref directCmp
- *
+ * @brief The name of the snapshot of the #Cache in the directory of a generation (hidden, so it is not copied to the next)
  */
-#define imbeddedDateCmp directCmp
+#define CACHE_SNAPSHOT_NAME ".cache.snapshot"
 
 /**
- * @brief 		Compares the strings in the given positions of the file
- *
- * 				If one of the files is NULL uses the pos_t as a string to compare
- *
- * @param f1 	The file where to search the string in
- * @param p1 	The position of the string in the file f1 (or the string itself if f1 is null)
- * @param f2 	The file where to search the string in
- * @param p2 	The position of the string in the file f1 (or the string itself if f2 is null)
- * @param c  	The #Cache
- *
- * @return -1   If the string in p1 < the string in p2
- * @return 0    If the string in p1 == the string in p2
- * @return 1    If the string in p1 > the string in p2
+ * @brief The maximum number of files of a #Catalog read through its #Cache (see @ref getCatalogCacheFiles)
  */
-int stringCmp(FILE* f1, pos_t p1, FILE* f2, pos_t p2, Cache c) {
-    int l1, l2;
-    char buff1[sizeof(int)], buff2[sizeof(int)];
-    if (f1 && f2) {
+#define CATALOG_CACHE_FILES (3 + 7 * INDEXER_MAX_FILES)
 
-        char aux[30];
-        getStr(c, f2, p2, aux, 30);
+/**
+ * @brief The time spent in each #BuildPhase by the builds so far (in nanoseconds, summed over the threads running it)
+ */
+static long long buildPhaseTimes[BUILD_PHASE_NUM];
+
+/**
+ * @brief The files of a #Catalog, in the directory of its generation (see @ref makeStagingDir)
+ */
+typedef enum catalogFile {
+    COMPRESSED_USERS, COMPRESSED_COMMITS, COMPRESSED_REPOS, USERSBYID_IND, REPOSBYID_IND, COMMITSBYREPO_IND,
+    COMMITSBYREPO_IND_VALS, REPOSBYLASTCOMMITDATE_IND, REPOSBYLANGUAGE_IND, REPOSBYLANGUAGE_IND_VALS, COMMITSBYDATE_IND,
+    COLLABORATORS_IND, COLLABORATORS_IND_VALS, STATIC_QUERIES, FRIENDS_RANKING, MESSAGE_RANKING, COMMIT_COLUMNS,
+    USER_MONTH_ROLLUP, USER_DAY_ROLLUP, LANGUAGES, COMMIT_MESSAGES, FRIEND_GRAPH, USER_IDS, REPO_IDS, REPO_COMMITS,
+    REPO_ZONES, LANGUAGE_RANKING,
+    CATALOG_FILE_NUM    ///< The number of files
+} CatalogFile;
 
-        getStr(c, f1, p1, buff1, sizeof(int));
-        l1 = readIntFromBinaryString(buff1);
+/**
+ * @brief The names of the files of a #Catalog, indexed by #CatalogFile
+ */
+static char* catalogFileNames[] = {
+    "users.dat", "commits.dat", "repos.dat", "usersById.indx", "reposById.indx", "commitsByRepo.indx",
+    "commitsByRepo.dat", "reposByLastCommitDate.indx", "reposByLanguage.indx", "reposByLanguage.dat", "commitsByDate.indx",
+    "collaborators.indx", "collaborators.dat", "staticQueries.dat", "friendsRanking.dat",
+    "messageRanking.dat", "commitColumns.dat", "userMonthRollup.dat", "userDayRollup.dat",
+    "languages.dict", "commitMessages.dat", "friends.graph", "users.ids", "repos.ids", "repoCommits.dat", "repoZones.dat",
+    "languageRanking.dat"
+};
 
-        getStr(c, f2, p2, buff2, sizeof(int));
-        l2 = readIntFromBinaryString(buff2);
+/**
+ * @brief The columns of the fields of the commits read by scans, indexed like commitsByDate (see @ref saveCommitColumns)
+ */
+typedef enum commitColumn {
+    COMMIT_DATE,            ///< The compacted date of the commit
+    COMMIT_REPO_ID,         ///< The id of the repo
+    COMMIT_AUTHOR_ID,       ///< The id of the author
+    COMMIT_COMMITTER_ID,    ///< The id of the committer
+    COMMIT_FRIENDS,         ///< The friendship flags (@ref AUTHOR_FRIEND_FLAG and @ref COMMITTER_FRIEND_FLAG)
+    COMMIT_MESSAGE_LEN,     ///< The length of the message
+    COMMIT_LANGUAGE_ID,     ///< The id of the language of the repo (-1 if the repo is not stored)
+    COMMIT_COLUMN_NUM       ///< The number of columns
+} CommitColumn;
 
-        if (l1 != l2)   return l2 - l1;
+/**
+ * @brief   The columns of the zone map of the commits of each repo (see @ref saveRepoZones), a row per repo with commits
+ *          in increasing order of their ids
+ */
+typedef enum repoZoneColumn {
+    REPO_ZONE_ID,           ///< The id of the repo
+    REPO_ZONE_FIRST,        ///< The position in repoCommits of its first commit
+    REPO_ZONE_SIZE,         ///< The number of its commits
+    REPO_ZONE_MIN_DATE,     ///< The compacted date of its first commit
+    REPO_ZONE_MAX_DATE,     ///< The compacted date of its last commit
+    REPO_ZONE_COLUMN_NUM    ///< The number of columns
+} RepoZoneColumn;
 
-        p1 += sizeof(int);
-        p2 += sizeof(int);
-        char c1[20], c2[20];
+/**
+ * @brief The flag of @ref COMMIT_FRIENDS set if the author of the commit is a friend of the owner of the repo
+ */
+#define AUTHOR_FRIEND_FLAG 1
 
-        for (int i = 0; i * 20 < l1; i++) {
-            getStr(c, f1, p1, c1, 20);
-            getStr(c, f2, p2, c2, 20);
+/**
+ * @brief The flag of @ref COMMIT_FRIENDS set if the committer of the commit is a friend of the owner of the repo
+ */
+#define COMMITTER_FRIEND_FLAG 2
 
-            int cmp = strncmp(c1, c2, MIN(20, l1 - i * 20));
-            if (cmp != 0)   return cmp;
+/**
+ * @brief   Count the commits of the users in a range of dates (query 5) from the rollups of whole months and days,
+ *          scanning only the commits of the partial days at the edges. Comment out to scan every commit of the range
+ */
+#define USE_USER_ROLLUPS
 
-            p1 += 20;
-            p2 += 20;
-        }
-        return 0;
-    } else {
-        char *c1, *c2;
+/**
+ * @brief   Solve query 6 by joining the repos of the language (reposByLanguage) with their commits (commitsByRepo)
+ *          when they are fewer than one in this many repos, as reading their commits then costs less than scanning
+ *          the language of every commit. Comment out to always scan the columns of the commits
+ */
+#define PLAN_JOIN_SHARE 32
 
-        if (f1 == NULL) {
-            c1 = (char*)p1;
-            l1 = strlen(c1);
-        } else {
-            getStr(c, f1, p1, buff1, sizeof(int));
-            l1 = readIntFromBinaryString(buff1);
+/**
+ * @brief   Solve query 6 by reading the prefix of the ranking of the users of the language, written when the #Catalog is
+ *          built (see @ref saveLanguageRanking). Comment out to count the commits of the language on every query
+ */
+#define USE_LANGUAGE_RANKING
 
-            c1 = malloc(l1);
-            getStr(c, f1, p1 + sizeof(int), c1, l1);
-        }
+/**
+ * @brief The rollups of the number of commits of each user, from the coarsest period to the finest (see @ref saveUserRollup)
+ */
+typedef enum rollupLevel {
+    ROLLUP_MONTH,           ///< A group per month
+    ROLLUP_DAY,             ///< A group per day
+    ROLLUP_LEVEL_NUM        ///< The number of levels
+} RollupLevel;
 
-        if (f2 == NULL) {
-            c2 = (char*)p2;
-            l2 = strlen(c2);
-        } else {
-            getStr(c, f2, p2, buff2, sizeof(int));
-            l2 = readIntFromBinaryString(buff2);
+/**
+ * @brief The file of each #RollupLevel
+ */
+static const CatalogFile rollupFiles[ROLLUP_LEVEL_NUM] = { USER_MONTH_ROLLUP, USER_DAY_ROLLUP };
 
-            c2 = malloc(l2);
-            getStr(c, f2, p2 + sizeof(int), c2, l2);
-        }
+/**
+ * @brief The shift turning a compacted date (see @ref getCompactedDate) into the key of its period, for each #RollupLevel
+ */
+static const int rollupShifts[ROLLUP_LEVEL_NUM] = { 22, 17 };
 
-        int cmp = 0;
-        if (l1 != l2)   cmp = l2 - l1;
-        else            cmp = strncmp(c1, c2, l1);
+/**
+ * @brief   The number of keys of usersById stepped over, from the last id resolved, before searching for the next id
+ *          resolved by @ref getUserLogins
+ */
+#define LOGIN_WALK_STEPS 16
 
-		if (f1) free(c1);
-        if (f2) free(c2);
-        return cmp;
-    }
-}
+/**
+ * @brief The least number of repos of each partition of @ref solveStaticQueries (fewer repos use fewer threads)
+ */
+#define STATIC_QUERIES_PARTITION_MIN_REPOS 1024
+
+/**
+ * @brief The maximum number of steps of the build of a #Catalog (see @ref newCatalog) run at once
+ */
+#define BUILD_MAX_THREADS 4
+
+/**
+ * @brief The percentage of the memory of the #Cache given to the lines of @ref CACHE_LINE_SIZE (the rest serves the records)
+ */
+#define CACHE_INDEX_SHARE 25
 
+/**
+ * @brief The least number of #Line of each pool of the #Cache
+ */
+#define CACHE_MIN_LINES (CACHE_SHARD_NUM * 16)
+
+/**
+ * @brief Alias for @ref directCmp
+ *
+ */
+#define imbeddedDateCmp directCmp
 
 /**
  * @brief Type used to store the catalog corresponding to the dataset of the application
@@ -160,9 +212,23 @@ struct catalog {
 	Indexer reposById;				///< The index of the repos by their id
 	Indexer commitsByRepo;			///< The index of the commits organized by their repo_id
 	Indexer reposByLastCommitDate;	///< The index of the repos ordered by their last commit date
-	Indexer reposByLanguage;		///< The index of the repos ordered by their language
+	Indexer reposByLanguage;		///< The index of the repos by the id of their language in languages
     Indexer commitsByDate;			///< The index of the commits ordered by their date
     Indexer collaborators;			///< The index of collaborators by repo
+    ColumnFile commitColumns;		///< The columns of the commits, by #CommitColumn (NULL until they are saved)
+    ColumnFile repoCommits;			///< The rows of commitColumns of the commits of each repo, by date (NULL until saved)
+    ColumnFile repoZones;			///< The zone map of repoCommits, by #RepoZoneColumn (NULL until they are saved)
+    MessageFile messages;			///< The messages of the commits, in the order of commits (NULL until they are stored)
+    FriendGraph friends;			///< The friendships of the users (NULL until they are indexed, see @ref indexFriends)
+    ResultCache results;			///< The results of the queries solved on it (NULL until it is built)
+    IdSet userIds;					///< The ids of the users (NULL if unknown)
+    IdSet repoIds;					///< The ids of the repos (NULL if unknown)
+    Dictionary languages;			///< The languages of the repos (lower case), by the ids stored in the repos
+    size_t cacheMemory;				///< The memory acquired from the memory budget by the #Cache
+    char* dir;						///< The directory of its generation (see @ref makeStagingDir)
+    char* paths[CATALOG_FILE_NUM];	///< The paths to its files, indexed by #CatalogFile
+    Manifest manifest;				///< Its #Manifest
+    bool staged;					///< Whether or not it is being built in a staging directory (not yet published)
     //statistical
     int userCount; 					///< Number of users of type User
     int botCount; 					///< Number of bots
@@ -184,117 +250,244 @@ Format getStaticQueriesFormat() {
     return makeFormat(&c, params, types, 6, sizeof(struct catalog), NULL, 0, '\0');
 }
 
+/**
+ * @brief 			Adds the time taken by some work of a build to its #BuildPhase
+ *
+ * @param phase 	The #BuildPhase
+ * @param start 	When the work started (see @ref getWallClock)
+ */
+static void addBuildPhaseTime(BuildPhase phase, double start)
+{
+    __atomic_add_fetch(buildPhaseTimes + phase, (long long)((getWallClock() - start) * 1e9), __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 			Gets the time spent in a #BuildPhase by the builds (and appends) of catalogs since the times were
+ *                  reset (see @ref resetBuildPhaseTimes). The phases run concurrently, so the times are summed over
+ *                  the threads running them and may add up to more than the build took
+ *
+ * @param phase 	The #BuildPhase
+ *
+ * @return 			The time (in seconds)
+ */
+double getBuildPhaseTime(BuildPhase phase)
+{
+    return __atomic_load_n(buildPhaseTimes + phase, __ATOMIC_RELAXED) / 1e9;
+}
+
+/**
+ * @brief 			Resets the times of the phases of the builds (see @ref getBuildPhaseTime)
+ */
+void resetBuildPhaseTimes()
+{
+    for (int i = 0; i < BUILD_PHASE_NUM; i++)
+        __atomic_store_n(buildPhaseTimes + i, 0, __ATOMIC_RELAXED);
+}
+
 /**
  * @brief 			A wrapper to call the fuction sortIndexer using a thread
  *
  * @param args 		The arguments to pass to the sortIndexer function
  */
 void sortIndexerWrapper(void* args[]){
+    double start = getWallClock();
 	sortIndexer((Indexer)args[0], (Cache)args[1]);
+    addBuildPhaseTime(BUILD_SORT, start);
 }
 /**
- * @brief 			A wrapper to call the fuction groupIndexer using a thread
+ * @brief 			A wrapper to call the fuction sortAndGroupIndexer using a thread
  *
- * @param args 		The arguments to pass to the groupIndexer function
+ * @param args 		The arguments to pass to the sortAndGroupIndexer function
  */
-void groupIndexerWrapper(void* args[]){
-	groupIndexer((Indexer)args[0],(char*)args[1],*(bool*)args[2], (Cache)args[3]);
+void sortAndGroupIndexerWrapper(void* args[]){
+    double start = getWallClock();
+	sortAndGroupIndexer((Indexer)args[0],(char*)args[1],*(bool*)args[2], (Cache)args[3]);
+    addBuildPhaseTime(BUILD_GROUP, start);
 }
 
 /**
- * @brief 			Checks whether or not two users are friends using their #Lazy pointers and their id
+ * @brief 			Indexes the friendships of the users of a #Catalog (read in the order of usersById) into its
+ * 					#FriendGraph, and writes it to its file
  *
- * @param c   		The #Catalog
- * @param a     	The id of the first user
- * @param b     	The id of the second user
- * @param one		The lazy of the first user
- * @param two 		The lazy of the second user
+ * @param catalog 	The #Catalog
+ *
+ * @return 			Whether or not the #FriendGraph was written
+ */
+static bool indexFriends(Catalog catalog)
+{
+    int numberOfUsers = getElemNumber(catalog->usersById);
+    pos_t* keys = malloc(numberOfUsers * sizeof(pos_t) + 1);
+    int* ids = malloc(numberOfUsers * sizeof(int) + 1);
+    retrieveLines(catalog->usersById, 0, numberOfUsers, keys, NULL, catalog->cache);
+    for (int i = 0; i < numberOfUsers; i++)
+        ids[i] = (int)keys[i];
+    free(keys);
+
+    freeFriendGraph(catalog->friends);
+    catalog->friends = makeFriendGraph(ids, numberOfUsers);
+    free(ids);
+
+    int members[] = { CUFRIENDS, CUFRIENDS_LIST };
+    Cursor u = openCursor(catalog->usersById, 0, numberOfUsers, catalog->cUserFormat, members, 2);
+    for (int rows; (rows = nextCursorBatch(u, catalog->cache)) > 0; ) {
+        int first = getCursorPosition(u), *lengths = getCursorColumn(u, CUFRIENDS);
+        int** lists = getCursorColumn(u, CUFRIENDS_LIST);
+        for (int j = 0; j < rows; j++)
+            addFriends(catalog->friends, first + j, lists[j], lengths[j]);
+    }
+    closeCursor(u);
+
+    DEBUG_PRINT("indexFriends done\n");
+    return saveFriendGraph(catalog->friends, catalog->paths[FRIEND_GRAPH]);
+}
+
+/**
+ * @brief 			A wrapper to call the fuction indexFriends using a thread
  *
- * @return 			Whether or not the users are friends
+ * @param args 		The #Catalog
  */
-bool areUsersFriendsByIdAndLazys(Catalog c, int a, int b, Lazy one,Lazy two) {
-	int one_len = *(int*)getLazyMember(one,CUFRIENDS,c->cache);
-	int two_len = *(int*)getLazyMember(two,CUFRIENDS,c->cache);
-	int* one_list = *(int**)getLazyMember(one,CUFRIENDS_LIST,c->cache);
-	int* two_list = *(int**)getLazyMember(two,CUFRIENDS_LIST,c->cache);
-	bool r=containedInSortedArray(two_list, two_len, a) && containedInSortedArray(one_list, one_len, b);
-	return r;
+void indexFriendsWrapper(void* args[])
+{
+    double start = getWallClock();
+    indexFriends((Catalog)args[0]);
+    addBuildPhaseTime(BUILD_FRIENDS, start);
 }
 
 
 
 /**
- * @brief 			Solves queries number 1,2,3,4 and saves the values in the #Catalog
- * 					It also calculates the friendship status between the collaborators of a commit and the owner of the repo
+ * @brief 			Checks the collaborators of a #Commit to a #Repo, flagging the ones who are friends of the owner of the repo
  *
  * @param catalog 	The #Catalog
+ * @param c 		The #Lazy of the commit (its changes are not written to the file)
+ * @param ownerId 	The id of the owner of the repo
+ * @param u 		Auxiliar #Lazy to load the collaborators
+ *
+ * @return 			Whether or not one of the collaborators is a bot
  */
-void solveStaticQueries(Catalog catalog){
-    long long ansQ2=0;
-	int numberOfUsers=getElemNumber(catalog->usersById);
-    int numberOfCommits=getElemNumber(catalog->commitsByDate);
-    int numberOfRepos=getElemNumber(catalog->commitsByRepo);
+static bool checkCommitCollaborators(Catalog catalog, Lazy c, int ownerId, Lazy u)
+{
+    int author_id=*(int*)getLazyMember(c,CCAUTHOR_ID,catalog->cache);
+    int commiter_id=*(int*)getLazyMember(c,CCCOMMITTER_ID,catalog->cache);
+    getUserById(catalog,author_id,u);
+
+    bool bot = *(Type*)getLazyMember(u,CUTYPE,catalog->cache)==BOT;
+    if (areFriends(catalog->friends, author_id, ownerId))
+        *(bool*)setLazyMember(c,CCAUTHOR_FRIEND) = true;
+
+    if (author_id!=commiter_id){
+        getUserById(catalog,commiter_id, u);
+        bot = bot || *(Type*)getLazyMember(u,CUTYPE,catalog->cache)==BOT;
+        if (areFriends(catalog->friends, commiter_id, ownerId))
+            *(bool*)setLazyMember(c,CCCOMMITTER_FRIEND) = true;
+    }
 
-    catalog->Q3 = 0;
-    User user1 = initUser(), user2 = initUser();
+    return bot;
+}
+
+/**
+ * @brief The state of a parallel pass of @ref solveStaticQueries over commitsByRepo
+ */
+typedef struct staticQueriesScan {
+    Catalog catalog;            ///< The #Catalog
+    long long* collaborators;   ///< The number of collaborators of the repos of each partition
+    int* botRepos;              ///< The number of repos with a bot collaborator of each partition
+} STATICQUERIESSCAN;
+
+/**
+ * @brief 			Solves queries 2 and 3 for the repos of a partition of commitsByRepo, flagging the collaborators of
+ * 					their commits who are friends of the owner of the repo (used by @ref solveStaticQueries)
+ *
+ * 					The partitions hold disjoint repos, so they write the flags of disjoint commits
+ *
+ * @param i 		commitsByRepo
+ * @param from 		The first position of the partition
+ * @param to 		The position after the last position of the partition
+ * @param part 		The number of the partition
+ * @param state 	The #STATICQUERIESSCAN
+ */
+static void solveStaticQueriesOfRepos(Indexer i, int from, int to, int part, void* state)
+{
+    STATICQUERIESSCAN* scan = (STATICQUERIESSCAN*)state;
+    Catalog catalog = scan->catalog;
+    long long collaborators = 0;
+    int botRepos = 0;
+
+    User user = initUser();
     Commit commit = initCommit();
     Repo repo = initRepo();
-    Lazy owner = makeLazy(NULL, 0, catalog->cUserFormat, user2),u = makeLazy(NULL, 0, catalog->cUserFormat, user1),
-         c = makeLazy(NULL, 0, catalog->cCommitFormat, commit), r = makeLazy(NULL, 0, catalog->cRepoFormat, repo);
+    Lazy u = makeLazy(NULL, 0, catalog->cUserFormat, user), c = makeLazy(NULL, 0, catalog->cCommitFormat, commit),
+         r = makeLazy(NULL, 0, catalog->cRepoFormat, repo);
 
-    for (int i=0;i<numberOfRepos;i++){
+    for (int k = from; k < to; k++) {
         //number of collaborators to that commit
-		int numberOfColabs=getGroupSize(catalog->collaborators,retrieveGroup(catalog->collaborators,i,catalog->cache),catalog->cache);
-		ansQ2 += numberOfColabs;
-
-		if (findValueAsLazy(catalog->reposById, retrieveEmbeddedKey(catalog->commitsByRepo,i,catalog->cache),catalog->cache, r)) //the repo to access
-        {
-            int ownerId=*(int*)getLazyMember(r,CROWNER_ID,catalog->cache);
-            pos_t g = retrieveGroup(catalog->commitsByRepo,i,catalog->cache);//the commits to that repo
-            getUserById(catalog,ownerId,owner);
-            int numberOfCommitsToTheRepo=getGroupSize(catalog->commitsByRepo,g,catalog->cache);
-            bool found = false;
-            for (int j=0;j<numberOfCommitsToTheRepo;j++){
-                getGroupElemAsLazy(catalog->commitsByRepo,g,j,catalog->cache,c);
-                int author_id=*(int*)getLazyMember(c,CCAUTHOR_ID,catalog->cache);
-                int commiter_id=*(int*)getLazyMember(c,CCCOMMITTER_ID,catalog->cache);
-                getUserById(catalog,author_id,u);
-
-                if (!found && *(Type*)getLazyMember(u,CUTYPE,catalog->cache)==BOT){
-                    catalog->Q3++;
-                    found = true;
-                }
-                if (areUsersFriendsByIdAndLazys(catalog,author_id,ownerId,u,owner))
-                    *(bool*)setLazyMember(c,CCAUTHOR_FRIEND) = true;
-
-                if (author_id!=commiter_id){
-                    getUserById(catalog,commiter_id, u);
-                    if (!found && *(Type*)getLazyMember(u,CUTYPE,catalog->cache)==BOT){
-                        catalog->Q3++;
-                        found = true;
-                    }
-                    if (areUsersFriendsByIdAndLazys(catalog,commiter_id,ownerId,u,owner))
-                        *(bool*)setLazyMember(c,CCCOMMITTER_FRIEND) = true;
-                }
-
-                printLazyToFile(c, catalog->cache);
-            }
+        collaborators += getGroupSize(catalog->collaborators, retrieveGroup(catalog->collaborators, k, catalog->cache),
+                                      catalog->cache);
+
+        if (!findValueAsLazy(catalog->reposById, retrieveEmbeddedKey(i, k, catalog->cache), catalog->cache, r)) //the repo to access
+            continue;
+
+        int ownerId = *(int*)getLazyMember(r, CROWNER_ID, catalog->cache);
+        int numberOfCommitsToTheRepo;
+        pos_t* commits = getGroupElems(i, retrieveGroup(i, k, catalog->cache), &numberOfCommitsToTheRepo,
+                                       catalog->cache); //the commits to that repo
+        bool found = false;
+        for (int j = 0; j < numberOfCommitsToTheRepo; j++) {
+            getGroupElemAsLazy(i, commits[j], c);
+            found = checkCommitCollaborators(catalog, c, ownerId, u) || found;
+            printLazyToFile(c, catalog->cache);
         }
-	}
+        free(commits);
 
-    //If the program were to crash, the changes made to the commits file
-    //wouldn't be flushed. Flushing them here guarantees this doesn't happen
-    //flushCacheFile(catalog->cache, catalog->commits);
+        if (found)
+            botRepos++;
+    }
 
-    freeLazy(owner);
     freeLazy(u);
     freeLazy(c);
     freeLazy(r);
-    free(user1);
-    free(user2);
+    free(user);
     free(commit);
     free(repo);
 
+    scan->collaborators[part] = collaborators;
+    scan->botRepos[part] = botRepos;
+}
+
+/**
+ * @brief 			Solves queries number 1,2,3,4 and saves the values in the #Catalog
+ * 					It also calculates the friendship status between the collaborators of a commit and the owner of the repo
+ *
+ * 					The repos are split into contiguous ranges of commitsByRepo, each solved by its own thread (see
+ * 					@ref scanIndexerRange), and the partial counts are added up
+ *
+ * @param catalog 	The #Catalog
+ */
+void solveStaticQueries(Catalog catalog){
+    long long ansQ2=0;
+	int numberOfUsers=getElemNumber(catalog->usersById);
+    int numberOfCommits=getElemNumber(catalog->commitsByDate);
+    int numberOfRepos=getElemNumber(catalog->commitsByRepo);
+
+    int parts = MAX(1, MIN(getSpareThreads(), numberOfRepos / STATIC_QUERIES_PARTITION_MIN_REPOS));
+    //Zeroed, as scanIndexerRange may run fewer partitions than asked for
+    long long collaborators[parts];
+    int botRepos[parts];
+    memset(collaborators, 0, sizeof(collaborators));
+    memset(botRepos, 0, sizeof(botRepos));
+    STATICQUERIESSCAN state = { .catalog = catalog, .collaborators = collaborators, .botRepos = botRepos };
+    scanIndexerRange(catalog->commitsByRepo, 0, numberOfRepos, parts, solveStaticQueriesOfRepos, &state);
+
+    catalog->Q3 = 0;
+    for (int p = 0; p < parts; p++) {
+        ansQ2 += collaborators[p];
+        catalog->Q3 += botRepos[p];
+    }
+
+    //If the program were to crash, the changes made to the commits file
+    //wouldn't be flushed. Flushing them here guarantees this doesn't happen
+    //flushCacheFile(catalog->cache, catalog->commits);
+
     catalog->Q2=((double)ansQ2 / numberOfRepos);
     catalog->Q4=((double)numberOfCommits/numberOfUsers);
 
@@ -302,428 +495,1919 @@ void solveStaticQueries(Catalog catalog){
 }
 
 /**
- * @brief 		Reads the users in the input file and writes them compressed to the corresponding file and sabes them to the user by id
+ * @brief The maximum number of threads parsing chunks of the same input file
+ */
+#define LOADER_MAX_THREADS 8
+
+/**
+ * @brief An entry of an #Indexer produced by a #CsvChunk, positioned relatively to the start of its output
+ */
+typedef struct indexEntry {
+    pos_t key;  ///< The key of the entry
+    pos_t pos;  ///< The position of the record in the output of the chunk
+} INDEXENTRY;
+
+/**
+ * @brief The entries of the commit indexes produced by a #CsvChunk for one commit, positioned relatively to the start of its output
+ */
+typedef struct commitEntry {
+    pos_t date;         ///< The compacted date of the commit (key of commitsByDate)
+    pos_t repo;         ///< The id of the repo of the commit (key of commitsByRepo and collaborators)
+    pos_t pos;          ///< The position of the commit in the output of the chunk
+    pos_t author;       ///< The position of the record of the author (value of collaborators)
+    pos_t committer;    ///< The position of the record of the committer, or POS_T_MAX if it is the author
+} COMMITENTRY;
+
+/**
+ * @brief A range of lines of an input file, parsed and validated by its own thread
+ */
+typedef struct csvChunk {
+    char* path;                 ///< The path of the input file
+    long start;                 ///< The position of the first line of the chunk
+    long end;                   ///< The position right after the last line of the chunk
+    bool stopped;               ///< Whether or not the chunk hit an empty line (which ends the input)
+
+    bool validate;              ///< Whether or not the lines must be validated
+    Indexer usersById;          ///< The #Indexer of the users by id (commits, or the users already stored when appending users)
+    IdSet userIds;              ///< The ids of the users (commits, or the users already stored when appending users)
+    IdSet repoIds;              ///< The ids of the repos (commits only)
+    GHashTable* repoIdTable;    ///< The ids of the repos, if repoIds is not exact (commits only)
+    Cache cache;                ///< The #Cache
+
+    FILE* out;                  ///< The file the compressed records of the chunk are written to
+    FILE* messages;             ///< The file the messages of the records of the chunk are written to (commits only)
+    GArray* entries;            ///< The #INDEXENTRY (users) or #COMMITENTRY (commits) of the records written
+    GHashTable* lastCommit;     ///< The date of the last commit of each repo in the chunk (commits only)
+    int counts[3];              ///< The number of users of each type, indexed by their type (users only)
+} CSVCHUNK, * CsvChunk;
+
+/**
+ * @brief   Calculates the number of threads used to parse an input file
+ * 
+ * @return  The number of online processors, capped at @ref LOADER_MAX_THREADS
+ */
+static int getLoaderThreads() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n < 1 ? 1 : n > LOADER_MAX_THREADS ? LOADER_MAX_THREADS : n;
+}
+
+/**
+ * @brief           Splits the lines of an input file (excluding its header) into chunks of similar size
+ * 
+ * @param path      The path of the input file
+ * @param chunks    The array to store the chunks in (at least @ref LOADER_MAX_THREADS long)
+ * @param validate  Whether or not the lines must be validated
+ * @param c         The #Cache
+ * 
+ * @return          The number of chunks
+ */
+static int splitCsv(char* path, CSVCHUNK chunks[], bool validate, Cache c) {
+    LineReader header = openLineReader(path, 0, -1);
+    char* line;
+    int n = getLoaderThreads();
+
+    readLine(header, &line);   //first line
+    long start = getLineReaderPos(header);
+    closeLineReader(header);
+
+    FILE* f = OPEN_FILE(path, "r");
+    fseek(f, 0, SEEK_END);
+    long filesize = ftell(f);
+
+    for (int j = 0; j < n; j++) {
+        chunks[j] = (CSVCHUNK){ .path = path, .start = j == 0 ? start : chunks[j - 1].end, .end = filesize,
+                                .validate = validate, .cache = c, .out = tmpfile() };
+
+        long target = start + (filesize - start) / n * (j + 1);
+        if (j < n - 1 && target > chunks[j].start) {
+            fseek(f, target - 1, SEEK_SET);
+            int ch;
+            while ((ch = fgetc(f)) != EOF && ch != '\n');
+            chunks[j].end = ftell(f);
+        } else if (j < n - 1)
+            chunks[j].end = chunks[j].start;
+    }
+
+    fclose(f);
+    return n;
+}
+
+/**
+ * @brief               Parses every #CsvChunk, each on its own thread
+ * 
+ * @param chunks        The chunks
+ * @param n             The number of chunks
+ * @param parseChunk    The function parsing a chunk
+ */
+static void parseCsvChunks(CSVCHUNK chunks[], int n, void* (*parseChunk)(void*)) {
+    pthread_t threads[LOADER_MAX_THREADS];
+
+    for (int j = 1; j < n; j++)
+        pthread_create(&threads[j], NULL, parseChunk, &chunks[j]);
+    parseChunk(&chunks[0]);
+    for (int j = 1; j < n; j++)
+        pthread_join(threads[j], NULL);
+}
+
+/**
+ * @brief       Appends the whole contents of a file to another
  *
- * @param args 	The arguments so the function can be executed
+ * @param src   The file to copy (read from its start)
+ * @param dest  The file to append the contents to
  */
-void parseUsers(void *args[])
+static void appendFile(FILE* src, FILE* dest) {
+    char buffer[65536];
+    size_t read;
+
+    fflush(src);
+    fseek(src, 0, SEEK_SET);
+    while ((read = fread(buffer, 1, sizeof(buffer), src)) > 0)
+        fwrite(buffer, 1, read, dest);
+}
+
+/**
+ * @brief       Appends the compressed records of a #CsvChunk to the given file and closes the output of the chunk
+ * 
+ * @param chunk The given #CsvChunk
+ * @param dest  The file to append the records to
+ */
+static void appendCsvChunk(CsvChunk chunk, FILE* dest) {
+    appendFile(chunk->out, dest);
+}
+
+/**
+ * @brief 			Checks whether a user (or repo) exists, through the #IdSet of the ids (confirmed by the #Indexer if it is not exact)
+ *
+ * @param ids 		The #IdSet of the ids
+ * @param byId 		The #Indexer of the users (or repos) by id
+ * @param id 		The id of the user (or repo)
+ * @param c 		The #Cache
+ *
+ * @return 			Whether or not the user (or repo) exists
+ */
+static bool idExists(IdSet ids, Indexer byId, int id, Cache c)
 {
-	FILE* users=(FILE*)args[0];///< 			The users input File
-	FILE* compressed_users=(FILE*)args[1];///<	The ouput File to save the compressed users in
-	Indexer usersById=(Indexer)args[2];///<		The #Indexer of usersById
-	bool validate=*(bool*)args[3];///<			The boolean flag to check if the users need to be validated
-    Cache cache = (Cache)args[4];///<           The #Cache
+    return mayContainId(ids, id) && (isIdSetExact(ids) || retrieveKey(byId, (pos_t)id, c) != -1);
+}
+
+/**
+ * @brief 			Creates the #IdSet of the ids stored in a GArray
+ *
+ * @param ids 		The GArray of the ids (ints)
+ *
+ * @return 			The #IdSet
+ */
+static IdSet makeIdSetFromArray(GArray* ids)
+{
+    int max = -1;
+    for (int j = 0; j < ids->len; j++)
+        if (g_array_index(ids, int, j) > max)
+            max = g_array_index(ids, int, j);
+
+    IdSet ans = makeIdSet(max, ids->len);
+    for (int j = 0; j < ids->len; j++)
+        addToIdSet(ans, g_array_index(ids, int, j));
+    return ans;
+}
 
-    int userCount = 0, organizationCount = 0, botCount = 0;
+/**
+ * @brief 		Parses the users of a #CsvChunk, writing them compressed to the output of the chunk
+ *
+ * @param p 	The #CsvChunk
+ *
+ * @return 		Always returns NULL (required by pthread_create thread_start prototype)
+ */
+static void* parseUsersChunk(void* p)
+{
+    CsvChunk chunk = (CsvChunk)p;
+    LineReader users = openLineReader(chunk->path, chunk->start, chunk->end);
 
     Format user_f = getUserFormat();
     Format comp_user_f = getCompressedUserFormat();
 
-    char* buffer = NULL;
-    int buffer_size;
-
-    getFileLine(users, &buffer, &buffer_size);   //first line
+    char* buffer;
+    int len;
     User u = initUser();
+    Arena arena = makeArena(0);
 
-    while (getFileLine(users, &buffer, &buffer_size))
+    chunk->entries = g_array_new(FALSE, FALSE, sizeof(INDEXENTRY));
+
+    while ((len = readLine(users, &buffer)) >= 0)
     {
-        if (validate ? readFormat(user_f, buffer, u)
-                     : (unsafeReadFormat(user_f, buffer, u), true))
+        if (len == 0) {
+            chunk->stopped = true;
+            break;
+        }
+
+        if (chunk->validate ? readFormat(user_f, buffer, u, arena)
+                            : (unsafeReadFormat(user_f, buffer, u, arena), true))
         {
-            calculateFriends(u);
+            if (chunk->userIds == NULL || !idExists(chunk->userIds, chunk->usersById, getUserId(u), chunk->cache)) {
+                calculateFriends(u, arena);
+                chunk->counts[getUserType(u)]++;
 
-            switch(getUserType(u))
-            {
-                case USER:
-                    userCount++;
-                    break;
-                case BOT:
-                    botCount++;
-                    break;
-                case ORGANIZATION:
-                    organizationCount++;
-                    break;
+                INDEXENTRY entry = { .key = (pos_t)getUserId(u), .pos = (pos_t)ftell(chunk->out) };
+                printFormat(comp_user_f, u, chunk->out);
+                g_array_append_val(chunk->entries, entry);
             }
-
-            pos_t pos = (pos_t)ftell(compressed_users);
-            printFormat(comp_user_f, u, compressed_users);
-            insertIntoIndex(usersById, (pos_t)getUserId(u), pos);
-            freeUserContent(u);
         }
+        resetArena(arena);
     }
 
     free(u);
-    free(buffer);
+    freeArena(arena);
     disposeFormat(user_f);
     disposeFormat(comp_user_f);
+    closeLineReader(users);
+
+    return NULL;
+}
+
+/**
+ * @brief 				Reads the users in the input file and appends them compressed to the given file, inserting them into the user by id
+ *
+ *                      The input file is split into chunks parsed in parallel, whose outputs are then concatenated in order
+ *
+ * @param users 		The path to the users input file
+ * @param compressed_users The file to append the compressed users to (at its current position)
+ * @param usersById 	The #Indexer to insert the users into (left unsorted)
+ * @param storedIds 	The #IdSet of the users already stored, which are skipped (NULL if there are none)
+ * @param storedById 	The #Indexer of the users already stored (NULL if there are none)
+ * @param validate 		The boolean flag to check if the users need to be validated
+ * @param cache 		The #Cache
+ * @param counts 		Where to add the number of users of each type to, indexed by their type
+ * @param ids 			Where to append the ids of the users to
+ */
+static void appendUsers(char* users, FILE* compressed_users, Indexer usersById, IdSet storedIds, Indexer storedById,
+                        bool validate, Cache cache, int counts[3], GArray* ids)
+{
+    CSVCHUNK chunks[LOADER_MAX_THREADS];
+    int n = splitCsv(users, chunks, validate, cache);
+    bool stopped = false;
+
+    //Flushes the index before it is shared by the threads
+    if (storedById != NULL)
+        retrieveKey(storedById, 0, cache);
+
+    for (int j = 0; j < n; j++) {
+        chunks[j].usersById = storedById;
+        chunks[j].userIds = storedIds;
+    }
+    parseCsvChunks(chunks, n, parseUsersChunk);
+
+    for (int j = 0; j < n; j++) {
+        if (!stopped) {
+            pos_t base = (pos_t)ftell(compressed_users);
+            for (int k = 0; k < chunks[j].entries->len; k++) {
+                INDEXENTRY entry = g_array_index(chunks[j].entries, INDEXENTRY, k);
+                insertIntoIndex(usersById, entry.key, base + entry.pos);
+
+                int id = (int)entry.key;
+                g_array_append_val(ids, id);
+            }
+
+            appendCsvChunk(&chunks[j], compressed_users);
+            for (int t = 0; t < 3; t++)
+                counts[t] += chunks[j].counts[t];
+            stopped = chunks[j].stopped;
+        }
+
+        g_array_free(chunks[j].entries, TRUE);
+        fclose(chunks[j].out);
+    }
 
     fflush(compressed_users);
+}
+
+/**
+ * @brief 		Reads the users in the input file and writes them compressed to the corresponding file and sabes them to the user by id
+ *
+ * @param args 	The arguments so the function can be executed
+ */
+void parseUsers(void *args[])
+{
+	char* users=(char*)args[0];///< 			The path to the users input file
+	FILE* compressed_users=(FILE*)args[1];///<	The ouput File to save the compressed users in
+	Indexer usersById=(Indexer)args[2];///<		The #Indexer of usersById
+	bool validate=*(bool*)args[3];///<			The boolean flag to check if the users need to be validated
+    Cache cache = (Cache)args[4];///<           The #Cache
+    IdSet* userIds = (IdSet*)args[8];///<       Where to store the #IdSet of the users
+    char* ids_path = (char*)args[9];///<        The path to the file where to save the #IdSet of the users
+
+    double start = getWallClock();
+    int counts[3] = { 0, 0, 0 };
+    GArray* ids = g_array_new(FALSE, FALSE, sizeof(int));
+
+    appendUsers(users, compressed_users, usersById, NULL, NULL, validate, cache, counts, ids);
     sortIndexer(usersById, cache);
 
-    *(int*)args[5] = userCount;
-    *(int*)args[6] = organizationCount;
-    *(int*)args[7] = botCount;
+    *userIds = makeIdSetFromArray(ids);
+    saveIdSet(*userIds, ids_path);
+    g_array_free(ids, TRUE);
+
+    *(int*)args[5] = counts[USER];
+    *(int*)args[6] = counts[ORGANIZATION];
+    *(int*)args[7] = counts[BOT];
+    addBuildPhaseTime(BUILD_PARSE, start);
 
     DEBUG_PRINT("parseUsers done\n");
 }
 /**
- * @brief 				Reads the repos in the input file and stores their id in an hashtable
+ * @brief 				Reads the repos in the input file and appends their id to the given GArray
  *
- * @param repos 		The file where the Repos are stored
- * @param repoIds 		The hashtable to store the id's in
+ * @param repos_path 	The path to the file where the Repos are stored
+ * @param ids 			The GArray of the ids (ints)
  * @param validate 		The boolean flag to see if the repos should be validated or only read
  */
-void fillRepoIdHashTable(FILE* repos, GHashTable* repoIds, bool validate)
+static void readRepoIds(char* repos_path, GArray* ids, bool validate)
 {
     Format repo_f = getRepoFormat();
+    LineReader repos = openLineReader(repos_path, 0, -1);
+    char* buffer;
 
-    char* buffer = NULL;
-    int buffer_size;
-
-    getFileLine(repos, &buffer, &buffer_size);   //first line
+    readLine(repos, &buffer);   //first line
     Repo r = initRepo();
+    Arena arena = makeArena(0);
 
-    while (getFileLine(repos, &buffer, &buffer_size))
+    while (readLine(repos, &buffer) > 0)
     {
-        if (validate ? readFormat(repo_f, buffer, r)
-                     : (unsafeReadFormat(repo_f, buffer, r), true))
+        if (validate ? readFormat(repo_f, buffer, r, arena)
+                     : (unsafeReadFormat(repo_f, buffer, r, arena), true))
         {
-            g_hash_table_insert(repoIds, GINT_TO_POINTER(getRepoId(r)), GINT_TO_POINTER(1));
-            freeFormat(repo_f, r);
+            int id = getRepoId(r);
+            g_array_append_val(ids, id);
         }
+        resetArena(arena);
     }
 
     free(r);
-    free(buffer);
+    freeArena(arena);
     disposeFormat(repo_f);
-
-    DEBUG_PRINT("fillRepoIdHashTable done\n");
+    closeLineReader(repos);
 }
+
 /**
- * @brief 							Reads the commits from the input file and stores them under the compressed form on the coorespondant file
+ * @brief 				Stores the given ids in an #IdSet. If the #IdSet is not exact, the ids are also stored in an hashtable
  *
- * @param commits					The File with the commits to be read
- * @param compressed_commits 		The File to output the commits to under the compressed form
- * @param usersById 				The #Indexer of userById
- * @param repoIds 					The hashtable of repos by id
- * @param repoLastCommit 			The hashtable to store the #Date of the last #Commit to each #Repo
- * @param validate 					The boolean flag indicating whether or not to validate the commits
- * @param c 						The #Cache to use to speed up the computation
+ * @param ids 			The GArray of the ids (ints)
+ * @param repoIds 		The hashtable to store the id's in, if needed
+ *
+ * @return 				The #IdSet of the ids
+ */
+static IdSet makeRepoIdSet(GArray* ids, GHashTable* repoIds)
+{
+    IdSet ans = makeIdSetFromArray(ids);
+    for (int k = 0; !isIdSetExact(ans) && k < ids->len; k++)
+        g_hash_table_insert(repoIds, GINT_TO_POINTER(g_array_index(ids, int, k)), GINT_TO_POINTER(1));
+    return ans;
+}
+
+/**
+ * @brief 				Reads the repos in the input file and stores their id in an #IdSet
+ *
+ *                      If the #IdSet is not exact, the ids are also stored in an hashtable
+ *
+ * @param repos_path 	The path to the file where the Repos are stored
+ * @param repoIds 		The hashtable to store the id's in, if needed
+ * @param validate 		The boolean flag to see if the repos should be validated or only read
+ *
+ * @return 				The #IdSet of the ids of the repos
+ */
+IdSet fillRepoIdSet(char* repos_path, GHashTable* repoIds, bool validate)
+{
+    GArray* ids = g_array_new(FALSE, FALSE, sizeof(int));
+    readRepoIds(repos_path, ids, validate);
+
+    IdSet ans = makeRepoIdSet(ids, repoIds);
+    g_array_free(ids, TRUE);
+
+    DEBUG_PRINT("fillRepoIdSet done\n");
+    return ans;
+}
+/**
+ * @brief 			Finds the position of the record of a user of a commit, checking whether it exists if the chunk is validated
+ *
+ * @param chunk 	The #CsvChunk
+ * @param id 		The id of the user
+ * @param pos 		Where to store the position of the record of the user
+ *
+ * @return 			Whether or not the user exists (always true if the chunk isn't validated)
+ */
+static bool findCommitUser(CsvChunk chunk, int id, pos_t* pos)
+{
+    if (!chunk->validate) {
+        *pos = getEmbeddedValue(chunk->usersById, (pos_t)id, chunk->cache);
+        return true;
+    }
+
+    return mayContainId(chunk->userIds, id) && findEmbeddedValue(chunk->usersById, (pos_t)id, chunk->cache, pos);
+}
+
+/**
+ * @brief 		Parses the commits of a #CsvChunk, writing the valid ones compressed to the output of the chunk
+ *              along with the entries of the commit indexes
+ *
+ * @param p 	The #CsvChunk
+ *
+ * @return 		Always returns NULL (required by pthread_create thread_start prototype)
  */
-void filterCommits(FILE* commits, FILE* compressed_commits, Indexer usersById,
-                   GHashTable* repoIds, GHashTable* repoLastCommit, bool validate, Cache c)
+static void* filterCommitsChunk(void* p)
 {
+    CsvChunk chunk = (CsvChunk)p;
+    LineReader commits = openLineReader(chunk->path, chunk->start, chunk->end);
+
     Format commit_f = getCommitFormat();
     Format comp_commit_f = getCompressedCommitFormat();
 
-    char* buffer = NULL;
-    int buffer_size;
-
-    getFileLine(commits, &buffer, &buffer_size);   //first line
+    char* buffer;
+    int len;
     Commit commit = initCommit();
+    Arena arena = makeArena(0);
+    MessageWriter messages = makeMessageWriter(chunk->messages);
     setCommitAuthorFriend(commit, false);
     setCommitCommitterFriend(commit, false);
 
-    while (getFileLine(commits, &buffer, &buffer_size))
+    chunk->lastCommit = g_hash_table_new(g_direct_hash, g_direct_equal);
+    chunk->entries = g_array_new(FALSE, FALSE, sizeof(COMMITENTRY));
+
+    while ((len = readLine(commits, &buffer)) >= 0)
     {
-        if (validate ? readFormat(commit_f, buffer, commit)
-                     : (unsafeReadFormat(commit_f, buffer, commit), true))
+        if (len == 0) {
+            chunk->stopped = true;
+            break;
+        }
+
+        if (chunk->validate ? readFormat(commit_f, buffer, commit, arena)
+                            : (unsafeReadFormat(commit_f, buffer, commit, arena), true))
         {
             int author = getCommitAuthorId(commit);
             int committer = getCommitCommitterId(commit);
-
-            if (!validate ||
-                (retrieveKey(usersById, (pos_t)author, c) != -1
-              && (author == committer || retrieveKey(usersById, (pos_t)committer, c) != -1)
-              && g_hash_table_lookup(repoIds, GINT_TO_POINTER(getCommitRepoId(commit))) != NULL))
+            int repo = getCommitRepoId(commit);
+            COMMITENTRY entry = { .repo = (pos_t)repo, .committer = POS_T_MAX };
+
+            if (findCommitUser(chunk, author, &entry.author)
+              && (author == committer || findCommitUser(chunk, committer, &entry.committer))
+              && (!chunk->validate ||
+                  (mayContainId(chunk->repoIds, repo)
+                && (isIdSetExact(chunk->repoIds)
+                    || g_hash_table_lookup(chunk->repoIdTable, GINT_TO_POINTER(repo)) != NULL))))
             {
-                printFormat(comp_commit_f, commit, compressed_commits);
-
-                int repo = getCommitRepoId(commit);
                 uint date = (uint)getCompressedCommitDate(commit);
-                gpointer stored_date = g_hash_table_lookup(repoLastCommit, GINT_TO_POINTER(repo));
+                entry.date = (pos_t)date;
+                entry.pos = (pos_t)ftell(chunk->out);
+                printFormat(comp_commit_f, commit, chunk->out);
+                char* message = getCommitMessage(commit);
+                addMessage(messages, message);
+                free(message);
+                g_array_append_val(chunk->entries, entry);
+
+                gpointer stored_date = g_hash_table_lookup(chunk->lastCommit, GINT_TO_POINTER(repo));
 
                 if (stored_date == NULL || GPOINTER_TO_UINT(stored_date) < date)
-                    g_hash_table_insert(repoLastCommit, GINT_TO_POINTER(repo), GUINT_TO_POINTER(date));
+                    g_hash_table_insert(chunk->lastCommit, GINT_TO_POINTER(repo), GUINT_TO_POINTER(date));
             }
-
-            freeFormat(commit_f, commit);
         }
+        resetArena(arena);
     }
 
+    if (!closeMessageWriter(messages))
+        fprintf(stderr, "filterCommitsChunk: could not write the messages of the commits\n");
     free(commit);
-    free(buffer);
+    freeArena(arena);
     disposeFormat(commit_f);
     disposeFormat(comp_commit_f);
+    closeLineReader(commits);
 
-    fflush(compressed_commits);
-
-    DEBUG_PRINT("filterCommits done\n");
+    return NULL;
 }
+
 /**
- * @brief 							Reads the compressed commits and stores in the corresponding #Indexer the values
+ * @brief 					Keeps the latest of the given date and the one stored in a hashtable for the same repo
  *
- * @param compressed_commits		The File where the compressed commits are stored
- * @param usersById					The #Indexer where the usersById are
- * @param commitsByDate				The #Indexer where the commitsByDate are
- * @param commitsByRepo				The #Indexer where the commitsByRepo are
- * @param collaborators				The #Indexer where the collaborators are
- * @param commitsByRepo_ind_vals	The file that stores the arrays of the commitsByRepo
- * @param collaborators_ind_vals	The file that stores the arrays of the collaborators
- * @param c
+ * @remark 					Used with g_hash_table_foreach
+ *
+ * @param repo 				The id of the repo
+ * @param date 				The date of the last commit to the repo
+ * @param repoLastCommit 	The hashtable of the date of the last commit to each repo
  */
-void parseCommits(FILE* compressed_commits, Indexer usersById,
-                  Indexer commitsByDate, Indexer commitsByRepo, Indexer collaborators,
-                  char* commitsByRepo_ind_vals, char* collaborators_ind_vals, Cache c)
+static void mergeLastCommit(gpointer repo, gpointer date, gpointer repoLastCommit)
 {
-    Format comp_commit_f = getCompressedCommitFormat();
-    Commit commit = initCommit();
-    Lazy l = makeLazy(NULL, 0, comp_commit_f, commit);
+    gpointer stored_date = g_hash_table_lookup((GHashTable*)repoLastCommit, repo);
 
-    fseek(compressed_commits, 0, SEEK_END);
-    pos_t filesize = (pos_t)ftell(compressed_commits);
-    pos_t pos = 0;
+    if (stored_date == NULL || GPOINTER_TO_UINT(stored_date) < GPOINTER_TO_UINT(date))
+        g_hash_table_insert((GHashTable*)repoLastCommit, repo, date);
+}
 
-    while (pos < filesize)
-    {
-        setLazyAddress(l, compressed_commits, pos);
-        Date d = *(Date*)getLazyMember(l, CCCOMMIT_AT, c);  //TODO: date is uncompressed and compressed
-        int repo = *(int*)getLazyMember(l, CCREPO_ID, c);
-        int author = *(int*)getLazyMember(l, CCAUTHOR_ID, c);
-        int committer = *(int*)getLazyMember(l, CCCOMMITTER_ID, c);
-
-        insertIntoIndex(commitsByDate, (pos_t)getCompactedDate(d), pos);
-        insertIntoIndex(commitsByRepo, (pos_t)repo, pos);
-        insertIntoIndex(collaborators, (pos_t)repo, getEmbeddedValue(usersById, (pos_t)author, c));
-        if (author != committer)
-            insertIntoIndex(collaborators, (pos_t)repo, getEmbeddedValue(usersById, (pos_t)committer, c));
-
-        pos = getPosAfterLazy(l, c);
+/**
+ * @brief 							Reads the commits from the input file and stores them under the compressed form on the coorespondant file
+ *
+ *                                  The input file is split into chunks parsed in parallel, whose outputs are then concatenated in order.
+ *                                  The entries of the commit indexes are produced while parsing, so the output is never read back
+ *
+ * @param commits					The path to the file with the commits to be read
+ * @param compressed_commits 		The File to output the commits to under the compressed form
+ * @param messages 					The File to output the messages of the commits to (see #MessageWriter)
+ * @param usersById 				The #Indexer of userById
+ * @param userIds 					The #IdSet of the users
+ * @param repoIds 					The #IdSet of the repos
+ * @param repoIdTable 				The hashtable of repos by id (used if repoIds is not exact)
+ * @param repoLastCommit 			The hashtable to store the #Date of the last #Commit to each #Repo
+ * @param commitsByDate				The #Indexer to insert the commits into by date (left unsorted)
+ * @param commitsByRepo				The #Indexer to insert the commits into by repo (left unsorted)
+ * @param collaborators				The #Indexer to insert the authors and committers into by repo (left unsorted)
+ * @param validate 					The boolean flag indicating whether or not to validate the commits
+ * @param c 						The #Cache to use to speed up the computation
+ */
+void filterCommits(char* commits, FILE* compressed_commits, FILE* messages, Indexer usersById, IdSet userIds,
+                   IdSet repoIds, GHashTable* repoIdTable, GHashTable* repoLastCommit,
+                   Indexer commitsByDate, Indexer commitsByRepo, Indexer collaborators, bool validate, Cache c)
+{
+    CSVCHUNK chunks[LOADER_MAX_THREADS];
+    int n = splitCsv(commits, chunks, validate, c);
+    bool stopped = false;
+
+    //Flushes the index before it is shared by the threads
+    retrieveKey(usersById, 0, c);
+
+    for (int j = 0; j < n; j++) {
+        chunks[j].usersById = usersById;
+        chunks[j].userIds = userIds;
+        chunks[j].repoIds = repoIds;
+        chunks[j].repoIdTable = repoIdTable;
+        chunks[j].messages = tmpfile();
     }
+    parseCsvChunks(chunks, n, filterCommitsChunk);
+
+    for (int j = 0; j < n; j++) {
+        if (!stopped) {
+            pos_t base = (pos_t)ftell(compressed_commits);
+            for (int k = 0; k < chunks[j].entries->len; k++) {
+                COMMITENTRY entry = g_array_index(chunks[j].entries, COMMITENTRY, k);
+                insertIntoIndex(commitsByDate, entry.date, base + entry.pos);
+                insertIntoIndex(commitsByRepo, entry.repo, base + entry.pos);
+                insertIntoIndex(collaborators, entry.repo, entry.author);
+                if (entry.committer != POS_T_MAX)
+                    insertIntoIndex(collaborators, entry.repo, entry.committer);
+            }
 
-    freeLazy(l);
-    free(commit);
-    disposeFormat(comp_commit_f);
+            appendCsvChunk(&chunks[j], compressed_commits);
+            appendFile(chunks[j].messages, messages);
+            g_hash_table_foreach(chunks[j].lastCommit, mergeLastCommit, repoLastCommit);
+            stopped = chunks[j].stopped;
+        }
 
+        g_array_free(chunks[j].entries, TRUE);
+        g_hash_table_destroy(chunks[j].lastCommit);
+        fclose(chunks[j].out);
+        fclose(chunks[j].messages);
+    }
 
-	bool False=false;
-	bool True=true;
+    fflush(compressed_commits);
+    fflush(messages);
 
-	pthread_t threads[2];
-	pthread_create(&threads[0], NULL,sequence,SEQ(
-		FUNC(sortIndexerWrapper,commitsByRepo, c),
-		FUNC(groupIndexerWrapper,commitsByRepo, commitsByRepo_ind_vals, &False, c)
-	));
-	pthread_create(&threads[1], NULL,sequence,SEQ(
-		FUNC(sortIndexerWrapper,collaborators, c),
-		FUNC(groupIndexerWrapper,collaborators, collaborators_ind_vals, &True, c)
-	));
-    sortIndexer(commitsByDate, c);
+    DEBUG_PRINT("filterCommits done\n");
+}
 
-	pthread_join(threads[0], NULL);
-	pthread_join(threads[1], NULL);
+/**
+ * @brief 		A wrapper to call the fuction fillRepoIdSet using a thread
+ *
+ * @param args 	The arguments to pass to the fillRepoIdSet function, followed by where to store its result
+ */
+void fillRepoIdSetWrapper(void* args[])
+{
+    double start = getWallClock();
+    *(IdSet*)args[3] = fillRepoIdSet((char*)args[0], (GHashTable*)args[1], *(bool*)args[2]);
+    addBuildPhaseTime(BUILD_FILTER, start);
+}
 
-    DEBUG_PRINT("parseCommits done\n");
+/**
+ * @brief 		A wrapper to call the fuction filterCommits using a thread. Frees the #IdSet of the repos afterwards
+ *
+ * @param args 	The arguments to pass to the filterCommits function (the #IdSet passed by reference, the file of the
+ * 				messages last)
+ */
+void filterCommitsWrapper(void* args[])
+{
+    double start = getWallClock();
+    IdSet* repoIds = (IdSet*)args[4];
+    filterCommits((char*)args[0], (FILE*)args[1], (FILE*)args[12], (Indexer)args[2], *(IdSet*)args[3], *repoIds,
+                  (GHashTable*)args[5], (GHashTable*)args[6], (Indexer)args[7], (Indexer)args[8], (Indexer)args[9],
+                  *(bool*)args[10], (Cache)args[11]);
+    freeIdSet(*repoIds);
+    addBuildPhaseTime(BUILD_FILTER, start);
 }
 /**
- * @brief 		Reads the repos in the input file and writes them compressed to the corresponding file
+ * @brief 						Reads the repos in the input file and appends them compressed to the given file, inserting them
+ *                              into the given #Indexer (left unsorted)
  *
- * @param args 	The arguments so the function can be executed
+ * @param repos_path 			The path to the file to read the repos from
+ * @param compressed_repos 		The file to append the compressed repos to (at its current position)
+ * @param usersById 			The #Indexer of usersById
+ * @param userIds 				The #IdSet of the users
+ * @param repoLastCommit 		The hashtable of the lastCommitDate to each repo
+ * @param reposById 			The #Indexer of reposById
+ * @param reposByLastCommitDate The #Indexer of reposByLastCommitDate (NULL to skip it)
+ * @param reposByLanguage 		The #Indexer of reposByLanguage
+ * @param languages 			The #Dictionary of the languages (the new languages are added to it)
+ * @param storedIds 			The #IdSet of the repos already stored, which are skipped (NULL if there are none)
+ * @param storedById 			The #Indexer of the repos already stored (NULL if there are none)
+ * @param validate 				The boolean flag weather to validate the repos or nor
+ * @param c 					The cache to use to accelarate the calculations
+ * @param ids 					Where to append the ids of the repos to
  */
-void parseRepos(void*args[])
+static void appendRepos(char* repos_path, FILE* compressed_repos, Indexer usersById, IdSet userIds, GHashTable* repoLastCommit,
+                        Indexer reposById, Indexer reposByLastCommitDate, Indexer reposByLanguage, Dictionary languages,
+                        IdSet storedIds, Indexer storedById, bool validate, Cache c, GArray* ids)
 {
-	FILE* repos=(FILE*)args[0];							///< The file to read the repos from
-	FILE* compressed_repos=(FILE*)args[1];				///< The repos to save the compressed Users
-	Indexer usersById=(Indexer)args[2];					///< The #Indexer of usersById
-	GHashTable* repoLastCommit=(GHashTable*)args[3];	///< The hashtable of the lastCommitDate to each repo
-	Indexer reposById=(Indexer)args[4];					///< The #Indexer of reposById
-	Indexer reposByLastCommitDate=(Indexer)args[5];		///< The #Indexer of reposByLastCommitDate
-	Indexer reposByLanguage=(Indexer)args[6];			///< The #indexer of reposByLanguage
-	char* reposByLanguage_ind_vals=(char*)args[7];		///< The file to store the arrays of repos by language
-	bool validate=*(bool*)args[8];						///< The boolean flag weather to validate the repos or nor
-	Cache c=(Cache)args[9];								///< The cache to use to accelarate the calculations
-
     Format repo_f = getRepoFormat();
     Format comp_repo_f = getCompressedRepoFormat();
 
-    char* buffer = NULL;
-    int buffer_size;
+    LineReader repos = openLineReader(repos_path, 0, -1);
+    char* buffer;
 
-    getFileLine(repos, &buffer, &buffer_size);   //first line
+    readLine(repos, &buffer);   //first line
     Repo r = initRepo();
-    Lazy l = makeLazy(NULL, 0, comp_repo_f, NULL);
+    Arena arena = makeArena(0);
 
-    while (getFileLine(repos, &buffer, &buffer_size))
+    while (readLine(repos, &buffer) > 0)
     {
-        if (validate ? readFormat(repo_f, buffer, r)
-                     : (unsafeReadFormat(repo_f, buffer, r), true))
+        if (validate ? readFormat(repo_f, buffer, r, arena)
+                     : (unsafeReadFormat(repo_f, buffer, r, arena), true))
         {
             gpointer lastCommitDate = g_hash_table_lookup(repoLastCommit, GINT_TO_POINTER(getRepoId(r)));
 
-            if (!validate || (retrieveKey(usersById, (pos_t)getRepoOwnerId(r), c) != -1
-                              && lastCommitDate != NULL))
+            if ((!validate || (idExists(userIds, usersById, getRepoOwnerId(r), c)
+                               && lastCommitDate != NULL))
+                && (storedIds == NULL || !idExists(storedIds, storedById, getRepoId(r), c)))
             {
 
-                setRepoLastCommitDateFromComp(r, GPOINTER_TO_INT(lastCommitDate));
+                setRepoLastCommitDateFromComp(r, GPOINTER_TO_INT(lastCommitDate), arena);
                 repolanguageToLower(r);
+                char* language = getRepoLanguage(r);
+                setRepoLanguageId(r, addToDictionary(languages, language));
+                free(language);
 
                 pos_t pos = (pos_t)ftell(compressed_repos);
                 printFormat(comp_repo_f, r, compressed_repos);
 
                 insertIntoIndex(reposById, (pos_t)getRepoId(r), pos);
-                insertIntoIndex(reposByLastCommitDate, (pos_t)GPOINTER_TO_INT(lastCommitDate), pos);
-
-                //We use the position of the language length as the key to the indexer since the language
-                //is right after. This way, to read the language one simply reads the length n and then the
-                //following n bytes correspond to the wanted string
-                setLazyAddress(l, compressed_repos, pos);
-                pos_t lang_pos = getPosOfLazyMember(l, CRLANGUAGE_LEN, c);
-                insertIntoIndex(reposByLanguage, lang_pos, pos);
+                int id = getRepoId(r);
+                g_array_append_val(ids, id);
+                if (reposByLastCommitDate != NULL)
+                    insertIntoIndex(reposByLastCommitDate, (pos_t)GPOINTER_TO_INT(lastCommitDate), pos);
+                insertIntoIndex(reposByLanguage, (pos_t)getRepoLanguageId(r), pos);
             }
-            freeRepoContent(r);
         }
+        resetArena(arena);
     }
 
     free(r);
-    freeLazy(l);
-    free(buffer);
+    freeArena(arena);
+    closeLineReader(repos);
     disposeFormat(repo_f);
     disposeFormat(comp_repo_f);
 
-
     fflush(compressed_repos);
+}
 
-	pthread_t threads[2];
-	pthread_create(&threads[0], NULL,sequence,SEQ(FUNC(sortIndexerWrapper,reposById,c)));
-	pthread_create(&threads[1], NULL,sequence,SEQ(FUNC(sortIndexerWrapper,reposByLastCommitDate,c)));
-	sortIndexer(reposByLanguage,c);
-    groupIndexer(reposByLanguage, reposByLanguage_ind_vals, false, c);
-	pthread_join(threads[0], NULL);
-	pthread_join(threads[1], NULL);
+/**
+ * @brief 		Reads the repos in the input file and writes them compressed to the corresponding file, inserting them
+ *              into the given #Indexer (left unsorted)
+ *
+ * @param args 	The arguments so the function can be executed
+ */
+void parseRepos(void*args[])
+{
+	char* repos_path=(char*)args[0];					///< The path to the file to read the repos from
+	FILE* compressed_repos=(FILE*)args[1];				///< The repos to save the compressed Users
+	Indexer usersById=(Indexer)args[2];					///< The #Indexer of usersById
+	GHashTable* repoLastCommit=(GHashTable*)args[3];	///< The hashtable of the lastCommitDate to each repo
+	Indexer reposById=(Indexer)args[4];					///< The #Indexer of reposById
+	Indexer reposByLastCommitDate=(Indexer)args[5];		///< The #Indexer of reposByLastCommitDate
+	Indexer reposByLanguage=(Indexer)args[6];			///< The #indexer of reposByLanguage
+	bool validate=*(bool*)args[7];						///< The boolean flag weather to validate the repos or nor
+	Cache c=(Cache)args[8];								///< The cache to use to accelarate the calculations
+	IdSet userIds=*(IdSet*)args[9];						///< The #IdSet of the users
+	IdSet* repoIds=(IdSet*)args[10];					///< Where to store the #IdSet of the repos
+	char* ids_path=(char*)args[11];						///< The path to the file where to save the #IdSet of the repos
+	Dictionary languages=(Dictionary)args[12];			///< The #Dictionary of the languages, filled with those of the repos
+	char* languages_path=(char*)args[13];				///< The path to the file where to save the #Dictionary
+
+    double start = getWallClock();
+    GArray* ids = g_array_new(FALSE, FALSE, sizeof(int));
+    appendRepos(repos_path, compressed_repos, usersById, userIds, repoLastCommit, reposById,
+                reposByLastCommitDate, reposByLanguage, languages, NULL, NULL, validate, c, ids);
+
+    *repoIds = makeIdSetFromArray(ids);
+    saveIdSet(*repoIds, ids_path);
+    saveDictionary(languages, languages_path);
+    g_array_free(ids, TRUE);
+    addBuildPhaseTime(BUILD_PARSE, start);
 
     DEBUG_PRINT("parseRepos done\n");
 }
 
 
+/**
+ * @brief 			Sets the directory of a #Catalog and the paths to its files
+ *
+ * @param catalog 	The #Catalog
+ * @param dir 		The directory (ending in '/', owned by the #Catalog)
+ */
+static void setCatalogDir(Catalog catalog, char* dir)
+{
+    catalog->dir = dir;
+    for (int i = 0; i < CATALOG_FILE_NUM; i++) {
+        catalog->paths[i] = malloc(strlen(dir) + strlen(catalogFileNames[i]) + 1);
+        sprintf(catalog->paths[i], "%s%s", dir, catalogFileNames[i]);
+    }
+}
+
+/**
+ * @brief 		Checks whether or not all of the files of a #Catalog exist in the given directory
+ *
+ * @param dir 	The directory
+ *
+ * @return 		Whether or not all of the files can be read
+ */
+static bool hasCatalogFiles(char* dir)
+{
+    for (int i = 0; i < CATALOG_FILE_NUM; i++) {
+        char path[strlen(dir) + strlen(catalogFileNames[i]) + 1];
+        sprintf(path, "%s%s", dir, catalogFileNames[i]);
+        if (access(path, R_OK))
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 			Publishes a #Catalog built in a staging directory: writes all of its data to disk, saves its #Manifest
+ *                  and swaps it in as the one served (see @ref publishStagingDir)
+ *
+ * @param catalog 	The #Catalog
+ *
+ * @return 			Whether or not the #Catalog was published
+ */
+static bool publishCatalog(Catalog catalog)
+{
+    flushCache(catalog->cache);
+    fflush(NULL);
+
+    bool ok = true;
+    for (int i = 0; ok && i < CATALOG_FILE_NUM; i++)
+        ok = addManifestFile(catalog->manifest, catalog->dir, catalogFileNames[i]);
+
+    setManifestRecords(catalog->manifest, "users", getElemNumber(catalog->usersById));
+    setManifestRecords(catalog->manifest, "commits", getElemNumber(catalog->commitsByDate));
+    setManifestRecords(catalog->manifest, "repos", getElemNumber(catalog->reposById));
+
+    ok = ok && saveManifest(catalog->manifest, catalog->dir) && publishStagingDir(CAT_DIR, catalog->dir);
+    if (ok)
+        catalog->staged = false;
+    else
+        fprintf(stderr, "publishCatalog: the catalog in '%s' was not published\n", catalog->dir);
+    return ok;
+}
+
+/**
+ * @brief 		Calculates the total size of the given files
+ *
+ * @param paths The paths to the files (the ones that don't exist are ignored)
+ * @param n 	The number of files
+ *
+ * @return 		The total size, in bytes
+ */
+static size_t getFilesSize(char* paths[], int n)
+{
+    size_t ans = 0;
+    struct stat st;
+
+    for (int i = 0; i < n; i++)
+        if (stat(paths[i], &st) == 0)
+            ans += (size_t)st.st_size;
+    return ans;
+}
+
+/**
+ * @brief 			Creates the #Cache of a #Catalog with the memory the budget allows for the given phase,
+ *                  splitting it between the lines of index files and those of record files
+ *
+ * @param catalog 	The #Catalog
+ * @param phase 	The phase the #Catalog is created for
+ * @param data_size The size of the data it serves
+ */
+static void makeCatalogCache(Catalog catalog, MemoryPhase phase, size_t data_size)
+{
+    size_t minimum = (size_t)CACHE_MIN_LINES * (CACHE_LINE_SIZE + CACHE_BIG_LINE_SIZE);
+    catalog->cacheMemory = acquireMemory(getCacheBudget(phase, data_size), minimum);
+
+    int index_lines = catalog->cacheMemory / 100 * CACHE_INDEX_SHARE / CACHE_LINE_SIZE;
+    int record_lines = catalog->cacheMemory / 100 * (100 - CACHE_INDEX_SHARE) / CACHE_BIG_LINE_SIZE;
+
+    catalog->cache = getCache(MAX(index_lines, CACHE_MIN_LINES), CACHE_SHARD_NUM, CACHE_2Q);
+    addCachePool(catalog->cache, CACHE_BIG_LINE_SIZE, MAX(record_lines, CACHE_MIN_LINES));
+}
+
+/**
+ * @brief 			Grows the #Cache of a #Catalog to the memory the budget allows for the given phase (ex: once it is built
+ *                  and the memory of the sorts is given back)
+ *
+ * @param catalog 	The #Catalog
+ * @param phase 	The new phase
+ * @param data_size The size of the data it serves
+ */
+static void growCatalogCache(Catalog catalog, MemoryPhase phase, size_t data_size)
+{
+    size_t target = getCacheBudget(phase, data_size);
+    if (target <= catalog->cacheMemory)
+        return;
+
+    size_t extra = acquireMemory(target - catalog->cacheMemory, 0);
+    int index_lines = extra / 100 * CACHE_INDEX_SHARE / CACHE_LINE_SIZE;
+    int record_lines = extra / 100 * (100 - CACHE_INDEX_SHARE) / CACHE_BIG_LINE_SIZE;
+
+    if (index_lines > 0)
+        growCachePool(catalog->cache, CACHE_LINE_SIZE, index_lines);
+    if (record_lines > 0)
+        growCachePool(catalog->cache, CACHE_BIG_LINE_SIZE, record_lines);
+    catalog->cacheMemory += extra;
+}
+
+/**
+ * @brief 		Tries to open the files of the existing #Catalog. If unsucessful (or if they do not match its #Manifest),
+ *              returns NULL
+ *
+ * @param mode 	 The mode to open the record files with (as in fopen)
+ * @param phase  The phase the #Catalog is opened for (sizes its #Cache)
+ * @param staged Whether or not to open a copy of the files in a new staging directory (to be changed and published)
+ *
+ * @return 		The #Catalog
+ */
+static Catalog openCatalog(char* mode, MemoryPhase phase, bool staged)
+{
+#ifdef CATALOG_VERIFY_CHECKSUMS
+    bool checksums = true;
+#else
+    bool checksums = false;
+#endif
+    char* dir = getCurrentDir(CAT_DIR);
+    Manifest manifest = dir == NULL || !hasCatalogFiles(dir) ? NULL : loadManifest(dir);
+    if (manifest == NULL || !checkManifest(manifest, dir, checksums)) {
+        freeManifest(manifest);
+        free(dir);
+        return NULL;
+    }
+
+    //The files are copied so the generation served stays untouched until the new one is published
+    if (staged) {
+        char* staging = makeStagingDir(CAT_DIR);
+        if (staging != NULL && !copyStagingDir(dir, staging)) {
+            removeStagingDir(staging);
+            free(staging);
+            staging = NULL;
+        }
+        free(dir);
+        dir = staging;
+        if (dir == NULL) {
+            freeManifest(manifest);
+            return NULL;
+        }
+    }
+
+    Catalog ans = (Catalog)malloc(sizeof(struct catalog));
+    setCatalogDir(ans, dir);
+    ans->manifest = manifest;
+    ans->staged = staged;
+    makeCatalogCache(ans, phase, getFilesSize(ans->paths, CATALOG_FILE_NUM));
+
+    ans->users = OPEN_FILE(ans->paths[COMPRESSED_USERS], mode);
+    ans->commits = OPEN_FILE(ans->paths[COMPRESSED_COMMITS], mode);
+    ans->repos = OPEN_FILE(ans->paths[COMPRESSED_REPOS], mode);
+
+    registerCacheFile(ans->cache, ans->users, CACHE_BIG_LINE_SIZE);
+    registerCacheFile(ans->cache, ans->commits, CACHE_BIG_LINE_SIZE);
+    registerCacheFile(ans->cache, ans->repos, CACHE_BIG_LINE_SIZE);
+
+    ans->cUserFormat = getCompressedUserFormat();
+	ans->cCommitFormat = getCompressedCommitFormat();
+	ans->cRepoFormat = getCompressedRepoFormat();
+
+	ans->usersById = parseIndexer(ans->paths[USERSBYID_IND], NULL, ans->users, directCmp);
+	ans->reposById = parseIndexer(ans->paths[REPOSBYID_IND], NULL, ans->repos, directCmp);
+	ans->commitsByRepo = parseGroupedIndexer(ans->paths[COMMITSBYREPO_IND], ans->paths[COMMITSBYREPO_IND_VALS], NULL, ans->commits, directCmp);
+    ans->reposByLastCommitDate = parseIndexer(ans->paths[REPOSBYLASTCOMMITDATE_IND], NULL, ans->repos, imbeddedDateCmp);
+	ans->reposByLanguage = parseGroupedIndexer(ans->paths[REPOSBYLANGUAGE_IND], ans->paths[REPOSBYLANGUAGE_IND_VALS], NULL, ans->repos, directCmp);
+	ans->commitsByDate = parseIndexer(ans->paths[COMMITSBYDATE_IND], NULL, ans->commits, imbeddedDateCmp);
+	ans->collaborators = parseGroupedIndexer(ans->paths[COLLABORATORS_IND], ans->paths[COLLABORATORS_IND_VALS], NULL, ans->users, directCmp);
+
+    ans->userIds = loadIdSet(ans->paths[USER_IDS]);
+    ans->repoIds = loadIdSet(ans->paths[REPO_IDS]);
+    ans->languages = loadDictionary(ans->paths[LANGUAGES]);
+    ans->commitColumns = openColumnFile(ans->paths[COMMIT_COLUMNS]);
+    ans->repoCommits = openColumnFile(ans->paths[REPO_COMMITS]);
+    ans->repoZones = openColumnFile(ans->paths[REPO_ZONES]);
+    ans->messages = openMessageFile(ans->paths[COMMIT_MESSAGES]);
+    ans->friends = loadFriendGraph(ans->paths[FRIEND_GRAPH]);
+    //The results of the generation copied are not (see RESULT_CACHE_PREFIX), so they start empty when staged
+    ans->results = makeResultCache(ans->dir, RESULT_CACHE_MEMORY, RESULT_CACHE_DISK_SIZE);
+
+    registerIndexer(ans->commitsByRepo, ans->cache);
+    registerIndexer(ans->reposByLanguage, ans->cache);
+    registerIndexer(ans->collaborators, ans->cache);
+
+    FILE* staticQueries = OPEN_FILE(ans->paths[STATIC_QUERIES], "rb");
+    Format static_queries_f = getStaticQueriesFormat();
+    char buffer[36];
+    
+    int read = fread(buffer, sizeof(char), 36, staticQueries);
+    if (read == 36)
+        unsafeReadFormat(static_queries_f, buffer, ans, NULL);
+    else
+        fprintf(stderr, "loadCatalog: unexpected number of characters read (read: %d; expected: 36\n", read);
+
+    disposeFormat(static_queries_f);
+    fclose(staticQueries);
+
+    if (read != 36 || getManifestRecords(manifest, "users") != getElemNumber(ans->usersById)
+        || getManifestRecords(manifest, "commits") != getElemNumber(ans->commitsByDate)
+        || getManifestRecords(manifest, "repos") != getElemNumber(ans->reposById)
+        || ans->languages == NULL || ans->commitColumns == NULL || getColumnFileRows(ans->commitColumns) != getElemNumber(ans->commitsByDate)
+        || ans->repoCommits == NULL || getColumnFileRows(ans->repoCommits) != getElemNumber(ans->commitsByDate) || ans->repoZones == NULL
+        || ans->messages == NULL || getMessageFileSize(ans->messages) != getElemNumber(ans->commitsByDate)
+        || ans->friends == NULL || getFriendGraphSize(ans->friends) != getElemNumber(ans->usersById)) {
+        fprintf(stderr, "openCatalog: the catalog in '%s' does not match its manifest\n", ans->dir);
+        freeCatalog(ans);
+        ans = NULL;
+    }
+
+    return ans;
+}
+
+/**
+ * @brief 			Gets the files of a #Catalog read through its #Cache, always in the same order
+ *
+ * @param catalog 	The #Catalog
+ * @param files 	Where to write the files (room for @ref CATALOG_CACHE_FILES)
+ *
+ * @return 			The number of files written
+ */
+static int getCatalogCacheFiles(Catalog catalog, FILE* files[])
+{
+    Indexer indexers[] = { catalog->usersById, catalog->reposById, catalog->commitsByRepo, catalog->reposByLastCommitDate,
+                           catalog->reposByLanguage, catalog->commitsByDate, catalog->collaborators };
+    int n = 0;
+    files[n++] = catalog->users;
+    files[n++] = catalog->commits;
+    files[n++] = catalog->repos;
+    for (int i = 0; i < 7; i++)
+        n += getIndexerFiles(indexers[i], files + n);
+    return n;
+}
+
+/**
+ * @brief 			Saves or loads the snapshot of the #Cache of a #Catalog, in the directory of its generation. The snapshot
+ *                  is tagged with the identity of the #Manifest, so one taken before the #Manifest was written is stale
+ *
+ * @param catalog 	The #Catalog
+ * @param save 		Whether to save the snapshot (or to load it)
+ */
+static void snapshotCatalogCache(Catalog catalog, bool save)
+{
+    char tag[CACHE_SNAPSHOT_TAG_SIZE];
+    char* path = malloc(strlen(catalog->dir) + strlen(MANIFEST_NAME) + strlen(CACHE_SNAPSHOT_NAME) + 1);
+    FILE* files[CATALOG_CACHE_FILES];
+    struct stat st;
+
+    if (path == NULL) {
+        fprintf(stderr, "snapshotCatalogCache: error allocating the path of the snapshot\n");
+        return;
+    }
+
+    sprintf(path, "%s%s", catalog->dir, MANIFEST_NAME);
+    if (stat(path, &st) == 0) {
+        snprintf(tag, CACHE_SNAPSHOT_TAG_SIZE, "%llu:%lld:%lld.%09ld", (unsigned long long)st.st_ino,
+                 (long long)st.st_size, (long long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+        sprintf(path, "%s%s", catalog->dir, CACHE_SNAPSHOT_NAME);
+        int n = getCatalogCacheFiles(catalog, files);
+
+        if (save)
+            saveCacheSnapshot(catalog->cache, path, files, n, tag);
+        else
+            loadCacheSnapshot(catalog->cache, path, files, n, tag);
+    }
+
+    free(path);
+}
+
 /**
  * @brief 		Tries to load the existing #Catalog. If unsucessful, returns NULL
  *
  * @return 		The #Catalog
  */
-Catalog loadCatalog()
+Catalog loadCatalog()
+{
+    Catalog ans = openCatalog("rb", MEMORY_QUERY, false);
+
+#ifdef CACHE_DIRECT_IO
+    if (ans != NULL) {
+        setCacheFileDirect(ans->cache, ans->users);
+        setCacheFileDirect(ans->cache, ans->commits);
+        setCacheFileDirect(ans->cache, ans->repos);
+    }
+#endif
+
+#ifdef CACHE_MMAP
+    if (ans != NULL) {
+#ifndef CACHE_DIRECT_IO
+        mapCacheFile(ans->cache, ans->users, MADV_RANDOM);
+        mapCacheFile(ans->cache, ans->commits, MADV_RANDOM);
+        mapCacheFile(ans->cache, ans->repos, MADV_RANDOM);
+#endif
+
+        mapIndexer(ans->usersById, ans->cache);
+        mapIndexer(ans->reposById, ans->cache);
+        mapIndexer(ans->commitsByRepo, ans->cache);
+        mapIndexer(ans->reposByLastCommitDate, ans->cache);
+        mapIndexer(ans->reposByLanguage, ans->cache);
+        mapIndexer(ans->commitsByDate, ans->cache);
+        mapIndexer(ans->collaborators, ans->cache);
+    }
+#endif
+
+#ifdef CATALOG_CACHE_SNAPSHOT
+    if (ans != NULL)
+        snapshotCatalogCache(ans, false);
+#endif
+
+    return ans;
+}
+
+/**
+ * @brief 			Writes the answers to the static queries of a #Catalog to its file
+ *
+ * @param catalog 	The #Catalog
+ */
+static void saveStaticQueries(Catalog catalog)
+{
+    FILE* staticQueries = OPEN_FILE(catalog->paths[STATIC_QUERIES], "wb+");
+    Format static_queries_f = getStaticQueriesFormat();
+    printFormat(static_queries_f, catalog, staticQueries);
+    disposeFormat(static_queries_f);
+    fclose(staticQueries);
+}
+
+/**
+ * @brief 			Writes the columns of the commits (see #CommitColumn), in the order of commitsByDate, to the files of a
+ *                  #Catalog, reading the commits with their friendship status already flagged. The language of the
+ *                  repo of each commit is copied next to it, so scans never look the repos up. The columns are then
+ *                  served to scans from their mapping
+ *
+ * @param catalog 	The #Catalog
+ *
+ * @return 			Whether or not the columns were written
+ */
+static bool saveCommitColumns(Catalog catalog)
+{
+    //The language of each repo, read once (in the order of reposById) so the commits do not look their repos up
+    GHashTable* repoLanguages = g_hash_table_new(g_direct_hash, g_direct_equal);
+    int repoMembers[] = { CRID, CRLANGUAGE_ID };
+    Cursor r = openCursor(catalog->reposById, 0, getElemNumber(catalog->reposById), catalog->cRepoFormat, repoMembers, 2);
+    for (int rows; (rows = nextCursorBatch(r, catalog->cache)) > 0; ) {
+        int *ids = getCursorColumn(r, CRID), *languages = getCursorColumn(r, CRLANGUAGE_ID);
+        for (int j = 0; j < rows; j++)
+            g_hash_table_insert(repoLanguages, GINT_TO_POINTER(ids[j]), GINT_TO_POINTER(languages[j] + 1));
+    }
+    closeCursor(r);
+
+    int numberOfCommits = getElemNumber(catalog->commitsByDate);
+    freeColumnFile(catalog->commitColumns);
+    catalog->commitColumns = makeColumnFile(catalog->paths[COMMIT_COLUMNS], COMMIT_COLUMN_NUM, numberOfCommits);
+    if (catalog->commitColumns == NULL) {
+        g_hash_table_destroy(repoLanguages);
+        return false;
+    }
+
+    int* columns[COMMIT_COLUMN_NUM];
+    for (int k = 0; k < COMMIT_COLUMN_NUM; k++)
+        columns[k] = getColumn(catalog->commitColumns, k);
+
+    int commitMembers[] = { CCREPO_ID, CCAUTHOR_ID, CCCOMMITTER_ID, CCAUTHOR_FRIEND, CCCOMMITTER_FRIEND, CCMESSAGE_LEN };
+    Cursor c = openCursor(catalog->commitsByDate, 0, numberOfCommits, catalog->cCommitFormat, commitMembers, 6);
+    for (int rows; (rows = nextCursorBatch(c, catalog->cache)) > 0; ) {
+        int first = getCursorPosition(c);
+        pos_t* dates = getCursorKeys(c);
+        int *repoIds = getCursorColumn(c, CCREPO_ID), *authorIds = getCursorColumn(c, CCAUTHOR_ID);
+        int *committerIds = getCursorColumn(c, CCCOMMITTER_ID), *messageLens = getCursorColumn(c, CCMESSAGE_LEN);
+        bool *authorFriends = getCursorColumn(c, CCAUTHOR_FRIEND), *committerFriends = getCursorColumn(c, CCCOMMITTER_FRIEND);
+
+        for (int j = 0; j < rows; j++) {
+            int i = first + j;
+            columns[COMMIT_DATE][i] = (int)dates[j];
+            columns[COMMIT_REPO_ID][i] = repoIds[j];
+            columns[COMMIT_AUTHOR_ID][i] = authorIds[j];
+            columns[COMMIT_COMMITTER_ID][i] = committerIds[j];
+            columns[COMMIT_FRIENDS][i] = (authorFriends[j] ? AUTHOR_FRIEND_FLAG : 0)
+                                       | (committerFriends[j] ? COMMITTER_FRIEND_FLAG : 0);
+            columns[COMMIT_MESSAGE_LEN][i] = messageLens[j];
+            columns[COMMIT_LANGUAGE_ID][i] = GPOINTER_TO_INT(g_hash_table_lookup(repoLanguages, GINT_TO_POINTER(repoIds[j]))) - 1;
+        }
+    }
+    closeCursor(c);
+    g_hash_table_destroy(repoLanguages);
+
+    DEBUG_PRINT("saveCommitColumns done\n");
+    return syncColumnFile(catalog->commitColumns);
+}
+
+/**
+ * @brief       Compares two pairs of the id of a repo and the row of one of its commits, by repo and then by row
+ *
+ * @param a     The first pair
+ * @param b     The second pair
+ *
+ * @return      < 0, 0 or > 0 if the first pair goes before, with or after the second
+ */
+static int compareRepoCommits(const void* a, const void* b) {
+    const int *x = a, *y = b;
+    return x[0] != y[0] ? (x[0] > y[0]) - (x[0] < y[0]) : (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+/**
+ * @brief 			Writes the commits of each repo in the order of their dates, with a zone map: repoCommits holds the rows
+ * 					of the columns of the commits (see @ref saveCommitColumns) grouped by repo, in increasing order of
+ * 					the ids of the repos, and repoZones the position, size and range of dates of each group
+ *
+ * 					The rows of the columns are in the order of the dates of the commits, so each group is too, and the
+ * 					commits of a repo in a range of dates are found by a binary search of its group, reading the dates
+ * 					straight from their column (see @ref getRepoCommitRange), so the groups need no zone map per block.
+ * 					The repos whose range of dates misses the one searched are skipped without reading their groups
+ *
+ * @param catalog 	The #Catalog, whose columns were saved
+ *
+ * @return 			Whether or not the files were written
+ */
+static bool saveRepoZones(Catalog catalog)
+{
+    if (catalog->commitColumns == NULL)
+        return false;
+
+    int numberOfCommits = getColumnFileRows(catalog->commitColumns), numberOfRepos = 0;
+    int* dates = getColumn(catalog->commitColumns, COMMIT_DATE);
+    int* repoIds = getColumn(catalog->commitColumns, COMMIT_REPO_ID);
+    int (*pairs)[2] = malloc(MAX(numberOfCommits, 1) * sizeof(int[2]));
+    for (int i = 0; i < numberOfCommits; i++) {
+        pairs[i][0] = repoIds[i];
+        pairs[i][1] = i;
+    }
+    qsort(pairs, numberOfCommits, sizeof(int[2]), compareRepoCommits);
+    for (int i = 0; i < numberOfCommits; i++)
+        if (i == 0 || pairs[i][0] != pairs[i - 1][0])
+            numberOfRepos++;
+
+    freeColumnFile(catalog->repoCommits);
+    freeColumnFile(catalog->repoZones);
+    catalog->repoCommits = makeColumnFile(catalog->paths[REPO_COMMITS], 1, numberOfCommits);
+    catalog->repoZones = makeColumnFile(catalog->paths[REPO_ZONES], REPO_ZONE_COLUMN_NUM, numberOfRepos);
+    if (catalog->repoCommits == NULL || catalog->repoZones == NULL) {
+        free(pairs);
+        return false;
+    }
+
+    int* rows = getColumn(catalog->repoCommits, 0);
+    int* zones[REPO_ZONE_COLUMN_NUM];
+    for (int k = 0; k < REPO_ZONE_COLUMN_NUM; k++)
+        zones[k] = getColumn(catalog->repoZones, k);
+
+    for (int i = 0, z = -1; i < numberOfCommits; i++) {
+        int row = pairs[i][1];
+        rows[i] = row;
+        if (i == 0 || pairs[i][0] != pairs[i - 1][0]) {
+            z++;
+            zones[REPO_ZONE_ID][z] = pairs[i][0];
+            zones[REPO_ZONE_FIRST][z] = i;
+            zones[REPO_ZONE_SIZE][z] = 0;
+            zones[REPO_ZONE_MIN_DATE][z] = dates[row];
+        }
+        zones[REPO_ZONE_SIZE][z]++;
+        zones[REPO_ZONE_MAX_DATE][z] = dates[row];
+    }
+    free(pairs);
+
+    DEBUG_PRINT("saveRepoZones done\n");
+    return syncColumnFile(catalog->repoCommits) && syncColumnFile(catalog->repoZones);
+}
+
+/**
+ * @brief 			Writes a rollup of the commits of a #Catalog (the #Ranking of a #RollupLevel): a group per period with
+ *                  commits, keyed by the compacted date of its start shifted by @ref rollupShifts (so in increasing order),
+ *                  holding the number of commits each user collaborated in during the period. It is read from the
+ *                  columns of the commits, which are in the order of their dates
+ *
+ * @param catalog 	The #Catalog
+ * @param level 	The #RollupLevel
+ *
+ * @return 			Whether or not the rollup was written
+ */
+static bool saveUserRollup(Catalog catalog, RollupLevel level)
+{
+    int shift = rollupShifts[level];
+    int numberOfCommits = getColumnFileRows(catalog->commitColumns);
+    int* dates = getColumn(catalog->commitColumns, COMMIT_DATE);
+    int* authors = getColumn(catalog->commitColumns, COMMIT_AUTHOR_ID);
+    int* committers = getColumn(catalog->commitColumns, COMMIT_COMMITTER_ID);
+
+    int groups = 0;
+    for (int i = 0; i < numberOfCommits; i++)
+        if (i == 0 || dates[i] >> shift != dates[i - 1] >> shift)
+            groups++;
+
+    Ranking rollup = makeRanking(catalog->paths[rollupFiles[level]], groups);
+    if (rollup == NULL)
+        return false;
+
+    Counter users = makeCounter(0);
+    bool ok = true;
+    for (int i = 0; i < numberOfCommits; i++) {
+        increaseCounter(users, authors[i], 1);
+        if (committers[i] != authors[i])
+            increaseCounter(users, committers[i], 1);
+
+        if (i == numberOfCommits - 1 || dates[i + 1] >> shift != dates[i] >> shift) {
+            int len;
+            COUNTERENTRY* rows = getCounterTop(users, getCounterSize(users), &len);
+            ok = addRankingGroup(rollup, dates[i] >> shift, rows, len) && ok;
+            free(rows);
+            clearCounter(users);
+        }
+    }
+
+    freeCounter(users);
+    return closeRanking(rollup) && ok;
+}
+
+/**
+ * @brief 			Writes every rollup of the commits of a #Catalog (see @ref saveUserRollup), once its columns are saved
+ *
+ * @param catalog 	The #Catalog
+ *
+ * @return 			Whether or not every rollup was written
+ */
+static bool saveUserRollups(Catalog catalog)
+{
+    if (catalog->commitColumns == NULL)
+        return false;
+
+    bool ok = true;
+    for (int level = 0; level < ROLLUP_LEVEL_NUM; level++)
+        ok = saveUserRollup(catalog, level) && ok;
+
+    DEBUG_PRINT("saveUserRollups done\n");
+    return ok;
+}
+
+/**
+ * @brief 			Writes the ranking answering query 6 for every language (@ref LANGUAGE_RANKING): a group per language,
+ *                  keyed by its id (so in increasing order), of the users by the number of commits they collaborated in
+ *                  to repos of the language. It is read from the columns of the commits, once they are saved
+ *
+ * @param catalog 	The #Catalog
+ *
+ * @return 			Whether or not the ranking was written
+ */
+static bool saveLanguageRanking(Catalog catalog)
+{
+    if (catalog->commitColumns == NULL)
+        return false;
+
+    int languages = getDictionarySize(catalog->languages);
+    int numberOfCommits = getColumnFileRows(catalog->commitColumns);
+    int* languageIds = getColumn(catalog->commitColumns, COMMIT_LANGUAGE_ID);
+    int* authors = getColumn(catalog->commitColumns, COMMIT_AUTHOR_ID);
+    int* committers = getColumn(catalog->commitColumns, COMMIT_COMMITTER_ID);
+
+    Ranking ranking = makeRanking(catalog->paths[LANGUAGE_RANKING], languages);
+    if (ranking == NULL)
+        return false;
+
+    Counter* users = malloc(MAX(languages, 1) * sizeof(Counter));
+    for (int l = 0; l < languages; l++)
+        users[l] = makeCounter(0);
+
+    for (int i = 0; i < numberOfCommits; i++) {
+        int language = languageIds[i];
+        if (language < 0 || language >= languages)
+            continue;
+
+        increaseCounter(users[language], authors[i], 1);
+        if (committers[i] != authors[i])
+            increaseCounter(users[language], committers[i], 1);
+    }
+
+    bool ok = true;
+    for (int l = 0; l < languages; l++) {
+        int len;
+        COUNTERENTRY* rows = getCounterTop(users[l], getCounterSize(users[l]), &len);
+        ok = addRankingGroup(ranking, l, rows, len) && ok;
+        free(rows);
+        freeCounter(users[l]);
+    }
+    free(users);
+
+    DEBUG_PRINT("saveLanguageRanking done\n");
+    return closeRanking(ranking) && ok;
+}
+
+/**
+ * @brief 			Writes the rankings answering queries 9 and 10 (which only depend on the number of rows wanted) to the
+ *                  files of a #Catalog, reading the commits of each repo (with their friendship status already flagged):
+ *
+ *                  - @ref FRIENDS_RANKING: a single group of the users, by their number of commits to repos owned by a friend
+ *                  - @ref MESSAGE_RANKING: a group per repo (in the order of commitsByRepo, keyed by its id) of its
+ *                    collaborators, by the length of the longest message of their commits to it
+ *
+ * @param catalog 	The #Catalog
+ *
+ * @return 			Whether or not both rankings were written
+ */
+static bool saveRankings(Catalog catalog)
+{
+    int numberOfRepos = getElemNumber(catalog->commitsByRepo);
+    Ranking messages = makeRanking(catalog->paths[MESSAGE_RANKING], numberOfRepos);
+    if (messages == NULL)
+        return false;
+
+    Counter friends = makeCounter(0), lengths = makeCounter(0);
+    Commit commit = initCommit();
+    Lazy c = makeLazy(NULL, 0, catalog->cCommitFormat, commit);
+    bool ok = true;
+
+    for (int i = 0; i < numberOfRepos; i++) {
+        int numberOfCommitsToTheRepo;
+        pos_t* commits = getGroupElems(catalog->commitsByRepo, retrieveGroup(catalog->commitsByRepo, i, catalog->cache),
+                                       &numberOfCommitsToTheRepo, catalog->cache);
+        clearCounter(lengths);
+
+        for (int j = 0; j < numberOfCommitsToTheRepo; j++) {
+            getGroupElemAsLazy(catalog->commitsByRepo, commits[j], c);
+            int messageLen = *(int*)getLazyMember(c, CCMESSAGE_LEN, catalog->cache);
+            int author_id = *(int*)getLazyMember(c, CCAUTHOR_ID, catalog->cache);
+            int committer_id = *(int*)getLazyMember(c, CCCOMMITTER_ID, catalog->cache);
+
+            storeCounterIfGreater(lengths, author_id, messageLen);
+            if (*(bool*)getLazyMember(c, CCAUTHOR_FRIEND, catalog->cache))
+                increaseCounter(friends, author_id, 1);
+
+            if (committer_id != author_id) {
+                storeCounterIfGreater(lengths, committer_id, messageLen);
+                if (*(bool*)getLazyMember(c, CCCOMMITTER_FRIEND, catalog->cache))
+                    increaseCounter(friends, committer_id, 1);
+            }
+        }
+        free(commits);
+
+        int len;
+        COUNTERENTRY* rows = getCounterTop(lengths, getCounterSize(lengths), &len);
+        ok = addRankingGroup(messages, (int)retrieveEmbeddedKey(catalog->commitsByRepo, i, catalog->cache), rows, len) && ok;
+        free(rows);
+    }
+    ok = closeRanking(messages) && ok;
+
+    Ranking users = makeRanking(catalog->paths[FRIENDS_RANKING], 1);
+    if (users != NULL) {
+        int len;
+        COUNTERENTRY* rows = getCounterTop(friends, getCounterSize(friends), &len);
+        ok = addRankingGroup(users, 0, rows, len) && ok;
+        ok = closeRanking(users) && ok;
+        free(rows);
+    } else
+        ok = false;
+
+    freeLazy(c);
+    free(commit);
+    freeCounter(friends);
+    freeCounter(lengths);
+
+    DEBUG_PRINT("saveRankings done\n");
+    return ok;
+}
+
+/**
+ * @brief 		A wrapper to call the fuctions solveStaticQueries, saveStaticQueries, saveRankings, saveCommitColumns,
+ *              saveRepoZones, saveUserRollups and saveLanguageRanking using a thread
+ *
+ * @param args 	The #Catalog
+ */
+void solveStaticQueriesWrapper(void* args[])
+{
+    double start = getWallClock();
+    solveStaticQueries((Catalog)args[0]);
+    saveStaticQueries((Catalog)args[0]);
+    saveRankings((Catalog)args[0]);
+    saveCommitColumns((Catalog)args[0]);
+    saveRepoZones((Catalog)args[0]);
+    saveUserRollups((Catalog)args[0]);
+    saveLanguageRanking((Catalog)args[0]);
+    addBuildPhaseTime(BUILD_STATIC_QUERIES, start);
+}
+
+/**
+ * @brief 					Creates the files nedded to load a catalog and then loads it
+ *
+ * 							The build is a #TaskGraph: each index is sorted (and grouped) as soon as its records are written,
+ * 							and the static queries are solved as soon as the indexes they read are done. It runs in a staging
+ * 							directory, published with its #Manifest once done, so the #Catalog served is replaced atomically
+ *
+ * @param users_path 		The path to the file where the users are stored
+ * @param commits_path 		The path to the file where the commits are stored
+ * @param repos_path 		The path to the file where the repos are stored
+ * @param validate 			The boolean flag indicating whether or not the files should be validated
+ * @return 					The #Catalog
+ */
+Catalog newCatalog(char* users_path, char* commits_path, char* repos_path, bool validate)
+{
+    char* dir = makeStagingDir(CAT_DIR);
+    if (dir == NULL)
+        exit(EXIT_FAILURE);
+
+    Catalog ans = (Catalog)malloc(sizeof(struct catalog));
+    char* inputs[] = { users_path, commits_path, repos_path };
+    setCatalogDir(ans, dir);
+    ans->manifest = makeManifest();
+    ans->staged = true;
+    ans->commitColumns = NULL;
+    ans->repoCommits = NULL;
+    ans->repoZones = NULL;
+    ans->messages = NULL;
+    ans->friends = NULL;
+    ans->results = NULL;
+    ans->languages = makeDictionary();
+    for (int i = 0; i < 3; i++)
+        addManifestSource(ans->manifest, inputs[i]);
+    makeCatalogCache(ans, MEMORY_BUILD, getFilesSize(inputs, 3));
+
+    GHashTable* repoIdTable = g_hash_table_new(g_direct_hash, g_direct_equal);
+    GHashTable* repoLastCommit = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+
+    ans->users = OPEN_FILE(ans->paths[COMPRESSED_USERS], "wb+");
+    ans->commits = OPEN_FILE(ans->paths[COMPRESSED_COMMITS], "wb+");
+    ans->repos = OPEN_FILE(ans->paths[COMPRESSED_REPOS], "wb+");
+    FILE* messages = OPEN_FILE(ans->paths[COMMIT_MESSAGES], "wb");
+
+    registerCacheFile(ans->cache, ans->users, CACHE_BIG_LINE_SIZE);
+    registerCacheFile(ans->cache, ans->commits, CACHE_BIG_LINE_SIZE);
+    registerCacheFile(ans->cache, ans->repos, CACHE_BIG_LINE_SIZE);
+
+    ans->cUserFormat = getCompressedUserFormat();
+	ans->cCommitFormat = getCompressedCommitFormat();
+	ans->cRepoFormat = getCompressedRepoFormat();
+
+    ans->usersById = makeIndexer(ans->paths[USERSBYID_IND], NULL, ans->users, directCmp);
+    ans->reposById = makeIndexer(ans->paths[REPOSBYID_IND], NULL, ans->repos, directCmp);
+    ans->commitsByRepo = makeIndexer(ans->paths[COMMITSBYREPO_IND], NULL, ans->commits, directCmp);
+    ans->reposByLastCommitDate = makeIndexer(ans->paths[REPOSBYLASTCOMMITDATE_IND], NULL, ans->repos, imbeddedDateCmp);
+    ans->reposByLanguage = makeIndexer(ans->paths[REPOSBYLANGUAGE_IND], NULL, ans->repos, directCmp);
+    ans->commitsByDate = makeIndexer(ans->paths[COMMITSBYDATE_IND], NULL, ans->commits, imbeddedDateCmp);
+    ans->collaborators = makeIndexer(ans->paths[COLLABORATORS_IND], NULL, ans->users, directCmp);
+
+    IdSet repoIds = NULL;
+    bool False = false;
+    bool True = true;
+    Cache c = ans->cache;
+
+    //Each step runs as soon as the steps it depends on are done
+    TaskGraph build = makeTaskGraph();
+
+    int users = addGraphTask(build, SEQ(FUNC(parseUsers, users_path, ans->users, ans->usersById, &validate, c,
+                                             &ans->userCount, &ans->organizationCount, &ans->botCount, &ans->userIds,
+                                             ans->paths[USER_IDS])), 0);
+    int friends = addGraphTask(build, SEQ(FUNC(indexFriendsWrapper, ans)), 1, users);
+    int repoIdSet = addGraphTask(build, SEQ(FUNC(fillRepoIdSetWrapper, repos_path, repoIdTable, &validate, &repoIds)), 0);
+    int commits = addGraphTask(build, SEQ(FUNC(filterCommitsWrapper, commits_path, ans->commits, ans->usersById, &ans->userIds,
+                                               &repoIds, repoIdTable, repoLastCommit, ans->commitsByDate, ans->commitsByRepo,
+                                               ans->collaborators, &validate, c, messages)), 2, users, repoIdSet);
+
+    int repos = addGraphTask(build, SEQ(FUNC(parseRepos, repos_path, ans->repos, ans->usersById, repoLastCommit, ans->reposById,
+                                             ans->reposByLastCommitDate, ans->reposByLanguage, &validate, c, &ans->userIds, &ans->repoIds,
+                                             ans->paths[REPO_IDS], ans->languages, ans->paths[LANGUAGES])),
+                             1, commits);
+    int reposById = addGraphTask(build, SEQ(FUNC(sortIndexerWrapper, ans->reposById, c)), 1, repos);
+    addGraphTask(build, SEQ(FUNC(sortIndexerWrapper, ans->reposByLastCommitDate, c)), 1, repos);
+    addGraphTask(build, SEQ(FUNC(sortAndGroupIndexerWrapper, ans->reposByLanguage, ans->paths[REPOSBYLANGUAGE_IND_VALS], &False, c)),
+                 1, repos);
+
+    int commitsByDate = addGraphTask(build, SEQ(FUNC(sortIndexerWrapper, ans->commitsByDate, c)), 1, commits);
+    int commitsByRepo = addGraphTask(build, SEQ(FUNC(sortAndGroupIndexerWrapper, ans->commitsByRepo,
+                                                     ans->paths[COMMITSBYREPO_IND_VALS], &False, c)), 1, commits);
+    int collaborators = addGraphTask(build, SEQ(FUNC(sortAndGroupIndexerWrapper, ans->collaborators,
+                                                     ans->paths[COLLABORATORS_IND_VALS], &True, c)), 1, commits);
+
+    addGraphTask(build, SEQ(FUNC(solveStaticQueriesWrapper, ans)), 5, reposById, commitsByDate, commitsByRepo, collaborators,
+                 friends);
+
+    runTaskGraph(build, BUILD_MAX_THREADS);
+    freeTaskGraph(build);
+    fclose(messages);
+    ans->messages = openMessageFile(ans->paths[COMMIT_MESSAGES]);
+    double start = getWallClock();
+    publishCatalog(ans);
+    addBuildPhaseTime(BUILD_PUBLISH, start);
+    ans->results = makeResultCache(ans->dir, RESULT_CACHE_MEMORY, RESULT_CACHE_DISK_SIZE);
+
+    //The memory of the sorts is given back, so the queries may use a larger cache
+    growCatalogCache(ans, MEMORY_QUERY, getFilesSize(ans->paths, CATALOG_FILE_NUM));
+
+    g_hash_table_destroy(repoIdTable);
+	g_hash_table_destroy(repoLastCommit);
+
+    return ans;
+}
+
+
+/**
+ * @brief 			A wrapper to call the fuction mergeGroupedIndexer using a thread
+ *
+ * @param args 		The arguments to pass to the mergeGroupedIndexer function
+ */
+void mergeGroupedIndexerWrapper(void* args[]){
+    double start = getWallClock();
+	mergeGroupedIndexer((Indexer)args[0], (Indexer)args[1], (char*)args[2], *(bool*)args[3], (Cache)args[4]);
+    addBuildPhaseTime(BUILD_GROUP, start);
+}
+
+/**
+ * @brief 			Appends the (embedded) keys of an #Indexer of ids to the given GArray
+ *
+ * @param i 		The #Indexer
+ * @param ids 		The GArray of the ids (ints)
+ * @param c 		The #Cache
+ */
+static void readIndexerIds(Indexer i, GArray* ids, Cache c)
+{
+    int n = getElemNumber(i);
+    for (int k = 0; k < n; k++) {
+        int id = (int)retrieveEmbeddedKey(i, k, c);
+        g_array_append_val(ids, id);
+    }
+}
+
+/**
+ * @brief 			Creates the #IdSet of the (embedded) keys of an #Indexer of ids
+ *
+ * @param i 		The #Indexer
+ * @param c 		The #Cache
+ *
+ * @return 			The #IdSet
+ */
+static IdSet makeIdSetFromIndexer(Indexer i, Cache c)
+{
+    GArray* ids = g_array_new(FALSE, FALSE, sizeof(int));
+    readIndexerIds(i, ids, c);
+    IdSet ans = makeIdSetFromArray(ids);
+    g_array_free(ids, TRUE);
+    return ans;
+}
+
+/**
+ * @brief A #Repo with new commits, as it was before they were appended to the #Catalog
+ */
+typedef struct affectedRepo {
+    int id;             ///< The id of the repo
+    uint last_commit;   ///< The date of the last new commit (compressed)
+    int commits;        ///< The number of commits it had
+    int collaborators;  ///< The number of collaborators it had
+    bool listed;        ///< Whether or not it was stored by the #Catalog
+    bool bot;           ///< Whether or not one of its collaborators was a bot
+} AFFECTEDREPO;
+
+/**
+ * @brief 					Adds a repo with new commits to the GArray of #AFFECTEDREPO
+ *
+ * @remark 					Used with g_hash_table_foreach
+ *
+ * @param repo 				The id of the repo
+ * @param date 				The date of the last new commit to the repo
+ * @param affected 			The GArray of #AFFECTEDREPO
+ */
+static void addAffectedRepo(gpointer repo, gpointer date, gpointer affected)
+{
+    AFFECTEDREPO a = { .id = GPOINTER_TO_INT(repo), .last_commit = GPOINTER_TO_UINT(date) };
+    g_array_append_val((GArray*)affected, a);
+}
+
+/**
+ * @brief 			Checks whether one of the collaborators of some commits of a repo is a bot
+ *
+ * @param catalog 	The #Catalog
+ * @param commits 	The commits (elements of the group of the repo in commitsByRepo)
+ * @param n 		The number of commits
+ * @param c 		Auxiliar #Lazy to load the commits
+ * @param u 		Auxiliar #Lazy to load the collaborators
+ *
+ * @return 			Whether or not one of the collaborators is a bot
+ */
+static bool hasBotCollaborator(Catalog catalog, pos_t* commits, int n, Lazy c, Lazy u)
+{
+    for (int j = 0; j < n; j++) {
+        getGroupElemAsLazy(catalog->commitsByRepo, commits[j], c);
+        int author_id = *(int*)getLazyMember(c, CCAUTHOR_ID, catalog->cache);
+        int commiter_id = *(int*)getLazyMember(c, CCCOMMITTER_ID, catalog->cache);
+
+        getUserById(catalog, author_id, u);
+        if (*(Type*)getLazyMember(u, CUTYPE, catalog->cache) == BOT)
+            return true;
+
+        if (author_id != commiter_id) {
+            getUserById(catalog, commiter_id, u);
+            if (*(Type*)getLazyMember(u, CUTYPE, catalog->cache) == BOT)
+                return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 					Records the state of the repos with new commits before the commits are indexed, and updates the
+ *                          date of the last commit of the ones already stored
+ *
+ * @param catalog 			The #Catalog
+ * @param repoLastCommit 	The hashtable of the date of the last new commit to each repo
+ *
+ * @return 					The GArray of #AFFECTEDREPO
+ */
+static GArray* collectAffectedRepos(Catalog catalog, GHashTable* repoLastCommit)
+{
+    GArray* affected = g_array_new(FALSE, FALSE, sizeof(AFFECTEDREPO));
+    g_hash_table_foreach(repoLastCommit, addAffectedRepo, affected);
+
+    User user = initUser();
+    Commit commit = initCommit();
+    Repo repo = initRepo();
+    Lazy u = makeLazy(NULL, 0, catalog->cUserFormat, user), c = makeLazy(NULL, 0, catalog->cCommitFormat, commit),
+         r = makeLazy(NULL, 0, catalog->cRepoFormat, repo);
+
+    for (int k = 0; k < affected->len; k++) {
+        AFFECTEDREPO* a = &g_array_index(affected, AFFECTEDREPO, k);
+
+        if (retrieveKey(catalog->commitsByRepo, (pos_t)a->id, catalog->cache) != -1) {
+            pos_t* commits = getGroupElems(catalog->commitsByRepo, getGroup(catalog->commitsByRepo, (pos_t)a->id, catalog->cache),
+                                           &a->commits, catalog->cache);
+            a->collaborators = getGroupSize(catalog->collaborators,
+                                            getGroup(catalog->collaborators, (pos_t)a->id, catalog->cache), catalog->cache);
+            a->bot = hasBotCollaborator(catalog, commits, a->commits, c, u);
+            free(commits);
+        }
+
+        a->listed = getRepoById(catalog, a->id, r);
+        if (a->listed && (uint)getCompactedDate(*(Date*)getLazyMember(r, CRACTUALLY_UPDATED_AT, catalog->cache)) < a->last_commit) {
+            Date* date = (Date*)setLazyMember(r, CRACTUALLY_UPDATED_AT);
+            free(*date);
+            *date = getUncompactedDate(a->last_commit, NULL);
+            printLazyToFile(r, catalog->cache);
+        }
+    }
+
+    freeLazy(u);
+    freeLazy(c);
+    freeLazy(r);
+    free(user);
+    free(commit);
+    free(repo);
+
+    return affected;
+}
+
+/**
+ * @brief 			Rebuilds the index of the repos by the date of their last commit, reading the compressed repos in order
+ *
+ * @param catalog 	The #Catalog
+ */
+static void indexReposByLastCommitDate(Catalog catalog)
+{
+    freeIndexer(catalog->reposByLastCommitDate, catalog->cache);
+    catalog->reposByLastCommitDate = makeIndexer(catalog->paths[REPOSBYLASTCOMMITDATE_IND], NULL, catalog->repos, imbeddedDateCmp);
+
+    Repo repo = initRepo();
+    Lazy l = makeLazy(NULL, 0, catalog->cRepoFormat, repo);
+
+    fseek(catalog->repos, 0, SEEK_END);
+    pos_t filesize = (pos_t)ftell(catalog->repos);
+
+    for (pos_t pos = 0; pos < filesize; pos = getPosAfterLazy(l, catalog->cache)) {
+        setLazyAddress(l, catalog->repos, pos);
+        Date d = *(Date*)getLazyMember(l, CRACTUALLY_UPDATED_AT, catalog->cache);
+        insertIntoIndex(catalog->reposByLastCommitDate, (pos_t)getCompactedDate(d), pos);
+    }
+
+    freeLazy(l);
+    free(repo);
+
+    sortIndexer(catalog->reposByLastCommitDate, catalog->cache);
+}
+
+/**
+ * @brief 				Updates the answers to the static queries of a #Catalog after new records were appended to it,
+ *                      from the repos with new commits only. It also flags the friendship status of the new commits
+ *
+ * @param catalog 		The #Catalog (with the new records already indexed)
+ * @param affected 		The GArray of #AFFECTEDREPO
+ * @param reposBefore 	The number of repos with commits before the new records were appended
+ * @param counts 		The number of new users of each type, indexed by their type
+ */
+static void updateStaticQueries(Catalog catalog, GArray* affected, int reposBefore, int counts[3])
 {
-    if (   access(COMPRESSED_USERS,        R_OK) || access(COMPRESSED_COMMITS,        R_OK)
-        || access(COMPRESSED_REPOS,        R_OK) || access(USERSBYID_IND,             R_OK)
-        || access(REPOSBYID_IND,           R_OK) || access(COMMITSBYREPO_IND,         R_OK)
-        || access(COMMITSBYREPO_IND_VALS,  R_OK) || access(REPOSBYLASTCOMMITDATE_IND, R_OK)
-        || access(REPOSBYLANGUAGE_IND,     R_OK) || access(REPOSBYLANGUAGE_IND_VALS,  R_OK)
-        || access(COMMITSBYDATE_IND,       R_OK) || access(COLLABORATORS_IND,         R_OK)
-        || access(COLLABORATORS_IND_VALS,  R_OK) || access(STATIC_QUERIES,            R_OK))
-            return NULL;
+    long long ansQ2 = reposBefore == 0 ? 0 : (long long)(catalog->Q2 * reposBefore + 0.5);
 
-    Catalog ans = (Catalog)malloc(sizeof(struct catalog));
-	ans->cache = getCache(1000000); //TODO: guess size
+    User user1 = initUser();
+    Commit commit = initCommit();
+    Repo repo = initRepo();
+    Lazy u = makeLazy(NULL, 0, catalog->cUserFormat, user1), c = makeLazy(NULL, 0, catalog->cCommitFormat, commit),
+         r = makeLazy(NULL, 0, catalog->cRepoFormat, repo);
+
+    for (int k = 0; k < affected->len; k++) {
+        AFFECTEDREPO* a = &g_array_index(affected, AFFECTEDREPO, k);
+        int numberOfCommitsToTheRepo;
+        pos_t* commits = getGroupElems(catalog->commitsByRepo, getGroup(catalog->commitsByRepo, (pos_t)a->id, catalog->cache),
+                                       &numberOfCommitsToTheRepo, catalog->cache);
+
+        ansQ2 += getGroupSize(catalog->collaborators, getGroup(catalog->collaborators, (pos_t)a->id, catalog->cache), catalog->cache)
+               - a->collaborators;
+        if (a->listed && a->bot)
+            catalog->Q3--;
+
+        if (!getRepoById(catalog, a->id, r)) {
+            free(commits);
+            continue;
+        }
 
-    ans->users = OPEN_FILE(COMPRESSED_USERS, "rb");
-    ans->commits = OPEN_FILE(COMPRESSED_COMMITS, "rb");
-    ans->repos = OPEN_FILE(COMPRESSED_REPOS, "rb");
+        int ownerId=*(int*)getLazyMember(r,CROWNER_ID,catalog->cache);
+        bool found = a->bot;
 
-    ans->cUserFormat = getCompressedUserFormat();
-	ans->cCommitFormat = getCompressedCommitFormat();
-	ans->cRepoFormat = getCompressedRepoFormat();
+        //The new commits come after the ones the repo had
+        for (int j = a->commits; j < numberOfCommitsToTheRepo; j++) {
+            getGroupElemAsLazy(catalog->commitsByRepo, commits[j], c);
+            found = checkCommitCollaborators(catalog, c, ownerId, u) || found;
+            printLazyToFile(c, catalog->cache);
+        }
+        free(commits);
 
-	ans->usersById = parseIndexer(USERSBYID_IND, NULL, ans->users, directCmp);
-	ans->reposById = parseIndexer(REPOSBYID_IND, NULL, ans->repos, directCmp);
-	ans->commitsByRepo = parseGroupedIndexer(COMMITSBYREPO_IND, COMMITSBYREPO_IND_VALS, NULL, ans->commits, directCmp);
-    ans->reposByLastCommitDate = parseIndexer(REPOSBYLASTCOMMITDATE_IND, NULL, ans->repos, imbeddedDateCmp);
-	ans->reposByLanguage = parseGroupedIndexer(REPOSBYLANGUAGE_IND, REPOSBYLANGUAGE_IND_VALS, ans->repos, ans->repos, stringCmp);
-	ans->commitsByDate = parseIndexer(COMMITSBYDATE_IND, NULL, ans->commits, imbeddedDateCmp);
-	ans->collaborators = parseGroupedIndexer(COLLABORATORS_IND, COLLABORATORS_IND_VALS, NULL, ans->users, directCmp);
+        if (found)
+            catalog->Q3++;
+    }
 
-    FILE* staticQueries = OPEN_FILE(STATIC_QUERIES, "rb");
-    Format static_queries_f = getStaticQueriesFormat();
-    char buffer[36];
-    
-    int read = fread(buffer, sizeof(char), 36, staticQueries);
-    if (read != 36) {
-        fprintf(stderr, "loadCatalog: unexpected number of characters read (read: %d; expected: 36\n", read);
-        freeCatalog(ans);
-        ans = NULL;
-    } else
-        unsafeReadFormat(static_queries_f, buffer, ans);
+    freeLazy(u);
+    freeLazy(c);
+    freeLazy(r);
+    free(user1);
+    free(commit);
+    free(repo);
 
-    disposeFormat(static_queries_f);
-    fclose(staticQueries);
+    catalog->userCount += counts[USER];
+    catalog->organizationCount += counts[ORGANIZATION];
+    catalog->botCount += counts[BOT];
+    catalog->Q2=((double)ansQ2 / getElemNumber(catalog->commitsByRepo));
+    catalog->Q4=((double)getElemNumber(catalog->commitsByDate)/getElemNumber(catalog->usersById));
 
-    return ans;
+    DEBUG_PRINT("updateStaticQueries done\n");
 }
 
 /**
- * @brief 					Creates the files nedded to load a catalog and then loads it
+ * @brief 					Appends the records in the given files to the existing #Catalog and then loads it
  *
- * @param users_path 		The path to the file where the users are stored
- * @param commits_path 		The path to the file where the commits are stored
- * @param repos_path 		The path to the file where the repos are stored
+ * 							The new records are appended to the compressed files and indexed by small sorted indexes, which
+ * 							are merged into the ones of the #Catalog (see @ref mergeIndexer). The static queries are updated
+ * 							from the repos with new commits, instead of solved again. The files are appended to in a copy of
+ * 							the #Catalog, published once done (see @ref newCatalog)
+ *
+ * @remark 					Users and repos already stored are skipped. The new commits must refer to repos stored by the
+ * 							#Catalog or in the given repos file, just as a repo is only stored if it has new commits
+ *
+ * @param users_path 		The path to the file where the new users are stored
+ * @param commits_path 		The path to the file where the new commits are stored
+ * @param repos_path 		The path to the file where the new repos are stored
  * @param validate 			The boolean flag indicating whether or not the files should be validated
- * @return 					The #Catalog
+ *
+ * @return 					The #Catalog (NULL if there is no #Catalog to append to)
  */
-Catalog newCatalog(char* users_path, char* commits_path, char* repos_path, bool validate)
+Catalog appendCatalog(char* users_path, char* commits_path, char* repos_path, bool validate)
 {
-    Catalog ans = (Catalog)malloc(sizeof(struct catalog));
-	ans->cache = getCache(1024 * 1024); //TODO: guess size
-
-    GHashTable* repoIds = g_hash_table_new(g_direct_hash, g_direct_equal);
+    Catalog ans = openCatalog("rb+", MEMORY_BUILD, true);
+    if (ans == NULL)
+        return NULL;
+
+    addManifestSource(ans->manifest, users_path);
+    addManifestSource(ans->manifest, commits_path);
+    addManifestSource(ans->manifest, repos_path);
+
+    Cache c = ans->cache;
+    if (ans->userIds == NULL)
+        ans->userIds = makeIdSetFromIndexer(ans->usersById, c);
+    if (ans->repoIds == NULL)
+        ans->repoIds = makeIdSetFromIndexer(ans->reposById, c);
+
+    int counts[3] = { 0, 0, 0 };
+    int reposBefore = getElemNumber(ans->commitsByRepo);
+    GArray* ids = g_array_new(FALSE, FALSE, sizeof(int));
+
+    Indexer newUsers = makeIndexer(NULL, NULL, ans->users, directCmp);
+    fseek(ans->users, 0, SEEK_END);
+    appendUsers(users_path, ans->users, newUsers, ans->userIds, ans->usersById, validate, c, counts, ids);
+    clearCacheFile(c, ans->users);
+    sortIndexer(newUsers, c);
+    mergeIndexer(ans->usersById, newUsers, c);
+    freeIndexer(newUsers, c);
+
+    freeIdSet(ans->userIds);
+    ans->userIds = makeIdSetFromIndexer(ans->usersById, c);
+    indexFriends(ans);
+
+    //The new commits may refer to the stored repos and to the new ones
+    GHashTable* repoIdTable = g_hash_table_new(g_direct_hash, g_direct_equal);
     GHashTable* repoLastCommit = g_hash_table_new(g_direct_hash, g_direct_equal);
+    g_array_set_size(ids, 0);
+    readIndexerIds(ans->reposById, ids, c);
+    readRepoIds(repos_path, ids, validate);
+    IdSet repoIds = makeRepoIdSet(ids, repoIdTable);
+
+    Indexer newCommitsByDate = makeIndexer(NULL, NULL, ans->commits, imbeddedDateCmp);
+    Indexer newCommitsByRepo = makeIndexer(NULL, NULL, ans->commits, directCmp);
+    Indexer newCollaborators = makeIndexer(NULL, NULL, ans->users, directCmp);
+    fseek(ans->commits, 0, SEEK_END);
+    FILE* messages = OPEN_FILE(ans->paths[COMMIT_MESSAGES], "ab");
+    filterCommits(commits_path, ans->commits, messages, ans->usersById, ans->userIds, repoIds, repoIdTable, repoLastCommit,
+                  newCommitsByDate, newCommitsByRepo, newCollaborators, validate, c);
+    clearCacheFile(c, ans->commits);
+    fclose(messages);
+    freeMessageFile(ans->messages);
+    ans->messages = openMessageFile(ans->paths[COMMIT_MESSAGES]);
+    freeIdSet(repoIds);
+    g_hash_table_destroy(repoIdTable);
+
+    GArray* affected = collectAffectedRepos(ans, repoLastCommit);
+
+    Indexer newRepos = makeIndexer(NULL, NULL, ans->repos, directCmp);
+    Indexer newReposByLanguage = makeIndexer(NULL, NULL, ans->repos, directCmp);
+    clearCacheFile(c, ans->repos);
+    fseek(ans->repos, 0, SEEK_END);
+    g_array_set_size(ids, 0);
+    appendRepos(repos_path, ans->repos, ans->usersById, ans->userIds, repoLastCommit, newRepos, NULL, newReposByLanguage,
+                ans->languages, ans->repoIds, ans->reposById, validate, c, ids);
+    clearCacheFile(c, ans->repos);
+
+    sortIndexer(newRepos, c);
+    mergeIndexer(ans->reposById, newRepos, c);
+    sortIndexer(newReposByLanguage, c);
+    mergeGroupedIndexer(ans->reposByLanguage, newReposByLanguage, ans->paths[REPOSBYLANGUAGE_IND_VALS], false, c);
+    freeIndexer(newRepos, c);
+    freeIndexer(newReposByLanguage, c);
+    indexReposByLastCommitDate(ans);
+
+    freeIdSet(ans->repoIds);
+    ans->repoIds = makeIdSetFromIndexer(ans->reposById, c);
+    saveIdSet(ans->userIds, ans->paths[USER_IDS]);
+    saveIdSet(ans->repoIds, ans->paths[REPO_IDS]);
+    saveDictionary(ans->languages, ans->paths[LANGUAGES]);
 
-    FILE* users = OPEN_FILE(users_path, "r");
-    FILE* commits = OPEN_FILE(commits_path, "r");
-    FILE* repos = OPEN_FILE(repos_path, "r");
-
-    ans->users = OPEN_FILE(COMPRESSED_USERS, "wb+");
-    ans->commits = OPEN_FILE(COMPRESSED_COMMITS, "wb+");
-    ans->repos = OPEN_FILE(COMPRESSED_REPOS, "wb+");
 
-    ans->cUserFormat = getCompressedUserFormat();
-	ans->cCommitFormat = getCompressedCommitFormat();
-	ans->cRepoFormat = getCompressedRepoFormat();
+	bool False=false;
+	bool True=true;
 
-    ans->usersById = makeIndexer(USERSBYID_IND, NULL, ans->users, directCmp);
-    ans->reposById = makeIndexer(REPOSBYID_IND, NULL, ans->repos, directCmp);
-    ans->commitsByRepo = makeIndexer(COMMITSBYREPO_IND, NULL, ans->commits, directCmp);
-    ans->reposByLastCommitDate = makeIndexer(REPOSBYLASTCOMMITDATE_IND, NULL, ans->repos, imbeddedDateCmp);
-    ans->reposByLanguage = makeIndexer(REPOSBYLANGUAGE_IND, ans->repos, ans->repos, stringCmp);
-    ans->commitsByDate = makeIndexer(COMMITSBYDATE_IND, NULL, ans->commits, imbeddedDateCmp);
-    ans->collaborators = makeIndexer(COLLABORATORS_IND, NULL, ans->users, directCmp);
-
-    pthread_t secondaryThread;
-    pthread_create(&secondaryThread, NULL, sequence,
-    	SEQ(FUNC(parseUsers,users, ans->users, ans->usersById, &validate, ans->cache, &ans->userCount, &ans->organizationCount, &ans->botCount)));
-    fillRepoIdHashTable(repos, repoIds, validate);
-    fseek(repos, 0, SEEK_SET);
-	pthread_join(secondaryThread, NULL);
-
-    filterCommits(commits, ans->commits, ans->usersById, repoIds, repoLastCommit, validate, ans->cache);
-
-	pthread_create(&secondaryThread, NULL, sequence,
-    	SEQ(FUNC(parseRepos,repos, ans->repos, ans->usersById, repoLastCommit, ans->reposById,
-        ans->reposByLastCommitDate, ans->reposByLanguage, REPOSBYLANGUAGE_IND_VALS, &validate, ans->cache)));
-    parseCommits(ans->commits, ans->usersById, ans->commitsByDate, ans->commitsByRepo,
-                    ans->collaborators, COMMITSBYREPO_IND_VALS, COLLABORATORS_IND_VALS, ans->cache);
-	pthread_join(secondaryThread, NULL);
-
-    g_hash_table_destroy(repoIds);
-	g_hash_table_destroy(repoLastCommit);
-    fclose(users);
-    fclose(commits);
-    fclose(repos);
+	pthread_t threads[2];
+	pthread_create(&threads[0], NULL,sequence,SEQ(
+		FUNC(sortIndexerWrapper,newCommitsByRepo, c),
+		FUNC(mergeGroupedIndexerWrapper,ans->commitsByRepo, newCommitsByRepo, ans->paths[COMMITSBYREPO_IND_VALS], &False, c)
+	));
+	pthread_create(&threads[1], NULL,sequence,SEQ(
+		FUNC(sortIndexerWrapper,newCollaborators, c),
+		FUNC(mergeGroupedIndexerWrapper,ans->collaborators, newCollaborators, ans->paths[COLLABORATORS_IND_VALS], &True, c)
+	));
+    sortIndexer(newCommitsByDate, c);
+    mergeIndexer(ans->commitsByDate, newCommitsByDate, c);
 
-    solveStaticQueries(ans);
-    FILE* staticQueries = OPEN_FILE(STATIC_QUERIES, "wb+");
-    Format static_queries_f = getStaticQueriesFormat();
-    printFormat(static_queries_f, ans, staticQueries);
-    disposeFormat(static_queries_f);
-    fclose(staticQueries);
+	pthread_join(threads[0], NULL);
+	pthread_join(threads[1], NULL);
 
+    freeIndexer(newCommitsByDate, c);
+    freeIndexer(newCommitsByRepo, c);
+    freeIndexer(newCollaborators, c);
+
+    updateStaticQueries(ans, affected, reposBefore, counts);
+    saveStaticQueries(ans);
+    saveRankings(ans);
+    saveCommitColumns(ans);
+    saveRepoZones(ans);
+    saveUserRollups(ans);
+    saveLanguageRanking(ans);
+    double start = getWallClock();
+    publishCatalog(ans);
+    addBuildPhaseTime(BUILD_PUBLISH, start);
+
+    g_array_free(affected, TRUE);
+    g_array_free(ids, TRUE);
+    g_hash_table_destroy(repoLastCommit);
+
+    DEBUG_PRINT("appendCatalog done\n");
     return ans;
 }
 
@@ -781,6 +2465,8 @@ int getUsersCount(Catalog c) {
  * @return  		The #Lazy pointer to the #User
  */
 void getUserById(Catalog c, int id, Lazy dest) {
+    if (c->userIds != NULL && !mayContainId(c->userIds, id))
+        return;
     findValueAsLazy(c->usersById, (pos_t)id, c->cache, dest);
 }
 
@@ -812,6 +2498,92 @@ void printUserLoginById(Catalog c, int id, Lazy l, FILE* dest)
     }
 }
 
+/**
+ * @brief       	Compares two ids (used to sort the ids resolved by @ref getUserLogins)
+ *
+ * @param a     	The first id
+ * @param b     	The second id
+ *
+ * @return      	A negative number, 0 or a positive number if the first id is smaller, equal or greater
+ */
+static int compareUserIds(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief           Gets the logins of many users at once
+ *
+ *                  The ids are sorted and deduplicated, then found in a single walk over usersById (stepping forward
+ *                  up to @ref LOGIN_WALK_STEPS keys from the last id found, and searching otherwise), so each user is
+ *                  read once and in the order it is stored
+ *
+ * @param c         The #Catalog
+ * @param ids       The ids of the users (in any order, possibly repeated)
+ * @param n         The number of ids
+ * @param offsets   Set to the position in the returned buffer of the login of each id (an empty string if there is no
+ *                  #User with the id)
+ *
+ * @return          The buffer holding the logins, each ended by '\0' (to be freed by the caller)
+ */
+char* getUserLogins(Catalog c, int* ids, int n, int* offsets)
+{
+    int* sorted = malloc(MAX(n, 1) * sizeof(int));
+    memcpy(sorted, ids, n * sizeof(int));
+    qsort(sorted, n, sizeof(int), compareUserIds);
+    int unique = 0;
+    for (int i = 0; i < n; i++)
+        if (unique == 0 || sorted[i] != sorted[unique - 1])
+            sorted[unique++] = sorted[i];
+
+    int* uniqueOffsets = malloc(MAX(unique, 1) * sizeof(int));
+    size_t size = 0, capacity = 64;
+    char* logins = malloc(capacity);
+    //The empty string of the users not found
+    logins[size++] = '\0';
+
+    User u = initUser();
+    Lazy l = makeLazy(NULL, 0, c->cUserFormat, u);
+    int users = getElemNumber(c->usersById), pos = 0;
+
+    for (int k = 0; k < unique; k++) {
+        uniqueOffsets[k] = 0;
+        if (c->userIds != NULL && !mayContainId(c->userIds, sorted[k]))
+            continue;
+
+        int steps = 0;
+        while (pos < users && steps < LOGIN_WALK_STEPS && (int)retrieveEmbeddedKey(c->usersById, pos, c->cache) < sorted[k]) {
+            pos++;
+            steps++;
+        }
+        if (steps == LOGIN_WALK_STEPS)
+            pos = retrieveKeyLowerBound(c->usersById, (pos_t)sorted[k], c->cache);
+        if (pos >= users || (int)retrieveEmbeddedKey(c->usersById, pos, c->cache) != sorted[k])
+            continue;
+
+        retrieveValueAsLazy(c->usersById, pos, c->cache, l);
+        char* login = *(char**)getLazyMember(l, CULOGIN, c->cache);
+        size_t len = strlen(login) + 1;
+        while (size + len > capacity)
+            capacity *= 2;
+        logins = realloc(logins, capacity);
+        uniqueOffsets[k] = size;
+        memcpy(logins + size, login, len);
+        size += len;
+    }
+
+    for (int i = 0; i < n; i++) {
+        int* found = bsearch(&ids[i], sorted, unique, sizeof(int), compareUserIds);
+        offsets[i] = uniqueOffsets[found - sorted];
+    }
+
+    freeLazy(l);
+    free(u);
+    free(uniqueOffsets);
+    free(sorted);
+    return logins;
+}
+
 /**
  * @brief 			Returns the number of #Commit stored in the #Catalog
  *
@@ -843,6 +2615,8 @@ int getTotalReposCount(Catalog c)
  * @return        	The #Repo
  */
 bool getRepoById(Catalog c, int id, Lazy dest) {
+    if (c->repoIds != NULL && !mayContainId(c->repoIds, id))
+        return false;
     return findValueAsLazy(c->reposById, (pos_t)id, c->cache, dest);
 }
 
@@ -892,25 +2666,75 @@ void queryOne(Catalog catalog, FILE* stream) {
 }
 
 /**
- * @brief 			Executes the seventh query (repos not updated since given date)
+ * @brief 			Writes the repos not updated since the given date (see @ref querySeven), in the order of their last
+ *                  commit date
  *
  * @param catalog   The given #Catalog
  * @param date      The given #Date
  * @param stream    The stream to write the ouput to
+ * @param cancel    The #CancelToken of the query (checked between batches of repos)
+ * @param keyed     Whether each row is preceded by the last commit date of its repo (see @ref partialSeven)
  */
-void querySeven(Catalog catalog, Date date, FILE* stream) {
-
+static void printInactiveRepos(Catalog catalog, Date date, FILE* stream, CancelToken cancel, bool keyed) {
     int last = retrieveKeyLowerBound(catalog->reposByLastCommitDate, (pos_t)getCompactedDate(date), catalog->cache);
-    Repo repo = initRepo();
-    Lazy r = makeLazy(NULL, 0, catalog->cRepoFormat, repo);
-    for (int i = 0; i < last; i++){
-        retrieveValueAsLazy(catalog->reposByLastCommitDate, i, catalog->cache, r);
-        int repoId = *(int*)getLazyMember(r, CRID, catalog->cache);
-        char* desc = *(char**)getLazyMember(r, CRDESCRIPTION, catalog->cache);
-        fprintf(stream, "%d;%s\n", repoId, desc);
+    int members[] = { CRID, CRDESCRIPTION };
+    Cursor r = openCursor(catalog->reposByLastCommitDate, 0, last, catalog->cRepoFormat, members, 2);
+    ResultSink sink = openSink(stream);
+    for (int rows; !isCancelled(cancel) && (rows = nextCursorBatch(r, catalog->cache)) > 0; ) {
+        int* repoIds = getCursorColumn(r, CRID);
+        char** descs = getCursorColumn(r, CRDESCRIPTION);
+        pos_t* keys = getCursorKeys(r);
+        for (int j = 0; j < rows; j++) {
+            if (keyed) {
+                //The compacted dates fit in an int
+                sinkInt(sink, (int)keys[j]);
+                sinkChar(sink, ';');
+            }
+            sinkInt(sink, repoIds[j]);
+            sinkChar(sink, ';');
+            sinkString(sink, descs[j]);
+            sinkChar(sink, '\n');
+        }
     }
-    freeLazy(r);
-    free(repo);
+    closeSink(sink);
+    closeCursor(r);
+}
+
+/**
+ * @brief 			Executes the seventh query (repos not updated since given date)
+ *
+ * @param catalog   The given #Catalog
+ * @param date      The given #Date
+ * @param stream    The stream to write the ouput to
+ * @param cancel    The #CancelToken of the query (checked between batches of repos)
+ */
+void querySeven(Catalog catalog, Date date, FILE* stream, CancelToken cancel) {
+    printInactiveRepos(catalog, date, stream, cancel, false);
+}
+
+/**
+ * @brief 			Solves the seventh query on a shard of the dataset: its rows are preceded by the last commit date of the
+ *                  repo (as compacted, see @ref getCompactedDate), so the rows of the shards can be merged in order
+ *
+ * @param catalog 	The #Catalog of the shard
+ * @param date 		The given #Date
+ * @param stream    The stream to write the ouput to
+ * @param cancel    The #CancelToken of the query (checked between batches of rows)
+ */
+void partialSeven(Catalog catalog, Date date, FILE* stream, CancelToken cancel) {
+    printInactiveRepos(catalog, date, stream, cancel, true);
+}
+
+/**
+ * @brief 			Gets the number of hits and misses of the #Cache of a #Catalog so far (see @ref getCacheStatistics)
+ *
+ * @param catalog  	The #Catalog
+ * @param hits 		Where to store the number of hits
+ * @param misses 	Where to store the number of misses
+ */
+void getCatalogCacheStatistics(Catalog catalog, long* hits, long* misses)
+{
+    getCacheStatistics(catalog->cache, hits, misses);
 }
 
 /**
@@ -920,6 +2744,12 @@ void querySeven(Catalog catalog, Date date, FILE* stream) {
  */
 void freeCatalog(Catalog catalog)
 {
+#ifdef CATALOG_CACHE_SNAPSHOT
+    //A catalog which was not published has no generation to warm
+    if (!catalog->staged)
+        snapshotCatalogCache(catalog, true);
+#endif
+
     disposeFormat(catalog->cUserFormat);
 	disposeFormat(catalog->cCommitFormat);
 	disposeFormat(catalog->cRepoFormat);
@@ -931,184 +2761,501 @@ void freeCatalog(Catalog catalog)
     freeIndexer(catalog->reposByLanguage, catalog->cache);
     freeIndexer(catalog->commitsByDate, catalog->cache);
     freeIndexer(catalog->collaborators, catalog->cache);
+    freeIdSet(catalog->userIds);
+    freeIdSet(catalog->repoIds);
+    freeDictionary(catalog->languages);
 
     //The cache must be freed before closing any altered file to allow it to flush the changes
     freeCache(catalog->cache);
+    releaseMemory(catalog->cacheMemory);
 
     fclose(catalog->commits);
     fclose(catalog->users);
     fclose(catalog->repos);
 
+    freeColumnFile(catalog->commitColumns);
+    freeColumnFile(catalog->repoCommits);
+    freeColumnFile(catalog->repoZones);
+    freeMessageFile(catalog->messages);
+    freeFriendGraph(catalog->friends);
+    freeResultCache(catalog->results);
+
+    //A catalog which was not published is never served
+    if (catalog->staged)
+        removeStagingDir(catalog->dir);
+    for (int i = 0; i < CATALOG_FILE_NUM; i++)
+        free(catalog->paths[i]);
+    free(catalog->dir);
+    freeManifest(catalog->manifest);
 
     free(catalog);
 }
 
 
 /**
- * @brief 				Gets a HashTable Of #User and their number of #Commit in an interval of #Date
+ * @brief           Runs some plans over the columns of the commits of a #Catalog, in a single scan of
+ *                  @ref commitsByDate (see @ref runPlans)
+ *
+ * @param catalog   The given #Catalog
+ * @param plans     The plans (made by @ref planCommitsPerLanguage and @ref planCommitsPerLanguageAfter)
+ * @param n         The number of plans
+ * @param cancel    The #CancelToken of the queries (the results are partial once it is cancelled)
+ */
+void runCatalogPlans(Catalog catalog, Plan* plans, int n, CancelToken cancel) {
+    runPlans(plans, n, catalog->commitsByDate, cancel);
+}
+
+/**
+ * @brief           Counts the #Commit each #User collaborated in, in a range of @ref commitsByDate (a plan grouping by
+ *                  the author and the committer of each commit, counting it once if they are the same #User)
+ *
+ * @param catalog   The given #Catalog
+ * @param from      The first position of the range
+ * @param to        The position after the last position of the range
+ * @param cancel    The #CancelToken of the query
+ *
+ * @return          The #Counter of the number of #Commit of each #User (partial if the query was cancelled)
+ */
+static Counter countCommitsOfUsers(Catalog catalog, int from, int to, CancelToken cancel) {
+    Plan plan = makePlan(from, to);
+    int* users[] = { getColumn(catalog->commitColumns, COMMIT_AUTHOR_ID), getColumn(catalog->commitColumns, COMMIT_COMMITTER_ID) };
+    setPlanGroupBy(plan, users, 2, PLAN_COUNT, NULL);
+
+    runCatalogPlans(catalog, &plan, 1, cancel);
+    Counter ans = takePlanResult(plan);
+    freePlan(plan);
+    return ans;
+}
+
+/**
+ * @brief           Gets the position of the first commit (in the order of commitsByDate) made on or after a date,
+ *                  searching the column of the dates of the commits
+ * 
+ * @param catalog   The given #Catalog
+ * @param date      The compacted date
+ * 
+ * @return          The position (the number of commits if all were made before the date)
+ */
+static int getCommitsLowerBound(Catalog catalog, int date) {
+    int* dates = getColumn(catalog->commitColumns, COMMIT_DATE);
+    int l = 0, r = getColumnFileRows(catalog->commitColumns);
+    while (l < r) {
+        int m = l + (r - l) / 2;
+        if (dates[m] < date)
+            l = m + 1;
+        else
+            r = m;
+    }
+    return l;
+}
+
+/**
+ * @brief           Counts the #Commit each #User collaborated in between two compacted dates: the whole periods of a
+ *                  #RollupLevel in between are read from its rollup, and the parts before the first and after the last
+ *                  whole period from the next level (scanning the commits themselves after the finest level, or if a
+ *                  rollup could not be opened)
+ *
+ * @param catalog   The given #Catalog
+ * @param rollups   The rollup of each #RollupLevel (NULL if it is not used)
+ * @param level     The #RollupLevel to count from
+ * @param from      The first compacted date of the range
+ * @param to        The compacted date after the last of the range
+ * @param users     The #SpillCounter to add the counts to
+ * @param cancel    The #CancelToken of the query
+ */
+static void countUserCommitsBetween(Catalog catalog, Ranking* rollups, int level, long long from, long long to, SpillCounter users,
+                                    CancelToken cancel) {
+    if (from >= to || isCancelled(cancel))
+        return;
+
+    if (level == ROLLUP_LEVEL_NUM || rollups[level] == NULL) {
+        int first = getCommitsLowerBound(catalog, (int)from), last = getCommitsLowerBound(catalog, (int)to);
+        if (first < last) {
+            Counter scanned = countCommitsOfUsers(catalog, first, last, cancel);
+            mergeIntoSpillCounter(users, scanned);
+            freeCounter(scanned);
+        }
+        return;
+    }
+
+    //The periods starting on or after from and ending on or before to
+    int shift = rollupShifts[level];
+    long long firstKey = (from + (1LL << shift) - 1) >> shift, lastKey = to >> shift;
+    if (firstKey >= lastKey) {
+        countUserCommitsBetween(catalog, rollups, level + 1, from, to, users, cancel);
+        return;
+    }
+
+    countUserCommitsBetween(catalog, rollups, level + 1, from, firstKey << shift, users, cancel);
+
+    Ranking rollup = rollups[level];
+    int last = findRankingGroup(rollup, (int)lastKey);
+    for (int g = findRankingGroup(rollup, (int)firstKey); g < last && !isCancelled(cancel); g++) {
+        int len;
+        COUNTERENTRY* rows = readRankingGroup(rollup, g, INT_MAX, &len);
+        for (int j = 0; j < len; j++)
+            addToSpillCounter(users, rows[j].key, rows[j].value);
+    }
+
+    countUserCommitsBetween(catalog, rollups, level + 1, lastKey << shift, to, users, cancel);
+}
+
+/**
+ * @brief 				Gets a #SpillCounter Of #User and their number of #Commit in an interval of #Date
  *
- * 						The hashtable has a type UserID:Number of commits they collaborated in
+ * 						The #SpillCounter has a type UserID:Number of commits they collaborated in, and is spilled to
+ * 						disk once the users do not fit in the memory budget
  *
  * @param catalog 		the #Catalog to search the commits in
  * @param startDate		the starting #Date to search
  * @param endDate 		the ending #Date to search
- * @param du 			the number of diferent #User which collaborated in between the #Date
- *
- * @return 				GHashTable of #User and the number of commits they collaborated in
- */
-GHashTable* getHashTableOfUserWithCommitsAfter(Catalog catalog,Date startDate,Date endDate,int* du) {
-	GHashTable* users = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, NULL);
-	pos_t date1=(pos_t)getCompactedDate(startDate);
-	pos_t date2=(pos_t)getCompactedDate(endDate);
-    int commits = getElemNumber(catalog->commitsByDate);
-    Commit c = initCommit();
-    Lazy commit = makeLazy(NULL, 0, catalog->cCommitFormat, c);
-    *du = 0;
-    for (int i = retrieveKeyLowerBound(catalog->commitsByDate, date1, catalog->cache); i < commits; i++){
-        if (retrieveEmbeddedKey(catalog->commitsByDate, i, catalog->cache) > date2) break;
-        retrieveValueAsLazy(catalog->commitsByDate, i, catalog->cache, commit);
-        int commiter_id = *(int*)getLazyMember(commit,CCCOMMITTER_ID,catalog->cache);
-		int author_id = *(int*)getLazyMember(commit,CCAUTHOR_ID,catalog->cache);
-		increaseNumberInHashTableIfFound(users,GINT_TO_POINTER(author_id),du);
-        if (commiter_id != author_id) increaseNumberInHashTableIfFound(users,GINT_TO_POINTER(commiter_id),du);
-    }
-    freeLazy(commit);
-    free(c);
+ * @param cancel 		the #CancelToken of the query (the #SpillCounter is partial once it is cancelled)
+ *
+ * @return 				#SpillCounter of #User and the number of commits they collaborated in (to be freed by the caller)
+ */
+SpillCounter getCounterOfUserWithCommitsAfter(Catalog catalog,Date startDate,Date endDate,CancelToken cancel) {
+    Ranking rollups[ROLLUP_LEVEL_NUM] = { NULL };
+#ifdef USE_USER_ROLLUPS
+    for (int level = 0; level < ROLLUP_LEVEL_NUM; level++)
+        rollups[level] = openRanking(catalog->paths[rollupFiles[level]]);
+#endif
+
+    SpillCounter users = makeSpillCounter(false);
+    countUserCommitsBetween(catalog, rollups, 0, getCompactedDate(startDate), getCompactedDate(endDate) + 1LL, users, cancel);
+    for (int level = 0; level < ROLLUP_LEVEL_NUM; level++)
+        freeRanking(rollups[level]);
+
     return users;
 }
 
 /**
- * @brief 			Gets the HashTable Of number of #Commit of a #User in of a given language.
+ * @brief 			Gets the id of a language of a #Catalog (see @ref getCatalogLanguage)
+ *
+ * @param catalog 	the given #Catalog
+ * @param lang 		the language (case insensitive)
+ *
+ * @return 			The id, -1 if there is no such language
+ */
+static int findLanguage(Catalog catalog, char* lang) {
+    char* dup=toLower(strdup(lang));
+    int ans = getDictionaryId(catalog->languages, dup);
+    free(dup);
+    return ans;
+}
+
+/**
+ * @brief 			Gets the position in repoCommits of the first commit of a repo made on or after a compacted date
+ *
+ * @param catalog 	the given #Catalog
+ * @param first 	the position of the first commit of the repo
+ * @param last 		the position after the last commit of the repo
+ * @param date 		the compacted date
+ *
+ * @return 			The position (last if every commit of the repo was made before the date)
+ */
+static int getRepoCommitsLowerBound(Catalog catalog, int first, int last, int date) {
+    int* rows = getColumn(catalog->repoCommits, 0);
+    int* dates = getColumn(catalog->commitColumns, COMMIT_DATE);
+    while (first < last) {
+        int m = first + (last - first) / 2;
+        if (dates[rows[m]] < date)
+            first = m + 1;
+        else
+            last = m;
+    }
+    return first;
+}
+
+/**
+ * @brief 			Gets the commits of a repo made in a range of compacted dates, as a range of positions of repoCommits
+ * 					(see @ref saveRepoZones). The repos whose commits all fall out of the range are pruned by their
+ * 					zone map, and the others narrowed down by a binary search of their commits
+ *
+ * @param catalog 	the given #Catalog
+ * @param id 		the id of the repo
+ * @param from 		the first compacted date of the range
+ * @param to 		the compacted date after the last of the range
+ * @param first 	set to the position of the first commit in the range
+ * @param last 		set to the position after the last commit in the range
  *
- * 					The hashtable has a type UserID:Number of commits they collaborated in of the given language.
+ * @return 			Whether the repo has commits in the range
+ */
+static bool getRepoCommitRange(Catalog catalog, int id, int from, int to, int* first, int* last) {
+    int* ids = getColumn(catalog->repoZones, REPO_ZONE_ID);
+    int l = 0, r = getColumnFileRows(catalog->repoZones);
+    while (l < r) {
+        int m = l + (r - l) / 2;
+        if (ids[m] < id)
+            l = m + 1;
+        else
+            r = m;
+    }
+
+    if (l == getColumnFileRows(catalog->repoZones) || ids[l] != id
+        || getColumn(catalog->repoZones, REPO_ZONE_MIN_DATE)[l] >= to || getColumn(catalog->repoZones, REPO_ZONE_MAX_DATE)[l] < from)
+        return false;
+
+    *first = getColumn(catalog->repoZones, REPO_ZONE_FIRST)[l];
+    *last = *first + getColumn(catalog->repoZones, REPO_ZONE_SIZE)[l];
+    if (getColumn(catalog->repoZones, REPO_ZONE_MIN_DATE)[l] < from)
+        *first = getRepoCommitsLowerBound(catalog, *first, *last, from);
+    if (getColumn(catalog->repoZones, REPO_ZONE_MAX_DATE)[l] >= to)
+        *last = getRepoCommitsLowerBound(catalog, *first, *last, to);
+    return *first < *last;
+}
+
+/**
+ * @brief 			Counts the #Commit of each #User in the repos of a language, joining its repos with their commits
+ * 					(read from the columns of the commits through repoCommits, so the commits are not decoded)
  *
  * @param catalog 	the #Catalog to find the commits in
- * @param lang 		the language to search by (case insensitive)
- * @param du 		the number of different users found
+ * @param repos 	the positions of the repos of the language in reposByLanguage
+ * @param repos_size the number of repos
+ * @param cancel 	the #CancelToken of the query (checked for each repo, the #Counter is partial once it is cancelled)
  *
- * @return 			GHashTable of #User and the number of #Commit they collaborated in of the given language.
+ * @return 			#Counter of #User and the number of #Commit they collaborated in of the language
  */
-GHashTable* getHashTableOfCommitsPerLanguage(Catalog catalog, char* lang, int*du) {
-    GHashTable* count = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, NULL);
-    char* dup=toLower(strdup(lang));
-    pos_t repos = getGroup(catalog->reposByLanguage, (pos_t)dup, catalog->cache);
-    int repos_size = getGroupSize(catalog->reposByLanguage, repos, catalog->cache);
+static Counter joinCommitsOfLanguage(Catalog catalog, pos_t* repos, int repos_size, CancelToken cancel) {
+    Counter count = makeCounter(0);
+    int* rows = getColumn(catalog->repoCommits, 0);
+    int* authors = getColumn(catalog->commitColumns, COMMIT_AUTHOR_ID);
+    int* committers = getColumn(catalog->commitColumns, COMMIT_COMMITTER_ID);
     Repo r = initRepo();
-    Commit c = initCommit();
-    Lazy repo = makeLazy(NULL, 0, catalog->cRepoFormat, r), commit = makeLazy(NULL, 0, catalog->cCommitFormat, c);
-    *du = 0;
-    for (int i = 0; i < repos_size; i++){
-        getGroupElemAsLazy(catalog->reposByLanguage, repos, i, catalog->cache, repo);
-		pos_t commits = getGroup(catalog->commitsByRepo, *(int*)getLazyMember(repo,CRID,catalog->cache), catalog->cache);
-		int N_commits=getGroupSize(catalog->commitsByRepo, commits, catalog->cache);
-		for (int j = 0; j < N_commits; j++){
-			getGroupElemAsLazy(catalog->commitsByRepo, commits, j, catalog->cache, commit);
-			int committer_id = *(int*)getLazyMember(commit,CCCOMMITTER_ID,catalog->cache);
-			int author_id = *(int*)getLazyMember(commit,CCAUTHOR_ID,catalog->cache);
-			increaseNumberInHashTableIfFound(count,GINT_TO_POINTER(committer_id),du);
-        	if (committer_id != author_id) increaseNumberInHashTableIfFound(count,GINT_TO_POINTER(author_id),du);
-		}
+    Lazy repo = makeLazy(NULL, 0, catalog->cRepoFormat, r);
+    for (int i = 0; i < repos_size && !isCancelled(cancel); i++){
+        getGroupElemAsLazy(catalog->reposByLanguage, repos[i], repo);
+        int first, last;
+        ADD_METRIC(METRIC_ROWS_SCANNED, 1);
+        if (!getRepoCommitRange(catalog, *(int*)getLazyMember(repo,CRID,catalog->cache), INT_MIN, INT_MAX, &first, &last))
+            continue;
+
+        ADD_METRIC(METRIC_ROWS_SCANNED, last - first);
+        for (int j = first; j < last; j++) {
+            int row = rows[j];
+            increaseCounter(count, authors[row], 1);
+            if (committers[row] != authors[row]) increaseCounter(count, committers[row], 1);
+        }
 	}
-    freeLazy(commit);
     freeLazy(repo);
-    free(dup);
-    free(c);
     free(r);
 	return count;
 }
 
 /**
- * @brief 			Gets the HashTable of Numbers Of repos Of A Language updated After a given date
+ * @brief 			Makes the plan of the commits of each #User in the repos of a language: a scan of every commit filtered
+ * 					by the language of its repo, stored in its columns, unless the language has so few repos that joining
+ * 					them with their commits costs less (see @ref PLAN_JOIN_SHARE)
+ *
+ * @param catalog 	the given #Catalog
+ * @param language 	the id of the language (-1 if there is no such language)
+ *
+ * @return NULL		If the commits are counted by the join instead (see @ref getCounterOfCommitsPerLanguage)
+ * @return 			The #Plan, whose result has type UserID : Number of commits (empty if there is no such language)
+ */
+static Plan planLanguageScan(Catalog catalog, int language) {
+    if (language == -1)
+        return makePlan(0, 0);
+
+#ifdef PLAN_JOIN_SHARE
+    int repos_size = getGroupSize(catalog->reposByLanguage, getGroup(catalog->reposByLanguage, (pos_t)language, catalog->cache),
+                                  catalog->cache);
+    if ((long)repos_size * PLAN_JOIN_SHARE < getElemNumber(catalog->reposById))
+        return NULL;
+#endif
+
+    Plan plan = makePlan(0, getColumnFileRows(catalog->commitColumns));
+    int* users[] = { getColumn(catalog->commitColumns, COMMIT_AUTHOR_ID), getColumn(catalog->commitColumns, COMMIT_COMMITTER_ID) };
+    addPlanFilter(plan, getColumn(catalog->commitColumns, COMMIT_LANGUAGE_ID), PLAN_EQ, language);
+    setPlanGroupBy(plan, users, 2, PLAN_COUNT, NULL);
+    return plan;
+}
+
+/**
+ * @brief 			Makes the plan of the commits of each #User in the repos of a language (see @ref runCatalogPlans), unless
+ * 					query 6 reads the ranking of the language instead (see @ref USE_LANGUAGE_RANKING)
+ *
+ * @param catalog 	the given #Catalog
+ * @param lang 		the language to search by (case insensitive)
+ *
+ * @return NULL		If the commits are not counted by a scan (see @ref planLanguageScan)
+ * @return 			The #Plan, whose result has type UserID : Number of commits (empty if there is no such language)
+ */
+Plan planCommitsPerLanguage(Catalog catalog, char* lang) {
+#ifdef USE_LANGUAGE_RANKING
+    return NULL;
+#else
+    return planLanguageScan(catalog, findLanguage(catalog, lang));
+#endif
+}
+
+/**
+ * @brief 			Gets the #Counter Of number of #Commit of a #User in of a given language.
+ *
+ * 					The #Counter has a type UserID:Number of commits they collaborated in of the given language.
+ *
+ * @param catalog 	the #Catalog to find the commits in
+ * @param lang 		the language to search by (case insensitive)
+ * @param du 		the number of different users found
+ * @param cancel 	the #CancelToken of the query (the #Counter is partial once it is cancelled)
+ *
+ * @return 			#Counter of #User and the number of #Commit they collaborated in of the given language.
+ */
+Counter getCounterOfCommitsPerLanguage(Catalog catalog, char* lang, int*du, CancelToken cancel) {
+    Counter count;
+    int language = findLanguage(catalog, lang);
+    Plan plan = planLanguageScan(catalog, language);
+    if (plan != NULL) {
+        runCatalogPlans(catalog, &plan, 1, cancel);
+        count = takePlanResult(plan);
+        freePlan(plan);
+    } else {
+        int repos_size;
+        pos_t* repos = getGroupElems(catalog->reposByLanguage, getGroup(catalog->reposByLanguage, (pos_t)language, catalog->cache),
+                                     &repos_size, catalog->cache);
+        count = joinCommitsOfLanguage(catalog, repos, repos_size, cancel);
+        free(repos);
+    }
+
+    *du = getCounterSize(count);
+    return count;
+}
+
+/**
+ * @brief 			Makes the plan of the commits to the repos of each language after a given date (see
+ * 					@ref runCatalogPlans): the date is pushed down to the range of @ref commitsByDate scanned, and the
+ * 					commits are grouped by the language of their repo, stored in their columns (so their repos are
+ * 					not looked up)
+ *
+ * @param catalog 	the given #Catalog
+ * @param startDate the date to lower bound of dates
+ *
+ * @return 			The #Plan, whose result has type language id (see @ref getCatalogLanguage) : Number of commits
+ */
+Plan planCommitsPerLanguageAfter(Catalog catalog, Date startDate) {
+    int* languages = getColumn(catalog->commitColumns, COMMIT_LANGUAGE_ID);
+    Plan plan = makePlan(getCommitsLowerBound(catalog, getCompactedDate(startDate)), getColumnFileRows(catalog->commitColumns));
+    addPlanFilter(plan, languages, PLAN_GE, 0);
+    setPlanGroupBy(plan, &languages, 1, PLAN_COUNT, NULL);
+    return plan;
+}
+
+/**
+ * @brief 			Gets the #Counter of the number of commits to the repos of each language after a given date
  *
- * 					the hashtable has type language:Number of appearences
+ * 					The #Counter has type language id (see @ref getCatalogLanguage) : Number of commits
  *
  * @param catalog 	the catalog to get the data from
  * @param startDate the date to lower bound of dates
- * @return 			GHashTable of languages and the number of repos using that language updated after a given date
- */
-GHashTable* getHashTableOfNumbersOfAperencesOfALanguageAfter(Catalog catalog,Date startDate){
-	GHashTable* languageCount = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, NULL);
-	pos_t date1=(pos_t)getCompactedDate(startDate); //imbed datas em pos_t
-    int N_commits = getElemNumber(catalog->commitsByDate);
-    Commit c = initCommit();
-	Repo r = initRepo();
-    Lazy commit = makeLazy(NULL, 0, catalog->cCommitFormat, c);
-	Lazy repo = makeLazy(NULL, 0, catalog->cRepoFormat, r);
-    for (int i = retrieveKeyLowerBound(catalog->commitsByDate, date1, catalog->cache); i < N_commits; i++){
-        retrieveValueAsLazy(catalog->commitsByDate, i, catalog->cache, commit);
-		if (getRepoById(catalog,*(int*)getLazyMember(commit,CCREPO_ID,catalog->cache),repo)) {
-            char* language = toLower(*(char**)getLazyMember(repo,CRLANGUAGE,catalog->cache));
-            gpointer searchResult = g_hash_table_lookup(languageCount,language);
-            if(searchResult != NULL) {
-                int newValue = GPOINTER_TO_INT(searchResult) + 1;
-                g_hash_table_insert(languageCount,language,GINT_TO_POINTER(newValue));
-            } else
-                g_hash_table_insert(languageCount,strdup(language),GINT_TO_POINTER(1));
-        }
-    }
-    freeLazy(commit);
-    freeLazy(repo);
-    free(c);
-	free(r);
-	return languageCount;
+ * @param cancel 	the #CancelToken of the query (the #Counter is partial once it is cancelled)
+ * @return 			#Counter of the ids of the languages and the number of commits to their repos after the given date
+ */
+Counter getCounterOfCommitsPerLanguageAfter(Catalog catalog,Date startDate,CancelToken cancel){
+    Plan plan = planCommitsPerLanguageAfter(catalog, startDate);
+    runCatalogPlans(catalog, &plan, 1, cancel);
+    Counter ans = takePlanResult(plan);
+    freePlan(plan);
+    return ans;
+}
+
+/**
+ * @brief 			Gets a language of a #Catalog by its id
+ *
+ * @param catalog 	the given #Catalog
+ * @param id 		the id of the language (see @ref getCounterOfCommitsPerLanguageAfter)
+ *
+ * @return 			The language in lower case (owned by the #Catalog), NULL if there is no language with the id
+ */
+char* getCatalogLanguage(Catalog catalog, int id){
+    return getDictionaryWord(catalog->languages, id);
+}
+
+/**
+ * @brief 			Gets the message of a commit of a #Catalog
+ *
+ * @param catalog 	the given #Catalog
+ * @param commit 	the position of the record of the commit (a value of commitsByDate or commitsByRepo)
+ *
+ * @return 			A copy of the message, NULL if it is empty
+ */
+char* getCatalogCommitMessage(Catalog catalog, pos_t commit){
+    //The records of the commits are of fixed size, so their position gives their number
+    pos_t size = getMemberOffset(catalog->cCommitFormat, getFormatMembers(catalog->cCommitFormat), NULL);
+    return getMessage(catalog->messages, (int)(commit / size));
+}
+
+/**
+ * @brief 			Gets the #ResultCache of a #Catalog, holding the results of the queries solved on its generation
+ *
+ * @param catalog 	the given #Catalog
+ *
+ * @return 			The #ResultCache (NULL if the #Catalog is still being built)
+ */
+ResultCache getCatalogResults(Catalog catalog){
+    return catalog->results;
 }
 
 /**
- * @brief 			Gets the HashTable of the number of #Commit in friends #Repo of each #User
+ * @brief 			Opens the ranking of the users by their number of commits to repos owned by a friend (answering query 9)
  *
- * 					The HashTable has type UserID:Number of commits in friends repos
+ * 					It has a single group, whose rows have type UserID : Number of commits in friends repos
  *
  * @param catalog 	the #Catalog to get the data from
  *
- * @return 			GHashTable of the number of #Commit in friends #Repo of each user
- */
-GHashTable* getHashTableOfCommitCountInReposOfFriends(Catalog catalog){
-	int differentUsers=0;
-    GHashTable* count = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, NULL);
-	int numberOfCommits=getCommitsCount(catalog);
-    Commit c = initCommit();
-    Lazy commit = makeLazy(NULL, 0, catalog->cCommitFormat, c);
-    for (int i=0;i<numberOfCommits;i++){
-		retrieveValueAsLazy(catalog->commitsByDate,i,catalog->cache,commit);
-		int author   = *(int*)getLazyMember(commit,CCAUTHOR_ID,catalog->cache);
-        int commiter = *(int*)getLazyMember(commit,CCCOMMITTER_ID,catalog->cache);
-		if (*(bool*)getLazyMember(commit,CCAUTHOR_FRIEND,catalog->cache))
-			increaseNumberInHashTableIfFound(count,GINT_TO_POINTER(author),&differentUsers);
-		if(commiter!=author && *(bool*)getLazyMember(commit,CCCOMMITTER_FRIEND,catalog->cache))
-			increaseNumberInHashTableIfFound(count,GINT_TO_POINTER(commiter),&differentUsers);
-	}
-    freeLazy(commit);
-    free(c);
-    return count;
+ * @return 			The #Ranking (NULL if it could not be opened), to be freed by the caller
+ */
+Ranking openFriendsCommitsRanking(Catalog catalog){
+    return openRanking(catalog->paths[FRIENDS_RANKING]);
 }
 
 /**
- * @brief 			Get the HashTable of the users and their maximum length commit message to a given repo (the one in position pos)
+ * @brief 			Opens the rankings of the collaborators of each repo by the length of their longest commit message to it
+ *                  (answering query 10)
+ *
+ * 					It has a group per repo, keyed by its id, whose rows have type UserID : the length of the biggest
+ * 					message of a commit the user collaborated in
  *
- * 					The HashTable has type UserID : the length of the biggest message of a commit the user collaborated in
+ * @param catalog 	the #Catalog to get the data from
  *
- * @param catalog 	the catalog to seatch the data in
- * @param pos 		the position of the repo in the catalog->repos
- * @param id 		the id of the repos in position pos
- * @return 			GHashTable of users and the length of their biggest message in a commit they collaborated in of a given repo
+ * @return 			The #Ranking (NULL if it could not be opened), to be freed by the caller
  */
-GHashTable* getHashTableOfLengthOfCommitsInArepoByRepoPositionInList(Catalog catalog,int pos,int*id){
-    //get list of commits foreach repo
-	GHashTable* UserbyCount=g_hash_table_new(g_direct_hash, g_direct_equal);
-    *id=(int)retrieveEmbeddedKey(catalog->commitsByRepo,pos,catalog->cache);
-	pos_t g = retrieveGroup(catalog->commitsByRepo,pos,catalog->cache);
-	int numberOfCommits=getGroupSize(catalog->commitsByRepo,g,catalog->cache);
-    Commit c = initCommit();
-    Lazy commit = makeLazy(NULL, 0, catalog->cCommitFormat, c);
-	for (int j=0;j<numberOfCommits;j++){
-    	getGroupElemAsLazy(catalog->commitsByRepo,g,j, catalog->cache,commit);
-		int messageLen   = *(int*)getLazyMember(commit,CCMESSAGE_LEN,catalog->cache);
-        int author_id    = *(int*)getLazyMember(commit,CCAUTHOR_ID,catalog->cache);
-        int committer_id = *(int*)getLazyMember(commit,CCCOMMITTER_ID,catalog->cache);
-		storeNumberInHashTableIfGreater(UserbyCount, GINT_TO_POINTER(author_id),messageLen);
-		if (committer_id!=author_id) storeNumberInHashTableIfGreater(UserbyCount, GINT_TO_POINTER(committer_id),messageLen);
-	}
-    freeLazy(commit);
-    free(c);
-	return UserbyCount;
+Ranking openMessageLengthRanking(Catalog catalog){
+    return openRanking(catalog->paths[MESSAGE_RANKING]);
+}
+
+/**
+ * @brief 			Opens the rankings of the users of each language by their number of commits to its repos (answering
+ *                  query 6)
+ *
+ * 					It has a group per language, keyed by its id (see @ref findLanguageRankingGroup), whose rows have type
+ * 					UserID : Number of commits
+ *
+ * @param catalog 	the #Catalog to get the data from
+ *
+ * @return 			The #Ranking (NULL if it could not be opened, or query 6 counts the commits instead), to be freed by
+ * 					the caller
+ */
+Ranking openLanguageRanking(Catalog catalog){
+#ifdef USE_LANGUAGE_RANKING
+    return openRanking(catalog->paths[LANGUAGE_RANKING]);
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * @brief 			Finds the group of a language in the rankings of the users of each language
+ *
+ * @param catalog 	the given #Catalog
+ * @param ranking 	the #Ranking (see @ref openLanguageRanking)
+ * @param lang 		the language to search by (case insensitive)
+ *
+ * @return 			The position of the group (-1 if there is no such language)
+ */
+int findLanguageRankingGroup(Catalog catalog, Ranking ranking, char* lang){
+    int language = findLanguage(catalog, lang);
+    if (language == -1)
+        return -1;
+
+    int group = findRankingGroup(ranking, language);
+    return group < getRankingGroups(ranking) && getRankingGroupKey(ranking, group) == language ? group : -1;
 }
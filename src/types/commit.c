@@ -36,7 +36,7 @@ struct commit {
  */
 void setCompressedCommitDate(Commit commit, int date) {
 	free(commit->commit_at);
-	commit->commit_at = getUncompactedDate(date);
+	commit->commit_at = getUncompactedDate(date, NULL);
 }
 
 /**
@@ -383,14 +383,11 @@ Format getCommitFormat() {
 Format getCompressedCommitFormat() {
     struct commit commit;
 
+    //The message is left out, so the records are of fixed size (the messages are stored apart, see #MessageFile)
     void* params[] = { &commit.repo_id, &commit.author_id,&commit.author_friend,
-	&commit.committer_id,&commit.committer_friend, &commit.commit_at,&commit.message_len, &commit.message };
+	&commit.committer_id,&commit.committer_friend, &commit.commit_at,&commit.message_len };
 
-    FormatType types[] = { BINARY_INT, BINARY_INT,BINARY_BOOL, BINARY_INT,BINARY_BOOL, BINARY_DATE_TIME,BINARY_INT, STRING_NULL};
-	PAIR *lists=malloc(getSizeOfPair());
-	addToPair(lists,0,CCMESSAGE,&commit.message_len);
+    FormatType types[] = { BINARY_INT, BINARY_INT,BINARY_BOOL, BINARY_INT,BINARY_BOOL, BINARY_DATE_TIME,BINARY_INT };
 
-	Format f=makeFormat(&commit, params, types, 8, sizeof(struct commit), lists, 1, '\0');
-	free(lists);
-	return f;
+	return makeFormat(&commit, params, types, 7, sizeof(struct commit), NULL, 0, '\0');
 }
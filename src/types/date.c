@@ -222,11 +222,12 @@ int dateCompare(Date d1, Date d2) {
  * @param length    The length of the string
  * @param date      The #Date  object to write to
  * @param time      Whether or not the string contains time information
+ * @param arena     The #Arena to allocate the #Date from (NULL to use malloc)
  * 
  * @return          Whether or not the operation was successful
  */
-bool readDate(char* str, int length, Date* date, bool time) {
-    Date d = (Date)malloc(sizeof(struct date));
+bool readDate(char* str, int length, Date* date, bool time, Arena arena) {
+    Date d = (Date)arenaAlloc(arena, sizeof(struct date));
     bool r = true;
     if (length != (time ? 19 : 10)) {
         r = false;
@@ -251,9 +252,10 @@ bool readDate(char* str, int length, Date* date, bool time) {
         }
     }
 
-    if (r) {
+    if (r)
         *date = d;
-    }
+    else
+        arenaFree(arena, d);
 
     return r;
 }
@@ -293,11 +295,12 @@ bool checkDate(char* str, int length) {
  * @brief       Converts a string into a #Date without validation checks
  *
  * @param str   The given string. The string is changed
+ * @param arena The #Arena to allocate the #Date from (NULL to use malloc)
  * 
  * @return      The converted #Date
  */
-Date unsafeDateFromString(char* str) {
-    Date date = (Date )malloc(sizeof(struct date));
+Date unsafeDateFromString(char* str, Arena arena) {
+    Date date = (Date )arenaAlloc(arena, sizeof(struct date));
     str[4]='\0';
     date->year   = atoi(str);
     str[7]='\0';
@@ -497,9 +500,10 @@ int getCompactedDate(Date date) {
  * @brief Get the Uncompacted Date
  *
  * @param c the int to umpack
+ * @param arena the #Arena to allocate the #Date from (NULL to use malloc)
  * @return the compacted date
  */
-Date getUncompactedDate(int c) {
+Date getUncompactedDate(int c, Arena arena) {
     /*
         The date is compacted to a 32-bit integer. 
         First 6 bits -> year (starting from 2005 -> 2005 counts as 0)
@@ -510,7 +514,7 @@ Date getUncompactedDate(int c) {
         Next 6 bits  -> seconds
     */
 
-    Date d = malloc(sizeof(struct date));
+    Date d = arenaAlloc(arena, sizeof(struct date));
 
     //We shift (>>) the binary representation of the compressed date so that the value we want to extract is at
     //the least significant bits. We then filter (&) all the unwanted bits (the ones to the left of the value)
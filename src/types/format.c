@@ -19,6 +19,11 @@
 #include "types/format.h"
 #include "utils/utils.h"
 
+/**
+ * @brief The number of ints of a binary list written at once by @ref printFormat
+ */
+#define FORMAT_LIST_CHUNK 256
+
 /**
  * @brief Internal storage of the pair. Can be requested with getListPair()
  */
@@ -44,6 +49,13 @@ struct format {
     int lists_no;				///< The length of lists
 
 	char separator;				///< The character to print between each member
+
+	bool offset_header;			///< Whether each record starts with its offset header (see @ref setFormatOffsetHeader)
+	int* segments;				/**< For each member (and the end of the record), the index of the last list before it
+									 (-1 if there is none). NULL if the #Format is not binary */
+	int* segment_offsets;		/**< For each member (and the end of the record), its offset from the end of the list of
+									 its segment (or of the start of the record). NULL if the #Format is not binary */
+	int references;				///< The number of holders of the #Format (see @ref copyFormat), which is freed by the last
 };
 
 
@@ -145,6 +157,34 @@ int elemStringSize(FormatType type) {
 	}
 }
 
+/**
+ * @brief 		Returns the size in bytes of a member of a ::FormatType in memory
+ *
+ * @param type 	The given ::FormatType
+ *
+ * @return 		The size of the member
+ */
+int typeSize(FormatType type) {
+	switch (type) {
+		case BOOL:
+		case BINARY_BOOL:
+			return sizeof(bool);
+		case TYPE:
+		case BINARY_TYPE:
+			return sizeof(Type);
+		case INT:
+		case BINARY_INT:
+			return sizeof(int);
+		case BINARY_DOUBLE:
+			return sizeof(double);
+		case INTLIST:
+		case BINARY_INTLIST:
+			return sizeof(int*);
+		default:
+			return sizeof(void*); //strings and dates
+	}
+}
+
 /**
  * @brief 			Reads the binary data from a string to the destination pointed to by dest
  *
@@ -152,8 +192,9 @@ int elemStringSize(FormatType type) {
  * @param str 		The member, as a string
  * @param str_len 	The length of the string
  * @param dest		The destination to write to
+ * @param arena 	The #Arena to allocate the member from, if needed (NULL to use malloc)
  */
-void readBinaryMember(FormatType type, char* str, int str_len, void* dest) {
+void readBinaryMember(FormatType type, char* str, int str_len, void* dest, Arena arena) {
 	switch (type) {
 		case BINARY_BOOL:
 			*(bool*)dest = (int)str[0];
@@ -172,16 +213,16 @@ void readBinaryMember(FormatType type, char* str, int str_len, void* dest) {
 			if (str_len == 0)
 				*(char**)dest = NULL;
 			else {
-				*(char**)dest = malloc(str_len + 1);
+				*(char**)dest = arenaAlloc(arena, str_len + 1);
 				strncpy(*(char**)dest, str, str_len);
 				(*(char**)dest)[str_len] = '\0';
 			}
 			break;
 		case BINARY_INTLIST:
-			*(int**)dest = BinaryStringTointList(str,str_len/sizeof(int));
+			*(int**)dest = BinaryStringTointList(str,str_len/sizeof(int),arena);
 			break;
 		case BINARY_DATE_TIME:
-			*(Date*)dest = getUncompactedDate(readIntFromBinaryString(str));
+			*(Date*)dest = getUncompactedDate(readIntFromBinaryString(str), arena);
 			break;
 		default:
 			fprintf(stderr,"readBinaryMember: binary data type %d not recognized\n", type);
@@ -206,7 +247,7 @@ void writeBinaryMember(FormatType type, void* src, char* dest, int dest_len) {
 			dest[0] = (char)*(Type*)src;
 			break;
 		case BINARY_INT:
-			writeIntToBinaryString(dest, *(int*)dest);
+			writeIntToBinaryString(dest, *(int*)src);
 			break;
 		case STRING_NULL:
 		case STRING:
@@ -276,6 +317,9 @@ Format makeFormat(void* sample, void** params, FormatType *types, int params_len
 	f->lists = (INTERNAL_PAIR*)malloc(lists_no * sizeof(INTERNAL_PAIR));
 	f->lists_no = lists_no;
 	f->separator = separator;
+	f->offset_header = false;
+	f->segments = f->segment_offsets = NULL;
+	f->references = 1;
 
 	for (int i = 0; i < f->members; i++) {
 		f->types[i] = types[i];
@@ -310,32 +354,110 @@ Format makeFormat(void* sample, void** params, FormatType *types, int params_len
 		return NULL;
 	}
 
+	if (isBinary(f)) {
+		//The members before the first list are at fixed offsets, the others at fixed offsets from the end of a list
+		f->segments = malloc((f->members + 1) * sizeof(int));
+		f->segment_offsets = malloc((f->members + 1) * sizeof(int));
+
+		int segment = -1, offset = 0;
+		for (int i = 0; i <= f->members; i++) {
+			f->segments[i] = segment;
+			f->segment_offsets[i] = offset;
+
+			if (i < f->members && stringSize(f->types[i]) == 0) {
+				segment++;
+				offset = 0;
+			} else if (i < f->members)
+				offset += stringSize(f->types[i]);
+		}
+	}
+
 	return f;
 }
 
 /**
  * @brief Copies a format
  *
+ * 		  A #Format is never changed once it is in use, so the copy shares it (counting its holders), which makes copying
+ * 		  (as done by every #Lazy) free
+ *
  * @param f The format to copy
  * @return 	The copy of the format. Must be freed independently of f
  */
 Format copyFormat(Format f)
 {
-	Format ans = malloc(sizeof(struct format));
-	ans->size = f->size;
-	ans->members = f->members;
-	ans->lists_no = f->lists_no;
-	ans->separator = f->separator;
+	__atomic_add_fetch(&f->references, 1, __ATOMIC_RELAXED);
+	return f;
+}
+
+/**
+ * @brief 			Makes the records of a binary #Format start with an offset header: the offset (from the start of the
+ * 					record) of the end of each list, written by @ref printFormat. Any member can then be found from the
+ * 					header alone (see @ref getMemberOffset), instead of from the lengths of every list before it
+ *
+ * @param f 		The given #Format
+ *
+ * @return 			Whether or not the header was added (only binary formats may have it)
+ */
+bool setFormatOffsetHeader(Format f)
+{
+	if (!isBinary(f)) {
+		fprintf(stderr, "setFormatOffsetHeader: format must be binary\n");
+		return false;
+	}
+
+	f->offset_header = true;
+	return true;
+}
 
-	ans->types = malloc(ans->members * sizeof(FormatType));
-	ans->displacements = malloc(ans->members * sizeof(ptrdiff_t));
-	ans->lists = malloc(ans->lists_no * sizeof(INTERNAL_PAIR));
+/**
+ * @brief 			Checks whether or not the records of a #Format start with an offset header
+ *
+ * @param f 		The given #Format
+ *
+ * @return 			Whether the #Format has an offset header
+ */
+bool hasOffsetHeader(Format f) {
+	return f->offset_header;
+}
+
+/**
+ * @brief 			Gets the size of the offset header of the records of a #Format
+ *
+ * @param f 		The given #Format
+ *
+ * @return 			The size of header, in bytes (0 if it has none)
+ */
+int getOffsetHeaderSize(Format f) {
+	return f->offset_header ? f->lists_no * (int)sizeof(int) : 0;
+}
 
-	memcpy(ans->types, f->types, ans->members * sizeof(FormatType));
-	memcpy(ans->displacements, f->displacements, ans->members * sizeof(ptrdiff_t));
-	memcpy(ans->lists, f->lists, ans->lists_no * sizeof(INTERNAL_PAIR));
+/**
+ * @brief 			Checks whether or not a member of a binary #Format is at a fixed offset of every record (it comes
+ * 					before every list)
+ *
+ * @param f 		The given #Format
+ * @param member 	The index of the member
+ *
+ * @return 			Whether or not the offset of the member is fixed (see @ref getMemberOffset)
+ */
+bool isFixedMember(Format f, int member) {
+	return f->segments[member] == -1;
+}
 
-	return ans;
+/**
+ * @brief 			Gets the offset of a member of a record of a binary #Format, which either has an offset header or
+ * 					comes before every list (see @ref isFixedMember)
+ *
+ * @param f 		The given #Format
+ * @param member 	The index of the member (the number of members for the end of the record)
+ * @param list_ends The offsets read from the header of the record (unused for fixed members)
+ *
+ * @return 			The offset of the member from the start of the record
+ */
+int getMemberOffset(Format f, int member, int* list_ends) {
+	int segment = f->segments[member];
+	return (segment == -1 ? getOffsetHeaderSize(f) : list_ends[segment]) + f->segment_offsets[member];
 }
 
 /**
@@ -452,9 +574,10 @@ void freeMember(Format format, void* obj, int member_index) {
  * @param format    The #Format of the struct
  * @param dest    	The object whose members are to be freed
  * @param members 	The number of members to free
+ * @param arena 	The #Arena the members were allocated from (nothing is freed), or NULL if they were allocated with malloc
  */
-void partialFree(Format format, void* dest, int members) {
-	for (int i = 0; i < members; i++)
+void partialFree(Format format, void* dest, int members, Arena arena) {
+	for (int i = 0; arena == NULL && i < members; i++)
 		freeMember(format, dest, i);
 }
 
@@ -560,12 +683,13 @@ bool checkFormat(Format f, char* str) {
  *
  * @return  			Whether or not the conversion was successful
  */
-bool readFormat(Format f, char* str, void* dest) {
+bool readFormat(Format f, char* str, void* dest, Arena arena) {
 
 	bool is_last = false, binary = isBinary(f);
 	int aux_list_sizes[f->members], temp_length, list_index = 0;
 	char *temp, separators[2] = "";
 	separators[0] = f->separator;
+	str += getOffsetHeaderSize(f);
 
 	for (int i = 0; i < f->members; i++) {
 		is_last = i == f->members - 1;
@@ -583,24 +707,24 @@ bool readFormat(Format f, char* str, void* dest) {
 		}
 
 		if (!binary && is_last != !str) { //untimely end of line
-			partialFree(f, dest, i);
+			partialFree(f, dest, i, arena);
 			return false;
 		}
 
 		switch (f->types[i]) {
 			case INT:
 			if (!safeStringToInt(temp, temp_length, (int*)getMember(f, dest, i))) {
-				partialFree(f, dest, i);
+				partialFree(f, dest, i, arena);
 				return false;
 			}
 			break;
 
 			case STRING:
 			if (temp_length == 0) {
-				partialFree(f, dest, i);
+				partialFree(f, dest, i, arena);
 				return false;
 			}
-			*(char**)getMember(f, dest, i)=malloc(temp_length + 1);
+			*(char**)getMember(f, dest, i)=arenaAlloc(arena, temp_length + 1);
 			strncpy(*(char**)getMember(f, dest, i),temp,temp_length);
 			(*(char**)getMember(f, dest, i))[temp_length] = '\0';
 			aux_list_sizes[i] = temp_length;
@@ -610,7 +734,7 @@ bool readFormat(Format f, char* str, void* dest) {
 			if (temp_length == 0)
 				*(char**)getMember(f, dest, i)=NULL;
 			else {
-				*(char**)getMember(f, dest, i)=malloc(temp_length + 1);
+				*(char**)getMember(f, dest, i)=arenaAlloc(arena, temp_length + 1);
 				strncpy(*(char**)getMember(f, dest, i), temp, temp_length);
 				(*(char**)getMember(f, dest, i))[temp_length] = '\0';
 			}
@@ -618,36 +742,36 @@ bool readFormat(Format f, char* str, void* dest) {
 			break;
 
 			case INTLIST:
-			if (!readIdList(temp, temp_length, (int**)getMember(f, dest, i), &aux_list_sizes[i])) {
-				partialFree(f, dest, i);
+			if (!readIdList(temp, temp_length, (int**)getMember(f, dest, i), &aux_list_sizes[i], arena)) {
+				partialFree(f, dest, i, arena);
 				return false;
 			}
 			break;
 
 			case TYPE:
 			if (!checkType(temp, temp_length, (Type*)getMember(f, dest, i))) {
-				partialFree(f, dest, i);
+				partialFree(f, dest, i, arena);
 				return false;
 			}
 			break;
 
 			case DATE:
 			case DATE_TIME:
-			if (!readDate(temp, temp_length, (Date *)getMember(f, dest, i),f->types[i] == DATE_TIME)) {
-				partialFree(f, dest, i);
+			if (!readDate(temp, temp_length, (Date *)getMember(f, dest, i),f->types[i] == DATE_TIME, arena)) {
+				partialFree(f, dest, i, arena);
 				return false;
 			}
 			break;
 
 			case BOOL:
 			if (!checkBool(temp, temp_length, (bool*)getMember(f, dest, i))) {
-				partialFree(f, dest, i);
+				partialFree(f, dest, i, arena);
 				return false;
 			}
 			break;
 			default:
 			fprintf(stderr, "readFormat: Invalid format type %d\n", f->types[i]);
-			partialFree(f, dest, i);
+			partialFree(f, dest, i, arena);
 			return false;
 		}
 	}
@@ -656,7 +780,7 @@ bool readFormat(Format f, char* str, void* dest) {
 		if (f->lists[i].length_member == -1)
 			*(int*)(dest + f->lists[i].length_displacement) = aux_list_sizes[f->lists[i].list_member];
 		else if (aux_list_sizes[f->lists[i].list_member] != *(int*)getMember(f, dest, f->lists[i].length_member)){
-			partialFree(f, dest, f->members);
+			partialFree(f, dest, f->members, arena);
 			return false;
 		}
 	}
@@ -676,12 +800,15 @@ bool readFormat(Format f, char* str, void* dest) {
  * 						the format is assumed to be binary (ie the size of each member is either determined,
  * 						stringSize() != 0, or specified beforehand)
  * @param dest  		An address to the destination object. Must be of the correct type for the format
+ * @param arena 		The #Arena to allocate the members from (NULL to use malloc). Must then be reset instead of
+ * 						calling @ref freeFormat
  */
-void unsafeReadFormat(Format f, char* str, void* dest) {
+void unsafeReadFormat(Format f, char* str, void* dest, Arena arena) {
 	int temp_length, aux_list_sizes[f->members], list_index = 0;
 	bool binary = isBinary(f);
 	char *temp, separators[2] = "";
 	separators[0] = f->separator;
+	str += getOffsetHeaderSize(f);
 
 	for (int i = 0; i < f->members; i++) {
 		if (binary) {
@@ -702,13 +829,13 @@ void unsafeReadFormat(Format f, char* str, void* dest) {
 				*(int *)getMember(f, dest, i) = atoi(temp);
 				break;
 			case INTLIST:
-            	*(int**)getMember(f, dest, i) = unsafeReadIdList(temp, temp_length, &aux_list_sizes[i]);
+            	*(int**)getMember(f, dest, i) = unsafeReadIdList(temp, temp_length, &aux_list_sizes[i], arena);
 				break;
 			case TYPE:
 				checkType(temp, temp_length, (Type*)getMember(f, dest, i));
 				break;
 			case DATE_TIME:
-				*(Date *)getMember(f, dest, i) = unsafeDateFromString(temp);
+				*(Date *)getMember(f, dest, i) = unsafeDateFromString(temp, arena);
 				break;
 			case BOOL:
 				checkBool(temp, temp_length, (bool*)getMember(f, dest, i));
@@ -721,7 +848,7 @@ void unsafeReadFormat(Format f, char* str, void* dest) {
 			case BINARY_BOOL:
 			case STRING_NULL:
 			case STRING:
-				readBinaryMember(f->types[i],temp,temp_length,getMember(f, dest, i));
+				readBinaryMember(f->types[i],temp,temp_length,getMember(f, dest, i),arena);
 				break;
 			default:
 			fprintf(stderr, "Not implemented\n");
@@ -749,6 +876,18 @@ void printFormat(Format f, void* src, FILE* dest) {
 	for (int i = 0; i < f->lists_no; i++)
 		aux_list_sizes[f->lists[i].list_member] = *(int*)(src + f->lists[i].length_displacement);
 
+	if (f->offset_header) {
+		char header[getOffsetHeaderSize(f) + 1];
+		int offset = getOffsetHeaderSize(f), list_index = 0;
+		for (int i = 0; i < f->members; i++) {
+			int size = stringSize(f->types[i]);
+			offset += size != 0 ? size : aux_list_sizes[i] * elemStringSize(f->types[i]);
+			if (size == 0)
+				writeIntToBinaryString(header + sizeof(int) * list_index++, offset);
+		}
+		fwrite(header, sizeof(char), getOffsetHeaderSize(f), dest);
+	}
+
 	for (int i = 0; i < f->members; i++) {
 		switch (f->types[i]) {
 			case INT:
@@ -797,10 +936,15 @@ void printFormat(Format f, void* src, FILE* dest) {
 				fwrite(sbid,sizeof(char),sizeof(double),dest);
 				break;
 			case BINARY_INTLIST:;
-				char*sbil = NULL;
-				IntListToBinaryString(&sbil, aux_list_sizes[i],*(int**)getMember(f, src, i));
-				fwrite(sbil,sizeof(char),4*aux_list_sizes[i],dest);
-				free(sbil);
+				//Written through a buffer on the stack, in pieces of FORMAT_LIST_CHUNK ints
+				char sbil[FORMAT_LIST_CHUNK * sizeof(int)];
+				int* list = *(int**)getMember(f, src, i);
+				for (int k = 0; k < aux_list_sizes[i]; k += FORMAT_LIST_CHUNK) {
+					int n = MIN(FORMAT_LIST_CHUNK, aux_list_sizes[i] - k);
+					char* p = sbil;
+					IntListToBinaryString(&p, n, list + k);
+					fwrite(sbil,sizeof(char),sizeof(int)*n,dest);
+				}
 				break;
 			case BINARY_DATE_TIME:;
 				char sbdt[sizeof(int)];
@@ -825,18 +969,23 @@ void printFormat(Format f, void* src, FILE* dest) {
  * @param obj		The formatted object
  */
 void freeFormat(Format format, void* obj) {
-	partialFree(format, obj, format->members);
+	partialFree(format, obj, format->members, NULL);
 }
 
 
 /**
- * @brief Frees the memory allocated to a #Format
+ * @brief Frees the memory allocated to a #Format, once every copy of it was disposed (see @ref copyFormat)
  *
  * @param format	The #Format to be disposed
  */
 void disposeFormat(Format format) {
+	if (__atomic_sub_fetch(&format->references, 1, __ATOMIC_ACQ_REL) > 0)
+		return;
+
 	free(format->types);
 	free(format->displacements);
 	free(format->lists);
+	free(format->segments);
+	free(format->segment_offsets);
 	free(format);
 }
@@ -11,6 +11,7 @@
 #include "io/cache.h"
 #include "types/format.h"
 #include "types/lazy.h"
+#include "utils/metrics.h"
 
 /**
  * @brief A type which serves as a wrapper for the access of a formatted object in a file
@@ -28,6 +29,8 @@ struct lazy {
                         the position after the end of the object*/
     int string_pos_it;  ///< The last calculated string_pos
     int list_index;     ///< The index of the last read list
+    int* list_ends;     ///< The offset header of the record, if the #Format has one (see @ref setFormatOffsetHeader)
+    bool header_loaded; ///< Whether list_ends was read from the record
 };
 
 /**
@@ -57,6 +60,8 @@ Lazy makeLazy(FILE* file, pos_t pos, Format format, void* obj) {
     l->string_pos[0] = pos;
     l->string_pos_it = 0;
     l->list_index = 0;
+    l->list_ends = malloc(getOffsetHeaderSize(l->format) + sizeof(int));
+    l->header_loaded = false;
     return l;
 }
 
@@ -80,6 +85,37 @@ void loadStringPos(Lazy l, int pos, Cache c) {
     }
 }
 
+/**
+ * @brief       Gets the position of a member of the object in the file. The members before every list are at fixed
+ *              positions; with an offset header, the others are read from the header (read once per record); otherwise,
+ *              the positions of the members before it are calculated
+ *
+ * @param l         The given #Lazy
+ * @param member    The index of the member (the number of members for the position after the object)
+ * @param c         The #Cache
+ *
+ * @return          The position of the member
+ */
+static pos_t getMemberPos(Lazy l, int member, Cache c) {
+    if (isFixedMember(l->format, member))
+        return l->pos + getMemberOffset(l->format, member, NULL);
+
+    if (!hasOffsetHeader(l->format)) {
+        loadStringPos(l, member, c);
+        return l->string_pos[member];
+    }
+
+    if (!l->header_loaded) {
+        int size = getOffsetHeaderSize(l->format);
+        char header[size + 1];
+        getStr(c, l->file, l->pos, header, size);
+        for (int i = 0; i * (int)sizeof(int) < size; i++)
+            l->list_ends[i] = readIntFromBinaryString(header + i * sizeof(int));
+        l->header_loaded = true;
+    }
+    return l->pos + getMemberOffset(l->format, member, l->list_ends);
+}
+
 /**
  * @brief           Gets the requested member of the object
  *
@@ -91,8 +127,8 @@ void loadStringPos(Lazy l, int pos, Cache c) {
  */
 void* getLazyMember(Lazy l, int member, Cache c) {
     if (!l->loaded[member]) {
-        loadStringPos(l, member + 1, c);
-        int length = l->string_pos[member + 1] - l->string_pos[member];
+        pos_t start = getMemberPos(l, member, c);
+        int length = getMemberPos(l, member + 1, c) - start;
         int stack_length = length > 1000 ? 0 : length;
         char stack_buffer[stack_length];
         char* buffer;
@@ -102,10 +138,11 @@ void* getLazyMember(Lazy l, int member, Cache c) {
         else
             buffer = stack_buffer;
 
-        getStr(c, l->file, l->string_pos[member], buffer, length);
+        getStr(c, l->file, start, buffer, length);
 
-        readBinaryMember(getMemberType(l->format, member), buffer, length, getMember(l->format, l->obj, member));
+        readBinaryMember(getMemberType(l->format, member), buffer, length, getMember(l->format, l->obj, member), NULL);
         l->loaded[member] = true;
+        ADD_METRIC(METRIC_LAZY_DECODES, 1);
 
         if (length > 1000)
             free(buffer);
@@ -139,8 +176,7 @@ void* setLazyMember(Lazy l, int member)
  * @return          The position of the requested member in the file
  */
 pos_t getPosOfLazyMember(Lazy l, int member, Cache c) {
-    loadStringPos(l, member, c);
-    return l->string_pos[member];
+    return getMemberPos(l, member, c);
 }
 
 /**
@@ -164,20 +200,13 @@ pos_t getPosAfterLazy(Lazy l, Cache c) {
  */
 void printLazyToFile(Lazy l, Cache c)
 {
-    int list_index = -1;
-
     for (int i = 0; i < getFormatMembers(l->format); i++)
     {
         if (l->altered[i])
         {
             FormatType t = getMemberType(l->format, i);
-            int length = stringSize(t);
-            
-            if (length == 0) {
-                while (getListPairListMember(l->format, list_index) < i)
-                    list_index++;
-                length = *(int*)getLazyMember(l, getListPairLengthMember(l->format, list_index), c) * elemStringSize(t);
-            }
+            pos_t start = getMemberPos(l, i, c);
+            int length = getMemberPos(l, i + 1, c) - start;
 
             int stack_length = length > 1000 ? 0 : length;
             char stack_buffer[stack_length];
@@ -189,7 +218,7 @@ void printLazyToFile(Lazy l, Cache c)
                 buffer = stack_buffer;
 
             writeBinaryMember(t, getMember(l->format, l->obj, i), buffer, length);
-            setStr(c, l->file, l->string_pos[i], buffer, length);
+            setStr(c, l->file, start, buffer, length);
 
             if (length > 1000)
                 free(buffer);
@@ -237,6 +266,7 @@ void setLazyAddress(Lazy l, FILE* file, pos_t pos)
     l->string_pos[0] = pos;
     l->string_pos_it = 0;
     l->list_index = 0;
+    l->header_loaded = false;
 }
 
 /**
@@ -254,5 +284,6 @@ void freeLazy(Lazy l)
     free(l->loaded);
     free(l->altered);
     free(l->string_pos);
+    free(l->list_ends);
     free(l);
 }
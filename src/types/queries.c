@@ -6,12 +6,16 @@
  * The #Query type is used to represent a query regarding the dataset
  */
 
+#include <ctype.h>
+#include <stdio.h>
 #include <string.h>
 
+#include "io/resultCache.h"
 #include "types/catalog.h"
 #include "types/date.h"
 #include "types/format.h"
 #include "types/queries.h"
+#include "utils/metrics.h"
 #include "utils/querySolver.h"
 #include "utils/utils.h"
 
@@ -26,6 +30,39 @@
  */
 #define MAX_QUERY_ARGS 10
 
+/**
+ * @brief Answer the queries from the #ResultCache of the #Catalog when they were solved before on it.
+ *        Comment out to always solve them
+ */
+#define QUERY_RESULT_CACHE
+
+/**
+ * @brief The first query whose results are cached (the ones before are read from the answers of the static queries)
+ */
+#define QUERY_CACHE_MIN_ID 5
+
+/**
+ * @brief The types of the parameters of each query, indexed by its id
+ */
+static FormatType queryParameterTypes[QUERY_COUNT][QUERY_COUNT] = {
+    {},
+    {},
+    {},
+    {},
+    {},
+    {INT, DATE, DATE},
+    {INT, STRING},
+    {DATE},
+    {INT, DATE},
+    {INT},
+    {INT},
+};
+
+/**
+ * @brief The number of parameters of each query, indexed by its id
+ */
+static int queryParameterCount[QUERY_COUNT] = {0,0,0,0,0,3,2,1,2,1,1};
+
 /**
  * @brief Struct used to store a query regarding the dataset
  * 
@@ -88,13 +125,14 @@ Query createQueryId(int id) {
 }
 
 /**
- * @brief           Executes a given #Query, storing its output to a file
+ * @brief           Solves a given #Query, storing its output to a file
  * 
  * @param stream    The file to output to
- * @param query     The #Query to be executed
+ * @param query     The #Query to be solved
  * @param catalog   The catalog containing the dataset
+ * @param cancel    The #CancelToken of the #Query
  */
-void executeQuery( FILE* stream,Query query,Catalog catalog) {
+static void solveQuery(FILE* stream, Query query, Catalog catalog, CancelToken cancel) {
     //We are disabling this warning because we are only interested in reading the first 32bits of a void* to cast them to int
     //This is intended behaviour, so we are NOT LOSING INFORMATION casting from a 64 bit to a 32 bit type, as the most significant 32 bits
     //are meaningless
@@ -118,22 +156,22 @@ void executeQuery( FILE* stream,Query query,Catalog catalog) {
             fprintf(stream, "%.2f\n", queryFour(catalog));
             break;
         case 5:
-            queryFive(catalog, (int)(query->params[0]), (Date )query->params[1], (Date )query->params[2], stream);
+            queryFive(catalog, (int)(query->params[0]), (Date )query->params[1], (Date )query->params[2], stream, cancel);
             break;
         case 6:
-            querySix(catalog, (int)(query->params[0]), (char*)(query->params[1]), stream);
+            querySix(catalog, (int)(query->params[0]), (char*)(query->params[1]), stream, cancel);
             break;
         case 7:
-            querySeven(catalog, (Date )query->params[0], stream);
+            querySeven(catalog, (Date )query->params[0], stream, cancel);
             break;
         case 8:
-            queryEight(catalog, (int)query->params[0], (Date )query->params[1], stream);
+            queryEight(catalog, (int)query->params[0], (Date )query->params[1], stream, cancel);
             break;
         case 9:
             queryNine(catalog, (int)query->params[0], stream);
             break;
         case 10:
-            queryTen(catalog, (int)query->params[0], stream);
+            queryTen(catalog, (int)query->params[0], stream, cancel);
             break;
         default:
             fprintf(stderr, "executeQuery: not supported id: %d\n", query->id);
@@ -143,7 +181,244 @@ void executeQuery( FILE* stream,Query query,Catalog catalog) {
     #pragma GCC diagnostic pop
 }
 
+/**
+ * @brief       Gets the normalized text of a #Query (the key of its result in the #ResultCache): its id followed
+ *              by its parameters, with the dates reduced to the day and the strings in lower case
+ * 
+ * @param query The given #Query
+ * 
+ * @return      The text (to be freed)
+ */
+char* getQueryKey(Query query) {
+    char* key;
+    size_t size;
+    FILE* stream = open_memstream(&key, &size);
+    fprintf(stream, "%d", query->id);
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpointer-to-int-cast"
+
+    for (int i = 0; query->id > 0 && query->id < QUERY_COUNT && i < queryParameterCount[query->id]; i++) {
+        switch (queryParameterTypes[query->id][i]) {
+            case INT:
+                fprintf(stream, " %d", (int)query->params[i]);
+                break;
+            case DATE: {
+                Date d = (Date)query->params[i];
+                fprintf(stream, " %04d-%02d-%02d", getDateYear(d), getDateMonth(d), getDateDay(d));
+                break;
+            }
+            default:
+                fputc(' ', stream);
+                for (char* c = (char*)query->params[i]; *c; c++)
+                    fputc(*c == '\n' ? ' ' : tolower((unsigned char)*c), stream);
+                break;
+        }
+    }
+
+    #pragma GCC diagnostic pop
+
+    fclose(stream);
+    return key;
+}
+
+/**
+ * @brief           Runs a given #Query, storing its output to a file (see @ref executeQuery)
+ * 
+ *                  The results of the queries in the #ResultCache of the #Catalog are written straight away; the
+ *                  others are solved and stored there (see @ref QUERY_RESULT_CACHE)
+ * 
+ *                  A cancelled #Query stops at its next check, leaving its output incomplete (and out of the
+ *                  #ResultCache)
+ * 
+ * @param stream    The file to output to
+ * @param query     The #Query to be executed
+ * @param catalog   The catalog containing the dataset
+ * @param cancel    The #CancelToken of the #Query (NULL if it is never cancelled)
+ */
+static void runQuery(FILE* stream, Query query, Catalog catalog, CancelToken cancel) {
+#ifdef QUERY_RESULT_CACHE
+    ResultCache results = getCatalogResults(catalog);
+    if (results == NULL || query->id < QUERY_CACHE_MIN_ID || query->id >= QUERY_COUNT) {
+        solveQuery(stream, query, catalog, cancel);
+        return;
+    }
+
+    char* key = getQueryKey(query);
+    size_t size;
+    char* result = getResult(results, key, &size);
+
+    if (result == NULL) {
+        FILE* buffer = open_memstream(&result, &size);
+        solveQuery(buffer, query, catalog, cancel);
+        fclose(buffer);
+        if (!isCancelled(cancel))
+            putResult(results, key, result, size);
+    }
+
+    fwrite(result, 1, size, stream);
+    free(result);
+    free(key);
+#else
+    solveQuery(stream, query, catalog, cancel);
+#endif
+}
+
+/**
+ * @brief           Executes a given #Query, storing its output to a file, and profiles it (see @ref QUERYPROFILE)
+ * 
+ * @param stream    The file to output to
+ * @param query     The #Query to be executed
+ * @param catalog   The catalog containing the dataset
+ * @param cancel    The #CancelToken of the #Query (NULL if it is never cancelled)
+ */
+void executeQuery(FILE* stream, Query query, Catalog catalog, CancelToken cancel) {
+    QUERYPROFILE profile;
+    beginQueryProfile(&profile, query->id);
+    runQuery(stream, query, catalog, cancel);
+    endQueryProfile(&profile);
+}
+
+/**
+ * @brief           Solves at once the queries of a batch whose plans scan the columns of the commits (6 and 8, see
+ *                  @ref runCatalogPlans), sharing a single scan between them, and stores their results in the
+ *                  #ResultCache of the #Catalog, so executing them (see @ref executeQuery) then only writes them
+ *
+ *                  The queries already cached, repeated in the batch or answered from an index instead are left to
+ *                  @ref executeQuery, as are all of them when fewer than two could share the scan
+ *
+ * @param queries   The queries of the batch
+ * @param n         The number of queries
+ * @param catalog   The catalog containing the dataset
+ */
+void shareQueryScans(Query* queries, int n, Catalog catalog) {
+#ifdef QUERY_RESULT_CACHE
+    ResultCache results = getCatalogResults(catalog);
+    if (results == NULL)
+        return;
+
+    Plan* plans = malloc(MAX(n, 1) * sizeof(Plan));
+    Query* planned = malloc(MAX(n, 1) * sizeof(Query));
+    char** keys = malloc(MAX(n, 1) * sizeof(char*));
+    int m = 0;
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpointer-to-int-cast"
+
+    for (int i = 0; i < n; i++) {
+        Query query = queries[i];
+        if (query->id != 6 && query->id != 8)
+            continue;
+
+        char* key = getQueryKey(query);
+        size_t size;
+        char* result = getResult(results, key, &size);
+        bool repeated = false;
+        for (int k = 0; k < m && !repeated; k++)
+            repeated = strcmp(keys[k], key) == 0;
+
+        Plan plan = NULL;
+        if (result == NULL && !repeated)
+            plan = query->id == 6 ? planCommitsPerLanguage(catalog, (char*)query->params[1])
+                                  : planCommitsPerLanguageAfter(catalog, (Date)query->params[1]);
+        free(result);
+        if (plan == NULL) {
+            free(key);
+            continue;
+        }
+
+        plans[m] = plan;
+        planned[m] = query;
+        keys[m++] = key;
+    }
+
+    #pragma GCC diagnostic pop
+
+    if (m > 1) {
+        runCatalogPlans(catalog, plans, m, NULL);
+        for (int k = 0; k < m; k++) {
+            Counter counter = takePlanResult(plans[k]);
+            char* result;
+            size_t size;
+            FILE* buffer = open_memstream(&result, &size);
+            if (planned[k]->id == 6)
+                printTopUsers(catalog, counter, getQueryLimit(planned[k]), buffer);
+            else
+                printTopLanguages(catalog, counter, getQueryLimit(planned[k]), buffer);
+            fclose(buffer);
+
+            putResult(results, keys[k], result, size);
+            free(result);
+            freeCounter(counter);
+        }
+    }
+
+    for (int k = 0; k < m; k++) {
+        freePlan(plans[k]);
+        free(keys[k]);
+    }
+    free(keys);
+    free(planned);
+    free(plans);
+#endif
+}
+
+/**
+ * @brief           Executes a given #Query on a shard of the dataset, storing the partial aggregate the coordinator of the
+ *                  shards merges with those of the other shards (see @ref answerScatteredQuery), and profiles it
+ * 
+ *                  The partial aggregates are never cached (the coordinator caches nothing either)
+ * 
+ * | Id            | Partial aggregate                                                                            |
+ * | :---:         | :-----------:                                                                                |
+ * |  5, 6, 9      | The value of every user (not only of the top N), as Id;Value                                 |
+ * |  7            | The rows, each preceded by the last commit date of the repo (see @ref partialSeven)          |
+ * |  8            | The number of commits of every language, as Value;Language                                    |
+ * |  10           | The rows (the repos of a shard are only in that shard)                                       |
+ * 
+ * @param stream    The file to output to
+ * @param query     The #Query to be executed
+ * @param catalog   The catalog of the shard
+ * @param cancel    The #CancelToken of the #Query (NULL if it is never cancelled)
+ * 
+ * @return          Whether the #Query has a partial aggregate (nothing is written otherwise)
+ */
+bool executePartialQuery(FILE* stream, Query query, Catalog catalog, CancelToken cancel) {
+    if (query->id < 5 || query->id > 10)
+        return false;
+
+    QUERYPROFILE profile;
+    beginQueryProfile(&profile, query->id);
 
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpointer-to-int-cast"
+
+    switch (query->id) {
+        case 5:
+            partialFive(catalog, (Date)query->params[1], (Date)query->params[2], stream, cancel);
+            break;
+        case 6:
+            partialSix(catalog, (char*)query->params[1], stream, cancel);
+            break;
+        case 7:
+            partialSeven(catalog, (Date)query->params[0], stream, cancel);
+            break;
+        case 8:
+            partialEight(catalog, (Date)query->params[1], stream, cancel);
+            break;
+        case 9:
+            partialNine(catalog, stream);
+            break;
+        default:
+            queryTen(catalog, (int)query->params[0], stream, cancel);
+            break;
+    }
+
+    #pragma GCC diagnostic pop
+
+    endQueryProfile(&profile);
+    return true;
+}
 
 /**
  * @brief       Given a string representing a #Query, stores the corresponding value in the given object
@@ -158,7 +433,7 @@ void parseQuery(char* str, Query query) {
 
     if (id<11 && id>0) {
         Format format = getQueryFormat(id);
-        bool result = readFormat(format, str, query->params);
+        bool result = readFormat(format, str, query->params, NULL);
         query->id = result ? id:-1;
         disposeFormat(format);
     }
@@ -177,29 +452,13 @@ Format getQueryFormat(int id) {
     if(id <= 0)
         return NULL;
 
-    FormatType dataTypes[QUERY_COUNT][QUERY_COUNT] = {
-        {},
-        {},
-        {},
-        {},
-        {},
-        {INT, DATE, DATE},
-        {INT, STRING},
-        {DATE},
-        {INT, DATE},
-        {INT},
-        {INT},
-    };
-
-    int parameterCount[QUERY_COUNT] = {0,0,0,0,0,3,2,1,2,1,1};
-    
-    void* parameters[parameterCount[id]];
+    void* parameters[queryParameterCount[id]];
     struct query temp;
-    for(int i = 0; i < parameterCount[id]; i++) {
+    for(int i = 0; i < queryParameterCount[id]; i++) {
         parameters[i] = &temp.params[i];
     }
 
-    Format format = makeFormat(temp.params, parameters, dataTypes[id], parameterCount[id], sizeof(temp.params), NULL, 0, ' ');
+    Format format = makeFormat(temp.params, parameters, queryParameterTypes[id], queryParameterCount[id], sizeof(temp.params), NULL, 0, ' ');
     return format;
 }
 
@@ -214,6 +473,22 @@ int getQueryId(Query query) {
     return query->id;
 }
 
+/**
+ * @brief       Gets the number of rows (or of rows per repo) a #Query outputs, its first parameter
+ * 
+ * @param query The given #Query
+ * 
+ * @return      The number (0 if the #Query has no such parameter)
+ */
+int getQueryLimit(Query query) {
+    bool limited = query->id == 5 || query->id == 6 || query->id == 8 || query->id == 9 || query->id == 10;
+
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wpointer-to-int-cast"
+    return limited ? (int)query->params[0] : 0;
+    #pragma GCC diagnostic pop
+}
+
 /**
  * @brief       Frees the given #Query
  * 
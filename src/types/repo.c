@@ -32,6 +32,7 @@ struct repo {
     char* description;          ///< The description of the repository
 	int language_len;           ///< The length of the language of the repository
     char* language;             ///< The language of the repository
+    int language_id;            ///< The id of the language of the repository in the dictionary of its catalog
 	int default_branch_len;     ///< The length of the name of default branch
     char* default_branch;       ///< The default branch of the repository
     Date  created_at;           ///< The date/time the repository was created at
@@ -51,7 +52,7 @@ struct repo {
  */
 void setRepoCreationFromComp(Repo repo, int date) {
 	free(repo->created_at);
-	repo->created_at = getUncompactedDate(date);
+	repo->created_at = getUncompactedDate(date, NULL);
 }
 
 /**
@@ -62,7 +63,7 @@ void setRepoCreationFromComp(Repo repo, int date) {
  */
 void setRepoUpdatedFromComp(Repo repo, int date) {
 	free(repo->updated_at);
-	repo->updated_at=getUncompactedDate(date);
+	repo->updated_at=getUncompactedDate(date, NULL);
 }
 
 /**
@@ -70,10 +71,11 @@ void setRepoUpdatedFromComp(Repo repo, int date) {
  *
  * @param repo  The given #Repo
  * @param date  The new date/time of the last commit to the #Repo
+ * @param arena The #Arena the dates of the #Repo are allocated from (NULL if they are allocated with malloc)
  */
-void setRepoLastCommitDateFromComp(Repo repo, int date) {
-	free(repo->actually_updated_at);
-	repo->actually_updated_at=getUncompactedDate(date);
+void setRepoLastCommitDateFromComp(Repo repo, int date, Arena arena) {
+	arenaFree(arena, repo->actually_updated_at);
+	repo->actually_updated_at=getUncompactedDate(date, arena);
 }
 
 /**
@@ -109,6 +111,27 @@ int getRepoLanguageLength(Repo repo) {
     return repo->language_len;
 }
 
+/**
+ * @brief       Gets the id of the language of a #Repo, in the #Dictionary of the languages of its #Catalog
+ *
+ * @param repo  The given #Repo
+ *
+ * @return      The id of the language of the #Repo (-1 if it was not set)
+ */
+int getRepoLanguageId(Repo repo) {
+    return repo->language_id;
+}
+
+/**
+ * @brief       Sets the id of the language of a #Repo
+ *
+ * @param repo  The given #Repo
+ * @param id    The id of its language, in the #Dictionary of the languages of its #Catalog
+ */
+void setRepoLanguageId(Repo repo, int id) {
+    repo->language_id = id;
+}
+
 /**
  * @brief       Gets the length of the name of the default branch of a #Repo
  *
@@ -196,6 +219,7 @@ Repo initRepo() {
     r->description = NULL;
 	r->language_len = 0;
     r->language = NULL;
+    r->language_id = -1;
 	r->default_branch_len = 0;
     r->default_branch = NULL;
     r->created_at = NULL;
@@ -692,12 +716,12 @@ Format getRepoFormat() {
 Format getCompressedRepoFormat() {
     struct repo repo;
     void* params[] = {
-        &repo.id,&repo.owner_id,&repo.actually_updated_at,&repo.language_len,&repo.language,&repo.description_len,&repo.description,
+        &repo.id,&repo.owner_id,&repo.actually_updated_at,&repo.language_id,&repo.language_len,&repo.language,&repo.description_len,&repo.description,
         /*after this point is all unused*/&repo.has_wiki,&repo.default_branch_len,&repo.default_branch,&repo.created_at,&repo.updated_at,&repo.forks_count,
         &repo.open_issues,&repo.stargazers_count,&repo.size,&repo.full_name_len,&repo.full_name,&repo.license_len,&repo.license
     };
 
-    FormatType types[] = { BINARY_INT,BINARY_INT,BINARY_DATE_TIME,BINARY_INT,STRING,BINARY_INT,STRING,
+    FormatType types[] = { BINARY_INT,BINARY_INT,BINARY_DATE_TIME,BINARY_INT,BINARY_INT,STRING,BINARY_INT,STRING,
         /*after this point is all unused*/BINARY_BOOL,BINARY_INT,STRING,BINARY_DATE_TIME,BINARY_DATE_TIME,BINARY_INT,BINARY_INT,BINARY_INT,
         BINARY_INT,BINARY_INT,STRING,BINARY_INT,STRING
     };
@@ -708,7 +732,8 @@ Format getCompressedRepoFormat() {
 	addToPair(lists,3,CRFULL_NAME, &repo.full_name_len);
 	addToPair(lists,4,CRLICENSE, &repo.license_len);
 
-	Format f=makeFormat(&repo, params, types, 20, sizeof(struct repo), lists, 5, '\0');
+	Format f=makeFormat(&repo, params, types, 21, sizeof(struct repo), lists, 5, '\0');
+	setFormatOffsetHeader(f);
 	free(lists);
 	return f;
 }
@@ -445,6 +445,8 @@ Format getCompressedUserFormat() {
 	addToPair(lists,2,CUFOLLOWER_LIST,&user.followers);
 	addToPair(lists,3,CUFOLLOWING_LIST,&user.following);
 	Format f=makeFormat(&user, params, types, 13, sizeof(struct user), lists, 4, '\0');
+	//The friends list before the login is skipped by reading the header
+	setFormatOffsetHeader(f);
 	free(lists);
 	return f;
 }
@@ -467,8 +469,9 @@ int compareInts(const void* a, const void* b) {
  *              As a side effect, sorts one of the lists follower_list or following_list
  *
  * @param user  The given #User
+ * @param arena The #Arena to allocate friends_list from (NULL to use malloc)
  */
-void calculateFriends(User user)
+void calculateFriends(User user, Arena arena)
 {
     if (user->followers == 0 || user->following == 0) {
         user->friends = 0;
@@ -479,20 +482,20 @@ void calculateFriends(User user)
         int* big = user->followers < user->following ? user->following_list : user->follower_list;
         int big_l = MAX(user->followers, user->following);
 
-        GArray* ans = g_array_new(FALSE, FALSE, sizeof(int));
+        //There are at most as many friends as elements of the smallest list
+        int* ans = arenaAlloc(arena, small_l * sizeof(int));
         qsort(small, small_l, sizeof(int), compareInts);
 
+        user->friends = 0;
         for (int i = 0; i < big_l; i++)
             if (containedInSortedArray(small, small_l, big[i]))
-                g_array_append_val(ans, big[i]);
+                ans[user->friends++] = big[i];
 
-        user->friends = ans->len;
-        if (user->friends == 0)
+        if (user->friends == 0) {
+            arenaFree(arena, ans);
             user->friends_list = NULL;
-        else
-            user->friends_list = (int*)ans->data;
-
-        g_array_free(ans, user->friends == 0);
+        } else
+            user->friends_list = ans;
     }
 }
 
@@ -0,0 +1,137 @@
+/**
+ * @file arena.c
+ * 
+ * File containing the implementation of the #Arena type
+ * 
+ * The #Arena keeps a list of blocks and a pointer to the first free byte of the current one. Allocating bumps the pointer
+ * (moving to the next block, or creating one, when the current is full) and resetting rewinds it to the start of the
+ * first block, so the blocks are reused by the following allocations instead of being given back to the system
+ */
+
+#include <stdlib.h>
+
+#include "utils/arena.h"
+
+/**
+ * @brief The alignment of the memory handed out by an #Arena
+ */
+#define ARENA_ALIGNMENT 16
+
+/**
+ * @brief A block of memory of an #Arena
+ */
+typedef struct arenaBlock {
+    struct arenaBlock* next;    ///< The following block (NULL if it is the last)
+    size_t size;                ///< The number of bytes of the block available for allocations
+    size_t used;                ///< The number of bytes of the block already handed out
+    char* data;                 ///< The memory of the block
+} ARENABLOCK, * ArenaBlock;
+
+/**
+ * @brief Structure representing an #Arena
+ */
+struct arena {
+    size_t block_size;      ///< The size of new blocks (larger allocations get a block of their own size)
+    ArenaBlock first;       ///< The first block
+    ArenaBlock current;     ///< The block allocations are currently served from
+};
+
+/**
+ * @brief       Creates an empty block of an #Arena
+ * 
+ * @param size  The size of the block
+ * 
+ * @return      The block
+ */
+static ArenaBlock makeArenaBlock(size_t size) {
+    ArenaBlock b = malloc(sizeof(ARENABLOCK));
+    b->next = NULL;
+    b->size = size;
+    b->used = 0;
+    b->data = malloc(size);
+    return b;
+}
+
+/**
+ * @brief               Creates an #Arena
+ * 
+ * @param block_size    The size of its blocks (0 for @ref ARENA_BLOCK_SIZE)
+ * 
+ * @return              The #Arena
+ */
+Arena makeArena(size_t block_size) {
+    Arena a = malloc(sizeof(struct arena));
+    a->block_size = block_size == 0 ? ARENA_BLOCK_SIZE : block_size;
+    a->first = a->current = makeArenaBlock(a->block_size);
+    return a;
+}
+
+/**
+ * @brief       Allocates memory from an #Arena. The memory lives until the #Arena is reset or freed
+ * 
+ * @param a     The #Arena (if NULL, the memory is allocated with malloc)
+ * @param size  The number of bytes to allocate
+ * 
+ * @return      The allocated memory
+ */
+void* arenaAlloc(Arena a, size_t size) {
+    if (a == NULL)
+        return malloc(size);
+
+    size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+
+    //The blocks after the current one are free, left over from before the last reset
+    while (a->current->used + size > a->current->size) {
+        ArenaBlock next = a->current->next;
+        if (next == NULL || next->size < size) {
+            ArenaBlock b = makeArenaBlock(size > a->block_size ? size : a->block_size);
+            b->next = next;
+            a->current->next = b;
+            next = b;
+        }
+        a->current = next;
+    }
+
+    void* ans = a->current->data + a->current->used;
+    a->current->used += size;
+    return ans;
+}
+
+/**
+ * @brief       Frees memory allocated by @ref arenaAlloc. Only frees it if it was allocated with malloc:
+ *              the memory of an #Arena is only given back by @ref resetArena
+ * 
+ * @param a     The #Arena the memory was allocated from (NULL if it was allocated with malloc)
+ * @param ptr   The memory
+ */
+void arenaFree(Arena a, void* ptr) {
+    if (a == NULL)
+        free(ptr);
+}
+
+/**
+ * @brief       Gives back all the memory allocated from an #Arena, keeping its blocks for the following allocations
+ * 
+ * @param a     The #Arena
+ */
+void resetArena(Arena a) {
+    for (ArenaBlock b = a->first; b != a->current->next; b = b->next)
+        b->used = 0;
+    a->current = a->first;
+}
+
+/**
+ * @brief       Frees an #Arena, along with all the memory allocated from it
+ * 
+ * @param a     The #Arena
+ */
+void freeArena(Arena a) {
+    ArenaBlock b = a->first;
+    while (b != NULL) {
+        ArenaBlock next = b->next;
+        free(b->data);
+        free(b);
+        b = next;
+    }
+    free(a);
+}
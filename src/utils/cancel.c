@@ -0,0 +1,73 @@
+/**
+ * @file cancel.c
+ * 
+ * File containing the implementation of the #CancelToken type
+ */
+
+#include <stdlib.h>
+
+#include "utils/cancel.h"
+
+/**
+ * @brief Structure representing a #CancelToken
+ */
+struct cancelToken {
+    bool cancelled; ///< Whether the work was cancelled
+    int refs;       ///< The number of holders of the token
+};
+
+/**
+ * @brief   Creates a #CancelToken, not cancelled, held by the caller
+ * 
+ * @return  The #CancelToken
+ */
+CancelToken makeCancelToken() {
+    CancelToken t = malloc(sizeof(struct cancelToken));
+    t->cancelled = false;
+    t->refs = 1;
+    return t;
+}
+
+/**
+ * @brief   Adds a holder to a #CancelToken (to be released by it)
+ * 
+ * @param t The given #CancelToken
+ * 
+ * @return  The #CancelToken
+ */
+CancelToken retainCancelToken(CancelToken t) {
+    if (t != NULL)
+        __atomic_add_fetch(&t->refs, 1, __ATOMIC_RELAXED);
+    return t;
+}
+
+/**
+ * @brief   Cancels the work of a #CancelToken
+ * 
+ * @param t The given #CancelToken
+ */
+void cancelWork(CancelToken t) {
+    if (t != NULL)
+        __atomic_store_n(&t->cancelled, true, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief   Checks whether the work of a #CancelToken was cancelled
+ * 
+ * @param t The given #CancelToken (NULL is never cancelled)
+ * 
+ * @return  Whether the work should stop
+ */
+bool isCancelled(CancelToken t) {
+    return t != NULL && __atomic_load_n(&t->cancelled, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief   Releases a holder of a #CancelToken, freeing it after the last
+ * 
+ * @param t The given #CancelToken
+ */
+void releaseCancelToken(CancelToken t) {
+    if (t != NULL && __atomic_sub_fetch(&t->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        free(t);
+}
@@ -0,0 +1,297 @@
+/**
+ * @file counter.c
+ *
+ * File containing the implementation of the #Counter type
+ *
+ * The entries are kept contiguous, in the order they were added, so iterating, merging and selecting the largest values
+ * only walk a dense array. Keys are found through a table of slots (a power of 2, at most half full) holding the
+ * position of an entry plus one (0 marking an empty slot), probed linearly from the hash of the key
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/counter.h"
+
+/**
+ * @brief Structure representing a #Counter
+ */
+struct counter {
+    COUNTERENTRY* entries;  ///< The entries, in the order they were added
+    int size;               ///< The number of entries
+    int capacity;           ///< The number of entries allocated
+    int* slots;             ///< The position of the entry of each slot plus one (0 if the slot is empty)
+    unsigned int mask;      ///< The number of slots minus one
+};
+
+/**
+ * @brief       Gets the first slot probed for a key (Fibonacci hashing, so that consecutive ids are spread out)
+ *
+ * @param c     The given #Counter
+ * @param key   The key
+ *
+ * @return      The slot
+ */
+static inline unsigned int hashCounterKey(Counter c, int key) {
+    return ((unsigned int)key * 2654435769u) & c->mask;
+}
+
+/**
+ * @brief       Finds the slot of a key: the one holding its entry or, if it is not in the #Counter, the empty slot
+ *              where it belongs
+ *
+ * @param c     The given #Counter
+ * @param key   The key
+ *
+ * @return      The slot
+ */
+static inline unsigned int findCounterSlot(Counter c, int key) {
+    unsigned int s = hashCounterKey(c, key);
+    while (c->slots[s] != 0 && c->entries[c->slots[s] - 1].key != key)
+        s = (s + 1) & c->mask;
+    return s;
+}
+
+/**
+ * @brief       Doubles the number of slots of a #Counter, placing its entries again
+ *
+ * @param c     The given #Counter
+ */
+static void growCounterSlots(Counter c) {
+    free(c->slots);
+    c->mask = c->mask * 2 + 1;
+    c->slots = calloc((size_t)c->mask + 1, sizeof(int));
+    for (int i = 0; i < c->size; i++)
+        c->slots[findCounterSlot(c, c->entries[i].key)] = i + 1;
+}
+
+/**
+ * @brief       Gets the entry of a key, adding it (with the value 0) if it is not in the #Counter
+ *
+ * @param c     The given #Counter
+ * @param key   The key
+ * @param added Set to whether the key was added
+ *
+ * @return      The entry
+ */
+static COUNTERENTRY* getCounterEntry(Counter c, int key, bool* added) {
+    unsigned int s = findCounterSlot(c, key);
+    *added = c->slots[s] == 0;
+    if (!*added)
+        return &c->entries[c->slots[s] - 1];
+
+    if (2 * (unsigned int)(c->size + 1) > c->mask + 1) {
+        growCounterSlots(c);
+        s = findCounterSlot(c, key);
+    }
+    if (c->size == c->capacity) {
+        c->capacity *= 2;
+        c->entries = realloc(c->entries, (size_t)c->capacity * sizeof(COUNTERENTRY));
+    }
+
+    c->entries[c->size] = (COUNTERENTRY){ .key = key, .value = 0 };
+    c->slots[s] = ++c->size;
+    return &c->entries[c->size - 1];
+}
+
+/**
+ * @brief       Creates an empty #Counter
+ *
+ * @param size  The expected number of keys (0 if unknown)
+ *
+ * @return      The #Counter
+ */
+Counter makeCounter(int size) {
+    Counter c = malloc(sizeof(struct counter));
+    unsigned int slots = COUNTER_MIN_SLOTS;
+    while (slots < 2 * (unsigned int)size)
+        slots *= 2;
+
+    c->mask = slots - 1;
+    c->slots = calloc(slots, sizeof(int));
+    c->size = 0;
+    c->capacity = slots / 2;
+    c->entries = malloc((size_t)c->capacity * sizeof(COUNTERENTRY));
+    return c;
+}
+
+/**
+ * @brief       Increases the value of a key of a #Counter (keys not in the #Counter start at 0)
+ *
+ * @param c     The given #Counter
+ * @param key   The key
+ * @param by    The amount to increase the value by
+ *
+ * @return      Whether the key was added to the #Counter
+ */
+bool increaseCounter(Counter c, int key, int by) {
+    bool added;
+    getCounterEntry(c, key, &added)->value += by;
+    return added;
+}
+
+/**
+ * @brief       Stores a value in a key of a #Counter if it is greater than the one stored (or if the key is not there)
+ *
+ * @param c     The given #Counter
+ * @param key   The key
+ * @param value The value
+ *
+ * @return      Whether the key was added to the #Counter
+ */
+bool storeCounterIfGreater(Counter c, int key, int value) {
+    bool added;
+    COUNTERENTRY* e = getCounterEntry(c, key, &added);
+    if (added || value > e->value)
+        e->value = value;
+    return added;
+}
+
+/**
+ * @brief       Gets the value stored in a key of a #Counter
+ *
+ * @param c     The given #Counter
+ * @param key   The key
+ *
+ * @return      The value (0 if the key is not in the #Counter)
+ */
+int getCounterValue(Counter c, int key) {
+    int pos = c->slots[findCounterSlot(c, key)];
+    return pos == 0 ? 0 : c->entries[pos - 1].value;
+}
+
+/**
+ * @brief       Gets the number of keys of a #Counter
+ *
+ * @param c     The given #Counter
+ *
+ * @return      The number of keys
+ */
+int getCounterSize(Counter c) {
+    return c->size;
+}
+
+/**
+ * @brief       Gets the entries of a #Counter, in the order their keys were added
+ *
+ * @param c     The given #Counter
+ * @param len   Set to the number of entries
+ *
+ * @return      The entries, valid until a key is added to the #Counter, it is cleared or freed
+ */
+COUNTERENTRY* getCounterEntries(Counter c, int* len) {
+    *len = c->size;
+    return c->entries;
+}
+
+/**
+ * @brief       Adds the values of a #Counter to the values of the same keys of another
+ *
+ * @param dest  The #Counter to add the values to
+ * @param src   The #Counter whose values are added (left unchanged)
+ */
+void mergeCounter(Counter dest, Counter src) {
+    for (int i = 0; i < src->size; i++)
+        increaseCounter(dest, src->entries[i].key, src->entries[i].value);
+}
+
+/**
+ * @brief       Whether an entry ranks below another: it has a smaller value or, on ties, a larger key
+ *
+ * @param a     The first entry
+ * @param b     The second entry
+ *
+ * @return      Whether a ranks below b
+ */
+static inline bool ranksBelow(COUNTERENTRY a, COUNTERENTRY b) {
+    return a.value < b.value || (a.value == b.value && a.key > b.key);
+}
+
+/**
+ * @brief       Moves an entry of a heap (whose root is the entry ranking the lowest) down to its place
+ *
+ * @param heap  The heap
+ * @param size  The number of entries of the heap
+ * @param pos   The position of the entry
+ */
+static void siftDown(COUNTERENTRY* heap, int size, int pos) {
+    COUNTERENTRY e = heap[pos];
+    for (int child = 2 * pos + 1; child < size; child = 2 * pos + 1) {
+        if (child + 1 < size && ranksBelow(heap[child + 1], heap[child]))
+            child++;
+        if (!ranksBelow(heap[child], e))
+            break;
+        heap[pos] = heap[child];
+        pos = child;
+    }
+    heap[pos] = e;
+}
+
+/**
+ * @brief       Gets the entries of a #Counter with the largest values, in decreasing order of value (and increasing
+ *              order of key on ties)
+ *
+ *              Keeps the best entries seen in a heap of at most n entries, so only O(K log n) work is done for K keys,
+ *              instead of sorting all of them
+ *
+ * @param c     The given #Counter
+ * @param n     The number of entries wanted
+ * @param len   Set to the number of entries returned (the least of n and the number of keys)
+ *
+ * @return      The entries (to be freed by the caller)
+ */
+COUNTERENTRY* getCounterTop(Counter c, int n, int* len) {
+    int size = n < c->size ? (n < 0 ? 0 : n) : c->size;
+    COUNTERENTRY* heap = malloc((size_t)(size > 0 ? size : 1) * sizeof(COUNTERENTRY));
+
+    if (size > 0) {
+        memcpy(heap, c->entries, (size_t)size * sizeof(COUNTERENTRY));
+        for (int i = size / 2 - 1; i >= 0; i--)
+            siftDown(heap, size, i);
+
+        for (int i = size; i < c->size; i++)
+            if (ranksBelow(heap[0], c->entries[i])) {
+                heap[0] = c->entries[i];
+                siftDown(heap, size, 0);
+            }
+
+        //Taking the lowest ranking entry to the end, one at a time, leaves them in decreasing order
+        for (int i = size - 1; i > 0; i--) {
+            COUNTERENTRY lowest = heap[0];
+            heap[0] = heap[i];
+            heap[i] = lowest;
+            siftDown(heap, i, 0);
+        }
+    }
+
+    *len = size;
+    return heap;
+}
+
+/**
+ * @brief       Removes every key of a #Counter, keeping its memory for the keys added next
+ *
+ *              Only the slots in use are emptied (so clearing costs as much as the number of keys, not of slots): the
+ *              slot of each entry is found first and kept in its value, as emptying a slot breaks the probing of the
+ *              keys placed after it
+ *
+ * @param c     The given #Counter
+ */
+void clearCounter(Counter c) {
+    for (int i = 0; i < c->size; i++)
+        c->entries[i].value = (int)findCounterSlot(c, c->entries[i].key);
+    for (int i = 0; i < c->size; i++)
+        c->slots[c->entries[i].value] = 0;
+    c->size = 0;
+}
+
+/**
+ * @brief       Frees a #Counter
+ *
+ * @param c     The given #Counter
+ */
+void freeCounter(Counter c) {
+    free(c->entries);
+    free(c->slots);
+    free(c);
+}
@@ -0,0 +1,292 @@
+/**
+ * @file metrics.c
+ *
+ * File containing the implementation of the metrics of the hot paths
+ *
+ * Each thread counts in its own #METRICS, registered in a list the first time it counts something, so counting takes no
+ * lock and shares no cache line. The list is only walked to aggregate the metrics, on demand. The metrics of the threads
+ * which exit are added to those of the exited threads, so none is lost and the list stays as short as the live threads
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/metrics.h"
+#include "utils/utils.h"
+
+/**
+ * @brief The metrics of a thread, in the list of the threads counting
+ */
+typedef struct metricsThread {
+    METRICS metrics;                ///< The metrics of the thread (first, so it converts to its #METRICS)
+    struct metricsThread* next;     ///< The next thread in the list
+} METRICSTHREAD;
+
+__thread METRICS* threadMetrics = NULL;
+
+/**
+ * @brief The mutex of the list of the threads counting, of the metrics of the exited threads and of the last profile
+ */
+static pthread_mutex_t metricsMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief The threads counting
+ */
+static METRICSTHREAD* metricsThreads = NULL;
+
+/**
+ * @brief The metrics of the threads which exited
+ */
+static METRICS exitedMetrics;
+
+/**
+ * @brief The profile of the last query executed (id 0 if none was)
+ */
+static QUERYPROFILE lastProfile;
+
+/**
+ * @brief The key whose destructor runs when a thread counting exits
+ */
+static pthread_key_t metricsKey;
+static pthread_once_t metricsKeyOnce = PTHREAD_ONCE_INIT;
+
+static const char* metricNames[METRIC_NUM] = {
+    "cache_hits", "cache_misses", "cache_evictions", "reads", "read_bytes", "read_ns", "writes", "write_bytes",
+    "write_ns", "lock_waits", "lock_wait_ns", "index_reads", "key_lookups", "key_probes", "lazy_decodes",
+    "rows_scanned", "rows_spilled", "queries", "query_ns"
+};
+
+static const char* histogramNames[HISTOGRAM_NUM] = {
+    "read_ns", "write_ns", "lock_wait_ns", "key_probes", "query_ns", "query_rows"
+};
+
+/**
+ * @brief           Adds some metrics to others
+ *
+ * @param dest      The metrics to add to
+ * @param metrics   The metrics to add (read atomically, as their thread may be counting)
+ */
+static void addMetrics(METRICS* dest, METRICS* metrics) {
+    for (int m = 0; m < METRIC_NUM; m++)
+        dest->counters[m] += __atomic_load_n(&metrics->counters[m], __ATOMIC_RELAXED);
+    for (int h = 0; h < HISTOGRAM_NUM; h++)
+        for (int b = 0; b < METRIC_BUCKETS; b++)
+            dest->histograms[h][b] += __atomic_load_n(&metrics->histograms[h][b], __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief       Removes the metrics of a thread which exited from the list, adding them to those of the exited threads
+ *
+ * @param t     The #METRICSTHREAD of the thread
+ */
+static void unregisterMetricsThread(void* t) {
+    pthread_mutex_lock(&metricsMutex);
+
+    METRICSTHREAD** it = &metricsThreads;
+    while (*it != NULL && *it != t)
+        it = &(*it)->next;
+    if (*it != NULL)
+        *it = (*it)->next;
+
+    addMetrics(&exitedMetrics, &((METRICSTHREAD*)t)->metrics);
+    pthread_mutex_unlock(&metricsMutex);
+    free(t);
+    threadMetrics = NULL;
+}
+
+/**
+ * @brief Creates the key whose destructor unregisters the threads (see @ref unregisterMetricsThread)
+ */
+static void createMetricsKey() {
+    pthread_key_create(&metricsKey, unregisterMetricsThread);
+}
+
+/**
+ * @brief   Registers the metrics of the calling thread, the first time it counts something
+ *
+ * @return  The metrics of the thread
+ */
+METRICS* registerMetricsThread() {
+    pthread_once(&metricsKeyOnce, createMetricsKey);
+
+    METRICSTHREAD* t = calloc(1, sizeof(METRICSTHREAD));
+    pthread_setspecific(metricsKey, t);
+
+    pthread_mutex_lock(&metricsMutex);
+    t->next = metricsThreads;
+    metricsThreads = t;
+    pthread_mutex_unlock(&metricsMutex);
+
+    threadMetrics = &t->metrics;
+    return threadMetrics;
+}
+
+/**
+ * @brief           Gets a counter of the calling thread (used to measure the work of a task as a difference)
+ *
+ * @param metric    The counter
+ *
+ * @return          The value of the counter
+ */
+long getThreadMetric(Metric metric) {
+    return threadMetrics == NULL ? 0 : threadMetrics->counters[metric];
+}
+
+/**
+ * @brief           Aggregates the metrics of every thread, since the start of the program
+ *
+ * @param metrics   Where to store the metrics
+ */
+void getMetrics(METRICS* metrics) {
+    memset(metrics, 0, sizeof(METRICS));
+
+    pthread_mutex_lock(&metricsMutex);
+    addMetrics(metrics, &exitedMetrics);
+    for (METRICSTHREAD* t = metricsThreads; t != NULL; t = t->next)
+        addMetrics(metrics, &t->metrics);
+    pthread_mutex_unlock(&metricsMutex);
+}
+
+/**
+ * @brief           Gets a percentile of a histogram (the upper bound of the bucket holding it)
+ *
+ * @param metrics   The metrics
+ * @param histogram The histogram
+ * @param p         The percentile (from 0 to 100)
+ *
+ * @return          The percentile (0 if the histogram is empty)
+ */
+long getHistogramPercentile(METRICS* metrics, Histogram histogram, double p) {
+    long* buckets = metrics->histograms[histogram];
+    long total = 0, seen = 0;
+    for (int b = 0; b < METRIC_BUCKETS; b++)
+        total += buckets[b];
+
+    for (int b = 0; b < METRIC_BUCKETS; b++) {
+        seen += buckets[b];
+        if (total > 0 && seen >= p / 100 * total)
+            return b == 0 ? 0 : (1L << b) - 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief           Gets the name of a counter, as dumped
+ *
+ * @param metric    The counter
+ *
+ * @return          The name
+ */
+const char* getMetricName(Metric metric) {
+    return metricNames[metric];
+}
+
+/**
+ * @brief           Gets the name of a histogram, as dumped
+ *
+ * @param histogram The histogram
+ *
+ * @return          The name
+ */
+const char* getHistogramName(Histogram histogram) {
+    return histogramNames[histogram];
+}
+
+/**
+ * @brief           Starts profiling a query, in the thread which executes it
+ *
+ * @param profile   The profile (holding the counters of the thread at the start, until @ref endQueryProfile)
+ * @param id        The id of the query
+ */
+void beginQueryProfile(QUERYPROFILE* profile, int id) {
+    profile->id = id;
+    profile->ns = METRICS_TIME();
+    profile->read_ns = getThreadMetric(METRIC_READ_NS);
+    profile->lock_ns = getThreadMetric(METRIC_LOCK_WAIT_NS);
+    profile->rows = getThreadMetric(METRIC_ROWS_SCANNED);
+    profile->misses = getThreadMetric(METRIC_CACHE_MISSES);
+}
+
+/**
+ * @brief           Ends profiling a query: the profile holds the work done since @ref beginQueryProfile, which is
+ *                  counted in the metrics and kept as the last profile
+ *
+ * @param profile   The profile
+ */
+void endQueryProfile(QUERYPROFILE* profile) {
+    profile->ns = METRICS_TIME() - profile->ns;
+    profile->read_ns = getThreadMetric(METRIC_READ_NS) - profile->read_ns;
+    profile->lock_ns = getThreadMetric(METRIC_LOCK_WAIT_NS) - profile->lock_ns;
+    profile->rows = getThreadMetric(METRIC_ROWS_SCANNED) - profile->rows;
+    profile->misses = getThreadMetric(METRIC_CACHE_MISSES) - profile->misses;
+
+    ADD_METRIC(METRIC_QUERIES, 1);
+    ADD_METRIC(METRIC_QUERY_NS, profile->ns);
+    ADD_HISTOGRAM(HISTOGRAM_QUERY_NS, profile->ns);
+    ADD_HISTOGRAM(HISTOGRAM_QUERY_ROWS, profile->rows);
+
+    pthread_mutex_lock(&metricsMutex);
+    lastProfile = *profile;
+    pthread_mutex_unlock(&metricsMutex);
+}
+
+/**
+ * @brief           Gets the profile of the last query executed
+ *
+ * @param profile   Where to store the profile
+ *
+ * @return          Whether a query was executed
+ */
+bool getLastQueryProfile(QUERYPROFILE* profile) {
+    pthread_mutex_lock(&metricsMutex);
+    *profile = lastProfile;
+    pthread_mutex_unlock(&metricsMutex);
+    return profile->id != 0;
+}
+
+/**
+ * @brief           Writes the metrics of every thread: a line per counter ("name value") and per histogram
+ *                  ("name count p50 p95 p99 max"), followed by the profile of the last query
+ *
+ * @param stream    The stream to write to
+ */
+void dumpMetrics(FILE* stream) {
+    METRICS metrics;
+    getMetrics(&metrics);
+
+    for (int m = 0; m < METRIC_NUM; m++)
+        fprintf(stream, "%s %ld\n", metricNames[m], metrics.counters[m]);
+
+    for (int h = 0; h < HISTOGRAM_NUM; h++) {
+        long count = 0;
+        for (int b = 0; b < METRIC_BUCKETS; b++)
+            count += metrics.histograms[h][b];
+        fprintf(stream, "histogram_%s %ld %ld %ld %ld %ld\n", histogramNames[h], count,
+                getHistogramPercentile(&metrics, h, 50), getHistogramPercentile(&metrics, h, 95),
+                getHistogramPercentile(&metrics, h, 99), getHistogramPercentile(&metrics, h, 100));
+    }
+
+    QUERYPROFILE p;
+    if (getLastQueryProfile(&p))
+        fprintf(stream, "last_query %d ns %ld read_ns %ld lock_ns %ld rows %ld misses %ld\n", p.id, p.ns, p.read_ns,
+                p.lock_ns, p.rows, p.misses);
+}
+
+/**
+ * @brief       Writes the metrics of every thread to a file (see @ref dumpMetrics)
+ *
+ * @param path  The path to the file
+ *
+ * @return      Whether the file was written
+ */
+bool saveMetrics(char* path) {
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf(stderr, "saveMetrics: could not open '%s'\n", path);
+        return false;
+    }
+
+    dumpMetrics(f);
+    return fclose(f) == 0;
+}
@@ -5,77 +5,123 @@
  */
 
 #include <glib.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include "types/catalog.h"
 #include "utils/querySolver.h"
+#include "utils/sink.h"
 #include "utils/utils.h"
 
-
 /**
- * @brief Struct used to represent pairs of key and respective value in hash table
+ * @brief The number of rows of query 10 whose logins are resolved at once (see @ref getUserLogins)
  */
-typedef struct keyValuePair {
-    gpointer key; 	///< The key to store
-    gpointer value; ///< The value of the respective key
-}*KeyValuePair;
+#define LOGIN_BATCH_SIZE 65536
 
 /**
- * @brief 			Saves a key and value to a Array as a pair
+ * @brief           Gets the logins of the users of rows at once (see @ref getUserLogins)
  *
- * @param key 		The key of the of the pair
- * @param value 	The value of the pair
+ * @param catalog   The given #Catalog
+ * @param rows      The rows, whose keys are the ids of the users
+ * @param n         The number of rows
+ * @param offsets   Set to the position in the returned buffer of the login of the user of each row
  *
- * @param arr 		The array to store in
+ * @return          The buffer holding the logins (to be freed by the caller)
  */
-void savePairToArray(gpointer key,gpointer value,gpointer arr) {
-    KeyValuePair p = malloc(sizeof(struct keyValuePair));
-    p->key = key;
-    p->value = value;
-    GArray* array = (GArray*)arr;
-    g_array_append_val(array,p);
+static char* getRowLogins(Catalog catalog, COUNTERENTRY* rows, int n, int* offsets) {
+    int* ids = malloc(MAX(n, 1) * sizeof(int));
+    for (int i = 0; i < n; i++)
+        ids[i] = rows[i].key;
+
+    char* logins = getUserLogins(catalog, ids, n, offsets);
+    free(ids);
+    return logins;
 }
 
 /**
- * @brief 			Compares two pairs by their value
+ * @brief           Writes rows of users, as Id;Login;Commits (queries 5 and 6)
  *
- * @param pair1 	The first Pair
- * @param pair2 	The second Pair
+ * @param catalog   The given #Catalog
+ * @param rows      The rows (user id : number of commits)
+ * @param n         The number of rows
+ * @param stream    The stream to write the ouput to
+ */
+static void printUserRows(Catalog catalog, COUNTERENTRY* rows, int n, FILE* stream) {
+    int* offsets = malloc(MAX(n, 1) * sizeof(int));
+    char* logins = getRowLogins(catalog, rows, n, offsets);
+
+    ResultSink sink = openSink(stream);
+    for (int i = 0; i < n; i++) {
+        sinkInt(sink, rows[i].key);
+        sinkChar(sink, ';');
+        sinkString(sink, logins + offsets[i]);
+        sinkChar(sink, ';');
+        sinkInt(sink, rows[i].value);
+        sinkChar(sink, '\n');
+    }
+    closeSink(sink);
+    free(logins);
+    free(offsets);
+}
+
+/**
+ * @brief           Writes the N #User with the most commits of a #Counter, as Id;Login;Commits (queries 5 and 6)
  *
- * @return True     If the value of pair1 is smaller than the value of pair2
- * @return False    Otherwise
+ * @param catalog   The given #Catalog
+ * @param users     The #Counter of the number of commits of each #User
+ * @param N         The number of #User to output
+ * @param stream    The stream to write the ouput to
  */
-gint comparePair(gconstpointer pair1,gconstpointer pair2) {
-    KeyValuePair p1=*(KeyValuePair*) pair1;
-    KeyValuePair p2=*(KeyValuePair*) pair2;
-    return GPOINTER_TO_INT(p1->value)<GPOINTER_TO_INT(p2->value);
+void printTopUsers(Catalog catalog, Counter users, int N, FILE* stream) {
+    int c;
+    COUNTERENTRY* top = getCounterTop(users, N, &c);
+    printUserRows(catalog, top, c, stream);
+    free(top);
 }
 
 /**
- * @brief 		Transforms a hash table into a list of pairs organized in decreasing order of values
+ * @brief           Reads the first rows of the ranking of the users of a language (see @ref openLanguageRanking)
  *
- * @param t 	The hashtable to transform into a list
+ * @param catalog   The given #Catalog
+ * @param ranking   The #Ranking
+ * @param lang      The given language
+ * @param N         The number of rows wanted
+ * @param len       Set to the number of rows read (0 if there is no such language)
  *
- * @return 		The array of keys and corresponding values under the pair type
+ * @return          The rows, valid until the #Ranking is read again or freed
  */
-GArray* getHashTableOrganizedyValues(GHashTable* t) {
-    GArray* pairs = g_array_new(FALSE,FALSE,sizeof(KeyValuePair));
-    g_hash_table_foreach(t,savePairToArray,pairs);
-    g_array_sort(pairs,comparePair);
-    return pairs;
+static COUNTERENTRY* readLanguageRanking(Catalog catalog, Ranking ranking, char* lang, int N, int* len) {
+    int group = findLanguageRankingGroup(catalog, ranking, lang);
+    *len = 0;
+    return group == -1 ? NULL : readRankingGroup(ranking, group, N, len);
 }
 
 /**
- * @brief 		Frees all pairs inside a Garray and the Garray itself
+ * @brief           Writes the N languages with the most commits of a #Counter (query 8)
  *
- * @param g    	the Garray to be freed
+ * @param catalog   The given #Catalog
+ * @param languages The #Counter of the number of commits of each language id (see @ref getCatalogLanguage)
+ * @param N         The number of languages to output
+ * @param stream    The stream to write the ouput to
  */
-void freeKeyValuesGarray(GArray* g) {
-    for (int i = 0;i<g->len;i++)
-        free(g_array_index(g,KeyValuePair,i));
+void printTopLanguages(Catalog catalog, Counter languages, int N, FILE* stream) {
+    int c;
+    //One more than wanted, as "none" is not a language
+    COUNTERENTRY* top = getCounterTop(languages, N + 1, &c);
+
+    ResultSink sink = openSink(stream);
+    for(int i = 0, printed = 0; i < c && printed < N; i++) {
+        char* lang = getCatalogLanguage(catalog, top[i].key);
+        if (strcmp(lang, "none") != 0) {
+            sinkString(sink, lang);
+            sinkChar(sink, '\n');
+            printed++;
+        }
+    }
+    closeSink(sink);
 
-    g_array_free(g,TRUE);
+    free(top);
 }
 
 /**
@@ -122,113 +168,92 @@ double queryFour(Catalog catalog) {
 /**
  * @brief 				Executes the fifth query (N most active users in given date interval)
  *
- * 						Complexity: O(C + NLogN) average, where C is the number of commits and N is the number of users
+ * 						Complexity: O(C + U log N) average, where C is the number of commits and U is the number of users
  *
  * @param catalog       The given #Catalog
  * @param N             The number of #User to output
  * @param startDate     The start #Date of the interval
  * @param endDate       The end #Date of the interval
  * @param stream        The stream to write the ouput to
+ * @param cancel        The #CancelToken of the query (nothing is written once it is cancelled)
  */
-void queryFive(Catalog catalog, int N, Date startDate, Date endDate, FILE* stream) {
+void queryFive(Catalog catalog, int N, Date startDate, Date endDate, FILE* stream, CancelToken cancel) {
     //Set time to end of day of final day
     setTime(endDate, 23, 59, 59);
 
-    int differentUsers;
-    //Create hash table of users for counting sort
-    GHashTable* users = getHashTableOfUserWithCommitsAfter(catalog,startDate,endDate,&differentUsers);
-    GArray* pairs = getHashTableOrganizedyValues(users);
-    User u = initUser();
-    Format comp_user_f = getCompressedUserFormat();
-    Lazy user = makeLazy(NULL, 0, comp_user_f, u);
-
-    for (int i = 0; i < MIN(N, differentUsers); i++) {
-        KeyValuePair pair=g_array_index(pairs,KeyValuePair,i);
-        int id=GPOINTER_TO_INT(pair->key);
-        int commitCount = GPOINTER_TO_INT(pair->value);
-        fprintf(stream, "%d;", id);
-        printUserLoginById(catalog, id, user, stream);
-        fprintf(stream,";%d\n", commitCount);
+    SpillCounter users = getCounterOfUserWithCommitsAfter(catalog,startDate,endDate,cancel);
+    if (isCancelled(cancel)) {
+        freeSpillCounter(users);
+        return;
     }
-    disposeFormat(comp_user_f);
-    freeLazy(user);
-    free(u);
-    freeKeyValuesGarray(pairs);
-    g_hash_table_destroy(users);
+
+    int c;
+    COUNTERENTRY* top = getSpillCounterTop(users, N, &c);
+    printUserRows(catalog, top, c, stream);
+    free(top);
+    freeSpillCounter(users);
 }
 
 /**
  * @brief 				Executes the sixth query (N most active users in repos of a given language)
  *
- * 						Complexity: O(C + NLogN) average, where C is the number of commits and N is the number of users
+ * 						Complexity: O(N), reading the ranking solved when the #Catalog was built (O(C + U log N) average
+ * 						counting the commits, where C is the number of commits and U is the number of users)
  *
  * @param catalog       The given #Catalog
  * @param N				The number of #User to output
  * @param lang          The given language
  * @param stream        The stream to write the ouput to
+ * @param cancel        The #CancelToken of the query (nothing is written once it is cancelled)
  */
-void querySix(Catalog catalog, int N, char* lang, FILE* stream) {
+void querySix(Catalog catalog, int N, char* lang, FILE* stream, CancelToken cancel) {
+    Ranking ranking = openLanguageRanking(catalog);
+    if (ranking != NULL) {
+        int c;
+        COUNTERENTRY* top = readLanguageRanking(catalog, ranking, lang, N, &c);
+        printUserRows(catalog, top, c, stream);
+        freeRanking(ranking);
+        return;
+    }
+
     //Create hash table of users for counting sort
     int differentUsers;
-    GHashTable* count = getHashTableOfCommitsPerLanguage(catalog,lang,&differentUsers);
-    GArray* pairs = getHashTableOrganizedyValues(count);
-    Format comp_user_f = getCompressedUserFormat();
-    User u = initUser();
-    Lazy user = makeLazy(NULL, 0, comp_user_f, u);
-
-    for(int i = 0; i < MIN(N, differentUsers); i++) {
-        KeyValuePair pair=g_array_index(pairs,KeyValuePair,i);
-        int id=GPOINTER_TO_INT(pair->key);
-        int commitCount = GPOINTER_TO_INT(pair->value);
-        fprintf(stream, "%d;", id);
-        printUserLoginById(catalog, id, user, stream);
-        fprintf(stream, ";%d\n", commitCount);
+    Counter count = getCounterOfCommitsPerLanguage(catalog,lang,&differentUsers,cancel);
+    if (isCancelled(cancel)) {
+        freeCounter(count);
+        return;
     }
-    disposeFormat(comp_user_f);
-    freeLazy(user);
-    free(u);
-    freeKeyValuesGarray(pairs);
-    g_hash_table_destroy(count);
+    printTopUsers(catalog, count, N, stream);
+    freeCounter(count);
 }
 
 /**
  * @brief 				Solves the eighth query, i.e., the top N languages present in repos starting from the given date
  *
- *
+ * 						Complexity: O(C + L log N), where C is the number of commits after the date and L the number of
+ * 						languages
  *
  * @param catalog       The given #Catalog
  * @param N             The top N wanted
  * @param startDate     The starting date
  * @param stream        The stream to write the ouput to
+ * @param cancel        The #CancelToken of the query (nothing is written once it is cancelled)
  */
-void queryEight(Catalog catalog, int N, Date  startDate, FILE* stream) {
-
-    GHashTable* languageCount = getHashTableOfNumbersOfAperencesOfALanguageAfter(catalog,startDate);
-    int c = g_hash_table_size(languageCount);
-    GArray* pairs = getHashTableOrganizedyValues(languageCount);
-
-    for(int i = 0; i < MIN(N, c); i++) {
-        KeyValuePair pair=g_array_index(pairs,KeyValuePair,i);
-        char* lang = (char*)pair->key;
-        if (strcmp(lang, "none") == 0) {
-            N++;
-            continue;
-        }
-        else
-            fprintf(stream, "%s\n", lang);
-    }
-
-    for (int i = 0; i < c; i++)
-        free(g_array_index(pairs,KeyValuePair,i)->key);
+void queryEight(Catalog catalog, int N, Date  startDate, FILE* stream, CancelToken cancel) {
 
-    g_hash_table_destroy(languageCount);
-    freeKeyValuesGarray(pairs);
+    Counter languageCount = getCounterOfCommitsPerLanguageAfter(catalog,startDate,cancel);
+    if (isCancelled(cancel)) {
+        freeCounter(languageCount);
+        return;
+    }
+    printTopLanguages(catalog, languageCount, N, stream);
+    freeCounter(languageCount);
 }
 
 /**
  * @brief 				Solves the ninth query (top N users with most commits in repos owned by their friends)
  *
- * 						Complexity: O(CN + N)
+ * 						Complexity: O(N), reading the ranking solved when the #Catalog was built
  *
  * @param catalog       The given #Catalog
  * @param N				The number of #User to output
@@ -236,59 +261,219 @@ void queryEight(Catalog catalog, int N, Date  startDate, FILE* stream) {
  */
 
 void queryNine(Catalog catalog, int N, FILE* stream) {
-    GHashTable* count = getHashTableOfCommitCountInReposOfFriends(catalog);
-    GArray* pairs = getHashTableOrganizedyValues(count);
-    int c = pairs->len;
-    Format comp_user_f = getCompressedUserFormat();
-    User u = initUser();
-    Lazy user = makeLazy(NULL, 0, comp_user_f, u);
-    for(int i = 0; i < MIN(N, c); i++) {
-        KeyValuePair pair=g_array_index(pairs,KeyValuePair,i);
-        int id=GPOINTER_TO_INT(pair->key);
-        fprintf(stream, "%d;",id);
-        printUserLoginById(catalog, id, user, stream);
-        fprintf(stream, "\n");
+    Ranking ranking = openFriendsCommitsRanking(catalog);
+    if (ranking == NULL) {
+        fprintf(stderr, "queryNine: could not open the ranking of the catalog\n");
+        return;
+    }
 
+    int c;
+    COUNTERENTRY* top = readRankingGroup(ranking, 0, N, &c);
+    int* offsets = malloc(MAX(c, 1) * sizeof(int));
+    char* logins = getRowLogins(catalog, top, c, offsets);
+
+    ResultSink sink = openSink(stream);
+    for(int i = 0; i < c; i++) {
+        sinkInt(sink, top[i].key);
+        sinkChar(sink, ';');
+        sinkString(sink, logins + offsets[i]);
+        sinkChar(sink, '\n');
     }
-    disposeFormat(comp_user_f);
-    freeLazy(user);
-    free(u);
-    g_hash_table_destroy(count);
-    freeKeyValuesGarray(pairs);
+    closeSink(sink);
+    free(logins);
+    free(offsets);
+    freeRanking(ranking);
+}
+
+/**
+ * @brief 				Prints rows of the 10th query, resolving the logins of their users at once
+ *
+ * @param catalog       The given #Catalog
+ * @param rows          The rows (user id : length of the longest message)
+ * @param repoIds       The id of the repo of each row
+ * @param n             The number of rows
+ * @param stream        The stream to write the ouput to
+ */
+static void printTenRows(Catalog catalog, COUNTERENTRY* rows, int* repoIds, int n, FILE* stream) {
+    int* offsets = malloc(MAX(n, 1) * sizeof(int));
+    char* logins = getRowLogins(catalog, rows, n, offsets);
+    ResultSink sink = openSink(stream);
+    for (int i = 0; i < n; i++) {
+        sinkInt(sink, rows[i].key);
+        sinkChar(sink, ';');
+        sinkString(sink, logins + offsets[i]);
+        sinkChar(sink, ';');
+        sinkInt(sink, rows[i].value);
+        sinkChar(sink, ';');
+        sinkInt(sink, repoIds[i]);
+        sinkChar(sink, '\n');
+    }
+    closeSink(sink);
+    free(logins);
+    free(offsets);
 }
 
 /**
  * @brief 				Solves the 10th query (Top N users with the longest to commit to each repo)
  *
- *  					Complexity: O(R + C + N)
+ *  					Complexity: O(RN), where R is the number of repos, reading the rankings solved when the #Catalog was built
  *
  * @param catalog       The given #Catalog
  * @param N				The number of #User to output per #Repo
  * @param stream        The stream to write the ouput to
+ * @param cancel        The #CancelToken of the query (checked between batches of rows)
  */
-void queryTen(Catalog catalog, int N, FILE* stream) {
-    int numberOfRepos=getTotalReposCount(catalog);
-    Format comp_user_f = getCompressedUserFormat();
-    User u = initUser();
-    Lazy user = makeLazy(NULL, 0, comp_user_f, u);
-    for(int i=0;i<numberOfRepos;i++){
-        int repoId;
-        GHashTable* UserbyCount= getHashTableOfLengthOfCommitsInArepoByRepoPositionInList(catalog,i,&repoId);
-        if (UserbyCount!=NULL){
-            GArray* pairs = getHashTableOrganizedyValues(UserbyCount);
-            int c = pairs->len;
-            for(int i = 0; i < MIN(N, c); i++) {
-                KeyValuePair pair=g_array_index(pairs,KeyValuePair,i);
-                int userId = GPOINTER_TO_INT(pair->key);
-                fprintf(stream, "%d;", userId);
-                printUserLoginById(catalog, userId, user, stream);
-                fprintf(stream, ";%d;%d\n",GPOINTER_TO_INT(g_hash_table_lookup(UserbyCount,GINT_TO_POINTER(userId))),repoId);
+void queryTen(Catalog catalog, int N, FILE* stream, CancelToken cancel) {
+    Ranking ranking = openMessageLengthRanking(catalog);
+    if (ranking == NULL) {
+        fprintf(stderr, "queryTen: could not open the ranking of the catalog\n");
+        return;
+    }
+
+    int numberOfRepos=getRankingGroups(ranking);
+    COUNTERENTRY* rows = malloc(LOGIN_BATCH_SIZE * sizeof(COUNTERENTRY));
+    int* repoIds = malloc(LOGIN_BATCH_SIZE * sizeof(int));
+    int size = 0;
+
+    for(int i=0;i<numberOfRepos && !isCancelled(cancel);i++){
+        int c;
+        COUNTERENTRY* top = readRankingGroup(ranking, i, N, &c);
+        for (int j = 0; j < c; j++) {
+            if (size == LOGIN_BATCH_SIZE) {
+                printTenRows(catalog, rows, repoIds, size, stream);
+                size = 0;
             }
-            g_hash_table_destroy(UserbyCount);
-            freeKeyValuesGarray(pairs);
+            rows[size] = top[j];
+            repoIds[size++] = getRankingGroupKey(ranking, i);
+        }
+    }
+    printTenRows(catalog, rows, repoIds, size, stream);
+
+    free(rows);
+    free(repoIds);
+    freeRanking(ranking);
+}
+
+/**
+ * @brief 				Writes rows, as "key;value" (the partial aggregate of a query on a shard)
+ *
+ * @param rows          The rows
+ * @param n             The number of rows
+ * @param stream        The stream to write the ouput to
+ */
+static void printPartialRows(COUNTERENTRY* rows, int n, FILE* stream) {
+    ResultSink sink = openSink(stream);
+    for (int i = 0; i < n; i++) {
+        sinkInt(sink, rows[i].key);
+        sinkChar(sink, ';');
+        sinkInt(sink, rows[i].value);
+        sinkChar(sink, '\n');
+    }
+    closeSink(sink);
+}
+
+/**
+ * @brief 				Writes every entry of a #Counter, as "key;value" (see @ref printPartialRows)
+ *
+ * @param counter       The given #Counter
+ * @param stream        The stream to write the ouput to
+ */
+static void printPartialCounter(Counter counter, FILE* stream) {
+    int n;
+    COUNTERENTRY* entries = getCounterEntries(counter, &n);
+    printPartialRows(entries, n, stream);
+}
+
+/**
+ * @brief 				Solves the fifth query on a shard of the dataset: writes the number of commits of every user in the
+ * 						date interval (see @ref printPartialRows), to be added up with those of the other shards
+ *
+ * @param catalog       The #Catalog of the shard
+ * @param startDate     The start #Date of the interval
+ * @param endDate       The end #Date of the interval
+ * @param stream        The stream to write the ouput to
+ * @param cancel        The #CancelToken of the query (nothing is written once it is cancelled)
+ */
+void partialFive(Catalog catalog, Date startDate, Date endDate, FILE* stream, CancelToken cancel) {
+    setTime(endDate, 23, 59, 59);
+
+    SpillCounter users = getCounterOfUserWithCommitsAfter(catalog, startDate, endDate, cancel);
+    for (int p = 0; p < getSpillPartitions(users) && !isCancelled(cancel); p++) {
+        int n;
+        COUNTERENTRY* entries = readSpillPartition(users, p, &n);
+        printPartialRows(entries, n, stream);
+    }
+    freeSpillCounter(users);
+}
+
+/**
+ * @brief 				Solves the sixth query on a shard of the dataset: writes the number of commits of every user in repos
+ * 						of the language (see @ref printPartialCounter)
+ *
+ * @param catalog       The #Catalog of the shard
+ * @param lang          The given language
+ * @param stream        The stream to write the ouput to
+ * @param cancel        The #CancelToken of the query (nothing is written once it is cancelled)
+ */
+void partialSix(Catalog catalog, char* lang, FILE* stream, CancelToken cancel) {
+    Ranking ranking = openLanguageRanking(catalog);
+    if (ranking != NULL) {
+        int c;
+        COUNTERENTRY* rows = readLanguageRanking(catalog, ranking, lang, INT_MAX, &c);
+        printPartialRows(rows, c, stream);
+        freeRanking(ranking);
+        return;
+    }
+
+    int differentUsers;
+    Counter count = getCounterOfCommitsPerLanguage(catalog, lang, &differentUsers, cancel);
+    if (!isCancelled(cancel))
+        printPartialCounter(count, stream);
+    freeCounter(count);
+}
+
+/**
+ * @brief 				Solves the eighth query on a shard of the dataset: writes the number of commits of every language
+ * 						from the date, as "value;language" (the ids of the languages are only known by the shard)
+ *
+ * @param catalog       The #Catalog of the shard
+ * @param startDate     The starting date
+ * @param stream        The stream to write the ouput to
+ * @param cancel        The #CancelToken of the query (nothing is written once it is cancelled)
+ */
+void partialEight(Catalog catalog, Date startDate, FILE* stream, CancelToken cancel) {
+    Counter languageCount = getCounterOfCommitsPerLanguageAfter(catalog, startDate, cancel);
+    if (!isCancelled(cancel)) {
+        int n;
+        COUNTERENTRY* entries = getCounterEntries(languageCount, &n);
+        ResultSink sink = openSink(stream);
+        for (int i = 0; i < n; i++) {
+            sinkInt(sink, entries[i].value);
+            sinkChar(sink, ';');
+            sinkString(sink, getCatalogLanguage(catalog, entries[i].key));
+            sinkChar(sink, '\n');
         }
+        closeSink(sink);
+    }
+    freeCounter(languageCount);
+}
+
+/**
+ * @brief 				Solves the ninth query on a shard of the dataset: writes the number of commits of every user in
+ * 						repos owned by their friends, as "key;value"
+ *
+ * @param catalog       The #Catalog of the shard
+ * @param stream        The stream to write the ouput to
+ */
+void partialNine(Catalog catalog, FILE* stream) {
+    Ranking ranking = openFriendsCommitsRanking(catalog);
+    if (ranking == NULL) {
+        fprintf(stderr, "partialNine: could not open the ranking of the catalog\n");
+        return;
     }
-    disposeFormat(comp_user_f);
-    freeLazy(user);
-    free(u);
+
+    int c;
+    COUNTERENTRY* rows = readRankingGroup(ranking, 0, INT_MAX, &c);
+    printPartialRows(rows, c, stream);
+    freeRanking(ranking);
 }
@@ -0,0 +1,144 @@
+/**
+ * @file sink.c
+ *
+ * File containing the implementation of the #ResultSink type
+ *
+ * The fields of the rows are copied to the buffer of the #ResultSink, the integers converted to text two digits at a
+ * time from a table, so each row costs a few copies instead of parsing a format string under the lock of the stream.
+ * The buffer is handed to the stream in a single fwrite whenever it fills up, which stdio passes straight to the file
+ * as it is larger than its own buffer
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/sink.h"
+
+/**
+ * @brief The text of every number of two digits, from "00" to "99"
+ */
+static const char digitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657"
+    "585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+/**
+ * @brief The maximum number of characters of an int written as text (its sign and 10 digits)
+ */
+#define INT_TEXT_SIZE 11
+
+/**
+ * @brief Structure representing a #ResultSink
+ */
+struct resultSink {
+    FILE* stream;   ///< The stream written to
+    char* buffer;   ///< The bytes not yet written to the stream
+    int used;       ///< The number of bytes of the buffer in use
+    bool ok;        ///< Whether or not every write to the stream succeeded
+};
+
+/**
+ * @brief           Opens a #ResultSink writing to a stream
+ *
+ * @param stream    The stream
+ *
+ * @return          The #ResultSink (to be closed with @ref closeSink)
+ */
+ResultSink openSink(FILE* stream) {
+    ResultSink s = malloc(sizeof(struct resultSink));
+    s->stream = stream;
+    s->buffer = malloc(SINK_BUFFER_SIZE);
+    s->used = 0;
+    s->ok = true;
+    return s;
+}
+
+/**
+ * @brief       Writes the buffer of a #ResultSink to its stream
+ *
+ * @param s     The given #ResultSink
+ */
+static void flushSink(ResultSink s) {
+    if (s->used > 0 && fwrite(s->buffer, 1, s->used, s->stream) != (size_t)s->used)
+        s->ok = false;
+    s->used = 0;
+}
+
+/**
+ * @brief       Appends an int, as text in base 10, to a #ResultSink
+ *
+ * @param s     The given #ResultSink
+ * @param value The int
+ */
+void sinkInt(ResultSink s, int value) {
+    if (s->used + INT_TEXT_SIZE > SINK_BUFFER_SIZE)
+        flushSink(s);
+
+    char digits[INT_TEXT_SIZE];
+    char* p = digits + INT_TEXT_SIZE;
+    unsigned int u = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+    while (u >= 100) {
+        unsigned int q = u / 100;
+        p -= 2;
+        memcpy(p, digitPairs + 2 * (u - q * 100), 2);
+        u = q;
+    }
+    if (u >= 10) {
+        p -= 2;
+        memcpy(p, digitPairs + 2 * u, 2);
+    } else
+        *--p = (char)('0' + u);
+    if (value < 0)
+        *--p = '-';
+
+    int len = (int)(digits + INT_TEXT_SIZE - p);
+    memcpy(s->buffer + s->used, p, len);
+    s->used += len;
+}
+
+/**
+ * @brief       Appends a string to a #ResultSink
+ *
+ * @param s     The given #ResultSink
+ * @param str   The string
+ */
+void sinkString(ResultSink s, const char* str) {
+    int len = (int)strlen(str);
+    if (s->used + len > SINK_BUFFER_SIZE)
+        flushSink(s);
+
+    if (len > SINK_BUFFER_SIZE) {
+        if (fwrite(str, 1, len, s->stream) != (size_t)len)
+            s->ok = false;
+        return;
+    }
+
+    memcpy(s->buffer + s->used, str, len);
+    s->used += len;
+}
+
+/**
+ * @brief       Appends a character to a #ResultSink
+ *
+ * @param s     The given #ResultSink
+ * @param c     The character
+ */
+void sinkChar(ResultSink s, char c) {
+    if (s->used == SINK_BUFFER_SIZE)
+        flushSink(s);
+    s->buffer[s->used++] = c;
+}
+
+/**
+ * @brief       Closes a #ResultSink, writing what is left of its buffer to its stream (which is left open)
+ *
+ * @param s     The given #ResultSink
+ *
+ * @return      Whether or not everything appended was written to the stream
+ */
+bool closeSink(ResultSink s) {
+    flushSink(s);
+    bool ok = s->ok;
+    free(s->buffer);
+    free(s);
+    return ok;
+}
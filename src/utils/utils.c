@@ -13,7 +13,10 @@
 #include <glib.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <termios.h>
+#include <time.h>
 
 #include "utils/utils.h"
 
@@ -190,20 +193,18 @@ bool checkInt(char* str, int length) {
  */
 bool safeStringToInt(char* str, int length, int* i)
 {
-    if (!checkInt(str, length))
+    if (!length)
         return false;
 
-    //Make sure to null terminate the string, without losing any data
-    //So we keep a temporary variable to store the next character in the array
-    char temp = str[length];
-    str[length] = '\0';
-
-    (*i) = atoi(str);
+    //The digits are validated and converted in the same pass
+    unsigned int n = 0;
+    for (; length > 0; length--, str++) {
+        if (*str < '0' || *str > '9')
+            return false;
+        n = n * 10 + (*str - '0');
+    }
 
-    //And restore it after we convert
-    //We do this because we only want to convert the substring of the given length, meaning
-    //the str is not null terminated by default in the length-th position
-    str[length] = temp;
+    (*i) = (int)n;
     return true;
 }
 
@@ -298,41 +299,81 @@ bool checkIdList(char* str, int length, int* list_size) {
     return length == 2 || !first_digit;
 }
 
+/**
+ * @brief           Reads the list of integers with the format "[1, 2, 3, ...]" in a single pass
+ *
+ * @param str       The list as a string. Not necessarily null-terminated
+ * @param length    The length of the string
+ * @param list      The variable in which to store the list (NULL if it is empty)
+ * @param list_size The size of the list
+ * @param validate  Whether or not to check the format of the list
+ * @param arena     The #Arena to allocate the list from (NULL to use malloc)
+ *
+ * @return True     If the string is a valid list of integers (or validate is false)
+ * @return False    Otherwise (nothing is allocated)
+ */
+static bool parseIdList(char* str, int length, int** list, int* list_size, bool validate, Arena arena) {
+    *list_size = 0;
+    *list = NULL;
+
+    if (validate && (length < 2 || str[0] != '[' || str[length - 1] != ']'))
+        return false;
+    if (length <= 2)
+        return true;
+
+    //Every id takes up at least 3 characters (digit, comma and space), except the last one
+    int* ids = arenaAlloc(arena, length / 3 * sizeof(int));
+    char *s = str + 1, *end = str + length - 1;
+
+    while (true) {
+        if (s == end || *s < '0' || *s > '9')
+            break;
+
+        unsigned int id = 0;
+        while (s < end && *s >= '0' && *s <= '9')
+            id = id * 10 + (*s++ - '0');
+        ids[(*list_size)++] = (int)id;
+
+        if (s == end) {
+            *list = ids;
+            return true;
+        }
+
+        if (s[0] != ',' || s[1] != ' ')
+            break;
+        s += 2;
+    }
+
+    //invalid list
+    if (!validate) {
+        *list = ids;
+        return true;
+    }
+    arenaFree(arena, ids);
+    *list_size = 0;
+    return false;
+}
+
 /**
  * @brief           Safely converts a string to an integer list.
  *                  If successful and the size of the list is greater than 0, allocates an array
  *                  and stores its size in *list_size. If str is a valid empty list, *list is set to NULL
  *
- * @param str       The string to convert to integer list. Is altered (strstep)
+ * @param str       The string to convert to integer list
  * @param length    The length of the string
  * @param list      The variable in which to store the result of the conversion
  * @param list_size The size of the converted integer list
+ * @param arena     The #Arena to allocate the list from (NULL to use malloc)
  *
  * @return True     If the string is a valid integer
  * @return False    Otherwise
  */
-bool readIdList(char *str, int length, int **list, int* list_size) {
-
-    if (!checkIdList(str, length, list_size))
+bool readIdList(char *str, int length, int **list, int* list_size, Arena arena) {
+    int* ids;
+    if (!parseIdList(str, length, &ids, list_size, true, arena))
         return false;
 
-    // case of []
-    if (*list_size == 0) {
-        *list = NULL;
-        return true;
-    }
-
-    //guardar espaço para as strings
-    *list = malloc(*list_size * sizeof(int));
-    //str[length - 1] = '\0';
-    int n = 0;
-
-    while (str) {
-        str++;
-        char* temp=strsep(&str,",");
-        (*list)[n++] = atoi(temp); //TODO: fix atoi (called without null terminator)
-    }
-
+    *list = ids;
     return true;
 }
 
@@ -342,33 +383,16 @@ bool readIdList(char *str, int length, int **list, int* list_size) {
  * @warning         This function does not check or validate the input
  *
  * @param str       The input string
+ * @param str_len   The length of the input string
  * @param list_size The size of the resulting list
+ * @param arena     The #Arena to allocate the list from (NULL to use malloc)
  * 
  * @return NULL     If list_size is 0
  * @return          A pointer to the allocated array
  */
-int* unsafeReadIdList(char* str, int str_len, int *list_size) {
-    if (str_len <= 2)
-        return NULL;
-
-    //The 10 here is an estimate of how many characters each member takes up
-    //With the comma and the space between each character, that leaves each integer taking up 8 characters
-    int list_capacity = str_len / 10;
-
-    int* list = malloc(list_capacity * sizeof(int));
-    *list_size = 0;
-    str++;
-
-    while (*str != ']') {
-        if (*list_size >= list_capacity) {
-            list_capacity *= 1.5;
-            list = realloc(list, list_capacity);
-        }
-
-        list[*list_size] = atoi(str);    //TODO: fix atoi (called without null terminator)
-        str += (int)log10(list[(*list_size)++]) + 3; //assume the id is positive
-    }
-
+int* unsafeReadIdList(char* str, int str_len, int *list_size, Arena arena) {
+    int* list;
+    parseIdList(str, str_len, &list, list_size, false, arena);
     return list;
 }
 
@@ -504,9 +528,162 @@ char* getQueryFileName() {
     return strdup(no);
 }
 
+/**
+ * @brief The number of lines between the lines whose position is kept by the line index of a file (see @ref indexFileLines)
+ */
+#define LINE_INDEX_STRIDE 64
+
+/**
+ * @brief The header of the line index of a file: identifies the version of the file it was built from
+ */
+typedef struct lineIndexHeader {
+    long size;      ///< The size of the file
+    long mtime;     ///< The time of the last modification of the file (seconds)
+    long mtime_ns;  ///< The time of the last modification of the file (nanoseconds of the second)
+    long inode;     ///< The inode of the file
+    int lines;      ///< The number of lines of the file
+    int stride;     ///< @ref LINE_INDEX_STRIDE when the index was built
+} LINEINDEXHEADER;
+
+/**
+ * @brief           Gets the path to the line index of a file (in the output directory, named after the file)
+ *
+ * @param filename  The path to the file
+ *
+ * @return          The path (must be freed)
+ */
+static char* getLineIndexName(char* filename) {
+    char* base = strrchr(filename, '/');
+    base = base == NULL ? filename : base + 1;
+
+    char* name = malloc(strlen(base) + 13);
+    sprintf(name, "saida/%s.lines", base);
+    return name;
+}
+
+/**
+ * @brief           Builds the header of the line index of a file, as it is now
+ *
+ * @param fd        The file descriptor of the file
+ * @param header    Where to write the header (without the number of lines)
+ *
+ * @return          Whether the file could be inspected
+ */
+static bool getLineIndexHeader(int fd, LINEINDEXHEADER* header) {
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return false;
+
+    *header = (LINEINDEXHEADER){ .size = st.st_size, .mtime = st.st_mtim.tv_sec, .mtime_ns = st.st_mtim.tv_nsec,
+                                 .inode = st.st_ino, .lines = 0, .stride = LINE_INDEX_STRIDE };
+    return true;
+}
+
+/**
+ * @brief           Writes the line index of a file: the position of every @ref LINE_INDEX_STRIDE th line, so
+ *                  @ref getFileContent seeks close to the first line it reads instead of reading the lines before it.
+ *                  Called by the writers of the files paged through, and by @ref getFileContent if it is missing or stale
+ *
+ * @param filename  The path to the file
+ */
+void indexFileLines(char* filename) {
+    int fd = open(filename, O_RDONLY);
+    LINEINDEXHEADER header;
+    if (fd == -1 || !getLineIndexHeader(fd, &header)) {
+        if (fd != -1)
+            close(fd);
+        return;
+    }
+
+    int capacity = 1024;
+    long* positions = malloc(capacity * sizeof(long));
+    char* block = malloc(1 << 20);
+    long pos = 0;
+    ssize_t read;
+    bool line_start = true;
+
+    //A line starts at the beginning of the file and after each line break (unless the file ends there)
+    while (pos < header.size && (read = pread(fd, block, MIN(1 << 20, header.size - pos), pos)) > 0) {
+        for (ssize_t j = 0; j < read; j++) {
+            bool starts = line_start;
+            line_start = block[j] == '\n';
+            if (!starts)
+                continue;
+
+            if (header.lines % LINE_INDEX_STRIDE == 0) {
+                if (header.lines / LINE_INDEX_STRIDE == capacity) {
+                    capacity *= 2;
+                    positions = realloc(positions, capacity * sizeof(long));
+                }
+                positions[header.lines / LINE_INDEX_STRIDE] = pos + j;
+            }
+            header.lines++;
+        }
+        pos += read;
+    }
+    close(fd);
+    free(block);
+
+    char* index_name = getLineIndexName(filename);
+    FILE* index = fopen(index_name, "wb");
+    if (index != NULL) {
+        int entries = (header.lines + LINE_INDEX_STRIDE - 1) / LINE_INDEX_STRIDE;
+        bool ok = fwrite(&header, sizeof(header), 1, index) == 1
+               && fwrite(positions, sizeof(long), entries, index) == (size_t)entries;
+        if (fclose(index) != 0 || !ok)
+            remove(index_name);
+    }
+
+    free(index_name);
+    free(positions);
+}
+
+/**
+ * @brief           Finds the position of a line of a file through its line index
+ *
+ * @param filename  The path to the file
+ * @param fd        The file descriptor of the file
+ * @param line      The line
+ * @param first     Where to write the number of the line found (the closest before, or the line itself)
+ *
+ * @return -1       If the file has no line index, or it is stale
+ * @return          The position of the line found (the size of the file if the file has fewer lines)
+ */
+static long findIndexedLine(char* filename, int fd, int line, int* first) {
+    LINEINDEXHEADER current, header;
+    if (!getLineIndexHeader(fd, &current))
+        return -1;
+
+    char* index_name = getLineIndexName(filename);
+    int index = open(index_name, O_RDONLY);
+    free(index_name);
+    if (index == -1)
+        return -1;
+
+    long pos = -1;
+    if (pread(index, &header, sizeof(header), 0) == sizeof(header) && header.size == current.size
+        && header.mtime == current.mtime && header.mtime_ns == current.mtime_ns && header.inode == current.inode
+        && header.stride == LINE_INDEX_STRIDE) {
+        if (line >= header.lines) {
+            *first = header.lines;
+            pos = header.size;
+        } else {
+            int entry = MAX(line, 0) / LINE_INDEX_STRIDE;
+            if (pread(index, &pos, sizeof(long), sizeof(header) + entry * sizeof(long)) != sizeof(long))
+                pos = -1;
+            *first = entry * LINE_INDEX_STRIDE;
+        }
+    }
+    close(index);
+    return pos;
+}
+
 /**
  * @brief           Prints the requested lines of a file to an array of strings
  *
+ *                  The file is read from the closest line before begin kept by its line index (built first if it is
+ *                  missing or stale, see @ref indexFileLines), so deep pages cost the same as the first
+ *
  * @param filename  The path of the file to read
  * @param begin     The first line to read (0-indexed, inclusive)
  * @param end       The last line to read (0-indexed, inclusive)
@@ -528,6 +705,16 @@ char** getFileContent(char* filename, int begin, int end, int* size) {
     if(file) {
         int index = 0;
 
+        long pos = begin > 0 ? findIndexedLine(filename, fileno(file), begin, &index) : 0;
+        if (pos == -1) {
+            indexFileLines(filename);
+            pos = findIndexedLine(filename, fileno(file), begin, &index);
+        }
+        if (pos > 0)
+            fseek(file, pos, SEEK_SET);
+        else
+            index = 0;
+
         while(index < begin && getFileLine(file, &buffer, &bufferSize)) {
             ++index;
         }
@@ -590,10 +777,7 @@ int getFileLine(FILE* file, char** buffer, int* buffer_size) {
  * @param n     The int to write to
  */
 void writeIntToBinaryString(char* bytes, int n) {
-    (bytes)[0] = (n >> 24) & 0xFF;
-    (bytes)[1] = (n >> 16) & 0xFF;
-    (bytes)[2] = (n >> 8) & 0xFF;
-    (bytes)[3] = n & 0xFF;
+    memcpy(bytes, &n, sizeof(int));
 }
 
 /**
@@ -607,23 +791,24 @@ void IntListToBinaryString(char** bytes, int N, int l[]) {
     if (!(*bytes)) 
         *bytes = malloc(N * sizeof(int) * sizeof(char));
 
-    for(int i=0;i<N;i++) {
-        int aux =  l[i];
-        writeIntToBinaryString(*bytes + (sizeof(int) * i), aux);
-    }
+    if (N > 0)
+        memcpy(*bytes, l, N * sizeof(int));
 }
 
 
 /**
  * @brief reads a int from the binary string
  *
- * at some point in time i completly forgot how this works but it works so...
+ * The ints are kept in the byte order of the machine (the files are not meant to be moved between machines), so they
+ * are copied as they are (the string may not be aligned to an int)
  *
  * @param bytes the binary string
  * @return the int found in the string
  */
 int readIntFromBinaryString(char *bytes){
-    return ((((bytes[0]<<24) & 0xFF000000) | ((bytes[1]<<16) & 0x00FF0000) | ( (bytes[2]<<8) & 0x0000FF00) | (((bytes[3]) & 0x000000FF))));
+    int n;
+    memcpy(&n, bytes, sizeof(int));
+    return n;
 }
 
 
@@ -632,21 +817,31 @@ int readIntFromBinaryString(char *bytes){
  *
  * @param bytes     The string to read from
  * @param N         The number of elements in the string
+ * @param arena     The #Arena to allocate the list from (NULL to use malloc)
  * 
  * @return          The list of ints found
  */
-int* BinaryStringTointList(char *bytes, int N) {
+int* BinaryStringTointList(char *bytes, int N, Arena arena) {
 	if (N==0) 
         return NULL;
 
-    int *l=malloc(sizeof(int)*N);
-
-    for (int i=0; i<N; i++)
-        l[i] = readIntFromBinaryString(bytes+sizeof(int)*i);
+    int *l=arenaAlloc(arena, sizeof(int)*N);
+    memcpy(l, bytes, sizeof(int)*N);
 
     return l;
 }
 
+/**
+ * @brief       Gets the time of a monotonic clock, to measure the wall clock time taken by some work
+ *
+ * @return      The time (in seconds, from an arbitrary point)
+ */
+double getWallClock() {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
 /**
  * @brief 		    Finds if a number is inside of a list using binary search
  *
@@ -671,37 +866,3 @@ bool binSearchInList(int key, int*l, int N) {
 
 	return key == l[p];
 }
-
-/**
- * @brief 			Increses the value stored in a given key of a hashtable by 1 if is not already in the hastable stores it as 1
- *
- * @param users 	The hashTable to search in
- * @param id 		The key to search by
- * @param new 		Pointer to store if a new key was added to the hashtable
- */
-void increaseNumberInHashTableIfFound(GHashTable* users, gpointer id, int*new) {
-	gpointer searchResult = g_hash_table_lookup(users,id);
-    if(searchResult != NULL) {
-        int newValue = GPOINTER_TO_INT(searchResult) + 1;
-        g_hash_table_replace(users,id,GINT_TO_POINTER(newValue));
-    } else {
-        g_hash_table_insert(users,id,GINT_TO_POINTER(1));
-        *new=(*new)+1;
-    }
-}
-
-/**
- * @brief 			Increses the value stored in a given key of a hashtable by a given value if this one is greater than the previous one or if its not in the hash table already.
- *
- * @param users 	The hashTable to search in
- * @param id 		The key to search by
- * @param value 	The value to store in the key
- */
-void storeNumberInHashTableIfGreater(GHashTable* users, gpointer id, int value) {
-	gpointer searchResult = g_hash_table_lookup(users,id);
-    if(searchResult != NULL) {
-		if(GPOINTER_TO_INT(searchResult)<value) g_hash_table_replace(users,id,GINT_TO_POINTER(value));
-    } else {
-        g_hash_table_insert(users,id,GINT_TO_POINTER(value));
-    }
-}